@@ -17,6 +17,7 @@ inline int omp_get_thread_num() { return 0; }
 inline int omp_get_max_threads() { return 1; }
 inline void omp_set_num_threads(int num_threads) {}
 inline int omp_get_num_procs() { return 1; }
+inline int omp_in_parallel() { return 0; }
 inline void omp_set_nested(int nested) {}
 
 inline void omp_init_lock(omp_lock_t *lock) {}
@@ -42,6 +42,31 @@ public:
         return p;
     }
 
+    /**
+     * @brief Add distortion to a set of points (assume points are in the camera frame [normalized coordinates])
+     * @note Distortion models may override it with a vectorized implementation
+     * @param[in,out] pts The points (one per column)
+     */
+    virtual void addDistortionPoints(Mat2X& pts) const
+    {
+        for(Eigen::Index i = 0; i < pts.cols(); ++i)
+        {
+            pts.col(i) = addDistortion(pts.col(i));
+        }
+    }
+
+    /**
+     * @brief Remove distortion to a set of points (assume points are in the camera frame [normalized coordinates])
+     * @param[in,out] pts The points (one per column)
+     */
+    virtual void removeDistortionPoints(Mat2X& pts) const
+    {
+        for(Eigen::Index i = 0; i < pts.cols(); ++i)
+        {
+            pts.col(i) = removeDistortion(pts.col(i));
+        }
+    }
+
     virtual double getUndistortedRadius(double r) const
     {
         return r;
@@ -0,0 +1,198 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/numeric/numeric.hpp>
+#include <aliceVision/camera/IntrinsicBase.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace aliceVision {
+namespace camera {
+
+/**
+ * @brief Cache of a camera pixel mapping (distortion or undistortion) on a regular grid.
+ *
+ * The exact mapping is only evaluated on the grid nodes, each query is then a bilinear interpolation.
+ * It avoids the per pixel virtual calls and the iterative inversion of the distortion model
+ * when a large number of pixels has to be mapped (full images, all the observations of a scene).
+ * Points outside of the grid domain use the exact mapping.
+ *
+ * @note The grid is only valid for the intrinsic parameters used to build it.
+ */
+class DistortionGrid
+{
+public:
+  enum class EMapping
+  {
+    UNDISTORT, //< distorted pixel to undistorted pixel (get_ud_pixel)
+    DISTORT    //< undistorted pixel to distorted pixel (get_d_pixel)
+  };
+
+  DistortionGrid() = default;
+
+  /**
+   * @brief Build a grid covering the image domain
+   * @param[in] intrinsic the camera intrinsic
+   * @param[in] mapping the cached pixel mapping
+   * @param[in] cellSize the distance between two grid nodes (in pixels)
+   * @param[in] margin the extra border around the image domain (in pixels)
+   */
+  DistortionGrid(const IntrinsicBase& intrinsic, EMapping mapping, double cellSize = 8.0, double margin = 0.0)
+  {
+    build(intrinsic, mapping, Vec2(-margin, -margin), Vec2(intrinsic.w() + margin, intrinsic.h() + margin), cellSize);
+  }
+
+  /**
+   * @brief Build the grid on a given domain
+   * @param[in] intrinsic the camera intrinsic
+   * @param[in] mapping the cached pixel mapping
+   * @param[in] domainMin the top-left corner of the grid domain (in pixels)
+   * @param[in] domainMax the bottom-right corner of the grid domain (in pixels)
+   * @param[in] cellSize the distance between two grid nodes (in pixels)
+   */
+  void build(const IntrinsicBase& intrinsic, EMapping mapping, const Vec2& domainMin, const Vec2& domainMax, double cellSize = 8.0)
+  {
+    _intrinsic.reset(intrinsic.clone());
+    _mapping = mapping;
+    _cellSize = cellSize;
+    _domainMin = domainMin;
+    _width = std::max(2, int(std::ceil((domainMax(0) - domainMin(0)) / cellSize)) + 1);
+    _height = std::max(2, int(std::ceil((domainMax(1) - domainMin(1)) / cellSize)) + 1);
+    _domainMax = domainMin + Vec2(_width - 1, _height - 1) * cellSize;
+
+    _nodes.resize(2, _width * _height);
+
+    #pragma omp parallel for
+    for(int y = 0; y < _height; ++y)
+    {
+      Mat2X rowNodes(2, _width);
+      for(int x = 0; x < _width; ++x)
+      {
+        rowNodes.col(x) = _domainMin + Vec2(x, y) * _cellSize;
+      }
+
+      Mat2X rowMappedNodes;
+      mapExact(rowNodes, rowMappedNodes);
+      _nodes.middleCols(y * _width, _width) = rowMappedNodes;
+    }
+  }
+
+  /**
+   * @brief Return true if the grid has been built
+   */
+  inline bool isValid() const
+  {
+    return _intrinsic != nullptr;
+  }
+
+  /**
+   * @brief Return true if the point is inside the grid domain
+   * @param[in] p the point (in pixels)
+   */
+  inline bool contains(const Vec2& p) const
+  {
+    return p(0) >= _domainMin(0) && p(1) >= _domainMin(1) && p(0) <= _domainMax(0) && p(1) <= _domainMax(1);
+  }
+
+  /**
+   * @brief Map a pixel
+   * @param[in] p the pixel
+   * @return the mapped pixel
+   */
+  inline Vec2 get(const Vec2& p) const
+  {
+    if(!contains(p))
+    {
+      return (_mapping == EMapping::UNDISTORT) ? _intrinsic->get_ud_pixel(p) : _intrinsic->get_d_pixel(p);
+    }
+
+    const double gx = (p(0) - _domainMin(0)) / _cellSize;
+    const double gy = (p(1) - _domainMin(1)) / _cellSize;
+    const int x = std::min(int(gx), _width - 2);
+    const int y = std::min(int(gy), _height - 2);
+    const double dx = gx - x;
+    const double dy = gy - y;
+
+    const Eigen::Index i = y * _width + x;
+    const Vec2 top = (1.0 - dx) * _nodes.col(i) + dx * _nodes.col(i + 1);
+    const Vec2 bottom = (1.0 - dx) * _nodes.col(i + _width) + dx * _nodes.col(i + _width + 1);
+
+    return (1.0 - dy) * top + dy * bottom;
+  }
+
+  /**
+   * @brief Compute the maximum distance between the interpolated and the exact mapping.
+   * It is evaluated at the center of each grid cell, where the bilinear interpolation is the least accurate.
+   * @return the maximum interpolation error (in pixels)
+   */
+  double computeMaxError() const
+  {
+    if(!isValid())
+      return 0.0;
+
+    double maxError = 0.0;
+
+    #pragma omp parallel for reduction(max:maxError)
+    for(int y = 0; y < _height - 1; ++y)
+    {
+      Mat2X rowCenters(2, _width - 1);
+      for(int x = 0; x < _width - 1; ++x)
+      {
+        rowCenters.col(x) = _domainMin + Vec2(x + 0.5, y + 0.5) * _cellSize;
+      }
+
+      Mat2X rowMappedCenters;
+      mapExact(rowCenters, rowMappedCenters);
+
+      for(int x = 0; x < _width - 1; ++x)
+      {
+        maxError = std::max(maxError, (get(Vec2(rowCenters.col(x))) - rowMappedCenters.col(x)).norm());
+      }
+    }
+    return maxError;
+  }
+
+  /**
+   * @brief Map a set of pixels
+   * @param[in] pts the pixels (one per column)
+   * @param[out] out_pts the mapped pixels (one per column)
+   */
+  void get(const Mat2X& pts, Mat2X& out_pts) const
+  {
+    out_pts.resize(2, pts.cols());
+    for(Eigen::Index i = 0; i < pts.cols(); ++i)
+    {
+      out_pts.col(i) = get(pts.col(i));
+    }
+  }
+
+private:
+
+  void mapExact(const Mat2X& pts, Mat2X& out_pts) const
+  {
+    if(_mapping == EMapping::UNDISTORT)
+      _intrinsic->get_ud_pixels(pts, out_pts);
+    else
+      _intrinsic->get_d_pixels(pts, out_pts);
+  }
+
+  std::shared_ptr<IntrinsicBase> _intrinsic;
+  EMapping _mapping = EMapping::UNDISTORT;
+  double _cellSize = 8.0;
+  Vec2 _domainMin{0.0, 0.0};
+  Vec2 _domainMax{0.0, 0.0};
+  int _width = 0;
+  int _height = 0;
+  /// mapped position of each grid node (row-major)
+  Mat2X _nodes;
+};
+
+} // namespace camera
+} // namespace aliceVision
@@ -84,6 +84,13 @@ public:
     return (p * r_coeff);
   }
 
+  void addDistortionPoints(Mat2X& pts) const override
+  {
+    const double k1 = _distortionParams.at(0);
+    const Eigen::Array<double, 1, Eigen::Dynamic> r2 = pts.colwise().squaredNorm().array();
+    pts.array().rowwise() *= (1. + k1 * r2);
+  }
+
   Eigen::Matrix2d getDerivativeAddDistoWrtPt(const Vec2 & p) const override
   {
 
@@ -244,6 +251,16 @@ public:
     return (p * r_coeff);
   }
 
+  void addDistortionPoints(Mat2X& pts) const override
+  {
+    const double k1 = _distortionParams[0];
+    const double k2 = _distortionParams[1];
+    const double k3 = _distortionParams[2];
+
+    const Eigen::Array<double, 1, Eigen::Dynamic> r2 = pts.colwise().squaredNorm().array();
+    pts.array().rowwise() *= (1. + r2 * (k1 + r2 * (k2 + r2 * k3)));
+  }
+
   Eigen::Matrix2d getDerivativeAddDistoWrtPt(const Vec2 & p) const override
   {
 
@@ -397,6 +397,11 @@ public:
     return _circleRadius * p  + getPrincipalPoint();
   }
 
+  void cam2imaPoints(Mat2X& pts) const override
+  {
+    pts = (_circleRadius * pts).colwise() + getPrincipalPoint();
+  }
+
   Eigen::Matrix2d getDerivativeCam2ImaWrtPoint() const override
   {
     return Eigen::Matrix2d::Identity() * _circleRadius;
@@ -408,6 +413,11 @@ public:
     return (p - getPrincipalPoint()) / _circleRadius;
   }
 
+  void ima2camPoints(Mat2X& pts) const override
+  {
+    pts = (pts.colwise() - getPrincipalPoint()) / _circleRadius;
+  }
+
   Eigen::Matrix2d getDerivativeIma2CamWrtPoint() const override
   {
     return Eigen::Matrix2d::Identity() * (1.0 / _circleRadius);
@@ -139,6 +139,23 @@ public:
    */
   virtual Vec2 project(const geometry::Pose3& pose, const Vec4& pt3D, bool applyDistortion = true) const = 0;
 
+  /**
+   * @brief Projection of a set of 3D points into the camera plane (Apply pose, disto (if any) and Intrinsics)
+   * @note Camera models may override it with a vectorized implementation
+   * @param[in] pose The pose
+   * @param[in] pts3D The 3d points (one per column)
+   * @param[out] out_pts2D The 2d projections in the camera plane (one per column)
+   * @param[in] applyDistortion If true apply distrortion if any
+   */
+  virtual void projectPoints(const geometry::Pose3& pose, const Mat3X& pts3D, Mat2X& out_pts2D, bool applyDistortion = true) const
+  {
+    out_pts2D.resize(2, pts3D.cols());
+    for(Eigen::Index i = 0; i < pts3D.cols(); ++i)
+    {
+      out_pts2D.col(i) = project(pose, pts3D.col(i).homogeneous(), applyDistortion);
+    }
+  }
+
   /**
    * @brief Back-projection of a 2D point at a specific depth into a 3D point
    * @param[in] pt2D The 2d point
@@ -233,13 +250,9 @@ public:
   inline Mat2X residuals(const geometry::Pose3& pose, const Mat3X& X, const Mat2X& x) const
   {
     assert(X.cols() == x.cols());
-    const std::size_t numPts = x.cols();
-    Mat2X residuals = Mat2X::Zero(2, numPts);
-    for(std::size_t i = 0; i < numPts; ++i)
-    {
-      residuals.col(i) = residual(pose, ((const Vec3&)X.col(i)).homogeneous(), x.col(i));
-    }
-    return residuals;
+    Mat2X proj;
+    projectPoints(pose, X, proj);
+    return x - proj;
   }
 
   /**
@@ -386,6 +399,30 @@ public:
    */
   virtual Vec2 ima2cam(const Vec2& p) const = 0;
 
+  /**
+   * @brief Transform a set of points from the camera plane to the image plane
+   * @param[in,out] pts The points (one per column)
+   */
+  virtual void cam2imaPoints(Mat2X& pts) const
+  {
+    for(Eigen::Index i = 0; i < pts.cols(); ++i)
+    {
+      pts.col(i) = cam2ima(pts.col(i));
+    }
+  }
+
+  /**
+   * @brief Transform a set of points from the image plane to the camera plane
+   * @param[in,out] pts The points (one per column)
+   */
+  virtual void ima2camPoints(Mat2X& pts) const
+  {
+    for(Eigen::Index i = 0; i < pts.cols(); ++i)
+    {
+      pts.col(i) = ima2cam(pts.col(i));
+    }
+  }
+
   /**
    * @brief Camera model handle a distortion field
    * @return True if the camera model handle a distortion field
@@ -429,6 +466,35 @@ public:
    */
   virtual Vec2 get_d_pixel(const Vec2& p) const = 0;
 
+  /**
+   * @brief Return the undistorted pixels (with removed distortion)
+   * @note To undistort a large number of pixels, see camera::DistortionGrid
+   * @param[in] pts The points (one per column)
+   * @param[out] out_pts The undistorted pixels (one per column)
+   */
+  virtual void get_ud_pixels(const Mat2X& pts, Mat2X& out_pts) const
+  {
+    out_pts.resize(2, pts.cols());
+    for(Eigen::Index i = 0; i < pts.cols(); ++i)
+    {
+      out_pts.col(i) = get_ud_pixel(pts.col(i));
+    }
+  }
+
+  /**
+   * @brief Return the distorted pixels (with added distortion)
+   * @param[in] pts The undistorted points (one per column)
+   * @param[out] out_pts The distorted pixels (one per column)
+   */
+  virtual void get_d_pixels(const Mat2X& pts, Mat2X& out_pts) const
+  {
+    out_pts.resize(2, pts.cols());
+    for(Eigen::Index i = 0; i < pts.cols(); ++i)
+    {
+      out_pts.col(i) = get_d_pixel(pts.col(i));
+    }
+  }
+
   /**
    * @brief Normalize a given unit pixel error to the camera plane
    * @param[in] value Given unit pixel error
@@ -80,6 +80,12 @@ public:
     return p.cwiseProduct(_scale) + getPrincipalPoint();
   }
 
+  void cam2imaPoints(Mat2X& pts) const override
+  {
+    const Vec2 pp = getPrincipalPoint();
+    pts = (pts.array().colwise() * _scale.array()).colwise() + pp.array();
+  }
+
   virtual Eigen::Matrix2d getDerivativeCam2ImaWrtScale(const Vec2& p) const
   {
     Eigen::Matrix2d M = Eigen::Matrix2d::Zero();
@@ -118,6 +124,12 @@ public:
     return np;
   }
 
+  void ima2camPoints(Mat2X& pts) const override
+  {
+    const Vec2 pp = getPrincipalPoint();
+    pts = (pts.array().colwise() - pp.array()).colwise() / _scale.array();
+  }
+
   virtual Eigen::Matrix<double, 2, 2> getDerivativeIma2CamWrtScale(const Vec2& p) const
   {
       Eigen::Matrix2d M = Eigen::Matrix2d::Zero();
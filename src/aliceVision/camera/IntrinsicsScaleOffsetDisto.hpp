@@ -86,6 +86,28 @@ public:
     return cam2ima(addDistortion(ima2cam(p)));
   }
 
+  void get_ud_pixels(const Mat2X& pts, Mat2X& out_pts) const override
+  {
+    out_pts = pts;
+    ima2camPoints(out_pts);
+    if (_pDistortion != nullptr)
+    {
+      _pDistortion->removeDistortionPoints(out_pts);
+    }
+    cam2imaPoints(out_pts);
+  }
+
+  void get_d_pixels(const Mat2X& pts, Mat2X& out_pts) const override
+  {
+    out_pts = pts;
+    ima2camPoints(out_pts);
+    if (_pDistortion != nullptr)
+    {
+      _pDistortion->addDistortionPoints(out_pts);
+    }
+    cam2imaPoints(out_pts);
+  }
+
   std::size_t getDistortionParamsSize() const
   {
     if (_pDistortion == nullptr)
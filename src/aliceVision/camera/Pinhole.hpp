@@ -109,6 +109,18 @@ public:
     return impt;
   }
 
+  void projectPoints(const geometry::Pose3& pose, const Mat3X& pts3D, Mat2X& out_pts2D, bool applyDistortion = true) const override
+  {
+    const Mat3X X = pose(pts3D); // apply pose
+    out_pts2D = X.topRows<2>().array().rowwise() / X.row(2).array();
+
+    if (applyDistortion && hasDistortion())
+    {
+      _pDistortion->addDistortionPoints(out_pts2D);
+    }
+    cam2imaPoints(out_pts2D);
+  }
+
   Eigen::Matrix<double, 2, 9> getDerivativeProjectWrtRotation(const geometry::Pose3& pose, const Vec4 & pt)
   {
     const Vec4 X = pose.getHomogeneous() * pt; // apply pose
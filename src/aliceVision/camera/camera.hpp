@@ -9,6 +9,7 @@
 
 #include <aliceVision/camera/cameraCommon.hpp>
 #include <aliceVision/camera/IntrinsicBase.hpp>
+#include <aliceVision/camera/DistortionGrid.hpp>
 #include <aliceVision/camera/Pinhole.hpp>
 #include <aliceVision/camera/PinholeRadial.hpp>
 #include <aliceVision/camera/Pinhole3DE.hpp>
@@ -13,6 +13,7 @@
 #include <aliceVision/image/Sampler.hpp>
 #include <aliceVision/camera/cameraCommon.hpp>
 #include <aliceVision/camera/IntrinsicBase.hpp>
+#include <aliceVision/camera/DistortionGrid.hpp>
 #include <aliceVision/camera/Pinhole.hpp>
 #include <aliceVision/image/io.hpp>
 
@@ -21,7 +22,11 @@
 namespace aliceVision {
 namespace camera {
 
-/// Undistort an image according a given camera and its distortion model
+/**
+ * @brief Undistort an image according a given camera and its distortion model
+ * @param[in] distortionGridMaxError the distortion can be interpolated from a grid (faster) if its maximum error
+ *            is below this threshold (in pixels), otherwise the exact mapping is used. 0 to always use the exact mapping.
+ */
 template <typename T>
 void UndistortImage(
   const image::Image<T>& imageIn,
@@ -29,7 +34,8 @@ void UndistortImage(
   image::Image<T>& image_ud,
   T fillcolor,
   bool correctPrincipalPoint = false, 
-  const oiio::ROI & roi = oiio::ROI())
+  const oiio::ROI & roi = oiio::ROI(),
+  double distortionGridMaxError = 0.01)
 {
   if (!intrinsicPtr->hasDistortion()) // no distortion, perform a direct copy
   {
@@ -63,15 +69,31 @@ void UndistortImage(
 
     image_ud.resize(widthRoi, heightRoi, true, fillcolor);
     const image::Sampler2d<image::SamplerLinear> sampler;
-    
-    
+
+    // cache the distortion on a grid covering the output image, to avoid a virtual call per pixel,
+    // only if the interpolation is accurate enough for this distortion
+    DistortionGrid distortionGrid;
+    if(distortionGridMaxError > 0.0)
+    {
+      const Vec2 domainMin = Vec2(xOffset, yOffset) + ppCorrection;
+      distortionGrid.build(*intrinsicPtr, DistortionGrid::EMapping::DISTORT, domainMin, domainMin + Vec2(widthRoi, heightRoi));
+
+      const double gridMaxError = distortionGrid.computeMaxError();
+      if(gridMaxError > distortionGridMaxError)
+      {
+        ALICEVISION_LOG_DEBUG("UndistortImage: distortion grid error of " << gridMaxError << " pixels, use the exact distortion.");
+        distortionGrid = DistortionGrid();
+      }
+    }
+
     #pragma omp parallel for
     for(int j = 0; j < heightRoi; ++j)
         for(int i = 0; i < widthRoi; ++i)
         {       
             const Vec2 undisto_pix(i + xOffset, j + yOffset); 
             // compute coordinates with distortion
-            const Vec2 disto_pix = intrinsicPtr->get_d_pixel(undisto_pix + ppCorrection);
+            const Vec2 disto_pix = distortionGrid.isValid() ? distortionGrid.get(undisto_pix + ppCorrection)
+                                                            : intrinsicPtr->get_d_pixel(undisto_pix + ppCorrection);
            
             // pick pixel if it is in the image domain
             if(imageIn.Contains(disto_pix(1), disto_pix(0)))
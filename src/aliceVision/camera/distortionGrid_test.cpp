@@ -0,0 +1,120 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/camera/PinholeRadial.hpp>
+#include <aliceVision/camera/Pinhole3DE.hpp>
+#include <aliceVision/camera/EquidistantRadial.hpp>
+#include <aliceVision/camera/DistortionGrid.hpp>
+
+#define BOOST_TEST_MODULE distortionGrid
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/tools/floating_point_comparison.hpp>
+#include <aliceVision/unitTest.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::camera;
+
+//-----------------
+// Test summary:
+//-----------------
+// - Create cameras with distortion
+// - Check that the batch projection / (un)distortion give the same results as the per point functions
+//-----------------
+BOOST_AUTO_TEST_CASE(distortionGrid_batchEqualsPerPoint)
+{
+  makeRandomOperationsReproducible();
+
+  const std::vector<std::shared_ptr<IntrinsicBase>> cameras = {
+    std::make_shared<PinholeRadialK3>(1000, 800, 1000, 1000, 5, -3, 0.1, -0.02, 0.005),
+    std::make_shared<Pinhole3DERadial4>(1000, 800, 1000, 1000, 5, -3, 0.05, 0.01, 0.001, 0.001, 0.0, 0.0),
+    std::make_shared<EquiDistantRadialK3>(1000, 800, 300, 5, -3, 400, 0.05, 0.01, 0.0)};
+
+  const geometry::Pose3 pose(geometry::randomPose());
+
+  for(const auto& cam : cameras)
+  {
+    // 3D points in front of the camera
+    Mat3X pts3D(3, 50);
+    for(Eigen::Index i = 0; i < pts3D.cols(); ++i)
+    {
+      const Vec2 pt2D = Vec2(500, 400) + Vec2::Random().cwiseProduct(Vec2(300, 250));
+      pts3D.col(i) = cam->backproject(pt2D, true, pose, 1.0 + std::abs(Vec2::Random()(0)) * 10.0);
+    }
+
+    Mat2X projected;
+    cam->projectPoints(pose, pts3D, projected);
+
+    Mat2X pixels = Mat2X::Random(2, 50);
+    pixels = (pixels.array().colwise() * Eigen::Array2d(300, 250)).colwise() + Eigen::Array2d(500, 400);
+    Mat2X undistorted;
+    cam->get_ud_pixels(pixels, undistorted);
+    Mat2X distorted;
+    cam->get_d_pixels(pixels, distorted);
+
+    for(Eigen::Index i = 0; i < pts3D.cols(); ++i)
+    {
+      EXPECT_MATRIX_NEAR(cam->project(pose, pts3D.col(i).homogeneous(), true), projected.col(i), 1e-8);
+      EXPECT_MATRIX_NEAR(cam->get_ud_pixel(pixels.col(i)), undistorted.col(i), 1e-8);
+      EXPECT_MATRIX_NEAR(cam->get_d_pixel(pixels.col(i)), distorted.col(i), 1e-8);
+    }
+  }
+}
+
+//-----------------
+// Test summary:
+//-----------------
+// - Create a camera with a strong distortion
+// - Build undistortion and distortion grids
+// - Check that the interpolated mapping is close to the exact one (inside and outside the grid domain)
+//-----------------
+BOOST_AUTO_TEST_CASE(distortionGrid_interpolation)
+{
+  makeRandomOperationsReproducible();
+
+  const PinholeRadialK3 cam(1000, 800, 1000, 1000, 5, -3, 0.1, -0.02, 0.005);
+
+  const DistortionGrid undistortionGrid(cam, DistortionGrid::EMapping::UNDISTORT);
+  const DistortionGrid distortionGrid(cam, DistortionGrid::EMapping::DISTORT, 4.0, 10.0);
+
+  BOOST_CHECK(undistortionGrid.isValid());
+  BOOST_CHECK(distortionGrid.isValid());
+
+  const double epsilon = 1e-2;
+  for(int i = 0; i < 1000; ++i)
+  {
+    const Vec2 pt = Vec2(500, 400) + Vec2::Random().cwiseProduct(Vec2(500, 400));
+
+    BOOST_CHECK(undistortionGrid.contains(pt));
+    EXPECT_MATRIX_NEAR(cam.get_ud_pixel(pt), undistortionGrid.get(pt), epsilon);
+    EXPECT_MATRIX_NEAR(cam.get_d_pixel(pt), distortionGrid.get(pt), epsilon);
+  }
+
+  // the measured error bounds the interpolation error
+  const double maxError = undistortionGrid.computeMaxError();
+  BOOST_CHECK_GT(maxError, 0.0);
+  BOOST_CHECK_LT(maxError, epsilon);
+  for(int i = 0; i < 1000; ++i)
+  {
+    const Vec2 pt = Vec2(500, 400) + Vec2::Random().cwiseProduct(Vec2(500, 400));
+    BOOST_CHECK_LE((cam.get_ud_pixel(pt) - undistortionGrid.get(pt)).norm(), maxError * 1.5);
+  }
+
+  // outside of the grid, the exact mapping is used
+  const Vec2 outside(-50.0, 900.0);
+  BOOST_CHECK(!undistortionGrid.contains(outside));
+  EXPECT_MATRIX_NEAR(cam.get_ud_pixel(outside), undistortionGrid.get(outside), 1e-12);
+
+  // batch query
+  Mat2X pts = Mat2X::Random(2, 100) * 400.0;
+  pts.colwise() += Vec2(500, 400);
+  Mat2X undistorted;
+  undistortionGrid.get(pts, undistorted);
+  for(Eigen::Index i = 0; i < pts.cols(); ++i)
+  {
+    EXPECT_MATRIX_NEAR(undistortionGrid.get(pts.col(i)), undistorted.col(i), 1e-12);
+  }
+}
@@ -0,0 +1,223 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "CpuCamera.hpp"
+
+#include <aliceVision/alicevision_omp.hpp>
+#include <aliceVision/system/Logger.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace aliceVision {
+namespace depthMap {
+
+namespace {
+
+/**
+ * @brief Linear RGB (0..1) to XYZ (0..1) using sRGB primaries
+ * @note Same as the device function rgb2xyz.
+ */
+inline Vec3f rgb2xyz(const Vec3f& c)
+{
+    return Vec3f(0.4124564f * c.x() + 0.3575761f * c.y() + 0.1804375f * c.z(),
+                 0.2126729f * c.x() + 0.7151522f * c.y() + 0.0721750f * c.z(),
+                 0.0193339f * c.x() + 0.1191920f * c.y() + 0.9503041f * c.z());
+}
+
+/**
+ * @brief XYZ (0..1) to CIELAB (0..255) assuming D65 whitepoint
+ * @note Same as the device function xyz2lab.
+ */
+inline Vec3f xyz2lab(const Vec3f& c)
+{
+    const Vec3f r(c.x() / 0.95047f, c.y(), c.z() / 1.08883f);
+
+    const auto f = [](float v) { return (v > 216.0f / 24389.0f) ? std::cbrt(v) : (24389.0f / 27.0f * v + 16.0f) / 116.0f; };
+    const Vec3f fr(f(r.x()), f(r.y()), f(r.z()));
+
+    // convert values to fit into 0..255 (could be out-of-range)
+    return Vec3f(116.0f * fr.y() - 16.0f, 500.0f * (fr.x() - fr.y()), 200.0f * (fr.y() - fr.z())) * 2.55f;
+}
+
+} // namespace
+
+void fillCpuCameraParameters(CpuCameraParams& out_cameraParams, int globalCamId, int downscale, const mvsUtils::MultiViewParams& mp)
+{
+    Matrix3x3 scaleM;
+    scaleM.m11 = 1.0 / float(downscale);
+    scaleM.m12 = 0.0;
+    scaleM.m13 = 0.0;
+    scaleM.m21 = 0.0;
+    scaleM.m22 = 1.0 / float(downscale);
+    scaleM.m23 = 0.0;
+    scaleM.m31 = 0.0;
+    scaleM.m32 = 0.0;
+    scaleM.m33 = 1.0;
+
+    const Matrix3x3 K = scaleM * mp.KArr[globalCamId];
+    const Matrix3x3 iK = K.inverse();
+    const Matrix3x4 P = K * (mp.RArr[globalCamId] | (Point3d(0.0, 0.0, 0.0) - mp.RArr[globalCamId] * mp.CArr[globalCamId]));
+    const Matrix3x3 iP = mp.iRArr[globalCamId] * iK;
+
+    const auto toEigen = [](const Matrix3x3& m)
+    {
+        Eigen::Matrix3f out;
+        out << m.m11, m.m12, m.m13,
+               m.m21, m.m22, m.m23,
+               m.m31, m.m32, m.m33;
+        return out;
+    };
+
+    out_cameraParams.P << P.m11, P.m12, P.m13, P.m14,
+                          P.m21, P.m22, P.m23, P.m24,
+                          P.m31, P.m32, P.m33, P.m34;
+    out_cameraParams.iP = toEigen(iP);
+    out_cameraParams.R = toEigen(mp.RArr[globalCamId]);
+    out_cameraParams.iR = toEigen(mp.iRArr[globalCamId]);
+    out_cameraParams.K = toEigen(K);
+    out_cameraParams.iK = toEigen(iK);
+
+    const Point3d& C = mp.CArr[globalCamId];
+    out_cameraParams.C = Vec3f(float(C.x), float(C.y), float(C.z));
+    out_cameraParams.XVect = (out_cameraParams.iR * Vec3f(1.f, 0.f, 0.f)).normalized();
+    out_cameraParams.YVect = (out_cameraParams.iR * Vec3f(0.f, 1.f, 0.f)).normalized();
+    out_cameraParams.ZVect = (out_cameraParams.iR * Vec3f(0.f, 0.f, 1.f)).normalized();
+}
+
+CpuCamera::CpuCamera(int globalCamId, int downscale, const mvsUtils::MultiViewParams& mp, ImagesCache& imageCache)
+    : CpuCamera(globalCamId, downscale, mp, *imageCache.getImg_sync(globalCamId))
+{}
+
+CpuCamera::CpuCamera(int globalCamId, int downscale, const mvsUtils::MultiViewParams& mp, const image::Image<image::RGBAfColor>& img)
+    : _globalCamId(globalCamId)
+    , _downscale(downscale)
+{
+    fillCpuCameraParameters(_params, globalCamId, downscale, mp);
+
+    const int originalWidth = img.Width();
+    const int originalHeight = img.Height();
+    const int width = originalWidth / downscale;
+    const int height = originalHeight / downscale;
+
+    // full size frame in range (0, 255)
+    image::Image<image::RGBAfColor> originalFrame(originalWidth, originalHeight);
+
+    #pragma omp parallel for
+    for(int y = 0; y < originalHeight; ++y)
+    {
+        for(int x = 0; x < originalWidth; ++x)
+        {
+            const image::RGBAfColor& floatRGBA = img(y, x);
+            originalFrame(y, x) = image::RGBAfColor(floatRGBA.r() * 255.0f, floatRGBA.g() * 255.0f, floatRGBA.b() * 255.0f, floatRGBA.a() * 255.0f);
+        }
+    }
+
+    if(downscale <= 1)
+    {
+        _frame.swap(originalFrame);
+    }
+    else
+    {
+        // downscale with gaussian blur, same filter as device downscaleWithGaussianBlur_kernel
+        const int gaussRadius = downscale;
+        std::vector<float> gaussian(2 * gaussRadius + 1);
+        for(int i = -gaussRadius; i <= gaussRadius; ++i)
+            gaussian[i + gaussRadius] = std::exp(-float(i * i) / 2.0f);
+
+        // bilinear fetch with clamped borders at pixel coordinates
+        const auto fetch = [&](float fx, float fy) -> Eigen::Vector4f
+        {
+            const float xf = std::floor(fx);
+            const float yf = std::floor(fy);
+            const float ax = fx - xf;
+            const float ay = fy - yf;
+            const int x0 = std::min(std::max(int(xf), 0), originalWidth - 1);
+            const int x1 = std::min(std::max(int(xf) + 1, 0), originalWidth - 1);
+            const int y0 = std::min(std::max(int(yf), 0), originalHeight - 1);
+            const int y1 = std::min(std::max(int(yf) + 1, 0), originalHeight - 1);
+            const Eigen::Vector4f top = originalFrame(y0, x0) * (1.f - ax) + originalFrame(y0, x1) * ax;
+            const Eigen::Vector4f bottom = originalFrame(y1, x0) * (1.f - ax) + originalFrame(y1, x1) * ax;
+            return top * (1.f - ay) + bottom * ay;
+        };
+
+        // texture offset (0.5) is already removed from the device sample position
+        const float s = float(downscale) * 0.5f - 0.5f;
+
+        _frame.resize(width, height);
+
+        #pragma omp parallel for
+        for(int y = 0; y < height; ++y)
+        {
+            for(int x = 0; x < width; ++x)
+            {
+                Eigen::Vector4f accPix = Eigen::Vector4f::Zero();
+                float sumFactor = 0.0f;
+
+                for(int i = -gaussRadius; i <= gaussRadius; ++i)
+                {
+                    for(int j = -gaussRadius; j <= gaussRadius; ++j)
+                    {
+                        const float factor = gaussian[i + gaussRadius] * gaussian[j + gaussRadius];
+                        accPix += fetch(float(x * downscale + j) + s, float(y * downscale + i) + s) * factor;
+                        sumFactor += factor;
+                    }
+                }
+
+                accPix /= sumFactor;
+                _frame(y, x) = image::RGBAfColor(accPix(0), accPix(1), accPix(2), accPix(3));
+            }
+        }
+    }
+
+    // in-place color conversion into CIELAB, alpha is kept in range (0, 255)
+    #pragma omp parallel for
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            image::RGBAfColor& rgba = _frame(y, x);
+            const Vec3f lab = xyz2lab(rgb2xyz(Vec3f(rgba.r(), rgba.g(), rgba.b()) / 255.f));
+            rgba.r() = lab.x();
+            rgba.g() = lab.y();
+            rgba.b() = lab.z();
+        }
+    }
+}
+
+CpuCameraCache::CpuCameraCache(const mvsUtils::MultiViewParams& mp, CpuCamera::ImagesCache& imageCache, int maxNbCameras)
+    : _mp(mp)
+    , _imageCache(imageCache)
+    , _maxNbCameras(maxNbCameras)
+{}
+
+std::shared_ptr<const CpuCamera> CpuCameraCache::requestCamera(int globalCamId, int downscale)
+{
+    const std::pair<int, int> key(globalCamId, downscale);
+
+    for(auto it = _cameras.begin(); it != _cameras.end(); ++it)
+    {
+        if(it->first == key)
+        {
+            // move to front (most recently used)
+            _cameras.splice(_cameras.begin(), _cameras, it);
+            return _cameras.front().second;
+        }
+    }
+
+    ALICEVISION_LOG_TRACE("Add camera on host cache (id: " << globalCamId << ", view id: " << _mp.getViewId(globalCamId) << ", downscale: " << downscale << ").");
+
+    auto camera = std::make_shared<const CpuCamera>(globalCamId, downscale, _mp, _imageCache);
+    _cameras.emplace_front(key, camera);
+
+    while(int(_cameras.size()) > _maxNbCameras)
+        _cameras.pop_back();
+
+    return camera;
+}
+
+} // namespace depthMap
+} // namespace aliceVision
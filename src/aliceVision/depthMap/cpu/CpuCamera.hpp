@@ -0,0 +1,167 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/numeric/numeric.hpp>
+#include <aliceVision/image/Image.hpp>
+#include <aliceVision/image/pixelTypes.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+#include <aliceVision/mvsUtils/ImagesCache.hpp>
+
+#include <cmath>
+#include <list>
+#include <memory>
+#include <utility>
+
+namespace aliceVision {
+namespace depthMap {
+
+/**
+ * @brief Camera parameters at a given downscale, in host memory.
+ *        CPU counterpart of DeviceCameraParams, all values are single precision.
+ */
+struct CpuCameraParams
+{
+    Eigen::Matrix<float, 3, 4> P;
+    Eigen::Matrix3f iP;
+    Eigen::Matrix3f R;
+    Eigen::Matrix3f iR;
+    Eigen::Matrix3f K;
+    Eigen::Matrix3f iK;
+    Vec3f C;
+    Vec3f XVect;
+    Vec3f YVect;
+    Vec3f ZVect;
+};
+
+/**
+ * @brief Fill the camera parameters of a camera at a given downscale.
+ * @param[out] out_cameraParams the camera parameters
+ * @param[in] globalCamId the camera index in the MultiViewParams
+ * @param[in] downscale the downscale to apply on the camera intrinsics
+ * @param[in] mp the multi-view parameters
+ */
+void fillCpuCameraParameters(CpuCameraParams& out_cameraParams, int globalCamId, int downscale, const mvsUtils::MultiViewParams& mp);
+
+/**
+ * @brief Camera parameters and downscaled CIELAB frame of a camera, in host memory.
+ *        CPU counterpart of DeviceCamera.
+ *
+ * Frame channels are (L, a, b, alpha), in range (0, 255) as in device textures.
+ */
+class CpuCamera
+{
+public:
+
+    using ImagesCache = mvsUtils::ImagesCache<image::Image<image::RGBAfColor>>;
+
+    /**
+     * @brief CpuCamera constructor, load and prepare the camera frame.
+     * @param[in] globalCamId the camera index in the MultiViewParams
+     * @param[in] downscale the frame downscale factor
+     * @param[in] mp the multi-view parameters
+     * @param[in] imageCache the image cache to get the full size frame from
+     */
+    CpuCamera(int globalCamId, int downscale, const mvsUtils::MultiViewParams& mp, ImagesCache& imageCache);
+
+    /**
+     * @brief CpuCamera constructor, prepare the camera frame from the given full size image.
+     * @param[in] globalCamId the camera index in the MultiViewParams
+     * @param[in] downscale the frame downscale factor
+     * @param[in] mp the multi-view parameters
+     * @param[in] img the full size linear RGBA image, in range (0, 1)
+     */
+    CpuCamera(int globalCamId, int downscale, const mvsUtils::MultiViewParams& mp, const image::Image<image::RGBAfColor>& img);
+
+    inline int getGlobalCamId() const { return _globalCamId; }
+    inline int getDownscale() const { return _downscale; }
+    inline int getWidth() const { return _frame.Width(); }
+    inline int getHeight() const { return _frame.Height(); }
+    inline const CpuCameraParams& getParams() const { return _params; }
+    inline const image::Image<image::RGBAfColor>& getFrame() const { return _frame; }
+
+    /**
+     * @brief Sample the frame with bilinear interpolation and clamped borders.
+     * @note Equivalent to a device texture fetch at (x + 0.5, y + 0.5).
+     * @param[in] x the pixel x coordinate
+     * @param[in] y the pixel y coordinate
+     * @return the interpolated (L, a, b, alpha) value
+     */
+    inline Eigen::Vector4f sample(float x, float y) const
+    {
+        const int w = _frame.Width();
+        const int h = _frame.Height();
+
+        const float xf = std::floor(x);
+        const float yf = std::floor(y);
+        const float ax = x - xf;
+        const float ay = y - yf;
+
+        const int x0 = clampIndex(int(xf), w);
+        const int x1 = clampIndex(int(xf) + 1, w);
+        const int y0 = clampIndex(int(yf), h);
+        const int y1 = clampIndex(int(yf) + 1, h);
+
+        const Eigen::Vector4f& c00 = _frame(y0, x0);
+        const Eigen::Vector4f& c01 = _frame(y0, x1);
+        const Eigen::Vector4f& c10 = _frame(y1, x0);
+        const Eigen::Vector4f& c11 = _frame(y1, x1);
+
+        const Eigen::Vector4f top = c00 + (c01 - c00) * ax;
+        const Eigen::Vector4f bottom = c10 + (c11 - c10) * ax;
+        return top + (bottom - top) * ay;
+    }
+
+private:
+
+    static inline int clampIndex(int i, int size) { return (i < 0) ? 0 : ((i >= size) ? (size - 1) : i); }
+
+    int _globalCamId;
+    int _downscale;
+    CpuCameraParams _params;
+    image::Image<image::RGBAfColor> _frame;
+};
+
+/**
+ * @brief Small LRU cache of CpuCamera, keyed by camera index and downscale.
+ * @note Not thread-safe, cameras should be requested outside of parallel regions.
+ */
+class CpuCameraCache
+{
+public:
+
+    /**
+     * @brief CpuCameraCache constructor
+     * @param[in] mp the multi-view parameters
+     * @param[in] imageCache the image cache to get the full size frames from
+     * @param[in] maxNbCameras the maximum number of cameras in the cache
+     */
+    CpuCameraCache(const mvsUtils::MultiViewParams& mp, CpuCamera::ImagesCache& imageCache, int maxNbCameras);
+
+    /**
+     * @brief Get a camera from the cache, load it if needed.
+     * @param[in] globalCamId the camera index in the MultiViewParams
+     * @param[in] downscale the frame downscale factor
+     * @return the camera
+     */
+    std::shared_ptr<const CpuCamera> requestCamera(int globalCamId, int downscale);
+
+    /// Remove all cameras from the cache
+    void clear() { _cameras.clear(); }
+
+private:
+
+    const mvsUtils::MultiViewParams& _mp;
+    CpuCamera::ImagesCache& _imageCache;
+    const int _maxNbCameras;
+
+    /// cached cameras, most recently used first
+    std::list<std::pair<std::pair<int, int>, std::shared_ptr<const CpuCamera>>> _cameras;
+};
+
+} // namespace depthMap
+} // namespace aliceVision
@@ -0,0 +1,53 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/image/Image.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+/**
+ * @brief Depth/similarity map in host memory.
+ *
+ * The two channels are stored in separate images so that they can be
+ * directly written on disk (see mvsUtils::writeDepthSimMap).
+ * Depending on the computation step, the second channel can also contain the pixel size.
+ */
+struct CpuDepthSimMap
+{
+    image::Image<float> depthMap; //< depth channel
+    image::Image<float> simMap;   //< similarity or pixSize channel
+
+    inline int width() const { return depthMap.Width(); }
+    inline int height() const { return depthMap.Height(); }
+
+    /**
+     * @brief Resize the depth/similarity map.
+     * @param[in] width the new width
+     * @param[in] height the new height
+     */
+    void resize(int width, int height)
+    {
+        depthMap.resize(width, height);
+        simMap.resize(width, height);
+    }
+
+    /**
+     * @brief Set all the depth/similarity map values.
+     * @param[in] depth the depth value
+     * @param[in] sim the similarity value
+     */
+    void fill(float depth, float sim)
+    {
+        depthMap.fill(depth);
+        simMap.fill(sim);
+    }
+};
+
+} // namespace depthMap
+} // namespace aliceVision
@@ -0,0 +1,278 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace aliceVision {
+namespace depthMap {
+
+/*
+ * Host versions of the device geometry functions (see cuda/device/Patch.cuh and cuda/device/matrix.cuh).
+ * Computations are done in single precision, as on the device.
+ */
+
+/**
+ * @brief Patch in host memory
+ */
+struct CpuPatch
+{
+    Vec3f p; //< 3d point
+    Vec3f n; //< normal
+    Vec3f x; //< x axis
+    Vec3f y; //< y axis
+    float d; //< pixel size
+};
+
+/**
+ * f(x) = min + (max-min) * \frac{1}{1 + e^{10 * (x - mid) / width}}
+ */
+inline float cpu_sigmoid(float zeroVal, float endVal, float sigwidth, float sigMid, float xval)
+{
+    return zeroVal + (endVal - zeroVal) * (1.0f / (1.0f + std::exp(10.0f * ((xval - sigMid) / sigwidth))));
+}
+
+/**
+ * f(x) = min + (max-min) * \frac{1}{1 + e^{10 * (mid - x) / width}}
+ */
+inline float cpu_sigmoid2(float zeroVal, float endVal, float sigwidth, float sigMid, float xval)
+{
+    return zeroVal + (endVal - zeroVal) * (1.0f / (1.0f + std::exp(10.0f * ((sigMid - xval) / sigwidth))));
+}
+
+inline Vec2f cpu_project3DPoint(const CpuCameraParams& cam, const Vec3f& p)
+{
+    const Vec3f h = cam.P.leftCols<3>() * p + cam.P.col(3);
+    return Vec2f(h.x() / h.z(), h.y() / h.z());
+}
+
+inline Vec3f cpu_pixelRay(const CpuCameraParams& cam, const Vec2f& pix)
+{
+    return (cam.iP * Vec3f(pix.x(), pix.y(), 1.0f)).normalized();
+}
+
+inline Vec3f cpu_linePlaneIntersect(const Vec3f& linePoint, const Vec3f& lineVect, const Vec3f& planePoint, const Vec3f& planeNormal)
+{
+    const float k = (planePoint.dot(planeNormal) - planeNormal.dot(linePoint)) / planeNormal.dot(lineVect);
+    return linePoint + lineVect * k;
+}
+
+inline Vec3f cpu_closestPointToLine3D(const Vec3f& point, const Vec3f& linePoint, const Vec3f& lineVectNormalized)
+{
+    return linePoint + lineVectNormalized * lineVectNormalized.dot(point - linePoint);
+}
+
+inline float cpu_pointLineDistance3D(const Vec3f& point, const Vec3f& linePoint, const Vec3f& lineVectNormalized)
+{
+    return lineVectNormalized.cross(linePoint - point).norm();
+}
+
+/**
+ * @return the angle (in degrees) between AB and AC
+ */
+inline float cpu_angleBetwABandAC(const Vec3f& A, const Vec3f& B, const Vec3f& C)
+{
+    const Vec3f V1 = (B - A).normalized();
+    const Vec3f V2 = (C - A).normalized();
+    double a = std::acos(double(V1.dot(V2)));
+    a = std::isinf(a) ? 0.0 : a;
+    return float(std::fabs(a) / (M_PI / 180.0));
+}
+
+inline Vec3f cpu_get3DPointForPixelAndFrontoParellePlaneRC(const CpuCameraParams& cam, const Vec2f& pix, float fpPlaneDepth)
+{
+    const Vec3f planep = cam.C + cam.ZVect * fpPlaneDepth;
+    return cpu_linePlaneIntersect(cam.C, cpu_pixelRay(cam, pix), planep, cam.ZVect);
+}
+
+inline Vec3f cpu_get3DPointForPixelAndDepthFromRC(const CpuCameraParams& cam, const Vec2f& pix, float depth)
+{
+    return cam.C + cpu_pixelRay(cam, pix) * depth;
+}
+
+inline float cpu_computePixSize(const CpuCameraParams& cam, const Vec3f& p)
+{
+    const Vec2f rp1 = cpu_project3DPoint(cam, p) + Vec2f(1.0f, 0.0f);
+    return cpu_pointLineDistance3D(p, cam.C, cpu_pixelRay(cam, rp1));
+}
+
+inline float cpu_depthPlaneToDepth(const CpuCameraParams& cam, const Vec2f& pix, float fpPlaneDepth)
+{
+    const Vec3f planep = cam.C + cam.ZVect * fpPlaneDepth;
+    const Vec3f p = cpu_linePlaneIntersect(cam.C, cpu_pixelRay(cam, pix), planep, cam.ZVect);
+    return (cam.C - p).norm();
+}
+
+/**
+ * @brief Compute the patch axes from the epipolar plane of the patch point.
+ * @note The patch normal is the bisector of the R and T viewing directions.
+ */
+inline void cpu_computeRotCSEpip(const CpuCameraParams& rcCam, const CpuCameraParams& tcCam, CpuPatch& ptch)
+{
+    const Vec3f v1 = (rcCam.C - ptch.p).normalized();
+    const Vec3f v2 = (tcCam.C - ptch.p).normalized();
+
+    ptch.y = v1.cross(v2).normalized();
+    ptch.n = ((v1 + v2) / 2.0f).normalized();
+    ptch.x = ptch.y.cross(ptch.n).normalized();
+}
+
+/**
+ * @brief Per-thread buffers of the patch samples for the vectorized similarity computation.
+ *
+ * Samples are stored as structure of arrays so that the weighting and the reduction
+ * of the Normalized Cross-Correlation statistics are SIMD loops.
+ */
+struct CpuSimilarityBuffer
+{
+    /**
+     * @param[in] in_wsh the half-width of the patch
+     * @param[in] gammaP the strength of grouping by proximity
+     */
+    CpuSimilarityBuffer(int in_wsh, float gammaP)
+        : wsh(in_wsh)
+    {
+        const int patchWidth = 2 * wsh + 1;
+        const int nbSamples = patchWidth * patchWidth;
+
+        proximity.resize(nbSamples);
+        rcL.resize(nbSamples);
+        tcL.resize(nbSamples);
+        deltaC.resize(nbSamples);
+
+        // spatial distance to the center of the patch, same for the R and T patches
+        int i = 0;
+        for(int yp = -wsh; yp <= wsh; ++yp)
+            for(int xp = -wsh; xp <= wsh; ++xp, ++i)
+                proximity[i] = 2.0f * std::sqrt(float(xp * xp + yp * yp)) / gammaP;
+    }
+
+    int wsh;                      //< patch half-width
+    std::vector<float> proximity; //< R and T spatial distances to the patch center, divided by gammaP
+    std::vector<float> rcL;       //< R patch luminance
+    std::vector<float> tcL;       //< T patch luminance
+    std::vector<float> deltaC;    //< sum of the R and T color distances to the patch center
+};
+
+/**
+ * @brief Compute the weighted Normalized Cross-Correlation of a patch between two cameras.
+ *
+ * Same similarity as the device function compNCCby3DptsYK (adaptive support-weight, Yoon & Kweon).
+ * Patch sample projections are computed incrementally in homogeneous coordinates
+ * and the weighted statistics are accumulated in a vectorized reduction.
+ *
+ * @param[in] rcCam the R camera
+ * @param[in] tcCam the T camera
+ * @param[in] ptch the patch
+ * @param[in] gammaC the strength of grouping by color similarity
+ * @param[in,out] buffer the thread buffer, initialized with the patch half-width and gammaP
+ * @return similarity value in range (-1, 0) or 1 if not defined,
+ *         or invalid similarity (infinity) if uninitialized or masked
+ */
+inline float cpu_compNCCby3DptsYK(const CpuCamera& rcCam,
+                                  const CpuCamera& tcCam,
+                                  const CpuPatch& ptch,
+                                  float gammaC,
+                                  CpuSimilarityBuffer& buffer)
+{
+    const CpuCameraParams& rcParams = rcCam.getParams();
+    const CpuCameraParams& tcParams = tcCam.getParams();
+    const int wsh = buffer.wsh;
+
+    // patch center in homogeneous image coordinates, and steps along the patch axes
+    const Vec3f rh = rcParams.P.leftCols<3>() * ptch.p + rcParams.P.col(3);
+    const Vec3f th = tcParams.P.leftCols<3>() * ptch.p + tcParams.P.col(3);
+    const Vec3f rhx = rcParams.P.leftCols<3>() * (ptch.x * ptch.d);
+    const Vec3f rhy = rcParams.P.leftCols<3>() * (ptch.y * ptch.d);
+    const Vec3f thx = tcParams.P.leftCols<3>() * (ptch.x * ptch.d);
+    const Vec3f thy = tcParams.P.leftCols<3>() * (ptch.y * ptch.d);
+
+    const Vec2f rp(rh.x() / rh.z(), rh.y() / rh.z());
+    const Vec2f tp(th.x() / th.z(), th.y() / th.z());
+
+    const float dd = wsh + 2.0f;
+    if((rp.x() < dd) || (rp.x() > float(rcCam.getWidth() - 1) - dd) || (rp.y() < dd) || (rp.y() > float(rcCam.getHeight() - 1) - dd) ||
+       (tp.x() < dd) || (tp.x() > float(tcCam.getWidth() - 1) - dd) || (tp.y() < dd) || (tp.y() > float(tcCam.getHeight() - 1) - dd))
+    {
+        return std::numeric_limits<float>::infinity(); // uninitialized
+    }
+
+    const Eigen::Vector4f gcr = rcCam.sample(rp.x(), rp.y());
+    const Eigen::Vector4f gct = tcCam.sample(tp.x(), tp.y());
+
+    if(gcr.w() < 0.9f || gct.w() < 0.4f)
+    {
+        return std::numeric_limits<float>::infinity(); // uninitialized
+    }
+
+    // gather the patch samples
+    int i = 0;
+    for(int yp = -wsh; yp <= wsh; ++yp)
+    {
+        const Vec3f rhy_ = rh + rhy * float(yp);
+        const Vec3f thy_ = th + thy * float(yp);
+
+        for(int xp = -wsh; xp <= wsh; ++xp, ++i)
+        {
+            const Vec3f rhp = rhy_ + rhx * float(xp);
+            const Vec3f thp = thy_ + thx * float(xp);
+
+            const Eigen::Vector4f gcr1 = rcCam.sample(rhp.x() / rhp.z(), rhp.y() / rhp.z());
+            const Eigen::Vector4f gct1 = tcCam.sample(thp.x() / thp.z(), thp.y() / thp.z());
+
+            buffer.rcL[i] = gcr1.x();
+            buffer.tcL[i] = gct1.x();
+            buffer.deltaC[i] = (gcr.head<3>() - gcr1.head<3>()).norm() + (gct.head<3>() - gct1.head<3>()).norm();
+        }
+    }
+
+    // weighted statistics
+    const float* proximity = buffer.proximity.data();
+    const float* rcL = buffer.rcL.data();
+    const float* tcL = buffer.tcL.data();
+    const float* deltaC = buffer.deltaC.data();
+    const float invGammaC = 1.0f / gammaC;
+    const int nbSamples = int(buffer.proximity.size());
+
+    float wsum = 0.0f;
+    float xsum = 0.0f;
+    float ysum = 0.0f;
+    float xxsum = 0.0f;
+    float yysum = 0.0f;
+    float xysum = 0.0f;
+
+    #pragma omp simd reduction(+:wsum, xsum, ysum, xxsum, yysum, xysum)
+    for(int s = 0; s < nbSamples; ++s)
+    {
+        // product of the R and T support weights
+        const float w = std::exp(-(deltaC[s] * invGammaC + proximity[s]));
+        const float wx = w * rcL[s];
+        const float wy = w * tcL[s];
+
+        wsum += w;
+        xsum += wx;
+        ysum += wy;
+        xxsum += wx * rcL[s];
+        yysum += wy * tcL[s];
+        xysum += wx * tcL[s];
+    }
+
+    // see simStat::computeWSim
+    const float varianceXW = (xxsum - xsum * xsum / wsum) / wsum;
+    const float varianceYW = (yysum - ysum * ysum / wsum) / wsum;
+    const float varianceXYW = (xysum - xsum * ysum / wsum) / wsum;
+    const float rawSim = varianceXYW / std::sqrt(varianceXW * varianceYW);
+
+    return std::isfinite(rawSim) ? -rawSim : 1.0f;
+}
+
+} // namespace depthMap
+} // namespace aliceVision
@@ -0,0 +1,182 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "CpuRefine.hpp"
+
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/mvsUtils/depthSimMapIO.hpp>
+#include <aliceVision/depthMap/cpu/cpuDepthSimilarityMap.hpp>
+#include <aliceVision/depthMap/cpu/cpuSimilarityVolume.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+CpuRefine::CpuRefine(const mvsUtils::MultiViewParams& mp,
+                     const mvsUtils::TileParams& tileParams,
+                     const RefineParams& refineParams,
+                     CpuCameraCache& cameraCache)
+    : _mp(mp)
+    , _tileParams(tileParams)
+    , _refineParams(refineParams)
+    , _cameraCache(cameraCache)
+{
+    if(_refineParams.exportIntermediateCrossVolumes ||
+       _refineParams.exportIntermediateVolume9pCsv)
+    {
+        ALICEVISION_LOG_WARNING("Refine intermediate volumes export is not available with the CPU backend.");
+    }
+}
+
+double CpuRefine::getMemoryConsumption() const
+{
+    size_t bytes = 0;
+
+    bytes += 2 * _sgmDepthPixSizeMap.depthMap.size() * sizeof(float);
+    bytes += 2 * _refinedDepthSimMap.depthMap.size() * sizeof(float);
+    bytes += 2 * _optimizedDepthSimMap.depthMap.size() * sizeof(float);
+    bytes += _volumeRefineSim.memorySize();
+
+    return (double(bytes) / (1024.0 * 1024.0));
+}
+
+void CpuRefine::refineRc(const Tile& tile, const CpuDepthSimMap& in_sgmDepthSimMap)
+{
+    const IndexT viewId = _mp.getViewId(tile.rc);
+
+    ALICEVISION_LOG_INFO(tile << "Refine depth/sim map of view id: " << viewId << ", rc: " << tile.rc << " (" << (tile.rc + 1) << " / " << _mp.ncams << ").");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _refineParams.scale * _refineParams.stepXY);
+
+    // allocate the tile depth/sim maps in host memory
+    _sgmDepthPixSizeMap.resize(int(downscaledRoi.width()), int(downscaledRoi.height()));
+    _refinedDepthSimMap.resize(int(downscaledRoi.width()), int(downscaledRoi.height()));
+
+    // compute upscaled SGM depth/pixSize map
+    {
+        // get R camera from cache
+        const std::shared_ptr<const CpuCamera> rcCamera = _cameraCache.requestCamera(tile.rc, _refineParams.scale);
+
+        // upscale SGM depth/sim map and filter masked pixels (alpha)
+        cpu_depthSimMapUpscaleAndFilter(_sgmDepthPixSizeMap, in_sgmDepthSimMap, *rcCamera, _refineParams, downscaledRoi);
+
+        // export intermediate depth/sim map (if requested by user)
+        if(_refineParams.exportIntermediateDepthSimMaps)
+          mvsUtils::writeDepthSimMap(tile.rc, _mp, _tileParams, tile.roi, _sgmDepthPixSizeMap.depthMap, _sgmDepthPixSizeMap.simMap, _refineParams.scale, _refineParams.stepXY, "_sgmUpscaled");
+
+        // compute pixSize to replace similarity (this is usefull for depth/sim map optimization)
+        cpu_depthSimMapComputePixSize(_sgmDepthPixSizeMap, *rcCamera, _refineParams, downscaledRoi);
+    }
+
+    // refine and fuse depth/sim map
+    if(_refineParams.useRefineFuse)
+    {
+        // refine and fuse with volume strategy
+        refineAndFuseDepthSimMap(tile);
+    }
+    else
+    {
+        ALICEVISION_LOG_INFO(tile << "Refine and fuse depth/sim map volume disabled.");
+        cpu_depthSimMapCopyDepthOnly(_refinedDepthSimMap, _sgmDepthPixSizeMap, 1.0f);
+    }
+
+    // export intermediate depth/sim map (if requested by user)
+    if(_refineParams.exportIntermediateDepthSimMaps)
+      mvsUtils::writeDepthSimMap(tile.rc, _mp, _tileParams, tile.roi, _refinedDepthSimMap.depthMap, _refinedDepthSimMap.simMap, _refineParams.scale, _refineParams.stepXY, "_refinedFused");
+
+    // optimize depth/sim map
+    if(_refineParams.useColorOptimization && _refineParams.optimizationNbIterations > 0)
+    {
+        optimizeDepthSimMap(tile);
+    }
+    else
+    {
+        ALICEVISION_LOG_INFO(tile << "Color optimize depth/sim map disabled.");
+        _optimizedDepthSimMap = _refinedDepthSimMap;
+    }
+
+    ALICEVISION_LOG_INFO(tile << "Refine depth/sim map done.");
+}
+
+void CpuRefine::refineAndFuseDepthSimMap(const Tile& tile)
+{
+    ALICEVISION_LOG_INFO(tile << "Refine and fuse depth/sim map volume.");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _refineParams.scale * _refineParams.stepXY);
+
+    // allocate the refine volume in host memory
+    const int nbDepthsToRefine = _refineParams.halfNbDepths * 2 + 1;
+    _volumeRefineSim.resize(int(downscaledRoi.width()), int(downscaledRoi.height()), nbDepthsToRefine);
+
+    // get the depth range
+    const Range depthRange(0, nbDepthsToRefine);
+
+    // initialize the similarity volume at 0
+    // each tc filtered and inverted similarity value will be summed in this volume
+    _volumeRefineSim.fill(TSimRefineCpu(0.f));
+
+    // get R camera from cache
+    const std::shared_ptr<const CpuCamera> rcCamera = _cameraCache.requestCamera(tile.rc, _refineParams.scale);
+
+    // compute for each RcTc each similarity value for each depth to refine
+    // sum the inverted / filtered similarity value, best value is the HIGHEST
+    for(std::size_t tci = 0; tci < tile.refineTCams.size(); ++tci)
+    {
+        const int tc = tile.refineTCams.at(tci);
+
+        // get T camera from cache
+        const std::shared_ptr<const CpuCamera> tcCamera = _cameraCache.requestCamera(tc, _refineParams.scale);
+
+        ALICEVISION_LOG_DEBUG(tile << "Refine similarity volume:" << std::endl
+                                   << "\t- rc: " << tile.rc << std::endl
+                                   << "\t- tc: " << tc << " (" << (tci + 1) << "/" << tile.refineTCams.size() << ")" << std::endl
+                                   << "\t- tile range x: [" << downscaledRoi.x.begin << " - " << downscaledRoi.x.end << "]" << std::endl
+                                   << "\t- tile range y: [" << downscaledRoi.y.begin << " - " << downscaledRoi.y.end << "]" << std::endl);
+
+        cpu_volumeRefineSimilarity(_volumeRefineSim,
+                                   _sgmDepthPixSizeMap,
+                                   *rcCamera,
+                                   *tcCamera,
+                                   _refineParams,
+                                   depthRange,
+                                   downscaledRoi);
+    }
+
+    // retrieve the best depth/sim in the volume
+    // compute sub-pixel sample using a sliding gaussian
+    cpu_volumeRefineBestDepth(_refinedDepthSimMap,
+                              _sgmDepthPixSizeMap,
+                              _volumeRefineSim,
+                              *rcCamera,
+                              _refineParams,
+                              downscaledRoi);
+
+    ALICEVISION_LOG_INFO(tile << "Refine and fuse depth/sim map volume done.");
+}
+
+void CpuRefine::optimizeDepthSimMap(const Tile& tile)
+{
+    ALICEVISION_LOG_INFO(tile << "Color optimize depth/sim map.");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _refineParams.scale * _refineParams.stepXY);
+
+    // get R camera from cache
+    const std::shared_ptr<const CpuCamera> rcCamera = _cameraCache.requestCamera(tile.rc, _refineParams.scale);
+
+    cpu_depthSimMapOptimizeGradientDescent(_optimizedDepthSimMap, // output depth/sim map optimized
+                                           _sgmDepthPixSizeMap,   // input SGM upscaled depth/pixSize map
+                                           _refinedDepthSimMap,   // input refined and fused depth/sim map
+                                           *rcCamera,
+                                           _refineParams,
+                                           downscaledRoi);
+
+    ALICEVISION_LOG_INFO(tile << "Color optimize depth/sim map done.");
+}
+
+} // namespace depthMap
+} // namespace aliceVision
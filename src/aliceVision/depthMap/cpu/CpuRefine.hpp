@@ -0,0 +1,95 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/mvsData/ROI.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+#include <aliceVision/mvsUtils/TileParams.hpp>
+#include <aliceVision/depthMap/Tile.hpp>
+#include <aliceVision/depthMap/RefineParams.hpp>
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+#include <aliceVision/depthMap/cpu/CpuDepthSimMap.hpp>
+#include <aliceVision/depthMap/cpu/CpuVolume.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+/**
+ * @brief Depth Map Estimation Refine on CPU
+ * @note Same computation as Refine, without GPU.
+ */
+class CpuRefine
+{
+public:
+
+    /**
+     * @brief CpuRefine constructor.
+     * @param[in] mp the multi-view parameters
+     * @param[in] tileParams tile workflow parameters
+     * @param[in] refineParams the Refine parameters
+     * @param[in] cameraCache the host camera cache
+     */
+    CpuRefine(const mvsUtils::MultiViewParams& mp,
+              const mvsUtils::TileParams& tileParams,
+              const RefineParams& refineParams,
+              CpuCameraCache& cameraCache);
+
+    // no default constructor
+    CpuRefine() = delete;
+
+    // default destructor
+    ~CpuRefine() = default;
+
+    // final depth/similarity map getter
+    inline const CpuDepthSimMap& getDepthSimMap() const { return _optimizedDepthSimMap; }
+
+    /**
+     * @brief Get memory consumption in host memory.
+     * @return host memory consumption (in MB)
+     */
+    double getMemoryConsumption() const;
+
+    /**
+     * @brief Refine for a single R camera the Semi-Global Matching depth/sim map.
+     * @param[in] tile The given tile for Refine computation
+     * @param[in] in_sgmDepthSimMap the SGM result depth/sim map
+     */
+    void refineRc(const Tile& tile, const CpuDepthSimMap& in_sgmDepthSimMap);
+
+private:
+
+    // private methods
+
+    /**
+     * @brief Refine and fuse the given depth/sim map using volume strategy.
+     * @param[in] tile The given tile for Refine computation
+     */
+    void refineAndFuseDepthSimMap(const Tile& tile);
+
+    /**
+     * @brief Optimize the refined depth/sim maps.
+     * @param[in] tile The given tile for Refine computation
+     */
+    void optimizeDepthSimMap(const Tile& tile);
+
+    // private members
+
+    const mvsUtils::MultiViewParams& _mp;          //< Multi-view parameters
+    const mvsUtils::TileParams& _tileParams;       //< tile workflow parameters
+    const RefineParams& _refineParams;             //< Refine parameters
+    CpuCameraCache& _cameraCache;                  //< host camera cache
+
+    // private members in host memory
+
+    CpuDepthSimMap _sgmDepthPixSizeMap;            //< rc upscaled SGM depth/pixSize map
+    CpuDepthSimMap _refinedDepthSimMap;            //< rc refined and fused depth/sim map
+    CpuDepthSimMap _optimizedDepthSimMap;          //< rc optimized depth/sim map
+    CpuVolume<TSimRefineCpu> _volumeRefineSim;     //< rc refine similarity volume
+};
+
+} // namespace depthMap
+} // namespace aliceVision
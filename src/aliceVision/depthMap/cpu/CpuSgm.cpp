@@ -0,0 +1,199 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "CpuSgm.hpp"
+
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/mvsUtils/depthSimMapIO.hpp>
+#include <aliceVision/depthMap/cpu/cpuSimilarityVolume.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+CpuSgm::CpuSgm(const mvsUtils::MultiViewParams& mp,
+               const mvsUtils::TileParams& tileParams,
+               const SgmParams& sgmParams,
+               CpuCameraCache& cameraCache)
+    : _mp(mp)
+    , _tileParams(tileParams)
+    , _sgmParams(sgmParams)
+    , _cameraCache(cameraCache)
+{
+    if(_sgmParams.exportIntermediateVolumes ||
+       _sgmParams.exportIntermediateCrossVolumes ||
+       _sgmParams.exportIntermediateVolume9pCsv)
+    {
+        ALICEVISION_LOG_WARNING("SGM intermediate volumes export is not available with the CPU backend.");
+    }
+}
+
+double CpuSgm::getMemoryConsumption() const
+{
+    size_t bytes = 0;
+
+    bytes += _volumeBestSim.memorySize();
+    bytes += _volumeSecBestSim.memorySize();
+    bytes += 2 * _depthSimMap.depthMap.size() * sizeof(float);
+
+    return (double(bytes) / (1024.0 * 1024.0));
+}
+
+void CpuSgm::sgmRc(const Tile& tile, const SgmDepthList& tileDepthList)
+{
+    const IndexT viewId = _mp.getViewId(tile.rc);
+
+    ALICEVISION_LOG_INFO(tile << "SGM depth/sim map of view id: " << viewId << ", rc: " << tile.rc << " (" << (tile.rc + 1) << " / " << _mp.ncams << ").");
+
+    // check SGM depth list and T cameras
+    if(tile.sgmTCams.empty() || tileDepthList.getDepths().empty())
+        ALICEVISION_THROW_ERROR(tile << "Cannot compute Semi-Global Matching, no depths or no T cameras (viewId: " << viewId << ").");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _sgmParams.scale * _sgmParams.stepXY);
+
+    // allocate the tile depth/sim map and similarity volumes in host memory
+    {
+        const int width = int(downscaledRoi.width());
+        const int height = int(downscaledRoi.height());
+        const int nbDepths = int(tileDepthList.getDepths().size());
+
+        _depthSimMap.resize(width, height);
+        _volumeBestSim.resize(width, height, nbDepths);
+        _volumeSecBestSim.resize(width, height, nbDepths);
+    }
+
+    // compute best sim and second best sim volumes
+    computeSimilarityVolumes(tile, tileDepthList);
+
+    // this is here for experimental purposes
+    // to show how SGGC work on non optimized depthmaps
+    // it must equals to true in normal case
+    if(_sgmParams.doSgmOptimizeVolume)
+    {
+        optimizeSimilarityVolume(tile);
+    }
+    else
+    {
+        // best sim volume is normally reuse to put optimized similarity
+        _volumeBestSim = _volumeSecBestSim;
+    }
+
+    // retrieve best depth
+    retrieveBestDepth(tile, tileDepthList);
+
+    // export intermediate depth/sim map (if requested by user)
+    if(_sgmParams.exportIntermediateDepthSimMaps)
+    {
+        mvsUtils::writeDepthSimMap(tile.rc, _mp, _tileParams, tile.roi, _depthSimMap.depthMap, _depthSimMap.simMap, _sgmParams.scale, _sgmParams.stepXY, "_sgm");
+    }
+
+    ALICEVISION_LOG_INFO(tile << "SGM depth/sim map done.");
+}
+
+void CpuSgm::computeSimilarityVolumes(const Tile& tile, const SgmDepthList& tileDepthList)
+{
+    ALICEVISION_LOG_INFO(tile << "SGM Compute similarity volume.");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _sgmParams.scale * _sgmParams.stepXY);
+
+    // initialize the two similarity volumes at 255
+    _volumeBestSim.fill(255);
+    _volumeSecBestSim.fill(255);
+
+    // get R camera from cache
+    const std::shared_ptr<const CpuCamera> rcCamera = _cameraCache.requestCamera(tile.rc, _sgmParams.scale);
+
+    // compute similarity volume per Rc Tc
+    for(std::size_t tci = 0; tci < tile.sgmTCams.size(); ++tci)
+    {
+        const int tc = tile.sgmTCams.at(tci);
+
+        const int firstDepth = tileDepthList.getDepthsTcLimits()[tci].x;
+        const int lastDepth  = firstDepth + tileDepthList.getDepthsTcLimits()[tci].y;
+
+        const Range tcDepthRange(firstDepth, lastDepth);
+
+        // get T camera from cache
+        const std::shared_ptr<const CpuCamera> tcCamera = _cameraCache.requestCamera(tc, _sgmParams.scale);
+
+        ALICEVISION_LOG_DEBUG(tile << "Compute similarity volume:" << std::endl
+                                   << "\t- rc: " << tile.rc << std::endl
+                                   << "\t- tc: " << tc << " (" << (tci + 1) << "/" << tile.sgmTCams.size() << ")" << std::endl
+                                   << "\t- tc first depth: " << firstDepth << std::endl
+                                   << "\t- tc last depth: " << lastDepth << std::endl
+                                   << "\t- tile range x: [" << downscaledRoi.x.begin << " - " << downscaledRoi.x.end << "]" << std::endl
+                                   << "\t- tile range y: [" << downscaledRoi.y.begin << " - " << downscaledRoi.y.end << "]" << std::endl);
+
+        cpu_volumeComputeSimilarity(_volumeBestSim,
+                                    _volumeSecBestSim,
+                                    tileDepthList.getDepths(),
+                                    *rcCamera,
+                                    *tcCamera,
+                                    _sgmParams,
+                                    tcDepthRange,
+                                    downscaledRoi);
+    }
+
+    // update second best uninitialized similarity volume values with first best similarity volume values
+    // - allows to avoid the particular case with a single tc (second best volume has no valid similarity values)
+    // - usefull if a tc alone contributes to the calculation of a subpart of the similarity volume
+    if(_sgmParams.updateUninitializedSim) // should always be true, false for debug purposes
+    {
+        ALICEVISION_LOG_DEBUG(tile << "SGM Update uninitialized similarity volume values from best similarity volume.");
+
+        cpu_volumeUpdateUninitializedSimilarity(_volumeBestSim, _volumeSecBestSim);
+    }
+
+    ALICEVISION_LOG_INFO(tile << "SGM Compute similarity volume done.");
+}
+
+void CpuSgm::optimizeSimilarityVolume(const Tile& tile)
+{
+    ALICEVISION_LOG_INFO(tile << "SGM Optimizing volume (filtering axes: " << _sgmParams.filteringAxes << ").");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _sgmParams.scale * _sgmParams.stepXY);
+
+    // get R camera from cache
+    const std::shared_ptr<const CpuCamera> rcCamera = _cameraCache.requestCamera(tile.rc, _sgmParams.scale);
+
+    cpu_volumeOptimize(_volumeBestSim,    // output volume (reuse best sim to put optimized similarity)
+                       _volumeSecBestSim, // input volume
+                       *rcCamera,
+                       _sgmParams,
+                       downscaledRoi);
+
+    ALICEVISION_LOG_INFO(tile << "SGM Optimizing volume done.");
+}
+
+void CpuSgm::retrieveBestDepth(const Tile& tile, const SgmDepthList& tileDepthList)
+{
+    ALICEVISION_LOG_INFO(tile << "SGM Retrieve best depth in volume.");
+
+    // downscale the region of interest
+    const ROI downscaledRoi = downscaleROI(tile.roi, _sgmParams.scale * _sgmParams.stepXY);
+
+    // get depth range
+    const Range depthRange(0, tileDepthList.getDepths().size());
+
+    // get R camera parameters at full resolution, the frame is not needed
+    CpuCameraParams rcCameraParams;
+    fillCpuCameraParameters(rcCameraParams, tile.rc, 1, _mp);
+
+    cpu_volumeRetrieveBestDepth(_depthSimMap,             // output depth/sim map
+                                tileDepthList.getDepths(), // rc depth
+                                _volumeBestSim,            // second best sim volume optimized in best sim volume
+                                rcCameraParams,
+                                _sgmParams,
+                                depthRange,
+                                downscaledRoi);
+
+    ALICEVISION_LOG_INFO(tile << "SGM Retrieve best depth in volume done.");
+}
+
+} // namespace depthMap
+} // namespace aliceVision
@@ -0,0 +1,103 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/mvsData/ROI.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+#include <aliceVision/mvsUtils/TileParams.hpp>
+#include <aliceVision/depthMap/Tile.hpp>
+#include <aliceVision/depthMap/SgmParams.hpp>
+#include <aliceVision/depthMap/SgmDepthList.hpp>
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+#include <aliceVision/depthMap/cpu/CpuDepthSimMap.hpp>
+#include <aliceVision/depthMap/cpu/CpuVolume.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+/**
+ * @brief Depth Map Estimation Semi-Global Matching on CPU
+ * @note Same computation as Sgm, without GPU.
+ */
+class CpuSgm
+{
+public:
+
+    /**
+     * @brief CpuSgm constructor.
+     * @param[in] mp the multi-view parameters
+     * @param[in] tileParams tile workflow parameters
+     * @param[in] sgmParams the Semi Global Matching parameters
+     * @param[in] cameraCache the host camera cache
+     */
+    CpuSgm(const mvsUtils::MultiViewParams& mp,
+           const mvsUtils::TileParams& tileParams,
+           const SgmParams& sgmParams,
+           CpuCameraCache& cameraCache);
+
+    // no default constructor
+    CpuSgm() = delete;
+
+    // default destructor
+    ~CpuSgm() = default;
+
+    // final depth/similarity map getter
+    inline const CpuDepthSimMap& getDepthSimMap() const { return _depthSimMap; }
+
+    /**
+     * @brief Get memory consumption in host memory.
+     * @return host memory consumption (in MB)
+     */
+    double getMemoryConsumption() const;
+
+    /**
+     * @brief Compute for a single R camera the Semi-Global Matching depth/sim map.
+     * @param[in] tile The given tile for SGM computation
+     * @param[in] tileDepthList the tile SGM depth list
+     */
+    void sgmRc(const Tile& tile, const SgmDepthList& tileDepthList);
+
+private:
+
+    // private methods
+
+    /**
+     * @brief Compute for each RcTc the best / second best similarity volumes.
+     * @param[in] tile The given tile for SGM computation
+     * @param[in] tileDepthList the tile SGM depth list
+     */
+    void computeSimilarityVolumes(const Tile& tile, const SgmDepthList& tileDepthList);
+
+    /**
+     * @brief Optimize the given similarity volume.
+     * @param[in] tile The given tile for SGM computation
+     */
+    void optimizeSimilarityVolume(const Tile& tile);
+
+    /**
+     * @brief Retrieve the best depths in the given similarity volume.
+     * @param[in] tile The given tile for SGM computation
+     * @param[in] tileDepthList the tile SGM depth list
+     */
+    void retrieveBestDepth(const Tile& tile, const SgmDepthList& tileDepthList);
+
+    // private members
+
+    const mvsUtils::MultiViewParams& _mp;          //< Multi-view parameters
+    const mvsUtils::TileParams& _tileParams;       //< tile workflow parameters
+    const SgmParams& _sgmParams;                   //< Semi Global Matching parameters
+    CpuCameraCache& _cameraCache;                  //< host camera cache
+
+    // private members in host memory
+
+    CpuDepthSimMap _depthSimMap;                   //< rc result depth/sim map
+    CpuVolume<TSimCpu> _volumeBestSim;             //< rc best similarity volume
+    CpuVolume<TSimCpu> _volumeSecBestSim;          //< rc second best similarity volume
+};
+
+} // namespace depthMap
+} // namespace aliceVision
@@ -0,0 +1,78 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace aliceVision {
+namespace depthMap {
+
+/*
+ * @note TSimCpu is the similarity type for volume in host memory, same range as the device TSim (0..255).
+ * @note TSimAccCpu is the similarity accumulation type for volume in host memory.
+ * @note TSimRefineCpu is the similarity type for volume refinement in host memory.
+ */
+using TSimCpu = unsigned char;
+using TSimAccCpu = unsigned int;
+using TSimRefineCpu = float;
+
+/**
+ * @brief Volume in host memory.
+ *
+ * The Z dimension (depth) is contiguous in memory:
+ * the similarities of a pixel for all depths are read and written together
+ * by the similarity computation, the SGM aggregation and the best depth retrieval.
+ */
+template <typename T>
+class CpuVolume
+{
+public:
+
+    CpuVolume() = default;
+
+    CpuVolume(int dimX, int dimY, int dimZ) { resize(dimX, dimY, dimZ); }
+
+    /**
+     * @brief Resize the volume, the previous values are not kept.
+     * @note Memory is only reallocated if the new volume is bigger.
+     */
+    void resize(int dimX, int dimY, int dimZ)
+    {
+        _dimX = dimX;
+        _dimY = dimY;
+        _dimZ = dimZ;
+        _data.resize(std::size_t(dimX) * dimY * dimZ);
+    }
+
+    /// Set all the volume values
+    void fill(T value) { std::fill(_data.begin(), _data.end(), value); }
+
+    inline int dimX() const { return _dimX; }
+    inline int dimY() const { return _dimY; }
+    inline int dimZ() const { return _dimZ; }
+
+    /// Return the values of the pixel (x, y) for all depths (dimZ values)
+    inline T* at(int x, int y) { return _data.data() + (std::size_t(y) * _dimX + x) * _dimZ; }
+    inline const T* at(int x, int y) const { return _data.data() + (std::size_t(y) * _dimX + x) * _dimZ; }
+
+    inline T& at(int x, int y, int z) { return at(x, y)[z]; }
+    inline const T& at(int x, int y, int z) const { return at(x, y)[z]; }
+
+    /// Return the memory used by the volume (in bytes)
+    std::size_t memorySize() const { return _data.capacity() * sizeof(T); }
+
+private:
+    int _dimX = 0;
+    int _dimY = 0;
+    int _dimZ = 0;
+    std::vector<T> _data;
+};
+
+} // namespace depthMap
+} // namespace aliceVision
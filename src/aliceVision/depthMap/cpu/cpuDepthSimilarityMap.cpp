@@ -0,0 +1,285 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "cpuDepthSimilarityMap.hpp"
+
+#include <aliceVision/alicevision_omp.hpp>
+#include <aliceVision/depthMap/cpu/CpuPatch.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace aliceVision {
+namespace depthMap {
+
+namespace {
+
+/**
+ * @brief Compute the smoothing step and the energy of a depth map cell.
+ * @note Same as the device function getCellSmoothStepEnergy, neighbor reads are clamped to the map borders.
+ * @return (smoothStep, energy)
+ */
+Vec2f getCellSmoothStepEnergy(const CpuCameraParams& rcParams, const image::Image<float>& depthMap, int cellX, int cellY, const ROI& roi, int stepXY)
+{
+    Vec2f out(0.0f, 180.0f);
+
+    const float d0 = depthMap(cellY, cellX);
+
+    // early exit: depth is <= 0
+    if(d0 <= 0.0f)
+        return out;
+
+    const auto getDepth = [&](int x, int y)
+    {
+        x = std::min(std::max(x, 0), depthMap.Width() - 1);
+        y = std::min(std::max(y, 0), depthMap.Height() - 1);
+        return depthMap(y, x);
+    };
+
+    const auto get3DPoint = [&](int x, int y, float depth)
+    {
+        const Vec2f pix(float((int(roi.x.begin) + x) * stepXY), float((int(roi.y.begin) + y) * stepXY));
+        return cpu_get3DPointForPixelAndDepthFromRC(rcParams, pix, depth);
+    };
+
+    // neighbor depths (left, right, up, bottom)
+    const float dL = getDepth(cellX, cellY - 1);
+    const float dR = getDepth(cellX, cellY + 1);
+    const float dU = getDepth(cellX - 1, cellY);
+    const float dB = getDepth(cellX + 1, cellY);
+
+    // associated 3d points
+    const Vec3f p0 = get3DPoint(cellX, cellY, d0);
+    const Vec3f pL = get3DPoint(cellX, cellY - 1, dL);
+    const Vec3f pR = get3DPoint(cellX, cellY + 1, dR);
+    const Vec3f pU = get3DPoint(cellX - 1, cellY, dU);
+    const Vec3f pB = get3DPoint(cellX + 1, cellY, dB);
+
+    // average point of the valid neighbors
+    Vec3f cg(0.0f, 0.0f, 0.0f);
+    float n = 0.0f;
+
+    if(dL > 0.0f) { cg += pL; n++; }
+    if(dR > 0.0f) { cg += pR; n++; }
+    if(dU > 0.0f) { cg += pU; n++; }
+    if(dB > 0.0f) { cg += pB; n++; }
+
+    if(n > 1.0f)
+    {
+        cg /= n;
+        const Vec3f vcn = (rcParams.C - p0).normalized();
+        // projection of cg on the line from p0 to camera
+        const Vec3f pS = cpu_closestPointToLine3D(cg, p0, vcn);
+        // keep the depth difference between pS and p0 as the smoothing step
+        out.x() = (rcParams.C - pS).norm() - d0;
+    }
+
+    float e = 0.0f;
+    n = 0.0f;
+
+    // large angle between neighbors == flat area => low energy
+    if(dL > 0.0f && dR > 0.0f)
+    {
+        e = std::max(e, (180.0f - cpu_angleBetwABandAC(p0, pL, pR)));
+        n++;
+    }
+    if(dU > 0.0f && dB > 0.0f)
+    {
+        e = std::max(e, (180.0f - cpu_angleBetwABandAC(p0, pU, pB)));
+        n++;
+    }
+
+    // the higher the energy, the less flat the area
+    if(n > 0.0f)
+        out.y() = e;
+
+    return out;
+}
+
+} // namespace
+
+void cpu_depthSimMapCopyDepthOnly(CpuDepthSimMap& out_depthSimMap, const CpuDepthSimMap& in_depthSimMap, float defaultSim)
+{
+    out_depthSimMap.depthMap = in_depthSimMap.depthMap;
+    out_depthSimMap.simMap.resize(in_depthSimMap.width(), in_depthSimMap.height(), true, defaultSim);
+}
+
+void cpu_depthSimMapUpscaleAndFilter(CpuDepthSimMap& out_upscaledDepthSimMap,
+                                     const CpuDepthSimMap& in_otherDepthSimMap,
+                                     const CpuCamera& rcCam,
+                                     const RefineParams& refineParams,
+                                     const ROI& roi)
+{
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+    const int stepXY = refineParams.stepXY;
+    const int inWidth = in_otherDepthSimMap.width();
+    const int inHeight = in_otherDepthSimMap.height();
+    const float ratio = float(inWidth) / float(roiWidth);
+
+    #pragma omp parallel for
+    for(int roiY = 0; roiY < roiHeight; ++roiY)
+    {
+        for(int roiX = 0; roiX < roiWidth; ++roiX)
+        {
+            // corresponding image coordinates
+            const int x = (int(roi.x.begin) + roiX) * stepXY;
+            const int y = (int(roi.y.begin) + roiY) * stepXY;
+
+            // filter masked pixels (alpha < 0.9f)
+            if(rcCam.sample(float(x), float(y)).w() < 0.9f)
+            {
+                out_upscaledDepthSimMap.depthMap(roiY, roiX) = -2.0f;
+                out_upscaledDepthSimMap.simMap(roiY, roiX) = 1.0f;
+                continue;
+            }
+
+            // nearest neighbor, no interpolation
+            const float ox = (float(roiX) - 0.5f) * ratio;
+            const float oy = (float(roiY) - 0.5f) * ratio;
+            const int xp = std::min(std::max(int(std::floor(ox + 0.5f)), 0), inWidth - 1);
+            const int yp = std::min(std::max(int(std::floor(oy + 0.5f)), 0), inHeight - 1);
+
+            out_upscaledDepthSimMap.depthMap(roiY, roiX) = in_otherDepthSimMap.depthMap(yp, xp);
+            out_upscaledDepthSimMap.simMap(roiY, roiX) = in_otherDepthSimMap.simMap(yp, xp);
+        }
+    }
+}
+
+void cpu_depthSimMapComputePixSize(CpuDepthSimMap& inout_depthPixSizeMap,
+                                   const CpuCamera& rcCam,
+                                   const RefineParams& refineParams,
+                                   const ROI& roi)
+{
+    const CpuCameraParams& rcParams = rcCam.getParams();
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+    const int stepXY = refineParams.stepXY;
+
+    #pragma omp parallel for
+    for(int roiY = 0; roiY < roiHeight; ++roiY)
+    {
+        for(int roiX = 0; roiX < roiWidth; ++roiX)
+        {
+            const float depth = inout_depthPixSizeMap.depthMap(roiY, roiX);
+
+            // original depth invalid or masked, pixSize set to 0
+            if(depth < 0.0f)
+            {
+                inout_depthPixSizeMap.simMap(roiY, roiX) = 0.0f;
+                continue;
+            }
+
+            const Vec2f pix(float((int(roi.x.begin) + roiX) * stepXY), float((int(roi.y.begin) + roiY) * stepXY));
+            const Vec3f p = cpu_get3DPointForPixelAndDepthFromRC(rcParams, pix, depth);
+
+            inout_depthPixSizeMap.simMap(roiY, roiX) = cpu_computePixSize(rcParams, p);
+        }
+    }
+}
+
+void cpu_depthSimMapOptimizeGradientDescent(CpuDepthSimMap& out_optimizeDepthSimMap,
+                                            const CpuDepthSimMap& in_sgmDepthPixSizeMap,
+                                            const CpuDepthSimMap& in_refineDepthSimMap,
+                                            const CpuCamera& rcCam,
+                                            const RefineParams& refineParams,
+                                            const ROI& roi)
+{
+    const CpuCameraParams& rcParams = rcCam.getParams();
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+    const int stepXY = refineParams.stepXY;
+
+    // initialize depth/sim map optimized with SGM depth/pixSize map
+    out_optimizeDepthSimMap = in_sgmDepthPixSizeMap;
+
+    // compute image variance map (gradient size of L)
+    image::Image<float> imgVariance(roiWidth, roiHeight);
+
+    #pragma omp parallel for
+    for(int roiY = 0; roiY < roiHeight; ++roiY)
+    {
+        for(int roiX = 0; roiX < roiWidth; ++roiX)
+        {
+            const int x = (int(roi.x.begin) + roiX) * stepXY;
+            const int y = (int(roi.y.begin) + roiY) * stepXY;
+
+            const float xM1 = rcCam.sample(float(x - 1), float(y)).x();
+            const float xP1 = rcCam.sample(float(x + 1), float(y)).x();
+            const float yM1 = rcCam.sample(float(x), float(y - 1)).x();
+            const float yP1 = rcCam.sample(float(x), float(y + 1)).x();
+
+            imgVariance(roiY, roiX) = Vec2f(xM1 - xP1, yM1 - yP1).norm();
+        }
+    }
+
+    // depths of the previous iteration
+    image::Image<float> tmpOptDepthMap;
+
+    for(int iter = 0; iter < refineParams.optimizationNbIterations; ++iter)
+    {
+        tmpOptDepthMap = out_optimizeDepthSimMap.depthMap;
+
+        #pragma omp parallel for
+        for(int roiY = 0; roiY < roiHeight; ++roiY)
+        {
+            for(int roiX = 0; roiX < roiWidth; ++roiX)
+            {
+                // SGM upscale (rough) depth/pixSize
+                const float sgmDepth = in_sgmDepthPixSizeMap.depthMap(roiY, roiX);
+                const float sgmPixSize = in_sgmDepthPixSizeMap.simMap(roiY, roiX);
+
+                // refined and fused (fine) depth/sim
+                const float refineDepth = in_refineDepthSimMap.depthMap(roiY, roiX);
+                const float refineSim = in_refineDepthSimMap.simMap(roiY, roiX);
+
+                // output optimized depth/sim
+                float& outDepth = out_optimizeDepthSimMap.depthMap(roiY, roiX);
+                float& outSim = out_optimizeDepthSimMap.simMap(roiY, roiX);
+
+                if(iter == 0)
+                {
+                    outDepth = sgmDepth;
+                    outSim = refineSim;
+                }
+
+                const float depthOpt = outDepth;
+
+                if(depthOpt <= 0.0f)
+                    continue;
+
+                const Vec2f depthSmoothStepEnergy = getCellSmoothStepEnergy(rcParams, tmpOptDepthMap, roiX, roiY, roi, stepXY); // (smoothStep, energy)
+                float stepToSmoothDepth = depthSmoothStepEnergy.x();
+                stepToSmoothDepth = std::copysign(std::min(std::abs(stepToSmoothDepth), sgmPixSize / 10.0f), stepToSmoothDepth);
+                const float depthEnergy = depthSmoothStepEnergy.y(); // max angle with neighbors
+                float stepToFineDM = refineDepth - depthOpt;       // distance to refined/noisy input depth map
+                stepToFineDM = std::copysign(std::min(std::abs(stepToFineDM), sgmPixSize / 10.0f), stepToFineDM);
+
+                const float stepToRoughDM = sgmDepth - depthOpt; // distance to smooth/robust input depth map
+                const float imgColorVariance = imgVariance(roiY, roiX);
+                const float colorVarianceThresholdForSmoothing = 20.0f;
+                const float angleThresholdForSmoothing = 30.0f;
+
+                const float weightedColorVariance = cpu_sigmoid2(5.0f, angleThresholdForSmoothing, 40.0f, colorVarianceThresholdForSmoothing, imgColorVariance);
+                const float fineSimWeight = cpu_sigmoid(0.0f, 1.0f, 0.7f, -0.7f, refineSim);
+
+                // if geometry variation is bigger than color variation => the fineDM is considered noisy
+                const float energyLowerThanVarianceWeight = cpu_sigmoid(0.0f, 1.0f, 30.0f, weightedColorVariance, depthEnergy);
+                const float closeToRoughWeight = 1.0f - cpu_sigmoid(0.0f, 1.0f, 10.0f, 17.0f, std::abs(stepToRoughDM / sgmPixSize));
+
+                const float depthOptStep = closeToRoughWeight * stepToRoughDM +
+                                           (1.0f - closeToRoughWeight) * (energyLowerThanVarianceWeight * fineSimWeight * stepToFineDM +
+                                                                         (1.0f - energyLowerThanVarianceWeight) * stepToSmoothDepth);
+
+                outDepth = depthOpt + depthOptStep;
+                outSim = (1.0f - closeToRoughWeight) * (energyLowerThanVarianceWeight * fineSimWeight * refineSim + (1.0f - energyLowerThanVarianceWeight) * (depthEnergy / 20.0f));
+            }
+        }
+    }
+}
+
+} // namespace depthMap
+} // namespace aliceVision
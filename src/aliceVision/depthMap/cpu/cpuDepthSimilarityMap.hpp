@@ -0,0 +1,72 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/mvsData/ROI.hpp>
+#include <aliceVision/depthMap/RefineParams.hpp>
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+#include <aliceVision/depthMap/cpu/CpuDepthSimMap.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+/*
+ * Host counterparts of the device depth/similarity map functions (see cuda/planeSweeping/deviceDepthSimilarityMap.hpp).
+ */
+
+/**
+ * @brief Copy depth and default similarity value to the given output depth/sim map.
+ * @param[out] out_depthSimMap the output depth/sim map
+ * @param[in] in_depthSimMap the input depth/sim map to copy
+ * @param[in] defaultSim the default similarity value to copy
+ */
+void cpu_depthSimMapCopyDepthOnly(CpuDepthSimMap& out_depthSimMap, const CpuDepthSimMap& in_depthSimMap, float defaultSim);
+
+/**
+ * @brief Upscale the given depth/sim map and filter masked pixels (alpha).
+ * @param[out] out_upscaledDepthSimMap the output upscaled depth/sim map
+ * @param[in] in_otherDepthSimMap the input depth/sim map to upscale
+ * @param[in] rcCam the R camera
+ * @param[in] refineParams the Refine parameters
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_depthSimMapUpscaleAndFilter(CpuDepthSimMap& out_upscaledDepthSimMap,
+                                     const CpuDepthSimMap& in_otherDepthSimMap,
+                                     const CpuCamera& rcCam,
+                                     const RefineParams& refineParams,
+                                     const ROI& roi);
+
+/**
+ * @brief Compute the pixSize map from the depth map (replace the similarity channel).
+ * @param[in,out] inout_depthPixSizeMap the depth/pixSize map
+ * @param[in] rcCam the R camera
+ * @param[in] refineParams the Refine parameters
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_depthSimMapComputePixSize(CpuDepthSimMap& inout_depthPixSizeMap,
+                                   const CpuCamera& rcCam,
+                                   const RefineParams& refineParams,
+                                   const ROI& roi);
+
+/**
+ * @brief Optimize a depth/sim map with the refine depth/sim map and the SGM depth/pixSize map.
+ * @param[out] out_optimizeDepthSimMap the output optimized depth/sim map
+ * @param[in] in_sgmDepthPixSizeMap the input SGM upscaled depth/pixSize map
+ * @param[in] in_refineDepthSimMap the input refined and fused depth/sim map
+ * @param[in] rcCam the R camera
+ * @param[in] refineParams the Refine parameters
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_depthSimMapOptimizeGradientDescent(CpuDepthSimMap& out_optimizeDepthSimMap,
+                                            const CpuDepthSimMap& in_sgmDepthPixSizeMap,
+                                            const CpuDepthSimMap& in_refineDepthSimMap,
+                                            const CpuCamera& rcCam,
+                                            const RefineParams& refineParams,
+                                            const ROI& roi);
+
+} // namespace depthMap
+} // namespace aliceVision
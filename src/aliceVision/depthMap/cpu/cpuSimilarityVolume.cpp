@@ -0,0 +1,436 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "cpuSimilarityVolume.hpp"
+
+#include <aliceVision/alicevision_omp.hpp>
+#include <aliceVision/depthMap/cpu/CpuPatch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace aliceVision {
+namespace depthMap {
+
+void cpu_volumeComputeSimilarity(CpuVolume<TSimCpu>& inout_volBestSim,
+                                 CpuVolume<TSimCpu>& inout_volSecBestSim,
+                                 const std::vector<float>& in_depths,
+                                 const CpuCamera& rcCam,
+                                 const CpuCamera& tcCam,
+                                 const SgmParams& sgmParams,
+                                 const Range& depthRange,
+                                 const ROI& roi)
+{
+    const CpuCameraParams& rcParams = rcCam.getParams();
+    const CpuCameraParams& tcParams = tcCam.getParams();
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+    const int stepXY = sgmParams.stepXY;
+    const float gammaC = float(sgmParams.gammaC);
+
+    #pragma omp parallel
+    {
+        CpuSimilarityBuffer buffer(sgmParams.wsh, float(sgmParams.gammaP));
+
+        #pragma omp for schedule(dynamic)
+        for(int vy = 0; vy < roiHeight; ++vy)
+        {
+            for(int vx = 0; vx < roiWidth; ++vx)
+            {
+                // corresponding image coordinates
+                const Vec2f pix(float((roi.x.begin + vx) * stepXY), float((roi.y.begin + vy) * stepXY));
+
+                TSimCpu* bestSimPtr = inout_volBestSim.at(vx, vy);
+                TSimCpu* secBestSimPtr = inout_volSecBestSim.at(vx, vy);
+
+                for(unsigned int vz = depthRange.begin; vz < depthRange.end; ++vz)
+                {
+                    // compute patch on the fronto-parallel plane
+                    CpuPatch ptch;
+                    ptch.p = cpu_get3DPointForPixelAndFrontoParellePlaneRC(rcParams, pix, in_depths[vz]);
+                    ptch.d = cpu_computePixSize(rcParams, ptch.p);
+                    cpu_computeRotCSEpip(rcParams, tcParams, ptch);
+
+                    // compute patch similarity
+                    float fsim = cpu_compNCCby3DptsYK(rcCam, tcCam, ptch, gammaC, buffer);
+
+                    if(std::isinf(fsim)) // invalid similarity
+                    {
+                        fsim = 255.0f; // 255 is the invalid similarity value
+                    }
+                    else
+                    {
+                        // remap similarity value from (-1, 1) to (0, 254)
+                        // 255 is reserved for the similarity initialization, i.e. undefined values
+                        fsim = std::min(1.0f, std::max(0.0f, (fsim + 1.0f) * 0.5f)) * 254.0f;
+                    }
+
+                    TSimCpu& fsim1st = bestSimPtr[vz];
+                    TSimCpu& fsim2nd = secBestSimPtr[vz];
+
+                    if(fsim < fsim1st)
+                    {
+                        fsim2nd = fsim1st;
+                        fsim1st = TSimCpu(fsim);
+                    }
+                    else if(fsim < fsim2nd)
+                    {
+                        fsim2nd = TSimCpu(fsim);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void cpu_volumeUpdateUninitializedSimilarity(const CpuVolume<TSimCpu>& in_volBestSim, CpuVolume<TSimCpu>& inout_volSecBestSim)
+{
+    const int volDimX = inout_volSecBestSim.dimX();
+    const int volDimY = inout_volSecBestSim.dimY();
+    const int volDimZ = inout_volSecBestSim.dimZ();
+
+    #pragma omp parallel for
+    for(int vy = 0; vy < volDimY; ++vy)
+    {
+        for(int vx = 0; vx < volDimX; ++vx)
+        {
+            const TSimCpu* bestSimPtr = in_volBestSim.at(vx, vy);
+            TSimCpu* secBestSimPtr = inout_volSecBestSim.at(vx, vy);
+
+            for(int vz = 0; vz < volDimZ; ++vz)
+            {
+                // invalid or uninitialized similarity value
+                if(secBestSimPtr[vz] >= 255)
+                    secBestSimPtr[vz] = bestSimPtr[vz];
+            }
+        }
+    }
+}
+
+void cpu_volumeOptimize(CpuVolume<TSimCpu>& out_volSimFiltered,
+                        const CpuVolume<TSimCpu>& in_volSim,
+                        const CpuCamera& rcCam,
+                        const SgmParams& sgmParams,
+                        const ROI& roi)
+{
+    const int volDimX = in_volSim.dimX();
+    const int volDimY = in_volSim.dimY();
+    const int volDimZ = in_volSim.dimZ();
+    const int stepXY = sgmParams.stepXY;
+    const float P1 = float(sgmParams.p1);
+    const float P2Weighting = float(sgmParams.p2Weighting);
+
+    // aggregate one path direction (along X or Y axis, forward or backward)
+    const auto aggregatePath = [&](bool alongX, bool invPath, int filteringIndex)
+    {
+        const int nbLines = alongX ? volDimY : volDimX;
+        const int lineLength = alongX ? volDimX : volDimY;
+        const int pathSign = invPath ? -1 : 1;
+
+        if(lineLength <= 0)
+            return;
+
+        #pragma omp parallel
+        {
+            std::vector<TSimAccCpu> pathCostPrev(volDimZ);
+            std::vector<TSimAccCpu> pathCostCur(volDimZ);
+
+            #pragma omp for schedule(static)
+            for(int line = 0; line < nbLines; ++line)
+            {
+                // volume coordinates of the i-th position on the line
+                const auto getVolumeCoords = [&](int i, int& vx, int& vy)
+                {
+                    const int pos = invPath ? (lineLength - 1 - i) : i;
+                    vx = alongX ? pos : line;
+                    vy = alongX ? line : pos;
+                };
+
+                // the first position of the path has no predecessor
+                {
+                    int vx, vy;
+                    getVolumeCoords(0, vx, vy);
+
+                    const TSimCpu* inSimPtr = in_volSim.at(vx, vy);
+                    TSimCpu* outSimPtr = out_volSimFiltered.at(vx, vy);
+
+                    for(int vz = 0; vz < volDimZ; ++vz)
+                    {
+                        pathCostPrev[vz] = TSimAccCpu(inSimPtr[vz]);
+                        outSimPtr[vz] = 255;
+                    }
+                }
+
+                for(int i = 1; i < lineLength; ++i)
+                {
+                    int vx, vy;
+                    getVolumeCoords(i, vx, vy);
+
+                    const TSimCpu* inSimPtr = in_volSim.at(vx, vy);
+                    TSimCpu* outSimPtr = out_volSimFiltered.at(vx, vy);
+
+                    // best path cost of the previous position
+                    const TSimAccCpu bestCostPrev = *std::min_element(pathCostPrev.begin(), pathCostPrev.end());
+
+                    // color distance with the previous position
+                    float P2 = 0.0f;
+
+                    if(P2Weighting < 0.0f)
+                    {
+                        // P2 convention: use negative value to skip the use of deltaC
+                        P2 = std::abs(P2Weighting);
+                    }
+                    else
+                    {
+                        const int imX0 = (int(roi.x.begin) + vx) * stepXY; // current
+                        const int imY0 = (int(roi.y.begin) + vy) * stepXY;
+                        const int imX1 = imX0 - pathSign * stepXY * int(alongX); // previous
+                        const int imY1 = imY0 - pathSign * stepXY * int(!alongX);
+
+                        const Eigen::Vector4f gcr0 = rcCam.sample(float(imX0), float(imY0));
+                        const Eigen::Vector4f gcr1 = rcCam.sample(float(imX1), float(imY1));
+                        const float deltaC = (gcr0.head<3>() - gcr1.head<3>()).norm();
+
+                        // best values found from tests: i = 80, a = 255, w = 80, P2 = 100
+                        P2 = cpu_sigmoid(80.f, 255.f, 80.f, P2Weighting, deltaC);
+                    }
+
+                    for(int vz = 0; vz < volDimZ; ++vz)
+                    {
+                        float pathCost = 255.0f;
+
+                        if((vz >= 1) && (vz < volDimZ - 1))
+                        {
+                            const float minCost = std::min(std::min(float(pathCostPrev[vz]), float(pathCostPrev[vz - 1]) + P1),
+                                                           std::min(float(pathCostPrev[vz + 1]) + P1, float(bestCostPrev) + P2));
+
+                            pathCost = float(inSimPtr[vz]) + minCost - float(bestCostPrev);
+                        }
+
+                        pathCostCur[vz] = TSimAccCpu(pathCost);
+
+                        // clamp, TSimCpu is uchar
+                        pathCost = std::min(255.0f, std::max(0.0f, pathCost));
+
+                        // aggregate into the final output
+                        const float val = (float(outSimPtr[vz]) * float(filteringIndex) + pathCost) / float(filteringIndex + 1);
+                        outSimPtr[vz] = TSimCpu(val);
+                    }
+
+                    std::swap(pathCostPrev, pathCostCur);
+                }
+            }
+        }
+    };
+
+    int npaths = 0;
+
+    for(char axis : sgmParams.filteringAxes)
+    {
+        if(axis != 'X' && axis != 'Y')
+            throw std::invalid_argument("Unrecognized SGM filtering axis: " + std::string(1, axis));
+
+        const bool alongX = (axis == 'X');
+
+        aggregatePath(alongX, false, npaths++); // forward
+        aggregatePath(alongX, true, npaths++);  // backward
+    }
+}
+
+void cpu_volumeRetrieveBestDepth(CpuDepthSimMap& out_sgmDepthSimMap,
+                                 const std::vector<float>& in_depths,
+                                 const CpuVolume<TSimCpu>& in_volSim,
+                                 const CpuCameraParams& rcCamParams,
+                                 const SgmParams& sgmParams,
+                                 const Range& depthRange,
+                                 const ROI& roi)
+{
+    const int scaleStep = sgmParams.scale * sgmParams.stepXY;
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+
+    #pragma omp parallel for
+    for(int vy = 0; vy < roiHeight; ++vy)
+    {
+        for(int vx = 0; vx < roiWidth; ++vx)
+        {
+            const TSimCpu* simPtr = in_volSim.at(vx, vy);
+
+            // find best depth
+            float bestSim = 255.0f;
+            int bestZIdx = -1;
+
+            for(unsigned int vz = depthRange.begin; vz < depthRange.end; ++vz)
+            {
+                if(float(simPtr[vz]) < bestSim)
+                {
+                    bestSim = float(simPtr[vz]);
+                    bestZIdx = int(vz);
+                }
+            }
+
+            if(bestZIdx == -1)
+            {
+                out_sgmDepthSimMap.depthMap(vy, vx) = -1.0f; // invalid depth
+                out_sgmDepthSimMap.simMap(vy, vx) = 1.0f;    // worst similarity value
+                continue;
+            }
+
+            // corresponding full resolution image coordinates
+            const Vec2f pix(float((roi.x.begin + vx) * scaleStep), float((roi.y.begin + vy) * scaleStep));
+
+            out_sgmDepthSimMap.depthMap(vy, vx) = cpu_depthPlaneToDepth(rcCamParams, pix, in_depths[bestZIdx]);
+            out_sgmDepthSimMap.simMap(vy, vx) = (bestSim / 255.0f) * 2.0f - 1.0f; // convert from (0, 255) to (-1, +1)
+        }
+    }
+}
+
+void cpu_volumeRefineSimilarity(CpuVolume<TSimRefineCpu>& inout_volSim,
+                                const CpuDepthSimMap& in_sgmDepthPixSizeMap,
+                                const CpuCamera& rcCam,
+                                const CpuCamera& tcCam,
+                                const RefineParams& refineParams,
+                                const Range& depthRange,
+                                const ROI& roi)
+{
+    const CpuCameraParams& rcParams = rcCam.getParams();
+    const CpuCameraParams& tcParams = tcCam.getParams();
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+    const int volDimZ = inout_volSim.dimZ();
+    const int stepXY = refineParams.stepXY;
+    const float gammaC = float(refineParams.gammaC);
+
+    #pragma omp parallel
+    {
+        CpuSimilarityBuffer buffer(refineParams.wsh, float(refineParams.gammaP));
+
+        #pragma omp for schedule(dynamic)
+        for(int vy = 0; vy < roiHeight; ++vy)
+        {
+            for(int vx = 0; vx < roiWidth; ++vx)
+            {
+                // corresponding original plane depth
+                const float originalDepth = in_sgmDepthPixSizeMap.depthMap(vy, vx);
+
+                // original depth invalid or masked, similarity value remain at 0
+                if(originalDepth <= 0.0f)
+                    continue;
+
+                // corresponding image coordinates
+                const Vec2f pix(float((roi.x.begin + vx) * stepXY), float((roi.y.begin + vy) * stepXY));
+
+                // rc 3d point at original depth (z center)
+                const Vec3f originalP = cpu_get3DPointForPixelAndDepthFromRC(rcParams, pix, originalDepth);
+                const Vec3f rcDir = (originalP - rcParams.C).normalized();
+                const float originalPixSize = cpu_computePixSize(rcParams, originalP);
+
+                TSimRefineCpu* simPtr = inout_volSim.at(vx, vy);
+
+                for(unsigned int vz = depthRange.begin; vz < depthRange.end; ++vz)
+                {
+                    // move rc 3d point according to the relative depth
+                    const int relativeDepthIndexOffset = int(vz) - ((volDimZ - 1) / 2);
+
+                    CpuPatch ptch;
+                    ptch.p = originalP + rcDir * (float(relativeDepthIndexOffset) * originalPixSize);
+                    ptch.d = cpu_computePixSize(rcParams, ptch.p);
+                    cpu_computeRotCSEpip(rcParams, tcParams, ptch);
+
+                    float fsim = cpu_compNCCby3DptsYK(rcCam, tcCam, ptch, gammaC, buffer);
+
+                    if(fsim == 1.f || std::isinf(fsim)) // infinite or invalid similarity
+                        fsim = 0.0f; // 0 is the worst similarity value at this point
+
+                    // invert and filter similarity between 0 and 1
+                    // best similarity value was -1, worst was 0
+                    // best similarity value is 1, worst is still 0
+                    simPtr[vz] += cpu_sigmoid(0.0f, 1.0f, 0.7f, -0.7f, fsim);
+                }
+            }
+        }
+    }
+}
+
+void cpu_volumeRefineBestDepth(CpuDepthSimMap& out_refineDepthSimMap,
+                               const CpuDepthSimMap& in_sgmDepthPixSizeMap,
+                               const CpuVolume<TSimRefineCpu>& in_volSim,
+                               const CpuCamera& rcCam,
+                               const RefineParams& refineParams,
+                               const ROI& roi)
+{
+    const CpuCameraParams& rcParams = rcCam.getParams();
+    const int roiWidth = int(roi.width());
+    const int roiHeight = int(roi.height());
+    const int volDimZ = in_volSim.dimZ();
+    const int stepXY = refineParams.stepXY;
+    const int samplesPerPixSize = refineParams.nbSubsamples;         // number of samples between two depths
+    const int halfNbDepths = refineParams.halfNbDepths;              // number of depths (in front and behind mid depth)
+    const int halfNbSamples = samplesPerPixSize * halfNbDepths;      // number of samples (in front and behind mid depth)
+    const float twoTimesSigmaPowerTwo = float(2.0 * refineParams.sigma * refineParams.sigma);
+
+    // gaussian weights for each sample offset (zs - sample) in [-2 * halfNbSamples, 2 * halfNbSamples]
+    std::vector<float> gaussianWeights(4 * halfNbSamples + 1);
+    for(int i = -2 * halfNbSamples; i <= 2 * halfNbSamples; ++i)
+        gaussianWeights[i + 2 * halfNbSamples] = std::exp(-float(i * i) / twoTimesSigmaPowerTwo);
+
+    #pragma omp parallel for
+    for(int vy = 0; vy < roiHeight; ++vy)
+    {
+        for(int vx = 0; vx < roiWidth; ++vx)
+        {
+            // corresponding original plane depth
+            const float originalDepth = in_sgmDepthPixSizeMap.depthMap(vy, vx);
+
+            if(originalDepth <= 0.0f) // original depth invalid or masked
+            {
+                out_refineDepthSimMap.depthMap(vy, vx) = originalDepth; // -1 (invalid) or -2 (masked)
+                out_refineDepthSimMap.simMap(vy, vx) = 1.0f;            // similarity between (-1, +1)
+                continue;
+            }
+
+            const TSimRefineCpu* simPtr = in_volSim.at(vx, vy);
+
+            // find best z sample per pixel with a sliding gaussian window
+            float bestSampleSim = 99999.f;
+            int bestSampleOffsetIndex = 0;
+
+            for(int sample = -halfNbSamples; sample <= halfNbSamples; ++sample)
+            {
+                float sampleSim = 0.f;
+
+                for(int vz = 0; vz < volDimZ; ++vz)
+                {
+                    const int zs = (vz - halfNbDepths) * samplesPerPixSize; // relative sample offset
+
+                    // reverse the inversed similarity sum value, best similarity value is the LOWEST
+                    sampleSim += -simPtr[vz] * gaussianWeights[zs - sample + 2 * halfNbSamples];
+                }
+
+                if(sampleSim < bestSampleSim)
+                {
+                    bestSampleOffsetIndex = sample;
+                    bestSampleSim = sampleSim;
+                }
+            }
+
+            // corresponding image coordinates
+            const Vec2f pix(float((roi.x.begin + vx) * stepXY), float((roi.y.begin + vy) * stepXY));
+
+            // rc 3d point at original depth (z center)
+            const Vec3f p = cpu_get3DPointForPixelAndDepthFromRC(rcParams, pix, originalDepth);
+            const float sampleSize = cpu_computePixSize(rcParams, p) / samplesPerPixSize;
+
+            out_refineDepthSimMap.depthMap(vy, vx) = originalDepth + bestSampleOffsetIndex * sampleSize;
+            out_refineDepthSimMap.simMap(vy, vx) = bestSampleSim;
+        }
+    }
+}
+
+} // namespace depthMap
+} // namespace aliceVision
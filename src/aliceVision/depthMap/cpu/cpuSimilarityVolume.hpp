@@ -0,0 +1,121 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/mvsData/ROI.hpp>
+#include <aliceVision/depthMap/SgmParams.hpp>
+#include <aliceVision/depthMap/RefineParams.hpp>
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+#include <aliceVision/depthMap/cpu/CpuDepthSimMap.hpp>
+#include <aliceVision/depthMap/cpu/CpuVolume.hpp>
+
+#include <vector>
+
+namespace aliceVision {
+namespace depthMap {
+
+/*
+ * Host counterparts of the device similarity volume functions (see cuda/planeSweeping/deviceSimilarityVolume.hpp).
+ * Volumes are sized to the downscaled ROI, pixels of a volume are processed in parallel.
+ */
+
+/**
+ * @brief Compute the best / second best similarity volume for the given RC / TC.
+ * @param[in,out] inout_volBestSim the best similarity volume
+ * @param[in,out] inout_volSecBestSim the second best similarity volume
+ * @param[in] in_depths the R camera depth list
+ * @param[in] rcCam the R camera
+ * @param[in] tcCam the T camera
+ * @param[in] sgmParams the Semi Global Matching parameters
+ * @param[in] depthRange the volume depth range to compute
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_volumeComputeSimilarity(CpuVolume<TSimCpu>& inout_volBestSim,
+                                 CpuVolume<TSimCpu>& inout_volSecBestSim,
+                                 const std::vector<float>& in_depths,
+                                 const CpuCamera& rcCam,
+                                 const CpuCamera& tcCam,
+                                 const SgmParams& sgmParams,
+                                 const Range& depthRange,
+                                 const ROI& roi);
+
+/**
+ * @brief Update second best similarity volume uninitialized values with first best volume values.
+ * @param[in] in_volBestSim the best similarity volume
+ * @param[in,out] inout_volSecBestSim the second best similarity volume
+ */
+void cpu_volumeUpdateUninitializedSimilarity(const CpuVolume<TSimCpu>& in_volBestSim, CpuVolume<TSimCpu>& inout_volSecBestSim);
+
+/**
+ * @brief Filter / Optimize the given similarity volume (Semi-Global Matching aggregation).
+ * @note Each line of a path is aggregated independently, lines are processed in parallel.
+ * @param[out] out_volSimFiltered the output similarity volume
+ * @param[in] in_volSim the input similarity volume
+ * @param[in] rcCam the R camera
+ * @param[in] sgmParams the Semi Global Matching parameters
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_volumeOptimize(CpuVolume<TSimCpu>& out_volSimFiltered,
+                        const CpuVolume<TSimCpu>& in_volSim,
+                        const CpuCamera& rcCam,
+                        const SgmParams& sgmParams,
+                        const ROI& roi);
+
+/**
+ * @brief Retrieve the best depth/sim in the given similarity volume.
+ * @param[out] out_sgmDepthSimMap the output best depth/sim map
+ * @param[in] in_depths the R camera depth list
+ * @param[in] in_volSim the input similarity volume
+ * @param[in] rcCamParams the R camera parameters at full resolution
+ * @param[in] sgmParams the Semi Global Matching parameters
+ * @param[in] depthRange the volume depth range to search
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_volumeRetrieveBestDepth(CpuDepthSimMap& out_sgmDepthSimMap,
+                                 const std::vector<float>& in_depths,
+                                 const CpuVolume<TSimCpu>& in_volSim,
+                                 const CpuCameraParams& rcCamParams,
+                                 const SgmParams& sgmParams,
+                                 const Range& depthRange,
+                                 const ROI& roi);
+
+/**
+ * @brief Refine the best similarity volume for the given RC / TC.
+ * @param[in,out] inout_volSim the similarity volume
+ * @param[in] in_sgmDepthPixSizeMap the SGM upscaled depth/pixSize map
+ * @param[in] rcCam the R camera
+ * @param[in] tcCam the T camera
+ * @param[in] refineParams the Refine parameters
+ * @param[in] depthRange the volume depth range to compute
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_volumeRefineSimilarity(CpuVolume<TSimRefineCpu>& inout_volSim,
+                                const CpuDepthSimMap& in_sgmDepthPixSizeMap,
+                                const CpuCamera& rcCam,
+                                const CpuCamera& tcCam,
+                                const RefineParams& refineParams,
+                                const Range& depthRange,
+                                const ROI& roi);
+
+/**
+ * @brief Retrieve the best depth/sim in the given refined similarity volume.
+ * @param[out] out_refineDepthSimMap the output refined and fused depth/sim map
+ * @param[in] in_sgmDepthPixSizeMap the SGM upscaled depth/pixSize map
+ * @param[in] in_volSim the similarity volume
+ * @param[in] rcCam the R camera
+ * @param[in] refineParams the Refine parameters
+ * @param[in] roi the 2d region of interest
+ */
+void cpu_volumeRefineBestDepth(CpuDepthSimMap& out_refineDepthSimMap,
+                               const CpuDepthSimMap& in_sgmDepthPixSizeMap,
+                               const CpuVolume<TSimRefineCpu>& in_volSim,
+                               const CpuCamera& rcCam,
+                               const RefineParams& refineParams,
+                               const ROI& roi);
+
+} // namespace depthMap
+} // namespace aliceVision
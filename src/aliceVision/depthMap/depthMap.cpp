@@ -6,17 +6,20 @@
 
 #include "depthMap.hpp"
 
+#include <aliceVision/alicevision_omp.hpp>
 #include <aliceVision/system/Logger.hpp>
 #include <aliceVision/system/Timer.hpp>
 #include <aliceVision/mvsUtils/fileIO.hpp>
 #include <aliceVision/mvsUtils/depthSimMapIO.hpp>
 #include <aliceVision/mvsUtils/MultiViewParams.hpp>
 #include <aliceVision/depthMap/depthMapUtils.hpp>
+#include <aliceVision/depthMap/depthMapWorkflow.hpp>
 #include <aliceVision/depthMap/DepthMapParams.hpp>
 #include <aliceVision/depthMap/SgmDepthList.hpp>
 #include <aliceVision/depthMap/Sgm.hpp>
 #include <aliceVision/depthMap/Refine.hpp>
 #include <aliceVision/depthMap/cuda/host/utils.hpp>
+#include <aliceVision/depthMap/cuda/host/deviceDepthMapUtils.hpp>
 #include <aliceVision/depthMap/cuda/host/DeviceCache.hpp>
 #include <aliceVision/depthMap/cuda/host/DeviceStreamManager.hpp>
 #include <aliceVision/depthMap/cuda/normalMapping/DeviceNormalMapper.hpp>
@@ -29,95 +32,6 @@ namespace fs = boost::filesystem;
 namespace aliceVision {
 namespace depthMap {
 
-int computeDownscale(const mvsUtils::MultiViewParams& mp, int scale, int maxWidth, int maxHeight)
-{
-    const int maxImageWidth = mp.getMaxImageWidth() / scale;
-    const int maxImageHeight = mp.getMaxImageHeight() / scale;
-
-    int downscale = 1;
-    int downscaleWidth = mp.getMaxImageWidth() / scale;
-    int downscaleHeight = mp.getMaxImageHeight() / scale;
-
-    while((downscaleWidth > maxWidth) || (downscaleHeight > maxHeight))
-    {
-        downscale++;
-        downscaleWidth = maxImageWidth / downscale;
-        downscaleHeight = maxImageHeight / downscale;
-    }
-
-    return downscale;
-}
-
-bool computeScaleStepSgmParams(const mvsUtils::MultiViewParams& mp, SgmParams& sgmParams)
-{
-    if(sgmParams.scale != -1 && sgmParams.stepXY != -1)
-      return false;
-
-    const int fileScale = 1; // input images scale (should be one)
-    const int maxSideXY = 700 / mp.getProcessDownscale(); // max side in order to fit in device memory
-    const int maxImageW = mp.getMaxImageWidth();
-    const int maxImageH = mp.getMaxImageHeight();
-
-    int maxW = maxSideXY;
-    int maxH = maxSideXY * 0.8;
-
-    if(maxImageW < maxImageH)
-        std::swap(maxW, maxH);
-
-    if(sgmParams.scale == -1)
-    {
-        // compute the number of scales that will be used in the plane sweeping.
-        // the highest scale should have a resolution close to 700x550 (or less).
-        const int scaleTmp = computeDownscale(mp, fileScale, maxW, maxH);
-        sgmParams.scale = std::min(2, scaleTmp);
-    }
-
-    if(sgmParams.stepXY == -1)
-    {
-        sgmParams.stepXY = computeDownscale(mp, fileScale * sgmParams.scale, maxW, maxH);
-    }
-
-    return true;
-}
-
-void updateDepthMapParamsForSingleTileComputation(const mvsUtils::MultiViewParams& mp, bool autoSgmScaleStep, DepthMapParams& depthMapParams)
-{
-    if(!depthMapParams.autoAdjustSmallImage)
-    {
-      // cannot adjust depth map parameters
-      return;
-    }
-
-    // update SGM maxTCamsPerTile
-    if(depthMapParams.sgmParams.maxTCamsPerTile < depthMapParams.maxTCams)
-    {
-      ALICEVISION_LOG_WARNING("Single tile computation, override SGM maximum number of T cameras per tile (before: "
-                              << depthMapParams.sgmParams.maxTCamsPerTile << ", now: " << depthMapParams.maxTCams << ").");
-      depthMapParams.sgmParams.maxTCamsPerTile = depthMapParams.maxTCams;
-    }
-
-    // update Refine maxTCamsPerTile
-    if(depthMapParams.refineParams.maxTCamsPerTile < depthMapParams.maxTCams)
-    {
-      ALICEVISION_LOG_WARNING("Single tile computation, override Refine maximum number of T cameras per tile (before: "
-                              << depthMapParams.refineParams.maxTCamsPerTile << ", now: " << depthMapParams.maxTCams << ").");
-      depthMapParams.refineParams.maxTCamsPerTile = depthMapParams.maxTCams;
-    }
-
-    const int maxSgmBufferWidth  = divideRoundUp(mp.getMaxImageWidth() , depthMapParams.sgmParams.scale * depthMapParams.sgmParams.stepXY);
-    const int maxSgmBufferHeight = divideRoundUp(mp.getMaxImageHeight(), depthMapParams.sgmParams.scale * depthMapParams.sgmParams.stepXY);
-
-    // update SGM step XY
-    if(!autoSgmScaleStep && // user define SGM scale & stepXY
-       (depthMapParams.sgmParams.stepXY == 2) && // default stepXY
-       (maxSgmBufferWidth  < depthMapParams.tileParams.bufferWidth  * 0.5) &&
-       (maxSgmBufferHeight < depthMapParams.tileParams.bufferHeight * 0.5))
-    {
-      ALICEVISION_LOG_WARNING("Single tile computation, override SGM step XY (before: " << depthMapParams.sgmParams.stepXY  << ", now: 1).");
-      depthMapParams.sgmParams.stepXY = 1;
-    }
-}
-
 int getNbStreams(const mvsUtils::MultiViewParams& mp, const DepthMapParams& depthMapParams, int nbTilesPerCamera)
 {
     const int maxImageSize = mp.getMaxImageWidth() * mp.getMaxImageHeight(); // process downscale apply
@@ -195,64 +109,6 @@ int getNbStreams(const mvsUtils::MultiViewParams& mp, const DepthMapParams& dept
     return out_nbAllowedStreams;
 }
 
-void getDepthMapParams(const mvsUtils::MultiViewParams& mp, DepthMapParams& depthMapParams)
-{
-    // get tile user parameters from MultiViewParams property_tree
-
-    auto& tileParams = depthMapParams.tileParams;
-    tileParams.bufferWidth = mp.userParams.get<int>("tile.bufferWidth", tileParams.bufferWidth);
-    tileParams.bufferHeight = mp.userParams.get<int>("tile.bufferHeight", tileParams.bufferHeight);
-    tileParams.padding = mp.userParams.get<int>("tile.padding", tileParams.padding);
-
-    // get SGM user parameters from MultiViewParams property_tree
-
-    auto& sgmParams = depthMapParams.sgmParams;
-    sgmParams.scale = mp.userParams.get<int>("sgm.scale", sgmParams.scale);
-    sgmParams.stepXY = mp.userParams.get<int>("sgm.stepXY", sgmParams.stepXY);
-    sgmParams.stepZ = mp.userParams.get<int>("sgm.stepZ", sgmParams.stepZ);
-    sgmParams.wsh = mp.userParams.get<int>("sgm.wsh", sgmParams.wsh);
-    sgmParams.maxDepths = mp.userParams.get<int>("sgm.maxDepths", sgmParams.maxDepths);
-    sgmParams.maxTCamsPerTile = mp.userParams.get<int>("sgm.maxTCamsPerTile", sgmParams.maxTCamsPerTile);
-    sgmParams.seedsRangeInflate = mp.userParams.get<double>("sgm.seedsRangeInflate", sgmParams.seedsRangeInflate);
-    sgmParams.gammaC = mp.userParams.get<double>("sgm.gammaC", sgmParams.gammaC);
-    sgmParams.gammaP = mp.userParams.get<double>("sgm.gammaP", sgmParams.gammaP);
-    sgmParams.p1 = mp.userParams.get<double>("sgm.p1", sgmParams.p1);
-    sgmParams.p2Weighting = mp.userParams.get<double>("sgm.p2Weighting", sgmParams.p2Weighting);
-    sgmParams.filteringAxes = mp.userParams.get<std::string>("sgm.filteringAxes", sgmParams.filteringAxes);
-    sgmParams.useSfmSeeds = mp.userParams.get<bool>("sgm.useSfmSeeds", sgmParams.useSfmSeeds);
-    sgmParams.depthListPerTile = mp.userParams.get<bool>("sgm.depthListPerTile", sgmParams.depthListPerTile);
-    sgmParams.exportIntermediateDepthSimMaps = mp.userParams.get<bool>("sgm.exportIntermediateDepthSimMaps", sgmParams.exportIntermediateDepthSimMaps);
-    sgmParams.exportIntermediateVolumes = mp.userParams.get<bool>("sgm.exportIntermediateVolumes", sgmParams.exportIntermediateVolumes);
-    sgmParams.exportIntermediateCrossVolumes = mp.userParams.get<bool>("sgm.exportIntermediateCrossVolumes", sgmParams.exportIntermediateCrossVolumes);
-    sgmParams.exportIntermediateVolume9pCsv = mp.userParams.get<bool>("sgm.exportIntermediateVolume9pCsv", sgmParams.exportIntermediateVolume9pCsv);
-
-    // get Refine user parameters from MultiViewParams property_tree
-
-    auto& refineParams = depthMapParams.refineParams;
-    refineParams.scale = mp.userParams.get<int>("refine.scale", refineParams.scale);
-    refineParams.stepXY = mp.userParams.get<int>("refine.stepXY", refineParams.stepXY);
-    refineParams.wsh = mp.userParams.get<int>("refine.wsh", refineParams.wsh);
-    refineParams.halfNbDepths = mp.userParams.get<int>("refine.halfNbDepths", refineParams.halfNbDepths);
-    refineParams.nbSubsamples = mp.userParams.get<int>("refine.nbSubsamples", refineParams.nbSubsamples);
-    refineParams.maxTCamsPerTile = mp.userParams.get<int>("refine.maxTCamsPerTile", refineParams.maxTCamsPerTile);
-    refineParams.optimizationNbIterations = mp.userParams.get<int>("refine.optimizationNbIterations", refineParams.optimizationNbIterations);
-    refineParams.sigma = mp.userParams.get<double>("refine.sigma", refineParams.sigma);
-    refineParams.gammaC = mp.userParams.get<double>("refine.gammaC", refineParams.gammaC);
-    refineParams.gammaP = mp.userParams.get<double>("refine.gammaP", refineParams.gammaP);
-    refineParams.useRefineFuse = mp.userParams.get<bool>("refine.useRefineFuse", refineParams.useRefineFuse);
-    refineParams.useColorOptimization = mp.userParams.get<bool>("refine.useColorOptimization", refineParams.useColorOptimization);
-    refineParams.exportIntermediateDepthSimMaps = mp.userParams.get<bool>("refine.exportIntermediateDepthSimMaps", refineParams.exportIntermediateDepthSimMaps);
-    refineParams.exportIntermediateCrossVolumes = mp.userParams.get<bool>("refine.exportIntermediateCrossVolumes", refineParams.exportIntermediateCrossVolumes);
-    refineParams.exportIntermediateVolume9pCsv = mp.userParams.get<bool>("refine.exportIntermediateVolume9pCsv", refineParams.exportIntermediateVolume9pCsv);
-
-    // get workflow user parameters from MultiViewParams property_tree
-
-    depthMapParams.maxTCams = mp.userParams.get<int>("depthMap.maxTCams", depthMapParams.maxTCams);
-    depthMapParams.chooseTCamsPerTile = mp.userParams.get<bool>("depthMap.chooseTCamsPerTile", depthMapParams.chooseTCamsPerTile);
-    depthMapParams.exportTilePattern = mp.userParams.get<bool>("depthMap.exportTilePattern", depthMapParams.exportTilePattern);
-    depthMapParams.autoAdjustSmallImage = mp.userParams.get<bool>("depthMap.autoAdjustSmallImage", depthMapParams.autoAdjustSmallImage);
-}
-
 void estimateAndRefineDepthMaps(int cudaDeviceId, mvsUtils::MultiViewParams& mp, const std::vector<int>& cams)
 {
     // set the device to use for GPU executions
@@ -262,46 +118,12 @@ void estimateAndRefineDepthMaps(int cudaDeviceId, mvsUtils::MultiViewParams& mp,
     // initialize RAM image cache
     mvsUtils::ImagesCache<image::Image<image::RGBAfColor>> ic(mp, image::EImageColorSpace::LINEAR);
 
-    // get user parameters from MultiViewParams property_tree
+    // get user parameters from MultiViewParams property_tree and compute tile ROI list
     DepthMapParams depthMapParams;
-    getDepthMapParams(mp, depthMapParams);
-
-    // compute SGM scale and step (set to -1)
-    const bool autoSgmScaleStep = computeScaleStepSgmParams(mp, depthMapParams.sgmParams);
-
-    // single tile case, update parameters
-    if(hasOnlyOneTile(depthMapParams.tileParams, mp.getMaxImageWidth(), mp.getMaxImageHeight()))
-      updateDepthMapParamsForSingleTileComputation(mp, autoSgmScaleStep, depthMapParams);
-
-    // compute the maximum downscale factor
-    const int maxDownscale = std::max(depthMapParams.sgmParams.scale * depthMapParams.sgmParams.stepXY,
-                                      depthMapParams.refineParams.scale * depthMapParams.refineParams.stepXY);
-
-    if(depthMapParams.tileParams.padding % maxDownscale != 0)
-    {
-      const int padding = divideRoundUp(depthMapParams.tileParams.padding, maxDownscale) * maxDownscale;
-      ALICEVISION_LOG_WARNING("Override tiling padding parameter (before: " << depthMapParams.tileParams.padding << ", now: " << padding << ").");
-      depthMapParams.tileParams.padding = padding;
-    }
-
-    // compute tile ROI list
     std::vector<ROI> tileRoiList;
-    getTileRoiList(depthMapParams.tileParams, mp.getMaxImageWidth(), mp.getMaxImageHeight(), maxDownscale, tileRoiList);
+    initDepthMapParamsAndTileRoiList(mp, depthMapParams, tileRoiList);
     const int nbTilesPerCamera = tileRoiList.size();
 
-    // log tiling information and ROI list
-    logTileRoiList(depthMapParams.tileParams, mp.getMaxImageWidth(), mp.getMaxImageHeight(), maxDownscale, tileRoiList);
-
-    // log SGM downscale & stepXY
-    ALICEVISION_LOG_INFO("SGM parameters:" << std::endl
-                         << "\t- scale: " << depthMapParams.sgmParams.scale << std::endl
-                         << "\t- stepXY: " << depthMapParams.sgmParams.stepXY);
-
-    // log Refine downscale & stepXY
-    ALICEVISION_LOG_INFO("Refine parameters:" << std::endl
-                         << "\t- scale: " << depthMapParams.refineParams.scale << std::endl
-                         << "\t- stepXY: " << depthMapParams.refineParams.stepXY);
-
     // get maximum number of stream (simultaneous tiles)
     const int nbStreams = getNbStreams(mp, depthMapParams, nbTilesPerCamera);
     DeviceStreamManager deviceStreamManager(nbStreams);
@@ -318,47 +140,8 @@ void estimateAndRefineDepthMaps(int cudaDeviceId, mvsUtils::MultiViewParams& mp,
     deviceCache.buildCache(nbCamerasPerBatch);
     
     // build tile list
-    // order by R camera
     std::vector<Tile> tiles;
-    tiles.reserve(cams.size() * tileRoiList.size());
-
-    for(int rc : cams)
-    {
-        // compute T cameras list per R camera
-        const std::vector<int> tCams = mp.findNearestCamsFromLandmarks(rc, depthMapParams.maxTCams).getDataWritable();
-        const ROI rcImageRoi(Range(0, mp.getWidth(rc)), Range(0, mp.getHeight(rc)));
-
-        for(std::size_t ti = 0;  ti < tileRoiList.size(); ++ti)
-        {
-            Tile t;
-
-            t.id = ti;
-            t.nbTiles = nbTilesPerCamera;
-            t.rc = rc;
-            t.roi = intersect(tileRoiList.at(ti), rcImageRoi);
-
-            if(t.roi.isEmpty())
-            {
-              // do nothing, this ROI cannot intersect the R camera ROI.
-            }
-            else if(depthMapParams.chooseTCamsPerTile)
-            {
-              // find nearest T cameras per tile
-              t.sgmTCams = mp.findTileNearestCams(rc, depthMapParams.sgmParams.maxTCamsPerTile, tCams, t.roi);
-
-              if(depthMapParams.useRefine)
-                t.refineTCams = mp.findTileNearestCams(rc, depthMapParams.refineParams.maxTCamsPerTile, tCams, t.roi);
-            }
-            else
-            {
-              // use previously selected T cameras from the entire image
-              t.sgmTCams = tCams;
-              t.refineTCams = tCams;
-            }
-
-            tiles.push_back(t);
-        }
-    }
+    buildTileList(mp, depthMapParams, cams, tileRoiList, tiles);
 
     // allocate Sgm and Refine per stream in device memory
     std::vector<Sgm> sgmPerStream;
@@ -587,7 +370,7 @@ void computeNormalMaps(int cudaDeviceId, mvsUtils::MultiViewParams& mp, const st
             const int scale = 1;
 
             image::Image<float> depthMap;
-            readImage(getFileNameFromIndex(mp, rc, mvsUtils::EFileType::depthMap, 0), depthMap, image::EImageColorSpace::NO_CONVERSION);
+            mvsUtils::readDepthMap(rc, mp, depthMap, 0);
 
             image::Image<image::RGBfColor> normalMap(mp.getWidth(rc), mp.getHeight(rc));
 
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <aliceVision/config.hpp>
+
 #include <vector>
 
 namespace aliceVision {
@@ -15,8 +17,22 @@ namespace mvsUtils { class MultiViewParams; }
 
 namespace depthMap {
 
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
 void estimateAndRefineDepthMaps(int cudaDeviceId, mvsUtils::MultiViewParams& mp, const std::vector<int>& cams);
+#endif
+
+/**
+ * @brief Estimate and refine the depth maps of the given cameras without GPU.
+ * @note Same workflow and results as estimateAndRefineDepthMaps, tiles are computed one after the other
+ *       and each tile computation is multi-threaded.
+ * @param[in,out] mp the multi-view parameters
+ * @param[in] cams the R camera index list
+ */
+void estimateAndRefineDepthMapsCpu(mvsUtils::MultiViewParams& mp, const std::vector<int>& cams);
+
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
 void computeNormalMaps(int cudaDeviceId, mvsUtils::MultiViewParams& mp, const std::vector<int>& cams);
+#endif
 
 } // namespace depthMap
 } // namespace aliceVision
@@ -0,0 +1,157 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "depthMap.hpp"
+
+#include <aliceVision/alicevision_omp.hpp>
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+#include <aliceVision/depthMap/depthMapUtils.hpp>
+#include <aliceVision/depthMap/depthMapWorkflow.hpp>
+#include <aliceVision/depthMap/DepthMapParams.hpp>
+#include <aliceVision/depthMap/SgmDepthList.hpp>
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+#include <aliceVision/depthMap/cpu/CpuSgm.hpp>
+#include <aliceVision/depthMap/cpu/CpuRefine.hpp>
+
+namespace aliceVision {
+namespace depthMap {
+
+void estimateAndRefineDepthMapsCpu(mvsUtils::MultiViewParams& mp, const std::vector<int>& cams)
+{
+    // initialize RAM image cache
+    mvsUtils::ImagesCache<image::Image<image::RGBAfColor>> ic(mp, image::EImageColorSpace::LINEAR);
+
+    // get user parameters from MultiViewParams property_tree and compute tile ROI list
+    DepthMapParams depthMapParams;
+    std::vector<ROI> tileRoiList;
+    initDepthMapParamsAndTileRoiList(mp, depthMapParams, tileRoiList);
+    const int nbTilesPerCamera = tileRoiList.size();
+
+    ALICEVISION_LOG_INFO("Parallelization:" << std::endl
+                         << "\t- backend: CPU" << std::endl
+                         << "\t- # tiles per image: " << nbTilesPerCamera << std::endl
+                         << "\t- # threads: " << omp_get_max_threads());
+
+    // build host camera cache
+    // tiles of a R camera are computed sequentially, each tile computation is multi-threaded
+    const int nbCamerasPerSgm = 1 + depthMapParams.maxTCams;                                      // number of Sgm cameras per R camera
+    const int nbCamerasPerRefine = depthMapParams.useRefine ? (1 + depthMapParams.maxTCams) : 0; // number of Refine cameras per R camera
+    CpuCameraCache cameraCache(mp, ic, nbCamerasPerSgm + nbCamerasPerRefine);
+
+    // build tile list
+    std::vector<Tile> tiles;
+    buildTileList(mp, depthMapParams, cams, tileRoiList, tiles);
+
+    // Sgm and Refine in host memory, buffers are resized to each tile
+    CpuSgm sgm(mp, depthMapParams.tileParams, depthMapParams.sgmParams, cameraCache);
+    CpuRefine refine(mp, depthMapParams.tileParams, depthMapParams.refineParams, cameraCache);
+
+    // final depth/similarity map scale and step
+    const int scale = depthMapParams.useRefine ? depthMapParams.refineParams.scale : depthMapParams.sgmParams.scale;
+    const int stepXY = depthMapParams.useRefine ? depthMapParams.refineParams.stepXY : depthMapParams.sgmParams.stepXY;
+
+    // final depth/similarity map tile list of the current R camera
+    std::vector<CpuDepthSimMap> depthSimMapTiles(nbTilesPerCamera);
+    std::vector<std::pair<float, float>> depthMinMaxTiles(nbTilesPerCamera);
+
+    // compute each R camera, tile by tile
+    for(std::size_t ci = 0; ci < cams.size(); ++ci)
+    {
+        const int rc = cams.at(ci);
+
+        for(int ti = 0; ti < nbTilesPerCamera; ++ti)
+        {
+            Tile& tile = tiles.at(ci * nbTilesPerCamera + ti);
+
+            // do not compute empty ROI
+            // some images in the dataset may be smaller than others
+            if(tile.roi.isEmpty())
+                continue;
+
+            // get tile result depth/similarity map in host memory
+            CpuDepthSimMap& tileDepthSimMap = depthSimMapTiles.at(tile.id);
+
+            // initialize tile result depth/similarity map to invalid depth
+            {
+                const ROI downscaledRoi = downscaleROI(tile.roi, scale * stepXY);
+                tileDepthSimMap.resize(int(downscaledRoi.width()), int(downscaledRoi.height()));
+                tileDepthSimMap.fill(-1.f, 1.f);
+            }
+
+            // check T cameras
+            if(tile.sgmTCams.empty() || (depthMapParams.useRefine && tile.refineTCams.empty())) // no T camera found
+                continue;
+
+            // build tile SGM depth list
+            SgmDepthList sgmDepthList(mp, depthMapParams.sgmParams, tile);
+
+            // compute the R camera depth list
+            sgmDepthList.computeListRc();
+
+            // check number of depths
+            if(sgmDepthList.getDepths().empty()) // no depth found
+            {
+                depthMinMaxTiles.at(tile.id) = {0.f, 0.f};
+                continue;
+            }
+
+            // remove T cameras with no depth found.
+            sgmDepthList.removeTcWithNoDepth(tile);
+
+            // store min/max depth
+            depthMinMaxTiles.at(tile.id) = sgmDepthList.getMinMaxDepths();
+
+            // log debug camera / depth information
+            sgmDepthList.logRcTcDepthInformation();
+
+            // check if starting and stopping depth are valid
+            sgmDepthList.checkStartingAndStoppingDepth();
+
+            // compute Semi-Global Matching
+            sgm.sgmRc(tile, sgmDepthList);
+
+            // compute Refine
+            if(depthMapParams.useRefine)
+            {
+                refine.refineRc(tile, sgm.getDepthSimMap());
+                tileDepthSimMap = refine.getDepthSimMap();
+            }
+            else
+            {
+                tileDepthSimMap = sgm.getDepthSimMap();
+            }
+        }
+
+        // write depth/sim map result
+        writeDepthSimMapFromTileList(rc, mp, depthMapParams.tileParams, tileRoiList, depthSimMapTiles, scale, stepXY);
+
+        if(depthMapParams.exportTilePattern)
+            exportDepthSimMapTilePatternObj(rc, mp, tileRoiList, depthMinMaxTiles);
+    }
+
+    // merge intermediate results tiles if needed and desired
+    if(tiles.size() > cams.size())
+    {
+        // merge tiles if needed and desired
+        for(int rc : cams)
+        {
+            if(depthMapParams.sgmParams.exportIntermediateDepthSimMaps)
+            {
+                mergeDepthSimMapTiles(rc, mp, depthMapParams.sgmParams.scale, depthMapParams.sgmParams.stepXY, "_sgm");
+            }
+
+            if(depthMapParams.useRefine && depthMapParams.refineParams.exportIntermediateDepthSimMaps)
+            {
+                mergeDepthSimMapTiles(rc, mp, depthMapParams.refineParams.scale, depthMapParams.refineParams.stepXY, "_sgmUpscaled");
+                mergeDepthSimMapTiles(rc, mp, depthMapParams.refineParams.scale, depthMapParams.refineParams.stepXY, "_refinedFused");
+            }
+        }
+    }
+}
+
+} // namespace depthMap
+} // namespace aliceVision
@@ -0,0 +1,484 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/config.hpp>
+#include <aliceVision/camera/Pinhole.hpp>
+#include <aliceVision/sfmData/SfMData.hpp>
+#include <aliceVision/image/io.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+#include <aliceVision/mvsUtils/depthSimMapIO.hpp>
+#include <aliceVision/depthMap/depthMap.hpp>
+#include <aliceVision/depthMap/cpu/CpuCamera.hpp>
+#include <aliceVision/depthMap/cpu/CpuPatch.hpp>
+#include <aliceVision/depthMap/cpu/cpuSimilarityVolume.hpp>
+
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
+#include <aliceVision/gpu/gpu.hpp>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define BOOST_TEST_MODULE depthMapCpu
+
+#include <boost/test/unit_test.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::depthMap;
+
+namespace {
+
+/*
+ * Synthetic pair: two fronto-parallel cameras with a horizontal baseline
+ * looking at a textured plane (world z = planeZ).
+ * At the plane depth, the disparity is focal * baseline / planeZ = 40 pixels.
+ */
+const int imageWidth = 160;
+const int imageHeight = 120;
+const double focal = 160.0;
+const double baseline = 1.0;
+const double planeZ = 4.0;
+
+/// random value noise on the plane, bilinearly interpolated
+class PlaneTexture
+{
+public:
+    PlaneTexture()
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> value(0.1f, 0.9f);
+
+        _values.resize(_gridWidth * _gridHeight);
+        for(float& v : _values)
+            v = value(generator);
+    }
+
+    float operator()(double X, double Y) const
+    {
+        const double gx = std::min(std::max((X - _originX) / _cellSize, 0.0), double(_gridWidth - 2));
+        const double gy = std::min(std::max((Y - _originY) / _cellSize, 0.0), double(_gridHeight - 2));
+        const int x0 = int(gx);
+        const int y0 = int(gy);
+        const float ax = float(gx - x0);
+        const float ay = float(gy - y0);
+
+        const float top = at(x0, y0) * (1.f - ax) + at(x0 + 1, y0) * ax;
+        const float bottom = at(x0, y0 + 1) * (1.f - ax) + at(x0 + 1, y0 + 1) * ax;
+        return top * (1.f - ay) + bottom * ay;
+    }
+
+private:
+    float at(int x, int y) const { return _values[y * _gridWidth + x]; }
+
+    const double _cellSize = 0.05; // 2 pixels at the plane depth
+    const double _originX = -3.0;
+    const double _originY = -2.5;
+    const int _gridWidth = 160;
+    const int _gridHeight = 100;
+    std::vector<float> _values;
+};
+
+/// the two views of the synthetic pair, the image paths can be empty
+void buildSfMData(sfmData::SfMData& sfmData, const std::vector<std::string>& imagePaths)
+{
+    sfmData.intrinsics[0] = std::make_shared<camera::Pinhole>(imageWidth, imageHeight, focal, focal, 0.0, 0.0);
+
+    for(int i = 0; i < 2; ++i)
+    {
+        std::shared_ptr<sfmData::View> view = std::make_shared<sfmData::View>(imagePaths.at(i), i, 0, i, imageWidth, imageHeight);
+        sfmData.views[i] = view;
+        sfmData.setPose(*view, sfmData::CameraPose(geometry::Pose3(Mat3::Identity(), Vec3(baseline * i, 0.0, 0.0))));
+    }
+}
+
+/// intersection of the ray of the given camera pixel with the plane
+Vec3 getPlanePoint(const mvsUtils::MultiViewParams& mp, int cam, double x, double y)
+{
+    const Point3d ray = mp.iCamArr[cam] * Point2d(x, y);
+    const Point3d& C = mp.CArr[cam];
+    const double t = (planeZ - C.z) / ray.z;
+    return Vec3(C.x + t * ray.x, C.y + t * ray.y, C.z + t * ray.z);
+}
+
+/// ground truth depth (distance to the camera center) of the given camera pixel
+float getGroundTruthDepth(const mvsUtils::MultiViewParams& mp, int cam, int x, int y)
+{
+    const Point3d& C = mp.CArr[cam];
+    return float((getPlanePoint(mp, cam, x, y) - Vec3(C.x, C.y, C.z)).norm());
+}
+
+void renderImage(const mvsUtils::MultiViewParams& mp, int cam, const PlaneTexture& texture, image::Image<image::RGBAfColor>& img)
+{
+    img.resize(imageWidth, imageHeight);
+
+    for(int y = 0; y < imageHeight; ++y)
+    {
+        for(int x = 0; x < imageWidth; ++x)
+        {
+            const Vec3 p = getPlanePoint(mp, cam, x, y);
+            const float v = texture(p.x(), p.y());
+            img(y, x) = image::RGBAfColor(v, v, v, 1.0f);
+        }
+    }
+}
+
+/// pixels of the R camera seen by the T camera for all the tested depths, away from the image borders
+bool isInterior(int x, int y)
+{
+    return (x >= 60) && (x < imageWidth - 8) && (y >= 8) && (y < imageHeight - 8);
+}
+
+/// SGM depth list: one pixel of disparity between two consecutive depths, increasing depths
+void getSgmDepths(std::vector<float>& depths, int& planeDepthIndex)
+{
+    depths.clear();
+    for(int disparity = 52; disparity >= 28; --disparity)
+    {
+        if(disparity == 40)
+            planeDepthIndex = int(depths.size());
+        depths.push_back(float(focal * baseline / disparity));
+    }
+}
+
+int getBestDepthIndex(const CpuVolume<TSimCpu>& volume, int vx, int vy)
+{
+    const TSimCpu* sim = volume.at(vx, vy);
+    return int(std::min_element(sim, sim + volume.dimZ()) - sim);
+}
+
+/// compute the SGM similarity volume of the R camera 0 with the T camera 1
+void computeSgmVolume(const CpuCamera& rcCam,
+                      const CpuCamera& tcCam,
+                      const SgmParams& sgmParams,
+                      const std::vector<float>& depths,
+                      CpuVolume<TSimCpu>& volSecBestSim)
+{
+    const ROI roi(0, imageWidth, 0, imageHeight);
+    const int nbDepths = int(depths.size());
+
+    CpuVolume<TSimCpu> volBestSim(imageWidth, imageHeight, nbDepths);
+    volSecBestSim.resize(imageWidth, imageHeight, nbDepths);
+    volBestSim.fill(255);
+    volSecBestSim.fill(255);
+
+    cpu_volumeComputeSimilarity(volBestSim, volSecBestSim, depths, rcCam, tcCam, sgmParams, Range(0, nbDepths), roi);
+    cpu_volumeUpdateUninitializedSimilarity(volBestSim, volSecBestSim);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(depthMapCpu_similarityVolume)
+{
+    sfmData::SfMData sfmData;
+    buildSfMData(sfmData, {"", ""});
+    const mvsUtils::MultiViewParams mp(sfmData);
+
+    const PlaneTexture texture;
+    image::Image<image::RGBAfColor> rcImage, tcImage;
+    renderImage(mp, 0, texture, rcImage);
+    renderImage(mp, 1, texture, tcImage);
+
+    const CpuCamera rcCam(0, 1, mp, rcImage);
+    const CpuCamera tcCam(1, 1, mp, tcImage);
+
+    SgmParams sgmParams;
+    sgmParams.scale = 1;
+    sgmParams.stepXY = 1;
+
+    std::vector<float> depths;
+    int planeDepthIndex = -1;
+    getSgmDepths(depths, planeDepthIndex);
+
+    CpuVolume<TSimCpu> volSim;
+    computeSgmVolume(rcCam, tcCam, sgmParams, depths, volSim);
+
+    // the plane depth has the best similarity
+    int nbInterior = 0;
+    int nbGood = 0;
+
+    for(int y = 0; y < imageHeight; ++y)
+    {
+        for(int x = 0; x < imageWidth; ++x)
+        {
+            if(!isInterior(x, y))
+                continue;
+
+            ++nbInterior;
+
+            // similarity in (0, 254), 0 is the best similarity
+            if(getBestDepthIndex(volSim, x, y) == planeDepthIndex && volSim.at(x, y, planeDepthIndex) < 50)
+                ++nbGood;
+        }
+    }
+
+    BOOST_CHECK_GE(nbGood, 0.9 * nbInterior);
+
+    // the T camera does not see the left border pixels for the smallest depths
+    BOOST_CHECK_EQUAL(volSim.at(0, imageHeight / 2, 0), 255);
+}
+
+BOOST_AUTO_TEST_CASE(depthMapCpu_sgmAggregation)
+{
+    sfmData::SfMData sfmData;
+    buildSfMData(sfmData, {"", ""});
+    const mvsUtils::MultiViewParams mp(sfmData);
+
+    const PlaneTexture texture;
+    image::Image<image::RGBAfColor> rcImage, tcImage;
+    renderImage(mp, 0, texture, rcImage);
+    renderImage(mp, 1, texture, tcImage);
+
+    const CpuCamera rcCam(0, 1, mp, rcImage);
+    const CpuCamera tcCam(1, 1, mp, tcImage);
+
+    SgmParams sgmParams;
+    sgmParams.scale = 1;
+    sgmParams.stepXY = 1;
+
+    std::vector<float> depths;
+    int planeDepthIndex = -1;
+    getSgmDepths(depths, planeDepthIndex);
+
+    CpuVolume<TSimCpu> volSim;
+    computeSgmVolume(rcCam, tcCam, sgmParams, depths, volSim);
+
+    // corrupt isolated pixels: a wrong depth gets the best similarity
+    const int wrongDepthIndex = planeDepthIndex - 6;
+    std::vector<std::pair<int, int>> corruptedPixels;
+
+    for(int y = 12; y < imageHeight - 12; y += 8)
+    {
+        for(int x = 64; x < imageWidth - 12; x += 8)
+        {
+            volSim.at(x, y, planeDepthIndex) = 80;
+            volSim.at(x, y, wrongDepthIndex) = 0;
+            corruptedPixels.emplace_back(x, y);
+        }
+    }
+
+    for(const auto& pixel : corruptedPixels)
+        BOOST_CHECK_EQUAL(getBestDepthIndex(volSim, pixel.first, pixel.second), wrongDepthIndex);
+
+    const ROI roi(0, imageWidth, 0, imageHeight);
+    CpuVolume<TSimCpu> volSimFiltered(imageWidth, imageHeight, int(depths.size()));
+    cpu_volumeOptimize(volSimFiltered, volSim, rcCam, sgmParams, roi);
+
+    // the aggregation along the paths restores the plane depth of the corrupted pixels
+    int nbRestored = 0;
+    for(const auto& pixel : corruptedPixels)
+    {
+        if(getBestDepthIndex(volSimFiltered, pixel.first, pixel.second) == planeDepthIndex)
+            ++nbRestored;
+    }
+
+    BOOST_CHECK_GE(nbRestored, 0.9 * corruptedPixels.size());
+
+    // best depth retrieval
+    CpuCameraParams rcCamParams;
+    fillCpuCameraParameters(rcCamParams, 0, 1, mp);
+
+    CpuDepthSimMap depthSimMap;
+    depthSimMap.resize(imageWidth, imageHeight);
+    cpu_volumeRetrieveBestDepth(depthSimMap, depths, volSimFiltered, rcCamParams, sgmParams, Range(0, int(depths.size())), roi);
+
+    int nbInterior = 0;
+    int nbGood = 0;
+
+    for(int y = 0; y < imageHeight; ++y)
+    {
+        for(int x = 0; x < imageWidth; ++x)
+        {
+            if(!isInterior(x, y))
+                continue;
+
+            ++nbInterior;
+
+            const float groundTruthDepth = getGroundTruthDepth(mp, 0, x, y);
+            if(std::abs(depthSimMap.depthMap(y, x) - groundTruthDepth) < 0.01f * groundTruthDepth)
+                ++nbGood;
+
+            BOOST_CHECK(depthSimMap.simMap(y, x) >= -1.f && depthSimMap.simMap(y, x) <= 1.f);
+        }
+    }
+
+    BOOST_CHECK_GE(nbGood, 0.9 * nbInterior);
+}
+
+BOOST_AUTO_TEST_CASE(depthMapCpu_refine)
+{
+    sfmData::SfMData sfmData;
+    buildSfMData(sfmData, {"", ""});
+    const mvsUtils::MultiViewParams mp(sfmData);
+
+    const PlaneTexture texture;
+    image::Image<image::RGBAfColor> rcImage, tcImage;
+    renderImage(mp, 0, texture, rcImage);
+    renderImage(mp, 1, texture, tcImage);
+
+    const CpuCamera rcCam(0, 1, mp, rcImage);
+    const CpuCamera tcCam(1, 1, mp, tcImage);
+
+    RefineParams refineParams;
+    refineParams.scale = 1;
+    refineParams.stepXY = 1;
+
+    // SGM-like input: the ground truth depth moved 6.4 pixel sizes backward
+    const float depthOffset = 6.4f;
+    CpuDepthSimMap sgmDepthPixSizeMap;
+    sgmDepthPixSizeMap.resize(imageWidth, imageHeight);
+
+    for(int y = 0; y < imageHeight; ++y)
+    {
+        for(int x = 0; x < imageWidth; ++x)
+        {
+            const Vec2f pix(float(x), float(y));
+            const float groundTruthDepth = getGroundTruthDepth(mp, 0, x, y);
+            const float pixSize = cpu_computePixSize(rcCam.getParams(), cpu_get3DPointForPixelAndDepthFromRC(rcCam.getParams(), pix, groundTruthDepth));
+
+            sgmDepthPixSizeMap.depthMap(y, x) = groundTruthDepth + depthOffset * pixSize;
+            sgmDepthPixSizeMap.simMap(y, x) = pixSize;
+        }
+    }
+
+    // masked pixel
+    sgmDepthPixSizeMap.depthMap(imageHeight / 2, 80) = -2.f;
+
+    const ROI roi(0, imageWidth, 0, imageHeight);
+    const int nbDepthsToRefine = refineParams.halfNbDepths * 2 + 1;
+
+    CpuVolume<TSimRefineCpu> volSim(imageWidth, imageHeight, nbDepthsToRefine);
+    volSim.fill(TSimRefineCpu(0.f));
+    cpu_volumeRefineSimilarity(volSim, sgmDepthPixSizeMap, rcCam, tcCam, refineParams, Range(0, nbDepthsToRefine), roi);
+
+    CpuDepthSimMap refinedDepthSimMap;
+    refinedDepthSimMap.resize(imageWidth, imageHeight);
+    cpu_volumeRefineBestDepth(refinedDepthSimMap, sgmDepthPixSizeMap, volSim, rcCam, refineParams, roi);
+
+    // masked pixels are kept
+    BOOST_CHECK_EQUAL(refinedDepthSimMap.depthMap(imageHeight / 2, 80), -2.f);
+    BOOST_CHECK_EQUAL(refinedDepthSimMap.simMap(imageHeight / 2, 80), 1.f);
+
+    // the refined depth is closer to the ground truth than the input depth
+    int nbInterior = 0;
+    int nbGood = 0;
+
+    for(int y = 0; y < imageHeight; ++y)
+    {
+        for(int x = 0; x < imageWidth; ++x)
+        {
+            if(!isInterior(x, y) || sgmDepthPixSizeMap.depthMap(y, x) <= 0.f)
+                continue;
+
+            ++nbInterior;
+
+            const float pixSize = sgmDepthPixSizeMap.simMap(y, x);
+            const float error = std::abs(refinedDepthSimMap.depthMap(y, x) - getGroundTruthDepth(mp, 0, x, y)) / pixSize;
+            if(error < 2.f)
+                ++nbGood;
+        }
+    }
+
+    BOOST_CHECK_GE(nbGood, 0.8 * nbInterior);
+}
+
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
+
+BOOST_AUTO_TEST_CASE(depthMapCpu_gpuConsistency)
+{
+    if(!gpu::gpuSupportCUDA(2, 0))
+    {
+        BOOST_TEST_MESSAGE("No CUDA device, CPU/GPU consistency test skipped.");
+        return;
+    }
+
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    const boost::filesystem::path cpuFolder = folder / "cpu";
+    const boost::filesystem::path gpuFolder = folder / "gpu";
+    boost::filesystem::create_directories(cpuFolder);
+    boost::filesystem::create_directories(gpuFolder);
+
+    // render the synthetic pair on disk
+    const std::vector<std::string> imagePaths = {(folder / "0.exr").string(), (folder / "1.exr").string()};
+    sfmData::SfMData sfmData;
+    {
+        sfmData::SfMData renderSfmData;
+        buildSfMData(renderSfmData, {"", ""});
+        const mvsUtils::MultiViewParams renderMp(renderSfmData);
+
+        const PlaneTexture texture;
+        for(int cam = 0; cam < 2; ++cam)
+        {
+            image::Image<image::RGBAfColor> img;
+            renderImage(renderMp, cam, texture, img);
+            image::writeImage(imagePaths.at(cam), img, image::ImageWriteOptions().toColorSpace(image::EImageColorSpace::LINEAR));
+        }
+
+        // landmarks on the plane, used for the depth range and the T camera selection
+        buildSfMData(sfmData, imagePaths);
+        const camera::IntrinsicBase& intrinsic = *sfmData.getIntrinsicPtr(0);
+        IndexT landmarkId = 0;
+
+        for(int y = 10; y < imageHeight - 10; y += 10)
+        {
+            for(int x = 50; x < imageWidth - 10; x += 10)
+            {
+                sfmData::Landmark landmark(getPlanePoint(renderMp, 0, x, y), feature::EImageDescriberType::SIFT);
+                for(IndexT viewId = 0; viewId < 2; ++viewId)
+                {
+                    const geometry::Pose3 pose = sfmData.getPose(sfmData.getView(viewId)).getTransform();
+                    landmark.observations[viewId] = sfmData::Observation(intrinsic.project(pose, landmark.X.homogeneous()), landmarkId, 1.0);
+                }
+                sfmData.structure[landmarkId++] = landmark;
+            }
+        }
+    }
+
+    mvsUtils::MultiViewParams cpuMp(sfmData, "", cpuFolder.string(), "", false);
+    mvsUtils::MultiViewParams gpuMp(sfmData, "", gpuFolder.string(), "", false);
+
+    estimateAndRefineDepthMapsCpu(cpuMp, {0});
+    estimateAndRefineDepthMaps(0, gpuMp, {0});
+
+    image::Image<float> cpuDepthMap;
+    image::Image<float> gpuDepthMap;
+    mvsUtils::readDepthMap(0, cpuMp, cpuDepthMap);
+    mvsUtils::readDepthMap(0, gpuMp, gpuDepthMap);
+
+    BOOST_REQUIRE_EQUAL(cpuDepthMap.Width(), gpuDepthMap.Width());
+    BOOST_REQUIRE_EQUAL(cpuDepthMap.Height(), gpuDepthMap.Height());
+
+    // same depths up to floating point differences, on the pixels valid on both sides
+    int nbValid = 0;
+    int nbConsistent = 0;
+
+    for(int y = 0; y < cpuDepthMap.Height(); ++y)
+    {
+        for(int x = 0; x < cpuDepthMap.Width(); ++x)
+        {
+            const float cpuDepth = cpuDepthMap(y, x);
+            const float gpuDepth = gpuDepthMap(y, x);
+
+            if(cpuDepth <= 0.f || gpuDepth <= 0.f)
+                continue;
+
+            ++nbValid;
+
+            if(std::abs(cpuDepth - gpuDepth) < 0.01f * gpuDepth)
+                ++nbConsistent;
+        }
+    }
+
+    BOOST_CHECK_GT(nbValid, 0);
+    BOOST_CHECK_GE(nbConsistent, 0.95 * nbValid);
+
+    boost::filesystem::remove_all(folder);
+}
+
+#endif
@@ -20,157 +20,19 @@
 namespace aliceVision {
 namespace depthMap {
 
-void writeDeviceImage(const CudaDeviceMemoryPitched<CudaRGBA, 2>& in_img_dmp, const std::string& path) 
-{
-    const CudaSize<2>& imgSize = in_img_dmp.getSize();
-    
-    // copy image from device pitched memory to host memory
-    CudaHostMemoryHeap<CudaRGBA, 2> img_hmh(imgSize);
-    img_hmh.copyFrom(in_img_dmp);
-
-    // copy image from host memory to an Image
-    image::Image<image::RGBfColor> img(imgSize.x(), imgSize.y(), true, {0.f,0.f,0.f});
-
-    for(size_t x = 0; x < imgSize.x(); ++x)
-    {
-        for(size_t y = 0; y < imgSize.y(); ++y)
-        {
-            const CudaRGBA& rgba_hmh = img_hmh(x, y);
-            image::RGBfColor& rgb = img(int(y), int(x));
-            rgb.r() = rgba_hmh.x;
-            rgb.g() = rgba_hmh.y;
-            rgb.b() = rgba_hmh.z;
-        }
-    }
-
-    // write the vector buffer
-    image::writeImage(path, img, image::ImageWriteOptions().toColorSpace(image::EImageColorSpace::NO_CONVERSION).storageDataType(image::EStorageDataType::Float));
-}
-
-void writeDeviceImage(const CudaDeviceMemoryPitched<float3, 2>& in_img_dmp, const std::string& path)
-{
-    const CudaSize<2>& imgSize = in_img_dmp.getSize();
-
-    // copy image from device pitched memory to host memory
-    CudaHostMemoryHeap<float3, 2> img_hmh(imgSize);
-    img_hmh.copyFrom(in_img_dmp);
-
-    // copy image from host memory to an Image
-    image::Image<image::RGBfColor> img(imgSize.x(), imgSize.y(), true, {0.f, 0.f, 0.f});
-
-    for(size_t x = 0; x < imgSize.x(); ++x)
-    {
-        for(size_t y = 0; y < imgSize.y(); ++y)
-        {
-            const float3& rgba_hmh = img_hmh(x, y);
-            image::RGBfColor& rgb = img(int(y), int(x));
-            rgb.r() = rgba_hmh.x;
-            rgb.g() = rgba_hmh.y;
-            rgb.b() = rgba_hmh.z;
-        }
-    }
-
-    // write the vector buffer
-    image::writeImage(path, img, image::ImageWriteOptions().toColorSpace(image::EImageColorSpace::NO_CONVERSION).storageDataType(image::EStorageDataType::Float));
-}
-
-void resetDepthSimMap(CudaHostMemoryHeap<float2, 2>& inout_depthSimMap_hmh, float depth, float sim)
-{
-  const CudaSize<2>& depthSimMapSize = inout_depthSimMap_hmh.getSize();
-
-  for(size_t x = 0; x < depthSimMapSize.x(); ++x)
-  {
-      for(size_t y = 0; y < depthSimMapSize.y(); ++y)
-      {
-          float2& depthSim_hmh = inout_depthSimMap_hmh(x, y);
-          depthSim_hmh.x = depth;
-          depthSim_hmh.y = sim;
-      }
-  }
-}
-
-void copyDepthSimMap(image::Image<float>& out_depthMap, image::Image<float>& out_simMap, const CudaHostMemoryHeap<float2, 2>& in_depthSimMap_hmh, const ROI& roi, int downscale)
-{
-    const ROI downscaledROI = downscaleROI(roi, downscale);
-    const int width  = int(downscaledROI.width());
-    const int height = int(downscaledROI.height());
-
-    // resize output vectors
-    out_depthMap.resize(width, height);
-    out_simMap.resize(width, height);
-
-    // copy image from host memory to output vectors
-    for(int x = 0; x < width; ++x)
-    {
-        for(int y = 0; y < height; ++y)
-        {
-            const float2& depthSim = in_depthSimMap_hmh(x, y);
-            out_depthMap(y, x) = depthSim.x;
-            out_simMap(y, x) = depthSim.y;
-        }
-    }
-}
-
-void copyDepthSimMap(image::Image<float>& out_depthMap, image::Image<float>& out_simMap, const CudaDeviceMemoryPitched<float2, 2>& in_depthSimMap_dmp, const ROI& roi, int downscale)
-{
-    // copy depth/sim maps from device pitched memory to host memory
-    CudaHostMemoryHeap<float2, 2> depthSimMap_hmh(in_depthSimMap_dmp.getSize());
-    depthSimMap_hmh.copyFrom(in_depthSimMap_dmp);
-
-    copyDepthSimMap(out_depthMap, out_simMap, depthSimMap_hmh, roi, downscale);
-}
-
-void writeDepthSimMap(int rc,
-                      const mvsUtils::MultiViewParams& mp,
-                      const mvsUtils::TileParams& tileParams,
-                      const ROI& roi, 
-                      const CudaHostMemoryHeap<float2, 2>& in_depthSimMap_hmh,
-                      int scale,
-                      int step,
-                      const std::string& customSuffix)
-{
-    const int scaleStep = scale * step;
-
-    image::Image<float> depthMap;
-    image::Image<float> simMap;
-
-    copyDepthSimMap(depthMap, simMap, in_depthSimMap_hmh, roi, scaleStep);
-
-    mvsUtils::writeDepthSimMap(rc, mp, tileParams, roi, depthMap, simMap, scale, step, customSuffix);
-}
-
-void writeDepthSimMap(int rc,
-                      const mvsUtils::MultiViewParams& mp,
-                      const mvsUtils::TileParams& tileParams,
-                      const ROI& roi, 
-                      const CudaDeviceMemoryPitched<float2, 2>& in_depthSimMap_dmp,
-                      int scale,
-                      int step,
-                      const std::string& customSuffix)
-{
-    const int scaleStep = scale * step;
-
-    image::Image<float> depthMap;
-    image::Image<float> simMap;
-
-    copyDepthSimMap(depthMap, simMap, in_depthSimMap_dmp, roi, scaleStep);
-
-    mvsUtils::writeDepthSimMap(rc, mp, tileParams, roi, depthMap, simMap, scale, step, customSuffix);
-}
-
 void writeDepthSimMapFromTileList(int rc,
                                   const mvsUtils::MultiViewParams& mp,
                                   const mvsUtils::TileParams& tileParams,
                                   const std::vector<ROI>& tileRoiList,
-                                  const std::vector<CudaHostMemoryHeap<float2, 2>>& in_depthSimMapTiles_hmh,
+                                  const std::vector<CpuDepthSimMap>& in_depthSimMapTiles,
                                   int scale,
                                   int step,
                                   const std::string& customSuffix)
 {
   ALICEVISION_LOG_TRACE("Merge and write depth/similarity map tiles (rc: " << rc << ", view id: " << mp.getViewId(rc) << ").");
-  
+
   const ROI imageRoi(Range(0, mp.getWidth(rc)), Range(0, mp.getHeight(rc)));
-  
+
   const int scaleStep = scale * step;
   const int width  = divideRoundUp(mp.getWidth(rc),  scaleStep);
   const int height = divideRoundUp(mp.getHeight(rc), scaleStep);
@@ -185,11 +47,9 @@ void writeDepthSimMapFromTileList(int rc,
     if(roi.isEmpty())
         continue;
 
-    image::Image<float> tileDepthMap;
-    image::Image<float> tileSimMap;
-
-    // copy tile depth/sim map from host memory
-    copyDepthSimMap(tileDepthMap, tileSimMap, in_depthSimMapTiles_hmh.at(i), roi, scaleStep);
+    // copy tile depth/sim map, tile borders are weighted in place
+    image::Image<float> tileDepthMap = in_depthSimMapTiles.at(i).depthMap;
+    image::Image<float> tileSimMap = in_depthSimMapTiles.at(i).simMap;
 
     // add tile maps to the full-size maps with weighting
     addTileMapWeighted(rc, mp, tileParams, roi, scaleStep, tileDepthMap, depthMap);
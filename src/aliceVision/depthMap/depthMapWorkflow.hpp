@@ -0,0 +1,57 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2021 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/mvsData/ROI.hpp>
+#include <aliceVision/depthMap/DepthMapParams.hpp>
+#include <aliceVision/depthMap/Tile.hpp>
+
+#include <vector>
+
+namespace aliceVision {
+
+// MultiViewParams forward declaration
+namespace mvsUtils { class MultiViewParams; }
+
+namespace depthMap {
+
+/*
+ * Depth map workflow steps shared by the CUDA and the CPU backends.
+ */
+
+/**
+ * @brief Get the depth map parameters from the MultiViewParams user parameters.
+ * @param[in] mp the multi-view parameters
+ * @param[in,out] depthMapParams the depth map parameters
+ */
+void getDepthMapParams(const mvsUtils::MultiViewParams& mp, DepthMapParams& depthMapParams);
+
+/**
+ * @brief Initialize the depth map parameters and compute the tile ROI list.
+ * @note SGM scale and step are computed if not given, parameters are adjusted for a single tile computation.
+ * @param[in] mp the multi-view parameters
+ * @param[out] depthMapParams the depth map parameters
+ * @param[out] tileRoiList the 2d region of interest of each tile
+ */
+void initDepthMapParamsAndTileRoiList(const mvsUtils::MultiViewParams& mp, DepthMapParams& depthMapParams, std::vector<ROI>& tileRoiList);
+
+/**
+ * @brief Build the tile list of the given R cameras, with the T cameras of each tile.
+ * @param[in] mp the multi-view parameters
+ * @param[in] depthMapParams the depth map parameters
+ * @param[in] cams the R camera index list
+ * @param[in] tileRoiList the 2d region of interest of each tile
+ * @param[out] tiles the tile list, ordered by R camera
+ */
+void buildTileList(const mvsUtils::MultiViewParams& mp,
+                   const DepthMapParams& depthMapParams,
+                   const std::vector<int>& cams,
+                   const std::vector<ROI>& tileRoiList,
+                   std::vector<Tile>& tiles);
+
+} // namespace depthMap
+} // namespace aliceVision
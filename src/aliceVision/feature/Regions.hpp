@@ -12,6 +12,7 @@
 #include <aliceVision/feature/PointFeature.hpp>
 #include <aliceVision/feature/Descriptor.hpp>
 #include <aliceVision/feature/metric.hpp>
+#include <aliceVision/feature/RegionsFile.hpp>
 
 #include <string>
 #include <cstddef>
@@ -22,6 +23,36 @@
 namespace aliceVision {
 namespace feature {
 
+/**
+ * @brief Read-only view of a contiguous array of descriptors.
+ * @note The view does not own the descriptors: it is invalidated when the regions are modified or destroyed.
+ */
+template<typename DescriptorT>
+class DescriptorsView
+{
+public:
+  typedef DescriptorT value_type;
+  typedef const DescriptorT* const_iterator;
+
+  DescriptorsView(const DescriptorT* data, std::size_t size)
+    : _data(data)
+    , _size(size)
+  {}
+
+  const DescriptorT* data() const { return _data; }
+  std::size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  const_iterator begin() const { return _data; }
+  const_iterator end() const { return _data + _size; }
+
+  const DescriptorT& operator[](std::size_t i) const { return _data[i]; }
+
+private:
+  const DescriptorT* _data;
+  std::size_t _size;
+};
+
 /**
  * @brief Store a featureIndex and the associated point3dId
  */
@@ -93,6 +124,23 @@ public:
 
   virtual void SaveDesc(const std::string& sfileNameDescs) const = 0;
 
+  //--
+  // IO - one binary regions container for both features and descriptors
+  //--
+
+  /**
+   * @brief Load regions from a binary regions container.
+   *        Descriptors are not copied: they are read in place from the file mapping.
+   * @param[in] sfileNameRegions the regions container file (usually .regions)
+   */
+  virtual void LoadContainer(const std::string& sfileNameRegions) = 0;
+
+  /**
+   * @brief Export regions features and descriptors into a binary regions container.
+   * @param[in] sfileNameRegions the regions container file (usually .regions)
+   */
+  virtual void SaveContainer(const std::string& sfileNameRegions) const = 0;
+
   //--
   //- Basic description of a descriptor [Type, Length]
   //--
@@ -103,13 +151,6 @@ public:
   virtual std::string Type_id() const = 0;
   virtual std::size_t DescriptorLength() const = 0;
 
-  /**
-   * @brief Return a blind pointer to the container of the descriptors array.
-   *
-   * @note: Descriptors are always stored as an std::vector<DescType>.
-   */
-  virtual const void* blindDescriptors() const = 0;
-
   /**
    * @brief Return a pointer to the first value of the descriptor array.
    *
@@ -171,9 +212,37 @@ public:
   typedef Descriptor<T, L> DescriptorT;
   /// Container for multiple regions description
   typedef std::vector<DescriptorT> DescsT;
+  /// Read-only view of the regions description
+  typedef DescriptorsView<DescriptorT> DescsViewT;
 
 protected:
-  std::vector<DescriptorT> _vec_descs; // region descriptions
+  /// region descriptions (empty while the descriptors are read from a regions container mapping)
+  std::vector<DescriptorT> _vec_descs;
+  /// regions container mapping (if loaded with LoadContainer)
+  std::shared_ptr<const MappedRegionsFile> _mappedFile;
+  /// region descriptions stored in the regions container mapping
+  const DescriptorT* _mappedDescs = nullptr;
+
+  /**
+   * @brief Release the regions container mapping.
+   */
+  void releaseMapping()
+  {
+    _mappedFile.reset();
+    _mappedDescs = nullptr;
+  }
+
+  /// Return a pointer to the first descriptor, from the mapping if available.
+  inline const DescriptorT* descriptorsData() const
+  {
+    return (_mappedDescs != nullptr) ? _mappedDescs : _vec_descs.data();
+  }
+
+  /// Return the number of available descriptors
+  inline std::size_t descriptorsCount() const
+  {
+    return (_mappedDescs != nullptr) ? _mappedFile->getRegionCount() : _vec_descs.size();
+  }
 
 public:
   std::string Type_id() const override {return typeid(T).name();}
@@ -192,6 +261,7 @@ public:
     const std::string& sfileNameFeats,
     const std::string& sfileNameDescs) override
   {
+    releaseMapping();
     loadFeatsFromFile(sfileNameFeats, this->_vec_feats);
     loadDescsFromBinFile(sfileNameDescs, _vec_descs);
   }
@@ -201,41 +271,87 @@ public:
     const std::string& sfileNameFeats,
     const std::string& sfileNameDescs) const override
   {
+    const DescsViewT descriptors = Descriptors();
     saveFeatsToFile(sfileNameFeats, this->_vec_feats);
-    saveDescsToBinFile(sfileNameDescs, _vec_descs);
+    saveDescsToBinFile(sfileNameDescs, descriptors);
   }
 
   void SaveDesc(const std::string& sfileNameDescs) const override
   {
-    saveDescsToBinFile(sfileNameDescs, _vec_descs);
+    const DescsViewT descriptors = Descriptors();
+    saveDescsToBinFile(sfileNameDescs, descriptors);
   }
 
-  /// Mutable and non-mutable DescriptorT getters.
-  inline std::vector<DescriptorT> & Descriptors() { return _vec_descs; }
-  inline const std::vector<DescriptorT> & Descriptors() const { return _vec_descs; }
+  /// Map a binary regions container, descriptors are used in place.
+  void LoadContainer(const std::string& sfileNameRegions) override
+  {
+    std::shared_ptr<const MappedRegionsFile> mappedFile = std::make_shared<const MappedRegionsFile>(sfileNameRegions);
+    mappedFile->checkDescriptorType(sizeof(T), L, regionType == ERegionType::Binary);
+    mappedFile->getFeatures(this->_vec_feats);
+
+    _vec_descs.clear();
+    _vec_descs.shrink_to_fit();
+    _mappedFile = mappedFile;
+    _mappedDescs = reinterpret_cast<const DescriptorT*>(mappedFile->getRawDescriptors());
+  }
 
-  inline const void* blindDescriptors() const override { return &_vec_descs; }
+  /// Export features and descriptors in one binary regions container.
+  void SaveContainer(const std::string& sfileNameRegions) const override
+  {
+    assert(descriptorsCount() == this->_vec_feats.size());
+    saveRegionsFile(sfileNameRegions, this->_vec_feats, descriptorsData(), sizeof(T), L, regionType == ERegionType::Binary);
+  }
 
-  inline const void* DescriptorRawData() const override { return &_vec_descs[0];}
+  /**
+   * @brief Mutable DescriptorT getter.
+   * @note If the regions have been loaded from a regions container, the descriptors are copied
+   *       from the file mapping and the mapping is released.
+   */
+  inline std::vector<DescriptorT> & Descriptors()
+  {
+    if(_mappedDescs != nullptr)
+    {
+      _vec_descs.assign(_mappedDescs, _mappedDescs + _mappedFile->getRegionCount());
+      releaseMapping();
+    }
+    return _vec_descs;
+  }
 
-  inline void clearDescriptors() override { _vec_descs.clear(); }
+  /**
+   * @brief Non-mutable DescriptorT getter.
+   * @note The descriptors are read in place, from the regions container mapping if any.
+   */
+  inline DescsViewT Descriptors() const
+  {
+    return DescsViewT(descriptorsData(), descriptorsCount());
+  }
+
+  inline const void* DescriptorRawData() const override { return descriptorsData(); }
+
+  inline void clearDescriptors() override
+  {
+    releaseMapping();
+    _vec_descs.clear();
+  }
 
   inline void swap(This& other)
   {
     this->_vec_feats.swap(other._vec_feats);
     _vec_descs.swap(other._vec_descs);
+    _mappedFile.swap(other._mappedFile);
+    std::swap(_mappedDescs, other._mappedDescs);
   }
 
   // Return the distance between two descriptors
   double SquaredDescriptorDistance(std::size_t i, const Regions * genericRegions, std::size_t j) const override
   {
-    assert(i < this->_vec_descs.size());
+    assert(i < descriptorsCount());
     assert(genericRegions);
     assert(j < genericRegions->RegionCount());
 
     const This * regionsT = dynamic_cast<const This*>(genericRegions);
     static typename SquaredMetric<T, regionType>::Metric metric;
-    return metric(this->_vec_descs[i].getData(), regionsT->_vec_descs[j].getData(), DescriptorT::static_size);
+    return metric(descriptorsData()[i].getData(), regionsT->descriptorsData()[j].getData(), DescriptorT::static_size);
   }
 
   /**
@@ -245,9 +361,9 @@ public:
    */
   void CopyRegion(std::size_t i, Regions * outRegionContainer) const override
   {
-    assert(i < this->_vec_feats.size() && i < this->_vec_descs.size());
+    assert(i < this->_vec_feats.size() && i < descriptorsCount());
     static_cast<This*>(outRegionContainer)->_vec_feats.push_back(this->_vec_feats[i]);
-    static_cast<This*>(outRegionContainer)->_vec_descs.push_back(this->_vec_descs[i]);
+    static_cast<This*>(outRegionContainer)->Descriptors().push_back(descriptorsData()[i]);
   }
 
   /**
@@ -273,7 +389,7 @@ public:
     {
       const FeatureInImage & feat = featuresInImage[i];
       regionsPtr->Features().push_back(this->_vec_feats[feat._featureIndex]);
-      regionsPtr->Descriptors().push_back(this->_vec_descs[feat._featureIndex]);
+      regionsPtr->Descriptors().push_back(descriptorsData()[feat._featureIndex]);
 
       // This assert should be valid in theory, but in the context of CameraLocalization
       // we can have the same 2D feature associated to different 3D points (2 in practice).
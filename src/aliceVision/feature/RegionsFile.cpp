@@ -0,0 +1,198 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "RegionsFile.hpp"
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace aliceVision {
+namespace feature {
+
+namespace {
+
+const char regionsFileMagic[8] = {'A', 'V', 'R', 'E', 'G', 'I', 'O', 'N'};
+
+inline std::uint64_t alignOffset(std::uint64_t offset)
+{
+  return (offset + REGIONS_FILE_ALIGNMENT - 1) / REGIONS_FILE_ALIGNMENT * REGIONS_FILE_ALIGNMENT;
+}
+
+/**
+ * @brief Compute a * b
+ * @return false if the product overflows
+ */
+inline bool checkedMultiply(std::uint64_t a, std::uint64_t b, std::uint64_t& out)
+{
+  if(a != 0 && b > std::numeric_limits<std::uint64_t>::max() / a)
+    return false;
+  out = a * b;
+  return true;
+}
+
+/**
+ * @brief Compute a + b
+ * @return false if the sum overflows
+ */
+inline bool checkedAdd(std::uint64_t a, std::uint64_t b, std::uint64_t& out)
+{
+  if(b > std::numeric_limits<std::uint64_t>::max() - a)
+    return false;
+  out = a + b;
+  return true;
+}
+
+} // namespace
+
+MappedRegionsFile::MappedRegionsFile(const std::string& filename)
+  : _filename(filename)
+{
+  try
+  {
+    // the mapping stays valid once the file is closed
+    const boost::interprocess::file_mapping file(filename.c_str(), boost::interprocess::read_only);
+    _region = boost::interprocess::mapped_region(file, boost::interprocess::read_only);
+  }
+  catch(const boost::interprocess::interprocess_exception& e)
+  {
+    throw std::runtime_error("Can't load regions file, can't map '" + filename + "' : " + e.what());
+  }
+
+  if(_region.get_size() < sizeof(RegionsFileHeader))
+    throw std::runtime_error("Can't load regions file, '" + filename + "' is too small.");
+
+  _header = static_cast<const RegionsFileHeader*>(_region.get_address());
+
+  if(std::memcmp(_header->magic, regionsFileMagic, sizeof(regionsFileMagic)) != 0)
+    throw std::runtime_error("Can't load regions file, '" + filename + "' is not a regions file.");
+
+  if(_header->version != REGIONS_FILE_VERSION)
+    throw std::runtime_error("Can't load regions file, '" + filename + "' has an unsupported version (" +
+                             std::to_string(_header->version) + ").");
+
+  // sizes come from the file: check every product and sum for overflow before comparing with the file size
+  const std::uint64_t fileSize = _region.get_size();
+  std::uint64_t featuresSize = 0;
+  std::uint64_t featuresEnd = 0;
+  std::uint64_t descriptorSize = 0;
+  std::uint64_t descriptorsSize = 0;
+  std::uint64_t descriptorsEnd = 0;
+
+  if(_header->fileSize != fileSize ||
+     _header->headerSize != sizeof(RegionsFileHeader) ||
+     _header->featuresOffset < sizeof(RegionsFileHeader) ||
+     _header->featuresOffset % REGIONS_FILE_ALIGNMENT != 0 ||
+     _header->descriptorsOffset % REGIONS_FILE_ALIGNMENT != 0 ||
+     !checkedMultiply(_header->regionCount, 4 * sizeof(float), featuresSize) ||
+     !checkedAdd(_header->featuresOffset, featuresSize, featuresEnd) ||
+     featuresEnd > _header->descriptorsOffset ||
+     !checkedMultiply(_header->descriptorLength, _header->descriptorBinSize, descriptorSize) ||
+     !checkedMultiply(_header->regionCount, descriptorSize, descriptorsSize) ||
+     !checkedAdd(_header->descriptorsOffset, descriptorsSize, descriptorsEnd) ||
+     descriptorsEnd > fileSize)
+    throw std::runtime_error("Can't load regions file, '" + filename + "' is incorrect !");
+}
+
+void MappedRegionsFile::checkDescriptorType(std::size_t descriptorBinSize, std::size_t descriptorLength, bool isBinary) const
+{
+  if(_header->descriptorBinSize != descriptorBinSize ||
+     _header->descriptorLength != descriptorLength ||
+     (_header->isBinary != 0) != isBinary)
+  {
+    throw std::runtime_error("Can't load regions file, '" + _filename + "' contains descriptors of length " +
+                             std::to_string(_header->descriptorLength) + " x " + std::to_string(_header->descriptorBinSize) +
+                             " bytes, expected " + std::to_string(descriptorLength) + " x " + std::to_string(descriptorBinSize) + " bytes.");
+  }
+}
+
+const float* MappedRegionsFile::getRawFeatures() const
+{
+  return reinterpret_cast<const float*>(static_cast<const char*>(_region.get_address()) + _header->featuresOffset);
+}
+
+const void* MappedRegionsFile::getRawDescriptors() const
+{
+  return static_cast<const char*>(_region.get_address()) + _header->descriptorsOffset;
+}
+
+void MappedRegionsFile::getFeatures(std::vector<PointFeature>& features) const
+{
+  const std::size_t regionCount = getRegionCount();
+  const float* rawFeatures = getRawFeatures();
+
+  features.clear();
+  features.reserve(regionCount);
+
+  for(std::size_t i = 0; i < regionCount; ++i)
+  {
+    const float* f = rawFeatures + 4 * i;
+    features.emplace_back(f[0], f[1], f[2], f[3]);
+  }
+}
+
+void saveRegionsFile(const std::string& filename,
+                     const std::vector<PointFeature>& features,
+                     const void* descriptors,
+                     std::size_t descriptorBinSize,
+                     std::size_t descriptorLength,
+                     bool isBinary)
+{
+  RegionsFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, regionsFileMagic, sizeof(regionsFileMagic));
+  header.version = REGIONS_FILE_VERSION;
+  header.headerSize = sizeof(RegionsFileHeader);
+  header.descriptorBinSize = static_cast<std::uint32_t>(descriptorBinSize);
+  header.descriptorLength = static_cast<std::uint32_t>(descriptorLength);
+  header.isBinary = isBinary ? 1 : 0;
+  header.regionCount = features.size();
+  header.featuresOffset = alignOffset(sizeof(RegionsFileHeader));
+
+  const std::uint64_t featuresSize = header.regionCount * 4 * sizeof(float);
+  const std::uint64_t descriptorsSize = header.regionCount * descriptorLength * descriptorBinSize;
+
+  header.descriptorsOffset = alignOffset(header.featuresOffset + featuresSize);
+  header.fileSize = header.descriptorsOffset + descriptorsSize;
+
+  std::ofstream file(filename, std::ios::out | std::ios::binary);
+
+  if(!file.is_open())
+    throw std::runtime_error("Can't save regions file, can't open '" + filename + "' !");
+
+  const char padding[REGIONS_FILE_ALIGNMENT] = {0};
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(padding, header.featuresOffset - sizeof(header));
+
+  std::vector<float> rawFeatures;
+  rawFeatures.reserve(features.size() * 4);
+  for(const PointFeature& feat : features)
+  {
+    rawFeatures.push_back(feat.x());
+    rawFeatures.push_back(feat.y());
+    rawFeatures.push_back(feat.scale());
+    rawFeatures.push_back(feat.orientation());
+  }
+
+  file.write(reinterpret_cast<const char*>(rawFeatures.data()), featuresSize);
+  file.write(padding, header.descriptorsOffset - header.featuresOffset - featuresSize);
+
+  if(descriptorsSize > 0)
+    file.write(static_cast<const char*>(descriptors), descriptorsSize);
+
+  if(!file.good())
+    throw std::runtime_error("Can't save regions file, '" + filename + "' is incorrect !");
+
+  file.close();
+}
+
+} // namespace feature
+} // namespace aliceVision
@@ -0,0 +1,120 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/feature/PointFeature.hpp>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace aliceVision {
+namespace feature {
+
+/// Extension of the binary regions container (features + descriptors in one file)
+constexpr const char* REGIONS_FILE_EXTENSION = ".regions";
+
+/// Current version of the binary regions container
+constexpr std::uint32_t REGIONS_FILE_VERSION = 1;
+
+/// Alignment (in bytes) of each section of the binary regions container
+constexpr std::size_t REGIONS_FILE_ALIGNMENT = 64;
+
+/**
+ * @brief Header of the binary regions container.
+ *
+ * File layout: [header][features][descriptors]
+ * - features: regionCount x 4 float32 (x, y, scale, orientation)
+ * - descriptors: regionCount x descriptorLength x descriptorBinSize bytes
+ *
+ * Each section starts on a REGIONS_FILE_ALIGNMENT boundary, so a memory mapping
+ * of the file can be used in place. Values are stored in little-endian.
+ */
+struct RegionsFileHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t headerSize;
+  std::uint32_t descriptorBinSize;
+  std::uint32_t descriptorLength;
+  std::uint32_t isBinary;
+  std::uint32_t reserved;
+  std::uint64_t regionCount;
+  std::uint64_t featuresOffset;
+  std::uint64_t descriptorsOffset;
+  std::uint64_t fileSize;
+};
+
+static_assert(sizeof(RegionsFileHeader) == REGIONS_FILE_ALIGNMENT, "RegionsFileHeader should fill exactly one aligned block.");
+
+/**
+ * @brief Read-only memory mapping of a binary regions container.
+ *        Features and descriptors are accessed in place, without parsing.
+ */
+class MappedRegionsFile
+{
+public:
+  /**
+   * @brief Map the given regions container file
+   * @note The file handle is only held while the mapping is created.
+   * @param[in] filename the regions container file path
+   * @throw std::runtime_error if the file cannot be mapped or is invalid
+   */
+  explicit MappedRegionsFile(const std::string& filename);
+
+  const std::string& getFilename() const { return _filename; }
+
+  const RegionsFileHeader& getHeader() const { return *_header; }
+
+  std::size_t getRegionCount() const { return static_cast<std::size_t>(_header->regionCount); }
+
+  /**
+   * @brief Check that the stored descriptors match the given descriptor type
+   * @throw std::runtime_error if the descriptor type is not the expected one
+   */
+  void checkDescriptorType(std::size_t descriptorBinSize, std::size_t descriptorLength, bool isBinary) const;
+
+  /// Return a pointer to the features section (4 floats per region)
+  const float* getRawFeatures() const;
+
+  /// Return a pointer to the descriptors section
+  const void* getRawDescriptors() const;
+
+  /**
+   * @brief Copy the features section into a vector of PointFeature
+   * @param[out] features the output features
+   */
+  void getFeatures(std::vector<PointFeature>& features) const;
+
+private:
+  std::string _filename;
+  boost::interprocess::mapped_region _region;
+  const RegionsFileHeader* _header = nullptr;
+};
+
+/**
+ * @brief Write a binary regions container
+ * @param[in] filename the output file path
+ * @param[in] features the region features
+ * @param[in] descriptors pointer to the flat array of descriptors (features.size() descriptors)
+ * @param[in] descriptorBinSize size in bytes of one descriptor bin
+ * @param[in] descriptorLength number of bins of one descriptor
+ * @param[in] isBinary true if the descriptor is a binary descriptor
+ * @throw std::runtime_error if the file cannot be written
+ */
+void saveRegionsFile(const std::string& filename,
+                     const std::vector<PointFeature>& features,
+                     const void* descriptors,
+                     std::size_t descriptorBinSize,
+                     std::size_t descriptorLength,
+                     bool isBinary);
+
+} // namespace feature
+} // namespace aliceVision
@@ -10,6 +10,7 @@
 #include <iostream>
 #include <fstream>
 #include <iterator>
+#include <limits>
 #include <vector>
 
 #define BOOST_TEST_MODULE Feature
@@ -121,3 +122,71 @@ BOOST_AUTO_TEST_CASE(descriptorIO_BINARY) {
       BOOST_CHECK_EQUAL(vec_descs[i][j], vec_descs_read[i][j]);
   }
 }
+
+//Test conversion between .feat/.desc files and the binary regions container
+BOOST_AUTO_TEST_CASE(regionsIO_CONTAINER) {
+  typedef ScalarRegions<unsigned char, DESC_LENGTH> Regions_T;
+
+  Regions_T regions;
+  for(int i = 0; i < CARD; ++i)
+  {
+    regions.Features().push_back(Feature_T(i, i*2, i*3, i*4));
+    Regions_T::DescriptorT desc;
+    for (int j = 0; j < DESC_LENGTH; ++j)
+      desc[j] = (i*DESC_LENGTH+j) % 256;
+    regions.Descriptors().push_back(desc);
+  }
+
+  // .feat/.desc -> container
+  BOOST_CHECK_NO_THROW(regions.Save("tempRegions.feat", "tempRegions.desc"));
+  Regions_T regionsFromFiles;
+  BOOST_CHECK_NO_THROW(regionsFromFiles.Load("tempRegions.feat", "tempRegions.desc"));
+  BOOST_CHECK_NO_THROW(regionsFromFiles.SaveContainer("tempRegions.regions"));
+
+  // mapped container
+  Regions_T regionsMapped;
+  BOOST_CHECK_NO_THROW(regionsMapped.LoadContainer("tempRegions.regions"));
+  BOOST_CHECK_EQUAL(CARD, regionsMapped.RegionCount());
+
+  const unsigned char* rawDescs = reinterpret_cast<const unsigned char*>(regionsMapped.DescriptorRawData());
+  for(int i = 0; i < CARD; ++i)
+  {
+    BOOST_CHECK_EQUAL(regions.Features()[i], regionsMapped.Features()[i]);
+    for (int j = 0; j < DESC_LENGTH; ++j)
+      BOOST_CHECK_EQUAL(regions.Descriptors()[i][j], rawDescs[i*DESC_LENGTH+j]);
+    BOOST_CHECK_EQUAL(regionsMapped.SquaredDescriptorDistance(i, &regions, i), 0.0);
+  }
+
+  // the const getter reads the descriptors in place
+  const Regions_T& regionsMappedConst = regionsMapped;
+  BOOST_CHECK_EQUAL(regionsMappedConst.Descriptors().size(), CARD);
+  BOOST_CHECK(regionsMappedConst.Descriptors().data() == regionsMapped.DescriptorRawData());
+
+  // container -> .feat/.desc
+  BOOST_CHECK_NO_THROW(regionsMapped.Save("tempRegionsBack.feat", "tempRegionsBack.desc"));
+  Regions_T regionsBack;
+  BOOST_CHECK_NO_THROW(regionsBack.Load("tempRegionsBack.feat", "tempRegionsBack.desc"));
+  BOOST_CHECK_EQUAL(CARD, regionsBack.RegionCount());
+  for(int i = 0; i < CARD; ++i)
+  {
+    BOOST_CHECK_EQUAL(regions.Features()[i], regionsBack.Features()[i]);
+    BOOST_CHECK(regions.Descriptors()[i] == regionsBack.Descriptors()[i]);
+  }
+
+  // descriptor type mismatch
+  ScalarRegions<float, DESC_LENGTH> floatRegions;
+  BOOST_CHECK_THROW(floatRegions.LoadContainer("tempRegions.regions"), std::exception);
+  BOOST_CHECK_THROW(floatRegions.LoadContainer("tempRegions.feat"), std::exception);
+
+  // region count overflowing the section sizes
+  {
+    std::fstream file("tempRegions.regions", std::ios::in | std::ios::out | std::ios::binary);
+    RegionsFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    header.regionCount = std::numeric_limits<std::uint64_t>::max() / 4 + 1;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  Regions_T regionsOverflow;
+  BOOST_CHECK_THROW(regionsOverflow.LoadContainer("tempRegions.regions"), std::exception);
+}
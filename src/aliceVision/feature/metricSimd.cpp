@@ -0,0 +1,578 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "metricSimd.hpp"
+
+#include <aliceVision/alicevision_omp.hpp>
+#include <aliceVision/system/Logger.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ALICEVISION_METRIC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ALICEVISION_METRIC_NEON
+#include <arm_neon.h>
+#endif
+
+// Kernels for a given instruction set are compiled with a function-level target attribute,
+// the whole library does not need to be built for this instruction set.
+#if defined(__GNUC__) || defined(__clang__)
+#define ALICEVISION_TARGET_AVX2 __attribute__((target("avx2,fma,popcnt")))
+#define ALICEVISION_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma,popcnt")))
+#define ALICEVISION_TARGET_AVX512_POPCNT __attribute__((target("avx512f,avx512bw,avx512vpopcntdq,avx2,fma,popcnt")))
+#else
+#define ALICEVISION_TARGET_AVX2
+#define ALICEVISION_TARGET_AVX512
+#define ALICEVISION_TARGET_AVX512_POPCNT
+#endif
+
+namespace aliceVision {
+namespace feature {
+
+std::string EInstructionSet_enumToString(EInstructionSet instructionSet)
+{
+  switch(instructionSet)
+  {
+    case EInstructionSet::SCALAR: return "scalar";
+    case EInstructionSet::AVX2:   return "avx2";
+    case EInstructionSet::AVX512: return "avx512";
+    case EInstructionSet::NEON:   return "neon";
+  }
+  throw std::out_of_range("Invalid instruction set enum");
+}
+
+namespace {
+
+//--
+// Scalar kernels
+//--
+
+inline int squaredL2UcharScalar(const unsigned char* a, const unsigned char* b, std::size_t size)
+{
+  int result = 0;
+  for(std::size_t i = 0; i < size; ++i)
+  {
+    const int diff = int(a[i]) - int(b[i]);
+    result += diff * diff;
+  }
+  return result;
+}
+
+inline float squaredL2FloatScalar(const float* a, const float* b, std::size_t size)
+{
+  float result = 0.f;
+  for(std::size_t i = 0; i < size; ++i)
+  {
+    const float diff = a[i] - b[i];
+    result += diff * diff;
+  }
+  return result;
+}
+
+inline unsigned int hammingScalar(const unsigned char* a, const unsigned char* b, std::size_t nbBytes)
+{
+  const Hamming<unsigned char> metric;
+  return metric(a, b, nbBytes);
+}
+
+#ifdef ALICEVISION_METRIC_X86
+
+//--
+// AVX2 kernels
+//--
+
+ALICEVISION_TARGET_AVX2
+inline int horizontalSumAvx2(__m256i v)
+{
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+}
+
+ALICEVISION_TARGET_AVX2
+inline int squaredL2UcharAvx2(const unsigned char* a, const unsigned char* b, std::size_t size)
+{
+  __m256i acc = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for(; i + 16 <= size; i += 16)
+  {
+    const __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    const __m256i diff = _mm256_sub_epi16(va, vb);
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(diff, diff));
+  }
+  return horizontalSumAvx2(acc) + squaredL2UcharScalar(a + i, b + i, size - i);
+}
+
+ALICEVISION_TARGET_AVX2
+inline float squaredL2FloatAvx2(const float* a, const float* b, std::size_t size)
+{
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  std::size_t i = 0;
+  for(; i + 16 <= size; i += 16)
+  {
+    const __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    const __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+    acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+    acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+  }
+  for(; i + 8 <= size; i += 8)
+  {
+    const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    acc0 = _mm256_fmadd_ps(diff, diff, acc0);
+  }
+  const __m256 acc = _mm256_add_ps(acc0, acc1);
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+  return _mm_cvtss_f32(sum) + squaredL2FloatScalar(a + i, b + i, size - i);
+}
+
+ALICEVISION_TARGET_AVX2
+inline unsigned int hammingAvx2(const unsigned char* a, const unsigned char* b, std::size_t nbBytes)
+{
+  // popcount of each nibble with a lookup table, summed per 64 bits with sad
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i lowMask = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for(; i + 32 <= nbBytes; i += 32)
+  {
+    const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    const __m256i lo = _mm256_and_si256(x, lowMask);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), lowMask);
+    const __m256i count = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(count, _mm256_setzero_si256()));
+  }
+  const unsigned int result = static_cast<unsigned int>(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                                                        _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+  return result + hammingScalar(a + i, b + i, nbBytes - i);
+}
+
+//--
+// AVX-512 kernels
+//--
+
+ALICEVISION_TARGET_AVX512
+inline int squaredL2UcharAvx512(const unsigned char* a, const unsigned char* b, std::size_t size)
+{
+  __m512i acc = _mm512_setzero_si512();
+  std::size_t i = 0;
+  for(; i + 32 <= size; i += 32)
+  {
+    const __m512i va = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+    const __m512i vb = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    const __m512i diff = _mm512_sub_epi16(va, vb);
+    acc = _mm512_add_epi32(acc, _mm512_madd_epi16(diff, diff));
+  }
+  return _mm512_reduce_add_epi32(acc) + squaredL2UcharScalar(a + i, b + i, size - i);
+}
+
+ALICEVISION_TARGET_AVX512
+inline float squaredL2FloatAvx512(const float* a, const float* b, std::size_t size)
+{
+  __m512 acc = _mm512_setzero_ps();
+  std::size_t i = 0;
+  for(; i + 16 <= size; i += 16)
+  {
+    const __m512 diff = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+    acc = _mm512_fmadd_ps(diff, diff, acc);
+  }
+  if(i < size)
+  {
+    const __mmask16 mask = static_cast<__mmask16>((1u << (size - i)) - 1u);
+    const __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+    acc = _mm512_fmadd_ps(diff, diff, acc);
+  }
+  return _mm512_reduce_add_ps(acc);
+}
+
+ALICEVISION_TARGET_AVX512_POPCNT
+inline unsigned int hammingAvx512(const unsigned char* a, const unsigned char* b, std::size_t nbBytes)
+{
+  __m512i acc = _mm512_setzero_si512();
+  std::size_t i = 0;
+  for(; i + 64 <= nbBytes; i += 64)
+  {
+    const __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+  }
+  if(i < nbBytes)
+  {
+    const __mmask64 mask = (nbBytes - i == 64) ? ~__mmask64(0) : ((__mmask64(1) << (nbBytes - i)) - 1);
+    const __m512i x = _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, a + i), _mm512_maskz_loadu_epi8(mask, b + i));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+  }
+  return static_cast<unsigned int>(_mm512_reduce_add_epi64(acc));
+}
+
+#endif // ALICEVISION_METRIC_X86
+
+#ifdef ALICEVISION_METRIC_NEON
+
+//--
+// NEON kernels
+//--
+
+inline std::uint32_t horizontalSumNeon(uint32x4_t v)
+{
+  std::uint32_t lanes[4];
+  vst1q_u32(lanes, v);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+inline int squaredL2UcharNeon(const unsigned char* a, const unsigned char* b, std::size_t size)
+{
+  uint32x4_t acc = vdupq_n_u32(0);
+  std::size_t i = 0;
+  for(; i + 16 <= size; i += 16)
+  {
+    const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+    acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+  }
+  return static_cast<int>(horizontalSumNeon(acc)) + squaredL2UcharScalar(a + i, b + i, size - i);
+}
+
+inline float squaredL2FloatNeon(const float* a, const float* b, std::size_t size)
+{
+  float32x4_t acc0 = vdupq_n_f32(0.f);
+  float32x4_t acc1 = vdupq_n_f32(0.f);
+  std::size_t i = 0;
+  for(; i + 8 <= size; i += 8)
+  {
+    const float32x4_t diff0 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+    const float32x4_t diff1 = vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    acc0 = vmlaq_f32(acc0, diff0, diff0);
+    acc1 = vmlaq_f32(acc1, diff1, diff1);
+  }
+  float lanes[4];
+  vst1q_f32(lanes, vaddq_f32(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + squaredL2FloatScalar(a + i, b + i, size - i);
+}
+
+inline unsigned int hammingNeon(const unsigned char* a, const unsigned char* b, std::size_t nbBytes)
+{
+  uint32x4_t acc = vdupq_n_u32(0);
+  std::size_t i = 0;
+  for(; i + 16 <= nbBytes; i += 16)
+  {
+    const uint8x16_t count = vcntq_u8(veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+    acc = vpadalq_u16(acc, vpaddlq_u8(count));
+  }
+  return horizontalSumNeon(acc) + hammingScalar(a + i, b + i, nbBytes - i);
+}
+
+#endif // ALICEVISION_METRIC_NEON
+
+//--
+// One-to-many kernels, compiled for each instruction set so the distance kernel is inlined
+//--
+
+#define ALICEVISION_DEFINE_ONE_TO_MANY(NAME, TARGET, SCALAR, DISTANCE, KERNEL) \
+  TARGET void NAME(const SCALAR* query, const SCALAR* database, std::size_t nbDatabase, std::size_t size, DISTANCE* distances) \
+  { \
+    for(std::size_t j = 0; j < nbDatabase; ++j) \
+      distances[j] = KERNEL(query, database + j * size, size); \
+  }
+
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2UcharOneToManyScalar, , unsigned char, int, squaredL2UcharScalar)
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2FloatOneToManyScalar, , float, float, squaredL2FloatScalar)
+ALICEVISION_DEFINE_ONE_TO_MANY(hammingOneToManyScalar, , unsigned char, unsigned int, hammingScalar)
+
+#ifdef ALICEVISION_METRIC_X86
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2UcharOneToManyAvx2, ALICEVISION_TARGET_AVX2, unsigned char, int, squaredL2UcharAvx2)
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2FloatOneToManyAvx2, ALICEVISION_TARGET_AVX2, float, float, squaredL2FloatAvx2)
+ALICEVISION_DEFINE_ONE_TO_MANY(hammingOneToManyAvx2, ALICEVISION_TARGET_AVX2, unsigned char, unsigned int, hammingAvx2)
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2UcharOneToManyAvx512, ALICEVISION_TARGET_AVX512, unsigned char, int, squaredL2UcharAvx512)
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2FloatOneToManyAvx512, ALICEVISION_TARGET_AVX512, float, float, squaredL2FloatAvx512)
+ALICEVISION_DEFINE_ONE_TO_MANY(hammingOneToManyAvx512, ALICEVISION_TARGET_AVX512_POPCNT, unsigned char, unsigned int, hammingAvx512)
+#endif
+
+#ifdef ALICEVISION_METRIC_NEON
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2UcharOneToManyNeon, , unsigned char, int, squaredL2UcharNeon)
+ALICEVISION_DEFINE_ONE_TO_MANY(squaredL2FloatOneToManyNeon, , float, float, squaredL2FloatNeon)
+ALICEVISION_DEFINE_ONE_TO_MANY(hammingOneToManyNeon, , unsigned char, unsigned int, hammingNeon)
+#endif
+
+#undef ALICEVISION_DEFINE_ONE_TO_MANY
+
+/**
+ * @brief Distance kernels for one instruction set
+ */
+struct MetricKernels
+{
+  EInstructionSet instructionSet;
+  int (*squaredL2Uchar)(const unsigned char*, const unsigned char*, std::size_t);
+  float (*squaredL2Float)(const float*, const float*, std::size_t);
+  unsigned int (*hamming)(const unsigned char*, const unsigned char*, std::size_t);
+  void (*squaredL2UcharOneToMany)(const unsigned char*, const unsigned char*, std::size_t, std::size_t, int*);
+  void (*squaredL2FloatOneToMany)(const float*, const float*, std::size_t, std::size_t, float*);
+  void (*hammingOneToMany)(const unsigned char*, const unsigned char*, std::size_t, std::size_t, unsigned int*);
+};
+
+const MetricKernels scalarKernels = {
+  EInstructionSet::SCALAR,
+  squaredL2UcharScalar, squaredL2FloatScalar, hammingScalar,
+  squaredL2UcharOneToManyScalar, squaredL2FloatOneToManyScalar, hammingOneToManyScalar
+};
+
+#ifdef ALICEVISION_METRIC_X86
+const MetricKernels avx2Kernels = {
+  EInstructionSet::AVX2,
+  squaredL2UcharAvx2, squaredL2FloatAvx2, hammingAvx2,
+  squaredL2UcharOneToManyAvx2, squaredL2FloatOneToManyAvx2, hammingOneToManyAvx2
+};
+
+const MetricKernels avx512Kernels = {
+  EInstructionSet::AVX512,
+  squaredL2UcharAvx512, squaredL2FloatAvx512, hammingAvx512,
+  squaredL2UcharOneToManyAvx512, squaredL2FloatOneToManyAvx512, hammingOneToManyAvx512
+};
+
+bool cpuSupportsAvx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("popcnt");
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool fma = (info[2] & (1 << 12)) != 0;
+  const bool popcnt = (info[2] & (1 << 23)) != 0;
+  if(!osxsave || !fma || !popcnt || (_xgetbv(0) & 0x6) != 0x6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+bool cpuSupportsAvx512()
+{
+  // the hamming kernel also requires the 64-bit popcount instruction
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return cpuSupportsAvx2() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+         __builtin_cpu_supports("avx512vpopcntdq");
+#elif defined(_MSC_VER)
+  if(!cpuSupportsAvx2() || (_xgetbv(0) & 0xE6) != 0xE6)
+    return false;
+  int info[4];
+  __cpuidex(info, 7, 0);
+  const bool avx512f = (info[1] & (1 << 16)) != 0;
+  const bool avx512bw = (info[1] & (1 << 30)) != 0;
+  const bool avx512vpopcntdq = (info[2] & (1 << 14)) != 0;
+  return avx512f && avx512bw && avx512vpopcntdq;
+#else
+  return false;
+#endif
+}
+#endif // ALICEVISION_METRIC_X86
+
+#ifdef ALICEVISION_METRIC_NEON
+const MetricKernels neonKernels = {
+  EInstructionSet::NEON,
+  squaredL2UcharNeon, squaredL2FloatNeon, hammingNeon,
+  squaredL2UcharOneToManyNeon, squaredL2FloatOneToManyNeon, hammingOneToManyNeon
+};
+#endif
+
+const MetricKernels* getKernelsFor(EInstructionSet instructionSet)
+{
+  switch(instructionSet)
+  {
+    case EInstructionSet::SCALAR:
+      return &scalarKernels;
+#ifdef ALICEVISION_METRIC_X86
+    case EInstructionSet::AVX2:
+      return cpuSupportsAvx2() ? &avx2Kernels : nullptr;
+    case EInstructionSet::AVX512:
+      return cpuSupportsAvx512() ? &avx512Kernels : nullptr;
+#endif
+#ifdef ALICEVISION_METRIC_NEON
+    case EInstructionSet::NEON:
+      return &neonKernels;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+const MetricKernels* selectBestKernels()
+{
+  for(EInstructionSet instructionSet : {EInstructionSet::AVX512, EInstructionSet::AVX2, EInstructionSet::NEON})
+  {
+    const MetricKernels* kernels = getKernelsFor(instructionSet);
+    if(kernels != nullptr)
+      return kernels;
+  }
+  return &scalarKernels;
+}
+
+std::atomic<const MetricKernels*>& currentKernels()
+{
+  static std::atomic<const MetricKernels*> kernels(selectBestKernels());
+  return kernels;
+}
+
+inline const MetricKernels& kernels()
+{
+  return *currentKernels().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Brute force top-2 search.
+ *        Each thread processes a chunk of queries against blocks of the database small enough to stay in cache.
+ */
+template<typename ScalarT, typename DistanceT>
+void top2Search(void (*oneToMany)(const ScalarT*, const ScalarT*, std::size_t, std::size_t, DistanceT*),
+                const ScalarT* queries, std::size_t nbQueries,
+                const ScalarT* database, std::size_t nbDatabase,
+                std::size_t size, Top2Neighbours<DistanceT>* neighbours)
+{
+  const std::size_t databaseBlockSize = std::max<std::size_t>(16, (64 * 1024) / std::max<std::size_t>(1, size * sizeof(ScalarT)));
+  const std::size_t queryChunkSize = 64;
+  const std::ptrdiff_t nbQueryChunks = static_cast<std::ptrdiff_t>((nbQueries + queryChunkSize - 1) / queryChunkSize);
+
+  #pragma omp parallel
+  {
+    std::vector<DistanceT> distances(databaseBlockSize);
+
+    #pragma omp for schedule(dynamic)
+    for(std::ptrdiff_t chunk = 0; chunk < nbQueryChunks; ++chunk)
+    {
+      const std::size_t queryBegin = chunk * queryChunkSize;
+      const std::size_t queryEnd = std::min(nbQueries, queryBegin + queryChunkSize);
+
+      for(std::size_t q = queryBegin; q < queryEnd; ++q)
+      {
+        Top2Neighbours<DistanceT>& n = neighbours[q];
+        n.index[0] = n.index[1] = -1;
+        n.distance[0] = n.distance[1] = std::numeric_limits<DistanceT>::max();
+      }
+
+      for(std::size_t blockBegin = 0; blockBegin < nbDatabase; blockBegin += databaseBlockSize)
+      {
+        const std::size_t blockCount = std::min(databaseBlockSize, nbDatabase - blockBegin);
+
+        for(std::size_t q = queryBegin; q < queryEnd; ++q)
+        {
+          oneToMany(queries + q * size, database + blockBegin * size, blockCount, size, distances.data());
+
+          // strict comparisons: on ties, the smallest index is kept
+          Top2Neighbours<DistanceT>& n = neighbours[q];
+          for(std::size_t j = 0; j < blockCount; ++j)
+          {
+            const DistanceT d = distances[j];
+            if(d < n.distance[1])
+            {
+              if(d < n.distance[0])
+              {
+                n.distance[1] = n.distance[0];
+                n.index[1] = n.index[0];
+                n.distance[0] = d;
+                n.index[0] = static_cast<int>(blockBegin + j);
+              }
+              else
+              {
+                n.distance[1] = d;
+                n.index[1] = static_cast<int>(blockBegin + j);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+EInstructionSet getMetricInstructionSet()
+{
+  return kernels().instructionSet;
+}
+
+bool setMetricInstructionSet(EInstructionSet instructionSet)
+{
+  const MetricKernels* requestedKernels = getKernelsFor(instructionSet);
+  if(requestedKernels == nullptr)
+    return false;
+  currentKernels().store(requestedKernels);
+  ALICEVISION_LOG_DEBUG("Descriptor distance kernels: " << EInstructionSet_enumToString(instructionSet));
+  return true;
+}
+
+int squaredL2Uchar(const unsigned char* a, const unsigned char* b, std::size_t size)
+{
+  return kernels().squaredL2Uchar(a, b, size);
+}
+
+float squaredL2Float(const float* a, const float* b, std::size_t size)
+{
+  return kernels().squaredL2Float(a, b, size);
+}
+
+unsigned int hammingDistance(const unsigned char* a, const unsigned char* b, std::size_t nbBytes)
+{
+  return kernels().hamming(a, b, nbBytes);
+}
+
+void squaredL2UcharOneToMany(const unsigned char* query, const unsigned char* database, std::size_t nbDatabase, std::size_t size, int* distances)
+{
+  kernels().squaredL2UcharOneToMany(query, database, nbDatabase, size, distances);
+}
+
+void squaredL2FloatOneToMany(const float* query, const float* database, std::size_t nbDatabase, std::size_t size, float* distances)
+{
+  kernels().squaredL2FloatOneToMany(query, database, nbDatabase, size, distances);
+}
+
+void hammingOneToMany(const unsigned char* query, const unsigned char* database, std::size_t nbDatabase, std::size_t size, unsigned int* distances)
+{
+  kernels().hammingOneToMany(query, database, nbDatabase, size, distances);
+}
+
+void squaredL2UcharTop2(const unsigned char* queries, std::size_t nbQueries, const unsigned char* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<int>* neighbours)
+{
+  top2Search(kernels().squaredL2UcharOneToMany, queries, nbQueries, database, nbDatabase, size, neighbours);
+}
+
+void squaredL2FloatTop2(const float* queries, std::size_t nbQueries, const float* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<float>* neighbours)
+{
+  top2Search(kernels().squaredL2FloatOneToMany, queries, nbQueries, database, nbDatabase, size, neighbours);
+}
+
+void hammingTop2(const unsigned char* queries, std::size_t nbQueries, const unsigned char* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<unsigned int>* neighbours)
+{
+  top2Search(kernels().hammingOneToMany, queries, nbQueries, database, nbDatabase, size, neighbours);
+}
+
+}  // namespace feature
+}  // namespace aliceVision
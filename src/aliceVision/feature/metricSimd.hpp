@@ -0,0 +1,140 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "metric.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace aliceVision {
+namespace feature {
+
+/**
+ * @brief Instruction set used by the descriptor distance kernels.
+ *        The best available instruction set is selected at runtime.
+ */
+enum class EInstructionSet
+{
+  SCALAR = 0,
+  AVX2,
+  AVX512,
+  NEON
+};
+
+std::string EInstructionSet_enumToString(EInstructionSet instructionSet);
+
+/**
+ * @brief Get the instruction set currently used by the distance kernels.
+ */
+EInstructionSet getMetricInstructionSet();
+
+/**
+ * @brief Force the instruction set used by the distance kernels (e.g. for testing or benchmarking).
+ * @param[in] instructionSet the requested instruction set
+ * @return false if the instruction set is not supported by this CPU or build
+ */
+bool setMetricInstructionSet(EInstructionSet instructionSet);
+
+/**
+ * @brief The two nearest neighbours of a query descriptor, as needed by the distance ratio test.
+ *        index[0] is the nearest neighbour, index[1] the second nearest one.
+ */
+template<typename DistanceT>
+struct Top2Neighbours
+{
+  int index[2];
+  DistanceT distance[2];
+};
+
+/// Squared Euclidean distance between two unsigned char descriptors
+int squaredL2Uchar(const unsigned char* a, const unsigned char* b, std::size_t size);
+
+/// Squared Euclidean distance between two float descriptors
+float squaredL2Float(const float* a, const float* b, std::size_t size);
+
+/// Hamming distance between two binary descriptors of nbBytes bytes
+unsigned int hammingDistance(const unsigned char* a, const unsigned char* b, std::size_t nbBytes);
+
+/**
+ * @brief Distances between one query and all the descriptors of a database.
+ * @param[in] query the query descriptor
+ * @param[in] database the contiguous database descriptors (nbDatabase x size)
+ * @param[in] nbDatabase the number of database descriptors
+ * @param[in] size the descriptor length (in bytes for hamming)
+ * @param[out] distances nbDatabase distances
+ */
+void squaredL2UcharOneToMany(const unsigned char* query, const unsigned char* database, std::size_t nbDatabase, std::size_t size, int* distances);
+void squaredL2FloatOneToMany(const float* query, const float* database, std::size_t nbDatabase, std::size_t size, float* distances);
+void hammingOneToMany(const unsigned char* query, const unsigned char* database, std::size_t nbDatabase, std::size_t size, unsigned int* distances);
+
+/**
+ * @brief Find the 2 nearest neighbours in a database for each query descriptor (brute force).
+ *        The database is processed by blocks to stay in cache and queries are processed in parallel.
+ * @param[in] queries the contiguous query descriptors (nbQueries x size)
+ * @param[in] nbQueries the number of query descriptors
+ * @param[in] database the contiguous database descriptors (nbDatabase x size)
+ * @param[in] nbDatabase the number of database descriptors (at least 2)
+ * @param[in] size the descriptor length (in bytes for hamming)
+ * @param[out] neighbours nbQueries nearest neighbours
+ */
+void squaredL2UcharTop2(const unsigned char* queries, std::size_t nbQueries, const unsigned char* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<int>* neighbours);
+void squaredL2FloatTop2(const float* queries, std::size_t nbQueries, const float* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<float>* neighbours);
+void hammingTop2(const unsigned char* queries, std::size_t nbQueries, const unsigned char* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<unsigned int>* neighbours);
+
+/**
+ * @brief Batched top-2 search for a given descriptor type and metric, if a SIMD kernel exists.
+ */
+template<typename ScalarT, typename MetricT>
+struct MetricTop2Kernel
+{
+  static constexpr bool available = false;
+};
+
+template<>
+struct MetricTop2Kernel<unsigned char, L2_Simple<unsigned char>>
+{
+  static constexpr bool available = true;
+  typedef int DistanceT;
+  static void search(const unsigned char* queries, std::size_t nbQueries, const unsigned char* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<DistanceT>* neighbours)
+  {
+    squaredL2UcharTop2(queries, nbQueries, database, nbDatabase, size, neighbours);
+  }
+};
+
+template<>
+struct MetricTop2Kernel<unsigned char, L2_Vectorized<unsigned char>> : public MetricTop2Kernel<unsigned char, L2_Simple<unsigned char>>
+{};
+
+template<>
+struct MetricTop2Kernel<float, L2_Simple<float>>
+{
+  static constexpr bool available = true;
+  typedef float DistanceT;
+  static void search(const float* queries, std::size_t nbQueries, const float* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<DistanceT>* neighbours)
+  {
+    squaredL2FloatTop2(queries, nbQueries, database, nbDatabase, size, neighbours);
+  }
+};
+
+template<>
+struct MetricTop2Kernel<float, L2_Vectorized<float>> : public MetricTop2Kernel<float, L2_Simple<float>>
+{};
+
+template<>
+struct MetricTop2Kernel<unsigned char, Hamming<unsigned char>>
+{
+  static constexpr bool available = true;
+  typedef unsigned int DistanceT;
+  static void search(const unsigned char* queries, std::size_t nbQueries, const unsigned char* database, std::size_t nbDatabase, std::size_t size, Top2Neighbours<DistanceT>* neighbours)
+  {
+    hammingTop2(queries, nbQueries, database, nbDatabase, size, neighbours);
+  }
+};
+
+}  // namespace feature
+}  // namespace aliceVision
@@ -6,9 +6,12 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include <aliceVision/feature/metric.hpp>
+#include <aliceVision/feature/metricSimd.hpp>
 
 #include <iostream>
+#include <random>
 #include <string>
+#include <vector>
 
 #define BOOST_TEST_MODULE matchingMetric
 
@@ -134,3 +137,87 @@ BOOST_AUTO_TEST_CASE(Metric_HAMMING_BITSET_RAW_MEMORY_32BITS)
     }
   }
 }
+
+template<typename T, typename DistanceT, typename MetricT>
+void checkTop2(const std::vector<T>& queries, const std::vector<T>& database, std::size_t size,
+               const std::vector<Top2Neighbours<DistanceT>>& neighbours, const MetricT& metric)
+{
+  const std::size_t nbQueries = queries.size() / size;
+  const std::size_t nbDatabase = database.size() / size;
+
+  for(std::size_t q = 0; q < nbQueries; ++q)
+  {
+    std::vector<DistanceT> distances(nbDatabase);
+    for(std::size_t j = 0; j < nbDatabase; ++j)
+      distances[j] = static_cast<DistanceT>(metric(&queries[q * size], &database[j * size], size));
+
+    const std::size_t first = std::min_element(distances.begin(), distances.end()) - distances.begin();
+    BOOST_CHECK_CLOSE(double(distances[first]), double(neighbours[q].distance[0]), 1e-3);
+    BOOST_CHECK_CLOSE(double(distances[neighbours[q].index[0]]), double(neighbours[q].distance[0]), 1e-3);
+    distances[first] = std::numeric_limits<DistanceT>::max();
+    const std::size_t second = std::min_element(distances.begin(), distances.end()) - distances.begin();
+    BOOST_CHECK_CLOSE(double(distances[second]), double(neighbours[q].distance[1]), 1e-3);
+    BOOST_CHECK_NE(neighbours[q].index[0], neighbours[q].index[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Metric_SIMD_Kernels)
+{
+  std::mt19937 randomNumberGenerator(0);
+  std::uniform_int_distribution<int> ucharDistribution(0, 255);
+  std::uniform_real_distribution<float> floatDistribution(0.f, 1.f);
+
+  // sizes with and without scalar remainders
+  const std::vector<std::size_t> sizes = {128, 32, 64, 77};
+  const std::size_t nbQueries = 37;
+  const std::size_t nbDatabase = 301;
+
+  const EInstructionSet defaultInstructionSet = getMetricInstructionSet();
+
+  for(EInstructionSet instructionSet : {EInstructionSet::SCALAR, EInstructionSet::AVX2, EInstructionSet::AVX512, EInstructionSet::NEON})
+  {
+    if(!setMetricInstructionSet(instructionSet))
+      continue;
+
+    BOOST_TEST_MESSAGE("Instruction set: " << EInstructionSet_enumToString(instructionSet));
+
+    for(std::size_t size : sizes)
+    {
+      std::vector<unsigned char> ucharQueries(nbQueries * size), ucharDatabase(nbDatabase * size);
+      std::vector<float> floatQueries(nbQueries * size), floatDatabase(nbDatabase * size);
+      for(auto& v : ucharQueries) v = ucharDistribution(randomNumberGenerator);
+      for(auto& v : ucharDatabase) v = ucharDistribution(randomNumberGenerator);
+      for(auto& v : floatQueries) v = floatDistribution(randomNumberGenerator);
+      for(auto& v : floatDatabase) v = floatDistribution(randomNumberGenerator);
+
+      // single pair
+      const L2_Simple<unsigned char> l2Uchar;
+      const L2_Simple<float> l2Float;
+      const Hamming<unsigned char> hamming;
+      BOOST_CHECK_EQUAL(int(l2Uchar(&ucharQueries[0], &ucharDatabase[0], size)), squaredL2Uchar(&ucharQueries[0], &ucharDatabase[0], size));
+      BOOST_CHECK_CLOSE(l2Float(&floatQueries[0], &floatDatabase[0], size), squaredL2Float(&floatQueries[0], &floatDatabase[0], size), 1e-3);
+      BOOST_CHECK_EQUAL(hamming(&ucharQueries[0], &ucharDatabase[0], size), hammingDistance(&ucharQueries[0], &ucharDatabase[0], size));
+
+      // one to many
+      std::vector<unsigned int> hammingDistances(nbDatabase);
+      hammingOneToMany(&ucharQueries[0], &ucharDatabase[0], nbDatabase, size, hammingDistances.data());
+      for(std::size_t j = 0; j < nbDatabase; ++j)
+        BOOST_CHECK_EQUAL(hamming(&ucharQueries[0], &ucharDatabase[j * size], size), hammingDistances[j]);
+
+      // top-2 neighbours
+      std::vector<Top2Neighbours<int>> ucharNeighbours(nbQueries);
+      squaredL2UcharTop2(ucharQueries.data(), nbQueries, ucharDatabase.data(), nbDatabase, size, ucharNeighbours.data());
+      checkTop2(ucharQueries, ucharDatabase, size, ucharNeighbours, l2Uchar);
+
+      std::vector<Top2Neighbours<float>> floatNeighbours(nbQueries);
+      squaredL2FloatTop2(floatQueries.data(), nbQueries, floatDatabase.data(), nbDatabase, size, floatNeighbours.data());
+      checkTop2(floatQueries, floatDatabase, size, floatNeighbours, l2Float);
+
+      std::vector<Top2Neighbours<unsigned int>> hammingNeighbours(nbQueries);
+      hammingTop2(ucharQueries.data(), nbQueries, ucharDatabase.data(), nbDatabase, size, hammingNeighbours.data());
+      checkTop2(ucharQueries, ucharDatabase, size, hammingNeighbours, hamming);
+    }
+  }
+
+  BOOST_CHECK(setMetricInstructionSet(defaultInstructionSet));
+}
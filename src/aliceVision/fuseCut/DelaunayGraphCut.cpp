@@ -10,6 +10,8 @@
 #include "DelaunayGraphCut.hpp"
 // #include <aliceVision/fuseCut/MaxFlow_CSR.hpp>
 #include <aliceVision/fuseCut/MaxFlow_AdjList.hpp>
+#include <aliceVision/fuseCut/MaxFlow_PushRelabel.hpp>
+#include <aliceVision/fuseCut/DepthMapsStream.hpp>
 #include <aliceVision/sfmData/SfMData.hpp>
 #include <aliceVision/mvsData/geometry.hpp>
 #include <aliceVision/mvsData/jetColorMap.hpp>
@@ -19,7 +21,10 @@
 #include <aliceVision/mvsUtils/fileIO.hpp>
 #include <aliceVision/mvsUtils/depthSimMapIO.hpp>
 #include <aliceVision/image/imageAlgo.hpp>
+#include <aliceVision/image/io.hpp>
 #include <aliceVision/system/ProgressDisplay.hpp>
+#include <aliceVision/system/MemoryInfo.hpp>
+#include <aliceVision/system/Timer.hpp>
 #include <aliceVision/alicevision_omp.hpp>
 
 #include "nanoflann.hpp"
@@ -29,7 +34,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/operations.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 
@@ -286,47 +294,54 @@ void createVerticesWithVisibilities(const StaticVector<int>& cams, std::vector<P
     // std::vector<Point3d> newVerticesCoordsPrepare(verticesCoordsPrepare.size());
     // std::vector<float> newSimScorePrepare(simScorePrepare.size());
     // std::vector<double> newPixSizePrepare(pixSizePrepare.size());
-    std::vector<omp_lock_t> locks(verticesCoordsPrepare.size());
-    for (auto& lock: locks)
-        omp_init_lock(&lock);
-
-    omp_set_nested(1);
-    #pragma omp parallel for num_threads(3)
-    for(int c = 0; c < cams.size(); ++c)
+    // The depth maps are decoded in background threads while the previous camera is processed.
+    // The vertices are not moved during the pass: the contributions are accumulated per vertex
+    // and averaged at the end, so the kd-tree stays consistent with the vertices coordinates.
+    std::vector<std::atomic<int>> lastCamPerVertex(verticesCoordsPrepare.size());
+    for(auto& lastCam : lastCamPerVertex)
+        lastCam.store(-1, std::memory_order_relaxed);
+    std::vector<Point3d> sumContributions(verticesCoordsPrepare.size(), Point3d(0.0, 0.0, 0.0));
+    std::vector<int> nbContributions(verticesCoordsPrepare.size(), 0);
+    std::vector<std::vector<std::pair<std::size_t, Point3d>>> threadContributions(omp_get_max_threads());
+
+    std::vector<int> rcs(cams.size());
+    std::iota(rcs.begin(), rcs.end(), 0);
+    DepthMapsStream depthMapsStream(mp, rcs, 0, true, false);
+    DepthSimMaps maps;
+
+    while(depthMapsStream.next(maps))
     {
+        const int c = maps.rc;
         ALICEVISION_LOG_INFO("Create visibilities (" << c << "/" << cams.size() << ")");
-        image::Image<float> depthMap;
-        image::Image<float> simMap;
+        image::Image<float>& depthMap = maps.depthMap;
+        image::Image<float>& simMap = maps.simMap;
         const int width = mp.getWidth(c);
         const int height = mp.getHeight(c);
 
-        // read depth map
-        mvsUtils::readDepthMap(c, mp, depthMap, 0);
-
         if(depthMap.size() <= 0)
         {
             ALICEVISION_LOG_WARNING("Empty depth map (cam id: " << c << ")");
             continue;
         }
 
-        // read similarity map
-        try
+        if(simMap.size() > 0)
         {
-            mvsUtils::readSimMap(c, mp, simMap, 0);
             image::Image<float> simMapTmp(simMap.Width(), simMap.Height());
             imageAlgo::convolveImage(simMap, simMapTmp, "gaussian", simGaussianSize, simGaussianSize);
             simMap.swap(simMapTmp);
         }
-        catch(const std::exception& e)
+        else
         {
             ALICEVISION_LOG_WARNING("Cannot find similarity map file.");
-            simMap.resize(width * height, -1);
+            simMap.resize(width, height, true, -1);
         }
-        
+
         // Add visibility
-        #pragma omp parallel for
+        #pragma omp parallel for schedule(static)
         for (int y = 0; y < depthMap.Height(); ++y)
         {
+            std::vector<std::pair<std::size_t, Point3d>>& contributions = threadContributions[omp_get_thread_num()];
+
             for(int x = 0; x < depthMap.Width(); ++x)
             {
                 const std::size_t index = y * depthMap.Width() + x;
@@ -357,37 +372,40 @@ void createVerticesWithVisibilities(const StaticVector<int>& cams, std::vector<P
 
                 if(dist < voteMarginFactor * std::max(pixSizeScoreI, pixSizeScoreV))
                 {
-                    GC_vertexInfo& va = verticesAttrPrepare[nearestVertexIndex];
-                    Point3d& vc = verticesCoordsPrepare[nearestVertexIndex];
-                    const float simValue = simMap(index);
-                    // remap similarity values from [-1;+1] to [+1;+simFactor]
-                    // interpretation is [goodSimilarity;badSimilarity]
-                    const float simScore = simValue < -1.0f ? 1.0f : 1.0f + (1.0f + simValue) * simFactor;
-
-                    // Custom locks to limit it to the index: nearestVertexIndex
-                    // to avoid using "omp critical"
-                    omp_lock_t* lock = &locks[nearestVertexIndex];
-                    omp_set_lock(lock);
-                    {
-                        va.cams.push_back_distinct(c);
-                        if(dist < contributeMarginFactor * pixSizeScoreV)
-                        {
-                            vc = (vc * (double)va.nrc + p) / double(va.nrc + 1);
-//                            newVerticesCoordsPrepare[nearestVertexIndex] = (newVerticesCoordsPrepare[nearestVertexIndex] * double(va.nrc) + p) / double(va.nrc + 1);
-//                            newSimScorePrepare[nearestVertexIndex] = (newSimScorePrepare[nearestVertexIndex] * float(va.nrc) + simScore) / float(va.nrc + 1);
-//                            newPixSizePrepare[nearestVertexIndex] = (newPixSizePrepare[nearestVertexIndex] * double(va.nrc) + pixSize) / double(va.nrc + 1);
-                            va.nrc += 1;
-                        }
-                    }
-                    omp_unset_lock(lock);
+                    // only the first thread voting for this vertex with this camera adds the visibility,
+                    // the cameras are processed one after the other
+                    int lastCam = lastCamPerVertex[nearestVertexIndex].load(std::memory_order_relaxed);
+                    if(lastCam != c && lastCamPerVertex[nearestVertexIndex].compare_exchange_strong(lastCam, c))
+                        verticesAttrPrepare[nearestVertexIndex].cams.push_back_distinct(c);
+
+                    if(dist < contributeMarginFactor * pixSizeScoreV)
+                        contributions.emplace_back(nearestVertexIndex, p);
                 }
             }
         }
+
+        for(auto& contributions : threadContributions)
+        {
+            for(const auto& contribution : contributions)
+            {
+                sumContributions[contribution.first] += contribution.second;
+                ++nbContributions[contribution.first];
+            }
+            contributions.clear();
+        }
     }
-    omp_set_nested(0);
 
-    for(auto& lock: locks)
-        omp_destroy_lock(&lock);
+    // average the contributions with the previous coordinates of the vertices
+    #pragma omp parallel for
+    for(int vi = 0; vi < verticesCoordsPrepare.size(); ++vi)
+    {
+        if(nbContributions[vi] == 0)
+            continue;
+        GC_vertexInfo& va = verticesAttrPrepare[vi];
+        Point3d& vc = verticesCoordsPrepare[vi];
+        vc = (vc * double(va.nrc) + sumContributions[vi]) / double(va.nrc + nbContributions[vi]);
+        va.nrc += nbContributions[vi];
+    }
 
     // compute pixSize
     #pragma omp parallel for
@@ -423,7 +441,22 @@ DelaunayGraphCut::DelaunayGraphCut(mvsUtils::MultiViewParams& mp)
     saveTemporaryBinFiles = _mp.userParams.get<bool>("LargeScale.saveTemporaryBinFiles", false);
 
     GEO::initialize();
-    _tetrahedralization = GEO::Delaunay::create(3, "BDEL");
+
+    // optionally use the geogram multi-threaded Delaunay (spatial partitioning and merge) if available.
+    // Disabled by default: its result depends on the threads scheduling, so the output mesh is not reproducible.
+    const bool useParallelDelaunay = _mp.userParams.get<bool>("delaunaycut.parallelDelaunay", false) && (omp_get_max_threads() > 1);
+
+    if(useParallelDelaunay)
+    {
+        _tetrahedralization = GEO::Delaunay::create(3, "PDEL");
+
+        if(_tetrahedralization.is_null())
+            ALICEVISION_LOG_WARNING("Parallel Delaunay tetrahedralization is not available, fallback to the sequential one.");
+    }
+
+    if(_tetrahedralization.is_null())
+        _tetrahedralization = GEO::Delaunay::create(3, "BDEL");
+
     // _tetrahedralization->set_keeps_infinite(true);
     _tetrahedralization->set_stores_neighbors(true);
     // _tetrahedralization->set_stores_cicl(true);
@@ -513,22 +546,104 @@ void DelaunayGraphCut::computeDelaunay()
 
     assert(_verticesCoords.size() == _verticesAttr.size());
 
-    long tall = clock();
+    const auto logPhase = [](const std::string& phase, const system::Timer& timer)
+    {
+        ALICEVISION_LOG_INFO("computeDelaunay: " << phase << " done in " << system::prettyTime(timer.elapsedMs())
+                             << " (peak memory: " << (system::getPeakProcessMemory() / (1024 * 1024)) << " MB).");
+    };
+
+    system::Timer timer;
     _tetrahedralization->set_vertices(_verticesCoords.size(), _verticesCoords.front().m);
-    mvsUtils::printfElapsedTime(tall, "GEOGRAM Delaunay tetrahedralization ");
+    logPhase("Delaunay tetrahedralization of " + std::to_string(_verticesCoords.size()) + " vertices", timer);
 
+    timer.reset();
     initCells();
+    logPhase("cells initialization", timer);
 
+    timer.reset();
     updateVertexToCellsCache();
+    logPhase("vertex to cells cache", timer);
 
     ALICEVISION_LOG_DEBUG("computeDelaunay done\n");
 }
 
+void DelaunayGraphCut::updateVertexToCellsCache()
+{
+    const std::size_t nbVertices = _verticesCoords.size();
+    const int nbCells = int(_tetrahedralization->nb_cells());
+
+    // count the number of neighboring cells per vertex
+    std::vector<int> nbCellsPerVertex(nbVertices, 0);
+    int coutInvalidVertices = 0;
+
+#pragma omp parallel for reduction(+ : coutInvalidVertices)
+    for(int ci = 0; ci < nbCells; ++ci)
+    {
+        for(VertexIndex k = 0; k < 4; ++k)
+        {
+            const VertexIndex vi = _tetrahedralization->cell_vertex(ci, k);
+            if(vi == GEO::NO_VERTEX || vi >= nbVertices)
+            {
+                ++coutInvalidVertices;
+                continue;
+            }
+#pragma omp atomic
+            ++nbCellsPerVertex[vi];
+        }
+    }
+
+    // allocate each neighboring cell list, counters are reused as insertion cursors
+    _neighboringCellsPerVertex.clear();
+    _neighboringCellsPerVertex.resize(nbVertices);
+
+#pragma omp parallel for
+    for(int vi = 0; vi < nbVertices; ++vi)
+    {
+        _neighboringCellsPerVertex[vi].resize(nbCellsPerVertex[vi]);
+        nbCellsPerVertex[vi] = 0;
+    }
+
+    // fill neighboring cell lists
+#pragma omp parallel for
+    for(int ci = 0; ci < nbCells; ++ci)
+    {
+        for(VertexIndex k = 0; k < 4; ++k)
+        {
+            const VertexIndex vi = _tetrahedralization->cell_vertex(ci, k);
+            if(vi == GEO::NO_VERTEX || vi >= nbVertices)
+                continue;
+
+            int position;
+#pragma omp atomic capture
+            position = nbCellsPerVertex[vi]++;
+
+            _neighboringCellsPerVertex[vi][position] = ci;
+        }
+    }
+
+    // neighboring cell lists should be sorted (see getNeighboringCellsByEdge)
+    std::size_t nbVerticesWithCells = 0;
+
+#pragma omp parallel for schedule(dynamic, 4096) reduction(+ : nbVerticesWithCells)
+    for(int vi = 0; vi < nbVertices; ++vi)
+    {
+        std::vector<CellIndex>& cells = _neighboringCellsPerVertex[vi];
+        std::sort(cells.begin(), cells.end());
+        if(!cells.empty())
+            ++nbVerticesWithCells;
+    }
+
+    ALICEVISION_LOG_INFO("coutInvalidVertices: " << coutInvalidVertices);
+    ALICEVISION_LOG_INFO("neighboringCellsPerVertex: " << nbVerticesWithCells);
+    ALICEVISION_LOG_INFO("verticesCoords: " << nbVertices);
+}
+
 void DelaunayGraphCut::initCells()
 {
     _cellsAttr.resize(_tetrahedralization->nb_cells()); // or nb_finite_cells() if keeps_infinite()
 
     ALICEVISION_LOG_INFO(_cellsAttr.size() << " cells created by tetrahedralization.");
+#pragma omp parallel for
     for(int i = 0; i < _cellsAttr.size(); ++i)
     {
         GC_cellInfo& c = _cellsAttr[i];
@@ -544,6 +659,22 @@ void DelaunayGraphCut::initCells()
         }
     }
 
+    // mirror facets local indexes, used by the ray traversals instead of searching them in the adjacent cells
+    _mirrorLocalVertexIndexes.clear();
+    std::vector<std::uint8_t> mirrorLocalVertexIndexes(_cellsAttr.size(), 0);
+#pragma omp parallel for
+    for(int i = 0; i < _cellsAttr.size(); ++i)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            const Facet mFacet = computeMirrorFacet(Facet(i, k));
+            if(mFacet.cellIndex != GEO::NO_CELL)
+                mirrorLocalVertexIndexes[i] |= std::uint8_t(mFacet.localVertexIndex << (2 * k));
+        }
+    }
+    _mirrorLocalVertexIndexes.swap(mirrorLocalVertexIndexes);
+    ALICEVISION_LOG_INFO("Mirror facets cache: " << _mirrorLocalVertexIndexes.size() / (1024.0 * 1024.0) << " MB.");
+
     ALICEVISION_LOG_DEBUG("initCells [" << _tetrahedralization->nb_cells() << "] done");
 }
 
@@ -1032,6 +1163,114 @@ void DelaunayGraphCut::addMaskHelperPoints(const Point3d voxel[8], const StaticV
     ALICEVISION_LOG_INFO("Add Mask Helper Points done.");
 }
 
+/**
+ * @brief Get the image region of a camera where a voxel can be seen, aligned on the sampling blocks.
+ * @param[in] mp the multi-view parameters
+ * @param[in] c the camera index
+ * @param[in] voxel the 8 corners of the voxel
+ * @param[in] step the size of the sampling blocks
+ * @return the image region, the whole image if the voxel is partly behind the camera, empty if it is out of the image
+ */
+ROI getVoxelImageRegion(const mvsUtils::MultiViewParams& mp, int c, const Point3d voxel[8], int step)
+{
+    const int width = mp.getWidth(c);
+    const int height = mp.getHeight(c);
+
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = -std::numeric_limits<double>::max();
+    double maxY = -std::numeric_limits<double>::max();
+
+    // the projection of the voxel is in the bounding box of the projection of its corners
+    for(int i = 0; i < 8; ++i)
+    {
+        const Point3d p = mp.camArr[c] * voxel[i];
+
+        if(p.z <= 0.0)
+            return ROI(0, width, 0, height);
+
+        minX = std::min(minX, p.x / p.z);
+        minY = std::min(minY, p.y / p.z);
+        maxX = std::max(maxX, p.x / p.z);
+        maxY = std::max(maxY, p.y / p.z);
+    }
+
+    const int beginX = int(std::max(std::floor(minX), 0.0));
+    const int beginY = int(std::max(std::floor(minY), 0.0));
+    const int endX = int(std::min(std::floor(maxX) + 1.0, double(width)));
+    const int endY = int(std::min(std::floor(maxY) + 1.0, double(height)));
+
+    if(beginX >= endX || beginY >= endY)
+        return ROI();
+
+    return ROI((beginX / step) * step, std::min(divideRoundUp(endX, step) * step, width),
+               (beginY / step) * step, std::min(divideRoundUp(endY, step) * step, height));
+}
+
+/**
+ * @brief Check if some valid depths of a region of the depth map of a camera can be in a voxel.
+ * @note Only uses the depth ranges of the depth map tiles, without reading the depth map.
+ * @param[in] mp the multi-view parameters
+ * @param[in] c the camera index
+ * @param[in] voxel the 8 corners of the voxel
+ * @param[in] roi the region of the depth map
+ * @return false if all the valid depths of the region are beyond the voxel
+ */
+bool isVoxelInDepthMapRange(const mvsUtils::MultiViewParams& mp, int c, const Point3d voxel[8], const ROI& roi)
+{
+    // the depths are distances to the camera center, the farthest point of the voxel is one of its corners
+    double maxVoxelDistance = 0.0;
+    for(int i = 0; i < 8; ++i)
+        maxVoxelDistance = std::max(maxVoxelDistance, (voxel[i] - mp.CArr[c]).size());
+
+    std::vector<mvsUtils::DepthMapRegion> regions;
+    mvsUtils::getDepthMapRegions(c, mp, 1, regions, 0);
+
+    for(const mvsUtils::DepthMapRegion& region : regions)
+    {
+        if(!region.roi.isEmpty() && intersect(region.roi, roi).isEmpty())
+            continue;
+
+        if(region.nbDepthValues == 0 || region.minDepth <= maxVoxelDistance)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Read a region of the filtered depth map, similarity map and number of modals map of a camera.
+ * @param[in] mp the multi-view parameters
+ * @param[in] c the camera index
+ * @param[in] roi the region of the maps, empty for the whole maps
+ * @param[out] out_maps the maps of the region, the similarity and number of modals maps are empty if they cannot be read
+ */
+void readCroppedDepthSimMaps(const mvsUtils::MultiViewParams& mp, int c, const ROI& roi, DepthSimMaps& out_maps)
+{
+    try
+    {
+        mvsUtils::readDepthSimMap(c, mp, roi, 1, out_maps.depthMap, out_maps.simMap, 0);
+    }
+    catch(const std::exception&)
+    {
+        // a missing similarity map is handled by the caller
+        mvsUtils::readDepthMap(c, mp, roi, 1, out_maps.depthMap, 0);
+        out_maps.simMap = image::Image<float>();
+    }
+
+    const std::string nmodMapFilepath = getFileNameFromIndex(mp, c, mvsUtils::EFileType::nmodMap, 0);
+    if(!bfs::exists(nmodMapFilepath))
+        return;
+
+    image::readImage(nmodMapFilepath, out_maps.nmodMap, image::EImageColorSpace::NO_CONVERSION);
+
+    if(!roi.isEmpty() && roi.x.end <= unsigned(out_maps.nmodMap.Width()) && roi.y.end <= unsigned(out_maps.nmodMap.Height()))
+    {
+        using NmodMap = image::Image<unsigned char>;
+        NmodMap nmodMap(NmodMap::Base(out_maps.nmodMap.block(roi.y.begin, roi.x.begin, roi.height(), roi.width())));
+        out_maps.nmodMap.swap(nmodMap);
+    }
+}
+
 void DelaunayGraphCut::fuseFromDepthMaps(const StaticVector<int>& cams, const Point3d voxel[8], const FuseParams& params)
 {
     ALICEVISION_LOG_INFO("fuseFromDepthMaps, maxVertices: " << params.maxPoints);
@@ -1075,68 +1314,131 @@ void DelaunayGraphCut::fuseFromDepthMaps(const StaticVector<int>& cams, const Po
 
     ALICEVISION_LOG_INFO("Load depth maps and add points.");
     {
-        omp_set_nested(1);
-        #pragma omp parallel for num_threads(3)
-        for(int c = 0; c < cams.size(); c++)
+        // With a voxel, only the image region of each camera where the voxel can be seen is sampled. The maps are
+        // read on this region with a margin for the filters (only the intersecting tiles of the depth/sim map
+        // containers are decoded) and the cameras with all their valid depths beyond the voxel are not read.
+        const int mapMargin = int(std::ceil(params.simGaussianSizeInit)) + 1;
+        std::vector<ROI> sampleRois(cams.size());
+        std::vector<ROI> readRois(cams.size()); // empty for the whole maps
+        int nbCulledCams = 0;
+
+        for(int c = 0; c < cams.size(); ++c)
         {
-            image::Image<float> depthMap;
-            image::Image<float> simMap;
-            image::Image<unsigned char> numOfModalsMap;
+            const ROI imageRoi(0, _mp.getWidth(c), 0, _mp.getHeight(c));
+
+            if(voxel == nullptr)
+            {
+                sampleRois[c] = imageRoi;
+                continue;
+            }
+
+            sampleRois[c] = getVoxelImageRegion(_mp, c, voxel, step);
+
+            if(!sampleRois[c].isEmpty() && !isVoxelInDepthMapRange(_mp, c, voxel, sampleRois[c]))
+                sampleRois[c] = ROI();
+
+            if(sampleRois[c].isEmpty())
+            {
+                ++nbCulledCams;
+                continue;
+            }
+
+            const ROI readRoi(std::max(int(sampleRois[c].x.begin) - mapMargin, 0), sampleRois[c].x.end + mapMargin,
+                              std::max(int(sampleRois[c].y.begin) - mapMargin, 0), sampleRois[c].y.end + mapMargin);
+            readRois[c] = intersect(readRoi, imageRoi);
+
+            if(readRois[c].width() == imageRoi.width() && readRois[c].height() == imageRoi.height())
+                readRois[c] = ROI();
+        }
+
+        if(voxel != nullptr)
+            ALICEVISION_LOG_INFO(nbCulledCams << " cameras without depth in the voxel are not read.");
+
+        // The maps of the next cameras are decoded in background threads while the points of the current
+        // camera are selected, only a few cameras are kept in memory.
+        std::vector<int> rcs(cams.size());
+        std::iota(rcs.begin(), rcs.end(), 0);
+        DepthMapsStream depthMapsStream(rcs,
+                                        [this, &sampleRois, &readRois](int c, DepthSimMaps& maps)
+                                        {
+                                            if(sampleRois[c].isEmpty())
+                                                return;
+                                            readCroppedDepthSimMaps(_mp, c, readRois[c], maps);
+                                        });
+        DepthSimMaps maps;
+
+        while(depthMapsStream.next(maps))
+        {
+            const int c = maps.rc;
+            image::Image<float>& depthMap = maps.depthMap;
+            image::Image<float>& simMap = maps.simMap;
+            image::Image<unsigned char>& numOfModalsMap = maps.nmodMap;
 
             const int width = _mp.getWidth(c);
             const int height = _mp.getHeight(c);
+            const int syMax = divideRoundUp(height, step);
+            const int sxMax = divideRoundUp(width, step);
+            const ROI& sampleRoi = sampleRois[c];
 
-            {
-                // read depth map
-                mvsUtils::readDepthMap(c, _mp, depthMap, 0);
+            // the points of the samples out of the voxel region are discarded
+            if(sampleRoi.width() != width || sampleRoi.height() != height)
+                std::fill(pixSizePrepare.begin() + startIndex[c], pixSizePrepare.begin() + startIndex[c] + syMax * sxMax, -1.0);
+
+            if(sampleRoi.isEmpty())
+                continue;
 
+            const int mapWidth = depthMap.Width();
+            const int mapHeight = depthMap.Height();
+            const int mapBeginX = readRois[c].isEmpty() ? 0 : readRois[c].x.begin;
+            const int mapBeginY = readRois[c].isEmpty() ? 0 : readRois[c].y.begin;
+
+            {
                 if(depthMap.size() <= 0)
                 {
                     ALICEVISION_LOG_WARNING("Empty depth map (cam id: " << c << ")");
                     continue;
                 }
 
-                // read similarity map
-                try
+                if(simMap.size() > 0)
                 {
-                    mvsUtils::readSimMap(c, _mp, simMap, 0);
-                        image::Image<float> simMapTmp;
-                        imageAlgo::convolveImage(simMap, simMapTmp, "gaussian",
-                                                 params.simGaussianSizeInit,
-                                                 params.simGaussianSizeInit);
-                        simMap.swap(simMapTmp);
+                    image::Image<float> simMapTmp;
+                    imageAlgo::convolveImage(simMap, simMapTmp, "gaussian",
+                                             params.simGaussianSizeInit,
+                                             params.simGaussianSizeInit);
+                    simMap.swap(simMapTmp);
                 }
-                catch(const std::exception& e)
+                else
                 {
                     ALICEVISION_LOG_WARNING("simMap file can't be found.");
-                    simMap.resize(width, height, true, -1);
+                    simMap.resize(mapWidth, mapHeight, true, -1);
                 }
 
-                // read nmod map
-                int wTmp, hTmp;
-                const std::string nmodMapFilepath = getFileNameFromIndex(_mp, c, mvsUtils::EFileType::nmodMap, 0);
                 // If we have an nModMap in input (from depthmapfilter) use it,
                 // else init with a constant value.
-                if(boost::filesystem::exists(nmodMapFilepath))
+                if(numOfModalsMap.size() > 0)
                 {
-                    image::readImage(nmodMapFilepath, numOfModalsMap,
-                                     image::EImageColorSpace::NO_CONVERSION);
-                    if (numOfModalsMap.Width() != width || numOfModalsMap.Height() != height)
-                        throw std::runtime_error("Wrong nmod map dimensions: " + nmodMapFilepath);
+                    if (numOfModalsMap.Width() != mapWidth || numOfModalsMap.Height() != mapHeight)
+                        throw std::runtime_error("Wrong nmod map dimensions: " + getFileNameFromIndex(_mp, c, mvsUtils::EFileType::nmodMap, 0));
                 }
                 else
                 {
                     ALICEVISION_LOG_WARNING("nModMap file can't be found.");
-                    numOfModalsMap.resize(width, height, true, 1);
+                    numOfModalsMap.resize(mapWidth, mapHeight, true, 1);
                 }
             }
 
-            int syMax = divideRoundUp(height, step);
-            int sxMax = divideRoundUp(width, step);
+            // pixel coordinates in the image, the maps cover the read region
+            const auto mapIndex = [&](int x, int y) { return std::size_t(y - mapBeginY) * mapWidth + (x - mapBeginX); };
+
+            const int syBegin = int(sampleRoi.y.begin) / step;
+            const int syEnd = divideRoundUp(int(sampleRoi.y.end), step);
+            const int sxBegin = int(sampleRoi.x.begin) / step;
+            const int sxEnd = divideRoundUp(int(sampleRoi.x.end), step);
+
             #pragma omp parallel for
-            for(int sy = 0; sy < syMax; ++sy)
+            for(int sy = syBegin; sy < syEnd; ++sy)
             {
-                for(int sx = 0; sx < sxMax; ++sx)
+                for(int sx = sxBegin; sx < sxEnd; ++sx)
                 {
                     int index = startIndex[c] + sy * sxMax + sx;
                     float bestDepth = std::numeric_limits<float>::max();
@@ -1150,24 +1452,23 @@ void DelaunayGraphCut::fuseFromDepthMaps(const StaticVector<int>& cams, const Po
                         for(int x = sx * step, xmax = std::min((sx+1) * step, width);
                             x < xmax; ++x)
                         {
-                            const std::size_t index = y * width + x;
-                            const float depth = depthMap(index);
+                            const float depth = depthMap(mapIndex(x, y));
                             if(depth <= 0.0f)
                                 continue;
 
                             int numOfModals = 0;
                             const int scoreKernelSize = 1;
-                            for(int ly = std::max(y-scoreKernelSize, 0), lyMax = std::min(y+scoreKernelSize, height-1); ly < lyMax; ++ly)
+                            for(int ly = std::max(y-scoreKernelSize, mapBeginY), lyMax = std::min(y+scoreKernelSize, height-1); ly < lyMax; ++ly)
                             {
-                                for(int lx = std::max(x-scoreKernelSize, 0), lxMax = std::min(x+scoreKernelSize, width-1); lx < lxMax; ++lx)
+                                for(int lx = std::max(x-scoreKernelSize, mapBeginX), lxMax = std::min(x+scoreKernelSize, width-1); lx < lxMax; ++lx)
                                 {
-                                    if (depthMap(ly * width + lx) > 0.0f)
+                                    if (depthMap(mapIndex(lx, ly)) > 0.0f)
                                     {
-                                        numOfModals += 10 + int(numOfModalsMap(ly * width + lx));
+                                        numOfModals += 10 + int(numOfModalsMap(mapIndex(lx, ly)));
                                     }
                                 }
                             }
-                            float sim = simMap(index);
+                            float sim = simMap(mapIndex(x, y));
                             sim = sim < 0.0f ?  0.0f : sim; // clamp values < 0
                             // remap similarity values from [-1;+1] to [+1;+simScale]
                             // interpretation is [goodSimilarity;badSimilarity]
@@ -1210,7 +1511,6 @@ void DelaunayGraphCut::fuseFromDepthMaps(const StaticVector<int>& cams, const Po
                 }
             }
         }
-        omp_set_nested(0);
     }
 
     ALICEVISION_LOG_INFO("Filter initial 3D points by pixel size to remove duplicates.");
@@ -1831,6 +2131,93 @@ float DelaunayGraphCut::weightFcn(float nrc, bool labatutWeights, int  /*ncams*/
     return weight;
 }
 
+std::vector<DelaunayGraphCut::VertexIndex> DelaunayGraphCut::getSpatiallySortedRealVertices() const
+{
+    Point3d bbMin(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+    Point3d bbMax(std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest());
+
+    std::vector<VertexIndex> vertices;
+    vertices.reserve(_verticesAttr.size());
+
+    for(VertexIndex vi = 0; vi < _verticesAttr.size(); ++vi)
+    {
+        if(!_verticesAttr[vi].isReal())
+            continue;
+
+        vertices.push_back(vi);
+        for(int d = 0; d < 3; ++d)
+        {
+            bbMin.m[d] = std::min(bbMin.m[d], _verticesCoords[vi].m[d]);
+            bbMax.m[d] = std::max(bbMax.m[d], _verticesCoords[vi].m[d]);
+        }
+    }
+
+    // Morton code on 21 bits per axis
+    const auto spreadBits = [](std::uint64_t x)
+    {
+        x &= 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffff;
+        x = (x | x << 16) & 0x1f0000ff0000ff;
+        x = (x | x << 8) & 0x100f00f00f00f00f;
+        x = (x | x << 4) & 0x10c30c30c30c30c3;
+        x = (x | x << 2) & 0x1249249249249249;
+        return x;
+    };
+
+    std::vector<std::pair<std::uint64_t, VertexIndex>> codes(vertices.size());
+
+#pragma omp parallel for
+    for(int i = 0; i < vertices.size(); ++i)
+    {
+        const Point3d& p = _verticesCoords[vertices[i]];
+        std::uint64_t code = 0;
+        for(int d = 0; d < 3; ++d)
+        {
+            const double extent = bbMax.m[d] - bbMin.m[d];
+            const std::uint64_t q = (extent > 0.0) ? std::uint64_t((p.m[d] - bbMin.m[d]) / extent * double(0x1fffff)) : 0;
+            code |= spreadBits(q) << d;
+        }
+        codes[i] = {code, vertices[i]};
+    }
+
+    std::sort(codes.begin(), codes.end());
+
+    for(std::size_t i = 0; i < codes.size(); ++i)
+        vertices[i] = codes[i].second;
+
+    return vertices;
+}
+
+void DelaunayGraphCut::applyCellWeightVotes(const std::vector<CellWeightVotes>& votes)
+{
+    if(votes.empty())
+        return;
+
+    const int nbBuckets = votes.front().getNbBuckets();
+
+#pragma omp parallel for schedule(dynamic)
+    for(int b = 0; b < nbBuckets; ++b)
+    {
+        for(const CellWeightVotes& groupVotes : votes)
+        {
+            for(const CellWeightVotes::Vote& vote : groupVotes.getBucket(b))
+            {
+                GC_cellInfo& c = _cellsAttr[vote.cellIndex];
+
+                switch(vote.weight)
+                {
+                    case CellWeightVotes::EMPTINESS: c.emptinessScore += vote.value; break;
+                    case CellWeightVotes::FULLNESS:  c.fullnessScore += vote.value; break;
+                    case CellWeightVotes::ON:        c.on += vote.value; break;
+                    case CellWeightVotes::S_WEIGHT:  c.cellSWeight = vote.value; break;
+                    case CellWeightVotes::T_WEIGHT:  c.cellTWeight += vote.value; break;
+                    default:                         c.gEdgeVisWeight[vote.weight - CellWeightVotes::EDGE_VIS] += vote.value; break;
+                }
+            }
+        }
+    }
+}
+
 void DelaunayGraphCut::fillGraph(double nPixelSizeBehind, bool labatutWeights, bool fillOut, float distFcnHeight,
                                  float fullWeight) // nPixelSizeBehind=2*spaceSteps allPoints=1 behind=0
                                                       // labatutWeights=0 fillOut=1 distFcnHeight=0
@@ -1852,9 +2239,21 @@ void DelaunayGraphCut::fillGraph(double nPixelSizeBehind, bool labatutWeights, b
         }
     }
 
-    // choose random order to prevent waiting
-    const unsigned int seed = (unsigned int)_mp.userParams.get<unsigned int>("delaunaycut.seed", 0);
-    const std::vector<int> verticesRandIds = mvsUtils::createRandomArrayOfIntegers(_verticesAttr.size(), seed);
+    // Rays are processed in batches of consecutive vertices along a Morton curve: the rays of a batch cross
+    // neighboring cells. Each chunk of a batch records its votes, they are merged in the chunks order after
+    // the batch, so the weights do not depend on the threads scheduling.
+    system::Timer timer;
+    const std::vector<VertexIndex> rayVertices = getSpatiallySortedRealVertices();
+    const double sortDuration = timer.elapsed();
+
+    const int nbChunks = 4 * omp_get_max_threads();
+    const std::size_t maxRaysPerBatch = 65536; // bound the memory used by the votes
+    std::vector<CellWeightVotes> chunkVotes(nbChunks);
+    for(CellWeightVotes& votes : chunkVotes)
+        votes.init(_cellsAttr.size(), nbChunks);
+
+    double traversalDuration = 0.0;
+    double mergeDuration = 0.0;
 
     int64_t totalStepsFront = 0;
     int64_t totalRayFront = 0;
@@ -1864,62 +2263,72 @@ void DelaunayGraphCut::fillGraph(double nPixelSizeBehind, bool labatutWeights, b
     size_t totalCamHaveVisibilityOnVertex = 0;
     size_t totalOfVertex = 0;
 
-    size_t totalIsRealNrc = 0;
+    size_t totalIsRealNrc = rayVertices.size();
     
     GeometriesCount totalGeometriesIntersectedFrontCount;
     GeometriesCount totalGeometriesIntersectedBehindCount;
 
     auto progressDisplay =
-            system::createConsoleProgressDisplay(std::min(size_t(100), verticesRandIds.size()),
+            system::createConsoleProgressDisplay(std::min(size_t(100), rayVertices.size()),
                                                  std::cout, "fillGraphPartPtRc\n");
 
-    size_t progressStep = verticesRandIds.size() / 100;
+    size_t progressStep = rayVertices.size() / 100;
     progressStep = std::max(size_t(1), progressStep);
-#pragma omp parallel for reduction(+:totalStepsFront,totalRayFront,totalStepsBehind,totalRayBehind,totalCamHaveVisibilityOnVertex,totalOfVertex,totalIsRealNrc)
-    for(int i = 0; i < verticesRandIds.size(); i++)
+    size_t nbProcessedVertices = 0;
+
+    for(std::size_t batchBegin = 0; batchBegin < rayVertices.size();)
     {
-        if(i % progressStep == 0)
-        {
-            ++progressDisplay;
-        }
+        // batch of vertices with at most maxRaysPerBatch rays (at least one vertex)
+        std::size_t batchEnd = batchBegin;
+        for(std::size_t nbRays = 0; batchEnd < rayVertices.size() && (batchEnd == batchBegin || nbRays < maxRaysPerBatch); ++batchEnd)
+            nbRays += _verticesAttr[rayVertices[batchEnd]].cams.size();
 
-        const int vertexIndex = verticesRandIds[i];
-        const GC_vertexInfo& v = _verticesAttr[vertexIndex];
+        const std::size_t batchSize = batchEnd - batchBegin;
 
-        GeometriesCount subTotalGeometriesIntersectedFrontCount;
-        GeometriesCount subTotalGeometriesIntersectedBehindCount;
+        timer.reset();
 
-        if(v.isReal())
+#pragma omp parallel for schedule(dynamic) reduction(+:totalStepsFront,totalRayFront,totalStepsBehind,totalRayBehind,totalCamHaveVisibilityOnVertex,totalOfVertex)
+        for(int chunk = 0; chunk < nbChunks; ++chunk)
         {
-            ++totalIsRealNrc;
-            // "weight" is called alpha(p) in the paper
-            const float weight = weightFcn((float)v.nrc, labatutWeights, v.getNbCameras()); // number of cameras
+            CellWeightVotes& votes = chunkVotes[chunk];
 
-            for(int c = 0; c < v.cams.size(); c++)
+            GeometriesCount subTotalGeometriesIntersectedFrontCount;
+            GeometriesCount subTotalGeometriesIntersectedBehindCount;
+
+            for(std::size_t i = batchBegin + batchSize * chunk / nbChunks; i < batchBegin + batchSize * (chunk + 1) / nbChunks; ++i)
             {
-                assert(v.cams[c] >= 0);
-                assert(v.cams[c] < _mp.ncams);
-
-                int stepsFront = 0;
-                int stepsBehind = 0;
-                GeometriesCount geometriesIntersectedFrontCount;
-                GeometriesCount geometriesIntersectedBehindCount;
-                fillGraphPartPtRc(stepsFront, stepsBehind, geometriesIntersectedFrontCount,
-                                  geometriesIntersectedBehindCount, vertexIndex, v.cams[c], weight, fullWeight,
-                                  nPixelSizeBehind,
-                                  fillOut, distFcnHeight);
-
-                totalStepsFront += stepsFront;
-                totalRayFront += 1;
-                totalStepsBehind += stepsBehind;
-                totalRayBehind += 1;
-
-                subTotalGeometriesIntersectedFrontCount += geometriesIntersectedFrontCount;
-                subTotalGeometriesIntersectedBehindCount += geometriesIntersectedBehindCount;
-            } // for c
-
-            totalCamHaveVisibilityOnVertex += v.cams.size();
-            totalOfVertex += 1;
+                const int vertexIndex = rayVertices[i];
+                const GC_vertexInfo& v = _verticesAttr[vertexIndex];
+
+                // "weight" is called alpha(p) in the paper
+                const float weight = weightFcn((float)v.nrc, labatutWeights, v.getNbCameras()); // number of cameras
+
+                for(int c = 0; c < v.cams.size(); c++)
+                {
+                    assert(v.cams[c] >= 0);
+                    assert(v.cams[c] < _mp.ncams);
+
+                    int stepsFront = 0;
+                    int stepsBehind = 0;
+                    GeometriesCount geometriesIntersectedFrontCount;
+                    GeometriesCount geometriesIntersectedBehindCount;
+                    fillGraphPartPtRc(stepsFront, stepsBehind, geometriesIntersectedFrontCount,
+                                      geometriesIntersectedBehindCount, vertexIndex, v.cams[c], weight, fullWeight,
+                                      nPixelSizeBehind,
+                                      fillOut, distFcnHeight, votes);
+
+                    totalStepsFront += stepsFront;
+                    totalRayFront += 1;
+                    totalStepsBehind += stepsBehind;
+                    totalRayBehind += 1;
+
+                    subTotalGeometriesIntersectedFrontCount += geometriesIntersectedFrontCount;
+                    subTotalGeometriesIntersectedBehindCount += geometriesIntersectedBehindCount;
+                } // for c
+
+                totalCamHaveVisibilityOnVertex += v.cams.size();
+                totalOfVertex += 1;
+            }
 
             boost::atomic_ref<std::size_t>{totalGeometriesIntersectedFrontCount.facets} +=
                     subTotalGeometriesIntersectedFrontCount.facets;
@@ -1934,9 +2343,26 @@ void DelaunayGraphCut::fillGraph(double nPixelSizeBehind, bool labatutWeights, b
             boost::atomic_ref<std::size_t>{totalGeometriesIntersectedBehindCount.edges} +=
                     subTotalGeometriesIntersectedBehindCount.edges;
         }
+
+        traversalDuration += timer.elapsed();
+        timer.reset();
+
+        applyCellWeightVotes(chunkVotes);
+        for(CellWeightVotes& votes : chunkVotes)
+            votes.clear();
+
+        mergeDuration += timer.elapsed();
+
+        for(std::size_t i = batchBegin; i < batchEnd; ++i)
+        {
+            if(++nbProcessedVertices % progressStep == 0)
+                ++progressDisplay;
+        }
+
+        batchBegin = batchEnd;
     }
 
-    ALICEVISION_LOG_DEBUG("_verticesAttr.size(): " << _verticesAttr.size() << "(" << verticesRandIds.size() << ")");
+    ALICEVISION_LOG_DEBUG("_verticesAttr.size(): " << _verticesAttr.size() << "(" << rayVertices.size() << ")");
     ALICEVISION_LOG_DEBUG("totalIsRealNrc: " << totalIsRealNrc);
     ALICEVISION_LOG_DEBUG("totalStepsFront//totalRayFront = " << totalStepsFront << " // " << totalRayFront);
     ALICEVISION_LOG_DEBUG("totalStepsBehind//totalRayBehind = " << totalStepsBehind << " // " << totalRayBehind);
@@ -1949,13 +2375,14 @@ void DelaunayGraphCut::fillGraph(double nPixelSizeBehind, bool labatutWeights, b
     totalGeometriesIntersectedBehindCount /= totalCamHaveVisibilityOnVertex;
     ALICEVISION_LOG_DEBUG("Front per vertex: " << totalGeometriesIntersectedFrontCount);
     ALICEVISION_LOG_DEBUG("Behind per vertex: " << totalGeometriesIntersectedBehindCount);
+    ALICEVISION_LOG_INFO("s-t graph weights phases (s): rays sort: " << sortDuration << ", traversal: " << traversalDuration << ", votes merge: " << mergeDuration);
     mvsUtils::printfElapsedTime(t1, "s-t graph weights computed : ");
 }
 
 void DelaunayGraphCut::fillGraphPartPtRc(
     int& outTotalStepsFront, int& outTotalStepsBehind, GeometriesCount& outFrontCount, GeometriesCount& outBehindCount,
     int vertexIndex, int cam, float weight, float fullWeight, double nPixelSizeBehind,
-                                       bool fillOut, float distFcnHeight)  // nPixelSizeBehind=2*spaceSteps allPoints=1 behind=0 fillOut=1 distFcnHeight=0
+                                       bool fillOut, float distFcnHeight, CellWeightVotes& votes)  // nPixelSizeBehind=2*spaceSteps allPoints=1 behind=0 fillOut=1 distFcnHeight=0
 {
     const int maxint = 1000000; // std::numeric_limits<int>::std::max()
     const double marginEpsilonFactor = 1.0e-4;
@@ -2032,11 +2459,11 @@ void DelaunayGraphCut::fillGraphPartPtRc(
             if (geometry.type == EGeometryType::Facet)
             {
                 ++outFrontCount.facets;
-                boost::atomic_ref<float>{_cellsAttr[geometry.facet.cellIndex].emptinessScore} += weight;
+                votes.add(geometry.facet.cellIndex, CellWeightVotes::EMPTINESS, weight);
 
                 {
                     const float dist = distFcn(maxDist, (originPt - lastIntersectPt).size(), distFcnHeight);
-                    boost::atomic_ref<float>{_cellsAttr[geometry.facet.cellIndex].gEdgeVisWeight[geometry.facet.localVertexIndex]} += weight * dist;
+                    votes.add(geometry.facet.cellIndex, CellWeightVotes::EDGE_VIS + geometry.facet.localVertexIndex, weight * dist);
                 }
 
                 // Take the mirror facet to iterate over the next cell
@@ -2063,7 +2490,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
                 // These geometries do not have a cellIndex, so we use the previousGeometry to retrieve the cell between the previous geometry and the current one.
                 if (previousGeometry.type == EGeometryType::Facet)
                 {
-                    boost::atomic_ref<float>{_cellsAttr[previousGeometry.facet.cellIndex].emptinessScore} += weight;
+                    votes.add(previousGeometry.facet.cellIndex, CellWeightVotes::EMPTINESS, weight);
                 }
 
                 if (geometry.type == EGeometryType::Vertex)
@@ -2091,7 +2518,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
             if (lastIntersectedFacet.cellIndex != GEO::NO_CELL &&
                 (_mp.CArr[cam] - intersectPt).size() < 0.2 * pointCamDistance)
             {
-                boost::atomic_ref<float>{_cellsAttr[lastIntersectedFacet.cellIndex].cellSWeight} = (float)maxint;
+                votes.add(lastIntersectedFacet.cellIndex, CellWeightVotes::S_WEIGHT, (float)maxint);
             }
         }
 
@@ -2103,7 +2530,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
                 // lastGeoIsVertex is supposed to be positive in almost all cases.
                 // If we do not reach the camera, we still vote on the last tetrehedra.
                 // Possible reaisons: the camera is not part of the vertices or we encounter a numerical error in intersectNextGeom
-                boost::atomic_ref<float>{_cellsAttr[lastIntersectedFacet.cellIndex].cellSWeight} = (float)maxint;
+                votes.add(lastIntersectedFacet.cellIndex, CellWeightVotes::S_WEIGHT, (float)maxint);
             }
             // else
             // {
@@ -2176,11 +2603,11 @@ void DelaunayGraphCut::fillGraphPartPtRc(
                 // Vote for the first cell found (only once)
                 if (firstIteration)
                 {
-                    boost::atomic_ref<float>{_cellsAttr[geometry.facet.cellIndex].on} += fWeight;
+                    votes.add(geometry.facet.cellIndex, CellWeightVotes::ON, fWeight);
                     firstIteration = false;
                 }
 
-                boost::atomic_ref<float>{_cellsAttr[geometry.facet.cellIndex].fullnessScore} += fWeight;
+                votes.add(geometry.facet.cellIndex, CellWeightVotes::FULLNESS, fWeight);
 
                 // Take the mirror facet to iterate over the next cell
                 const Facet mFacet = mirrorFacet(geometry.facet);
@@ -2194,8 +2621,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
 
                 {
                     const float dist = distFcn(maxDist, (originPt - lastIntersectPt).size(), distFcnHeight);
-                    boost::atomic_ref<float>{_cellsAttr[geometry.facet.cellIndex].gEdgeVisWeight[geometry.facet.localVertexIndex]} +=
-                        fWeight * dist;
+                    votes.add(geometry.facet.cellIndex, CellWeightVotes::EDGE_VIS + geometry.facet.localVertexIndex, fWeight * dist);
                 }
                 if(previousGeometry.type == EGeometryType::Facet && outBehindCount.facets > 1000)
                 {
@@ -2223,7 +2649,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
 
                     for (const CellIndex& ci : neighboringCells)
                     {
-                        boost::atomic_ref<float>{_cellsAttr[neighboringCells[0]].on} += fWeight;
+                        votes.add(neighboringCells[0], CellWeightVotes::ON, fWeight);
                     }
                     firstIteration = false;
                 }
@@ -2232,7 +2658,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
                 // These geometries do not have a cellIndex, so we use the previousGeometry to retrieve the cell between the previous geometry and the current one.
                 if (previousGeometry.type == EGeometryType::Facet)
                 {
-                    boost::atomic_ref<float>{_cellsAttr[previousGeometry.facet.cellIndex].fullnessScore} += fWeight;
+                    votes.add(previousGeometry.facet.cellIndex, CellWeightVotes::FULLNESS, fWeight);
                 }
 
                 if (geometry.type == EGeometryType::Vertex)
@@ -2260,7 +2686,7 @@ void DelaunayGraphCut::fillGraphPartPtRc(
         // Vote for the last intersected facet (farthest from the camera)
         if (lastIntersectedFacet.cellIndex != GEO::NO_CELL)
         {
-            boost::atomic_ref<float>{_cellsAttr[lastIntersectedFacet.cellIndex].cellTWeight} += fWeight;
+            votes.add(lastIntersectedFacet.cellIndex, CellWeightVotes::T_WEIGHT, fWeight);
         }
     }
 }
@@ -3116,6 +3542,21 @@ void DelaunayGraphCut::addToInfiniteSw(float sW)
 }
 
 void DelaunayGraphCut::maxflow()
+{
+    const std::string maxflowSolver = _mp.userParams.get<std::string>("delaunaycut.maxflowSolver", "boykovKolmogorov");
+
+    ALICEVISION_LOG_INFO("Maxflow solver: " << maxflowSolver);
+
+    if(maxflowSolver == "boykovKolmogorov")
+        maxflowWithSolver<MaxFlow_AdjList>();
+    else if(maxflowSolver == "pushRelabel")
+        maxflowWithSolver<MaxFlow_PushRelabel>();
+    else
+        throw std::invalid_argument("Unknown maxflow solver: " + maxflowSolver);
+}
+
+template <typename MaxFlowT>
+void DelaunayGraphCut::maxflowWithSolver()
 {
     long t_maxflow = clock();
 
@@ -3124,7 +3565,7 @@ void DelaunayGraphCut::maxflow()
     ALICEVISION_LOG_INFO("Number of cells: " << nbCells);
 
     // MaxFlow_CSR maxFlowGraph(nbCells);
-    MaxFlow_AdjList maxFlowGraph(nbCells);
+    MaxFlowT maxFlowGraph(nbCells);
 
     ALICEVISION_LOG_INFO("Maxflow: add nodes.");
     // fill s-t edges
@@ -3189,11 +3630,13 @@ void DelaunayGraphCut::maxflow()
     ALICEVISION_LOG_INFO("Maxflow: clear cells info.");
     std::vector<GC_cellInfo>().swap(_cellsAttr); // force clear to free some RAM before maxflow
 
-    long t_maxflow_compute = clock();
+    // wall-clock time, the solver may be multi-threaded
+    system::Timer timerCompute;
     // Find graph-cut solution
     ALICEVISION_LOG_INFO("Maxflow: compute.");
     const float totalFlow = maxFlowGraph.compute();
-    mvsUtils::printfElapsedTime(t_maxflow_compute, "Maxflow computation ");
+    ALICEVISION_LOG_INFO("Maxflow computation done in " << system::prettyTime(timerCompute.elapsedMs())
+                         << " (peak memory: " << (system::getPeakProcessMemory() / (1024 * 1024)) << " MB).");
     ALICEVISION_LOG_INFO("totalFlow: " << totalFlow);
 
     ALICEVISION_LOG_INFO("Maxflow: update full/empty cells status.");
@@ -21,6 +21,8 @@
 #include <geogram/mesh/mesh.h>
 #include <geogram/basic/geometry_nd.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <set>
 
@@ -204,6 +206,59 @@ public:
         }
     };
 
+    /**
+     * @brief Weights voted for the cells by a group of rays.
+     *
+     * The votes are bucketed by cell index range, so the votes of several groups can be merged
+     * in parallel (one thread per bucket) and in a fixed order, without atomics.
+     */
+    class CellWeightVotes
+    {
+    public:
+        enum EWeight : std::uint8_t
+        {
+            EMPTINESS = 0,
+            FULLNESS,
+            ON,
+            S_WEIGHT,
+            T_WEIGHT,
+            /// gEdgeVisWeight of the facet local index: EDGE_VIS + localVertexIndex
+            EDGE_VIS
+        };
+
+        struct Vote
+        {
+            CellIndex cellIndex;
+            std::uint8_t weight;
+            float value;
+        };
+
+        void init(std::size_t nbCells, std::size_t nbBuckets)
+        {
+            _bucketSize = std::max(std::size_t(1), (nbCells + nbBuckets - 1) / nbBuckets);
+            _buckets.resize(nbBuckets);
+        }
+
+        inline void add(CellIndex ci, std::uint8_t weight, float value)
+        {
+            _buckets[ci / _bucketSize].push_back({ci, weight, value});
+        }
+
+        inline std::size_t getNbBuckets() const { return _buckets.size(); }
+        inline const std::vector<Vote>& getBucket(std::size_t b) const { return _buckets[b]; }
+
+        /// remove the votes, keep the memory for the next group of rays
+        void clear()
+        {
+            for(auto& bucket : _buckets)
+                bucket.clear();
+        }
+
+    private:
+        std::size_t _bucketSize = 1;
+        std::vector<std::vector<Vote>> _buckets;
+    };
+
     mvsUtils::MultiViewParams& _mp;
 
     GEO::Delaunay_var _tetrahedralization;
@@ -218,6 +273,9 @@ public:
 
     std::vector<int> _camsVertexes;
     std::vector<std::vector<CellIndex>> _neighboringCellsPerVertex;
+    /// local vertex index of the mirror facet (in the adjacent cell) of the 4 facets of each cell, on 2 bits per facet,
+    /// built by initCells: the adjacent cell is already stored by the tetrahedralization, so only 1 byte per cell is added
+    std::vector<std::uint8_t> _mirrorLocalVertexIndexes;
 
     bool saveTemporaryBinFiles;
 
@@ -310,6 +368,21 @@ public:
     }
 
     inline Facet mirrorFacet(const Facet& f) const
+    {
+        if(_mirrorLocalVertexIndexes.empty())
+            return computeMirrorFacet(f);
+
+        Facet out;
+        out.cellIndex = _tetrahedralization->cell_adjacent(f.cellIndex, f.localVertexIndex);
+        if(out.cellIndex != GEO::NO_CELL)
+            out.localVertexIndex = (_mirrorLocalVertexIndexes[f.cellIndex] >> (2 * f.localVertexIndex)) & 3;
+        return out;
+    }
+
+    /**
+     * @brief Find the mirror facet in the adjacent cell from the tetrahedralization.
+     */
+    inline Facet computeMirrorFacet(const Facet& f) const
     {
         const std::array<VertexIndex, 3> facetVertices = {
             getVertexIndex(f, 0),
@@ -335,36 +408,11 @@ public:
         return out;
     }
 
-    void updateVertexToCellsCache()
-    {
-        _neighboringCellsPerVertex.clear();
-
-        std::map<VertexIndex, std::set<CellIndex>> neighboringCellsPerVertexTmp;
-        int coutInvalidVertices = 0;
-        for (CellIndex ci = 0; ci < _tetrahedralization->nb_cells(); ++ci)
-        {
-            for(VertexIndex k = 0; k < 4; ++k)
-            {
-                const VertexIndex vi = _tetrahedralization->cell_vertex(ci, k);
-                if(vi == GEO::NO_VERTEX || vi >= _verticesCoords.size())
-                {
-                    ++coutInvalidVertices;
-                    continue;
-                }
-                neighboringCellsPerVertexTmp[vi].insert(ci);
-            }
-        }
-        ALICEVISION_LOG_INFO("coutInvalidVertices: " << coutInvalidVertices);
-        ALICEVISION_LOG_INFO("neighboringCellsPerVertexTmp: " << neighboringCellsPerVertexTmp.size());
-        _neighboringCellsPerVertex.resize(_verticesCoords.size());
-        ALICEVISION_LOG_INFO("verticesCoords: " << _verticesCoords.size());
-        for(const auto& it: neighboringCellsPerVertexTmp)
-        {
-            const std::set<CellIndex>& input = it.second;
-            std::vector<CellIndex>& output = _neighboringCellsPerVertex[it.first];
-            output.assign(input.begin(), input.end());
-        }
-    }
+    /**
+     * @brief Rebuild the vertex to neighboring cells cache from the tetrahedralization.
+     * @note Multi-threaded, each neighboring cell list is sorted by cell index.
+     */
+    void updateVertexToCellsCache();
 
     /**
      * @brief vertexToCells
@@ -503,7 +551,20 @@ public:
     void fillGraph(double nPixelSizeBehind, bool labatutWeights, bool fillOut, float distFcnHeight,
                            float fullWeight);
     void fillGraphPartPtRc(int& out_nstepsFront, int& out_nstepsBehind, GeometriesCount& outFrontCount, GeometriesCount& outBehindCount, int vertexIndex, int cam, float weight,
-                           float fullWeight, double nPixelSizeBehind, bool fillOut, float distFcnHeight);
+                           float fullWeight, double nPixelSizeBehind, bool fillOut, float distFcnHeight, CellWeightVotes& votes);
+
+    /**
+     * @brief Add the cell weights voted by groups of rays to the cells.
+     * @note Multi-threaded over the vote buckets, the groups are merged in order so the result is deterministic.
+     * @param[in] votes the votes of each group of rays
+     */
+    void applyCellWeightVotes(const std::vector<CellWeightVotes>& votes);
+
+    /**
+     * @brief Get the real vertices ordered along a Morton curve, so consecutive rays cross neighboring cells.
+     * @return the ordered vertex indexes
+     */
+    std::vector<VertexIndex> getSpatiallySortedRealVertices() const;
 
     /**
      * @brief Estimate the cells property "on" based on the analysis of the visibility of neigbouring cells.
@@ -516,8 +577,20 @@ public:
 
     void addToInfiniteSw(float sW);
 
+    /**
+     * @brief Compute the minimum s-t cut of the cells graph and update the full/empty status of cells.
+     * @note The solver is selected with the "delaunaycut.maxflowSolver" user parameter:
+     *       "boykovKolmogorov" (default, sequential) or "pushRelabel" (multi-threaded).
+     */
     void maxflow();
 
+    /**
+     * @brief Compute the minimum s-t cut of the cells graph with the given solver.
+     * @see maxflow
+     */
+    template <typename MaxFlowT>
+    void maxflowWithSolver();
+
     void voteFullEmptyScore(const StaticVector<int>& cams, const std::string& folderName);
 
     void createDensePointCloud(const Point3d hexah[8], const StaticVector<int>& cams, const sfmData::SfMData* sfmData, const FuseParams* depthMapsFuseParams);
@@ -12,6 +12,8 @@
 
 #include <boost/math/constants/constants.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 
 #define BOOST_TEST_MODULE fuseCut
@@ -109,6 +111,156 @@ BOOST_AUTO_TEST_CASE(fuseCut_delaunayGraphCut)
     ALICEVISION_LOG_TRACE("CreateGraphCut Done.");
 }
 
+BOOST_AUTO_TEST_CASE(fuseCut_delaunayGraphCut_maxflowSolvers)
+{
+    makeRandomOperationsReproducible();
+
+    const NViewDatasetConfigurator config(1000, 1000, 500, 500, 1, 0);
+    SfMData sfmData = generateSfm(config, 6);
+
+    mvsUtils::MultiViewParams mp(sfmData, "", "", "", false);
+
+    mp.userParams.put("LargeScale.universePercentile", 0.999);
+    mp.userParams.put("delaunaycut.forceTEdgeDelta", 0.1f);
+    mp.userParams.put("delaunaycut.seed", 1);
+
+    std::array<Point3d, 8> hexah;
+
+    Fuser fs(mp);
+    fs.divideSpaceFromSfM(sfmData, &hexah[0], 2, 0.01f);
+
+    StaticVector<int> cams;
+    cams.resize(mp.getNbCameras());
+    for (int i = 0; i < cams.size(); ++i)
+        cams[i] = i;
+
+    const std::string tempDirPath = boost::filesystem::temp_directory_path().generic_string();
+
+    DelaunayGraphCut delaunayGC(mp);
+
+    const float minDist = (hexah[0] - hexah[1]).size() / 1000.0f;
+    delaunayGC.addPointsFromCameraCenters(cams, minDist);
+    delaunayGC.addPointsFromSfM(&hexah[0], cams, sfmData);
+
+    delaunayGC.computeDelaunay();
+    delaunayGC.voteFullEmptyScore(cams, tempDirPath + "/");
+
+    // maxflow releases the cells information, keep a copy to run each solver on the same graph
+    const std::vector<GC_cellInfo> cellsAttr = delaunayGC._cellsAttr;
+
+    mp.userParams.put("delaunaycut.maxflowSolver", "boykovKolmogorov");
+    delaunayGC.maxflow();
+    const std::vector<bool> cellIsFullBoykovKolmogorov = delaunayGC._cellIsFull;
+
+    delaunayGC._cellsAttr = cellsAttr;
+    mp.userParams.put("delaunaycut.maxflowSolver", "pushRelabel");
+    delaunayGC.maxflow();
+
+    BOOST_CHECK(cellIsFullBoykovKolmogorov == delaunayGC._cellIsFull);
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_delaunayGraphCut_batchedVotes)
+{
+    makeRandomOperationsReproducible();
+
+    const NViewDatasetConfigurator config(1000, 1000, 500, 500, 1, 0);
+    SfMData sfmData = generateSfm(config, 6);
+
+    mvsUtils::MultiViewParams mp(sfmData, "", "", "", false);
+
+    mp.userParams.put("LargeScale.universePercentile", 0.999);
+
+    std::array<Point3d, 8> hexah;
+
+    Fuser fs(mp);
+    fs.divideSpaceFromSfM(sfmData, &hexah[0], 2, 0.01f);
+
+    StaticVector<int> cams;
+    cams.resize(mp.getNbCameras());
+    for (int i = 0; i < cams.size(); ++i)
+        cams[i] = i;
+
+    DelaunayGraphCut delaunayGC(mp);
+
+    const float minDist = (hexah[0] - hexah[1]).size() / 1000.0f;
+    delaunayGC.addPointsFromCameraCenters(cams, minDist);
+    delaunayGC.addPointsFromSfM(&hexah[0], cams, sfmData);
+
+    delaunayGC.computeDelaunay();
+
+    // the cached mirror facets are the ones found in the tetrahedralization
+    BOOST_REQUIRE_EQUAL(delaunayGC._mirrorLocalVertexIndexes.size(), delaunayGC._cellsAttr.size());
+    for (DelaunayGraphCut::CellIndex ci = 0; ci < delaunayGC._cellsAttr.size(); ++ci)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            const DelaunayGraphCut::Facet f(ci, k);
+            BOOST_CHECK(delaunayGC.mirrorFacet(f) == delaunayGC.computeMirrorFacet(f));
+        }
+    }
+
+    const double nPixelSizeBehind = 4.0;
+    const float distFcnHeight = 0.0f;
+    const float fullWeight = 1.0f;
+
+    // batched votes, merged per cell after each batch of rays
+    delaunayGC.fillGraph(nPixelSizeBehind, false, true, distFcnHeight, fullWeight);
+    const std::vector<GC_cellInfo> batchedCellsAttr = delaunayGC._cellsAttr;
+
+    // reference: each ray updates the cell weights directly, in the vertices order, without the mirror facets cache
+    delaunayGC._mirrorLocalVertexIndexes.clear();
+    for (GC_cellInfo& c : delaunayGC._cellsAttr)
+        c = GC_cellInfo();
+
+    std::vector<DelaunayGraphCut::CellWeightVotes> rayVotes(1);
+    rayVotes.front().init(delaunayGC._cellsAttr.size(), 1);
+
+    for (int vi = 0; vi < delaunayGC._verticesAttr.size(); ++vi)
+    {
+        const GC_vertexInfo& v = delaunayGC._verticesAttr[vi];
+        if (!v.isReal())
+            continue;
+
+        const float weight = delaunayGC.weightFcn((float)v.nrc, false, v.getNbCameras());
+        for (int c = 0; c < v.cams.size(); ++c)
+        {
+            int stepsFront = 0;
+            int stepsBehind = 0;
+            DelaunayGraphCut::GeometriesCount frontCount;
+            DelaunayGraphCut::GeometriesCount behindCount;
+            delaunayGC.fillGraphPartPtRc(stepsFront, stepsBehind, frontCount, behindCount, vi, v.cams[c], weight,
+                                         fullWeight, nPixelSizeBehind, true, distFcnHeight, rayVotes.front());
+            delaunayGC.applyCellWeightVotes(rayVotes);
+            rayVotes.front().clear();
+        }
+    }
+
+    // the weights are the same up to the floating point summation order
+    const auto isClose = [](float a, float b) { return std::abs(a - b) <= 1e-4f * std::max({1.0f, std::abs(a), std::abs(b)}); };
+
+    int nbVotedCells = 0;
+    int nbDifferentCells = 0;
+    for (std::size_t ci = 0; ci < batchedCellsAttr.size(); ++ci)
+    {
+        const GC_cellInfo& batched = batchedCellsAttr[ci];
+        const GC_cellInfo& reference = delaunayGC._cellsAttr[ci];
+
+        bool same = isClose(batched.cellSWeight, reference.cellSWeight) &&
+                    isClose(batched.cellTWeight, reference.cellTWeight) &&
+                    isClose(batched.fullnessScore, reference.fullnessScore) &&
+                    isClose(batched.emptinessScore, reference.emptinessScore) &&
+                    isClose(batched.on, reference.on);
+        for (int k = 0; k < 4; ++k)
+            same = same && isClose(batched.gEdgeVisWeight[k], reference.gEdgeVisWeight[k]);
+
+        nbDifferentCells += !same;
+        nbVotedCells += (reference.emptinessScore != 0.0f || reference.fullnessScore != 0.0f);
+    }
+
+    BOOST_CHECK_GT(nbVotedCells, 0);
+    BOOST_CHECK_EQUAL(nbDifferentCells, 0);
+}
+
 /**
  * @brief Generate syntesize dataset with succesion of n(size) alignaed regular thetraedron and two camera on the last thetrahedron.
  * 
@@ -0,0 +1,150 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "DepthMapsStream.hpp"
+#include <aliceVision/image/io.hpp>
+#include <aliceVision/mvsUtils/fileIO.hpp>
+#include <aliceVision/mvsUtils/depthSimMapIO.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace aliceVision {
+namespace fuseCut {
+
+namespace {
+
+void readDepthSimMaps(const mvsUtils::MultiViewParams& mp, int rc, int scale, bool readSimMaps, bool readNmodMaps,
+                      DepthSimMaps& maps)
+{
+    mvsUtils::readDepthMap(rc, mp, maps.depthMap, scale);
+
+    if(readSimMaps)
+    {
+        try
+        {
+            mvsUtils::readSimMap(rc, mp, maps.simMap, scale);
+        }
+        catch(const std::exception&)
+        {
+            // a missing similarity map is handled by the caller
+            maps.simMap = image::Image<float>();
+        }
+    }
+
+    if(readNmodMaps)
+    {
+        const std::string nmodMapFilepath = getFileNameFromIndex(mp, rc, mvsUtils::EFileType::nmodMap, scale);
+        if(boost::filesystem::exists(nmodMapFilepath))
+            image::readImage(nmodMapFilepath, maps.nmodMap, image::EImageColorSpace::NO_CONVERSION);
+    }
+}
+
+} // namespace
+
+DepthMapsStream::DepthMapsStream(const mvsUtils::MultiViewParams& mp, const std::vector<int>& cams, int scale,
+                                 bool readSimMaps, bool readNmodMaps, std::size_t maxPrefetch, int nbThreads)
+  : DepthMapsStream(cams,
+                    [&mp, scale, readSimMaps, readNmodMaps](int rc, DepthSimMaps& maps)
+                    {
+                        readDepthSimMaps(mp, rc, scale, readSimMaps, readNmodMaps, maps);
+                    },
+                    maxPrefetch, nbThreads)
+{}
+
+DepthMapsStream::DepthMapsStream(const std::vector<int>& cams, ReadFunction readFunction, std::size_t maxPrefetch, int nbThreads)
+  : _cams(cams)
+  , _readFunction(std::move(readFunction))
+  , _maxPrefetch(std::max({maxPrefetch, std::size_t(nbThreads), std::size_t(1)}))
+  , _errorIndex(std::numeric_limits<std::size_t>::max())
+{
+    const int nbDecoders = std::max(1, std::min(nbThreads, int(_cams.size())));
+    for(int i = 0; i < nbDecoders; ++i)
+        _threads.emplace_back(&DepthMapsStream::decode, this);
+}
+
+DepthMapsStream::~DepthMapsStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+    }
+    _condition.notify_all();
+    for(std::thread& thread : _threads)
+        thread.join();
+}
+
+bool DepthMapsStream::next(DepthSimMaps& maps)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this] {
+        return _nextToDeliver >= _cams.size() || _nextToDeliver == _errorIndex || _decoded.count(_nextToDeliver);
+    });
+
+    // the reading errors are raised after the cameras read before the error
+    if(_nextToDeliver == _errorIndex)
+        std::rethrow_exception(_error);
+
+    if(_nextToDeliver >= _cams.size())
+        return false;
+
+    const auto it = _decoded.find(_nextToDeliver);
+    maps = std::move(it->second);
+    _decoded.erase(it);
+    ++_nextToDeliver;
+    lock.unlock();
+    _condition.notify_all();
+    return true;
+}
+
+void DepthMapsStream::decode()
+{
+    while(true)
+    {
+        std::size_t index;
+        {
+            // wait until the camera fits in the prefetch window
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this] { return _stopped || _error || _nextToRead >= _cams.size() || _nextToRead < _nextToDeliver + _maxPrefetch; });
+            // no new camera after an error, the cameras before it are still decoded
+            if(_stopped || _error || _nextToRead >= _cams.size())
+                return;
+            index = _nextToRead++;
+        }
+
+        DepthSimMaps maps;
+        maps.rc = _cams[index];
+        std::exception_ptr error;
+
+        try
+        {
+            _readFunction(maps.rc, maps);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!error)
+            {
+                _decoded.emplace(index, std::move(maps));
+            }
+            else if(index < _errorIndex)
+            {
+                _errorIndex = index;
+                _error = error;
+            }
+        }
+        _condition.notify_all();
+    }
+}
+
+} // namespace fuseCut
+} // namespace aliceVision
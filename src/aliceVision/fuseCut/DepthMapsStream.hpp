@@ -0,0 +1,111 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/image/Image.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aliceVision {
+namespace fuseCut {
+
+/**
+ * @brief The maps of one camera read by a DepthMapsStream.
+ */
+struct DepthSimMaps
+{
+    /// camera index
+    int rc = -1;
+    image::Image<float> depthMap;
+    /// similarity map, empty if not requested or if it cannot be read
+    image::Image<float> simMap;
+    /// number of modals map, empty if not requested or if there is no such file
+    image::Image<unsigned char> nmodMap;
+};
+
+/**
+ * @brief Read the depth maps (and optionally the similarity / number of modals maps) of a list of cameras
+ *        in background threads, delivered in the cameras order.
+ *
+ * At most maxPrefetch cameras are decoded or waiting to be processed: the decoding of the next maps overlaps the
+ * processing of the current ones, without loading all the maps in memory.
+ */
+class DepthMapsStream
+{
+public:
+    /// Read the maps of a camera, an exception is rethrown by next() in the cameras order
+    using ReadFunction = std::function<void(int rc, DepthSimMaps& maps)>;
+
+    /**
+     * @brief Start reading the maps from the depth maps folders.
+     * @param[in] mp the multi-view parameters
+     * @param[in] cams the camera indexes to read
+     * @param[in] scale the depth/sim map downscale factor
+     * @param[in] readSimMaps read the similarity maps
+     * @param[in] readNmodMaps read the number of modals maps
+     * @param[in] maxPrefetch the maximum number of cameras decoded or waiting to be processed
+     * @param[in] nbThreads the number of decoding threads
+     */
+    DepthMapsStream(const mvsUtils::MultiViewParams& mp, const std::vector<int>& cams, int scale,
+                    bool readSimMaps, bool readNmodMaps, std::size_t maxPrefetch = 2, int nbThreads = 2);
+
+    /**
+     * @brief Start reading the maps with a custom read function.
+     * @param[in] cams the camera indexes to read
+     * @param[in] readFunction the function reading the maps of a camera, called from the decoding threads
+     * @param[in] maxPrefetch the maximum number of cameras decoded or waiting to be processed
+     * @param[in] nbThreads the number of decoding threads
+     */
+    DepthMapsStream(const std::vector<int>& cams, ReadFunction readFunction, std::size_t maxPrefetch = 2, int nbThreads = 2);
+
+    /// Stop reading and wait for the decoding threads.
+    ~DepthMapsStream();
+
+    DepthMapsStream(const DepthMapsStream&) = delete;
+    DepthMapsStream& operator=(const DepthMapsStream&) = delete;
+
+    /**
+     * @brief Get the maps of the next camera, wait until they are decoded.
+     * @note A reading error is rethrown here, once the cameras before the failed one have been delivered.
+     * @param[out] maps the maps of the next camera
+     * @return false if all the cameras have been read
+     */
+    bool next(DepthSimMaps& maps);
+
+private:
+    void decode();
+
+    const std::vector<int> _cams;
+    const ReadFunction _readFunction;
+    const std::size_t _maxPrefetch;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    /// decoded maps per index in the cameras list
+    std::map<std::size_t, DepthSimMaps> _decoded;
+    /// index of the next camera to decode
+    std::size_t _nextToRead = 0;
+    /// index of the next camera to deliver
+    std::size_t _nextToDeliver = 0;
+    /// index of the first camera that cannot be read
+    std::size_t _errorIndex;
+    std::exception_ptr _error;
+    bool _stopped = false;
+    std::vector<std::thread> _threads;
+};
+
+} // namespace fuseCut
+} // namespace aliceVision
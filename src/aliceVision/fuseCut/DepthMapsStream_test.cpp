@@ -0,0 +1,132 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/fuseCut/DepthMapsStream.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+#define BOOST_TEST_MODULE fuseCutDepthMapsStream
+
+#include <boost/test/unit_test.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::fuseCut;
+
+namespace {
+
+/// read function filling the depth map with the camera index, the first cameras are the slowest to decode
+DepthMapsStream::ReadFunction createReadFunction(int nbCams, std::atomic<int>& nbReading, std::atomic<int>& maxNbReading)
+{
+    return [nbCams, &nbReading, &maxNbReading](int rc, DepthSimMaps& maps)
+    {
+        const int reading = ++nbReading;
+        int maxReading = maxNbReading.load();
+        while(reading > maxReading && !maxNbReading.compare_exchange_weak(maxReading, reading)) {}
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2 * (nbCams - rc)));
+        maps.depthMap.resize(4, 3, true, float(rc));
+
+        --nbReading;
+    };
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fuseCut_depthMapsStream_order)
+{
+    const int nbCams = 20;
+    std::vector<int> cams(nbCams);
+    std::iota(cams.begin(), cams.end(), 0);
+
+    for(const int nbThreads : {1, 2, 4})
+    {
+        std::atomic<int> nbReading(0);
+        std::atomic<int> maxNbReading(0);
+        const std::size_t maxPrefetch = 4;
+
+        DepthMapsStream stream(cams, createReadFunction(nbCams, nbReading, maxNbReading), maxPrefetch, nbThreads);
+
+        DepthSimMaps maps;
+        int expectedRc = 0;
+        while(stream.next(maps))
+        {
+            // the cameras are delivered in the input order, whatever the decoding order
+            BOOST_CHECK_EQUAL(maps.rc, expectedRc);
+            BOOST_CHECK_EQUAL(maps.depthMap.Width(), 4);
+            BOOST_CHECK_EQUAL(maps.depthMap(0, 0), float(expectedRc));
+            ++expectedRc;
+        }
+        BOOST_CHECK_EQUAL(expectedRc, nbCams);
+        BOOST_CHECK(!stream.next(maps));
+
+        BOOST_CHECK_LE(maxNbReading.load(), nbThreads);
+        if(nbThreads > 1)
+            BOOST_CHECK_GT(maxNbReading.load(), 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_depthMapsStream_error)
+{
+    const int nbCams = 12;
+    const int failedCam = 5;
+    std::vector<int> cams(nbCams);
+    std::iota(cams.begin(), cams.end(), 0);
+
+    for(const int nbThreads : {1, 3})
+    {
+        std::atomic<int> nbRead(0);
+        DepthMapsStream stream(cams,
+                               [&nbRead](int rc, DepthSimMaps& maps)
+                               {
+                                   std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                                   if(rc == failedCam)
+                                       throw std::runtime_error("Cannot read the depth map.");
+                                   maps.depthMap.resize(4, 3, true, float(rc));
+                                   ++nbRead;
+                               },
+                               2, nbThreads);
+
+        // the cameras before the failed one are delivered, then the error is raised
+        DepthSimMaps maps;
+        for(int rc = 0; rc < failedCam; ++rc)
+        {
+            BOOST_REQUIRE(stream.next(maps));
+            BOOST_CHECK_EQUAL(maps.rc, rc);
+        }
+        BOOST_CHECK_THROW(stream.next(maps), std::runtime_error);
+
+        // the decoding stops after the error, within the prefetch window
+        BOOST_CHECK_LT(nbRead.load(), nbCams - 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_depthMapsStream_stop)
+{
+    const int nbCams = 50;
+    std::vector<int> cams(nbCams);
+    std::iota(cams.begin(), cams.end(), 0);
+
+    std::atomic<int> nbRead(0);
+    {
+        DepthMapsStream stream(cams,
+                               [&nbRead](int rc, DepthSimMaps& maps)
+                               {
+                                   std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                                   ++nbRead;
+                               },
+                               2, 2);
+
+        DepthSimMaps maps;
+        BOOST_REQUIRE(stream.next(maps));
+        BOOST_CHECK_EQUAL(maps.rc, 0);
+        // the destruction stops the decoding of the remaining cameras
+    }
+    BOOST_CHECK_LT(nbRead.load(), nbCams);
+}
@@ -5,6 +5,7 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "Fuser.hpp"
+#include <aliceVision/fuseCut/DepthMapsStream.hpp>
 #include <aliceVision/image/io.hpp>
 #include <aliceVision/system/Logger.hpp>
 #include <aliceVision/sfmData/SfMData.hpp>
@@ -15,6 +16,7 @@
 #include <aliceVision/mvsUtils/common.hpp>
 #include <aliceVision/mvsUtils/fileIO.hpp>
 #include <aliceVision/mvsUtils/depthSimMapIO.hpp>
+#include <aliceVision/numeric/numeric.hpp>
 #include <aliceVision/image/io.hpp>
 #include <aliceVision/image/imageAlgo.hpp>
 
@@ -22,7 +24,9 @@
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 
+#include <cstdint>
 #include <iostream>
+#include <numeric>
 
 namespace aliceVision {
 namespace fuseCut {
@@ -42,6 +46,57 @@ unsigned long computeNumberOfAllPoints(const mvsUtils::MultiViewParams& mp, int
     return npts;
 }
 
+/**
+ * @brief Check if the 3D points of a depth map region of a camera can be seen in the image of another camera.
+ * @note Conservative test: the points of the region are bounded by the frustum of the region between the depths
+ *       of its depth range, the region is seen if the projection of this frustum intersects the image.
+ * @param[in] mp the multi-view parameters
+ * @param[in] tc the camera index of the depth map
+ * @param[in] region the depth map region, at scale 1
+ * @param[in] rc the camera index of the image
+ * @return false if no point of the region can be seen in the image of rc
+ */
+bool isDepthMapRegionVisible(const mvsUtils::MultiViewParams& mp, int tc, const mvsUtils::DepthMapRegion& region, int rc)
+{
+    // whole map or unknown depth range
+    if(region.roi.isEmpty() || region.nbDepthValues == 0)
+        return true;
+
+    // the rays of iCamArr have a unit component along the optical axis: the point at a distance d along the ray
+    // of a pixel is at the depth d / |ray| along the optical axis, with |ray| >= 1 and maximal at a region corner
+    Point3d rays[4];
+    double maxRayNorm = 0.0;
+    for(int i = 0; i < 4; ++i)
+    {
+        const Point2d pix((i % 2) ? region.roi.x.end : region.roi.x.begin, (i / 2) ? region.roi.y.end : region.roi.y.begin);
+        rays[i] = mp.iCamArr[tc] * pix;
+        maxRayNorm = std::max(maxRayNorm, rays[i].size());
+    }
+
+    const double depths[2] = {region.minDepth / maxRayNorm, region.maxDepth};
+    Point2d pixMin(std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+    Point2d pixMax(-std::numeric_limits<double>::max(), -std::numeric_limits<double>::max());
+
+    for(const Point3d& ray : rays)
+    {
+        for(const double depth : depths)
+        {
+            const Point3d p = mp.camArr[rc] * (mp.CArr[tc] + ray * depth);
+
+            // behind the camera, the projection of the frustum cannot be bounded
+            if(p.z <= 0.0)
+                return true;
+
+            pixMin.x = std::min(pixMin.x, p.x / p.z);
+            pixMin.y = std::min(pixMin.y, p.y / p.z);
+            pixMax.x = std::max(pixMax.x, p.x / p.z);
+            pixMax.y = std::max(pixMax.y, p.y / p.z);
+        }
+    }
+
+    return (pixMax.x >= 0.0 && pixMax.y >= 0.0 && pixMin.x < mp.getWidth(rc) && pixMin.y < mp.getHeight(rc));
+}
+
 Fuser::Fuser(const mvsUtils::MultiViewParams& mp)
   : _mp(mp)
 {}
@@ -169,12 +224,48 @@ bool Fuser::filterGroupsRC(int rc, float pixToleranceFactor, int pixSizeBall, in
         numOfPtsMap->resize_with(w * h, 0);
         int tc = tcams[c];
 
-        image::Image<float> tcdepthMap;
+        // only read the region of the tc depth map whose points can be seen by rc,
+        // from the depth ranges of the tiles of the depth/sim map container
+        std::vector<mvsUtils::DepthMapRegion> tcRegions;
+        mvsUtils::getDepthMapRegions(tc, _mp, 1, tcRegions, 1);
 
-        mvsUtils::readDepthMap(tc, _mp, tcdepthMap, 1);
+        bool isVisible = false;
+        ROI tcRoi(std::numeric_limits<unsigned int>::max(), 0, std::numeric_limits<unsigned int>::max(), 0);
 
-        if (tcdepthMap.Height() > 0 && tcdepthMap.Width() > 0)
+        for(const mvsUtils::DepthMapRegion& region : tcRegions)
         {
+            if(!isDepthMapRegionVisible(_mp, tc, region, rc))
+                continue;
+
+            isVisible = true;
+
+            // whole map
+            if(region.roi.isEmpty())
+            {
+                tcRoi = ROI();
+                break;
+            }
+
+            tcRoi.x.begin = std::min(tcRoi.x.begin, region.roi.x.begin);
+            tcRoi.y.begin = std::min(tcRoi.y.begin, region.roi.y.begin);
+            tcRoi.x.end = std::max(tcRoi.x.end, region.roi.x.end);
+            tcRoi.y.end = std::max(tcRoi.y.end, region.roi.y.end);
+        }
+
+        // no point of tc can be seen by rc: the tc depth map is not read, the counts are unchanged
+        bool hasDepthMap = !isVisible;
+
+        if(isVisible)
+        {
+            image::Image<float> tcdepthMap;
+
+            mvsUtils::readDepthMap(tc, _mp, tcRoi, 1, tcdepthMap, 1);
+
+            hasDepthMap = (tcdepthMap.Height() > 0 && tcdepthMap.Width() > 0);
+
+            const int offsetX = tcRoi.isEmpty() ? 0 : tcRoi.x.begin;
+            const int offsetY = tcRoi.isEmpty() ? 0 : tcRoi.y.begin;
+
             for(int y = 0; y < tcdepthMap.Height(); ++y)
             {
                 for(int x = 0; x < tcdepthMap.Width(); ++x)
@@ -183,12 +274,15 @@ bool Fuser::filterGroupsRC(int rc, float pixToleranceFactor, int pixSizeBall, in
 
                     if(depth > 0.0f)
                     {
-                      Point3d p = _mp.CArr[tc] + (_mp.iCamArr[tc] * Point2d((float)x, (float)y)).normalize() * depth;
+                      Point3d p = _mp.CArr[tc] + (_mp.iCamArr[tc] * Point2d((float)(x + offsetX), (float)(y + offsetY))).normalize() * depth;
                       updateInSurr(pixToleranceFactor, pixSizeBall, pixSizeBallWSP, p, rc, tc, numOfPtsMap, depthMap, simMap, 1);
                     }
                 }
             }
+        }
 
+        if(hasDepthMap)
+        {
             for(int i = 0; i < w * h; i++)
             {
                 numOfModalsMap(i) += static_cast<int>((*numOfPtsMap)[i] > 0);
@@ -287,26 +381,45 @@ bool Fuser::filterDepthMapsRC(int rc, int minNumOfModals, int minNumOfModalsWSP2
     return true;
 }
 
-float Fuser::computeAveragePixelSizeInHexahedron(Point3d* hexah, int step, int scale)
+void Fuser::sampleDepthMaps(int scale, int step)
 {
-    int scaleuse = std::max(1, scale);
-
-    StaticVector<int> cams = _mp.findCamsWhichIntersectsHexahedron(hexah);
-    int j = 0;
-    float av = 0.0f;
-    float nav = 0.0f;
-    float minv = std::numeric_limits<float>::max();
-    //long t1 = mvsUtils::initEstimate();
-    for(int c = 0; c < cams.size(); c++)
+    if(_depthMapsSampleScale == scale && _depthMapsSampleStep == step)
+        return;
+
+    const int scaleuse = std::max(1, scale);
+
+    _depthMapsSamplePoints.clear();
+    _depthMapsSamplePixSizes.clear();
+
+    // Only one valid depth every step is sampled: the samples are taken on a downscaled level of the depth maps
+    // with the same density, the levels of the depth/sim map containers are read without decoding the full maps.
+    const int maxSampleDownscale = 8;
+    int downscale = 1;
+    while(downscale < maxSampleDownscale && 4 * downscale * downscale <= step)
+        downscale *= 2;
+    const std::uint64_t levelStep = std::max(1, step / (downscale * downscale));
+
+    std::vector<int> cams(_mp.ncams);
+    std::iota(cams.begin(), cams.end(), 0);
+    // the sampling is cheap compared to the decoding: more decoders on the downscaled maps
+    DepthMapsStream depthMapsStream(cams,
+                                    [this, scale, downscale](int rc, DepthSimMaps& maps)
+                                    {
+                                        mvsUtils::readDepthMap(rc, _mp, ROI(), downscale, maps.depthMap, scale);
+                                    },
+                                    4, 4);
+    DepthSimMaps maps;
+
+    // valid depths of all the cameras, more than INT_MAX on large scenes
+    std::uint64_t j = 0;
+    while(depthMapsStream.next(maps))
     {
-        int rc = cams[c];
-        int h = _mp.getHeight(rc) / scaleuse;
-        int w = _mp.getWidth(rc) / scaleuse;
-        image::Image<float> rcdepthMap;
-
-      mvsUtils::readDepthMap(rc, _mp, rcdepthMap, scale);
+        const int rc = maps.rc;
+        const int h = divideRoundUp(_mp.getHeight(rc) / scaleuse, downscale);
+        const int w = divideRoundUp(_mp.getWidth(rc) / scaleuse, downscale);
+        const image::Image<float>& rcdepthMap = maps.depthMap;
 
-        if (rcdepthMap.size() < w * h)
+        if(rcdepthMap.size() < w * h)
             throw std::runtime_error("Invalid image size");
 
         for(int y = 0; y < h; y++)
@@ -316,27 +429,46 @@ float Fuser::computeAveragePixelSizeInHexahedron(Point3d* hexah, int step, int s
                 const float depth = rcdepthMap(y, x);
                 if(depth > 0.0f)
                 {
-                    if(j % step == 0)
+                    if(j % levelStep == 0)
                     {
-                        Point3d p = _mp.CArr[rc] +
-                                    (_mp.iCamArr[rc] * Point2d((float)x * (float)scaleuse, (float)y * (float)scaleuse))
-                                            .normalize() *
-                                        depth;
-                        if(mvsUtils::isPointInHexahedron(p, hexah))
-                        {
-                            float v = _mp.getCamPixelSize(p, rc);
-                            av += v; // WARNING: the value may be too big for a float
-                            nav += 1.0f;
-                            minv = std::min(minv, v);
-                        }
+                        const float pixScale = (float)scaleuse * (float)downscale;
+                        const Point3d p = _mp.CArr[rc] +
+                                          (_mp.iCamArr[rc] * Point2d((float)x * pixScale, (float)y * pixScale))
+                                                  .normalize() *
+                                              depth;
+                        _depthMapsSamplePoints.push_back(p);
+                        _depthMapsSamplePixSizes.push_back(_mp.getCamPixelSize(p, rc));
                     }
                     j++;
                 }
             }
         }
-        //mvsUtils::printfEstimate(c, cams.size(), t1);
     }
-    //mvsUtils::finishEstimate();
+
+    _depthMapsSampleScale = scale;
+    _depthMapsSampleStep = step;
+
+    ALICEVISION_LOG_INFO(_depthMapsSamplePoints.size() << " points sampled from the depth maps.");
+}
+
+float Fuser::computeAveragePixelSizeInHexahedron(Point3d* hexah, int step, int scale)
+{
+    sampleDepthMaps(scale, step);
+
+    float av = 0.0f;
+    float nav = 0.0f;
+    float minv = std::numeric_limits<float>::max();
+
+    for(std::size_t i = 0; i < _depthMapsSamplePoints.size(); ++i)
+    {
+        if(mvsUtils::isPointInHexahedron(_depthMapsSamplePoints[i], hexah))
+        {
+            const float v = _depthMapsSamplePixSizes[i];
+            av += v; // WARNING: the value may be too big for a float
+            nav += 1.0f;
+            minv = std::min(minv, v);
+        }
+    }
 
     if(nav == 0.0f)
     {
@@ -385,41 +517,29 @@ float Fuser::computeAveragePixelSizeInHexahedron(Point3d* hexah, const sfmData::
  *@param[out] hexah: table of 8 values
  *@param[out] minPixSize
  */
+const std::vector<Point3d>& Fuser::getDepthMapsSamplePoints()
+{
+    // same sampling as estimateDimensions to read the depth maps only once
+    const int scale = 0;
+    const unsigned long npset = computeNumberOfAllPoints(_mp, scale);
+    const int stepPts = npset / (unsigned long)1000000 + 1;
+    sampleDepthMaps(scale, stepPts);
+    return _depthMapsSamplePoints;
+}
+
 void Fuser::divideSpaceFromDepthMaps(Point3d* hexah, float& minPixSize)
 {
     ALICEVISION_LOG_INFO("Estimate space from depth maps.");
-    int scale = 0;
 
-    unsigned long npset = computeNumberOfAllPoints(_mp, scale);
-    int stepPts = std::max(1, (int)(npset / (unsigned long)1000000));
+    getDepthMapsSamplePoints();
 
     minPixSize = std::numeric_limits<float>::max();
-    //long t1 = mvsUtils::initEstimate();
     Stat3d s3d = Stat3d();
-    for(int rc = 0; rc < _mp.ncams; rc++)
+    for(std::size_t i = 0; i < _depthMapsSamplePoints.size(); ++i)
     {
-        int w = _mp.getWidth(rc);
-
-        image::Image<float> depthMap;
-
-        mvsUtils::readDepthMap(rc, _mp, depthMap, scale);
-
-        for(int i = 0; i < depthMap.size(); i += stepPts)
-        {
-            int x = i % w;
-            int y = i / w;
-            float depth = depthMap(i);
-            if(depth > 0.0f)
-            {
-                Point3d p = _mp.CArr[rc] + (_mp.iCamArr[rc] * Point2d((float)x, (float)y)).normalize() * depth;
-                float pixSize = _mp.getCamPixelSize(p, rc);
-                minPixSize = std::min(minPixSize, pixSize);
-                s3d.update(&p);
-            }
-        }
-        //mvsUtils::printfEstimate(rc, _mp.ncams, t1);
+        minPixSize = std::min(minPixSize, _depthMapsSamplePixSizes[i]);
+        s3d.update(&_depthMapsSamplePoints[i]);
     }
-    //mvsUtils::finishEstimate();
 
     Point3d v1, v2, v3, cg;
     float d1, d2, d3;
@@ -437,45 +557,27 @@ void Fuser::divideSpaceFromDepthMaps(Point3d* hexah, float& minPixSize)
     Accumulator accZ1( tag::tail<right>::cache_size = cacheSize );
     Accumulator accZ2( tag::tail<right>::cache_size = cacheSize );
 
-    for(int rc = 0; rc < _mp.ncams; ++rc)
+    for(const Point3d& p : _depthMapsSamplePoints)
     {
-        int w = _mp.getWidth(rc);
-
-        image::Image<float> depthMap;
-
-        mvsUtils::readDepthMap(rc, _mp, depthMap, scale);
-
-        for(int i = 0; i < depthMap.size(); i += stepPts)
-        {
-            int x = i % w;
-            int y = i / w;
-            float depth = depthMap(i);
-            if(depth > 0.0f)
-            {
-                Point3d p = _mp.CArr[rc] + (_mp.iCamArr[rc] * Point2d((float)x, (float)y)).normalize() * depth;
-                float d1 = orientedPointPlaneDistance(p, cg, v1);
-                float d2 = orientedPointPlaneDistance(p, cg, v2);
-                float d3 = orientedPointPlaneDistance(p, cg, v3);
-
-                if(d1 < 0)
-                    accX1(fabs(d1));
-                else
-                    accX2(fabs(d1));
-
-                if(d2 < 0)
-                    accY1(fabs(d2));
-                else
-                    accY2(fabs(d2));
-
-                if(d3 < 0)
-                    accZ1(fabs(d3));
-                else
-                    accZ2(fabs(d3));
-            }
-        }
-        //mvsUtils::printfEstimate(rc, _mp.ncams, t1);
+        float d1 = orientedPointPlaneDistance(p, cg, v1);
+        float d2 = orientedPointPlaneDistance(p, cg, v2);
+        float d3 = orientedPointPlaneDistance(p, cg, v3);
+
+        if(d1 < 0)
+            accX1(fabs(d1));
+        else
+            accX2(fabs(d1));
+
+        if(d2 < 0)
+            accY1(fabs(d2));
+        else
+            accY2(fabs(d2));
+
+        if(d3 < 0)
+            accZ1(fabs(d3));
+        else
+            accZ2(fabs(d3));
     }
-    //mvsUtils::finishEstimate();
 
     float perc = (float)_mp.userParams.get<double>("LargeScale.universePercentile", 0.999f);
 
@@ -641,10 +743,10 @@ Voxel Fuser::estimateDimensions(Point3d* vox, Point3d* newSpace, int scale, int
 
     if(sfmData == nullptr)
     {
-      // WARNING perf: reload all depth maps to compute the minPixelSize (minPixelSize consider only points in the hexahedron)
+      // minPixelSize consider only points in the hexahedron, the depth maps samples are shared with divideSpaceFromDepthMaps
       // Average 3D size for each pixel from all 3D points in the current voxel
       const int maxPts = 1000000;
-      const int nAllPts = computeNumberOfAllPoints(_mp, scale);
+      const unsigned long nAllPts = computeNumberOfAllPoints(_mp, scale);
       const int stepPts = nAllPts / maxPts + 1;
       aAvPixelSize = computeAveragePixelSizeInHexahedron(vox, stepPts, scale) * (float)std::max(scale, 1) * pointToJoinPixSizeDist;
     }
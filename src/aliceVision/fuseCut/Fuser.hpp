@@ -40,11 +40,32 @@ public:
     float computeAveragePixelSizeInHexahedron(Point3d* hexah, int step, int scale);
     float computeAveragePixelSizeInHexahedron(Point3d* hexah, const sfmData::SfMData& sfmData);
 
+    /**
+     * @brief Get the 3D points sampled from the depth maps, the same sample as divideSpaceFromDepthMaps (about one million points).
+     * @return the sampled points
+     */
+    const std::vector<Point3d>& getDepthMapsSamplePoints();
+
     Voxel estimateDimensions(Point3d* vox, Point3d* newSpace, int scale, int maxOcTreeDim, const sfmData::SfMData* sfmData = nullptr);
 
 private:
+    /**
+     * @brief Sample the valid depths of all the depth maps, read only once for all the statistics.
+     * @note The samples are cached, nothing is read if the same scale and step are requested again.
+     * @param[in] scale the depth map downscale factor
+     * @param[in] step keep one valid depth every step valid depths
+     */
+    void sampleDepthMaps(int scale, int step);
+
     bool updateInSurr(float pixToleranceFactor, int pixSizeBall, int pixSizeBallWSP, Point3d& p, int rc, int tc, StaticVector<int>* numOfPtsMap,
                       const image::Image<float>& depthMap, const image::Image<float>& simMap, int scale);
+
+    /// 3D points sampled from the depth maps
+    std::vector<Point3d> _depthMapsSamplePoints;
+    /// pixel size of the sampled 3D points in their camera
+    std::vector<float> _depthMapsSamplePixSizes;
+    int _depthMapsSampleScale = -1;
+    int _depthMapsSampleStep = 0;
 };
 
 unsigned long computeNumberOfAllPoints(const mvsUtils::MultiViewParams& mp, int scale);
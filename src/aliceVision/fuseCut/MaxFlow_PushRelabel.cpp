@@ -0,0 +1,343 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "MaxFlow_PushRelabel.hpp"
+
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/alicevision_omp.hpp>
+
+#include <boost/atomic/atomic_ref.hpp>
+
+#include <algorithm>
+
+namespace aliceVision {
+namespace fuseCut {
+
+void MaxFlow_PushRelabel::buildGraph()
+{
+    const int nbNodes = int(_numNodes);
+
+    // count arcs per node (each input edge gives one arc and its reverse)
+    _firstArc.assign(_numNodes + 1, 0);
+    for(const InputEdge& edge : _edges)
+    {
+        ++_firstArc[edge.n1 + 1];
+        ++_firstArc[edge.n2 + 1];
+    }
+    for(int n = 0; n < nbNodes; ++n)
+        _firstArc[n + 1] += _firstArc[n];
+
+    const ArcIndex nbArcs = _firstArc[_numNodes];
+    _arcHead.resize(nbArcs);
+    _arcReverse.resize(nbArcs);
+    _arcResidual.resize(nbArcs);
+
+    // fill arcs
+    std::vector<ArcIndex> cursor(_firstArc.begin(), _firstArc.end() - 1);
+    for(const InputEdge& edge : _edges)
+    {
+        const ArcIndex a = cursor[edge.n1]++;
+        const ArcIndex ra = cursor[edge.n2]++;
+
+        _arcHead[a] = edge.n2;
+        _arcReverse[a] = ra;
+        _arcResidual[a] = edge.capacity;
+
+        _arcHead[ra] = edge.n1;
+        _arcReverse[ra] = a;
+        _arcResidual[ra] = edge.reverseCapacity;
+    }
+
+    // input edges are no longer needed
+    std::vector<InputEdge>().swap(_edges);
+
+    ALICEVISION_LOG_INFO("# vertices: " << _numNodes + 2);
+    ALICEVISION_LOG_INFO("# arcs: " << nbArcs);
+}
+
+void MaxFlow_PushRelabel::globalRelabel()
+{
+    const int nbNodes = int(_numNodes);
+    const int unreachableLabel = nbNodes + 1;
+
+    std::vector<NodeType> frontier;
+
+    #pragma omp parallel
+    {
+        std::vector<NodeType> localFrontier;
+
+        #pragma omp for
+        for(int n = 0; n < nbNodes; ++n)
+        {
+            if(_sinkCapacity[n] > 0)
+            {
+                _label[n] = 1;
+                localFrontier.push_back(NodeType(n));
+            }
+            else
+            {
+                _label[n] = unreachableLabel;
+            }
+        }
+
+        #pragma omp critical
+        frontier.insert(frontier.end(), localFrontier.begin(), localFrontier.end());
+    }
+
+    // backward breadth-first search from the sink
+    int level = 1;
+    std::vector<NodeType> nextFrontier;
+
+    while(!frontier.empty())
+    {
+        nextFrontier.clear();
+
+        #pragma omp parallel
+        {
+            std::vector<NodeType> localFrontier;
+
+            #pragma omp for schedule(dynamic, 256)
+            for(int i = 0; i < frontier.size(); ++i)
+            {
+                const NodeType w = frontier[i];
+                for(ArcIndex a = _firstArc[w]; a < _firstArc[w + 1]; ++a)
+                {
+                    // u can reach w if the arc (u, w) has a residual capacity
+                    if(_arcResidual[_arcReverse[a]] <= 0)
+                        continue;
+
+                    const NodeType u = _arcHead[a];
+                    int expected = unreachableLabel;
+                    if(boost::atomic_ref<int>(_label[u]).compare_exchange_strong(expected, level + 1))
+                        localFrontier.push_back(u);
+                }
+            }
+
+            #pragma omp critical
+            nextFrontier.insert(nextFrontier.end(), localFrontier.begin(), localFrontier.end());
+        }
+
+        frontier.swap(nextFrontier);
+        ++level;
+    }
+}
+
+void MaxFlow_PushRelabel::getActiveNodes(std::vector<NodeType>& out_activeNodes) const
+{
+    const int nbNodes = int(_numNodes);
+    const int unreachableLabel = nbNodes + 1;
+
+    out_activeNodes.clear();
+
+    #pragma omp parallel
+    {
+        std::vector<NodeType> localActiveNodes;
+
+        #pragma omp for
+        for(int n = 0; n < nbNodes; ++n)
+        {
+            if(_excess[n] > 0 && _label[n] < unreachableLabel)
+                localActiveNodes.push_back(NodeType(n));
+        }
+
+        #pragma omp critical
+        out_activeNodes.insert(out_activeNodes.end(), localActiveNodes.begin(), localActiveNodes.end());
+    }
+}
+
+MaxFlow_PushRelabel::ValueType MaxFlow_PushRelabel::compute()
+{
+    ALICEVISION_LOG_INFO("Compute parallel push-relabel max flow (" << omp_get_max_threads() << " threads).");
+
+    buildGraph();
+
+    const int nbNodes = int(_numNodes);
+    const int unreachableLabel = nbNodes + 1; // distance to the sink is at most the number of nodes
+
+    // saturate all source edges
+    _excess.swap(_sourceCapacity);
+    std::vector<ValueType>().swap(_sourceCapacity);
+
+    _label.resize(_numNodes);
+
+    // per node temporary buffers
+    std::vector<ValueType> addedExcess(_numNodes, 0.0f);
+    std::vector<unsigned char> isDiscovered(_numNodes, 0);
+
+    std::vector<NodeType> activeNodes;
+    std::vector<NodeType> discoveredNodes;
+    std::vector<int> newLabels;
+
+    double totalFlow = 0.0;
+    std::size_t nbRounds = 0;
+    std::size_t nbGlobalRelabels = 0;
+    std::size_t nbRelabelsSinceGlobalRelabel = 0;
+
+    // global relabel heuristic frequency
+    const std::size_t globalRelabelThreshold = std::max(std::size_t(1), _numNodes / 2);
+
+    globalRelabel();
+    ++nbGlobalRelabels;
+    getActiveNodes(activeNodes);
+
+    while(!activeNodes.empty())
+    {
+        ++nbRounds;
+        const int nbActiveNodes = int(activeNodes.size());
+        discoveredNodes.clear();
+
+        // push excess of each active node through its admissible arcs
+        // labels are frozen: an arc and its reverse cannot be both admissible, so only one node writes them
+        #pragma omp parallel reduction(+ : totalFlow)
+        {
+            std::vector<NodeType> localDiscoveredNodes;
+
+            #pragma omp for schedule(dynamic, 64)
+            for(int i = 0; i < nbActiveNodes; ++i)
+            {
+                const NodeType v = activeNodes[i];
+                const int label = _label[v];
+                ValueType excess = _excess[v];
+
+                // a node with a residual capacity to the sink has a label of 1
+                if(_sinkCapacity[v] > 0)
+                {
+                    const ValueType delta = std::min(excess, _sinkCapacity[v]);
+                    _sinkCapacity[v] -= delta;
+                    excess -= delta;
+                    totalFlow += delta;
+                }
+
+                for(ArcIndex a = _firstArc[v]; (a < _firstArc[v + 1]) && (excess > 0); ++a)
+                {
+                    const NodeType w = _arcHead[a];
+
+                    // check admissibility before reading the residual capacity
+                    if(_label[w] + 1 != label)
+                        continue;
+
+                    const ValueType residual = _arcResidual[a];
+                    if(residual <= 0)
+                        continue;
+
+                    const ValueType delta = std::min(residual, excess);
+                    _arcResidual[a] = residual - delta;
+                    _arcResidual[_arcReverse[a]] += delta;
+                    excess -= delta;
+
+                    boost::atomic_ref<ValueType>(addedExcess[w]).fetch_add(delta);
+
+                    if(!boost::atomic_ref<unsigned char>(isDiscovered[w]).exchange(1))
+                        localDiscoveredNodes.push_back(w);
+                }
+
+                _excess[v] = excess;
+            }
+
+            #pragma omp critical
+            discoveredNodes.insert(discoveredNodes.end(), localDiscoveredNodes.begin(), localDiscoveredNodes.end());
+        }
+
+        // relabel active nodes with a remaining excess, they have no admissible arc left
+        // new labels are computed from the previous labels, so simultaneous relabels keep a valid labeling
+        newLabels.resize(nbActiveNodes);
+        std::size_t nbRelabels = 0;
+
+        #pragma omp parallel for reduction(+ : nbRelabels)
+        for(int i = 0; i < nbActiveNodes; ++i)
+        {
+            const NodeType v = activeNodes[i];
+
+            if(_excess[v] <= 0)
+            {
+                newLabels[i] = _label[v];
+                continue;
+            }
+
+            int newLabel = (_sinkCapacity[v] > 0) ? 1 : unreachableLabel;
+            for(ArcIndex a = _firstArc[v]; a < _firstArc[v + 1]; ++a)
+            {
+                if(_arcResidual[a] > 0)
+                    newLabel = std::min(newLabel, _label[_arcHead[a]] + 1);
+            }
+            newLabels[i] = std::min(newLabel, unreachableLabel);
+            ++nbRelabels;
+        }
+
+        #pragma omp parallel for
+        for(int i = 0; i < nbActiveNodes; ++i)
+            _label[activeNodes[i]] = newLabels[i];
+
+        nbRelabelsSinceGlobalRelabel += nbRelabels;
+
+        // active nodes with a remaining excess stay active
+        for(int i = 0; i < nbActiveNodes; ++i)
+        {
+            const NodeType v = activeNodes[i];
+            if(_excess[v] > 0 && !isDiscovered[v])
+            {
+                isDiscovered[v] = 1;
+                discoveredNodes.push_back(v);
+            }
+        }
+
+        // apply added excess and build the next active node list
+        activeNodes.clear();
+
+        #pragma omp parallel
+        {
+            std::vector<NodeType> localActiveNodes;
+
+            #pragma omp for
+            for(int i = 0; i < discoveredNodes.size(); ++i)
+            {
+                const NodeType v = discoveredNodes[i];
+                isDiscovered[v] = 0;
+                _excess[v] += addedExcess[v];
+                addedExcess[v] = 0.0f;
+
+                if(_excess[v] > 0 && _label[v] < unreachableLabel)
+                    localActiveNodes.push_back(v);
+            }
+
+            #pragma omp critical
+            activeNodes.insert(activeNodes.end(), localActiveNodes.begin(), localActiveNodes.end());
+        }
+
+        if(nbRelabelsSinceGlobalRelabel > globalRelabelThreshold)
+        {
+            globalRelabel();
+            ++nbGlobalRelabels;
+            nbRelabelsSinceGlobalRelabel = 0;
+            getActiveNodes(activeNodes);
+        }
+    }
+
+    ALICEVISION_LOG_INFO("Push-relabel done: " << nbRounds << " rounds, " << nbGlobalRelabels << " global relabels.");
+
+    // a reachable label means that the node can reach the sink in the residual graph
+    globalRelabel();
+
+    _isTarget.resize(_numNodes + 2);
+    for(int n = 0; n < nbNodes; ++n)
+        _isTarget[n] = (_label[n] < unreachableLabel);
+    _isTarget[_S] = false;
+    _isTarget[_T] = true;
+
+    // release the graph, only the labeling is needed
+    std::vector<ArcIndex>().swap(_firstArc);
+    std::vector<NodeType>().swap(_arcHead);
+    std::vector<ArcIndex>().swap(_arcReverse);
+    std::vector<ValueType>().swap(_arcResidual);
+    std::vector<ValueType>().swap(_sinkCapacity);
+    std::vector<ValueType>().swap(_excess);
+    std::vector<int>().swap(_label);
+
+    return ValueType(totalFlow);
+}
+
+} // namespace fuseCut
+} // namespace aliceVision
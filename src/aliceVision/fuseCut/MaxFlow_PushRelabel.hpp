@@ -0,0 +1,135 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace aliceVision {
+namespace fuseCut {
+
+/**
+ * @brief Maxflow computation based on a synchronous parallel push-relabel algorithm.
+ *
+ * @note: Only the first phase of the push-relabel (maximum preflow) is computed, it is enough to retrieve the minimum cut.
+ * Each round pushes the excess of all active nodes in parallel using frozen labels (so two nodes never push
+ * on the same pair of arcs), then relabels them in parallel. A parallel global relabel (backward BFS from the sink)
+ * is done regularly.
+ *
+ * The output labeling is the same as MaxFlow_AdjList and MaxFlow_CSR (Boykov-Kolmogorov):
+ * a node is "target" (full) if it can reach the sink in the final residual graph.
+ *
+ * The graph is stored as a compressed sparse row where reverse arcs are known by construction,
+ * source/sink edges are stored per node.
+ */
+class MaxFlow_PushRelabel
+{
+public:
+    using NodeType = unsigned int;
+    using ValueType = float;
+    using ArcIndex = std::size_t;
+
+public:
+    explicit MaxFlow_PushRelabel(std::size_t numNodes)
+        : _numNodes(numNodes)
+        , _sourceCapacity(numNodes, 0.0f)
+        , _sinkCapacity(numNodes, 0.0f)
+        , _S(NodeType(numNodes))
+        , _T(NodeType(numNodes+1))
+    {
+        const std::size_t nbEdgesEstimation = numNodes * 4;
+        _edges.reserve(nbEdgesEstimation);
+    }
+
+    inline void addNode(NodeType n, ValueType source, ValueType sink)
+    {
+        assert(source >= 0 && sink >= 0);
+        const ValueType score = source - sink;
+        if(score > 0)
+        {
+            _sourceCapacity[n] += score;
+        }
+        else //if(score <= 0)
+        {
+            _sinkCapacity[n] += -score;
+        }
+    }
+
+    inline void addEdge(NodeType n1, NodeType n2, ValueType capacity, ValueType reverseCapacity)
+    {
+        assert(capacity >= 0 && reverseCapacity >= 0);
+        _edges.push_back({n1, n2, capacity, reverseCapacity});
+    }
+
+    /**
+     * @brief Compute the maximum flow (maximum preflow) and the minimum cut labeling.
+     * @note The graph is released at the end of the computation, only the labeling is kept.
+     * @return the maximum flow value
+     */
+    ValueType compute();
+
+    /// is empty
+    inline bool isSource(NodeType n) const
+    {
+        return !_isTarget[n];
+    }
+    /// is full
+    inline bool isTarget(NodeType n) const
+    {
+        return _isTarget[n];
+    }
+
+private:
+
+    struct InputEdge
+    {
+        NodeType n1;
+        NodeType n2;
+        ValueType capacity;
+        ValueType reverseCapacity;
+    };
+
+    /**
+     * @brief Build the compressed sparse row residual graph from the input edges.
+     */
+    void buildGraph();
+
+    /**
+     * @brief Set each node label to its exact distance to the sink in the residual graph.
+     * @note Nodes that cannot reach the sink are labeled with the number of nodes + 1.
+     */
+    void globalRelabel();
+
+    /**
+     * @brief Get all nodes with a positive excess and a reachable label.
+     * @param[out] out_activeNodes the active node list
+     */
+    void getActiveNodes(std::vector<NodeType>& out_activeNodes) const;
+
+    std::size_t _numNodes;
+    std::vector<InputEdge> _edges;
+    std::vector<ValueType> _sourceCapacity;
+    std::vector<ValueType> _sinkCapacity; //< residual capacity to the sink
+
+    // residual graph
+    std::vector<ArcIndex> _firstArc;
+    std::vector<NodeType> _arcHead;
+    std::vector<ArcIndex> _arcReverse;
+    std::vector<ValueType> _arcResidual;
+
+    // push-relabel state
+    std::vector<int> _label;
+    std::vector<ValueType> _excess;
+
+    std::vector<bool> _isTarget;
+    const NodeType _S;  //< emptyness
+    const NodeType _T;  //< fullness
+};
+
+} // namespace fuseCut
+} // namespace aliceVision
@@ -0,0 +1,129 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/fuseCut/MaxFlow_AdjList.hpp>
+#include <aliceVision/fuseCut/MaxFlow_PushRelabel.hpp>
+
+#include <random>
+#include <vector>
+
+#define BOOST_TEST_MODULE fuseCutMaxFlow
+
+#include <boost/test/unit_test.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::fuseCut;
+
+namespace {
+
+struct TestGraph
+{
+    struct TestEdge
+    {
+        int n1;
+        int n2;
+        float capacity;
+        float reverseCapacity;
+    };
+
+    std::size_t nbNodes;
+    std::vector<float> source;
+    std::vector<float> sink;
+    std::vector<TestEdge> edges;
+};
+
+/**
+ * @brief Generate a random graph with the connectivity of a tetrahedralization (up to 4 neighbors per node).
+ * Capacities are integers to get exact floating point flows, so all solvers should give the same minimum cut.
+ */
+TestGraph generateRandomGraph(std::size_t nbNodes, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> capacityDistribution(0, 10);
+    std::uniform_int_distribution<int> terminalDistribution(0, 20);
+    std::uniform_int_distribution<int> nodeDistribution(0, int(nbNodes) - 1);
+
+    TestGraph graph;
+    graph.nbNodes = nbNodes;
+
+    for(std::size_t n = 0; n < nbNodes; ++n)
+    {
+        graph.source.push_back(float(terminalDistribution(generator)));
+        graph.sink.push_back(float(terminalDistribution(generator)));
+    }
+
+    for(int n = 0; n < nbNodes; ++n)
+    {
+        // local neighbor, to get long paths
+        if(n + 1 < nbNodes)
+            graph.edges.push_back({n, n + 1, float(capacityDistribution(generator)), float(capacityDistribution(generator))});
+
+        // random neighbors
+        for(int k = 0; k < 3; ++k)
+        {
+            const int m = nodeDistribution(generator);
+            if(m != n)
+                graph.edges.push_back({n, m, float(capacityDistribution(generator)), float(capacityDistribution(generator))});
+        }
+    }
+    return graph;
+}
+
+template <typename MaxFlowT>
+float computeMaxFlow(const TestGraph& graph, std::vector<bool>& out_isTarget)
+{
+    MaxFlowT maxFlowGraph(graph.nbNodes);
+
+    for(std::size_t n = 0; n < graph.nbNodes; ++n)
+        maxFlowGraph.addNode(n, graph.source[n], graph.sink[n]);
+
+    for(const auto& edge : graph.edges)
+        maxFlowGraph.addEdge(edge.n1, edge.n2, edge.capacity, edge.reverseCapacity);
+
+    const float flow = maxFlowGraph.compute();
+
+    out_isTarget.resize(graph.nbNodes);
+    for(std::size_t n = 0; n < graph.nbNodes; ++n)
+        out_isTarget[n] = maxFlowGraph.isTarget(n);
+
+    return flow;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fuseCut_maxFlow_simpleGraph)
+{
+    // source -> 0 -> 1 -> sink, the edge 0 -> 1 is the minimum cut
+    TestGraph graph;
+    graph.nbNodes = 2;
+    graph.source = {5.0f, 0.0f};
+    graph.sink = {0.0f, 5.0f};
+    graph.edges.push_back({0, 1, 2.0f, 0.0f});
+
+    std::vector<bool> isTarget;
+    const float flow = computeMaxFlow<MaxFlow_PushRelabel>(graph, isTarget);
+
+    BOOST_CHECK_EQUAL(flow, 2.0f);
+    BOOST_CHECK(!isTarget[0]);
+    BOOST_CHECK(isTarget[1]);
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_maxFlow_sameLabeling)
+{
+    for(unsigned int seed = 0; seed < 10; ++seed)
+    {
+        const TestGraph graph = generateRandomGraph(2000 + seed * 500, seed);
+
+        std::vector<bool> isTargetAdjList;
+        std::vector<bool> isTargetPushRelabel;
+
+        const float flowAdjList = computeMaxFlow<MaxFlow_AdjList>(graph, isTargetAdjList);
+        const float flowPushRelabel = computeMaxFlow<MaxFlow_PushRelabel>(graph, isTargetPushRelabel);
+
+        BOOST_CHECK_EQUAL(flowAdjList, flowPushRelabel);
+        BOOST_CHECK(isTargetAdjList == isTargetPushRelabel);
+    }
+}
@@ -0,0 +1,774 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "SpacePartition.hpp"
+#include <aliceVision/system/Logger.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace aliceVision {
+namespace fuseCut {
+
+HexahedronFrame::HexahedronFrame(const Point3d hexah[8])
+  : _origin(hexah[0])
+{
+    const Point3d vx = hexah[1] - hexah[0];
+    const Point3d vy = hexah[3] - hexah[0];
+    const Point3d vz = hexah[4] - hexah[0];
+
+    _axes.m11 = vx.x; _axes.m12 = vy.x; _axes.m13 = vz.x;
+    _axes.m21 = vx.y; _axes.m22 = vy.y; _axes.m23 = vz.y;
+    _axes.m31 = vx.z; _axes.m32 = vy.z; _axes.m33 = vz.z;
+
+    if(_axes.isSingular())
+        throw std::runtime_error("HexahedronFrame: degenerated hexahedron.");
+
+    _inverseAxes = _axes.inverse();
+}
+
+std::array<Point3d, 8> HexahedronFrame::getHexahedron(const Point3d& min, const Point3d& max) const
+{
+    return {{
+        toWorld(Point3d(min.x, min.y, min.z)),
+        toWorld(Point3d(max.x, min.y, min.z)),
+        toWorld(Point3d(max.x, max.y, min.z)),
+        toWorld(Point3d(min.x, max.y, min.z)),
+        toWorld(Point3d(min.x, min.y, max.z)),
+        toWorld(Point3d(max.x, min.y, max.z)),
+        toWorld(Point3d(max.x, max.y, max.z)),
+        toWorld(Point3d(min.x, max.y, max.z)),
+    }};
+}
+
+std::size_t getMaxPointsPerBlock(std::size_t memoryBudget, std::size_t maxInputPoints, std::size_t memoryPerPoint)
+{
+    const std::size_t fusionMemory = maxInputPoints * meshingMemoryPerInputPoint;
+    if(memoryBudget <= fusionMemory || memoryPerPoint == 0)
+        return 0;
+    return (memoryBudget - fusionMemory) / memoryPerPoint;
+}
+
+std::vector<SpaceBlock> computeSpaceBlocks(const HexahedronFrame& frame,
+                                           const std::vector<Point3d>& samplePoints,
+                                           std::size_t nbScenePoints,
+                                           std::size_t maxPointsPerBlock,
+                                           double overlap)
+{
+    // do not split blocks with too few samples to estimate their number of points
+    const std::size_t minSamplesPerBlock = 64;
+    const std::size_t maxNbBlocks = 4096;
+
+    std::vector<Point3d> localPoints;
+    localPoints.reserve(samplePoints.size());
+    for(const Point3d& p : samplePoints)
+    {
+        const Point3d u = frame.toLocal(p);
+        if(u.x >= 0.0 && u.x <= 1.0 && u.y >= 0.0 && u.y <= 1.0 && u.z >= 0.0 && u.z <= 1.0)
+            localPoints.push_back(u);
+    }
+
+    const double pointsPerSample = localPoints.empty() ? 0.0 : double(nbScenePoints) / double(localPoints.size());
+
+    // axes lengths, to cut the blocks on their longest axis
+    const Point3d origin = frame.toWorld(Point3d(0.0, 0.0, 0.0));
+    const Point3d axesLength((frame.toWorld(Point3d(1.0, 0.0, 0.0)) - origin).size(),
+                             (frame.toWorld(Point3d(0.0, 1.0, 0.0)) - origin).size(),
+                             (frame.toWorld(Point3d(0.0, 0.0, 1.0)) - origin).size());
+
+    struct Node
+    {
+        SpaceBlock block;
+        /// samples in the parent block with its overlap
+        std::vector<int> samples;
+    };
+
+    std::vector<SpaceBlock> blocks;
+    std::vector<Node> toDivide(1);
+    toDivide.front().block.coreMin = Point3d(0.0, 0.0, 0.0);
+    toDivide.front().block.coreMax = Point3d(1.0, 1.0, 1.0);
+    toDivide.front().samples.resize(localPoints.size());
+    for(int i = 0; i < localPoints.size(); ++i)
+        toDivide.front().samples[i] = i;
+
+    while(!toDivide.empty())
+    {
+        Node node = std::move(toDivide.back());
+        toDivide.pop_back();
+        SpaceBlock& block = node.block;
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            const double margin = overlap * (block.coreMax.m[axis] - block.coreMin.m[axis]);
+            block.min.m[axis] = block.coreMin.m[axis] - (block.isInnerSide(axis, false) ? margin : 0.0);
+            block.max.m[axis] = block.coreMax.m[axis] + (block.isInnerSide(axis, true) ? margin : 0.0);
+        }
+
+        // the samples of a child block with its overlap are in its parent block with its overlap
+        std::vector<int> samples;
+        samples.reserve(node.samples.size());
+        for(const int i : node.samples)
+        {
+            const Point3d& u = localPoints[i];
+            if(u.x >= block.min.x && u.x <= block.max.x && u.y >= block.min.y && u.y <= block.max.y &&
+               u.z >= block.min.z && u.z <= block.max.z)
+                samples.push_back(i);
+        }
+        block.nbPoints = std::size_t(double(samples.size()) * pointsPerSample);
+
+        if(block.nbPoints <= maxPointsPerBlock || samples.size() < minSamplesPerBlock ||
+           blocks.size() + toDivide.size() + 2 > maxNbBlocks)
+        {
+            if(block.nbPoints > maxPointsPerBlock)
+                ALICEVISION_LOG_WARNING("Space partition: a block is over the points limit (" << block.nbPoints << " points).");
+            blocks.push_back(block);
+            continue;
+        }
+
+        // cut the longest axis at the median of the samples of the block without overlap
+        int axis = 0;
+        for(int d = 1; d < 3; ++d)
+        {
+            if((block.coreMax.m[d] - block.coreMin.m[d]) * axesLength.m[d] >
+               (block.coreMax.m[axis] - block.coreMin.m[axis]) * axesLength.m[axis])
+                axis = d;
+        }
+
+        std::vector<double> values;
+        values.reserve(samples.size());
+        for(const int i : samples)
+        {
+            const double v = localPoints[i].m[axis];
+            if(v >= block.coreMin.m[axis] && v <= block.coreMax.m[axis])
+                values.push_back(v);
+        }
+
+        const double extent = block.coreMax.m[axis] - block.coreMin.m[axis];
+        double cut = block.coreMin.m[axis] + 0.5 * extent;
+        if(!values.empty())
+        {
+            std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+            cut = values[values.size() / 2];
+        }
+        // avoid thin blocks
+        cut = std::max(block.coreMin.m[axis] + 0.1 * extent, std::min(block.coreMax.m[axis] - 0.1 * extent, cut));
+
+        Node low;
+        low.block.coreMin = block.coreMin;
+        low.block.coreMax = block.coreMax;
+        low.block.coreMax.m[axis] = cut;
+        low.samples = samples;
+
+        Node high;
+        high.block.coreMin = block.coreMin;
+        high.block.coreMax = block.coreMax;
+        high.block.coreMin.m[axis] = cut;
+        high.samples = std::move(samples);
+
+        toDivide.push_back(std::move(high));
+        toDivide.push_back(std::move(low));
+    }
+
+    ALICEVISION_LOG_INFO("Space partition: " << blocks.size() << " blocks, max " << maxPointsPerBlock << " points per block, "
+                         << nbScenePoints << " points in the scene.");
+
+    return blocks;
+}
+
+BlockMeshesStitcher::BlockMeshesStitcher(const HexahedronFrame& frame, const std::vector<SpaceBlock>& blocks,
+                                         double seamMaxDistanceFactor)
+  : _frame(frame)
+  , _blocks(blocks)
+  , _seamMaxDistanceFactor(seamMaxDistanceFactor)
+{}
+
+void BlockMeshesStitcher::addBlockMesh(int blockIndex, const mesh::Mesh& mesh, const StaticVector<StaticVector<int>>& ptsCams)
+{
+    const SpaceBlock& block = _blocks.at(blockIndex);
+
+    std::vector<Point3d> pts(mesh.pts.size());
+    for(int i = 0; i < mesh.pts.size(); ++i)
+        pts[i] = _frame.toLocal(mesh.pts[i]);
+
+    std::vector<std::uint8_t> sides(pts.size(), 0);
+    // mesh vertex giving the cameras of each vertex
+    std::vector<int> camsSource(pts.size());
+    for(int i = 0; i < camsSource.size(); ++i)
+        camsSource[i] = i;
+
+    std::vector<std::array<int, 3>> tris;
+    tris.reserve(mesh.tris.size());
+    for(const mesh::Mesh::triangle& t : mesh.tris)
+    {
+        if(t.alive)
+            tris.push_back({t.v[0], t.v[1], t.v[2]});
+    }
+
+    // clip the triangles on each side shared with other blocks
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        for(const bool maxSide : {false, true})
+        {
+            if(!block.isInnerSide(axis, maxSide))
+                continue;
+
+            const double value = maxSide ? block.coreMax.m[axis] : block.coreMin.m[axis];
+            const std::uint8_t sideBit = 1 << sideIndex(axis, maxSide);
+            // distance to the side, positive outside of the block
+            const auto distance = [&](int v) { return maxSide ? pts[v].m[axis] - value : value - pts[v].m[axis]; };
+
+            for(int v = 0; v < pts.size(); ++v)
+            {
+                if(distance(v) == 0.0)
+                    sides[v] |= sideBit;
+            }
+
+            // vertices created on the side, shared by the triangles of the split edge
+            std::map<std::pair<int, int>, int> edgeVertices;
+            const auto getEdgeVertex = [&](int a, int b)
+            {
+                const std::pair<int, int> edge(std::min(a, b), std::max(a, b));
+                const auto it = edgeVertices.find(edge);
+                if(it != edgeVertices.end())
+                    return it->second;
+
+                const double da = distance(a);
+                const double db = distance(b);
+                const double t = da / (da - db);
+                Point3d p = pts[a] + (pts[b] - pts[a]) * t;
+                p.m[axis] = value;
+
+                const int v = pts.size();
+                pts.push_back(p);
+                sides.push_back(sideBit | (sides[a] & sides[b]));
+                camsSource.push_back(camsSource[t < 0.5 ? a : b]);
+                edgeVertices[edge] = v;
+                return v;
+            };
+
+            std::vector<std::array<int, 3>> clippedTris;
+            clippedTris.reserve(tris.size());
+
+            for(const std::array<int, 3>& t : tris)
+            {
+                const double d[3] = {distance(t[0]), distance(t[1]), distance(t[2])};
+
+                if(d[0] <= 0.0 && d[1] <= 0.0 && d[2] <= 0.0)
+                {
+                    clippedTris.push_back(t);
+                    continue;
+                }
+                if(d[0] >= 0.0 && d[1] >= 0.0 && d[2] >= 0.0)
+                    continue;
+
+                // clip the triangle polygon, keep its orientation
+                int polygon[4];
+                int polygonSize = 0;
+                for(int k = 0; k < 3; ++k)
+                {
+                    const int next = (k + 1) % 3;
+                    if(d[k] <= 0.0)
+                        polygon[polygonSize++] = t[k];
+                    if((d[k] < 0.0 && d[next] > 0.0) || (d[k] > 0.0 && d[next] < 0.0))
+                        polygon[polygonSize++] = getEdgeVertex(t[k], t[next]);
+                }
+
+                for(int k = 2; k < polygonSize; ++k)
+                    clippedTris.push_back({polygon[0], polygon[k - 1], polygon[k]});
+            }
+
+            tris.swap(clippedTris);
+        }
+    }
+
+    // add the used vertices
+    std::vector<int> newIndexes(pts.size(), -1);
+    for(std::array<int, 3>& t : tris)
+    {
+        for(int& v : t)
+        {
+            if(newIndexes[v] == -1)
+            {
+                newIndexes[v] = _pts.size();
+                _pts.push_back(pts[v]);
+                _ptsBlock.push_back(blockIndex);
+                _ptsSides.push_back(sides[v]);
+                _ptsCams.push_back(camsSource[v] < ptsCams.size() ? ptsCams[camsSource[v]] : StaticVector<int>());
+            }
+            v = newIndexes[v];
+        }
+        _tris.push_back(t);
+    }
+
+    ALICEVISION_LOG_DEBUG("Block " << blockIndex << ": " << tris.size() << " triangles after clipping (" << mesh.tris.size() << " before).");
+}
+
+void BlockMeshesStitcher::buildChains(const std::vector<std::pair<int, int>>& edges, std::vector<SeamChain>& out_chains)
+{
+    std::unordered_map<int, int> next;
+    std::unordered_map<int, int> nbIncoming;
+    for(const auto& edge : edges)
+    {
+        // keep one outgoing edge on non-manifold borders
+        if(next.emplace(edge.first, edge.second).second)
+            ++nbIncoming[edge.second];
+    }
+
+    std::unordered_map<int, bool> visited;
+    const auto follow = [&](int start, SeamChain& chain)
+    {
+        int v = start;
+        while(true)
+        {
+            chain.vertices.push_back(v);
+            visited[v] = true;
+            const auto it = next.find(v);
+            if(it == next.end())
+                return;
+            if(it->second == start)
+            {
+                chain.closed = true;
+                return;
+            }
+            if(visited.count(it->second))
+                return;
+            v = it->second;
+        }
+    };
+
+    // open chains first, from the vertices without incoming edge
+    for(const auto& edge : edges)
+    {
+        if(nbIncoming.count(edge.first) || visited.count(edge.first))
+            continue;
+        SeamChain chain;
+        follow(edge.first, chain);
+        out_chains.push_back(std::move(chain));
+    }
+    // then the loops
+    for(const auto& edge : edges)
+    {
+        if(visited.count(edge.first))
+            continue;
+        SeamChain chain;
+        follow(edge.first, chain);
+        out_chains.push_back(std::move(chain));
+    }
+}
+
+void BlockMeshesStitcher::zip(const std::vector<int>& lowSequence, const std::vector<int>& highSequence)
+{
+    // the low border edges are (low[i], low[i+1]) and the high border edges (high[l+1], high[l]),
+    // the strip triangles use them in the opposite direction
+    const auto distance = [&](int a, int b) { return (_frame.toWorld(_pts[a]) - _frame.toWorld(_pts[b])).size(); };
+
+    std::size_t i = 0;
+    std::size_t l = 0;
+    while(i + 1 < lowSequence.size() || l + 1 < highSequence.size())
+    {
+        const bool advanceLow = (l + 1 == highSequence.size()) ||
+                                (i + 1 < lowSequence.size() &&
+                                 distance(lowSequence[i + 1], highSequence[l]) <= distance(lowSequence[i], highSequence[l + 1]));
+        if(advanceLow)
+        {
+            _tris.push_back({lowSequence[i + 1], lowSequence[i], highSequence[l]});
+            ++i;
+        }
+        else
+        {
+            _tris.push_back({highSequence[l], highSequence[l + 1], lowSequence[i]});
+            ++l;
+        }
+    }
+}
+
+void BlockMeshesStitcher::zipChains(int axis, const std::vector<SeamChain>& lowChains, const std::vector<SeamChain>& highChains)
+{
+    if(lowChains.empty() || highChains.empty())
+        return;
+
+    // maximum distance between zipped borders
+    double edgesLength = 0.0;
+    std::size_t nbEdges = 0;
+    for(const auto* chains : {&lowChains, &highChains})
+    {
+        for(const SeamChain& chain : *chains)
+        {
+            for(std::size_t k = 0; k + 1 < chain.vertices.size(); ++k)
+            {
+                edgesLength += (_frame.toWorld(_pts[chain.vertices[k + 1]]) - _frame.toWorld(_pts[chain.vertices[k]])).size();
+                ++nbEdges;
+            }
+        }
+    }
+    const double maxDistance = std::max(_seamMaxDistanceFactor * edgesLength / double(std::max(nbEdges, std::size_t(1))),
+                                        std::numeric_limits<double>::epsilon());
+
+    // the high chains reversed, in the direction of the low chains
+    std::vector<std::vector<int>> highSequences(highChains.size());
+    for(std::size_t c = 0; c < highChains.size(); ++c)
+        highSequences[c].assign(highChains[c].vertices.rbegin(), highChains[c].vertices.rend());
+
+    // grid of the high chains vertices
+    const auto getCell = [&](const Point3d& p, int dx, int dy, int dz)
+    {
+        const std::int64_t x = std::int64_t(std::floor(p.x / maxDistance)) + dx;
+        const std::int64_t y = std::int64_t(std::floor(p.y / maxDistance)) + dy;
+        const std::int64_t z = std::int64_t(std::floor(p.z / maxDistance)) + dz;
+        return ((x & 0x1fffff) << 42) | ((y & 0x1fffff) << 21) | (z & 0x1fffff);
+    };
+    std::unordered_map<std::int64_t, std::vector<std::pair<int, int>>> grid;
+    for(int c = 0; c < highSequences.size(); ++c)
+    {
+        for(int k = 0; k < highSequences[c].size(); ++k)
+            grid[getCell(_frame.toWorld(_pts[highSequences[c][k]]), 0, 0, 0)].emplace_back(c, k);
+    }
+
+    // a vertex is only zipped with the blocks facing its block at its position on the plane,
+    // so the seams of two blocks do not cross the corner where 4 blocks meet
+    const auto isFacing = [&](int v, int highBlock)
+    {
+        const SpaceBlock& lowBlock = _blocks[_ptsBlock[v]];
+        const SpaceBlock& block = _blocks[highBlock];
+        for(int d = 0; d < 3; ++d)
+        {
+            if(d == axis)
+                continue;
+            if(std::min(lowBlock.coreMax.m[d], block.coreMax.m[d]) <= std::max(lowBlock.coreMin.m[d], block.coreMin.m[d]))
+                return false;
+            if(_pts[v].m[d] < block.coreMin.m[d] || _pts[v].m[d] > block.coreMax.m[d])
+                return false;
+        }
+        return true;
+    };
+
+    const auto getNearest = [&](int v)
+    {
+        const Point3d p = _frame.toWorld(_pts[v]);
+        std::pair<int, int> nearest(-1, -1);
+        double nearestDistance = maxDistance;
+        for(int dx = -1; dx <= 1; ++dx)
+            for(int dy = -1; dy <= 1; ++dy)
+                for(int dz = -1; dz <= 1; ++dz)
+                {
+                    const auto it = grid.find(getCell(p, dx, dy, dz));
+                    if(it == grid.end())
+                        continue;
+                    for(const auto& candidate : it->second)
+                    {
+                        const int candidateVertex = highSequences[candidate.first][candidate.second];
+                        if(!isFacing(v, _ptsBlock[candidateVertex]))
+                            continue;
+                        const double d = (_frame.toWorld(_pts[candidateVertex]) - p).size();
+                        if(d < nearestDistance)
+                        {
+                            nearestDistance = d;
+                            nearest = candidate;
+                        }
+                    }
+                }
+        return nearest;
+    };
+
+    std::size_t nbZipped = 0;
+    std::size_t nbNotZipped = 0;
+
+    for(const SeamChain& lowChain : lowChains)
+    {
+        const std::vector<int>& low = lowChain.vertices;
+        const int n = low.size();
+
+        std::vector<std::pair<int, int>> nearest(n);
+        for(int k = 0; k < n; ++k)
+            nearest[k] = getNearest(low[k]);
+
+        // a closed chain starts at a change of its nearest high chain
+        int start = 0;
+        bool singleRun = true;
+        if(lowChain.closed)
+        {
+            for(int k = 0; k < n; ++k)
+            {
+                if(nearest[k].first != nearest[(k + n - 1) % n].first)
+                {
+                    start = k;
+                    singleRun = false;
+                    break;
+                }
+            }
+        }
+
+        if(lowChain.closed && singleRun)
+        {
+            const int c = nearest[0].first;
+            if(c < 0)
+            {
+                ++nbNotZipped;
+                continue;
+            }
+            const std::vector<int>& high = highSequences[c];
+            std::vector<int> lowSequence(low);
+            lowSequence.push_back(low.front());
+            std::vector<int> highSequence;
+            if(highChains[c].closed)
+            {
+                for(std::size_t k = 0; k <= high.size(); ++k)
+                    highSequence.push_back(high[(nearest[0].second + k) % high.size()]);
+            }
+            else
+            {
+                highSequence = high;
+            }
+            zip(lowSequence, highSequence);
+            ++nbZipped;
+            continue;
+        }
+
+        // zip each run of vertices with the same nearest high chain,
+        // a run ends on the first vertex of the next run so the edge between them is zipped too
+        int runBegin = start;
+        for(int step = 1; step <= n; ++step)
+        {
+            const int k = (start + step) % n;
+            const int previous = (start + step - 1) % n;
+            if(step < n && nearest[k].first == nearest[previous].first)
+                continue;
+
+            const int c = nearest[previous].first;
+            const int runLength = (previous - runBegin + n) % n + 1 + ((lowChain.closed || step < n) ? 1 : 0);
+            if(c < 0 || runLength < 2)
+            {
+                nbNotZipped += (c < 0);
+                runBegin = k;
+                continue;
+            }
+
+            const std::vector<int>& high = highSequences[c];
+            const int p = nearest[runBegin].second;
+            const int q = nearest[previous].second;
+
+            std::vector<int> lowSequence;
+            for(int r = 0; r < runLength; ++r)
+                lowSequence.push_back(low[(runBegin + r) % n]);
+
+            std::vector<int> highSequence;
+            if(highChains[c].closed)
+            {
+                const int m = high.size();
+                for(int r = 0; r <= (q - p + m) % m; ++r)
+                    highSequence.push_back(high[(p + r) % m]);
+            }
+            else if(q >= p)
+            {
+                highSequence.assign(high.begin() + p, high.begin() + q + 1);
+            }
+
+            if(highSequence.empty())
+            {
+                // the borders are not in the same direction
+                ++nbNotZipped;
+            }
+            else
+            {
+                zip(lowSequence, highSequence);
+                ++nbZipped;
+            }
+            runBegin = k;
+        }
+    }
+
+    ALICEVISION_LOG_DEBUG("Seam: " << lowChains.size() << " / " << highChains.size() << " border chains, "
+                          << nbZipped << " zipped parts, " << nbNotZipped << " parts not zipped.");
+}
+
+void BlockMeshesStitcher::getSeamBorders(std::vector<SeamChain>& out_borders) const
+{
+    const auto edgeKey = [](int a, int b) { return (std::uint64_t(std::uint32_t(a)) << 32) | std::uint32_t(b); };
+    std::unordered_set<std::uint64_t> seamEdges;
+    for(const std::array<int, 3>& t : _tris)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            const int a = t[k];
+            const int b = t[(k + 1) % 3];
+            if(_ptsSides[a] && _ptsSides[b])
+                seamEdges.insert(edgeKey(a, b));
+        }
+    }
+    std::vector<std::pair<int, int>> bordersEdges;
+    for(const std::uint64_t edge : seamEdges)
+    {
+        const int a = int(edge >> 32);
+        const int b = int(edge & 0xffffffff);
+        if(!seamEdges.count(edgeKey(b, a)))
+            bordersEdges.emplace_back(a, b);
+    }
+    // deterministic chains
+    std::sort(bordersEdges.begin(), bordersEdges.end());
+    buildChains(bordersEdges, out_borders);
+}
+
+void BlockMeshesStitcher::stitch(mesh::Mesh& out_mesh, StaticVector<StaticVector<int>>& out_ptsCams)
+{
+    // directed edges between vertices on block sides
+    const auto edgeKey = [](int a, int b) { return (std::uint64_t(std::uint32_t(a)) << 32) | std::uint32_t(b); };
+    std::unordered_map<std::uint64_t, int> sideEdges;
+    for(const std::array<int, 3>& t : _tris)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            const int a = t[k];
+            const int b = t[(k + 1) % 3];
+            if(_ptsSides[a] & _ptsSides[b])
+                ++sideEdges[edgeKey(a, b)];
+        }
+    }
+
+    // border edges of each block side
+    std::map<std::pair<int, int>, std::vector<std::pair<int, int>>> borderEdges;
+    for(const std::array<int, 3>& t : _tris)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            const int a = t[k];
+            const int b = t[(k + 1) % 3];
+            const std::uint8_t commonSides = _ptsSides[a] & _ptsSides[b];
+            if(!commonSides || sideEdges.count(edgeKey(b, a)) || sideEdges.at(edgeKey(a, b)) != 1)
+                continue;
+            for(int side = 0; side < 6; ++side)
+            {
+                if(commonSides & (1 << side))
+                    borderEdges[{_ptsBlock[a], side}].emplace_back(a, b);
+            }
+        }
+    }
+    sideEdges.clear();
+
+    // group the chains per plane: the max side of the blocks below and the min side of the blocks above
+    std::map<std::pair<int, double>, std::pair<std::vector<SeamChain>, std::vector<SeamChain>>> seams;
+    for(const auto& blockSideEdges : borderEdges)
+    {
+        const int blockIndex = blockSideEdges.first.first;
+        const int axis = blockSideEdges.first.second / 2;
+        const bool maxSide = blockSideEdges.first.second % 2;
+        const SpaceBlock& block = _blocks[blockIndex];
+        const double value = maxSide ? block.coreMax.m[axis] : block.coreMin.m[axis];
+
+        auto& seam = seams[{axis, value}];
+        buildChains(blockSideEdges.second, maxSide ? seam.first : seam.second);
+    }
+    borderEdges.clear();
+
+    const std::size_t nbTrisBeforeZip = _tris.size();
+    for(const auto& seam : seams)
+        zipChains(seam.first.first, seam.second.first, seam.second.second);
+
+    // close the holes left where more than 2 blocks meet
+    const auto distance = [&](int a, int b) { return (_frame.toWorld(_pts[a]) - _frame.toWorld(_pts[b])).size(); };
+    std::vector<SeamChain> holes;
+    getSeamBorders(holes);
+    int nbHoles = 0;
+    int nbOpenBorders = 0;
+    for(const SeamChain& hole : holes)
+    {
+        if(hole.vertices.size() < 3)
+        {
+            ++nbOpenBorders;
+            continue;
+        }
+        if(!hole.closed)
+        {
+            // a hole through a vertex twice gives an open chain, close it if its ends are neighbors
+            double maxEdgeLength = 0.0;
+            for(std::size_t k = 0; k + 1 < hole.vertices.size(); ++k)
+                maxEdgeLength = std::max(maxEdgeLength, distance(hole.vertices[k], hole.vertices[k + 1]));
+            if(distance(hole.vertices.back(), hole.vertices.front()) > maxEdgeLength)
+            {
+                // a border of the surface
+                ++nbOpenBorders;
+                continue;
+            }
+        }
+        // cut the ear with the shortest diagonal until the hole is a triangle
+        std::vector<int> polygon(hole.vertices);
+        while(polygon.size() > 3)
+        {
+            const std::size_t n = polygon.size();
+            std::size_t ear = 0;
+            double earDiagonal = std::numeric_limits<double>::max();
+            for(std::size_t k = 0; k < n; ++k)
+            {
+                const double diagonal = distance(polygon[(k + n - 1) % n], polygon[(k + 1) % n]);
+                if(diagonal < earDiagonal)
+                {
+                    earDiagonal = diagonal;
+                    ear = k;
+                }
+            }
+            _tris.push_back({polygon[(ear + n - 1) % n], polygon[(ear + 1) % n], polygon[ear]});
+            polygon.erase(polygon.begin() + ear);
+        }
+        _tris.push_back({polygon[0], polygon[2], polygon[1]});
+        ++nbHoles;
+    }
+
+    // the seam triangles must not overlap the block meshes or each other, but the graph-cut surface is not
+    // guaranteed to be manifold along the block sides: drop the overlapping seam triangles rather than
+    // failing the whole meshing
+    std::unordered_map<std::uint64_t, int> edgesUse;
+    for(const std::array<int, 3>& t : _tris)
+    {
+        for(int k = 0; k < 3; ++k)
+            ++edgesUse[edgeKey(t[k], t[(k + 1) % 3])];
+    }
+    std::size_t nbKeptTris = nbTrisBeforeZip;
+    for(std::size_t i = nbTrisBeforeZip; i < _tris.size(); ++i)
+    {
+        const std::array<int, 3> t = _tris[i];
+        bool overlapping = false;
+        for(int k = 0; k < 3 && !overlapping; ++k)
+            overlapping = (edgesUse.at(edgeKey(t[k], t[(k + 1) % 3])) > 1);
+        if(overlapping)
+        {
+            for(int k = 0; k < 3; ++k)
+                --edgesUse.at(edgeKey(t[k], t[(k + 1) % 3]));
+            continue;
+        }
+        _tris[nbKeptTris++] = t;
+    }
+    edgesUse.clear();
+    const std::size_t nbOverlappingTris = _tris.size() - nbKeptTris;
+    _tris.resize(nbKeptTris);
+    if(nbOverlappingTris > 0)
+        ALICEVISION_LOG_WARNING("Block meshes stitching: " << nbOverlappingTris << " seam triangles overlapping other triangles removed.");
+
+    ALICEVISION_LOG_INFO("Block meshes stitched: " << _pts.size() << " vertices, " << _tris.size() << " triangles ("
+                         << _tris.size() - nbTrisBeforeZip << " seam triangles, " << nbHoles << " holes closed, "
+                         << nbOpenBorders << " surface borders on the seams).");
+
+    out_mesh.pts.resize(_pts.size());
+    for(int i = 0; i < _pts.size(); ++i)
+        out_mesh.pts[i] = _frame.toWorld(_pts[i]);
+
+    out_mesh.tris.resize(_tris.size());
+    for(int i = 0; i < _tris.size(); ++i)
+        out_mesh.tris[i] = mesh::Mesh::triangle(_tris[i][0], _tris[i][1], _tris[i][2]);
+
+    out_ptsCams.swap(_ptsCams);
+
+    _pts.clear();
+    _tris.clear();
+    _ptsBlock.clear();
+    _ptsSides.clear();
+}
+
+} // namespace fuseCut
+} // namespace aliceVision
@@ -0,0 +1,182 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/mvsData/Matrix3x3.hpp>
+#include <aliceVision/mvsData/Point3d.hpp>
+#include <aliceVision/mvsData/StaticVector.hpp>
+#include <aliceVision/mesh/Mesh.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace aliceVision {
+namespace fuseCut {
+
+/// Default memory of the Delaunay graph cut per point: vertex, tetrahedra, cells weights and max-flow graph.
+/// It is a conservative estimate, not a measure: the meshing logs the peak memory per point of each block to adjust it.
+constexpr std::size_t defaultMeshingMemoryPerPoint = 2048;
+/// Estimated memory of the depth maps fusion per input point
+constexpr std::size_t meshingMemoryPerInputPoint = 48;
+
+/**
+ * @brief Normalized coordinates of a hexahedron.
+ *
+ * The hexahedron vertices are ordered as in VoxelsGrid::getHexah: hexah[0] is the origin,
+ * hexah[1], hexah[3] and hexah[4] are at 1 on the x, y and z axes.
+ */
+class HexahedronFrame
+{
+public:
+    explicit HexahedronFrame(const Point3d hexah[8]);
+
+    /// @return the normalized coordinates of a 3D point
+    inline Point3d toLocal(const Point3d& p) const { return _inverseAxes * (p - _origin); }
+
+    /// @return the 3D point of normalized coordinates
+    inline Point3d toWorld(const Point3d& u) const { return _origin + _axes * u; }
+
+    /**
+     * @brief Get the hexahedron of a box in normalized coordinates.
+     * @param[in] min the box minimum corner
+     * @param[in] max the box maximum corner
+     * @return the 8 vertices of the box
+     */
+    std::array<Point3d, 8> getHexahedron(const Point3d& min, const Point3d& max) const;
+
+private:
+    Point3d _origin;
+    /// the hexahedron axes as columns
+    Matrix3x3 _axes;
+    Matrix3x3 _inverseAxes;
+};
+
+/**
+ * @brief Block of a space partition, in normalized coordinates.
+ */
+struct SpaceBlock
+{
+    /// block without overlap, the cores of the blocks cover the space without intersecting
+    Point3d coreMin;
+    Point3d coreMax;
+    /// block with the overlap on the sides shared with other blocks
+    Point3d min;
+    Point3d max;
+    /// estimated number of points in the block with its overlap
+    std::size_t nbPoints = 0;
+
+    /// @return true if the side of the block on the axis is shared with other blocks
+    inline bool isInnerSide(int axis, bool maxSide) const
+    {
+        return maxSide ? (coreMax.m[axis] < 1.0) : (coreMin.m[axis] > 0.0);
+    }
+};
+
+/**
+ * @brief Get the maximum number of points of a block meshed within a memory budget.
+ * @param[in] memoryBudget the memory available for one block in bytes
+ * @param[in] maxInputPoints the maximum number of points loaded from the depth maps (0 if no depth maps)
+ * @param[in] memoryPerPoint the memory of the Delaunay graph cut per point in bytes
+ * @return the maximum number of points, 0 if the budget is too small
+ */
+std::size_t getMaxPointsPerBlock(std::size_t memoryBudget, std::size_t maxInputPoints,
+                                 std::size_t memoryPerPoint = defaultMeshingMemoryPerPoint);
+
+/**
+ * @brief Split the space into blocks with a bounded number of points.
+ *
+ * The space is recursively cut in 2 at the median of the points on its longest axis (as in ReconstructionPlan::divideBox),
+ * until the number of points of each block with its overlap is below the maximum.
+ *
+ * @param[in] frame the space
+ * @param[in] samplePoints points sampled uniformly from the scene
+ * @param[in] nbScenePoints the number of points of the whole scene
+ * @param[in] maxPointsPerBlock the maximum number of points of a block with its overlap
+ * @param[in] overlap the overlap margin of a block, relative to its size
+ * @return the blocks
+ */
+std::vector<SpaceBlock> computeSpaceBlocks(const HexahedronFrame& frame,
+                                           const std::vector<Point3d>& samplePoints,
+                                           std::size_t nbScenePoints,
+                                           std::size_t maxPointsPerBlock,
+                                           double overlap);
+
+/**
+ * @brief Merge the meshes of the blocks of a space partition into one mesh.
+ *
+ * Each block mesh is clipped to the block without overlap, the clipped triangles are split on the block sides,
+ * so the borders of two neighboring blocks lie on the same plane.
+ * The seams are then closed by zipping these border chains with a strip of triangles.
+ * Only one block mesh is kept in memory with the result.
+ */
+class BlockMeshesStitcher
+{
+public:
+    /**
+     * @param[in] frame the space
+     * @param[in] blocks the blocks of the space partition
+     * @param[in] seamMaxDistanceFactor the maximum distance between two zipped borders, relative to their mean edge length
+     */
+    BlockMeshesStitcher(const HexahedronFrame& frame, const std::vector<SpaceBlock>& blocks, double seamMaxDistanceFactor = 4.0);
+
+    /**
+     * @brief Clip the mesh of a block and add it.
+     * @param[in] blockIndex the block index
+     * @param[in] mesh the block mesh, consistently oriented
+     * @param[in] ptsCams the cameras of each mesh vertex
+     */
+    void addBlockMesh(int blockIndex, const mesh::Mesh& mesh, const StaticVector<StaticVector<int>>& ptsCams);
+
+    /**
+     * @brief Zip the seams between the blocks and get the merged mesh.
+     * @param[out] out_mesh the merged mesh
+     * @param[out] out_ptsCams the cameras of each merged mesh vertex
+     */
+    void stitch(mesh::Mesh& out_mesh, StaticVector<StaticVector<int>>& out_ptsCams);
+
+private:
+    /// a border chain of a block on one of its sides
+    struct SeamChain
+    {
+        std::vector<int> vertices;
+        bool closed = false;
+    };
+
+    /// @return the index of the side for the vertices side mask
+    inline static int sideIndex(int axis, bool maxSide) { return axis * 2 + (maxSide ? 1 : 0); }
+
+    /// link the border edges of one block side into chains
+    static void buildChains(const std::vector<std::pair<int, int>>& edges, std::vector<SeamChain>& out_chains);
+
+    /// close the seam between the chains of the blocks below a plane orthogonal to the axis and the chains of the blocks above it
+    void zipChains(int axis, const std::vector<SeamChain>& lowChains, const std::vector<SeamChain>& highChains);
+
+    /// link the border edges between vertices on block sides into chains
+    void getSeamBorders(std::vector<SeamChain>& out_borders) const;
+
+    /// add the strip of triangles between two parallel vertex sequences
+    void zip(const std::vector<int>& lowSequence, const std::vector<int>& highSequence);
+
+    const HexahedronFrame _frame;
+    const std::vector<SpaceBlock> _blocks;
+    const double _seamMaxDistanceFactor;
+
+    /// merged vertices in normalized coordinates
+    std::vector<Point3d> _pts;
+    std::vector<std::array<int, 3>> _tris;
+    StaticVector<StaticVector<int>> _ptsCams;
+    /// block of each vertex
+    std::vector<int> _ptsBlock;
+    /// block sides of each vertex (bit sideIndex)
+    std::vector<std::uint8_t> _ptsSides;
+};
+
+} // namespace fuseCut
+} // namespace aliceVision
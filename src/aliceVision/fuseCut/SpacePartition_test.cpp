@@ -0,0 +1,248 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/fuseCut/SpacePartition.hpp>
+
+#include <cmath>
+#include <map>
+#include <random>
+
+#define BOOST_TEST_MODULE fuseCutSpacePartition
+
+#include <boost/test/unit_test.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::fuseCut;
+
+namespace {
+
+/// a box of size 10 x 20 x 5, rotated around z
+std::array<Point3d, 8> getTestHexahedron()
+{
+    const double c = std::cos(0.3);
+    const double s = std::sin(0.3);
+    const Point3d origin(1.0, 2.0, 3.0);
+    const Point3d vx = Point3d(c, s, 0.0) * 10.0;
+    const Point3d vy = Point3d(-s, c, 0.0) * 20.0;
+    const Point3d vz = Point3d(0.0, 0.0, 1.0) * 5.0;
+    return {{origin, origin + vx, origin + vx + vy, origin + vy,
+             origin + vz, origin + vz + vx, origin + vz + vx + vy, origin + vz + vy}};
+}
+
+/// a grid on a plane z=constant in normalized coordinates, oriented to +z
+void addPlaneGrid(const HexahedronFrame& frame, const Point3d& min, const Point3d& max, int nx, int ny, double z,
+                  mesh::Mesh& mesh, StaticVector<StaticVector<int>>& ptsCams)
+{
+    for(int j = 0; j <= ny; ++j)
+    {
+        for(int i = 0; i <= nx; ++i)
+        {
+            mesh.pts.push_back(frame.toWorld(Point3d(min.x + (max.x - min.x) * i / nx, min.y + (max.y - min.y) * j / ny, z)));
+            StaticVector<int> cams;
+            cams.push_back(i);
+            ptsCams.push_back(cams);
+        }
+    }
+    for(int j = 0; j < ny; ++j)
+    {
+        for(int i = 0; i < nx; ++i)
+        {
+            const int v = j * (nx + 1) + i;
+            mesh.tris.push_back(mesh::Mesh::triangle(v, v + 1, v + nx + 2));
+            mesh.tris.push_back(mesh::Mesh::triangle(v, v + nx + 2, v + nx + 1));
+        }
+    }
+}
+
+/// blocks with their overlap on the inner sides
+std::vector<SpaceBlock> createBlocks(const std::vector<std::pair<Point3d, Point3d>>& cores, double overlap)
+{
+    std::vector<SpaceBlock> blocks(cores.size());
+    for(std::size_t i = 0; i < cores.size(); ++i)
+    {
+        SpaceBlock& block = blocks[i];
+        block.coreMin = cores[i].first;
+        block.coreMax = cores[i].second;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            block.min.m[axis] = block.coreMin.m[axis] - (block.isInnerSide(axis, false) ? overlap : 0.0);
+            block.max.m[axis] = block.coreMax.m[axis] + (block.isInnerSide(axis, true) ? overlap : 0.0);
+        }
+    }
+    return blocks;
+}
+
+/// check that the stitched mesh is consistently oriented, without hole and without overlapping triangles
+void checkStitchedPlane(const HexahedronFrame& frame, const mesh::Mesh& mesh, bool checkArea)
+{
+    BOOST_REQUIRE(!mesh.tris.empty());
+
+    std::map<std::pair<int, int>, int> edges;
+    for(const mesh::Mesh::triangle& t : mesh.tris)
+    {
+        for(int k = 0; k < 3; ++k)
+            ++edges[{t.v[k], t.v[(k + 1) % 3]}];
+    }
+
+    // the border edges are on the hexahedron sides
+    const auto isOnHexahedronSide = [&](int v)
+    {
+        const Point3d u = frame.toLocal(mesh.pts[v]);
+        const double eps = 1e-9;
+        return std::abs(u.x) < eps || std::abs(u.x - 1.0) < eps || std::abs(u.y) < eps || std::abs(u.y - 1.0) < eps;
+    };
+
+    for(const auto& edge : edges)
+    {
+        BOOST_CHECK_EQUAL(edge.second, 1);
+        if(edges.count({edge.first.second, edge.first.first}) == 0)
+        {
+            BOOST_CHECK(isOnHexahedronSide(edge.first.first));
+            BOOST_CHECK(isOnHexahedronSide(edge.first.second));
+        }
+    }
+
+    // the area is the plane area
+    if(checkArea)
+    {
+        double area = 0.0;
+        for(const mesh::Mesh::triangle& t : mesh.tris)
+            area += cross(mesh.pts[t.v[1]] - mesh.pts[t.v[0]], mesh.pts[t.v[2]] - mesh.pts[t.v[0]]).size() / 2.0;
+        BOOST_CHECK_CLOSE(area, 10.0 * 20.0, 1e-6);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fuseCut_spacePartition_frame)
+{
+    const std::array<Point3d, 8> hexah = getTestHexahedron();
+    const HexahedronFrame frame(&hexah[0]);
+
+    const Point3d p(4.0, 9.0, 5.0);
+    BOOST_CHECK_SMALL((frame.toWorld(frame.toLocal(p)) - p).size(), 1e-9);
+
+    const std::array<Point3d, 8> sameHexah = frame.getHexahedron(Point3d(0.0, 0.0, 0.0), Point3d(1.0, 1.0, 1.0));
+    for(int i = 0; i < 8; ++i)
+        BOOST_CHECK_SMALL((sameHexah[i] - hexah[i]).size(), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_spacePartition_blocks)
+{
+    const std::array<Point3d, 8> hexah = getTestHexahedron();
+    const HexahedronFrame frame(&hexah[0]);
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<Point3d> samples(100000);
+    for(Point3d& p : samples)
+        p = frame.toWorld(Point3d(uniform(generator), uniform(generator), uniform(generator)));
+
+    const std::size_t maxPointsPerBlock = 300000;
+    const std::vector<SpaceBlock> blocks = computeSpaceBlocks(frame, samples, 2000000, maxPointsPerBlock, 0.1);
+
+    BOOST_CHECK_GE(blocks.size(), 8);
+
+    double volume = 0.0;
+    for(const SpaceBlock& block : blocks)
+    {
+        BOOST_CHECK_LE(block.nbPoints, maxPointsPerBlock);
+        volume += (block.coreMax.x - block.coreMin.x) * (block.coreMax.y - block.coreMin.y) * (block.coreMax.z - block.coreMin.z);
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            BOOST_CHECK_GE(block.coreMin.m[axis], 0.0);
+            BOOST_CHECK_LE(block.coreMax.m[axis], 1.0);
+            BOOST_CHECK_LE(block.min.m[axis], block.coreMin.m[axis]);
+            BOOST_CHECK_GE(block.max.m[axis], block.coreMax.m[axis]);
+            BOOST_CHECK_EQUAL(block.min.m[axis] < block.coreMin.m[axis], block.isInnerSide(axis, false));
+            BOOST_CHECK_EQUAL(block.max.m[axis] > block.coreMax.m[axis], block.isInnerSide(axis, true));
+        }
+    }
+    // the blocks cover the space without intersecting
+    BOOST_CHECK_CLOSE(volume, 1.0, 1e-6);
+
+    // no split under the limit
+    BOOST_CHECK_EQUAL(computeSpaceBlocks(frame, samples, 2000000, 2000000, 0.1).size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_spacePartition_stitch)
+{
+    const std::array<Point3d, 8> hexah = getTestHexahedron();
+    const HexahedronFrame frame(&hexah[0]);
+
+    std::vector<SpaceBlock> blocks(2);
+    blocks[0].coreMin = Point3d(0.0, 0.0, 0.0);
+    blocks[0].coreMax = Point3d(0.5, 1.0, 1.0);
+    blocks[0].min = blocks[0].coreMin;
+    blocks[0].max = Point3d(0.6, 1.0, 1.0);
+    blocks[1].coreMin = Point3d(0.5, 0.0, 0.0);
+    blocks[1].coreMax = Point3d(1.0, 1.0, 1.0);
+    blocks[1].min = Point3d(0.4, 0.0, 0.0);
+    blocks[1].max = blocks[1].coreMax;
+
+    // the same surface meshed with different resolutions in the two blocks
+    BlockMeshesStitcher stitcher(frame, blocks);
+    {
+        mesh::Mesh mesh;
+        StaticVector<StaticVector<int>> ptsCams;
+        addPlaneGrid(frame, Point3d(0.0, 0.0, 0.0), Point3d(0.6, 1.0, 0.0), 17, 23, 0.5, mesh, ptsCams);
+        stitcher.addBlockMesh(0, mesh, ptsCams);
+    }
+    {
+        mesh::Mesh mesh;
+        StaticVector<StaticVector<int>> ptsCams;
+        addPlaneGrid(frame, Point3d(0.4, 0.0, 0.0), Point3d(1.0, 1.0, 0.0), 13, 31, 0.5, mesh, ptsCams);
+        stitcher.addBlockMesh(1, mesh, ptsCams);
+    }
+
+    mesh::Mesh mesh;
+    StaticVector<StaticVector<int>> ptsCams;
+    stitcher.stitch(mesh, ptsCams);
+
+    BOOST_REQUIRE_EQUAL(ptsCams.size(), mesh.pts.size());
+    checkStitchedPlane(frame, mesh, true);
+}
+
+BOOST_AUTO_TEST_CASE(fuseCut_spacePartition_stitchCorners)
+{
+    const std::array<Point3d, 8> hexah = getTestHexahedron();
+    const HexahedronFrame frame(&hexah[0]);
+
+    // 4 blocks meeting on a corner, and 3 blocks meeting on a T junction as in the median cuts
+    const std::vector<std::vector<std::pair<Point3d, Point3d>>> partitions = {
+        {{Point3d(0.0, 0.0, 0.0), Point3d(0.5, 0.5, 1.0)},
+         {Point3d(0.0, 0.5, 0.0), Point3d(0.5, 1.0, 1.0)},
+         {Point3d(0.5, 0.0, 0.0), Point3d(1.0, 0.5, 1.0)},
+         {Point3d(0.5, 0.5, 0.0), Point3d(1.0, 1.0, 1.0)}},
+        {{Point3d(0.0, 0.0, 0.0), Point3d(0.5, 1.0, 1.0)},
+         {Point3d(0.5, 0.0, 0.0), Point3d(1.0, 0.4, 1.0)},
+         {Point3d(0.5, 0.4, 0.0), Point3d(1.0, 1.0, 1.0)}},
+    };
+
+    for(const auto& cores : partitions)
+    {
+        // the same plane, or slightly different surfaces, meshed with different resolutions in each block
+        for(const double blockOffset : {0.0, 0.002})
+        {
+            const std::vector<SpaceBlock> blocks = createBlocks(cores, 0.1);
+            BlockMeshesStitcher stitcher(frame, blocks);
+            for(int b = 0; b < blocks.size(); ++b)
+            {
+                mesh::Mesh mesh;
+                StaticVector<StaticVector<int>> ptsCams;
+                addPlaneGrid(frame, blocks[b].min, blocks[b].max, 11 + 3 * b, 13 + 2 * b, 0.5 + blockOffset * b, mesh, ptsCams);
+                stitcher.addBlockMesh(b, mesh, ptsCams);
+            }
+
+            mesh::Mesh mesh;
+            StaticVector<StaticVector<int>> ptsCams;
+            stitcher.stitch(mesh, ptsCams);
+
+            BOOST_REQUIRE_EQUAL(ptsCams.size(), mesh.pts.size());
+            checkStitchedPlane(frame, mesh, blockOffset == 0.0);
+        }
+    }
+}
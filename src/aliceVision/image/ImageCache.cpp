@@ -8,6 +8,8 @@
 
 #include <aliceVision/system/Logger.hpp>
 
+#include <iterator>
+
 
 namespace aliceVision {
 namespace image {
@@ -116,42 +118,378 @@ unsigned long long int CacheValue::memorySize() const
     return 0;
 }
 
-ImageCache::ImageCache(float capacity_MiB, float maxSize_MiB, const ImageReadOptions& options) : 
-    _info(capacity_MiB, maxSize_MiB), 
-    _options(options)
+ImageCache::ImageCache(float capacity_MiB, float maxSize_MiB, const ImageReadOptions& options, int nbPrefetchThreads) : 
+    _limits(capacity_MiB, maxSize_MiB), 
+    _options(options),
+    _nbPrefetchThreads(nbPrefetchThreads)
 {
 }
 
 ImageCache::~ImageCache()
 {
+    {
+        const std::lock_guard<std::mutex> lock(_prefetchMutex);
+        _prefetchStop = true;
+        _prefetchQueue.clear();
+    }
+    _prefetchCondition.notify_all();
+
+    for (std::thread& thread : _prefetchThreads)
+    {
+        thread.join();
+    }
+}
+
+CacheInfo ImageCache::info() const
+{
+    CacheInfo info(_limits);
+
+    {
+        const std::lock_guard<std::mutex> lock(_memoryMutex);
+        info.contentSize = _contentSize;
+    }
+
+    info.nbImages = _nbImages;
+    info.nbHits = _nbHits;
+    info.nbMisses = _nbMisses;
+    info.nbSharedLoads = _nbSharedLoads;
+    info.nbLoadFromDisk = _nbLoadFromDisk;
+    info.nbLoadFromCache = info.nbHits + info.nbSharedLoads;
+    info.nbRemoveUnused = _nbRemoveUnused;
+    info.nbPrefetch = _nbPrefetch;
+    info.waitTime = static_cast<double>(_waitTimeNs) * 1e-9;
+
+    return info;
+}
+
+ImageCache::Shard& ImageCache::getShard(const CacheKey& key)
+{
+    return _shards[CacheKeyHasher()(key) % nbShards];
+}
+
+void ImageCache::addWaitTime(std::chrono::steady_clock::time_point start)
+{
+    const auto duration = std::chrono::steady_clock::now() - start;
+    _waitTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+CacheValue ImageCache::getOrLoad(const CacheKey& key,
+                                 const std::function<unsigned long long int()>& memorySize,
+                                 const std::function<CacheValue()>& load)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    Shard& shard = getShard(key);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+
+    // find the requested image in the cached images
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end())
+    {
+        Entry& entry = it->second;
+
+        if (entry.ready)
+        {
+            // image becomes MRU
+            shard.lru.splice(shard.lru.end(), shard.lru, entry.lruIt);
+            entry.lastAccess = _tick++;
+
+            CacheValue value = entry.value.get();
+            lock.unlock();
+
+            _nbHits++;
+            addWaitTime(start);
+            return value;
+        }
+
+        // image is being loaded by another request: wait for it outside of the lock
+        std::shared_future<CacheValue> future = entry.value;
+        lock.unlock();
+
+        _nbSharedLoads++;
+        CacheValue value = future.get();
+        addWaitTime(start);
+        return value;
+    }
+
+    // register the image as being loaded, so that concurrent requests wait for this load
+    std::promise<CacheValue> promise;
+    shard.entries[key].value = promise.get_future().share();
+    lock.unlock();
+
+    _nbMisses++;
+    addWaitTime(start);
+
+    unsigned long long int memSize = 0;
+    bool reserved = false;
+
+    try
+    {
+        // retrieve image size and reserve memory for it
+        memSize = memorySize();
+        reserved = reserveMemory(memSize);
+
+        if (!reserved)
+        {
+            ALICEVISION_THROW_ERROR("[image] ImageCache: failed to load image " << key.filename << "\n" << toString());
+        }
+
+        // load image outside of the locks
+        CacheValue value = load();
+        _nbLoadFromDisk++;
+
+        // update memory usage with the actual image size
+        {
+            const std::lock_guard<std::mutex> memoryLock(_memoryMutex);
+            _contentSize = _contentSize - memSize + value.memorySize();
+        }
+
+        promise.set_value(value);
+
+        // add to cache as MRU
+        {
+            const std::lock_guard<std::mutex> shardLock(shard.mutex);
+            EntryNode& node = *shard.entries.find(key);
+            Entry& entry = node.second;
+            entry.ready = true;
+            entry.lastAccess = _tick++;
+            entry.lruIt = shard.lru.insert(shard.lru.end(), &node);
+        }
+        _nbImages++;
+
+        return value;
+    }
+    catch (...)
+    {
+        if (reserved)
+        {
+            const std::lock_guard<std::mutex> memoryLock(_memoryMutex);
+            _contentSize -= memSize;
+        }
+
+        {
+            const std::lock_guard<std::mutex> shardLock(shard.mutex);
+            shard.entries.erase(key);
+        }
+
+        // propagate the error to the requests waiting for this image
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+bool ImageCache::reserveMemory(unsigned long long int memSize)
+{
+    const std::lock_guard<std::mutex> memoryLock(_memoryMutex);
+
+    // add image to cache if it fits in capacity
+    if (memSize + _contentSize <= _limits.capacity)
+    {
+        _contentSize += memSize;
+        return true;
+    }
+
+    // lock all the shards (always in the same order) to look for unused images
+    std::array<std::unique_lock<std::mutex>, nbShards> shardLocks;
+    for (std::size_t i = 0; i < nbShards; ++i)
+    {
+        shardLocks[i] = std::unique_lock<std::mutex>(_shards[i].mutex);
+    }
+
+    // retrieve missing capacity
+    const unsigned long long int missingCapacity = memSize + _contentSize - _limits.capacity;
+
+    // find unused image with size bigger than missing capacity
+    // remove it and add image to cache
+    {
+        const unsigned long long int removedSize = removeUnused(missingCapacity);
+        if (removedSize > 0)
+        {
+            _contentSize = _contentSize - removedSize + memSize;
+            return true;
+        }
+    }
+
+    // remove as few unused images as possible
+    while (memSize + _contentSize > _limits.capacity)
+    {
+        const unsigned long long int removedSize = removeUnused(0);
+        if (removedSize == 0)
+        {
+            break;
+        }
+        _contentSize -= removedSize;
+    }
+
+    // add image to cache if it fits in maxSize
+    if (memSize + _contentSize <= _limits.maxSize)
+    {
+        _contentSize += memSize;
+        return true;
+    }
+
+    return false;
+}
+
+unsigned long long int ImageCache::removeUnused(unsigned long long int minSize)
+{
+    // find the LRU candidate of each shard and keep the oldest one
+    Shard* bestShard = nullptr;
+    EntryNode* bestNode = nullptr;
+
+    for (Shard& shard : _shards)
+    {
+        // each image is examined at most once: the images in use are moved after the initial MRU
+        std::size_t nbToExamine = shard.lru.size();
+        auto it = shard.lru.begin();
+        while (nbToExamine-- > 0)
+        {
+            EntryNode* node = *it;
+            const auto next = std::next(it);
+            Entry& entry = node->second;
+            const CacheValue& value = entry.value.get();
+
+            if (value.useCount() > 1)
+            {
+                // image used externally: it becomes MRU
+                shard.lru.splice(shard.lru.end(), shard.lru, it);
+                entry.lastAccess = _tick++;
+            }
+            else if (value.memorySize() >= minSize)
+            {
+                if (bestNode == nullptr || entry.lastAccess < bestNode->second.lastAccess)
+                {
+                    bestShard = &shard;
+                    bestNode = node;
+                }
+                break;
+            }
+            it = next;
+        }
+    }
+
+    if (bestNode == nullptr)
+    {
+        return 0;
+    }
+
+    const unsigned long long int removedSize = bestNode->second.value.get().memorySize();
+    const CacheKey removedKey = bestNode->first;
+    bestShard->lru.erase(bestNode->second.lruIt);
+    bestShard->entries.erase(removedKey);
+
+    _nbImages--;
+    _nbRemoveUnused++;
+
+    return removedSize;
+}
+
+void ImageCache::enqueuePrefetch(std::function<void()>&& task)
+{
+    if (_nbPrefetchThreads <= 0)
+    {
+        return;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(_prefetchMutex);
+
+        if (_prefetchStop)
+        {
+            return;
+        }
+
+        if (_prefetchQueue.size() >= maxPendingPrefetch)
+        {
+            ALICEVISION_LOG_TRACE("[image] ImageCache: too many pending prefetch requests, request dropped.");
+            return;
+        }
+
+        // start the prefetch threads on first use
+        if (_prefetchThreads.empty())
+        {
+            for (int i = 0; i < _nbPrefetchThreads; ++i)
+            {
+                _prefetchThreads.emplace_back(&ImageCache::prefetchWorker, this);
+            }
+        }
+
+        _prefetchQueue.push_back(std::move(task));
+    }
+
+    _nbPrefetch++;
+    _prefetchCondition.notify_one();
+}
+
+void ImageCache::prefetchWorker()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_prefetchMutex);
+            _prefetchCondition.wait(lock, [this]() { return _prefetchStop || !_prefetchQueue.empty(); });
+
+            if (_prefetchStop)
+            {
+                return;
+            }
+
+            task = std::move(_prefetchQueue.front());
+            _prefetchQueue.pop_front();
+        }
+
+        try
+        {
+            task();
+        }
+        catch (const std::exception& e)
+        {
+            ALICEVISION_LOG_WARNING("[image] ImageCache: prefetch failed: " << e.what());
+        }
+    }
 }
 
 std::string ImageCache::toString() const
 {
-    std::string description = "Image cache content (LRU to MRU): ";
+    std::string description = "Image cache content (LRU to MRU, per shard): ";
 
-    for (const CacheKey& key : _keys)
+    for (const Shard& shard : _shards)
     {
-        std::string keyDesc = key.filename + 
-                              ", nbChannels: " + std::to_string(key.nbChannels) + 
-                              ", typeDesc: " + std::to_string(key.typeDesc) + 
-                              ", downscaleLevel: " + std::to_string(key.downscaleLevel) + 
-                              ", usages: " + std::to_string(_imagePtrs.at(key).useCount()) + 
-                              ", size: " + std::to_string(_imagePtrs.at(key).memorySize());
-        description += "\n * " + keyDesc;
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for (const EntryNode* node : shard.lru)
+        {
+            const CacheKey& key = node->first;
+            const CacheValue& value = node->second.value.get();
+            std::string keyDesc = key.filename + 
+                                  ", nbChannels: " + std::to_string(key.nbChannels) + 
+                                  ", typeDesc: " + std::to_string(key.typeDesc) + 
+                                  ", downscaleLevel: " + std::to_string(key.downscaleLevel) + 
+                                  ", usages: " + std::to_string(value.useCount()) + 
+                                  ", size: " + std::to_string(value.memorySize());
+            description += "\n * " + keyDesc;
+        }
     }
 
+    const CacheInfo cacheInfo = info();
+
     std::string memUsageDesc = "\nMemory usage: "
-                               "\n * capacity: " + std::to_string(_info.capacity) + 
-                               "\n * max size: " + std::to_string(_info.maxSize) + 
-                               "\n * nb images: " + std::to_string(_info.nbImages) + 
-                               "\n * content size: " + std::to_string(_info.contentSize);
+                               "\n * capacity: " + std::to_string(cacheInfo.capacity) + 
+                               "\n * max size: " + std::to_string(cacheInfo.maxSize) + 
+                               "\n * nb images: " + std::to_string(cacheInfo.nbImages) + 
+                               "\n * content size: " + std::to_string(cacheInfo.contentSize);
     description += memUsageDesc;
 
     std::string statsDesc = "\nUsage statistics: "
-                            "\n * nb load from disk: " + std::to_string(_info.nbLoadFromDisk) + 
-                            "\n * nb load from cache: " + std::to_string(_info.nbLoadFromCache) + 
-                            "\n * nb remove unused: " + std::to_string(_info.nbRemoveUnused);
+                            "\n * nb load from disk: " + std::to_string(cacheInfo.nbLoadFromDisk) + 
+                            "\n * nb load from cache: " + std::to_string(cacheInfo.nbLoadFromCache) + 
+                            "\n * nb remove unused: " + std::to_string(cacheInfo.nbRemoveUnused) + 
+                            "\n * nb hits: " + std::to_string(cacheInfo.nbHits) + 
+                            "\n * nb misses: " + std::to_string(cacheInfo.nbMisses) + 
+                            "\n * nb shared loads: " + std::to_string(cacheInfo.nbSharedLoads) + 
+                            "\n * nb prefetch: " + std::to_string(cacheInfo.nbPrefetch) + 
+                            "\n * wait time: " + std::to_string(cacheInfo.waitTime) + "s";
     description += statsDesc;
  
     return description;
@@ -16,12 +16,19 @@
 #include <boost/filesystem.hpp>
 #include <boost/functional/hash.hpp>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <functional>
+#include <future>
 #include <list>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 
 namespace aliceVision {
@@ -90,6 +97,18 @@ struct CacheInfo
     int nbLoadFromCache = 0;
     int nbRemoveUnused = 0;
 
+    /// requests served by an image already in the cache
+    int nbHits = 0;
+    /// requests that loaded the image from disk
+    int nbMisses = 0;
+    /// requests that waited for the same image being loaded by another request
+    /// (nbLoadFromCache = nbHits + nbSharedLoads)
+    int nbSharedLoads = 0;
+    /// images requested with prefetch
+    int nbPrefetch = 0;
+    /// total time (in seconds) spent by requests waiting for the cache locks or for a load by another request
+    double waitTime = 0.0;
+
     CacheInfo(float capacity_MiB, float maxSize_MiB) : 
         capacity(capacity_MiB * 1024 * 1024), 
         maxSize(maxSize_MiB * 1024 * 1024)
@@ -192,6 +211,12 @@ inline std::shared_ptr<Image<RGBAfColor>> CacheValue::get<RGBAfColor>() { return
  * or until there is nothing to remove
  * 5. if the image fits in the maximal size, load it, store it and return it
  * 6. the image is too big for the cache, throw an error.
+ *
+ * The cache is split in shards, each with its own lock, hash map and LRU list.
+ * Images are decoded outside of the locks: concurrent requests for an image being loaded wait for this load
+ * instead of decoding it again. The LRU order is maintained per shard.
+ * An image found in use while looking for an image to remove becomes MRU, so the images in use
+ * are not examined again by the next removals.
  */
 class ImageCache 
 {
@@ -201,11 +226,13 @@ public:
      * @param[in] capacity_MiB the cache capacity (in MiB)
      * @param[in] maxSize_MiB the cache maximal size (in MiB)
      * @param[in] options the reading options that will be used when loading images through this cache
+     * @param[in] nbPrefetchThreads the number of threads used to load prefetched images
      */
-    ImageCache(float capacity_MiB, float maxSize_MiB, const ImageReadOptions& options);
+    ImageCache(float capacity_MiB, float maxSize_MiB, const ImageReadOptions& options, int nbPrefetchThreads = 2);
 
     /**
      * @brief Destroy the cache and the unused images it contains.
+     *        Pending prefetch requests are canceled.
      */
     ~ImageCache();
 
@@ -224,13 +251,20 @@ public:
     template<typename TPix>
     std::shared_ptr<Image<TPix>> get(const std::string& filename, int downscaleLevel = 1);
 
+    /**
+     * @brief Load images in the cache in the background, to be retrieved later with get.
+     * @note This method is thread-safe and does not wait for the images to be loaded.
+     *       Requests are dropped if too many of them are pending.
+     * @param[in] filenames the images' filenames on disk
+     * @param[in] downscaleLevel the downscale level
+     */
+    template<typename TPix>
+    void prefetch(const std::vector<std::string>& filenames, int downscaleLevel = 1);
+
     /**
      * @return information on the current cache state and usage
      */
-    inline const CacheInfo& info() const
-    {
-        return _info;
-    }
+    CacheInfo info() const;
 
     /**
      * @return the image reading options of the cache
@@ -247,20 +281,113 @@ public:
     std::string toString() const;
 
 private:
+    /// maximum number of pending prefetch requests
+    static constexpr std::size_t maxPendingPrefetch = 1024;
+    static constexpr std::size_t nbShards = 16;
+
+    struct Entry;
+    /// element of the entries hash map, its address is stable until it is erased
+    using EntryNode = std::pair<const CacheKey, Entry>;
+
+    /**
+     * @brief An entry of the cache: an image being loaded or loaded.
+     */
+    struct Entry
+    {
+        std::shared_future<CacheValue> value;
+        /// false while the image is being loaded
+        bool ready = false;
+        /// position in the shard LRU list, valid if ready
+        std::list<EntryNode*>::iterator lruIt;
+        /// last access tick, used to compare the LRU images of the shards
+        unsigned long long int lastAccess = 0;
+    };
+
+    /**
+     * @brief A subset of the cache entries with its own lock.
+     */
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<CacheKey, Entry, CacheKeyHasher> entries;
+        /// loaded entries, ordered from LRU (Least Recently Used) to MRU (Most Recently Used)
+        std::list<EntryNode*> lru;
+    };
+
     /**
-     * @brief Load a new image corresponding to the given key and add it as a new entry in the cache.
+     * @brief Retrieve the cache value corresponding to the given key, load it if needed.
      * @param[in] key the key used to identify the entry in the cache
+     * @param[in] memorySize function returning the memory size of the image before loading it
+     * @param[in] load function loading the image
+     * @return the cache value
+     */
+    CacheValue getOrLoad(const CacheKey& key,
+                         const std::function<unsigned long long int()>& memorySize,
+                         const std::function<CacheValue()>& load);
+
+    /**
+     * @brief Reserve memory for an image, removing unused images if needed (steps 2 to 6 of the policy).
+     * @param[in] memSize the memory size of the image
+     * @return false if the image does not fit in the cache
+     */
+    bool reserveMemory(unsigned long long int memSize);
+
+    /**
+     * @brief Remove the Least-Recently-Used image of the cache that is not used externally.
+     *        The images in use met before the LRU unused image of a shard become MRU.
+     * @note All the shard locks must be held.
+     * @param[in] minSize the minimal memory size of the removed image
+     * @return the memory size of the removed image, 0 if there is no such image
+     */
+    unsigned long long int removeUnused(unsigned long long int minSize);
+
+    /**
+     * @brief Load a new image corresponding to the given key.
+     * @param[in] key the key used to identify the entry in the cache
+     * @return the cache value wrapping the image
      */
     template<typename TPix>
-    void load(const CacheKey& key);
+    CacheValue load(const CacheKey& key) const;
 
-    CacheInfo _info;
-    ImageReadOptions _options;
-    std::unordered_map<CacheKey, CacheValue, CacheKeyHasher> _imagePtrs;
-    /// ordered from LRU (Least Recently Used) to MRU (Most Recently Used)
-    std::list<CacheKey> _keys;
-    mutable std::mutex _mutex;
+    Shard& getShard(const CacheKey& key);
+
+    void addWaitTime(std::chrono::steady_clock::time_point start);
 
+    /**
+     * @brief Add a task to the prefetch queue, start the prefetch threads if needed.
+     * @param[in] task the prefetch task
+     */
+    void enqueuePrefetch(std::function<void()>&& task);
+
+    void prefetchWorker();
+
+    const CacheInfo _limits;
+    ImageReadOptions _options;
+    std::array<Shard, nbShards> _shards;
+
+    /// memory accounting, includes the images being loaded
+    mutable std::mutex _memoryMutex;
+    unsigned long long int _contentSize = 0;
+
+    std::atomic<int> _nbImages{0};
+    std::atomic<unsigned long long int> _tick{0};
+
+    // usage statistics
+    std::atomic<int> _nbHits{0};
+    std::atomic<int> _nbMisses{0};
+    std::atomic<int> _nbSharedLoads{0};
+    std::atomic<int> _nbLoadFromDisk{0};
+    std::atomic<int> _nbRemoveUnused{0};
+    std::atomic<int> _nbPrefetch{0};
+    std::atomic<long long int> _waitTimeNs{0};
+
+    // prefetch
+    const int _nbPrefetchThreads;
+    std::mutex _prefetchMutex;
+    std::condition_variable _prefetchCondition;
+    std::deque<std::function<void()>> _prefetchQueue;
+    std::vector<std::thread> _prefetchThreads;
+    bool _prefetchStop = false;
 };
 
 
@@ -276,8 +403,6 @@ std::shared_ptr<Image<TPix>> ImageCache::get(const std::string& filename, int do
                                 << "request was made with downscale level " << downscaleLevel);
     }
 
-    const std::lock_guard<std::mutex> lock(_mutex);
-
     ALICEVISION_LOG_TRACE("[image] ImageCache: reading " << filename 
                          << " with downscale level " << downscaleLevel
                          << " from thread " << std::this_thread::get_id());
@@ -285,108 +410,35 @@ std::shared_ptr<Image<TPix>> ImageCache::get(const std::string& filename, int do
     using TInfo = ColorTypeInfo<TPix>;
 
     auto lastWriteTime = boost::filesystem::last_write_time(filename);
-    CacheKey keyReq(filename, TInfo::size, TInfo::typeDesc, downscaleLevel, lastWriteTime);
-
-    // find the requested image in the cached images
-    {
-        auto it = std::find(_keys.begin(), _keys.end(), keyReq);
-        if (it != _keys.end())
-        {
-            // image becomes LRU
-            _keys.erase(it);
-            _keys.push_back(keyReq);
-
-            _info.nbLoadFromCache++;
-
-            ALICEVISION_LOG_TRACE("[image] ImageCache: " << toString());
-            return _imagePtrs.at(keyReq).get<TPix>();
-        }
-    }
-
-    // retrieve image size
-    int width, height;
-    readImageSize(filename, width, height);
-    unsigned long long int memSize = (width / downscaleLevel) * (height / downscaleLevel) * sizeof(TPix);
- 
-    // add image to cache if it fits in capacity
-    if (memSize + _info.contentSize <= _info.capacity) 
-    {
-        load<TPix>(keyReq);
-
-        ALICEVISION_LOG_TRACE("[image] ImageCache: " << toString());
-        return _imagePtrs.at(keyReq).get<TPix>();
-    }
-
-    // retrieve missing capacity
-    unsigned long long int missingCapacity = memSize + _info.contentSize - _info.capacity;
-
-    // find unused image with size bigger than missing capacity
-    // remove it and add image to cache
-    {
-        auto it = _keys.begin();
-        while (it != _keys.end())
-        {
-            const CacheKey& key = *it;
-            const CacheValue& value = _imagePtrs.at(key);
-            if (value.useCount() == 1 && value.memorySize() >= missingCapacity)
-            {
-                _info.nbImages--;
-                _info.contentSize -= value.memorySize();
-                _imagePtrs.erase(key);
-                _keys.erase(it);
-
-                _info.nbRemoveUnused++;
-
-                load<TPix>(keyReq);
-
-                ALICEVISION_LOG_TRACE("[image] ImageCache: " << toString());
-                return _imagePtrs.at(keyReq).get<TPix>();
-            }
-            ++it;
-        }
-    }
-
-    // remove as few unused images as possible
-    while (missingCapacity > 0)
-    {
-        auto it = std::find_if(_keys.begin(), _keys.end(), [this](const CacheKey& k){
-            return _imagePtrs.at(k).useCount() == 1;
+    const CacheKey keyReq(filename, TInfo::size, TInfo::typeDesc, downscaleLevel, lastWriteTime);
+
+    CacheValue value = getOrLoad(keyReq,
+        [&keyReq]() {
+            // retrieve image size
+            int width, height;
+            readImageSize(keyReq.filename, width, height);
+            return static_cast<unsigned long long int>(width / keyReq.downscaleLevel) * (height / keyReq.downscaleLevel) * sizeof(TPix);
+        },
+        [this, &keyReq]() {
+            return load<TPix>(keyReq);
         });
-        
-        if (it != _keys.end())
-        {
-            const CacheKey& key = *it;
-            const CacheValue& value = _imagePtrs.at(key);
-
-            _info.nbImages--;
-            _info.contentSize -= value.memorySize();
-            _imagePtrs.erase(key);
-            _keys.erase(it);
 
-            _info.nbRemoveUnused++;
-        }
-        else 
-        {
-            break;
-        }
-    }
+    return value.get<TPix>();
+}
 
-    // add image to cache if it fits in maxSize
-    if (memSize + _info.contentSize <= _info.maxSize) 
+template<typename TPix>
+void ImageCache::prefetch(const std::vector<std::string>& filenames, int downscaleLevel)
+{
+    for (const std::string& filename : filenames)
     {
-        load<TPix>(keyReq);
-
-        ALICEVISION_LOG_TRACE("[image] ImageCache: " << toString());
-        return _imagePtrs.at(keyReq).get<TPix>();
+        enqueuePrefetch([this, filename, downscaleLevel]() {
+            get<TPix>(filename, downscaleLevel);
+        });
     }
-
-    ALICEVISION_THROW_ERROR("[image] ImageCache: failed to load image \n" << toString());
-
-    return nullptr;
 }
 
 template<typename TPix>
-void ImageCache::load(const CacheKey& key)
+CacheValue ImageCache::load(const CacheKey& key) const
 {
     auto img = std::make_shared<Image<TPix>>();
 
@@ -399,18 +451,8 @@ void ImageCache::load(const CacheKey& key)
         imageAlgo::resizeImage(key.downscaleLevel, *img);
     }
 
-    _info.nbLoadFromDisk++;
-
     // create wrapper around shared pointer
-    CacheValue value = CacheValue::wrap(img);
-
-    // add to cache as MRU
-    _imagePtrs.insert({key, value});
-    _keys.push_back(key);
-
-    // update memory usage
-    _info.nbImages++;
-    _info.contentSize += value.memorySize();
+    return CacheValue::wrap(img);
 }
 
 } // namespace image
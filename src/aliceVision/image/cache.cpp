@@ -389,6 +389,14 @@ void TileCacheManager::notifyDestroy(size_t tileId) {
   /* Remove weak pointer */
   _objectMap.erase(tileId);
 
+  /* Remove from the most recently used objects, its memory is released with the tile */
+  MRUType::nth_index<1>::type & mruById = _mru.get<1>();
+  MRUType::nth_index<1>::type::iterator itmru = mruById.find(tileId);
+  if (itmru != mruById.end()) {
+    _incoreBlockUsageCount -= itmru->objectSize;
+    mruById.erase(itmru);
+  }
+
   /* Remove map from object to block id*/
   MemoryMap::iterator it = _memoryMap.find(tileId);
   if (it == _memoryMap.end()) {
@@ -10,6 +10,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <thread>
+#include <vector>
+
 using namespace aliceVision;
 using namespace aliceVision::image;
 
@@ -52,3 +55,82 @@ BOOST_AUTO_TEST_CASE(load_all_pixel_types) {
     BOOST_CHECK_EQUAL(cache.info().nbImages, 6);
     BOOST_CHECK_EQUAL(cache.info().nbLoadFromDisk, 6);
 }
+
+BOOST_AUTO_TEST_CASE(load_image_concurrently) {
+    ImageCache cache(256, 1024, EImageColorSpace::LINEAR);
+    const std::string filename = std::string(THIS_SOURCE_DIR) + "/image_test/lena.png";
+    const int nbThreads = 8;
+    std::vector<std::shared_ptr<Image<RGBAfColor>>> imgs(nbThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nbThreads; ++i)
+    {
+        threads.emplace_back([&cache, &filename, &imgs, i]() { imgs[i] = cache.get<RGBAfColor>(filename); });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (int i = 1; i < nbThreads; ++i)
+    {
+        BOOST_CHECK_EQUAL(imgs[0], imgs[i]);
+    }
+    BOOST_CHECK_EQUAL(cache.info().nbImages, 1);
+    BOOST_CHECK_EQUAL(cache.info().nbLoadFromDisk, 1);
+    BOOST_CHECK_EQUAL(cache.info().nbLoadFromCache, nbThreads - 1);
+    BOOST_CHECK_EQUAL(cache.info().nbHits + cache.info().nbSharedLoads, nbThreads - 1);
+}
+
+BOOST_AUTO_TEST_CASE(remove_unused_image) {
+    const std::string filename = std::string(THIS_SOURCE_DIR) + "/image_test/lena.png";
+    int width, height;
+    readImageSize(filename, width, height);
+    const float imgSize_MiB = static_cast<float>(width) * height * sizeof(RGBAfColor) / (1024 * 1024);
+
+    ImageCache cache(1.5f * imgSize_MiB, 1.9f * imgSize_MiB, EImageColorSpace::LINEAR);
+    {
+        auto imgRGBAf = cache.get<RGBAfColor>(filename);
+    }
+    // the unused RGBAf image is removed to fit the RGBf image in the capacity
+    auto imgRGBf = cache.get<RGBfColor>(filename);
+    BOOST_CHECK_EQUAL(cache.info().nbRemoveUnused, 1);
+    BOOST_CHECK_EQUAL(cache.info().nbImages, 1);
+    // no unused image, the RGBAf image only fits in the maximal size
+    auto imgRGBAf = cache.get<RGBAfColor>(filename);
+    BOOST_CHECK_EQUAL(cache.info().nbImages, 2);
+    BOOST_CHECK_EQUAL(cache.info().nbLoadFromDisk, 3);
+    // the RGBA image does not fit in the maximal size
+    BOOST_CHECK_THROW(auto imgRGBA = cache.get<RGBAColor>(filename), std::exception);
+    BOOST_CHECK_EQUAL(cache.info().nbImages, 2);
+}
+
+BOOST_AUTO_TEST_CASE(remove_unused_image_skips_images_in_use) {
+    const std::string filename = std::string(THIS_SOURCE_DIR) + "/image_test/lena.png";
+    int width, height;
+    readImageSize(filename, width, height);
+    const float pixels_MiB = static_cast<float>(width) * height / (1024 * 1024);
+
+    // the capacity fits the RGBf and RGB images
+    ImageCache cache((sizeof(RGBfColor) + sizeof(RGBColor) + 0.5f) * pixels_MiB, 64.f * pixels_MiB, EImageColorSpace::LINEAR);
+    auto imgRGBf = cache.get<RGBfColor>(filename);
+    {
+        auto imgRGB = cache.get<RGBColor>(filename);
+    }
+    // the LRU RGBf image is in use, the unused RGB image is removed
+    auto imgRGBA = cache.get<RGBAColor>(filename);
+    BOOST_CHECK_EQUAL(cache.info().nbRemoveUnused, 1);
+    BOOST_CHECK_EQUAL(cache.info().nbImages, 2);
+    // the RGBf image is still in the cache
+    auto imgRGBf2 = cache.get<RGBfColor>(filename);
+    BOOST_CHECK_EQUAL(imgRGBf, imgRGBf2);
+    BOOST_CHECK_EQUAL(cache.info().nbLoadFromDisk, 3);
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_image) {
+    ImageCache cache(256, 1024, EImageColorSpace::LINEAR);
+    const std::string filename = std::string(THIS_SOURCE_DIR) + "/image_test/lena.png";
+    cache.prefetch<RGBAfColor>({filename});
+    auto img = cache.get<RGBAfColor>(filename);
+    BOOST_CHECK(img != nullptr);
+    BOOST_CHECK_EQUAL(cache.info().nbPrefetch, 1);
+    BOOST_CHECK_EQUAL(cache.info().nbLoadFromDisk, 1);
+}
@@ -257,43 +257,72 @@ void generateFromVoctree(PairList& allMatches,
             allMatches[descriptorPair.first] = {};
     }
 
-    // query each document
-#pragma omp parallel for
-    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(descriptorsFiles.size()); ++i)
-    {
-        auto itA = descriptorsFiles.cbegin();
-        std::advance(itA, i);
-        const IndexT viewIdA = itA->first;
-        const std::string featuresPathA = itA->second;
+    // gather the sparse histograms of the query documents
+    std::vector<IndexT> viewIdsA;
+    viewIdsA.reserve(descriptorsFiles.size());
+    for (const auto& descriptorPair : descriptorsFiles)
+        viewIdsA.push_back(descriptorPair.first);
+
+    // the queries are processed by chunks, so in mode AB only the sparse histograms of one chunk are in memory
+    const std::size_t chunkSize = 1024;
 
-        aliceVision::voctree::SparseHistogram imageSH;
+    std::vector<aliceVision::voctree::SparseHistogram> computedSH;
+    std::vector<const aliceVision::voctree::SparseHistogram*> queries;
+    std::vector<aliceVision::voctree::DocMatches> matchesPerQuery;
+    aliceVision::voctree::QueriesStatistics statistics;
+
+    for (std::size_t chunkStart = 0; chunkStart < viewIdsA.size(); chunkStart += chunkSize)
+    {
+        const std::size_t chunkEnd = std::min(chunkStart + chunkSize, viewIdsA.size());
+        queries.assign(chunkEnd - chunkStart, nullptr);
 
         if (modeMultiSfM != EImageMatchingMode::A_B)
         {
-            // sparse histogram of A is already computed in the DB
-            imageSH = db.getSparseHistogramPerImage().at(viewIdA);
+            // sparse histograms of A are already computed in the DB
+            for (std::size_t i = chunkStart; i < chunkEnd; ++i)
+                queries[i - chunkStart] = &db.getSparseHistogramPerImage().at(viewIdsA[i]);
         }
         else // mode AB
         {
-            // compute the sparse histogram of each image A
-            std::vector<DescriptorUChar> descriptors;
-            // read the descriptors
-            loadDescsFromBinFile(featuresPathA, descriptors, false, nbMaxDescriptors);
-            imageSH = tree.quantizeToSparse(descriptors);
-        }
+            // compute the sparse histogram of each image A of the chunk
+            computedSH.assign(chunkEnd - chunkStart, {});
 
-        std::vector<aliceVision::voctree::DocMatch> matches;
+#pragma omp parallel for
+            for (ptrdiff_t i = static_cast<ptrdiff_t>(chunkStart); i < static_cast<ptrdiff_t>(chunkEnd); ++i)
+            {
+                std::vector<DescriptorUChar> descriptors;
+                // read the descriptors
+                loadDescsFromBinFile(descriptorsFiles.at(viewIdsA[i]), descriptors, false, nbMaxDescriptors);
+                computedSH[i - chunkStart] = tree.quantizeToSparse(descriptors);
+            }
 
-        db.find(imageSH, numImageQuery, matches);
+            for (std::size_t i = 0; i < computedSH.size(); ++i)
+                queries[i] = &computedSH[i];
+        }
 
-        ListOfImageID& imgMatches = allMatches.at(viewIdA);
-        imgMatches.reserve(imgMatches.size() + matches.size());
+        // query all the documents of the chunk at once
+        aliceVision::voctree::QueriesStatistics chunkStatistics;
+        db.findBatch(queries, numImageQuery, matchesPerQuery, "strongCommonPoints", &chunkStatistics);
+        statistics.nbQueries += chunkStatistics.nbQueries;
+        statistics.duration += chunkStatistics.duration;
 
-        for (const aliceVision::voctree::DocMatch& m : matches)
+        for (std::size_t i = chunkStart; i < chunkEnd; ++i)
         {
-            imgMatches.push_back(m.id);
+            ListOfImageID& imgMatches = allMatches.at(viewIdsA[i]);
+            const aliceVision::voctree::DocMatches& matches = matchesPerQuery[i - chunkStart];
+            imgMatches.reserve(imgMatches.size() + matches.size());
+
+            for (const aliceVision::voctree::DocMatch& m : matches)
+            {
+                imgMatches.push_back(m.id);
+            }
         }
     }
+    if (statistics.duration > 0.0)
+        statistics.queriesPerSecond = statistics.nbQueries / statistics.duration;
+
+    ALICEVISION_LOG_INFO("Database queries: " << statistics.nbQueries << " queries in " << statistics.duration << " s ("
+                         << statistics.queriesPerSecond << " queries per second).");
 }
 
 void conditionVocTree(const std::string& treeName, bool withWeights,
@@ -7,6 +7,7 @@
 #include "KeyframeSelector.hpp"
 #include <aliceVision/sfmDataIO/viewIO.hpp>
 #include <aliceVision/system/Logger.hpp>
+#include <aliceVision/alicevision_omp.hpp>
 
 #include <boost/filesystem.hpp>
 
@@ -16,6 +17,11 @@
 #include <cstdlib>
 #include <iomanip>
 #include <fstream>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 
 namespace fs = boost::filesystem;
@@ -63,6 +69,101 @@ double findMedian(const std::vector<double>& vec)
     return 0.0;
 }
 
+namespace {
+
+/**
+ * @brief A frame decoded by the reader thread, waiting to be scored by a worker.
+ */
+struct DecodedFrame
+{
+    std::size_t frameIndex = 0;
+    std::size_t mediaIndex = 0;
+    /// false if the frame is invalid or missing
+    bool valid = false;
+    /// Grayscale frame rescaled for the sharpness computation
+    cv::Mat sharpnessMat;
+    /// Grayscale frame rescaled for the optical flow computation
+    cv::Mat flowMat;
+    /// Previous frame of the same media for the optical flow computation (empty if there is none)
+    cv::Mat previousFlowMat;
+};
+
+/**
+ * @brief A bounded FIFO queue between the reader thread and the workers.
+ * The reader blocks when the queue is full, which limits the number of decoded frames kept in memory.
+ */
+class DecodedFramesQueue
+{
+public:
+    explicit DecodedFramesQueue(std::size_t capacity)
+        : _capacity(capacity)
+    {}
+
+    /**
+     * @brief Push a frame, wait while the queue is full
+     * @return false if the queue has been closed
+     */
+    bool push(DecodedFrame&& frame)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [this]() { return _closed || _frames.size() < _capacity; });
+        if (_closed)
+            return false;
+        _frames.push_back(std::move(frame));
+        _notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Pop a frame, wait while the queue is empty
+     * @return false if the queue has been closed and there is no more frame
+     */
+    bool pop(DecodedFrame& frame)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [this]() { return _closed || !_frames.empty(); });
+        if (_frames.empty())
+            return false;
+        frame = std::move(_frames.front());
+        _frames.pop_front();
+        _notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Close the queue: no more frame can be pushed, the remaining frames can still be popped
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+    /**
+     * @brief Close the queue and drop the remaining frames
+     */
+    void abort()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _frames.clear();
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+private:
+    const std::size_t _capacity;
+    std::deque<DecodedFrame> _frames;
+    bool _closed = false;
+    std::mutex _mutex;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+};
+
+} // namespace
+
 KeyframeSelector::KeyframeSelector(const std::vector<std::string>& mediaPaths,
                                    const std::string& sensorDbPath,
                                    const std::string& outputFolder,
@@ -358,83 +459,157 @@ bool KeyframeSelector::computeScores(const std::size_t rescaledWidthSharpness, c
         }
     }
 
-    std::size_t currentFrame = 0;
-    cv::Mat currentMatSharpness;  // OpenCV matrix for the sharpness computation
-    cv::Mat previousMatFlow, currentMatFlow;  // OpenCV matrices for the optical flow computation
-    auto ptrFlow = cv::optflow::createOptFlow_DeepFlow();
+    _flowVisualisationExported = false;
+    const std::vector<std::string> flowVisualisationFolders =
+        _exportFlowVisualisation ? createFlowVisualisationFolders() : std::vector<std::string>();
+
+    // Scores per media and per frame, filled by the workers in any order (-1 for invalid or missing frames)
+    std::vector<std::vector<double>> sharpnessScores(feeds.size(), std::vector<double>(nbFrames, -1.0));
+    std::vector<std::vector<double>> flowScores(feeds.size(), std::vector<double>(nbFrames, -1.0));
+    std::vector<std::vector<char>> validFrames(feeds.size(), std::vector<char>(nbFrames, 0));
+
+    const std::size_t nbWorkers = static_cast<std::size_t>(std::max(omp_get_max_threads(), 1));
+    DecodedFramesQueue queue(2 * nbWorkers);
+
+    std::atomic<std::size_t> nbProcessedFrames(0);
+    std::exception_ptr exception;
+    std::mutex exceptionMutex;
+
+    const auto setException = [&]() {
+        std::lock_guard<std::mutex> lock(exceptionMutex);
+        if (!exception)
+            exception = std::current_exception();
+        queue.abort();
+    };
+
+    // Reader: decode each frame once, in order, and rescale it for the sharpness and optical flow computations
+    std::thread reader([&]() {
+        try {
+            std::vector<cv::Mat> previousFlowMats(feeds.size());
+
+            for (std::size_t frameIndex = 0; frameIndex < nbFrames; ++frameIndex) {
+                for (std::size_t mediaIndex = 0; mediaIndex < feeds.size(); ++mediaIndex) {
+                    auto& feed = *feeds.at(mediaIndex);
+
+                    if (frameIndex > 0)
+                        feed.goToNextFrame();
+
+                    DecodedFrame frame;
+                    frame.frameIndex = frameIndex;
+                    frame.mediaIndex = mediaIndex;
+
+                    /* Handle input feeds that may have invalid or missing frames: dummy scores are kept for the
+                     * invalid frame, and the optical flow of the next frame cannot be computed. */
+                    cv::Mat grayscaleMat;
+                    try {
+                        grayscaleMat = readImage(feed);
+                        frame.valid = true;
+                    } catch (const std::invalid_argument& ex) {
+                        // frameIndex + 1 = currently evaluated frame with indexing starting at 1, for display reasons
+                        ALICEVISION_LOG_WARNING("Invalid or missing frame " << frameIndex + 1 << ", it will be skipped.");
+                    }
 
-    while (currentFrame < nbFrames) {
-        double minimalSharpness = skipSharpnessComputation ? 1.0f : std::numeric_limits<double>::max();
-        double minimalFlow = std::numeric_limits<double>::max();
+                    if (frame.valid) {
+                        if (!skipSharpnessComputation)
+                            frame.sharpnessMat = rescaleImage(grayscaleMat, rescaledWidthSharpness);
 
-        for (std::size_t mediaIndex = 0; mediaIndex < feeds.size(); ++mediaIndex) {
-            auto& feed = *feeds.at(mediaIndex);
+                        if (rescaledWidthSharpness == rescaledWidthFlow && !skipSharpnessComputation)
+                            frame.flowMat = frame.sharpnessMat;
+                        else
+                            frame.flowMat = rescaleImage(grayscaleMat, rescaledWidthFlow);
 
-            if (currentFrame > 0) {  // Get currentFrame - 1 for the optical flow computation
-                previousMatFlow = readImage(feed, rescaledWidthFlow);
-                feed.goToNextFrame();
-            }
+                        if (_frameWidth == 0 && _frameHeight == 0) {  // Will be used later on to determine the motion accumulation step
+                            _frameWidth = frame.flowMat.size().width;
+                            _frameHeight = frame.flowMat.size().height;
+                        }
+
+                        frame.previousFlowMat = previousFlowMats.at(mediaIndex);
+                        previousFlowMats.at(mediaIndex) = frame.flowMat;
+                    } else {
+                        previousFlowMats.at(mediaIndex) = cv::Mat();
+                    }
 
-            /* Handle input feeds that may have invalid or missing frames:
-             *   - catch the "invalid argument" exception thrown by "readImage" if a frame is invalid or missing
-             *   - try reading the next frame instead
-             *   - if the next frame is correctly read, then push dummy scores for the invalid frame and go on with
-             *     the process
-             *   - otherwise (feed not correctly moved to the next frame), throw a runtime error exception as something
-             *     is wrong with the video
-             */
-            if (!skipSharpnessComputation) {
-                try {
-                    // Read image for sharpness and rescale it if requested
-                    currentMatSharpness = readImage(feed, rescaledWidthSharpness);
-                } catch (const std::invalid_argument& ex) {
-                    // currentFrame + 1 = currently evaluated frame with indexing starting at 1, for display reasons
-                    // currentFrame + 2 = next frame to evaluate with indexing starting at 1, for display reasons
-                    ALICEVISION_LOG_WARNING("Invalid or missing frame " << currentFrame + 1
-                                            << ", attempting to read frame " << currentFrame + 2 << ".");
-                    bool success = feed.goToFrame(++currentFrame);
-                    if (success) {
-                        // Will throw an exception if next frame is also invalid
-                        currentMatSharpness = readImage(feed, rescaledWidthSharpness);
-                        // If no exception has been thrown, push dummy scores for the frame that was skipped
-                        _sharpnessScores.push_back(-1.f);
-                        _flowScores.push_back(-1.f);
-                    } else
-                        ALICEVISION_THROW_ERROR("Could not go to frame " << currentFrame + 1
-                                                << " either. The feed might be corrupted.");
+                    if (!queue.push(std::move(frame)))
+                        return;  // The scores computation has been aborted
                 }
             }
+            queue.close();
+        } catch (...) {
+            setException();
+        }
+    });
 
-            if (rescaledWidthSharpness == rescaledWidthFlow && !skipSharpnessComputation) {
-                currentMatFlow = currentMatSharpness;
-            } else {
-                currentMatFlow = readImage(feed, rescaledWidthFlow);
-            }
+    // Workers: compute the sharpness of each frame and the optical flow with its previous frame
+    const auto worker = [&]() {
+        try {
+            auto ptrFlow = cv::optflow::createOptFlow_DeepFlow();
+            DecodedFrame frame;
 
-            if (_frameWidth == 0 && _frameHeight == 0) {  // Will be used later on to determine the motion accumulation step
-                _frameWidth = currentMatFlow.size().width;
-                _frameHeight = currentMatFlow.size().height;
-            }
+            while (queue.pop(frame)) {
+                const std::size_t frameIndex = frame.frameIndex;
+                const std::size_t mediaIndex = frame.mediaIndex;
+
+                if (frame.valid) {
+                    if (!skipSharpnessComputation)
+                        sharpnessScores.at(mediaIndex).at(frameIndex) = computeSharpness(frame.sharpnessMat, sharpnessWindowSize);
 
-            // Compute sharpness
-            if (!skipSharpnessComputation) {
-                const double sharpness = computeSharpness(currentMatSharpness, sharpnessWindowSize);
-                minimalSharpness = std::min(minimalSharpness, sharpness);
+                    if (!frame.previousFlowMat.empty()) {
+                        cv::Mat flow;
+                        flowScores.at(mediaIndex).at(frameIndex) =
+                            estimateFlow(ptrFlow, frame.flowMat, frame.previousFlowMat, flowCellSize, flow);
+
+                        if (_exportFlowVisualisation)
+                            writeFlowVisualisation(flow, flowVisualisationFolders.at(mediaIndex), frameIndex);
+                    }
+
+                    validFrames.at(mediaIndex).at(frameIndex) = 1;
+                }
+
+                ALICEVISION_LOG_INFO("Finished processing frame " << frameIndex + 1 << "/" << nbFrames << " ("
+                                     << ++nbProcessedFrames << "/" << nbFrames * feeds.size() << " processed)");
             }
+        } catch (...) {
+            setException();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < nbWorkers; ++i)
+        workers.emplace_back(worker);
 
-            // Compute optical flow
-            if (currentFrame > 0) {
-                const double flow = estimateFlow(ptrFlow, currentMatFlow, previousMatFlow, flowCellSize);
-                minimalFlow = std::min(minimalFlow, flow);
+    reader.join();
+    for (std::thread& thread : workers)
+        thread.join();
+
+    if (exception)
+        std::rethrow_exception(exception);
+
+    // Save the scores of each frame: the minimal scores across all the medias
+    for (std::size_t frameIndex = 0; frameIndex < nbFrames; ++frameIndex) {
+        double minimalSharpness = skipSharpnessComputation ? 1.0f : std::numeric_limits<double>::max();
+        double minimalFlow = std::numeric_limits<double>::max();
+        bool isValid = true;
+
+        for (std::size_t mediaIndex = 0; mediaIndex < feeds.size(); ++mediaIndex) {
+            if (!validFrames.at(mediaIndex).at(frameIndex)) {
+                isValid = false;
+                break;
             }
+            if (!skipSharpnessComputation)
+                minimalSharpness = std::min(minimalSharpness, sharpnessScores.at(mediaIndex).at(frameIndex));
 
-            ALICEVISION_LOG_INFO("Finished processing frame " << currentFrame + 1 << "/" << nbFrames);
+            // The optical flow is not defined for the first frame or after an invalid frame
+            const double flow = flowScores.at(mediaIndex).at(frameIndex);
+            minimalFlow = (flow < 0.0) ? -1.0 : std::min(minimalFlow, flow);
         }
 
-        // Save scores for the current frame
-        _sharpnessScores.push_back(minimalSharpness);
-        _flowScores.push_back(currentFrame > 0 ? minimalFlow : -1.f);
-        ++currentFrame;
+        _sharpnessScores.push_back(isValid ? minimalSharpness : -1.f);
+        _flowScores.push_back(isValid && frameIndex > 0 ? minimalFlow : -1.f);
+    }
+
+    if (_exportFlowVisualisation) {
+        _flowVisualisationExported = true;
+        _flowVisualisationWidth = rescaledWidthFlow;
     }
 
     return true;
@@ -593,10 +768,15 @@ bool KeyframeSelector::exportScoresToFile(const std::string& filename, const boo
 
 bool KeyframeSelector::exportFlowVisualisation(const std::size_t rescaledWidth)
 {
+    // The optical flow has already been exported while it was computed for the scores
+    if (_flowVisualisationExported && _flowVisualisationWidth == rescaledWidth) {
+        ALICEVISION_LOG_INFO("The optical flow visualisation has already been exported during the scores computation.");
+        return true;
+    }
+
     // Create feeds and count minimum number of frames
     std::size_t nbFrames = std::numeric_limits<std::size_t>::max();
     std::vector<std::unique_ptr<dataio::FeedProvider>> feeds;
-    std::vector<std::string> outputFolders;
 
     for (std::size_t mediaIndex = 0; mediaIndex < _mediaPaths.size(); ++mediaIndex) {
         const auto& path = _mediaPaths.at(mediaIndex);
@@ -615,23 +795,6 @@ bool KeyframeSelector::exportFlowVisualisation(const std::size_t rescaledWidth)
 
         // Update minimum number of frames
         nbFrames = std::min(nbFrames, (size_t)feed.nbFrames());
-
-        // If there is a rig, create the corresponding folders
-        std::string processedOutputFolder = _outputFolder;
-        if (_mediaPaths.size() > 1) {
-            const std::string rigFolder = _outputFolder + "/rig/";
-            if (!fs::exists(rigFolder)) {
-                fs::create_directory(rigFolder);
-            }
-
-            processedOutputFolder = rigFolder + std::to_string(mediaIndex);
-            if (!fs::exists(processedOutputFolder)) {
-                fs::create_directory(processedOutputFolder);
-            }
-        }
-
-        // Save the output paths
-        outputFolders.push_back(processedOutputFolder);
     }
 
     if (nbFrames == 0) {
@@ -639,67 +802,93 @@ bool KeyframeSelector::exportFlowVisualisation(const std::size_t rescaledWidth)
         return false;
     }
 
-    size_t currentFrame = 0;
-    cv::Mat previousMat, currentMat;  // OpenCV matrices for the optical flow computation
+    // If there is a rig, create the corresponding folders
+    const std::vector<std::string> outputFolders = createFlowVisualisationFolders();
+
+    // Each frame is read once and kept as the previous frame of the next optical flow computation
+    std::vector<cv::Mat> previousMats(feeds.size());
     auto ptrFlow = cv::optflow::createOptFlow_DeepFlow();
 
-    /* To be able to handle the rigs and to avoid storing the optical flow results for all frames in case
-     * we might want to export them, we need to recompute the optical flow for all the frames, even if it has already
-     * been computed in computeScores(). */
-    while (currentFrame < nbFrames) {
+    for (std::size_t currentFrame = 0; currentFrame < nbFrames; ++currentFrame) {
         for (std::size_t mediaIndex = 0; mediaIndex < feeds.size(); ++mediaIndex) {
             auto& feed = *feeds.at(mediaIndex);
 
-            if (currentFrame > 0) {  // Get currentFrame - 1 for the optical flow computation
-                previousMat = readImage(feed, rescaledWidth);
+            if (currentFrame > 0)
                 feed.goToNextFrame();
-            }
 
             // Handle invalid or missing frames
+            cv::Mat currentMat;
             try {
                 currentMat = readImage(feed, rescaledWidth);  // Read image and rescale it if requested
             } catch (const std::invalid_argument& ex) {
-                ALICEVISION_LOG_WARNING("Invalid or missing frame " << currentFrame + 1
-                                        << ", attempting to read frame " << currentFrame + 2 << ".");
-                bool success = feed.goToFrame(++currentFrame);
-                if (success)
-                    currentMat = readImage(feed, rescaledWidth);
-                else
-                    ALICEVISION_THROW_ERROR("Could not go to frame " << currentFrame + 1
-                                            << " either. The feed might be corrupted.");
+                ALICEVISION_LOG_WARNING("Invalid or missing frame " << currentFrame + 1 << ", it will be skipped.");
+                previousMats.at(mediaIndex) = cv::Mat();
+                continue;
             }
 
-            if (currentFrame > 0) {
+            if (!previousMats.at(mediaIndex).empty()) {
                 cv::Mat flow;
-                ptrFlow->calc(currentMat, previousMat, flow);
-
-                cv::Mat flowParts[2];
-                cv::split(flow, flowParts);
-                cv::Mat magnitude, angle, magnNorm;
-                cv::cartToPolar(flowParts[0], flowParts[1], magnitude, angle, true);
-                cv::normalize(magnitude, magnNorm, 0.0f, 1.0f, cv::NORM_MINMAX);
-                angle *= ((1.f / 360.f) * (180.f / 255.f));
-
-                cv::Mat _hsv[3], hsv, hsv8, bgr;
-                _hsv[0] = angle;
-                _hsv[1] = cv::Mat::ones(angle.size(), CV_32F);
-                _hsv[2] = magnNorm;
-                cv::merge(_hsv, 3, hsv);
-                hsv.convertTo(hsv8, CV_8U, 255.0);
-                cv::cvtColor(hsv8, bgr, cv::COLOR_HSV2BGR);
-
-                std::ostringstream filenameSS;
-                filenameSS << std::setw(5) << std::setfill('0') << currentFrame << ".png";
-                cv::imwrite(outputFolders.at(mediaIndex) + "/OF_" + filenameSS.str(), bgr);
-                ALICEVISION_LOG_DEBUG("Wrote OF_" << filenameSS.str() << "!");
+                ptrFlow->calc(currentMat, previousMats.at(mediaIndex), flow);
+                writeFlowVisualisation(flow, outputFolders.at(mediaIndex), currentFrame);
             }
+
+            previousMats.at(mediaIndex) = currentMat;
         }
-        ++currentFrame;
     }
 
     return true;
 }
 
+std::vector<std::string> KeyframeSelector::createFlowVisualisationFolders() const
+{
+    std::vector<std::string> outputFolders;
+
+    for (std::size_t mediaIndex = 0; mediaIndex < _mediaPaths.size(); ++mediaIndex) {
+        // If there is a rig, create the corresponding folders
+        std::string processedOutputFolder = _outputFolder;
+        if (_mediaPaths.size() > 1) {
+            const std::string rigFolder = _outputFolder + "/rig/";
+            if (!fs::exists(rigFolder)) {
+                fs::create_directory(rigFolder);
+            }
+
+            processedOutputFolder = rigFolder + std::to_string(mediaIndex);
+            if (!fs::exists(processedOutputFolder)) {
+                fs::create_directory(processedOutputFolder);
+            }
+        }
+
+        // Save the output paths
+        outputFolders.push_back(processedOutputFolder);
+    }
+
+    return outputFolders;
+}
+
+void KeyframeSelector::writeFlowVisualisation(const cv::Mat& flow, const std::string& outputFolder,
+                                              std::size_t frameIndex)
+{
+    cv::Mat flowParts[2];
+    cv::split(flow, flowParts);
+    cv::Mat magnitude, angle, magnNorm;
+    cv::cartToPolar(flowParts[0], flowParts[1], magnitude, angle, true);
+    cv::normalize(magnitude, magnNorm, 0.0f, 1.0f, cv::NORM_MINMAX);
+    angle *= ((1.f / 360.f) * (180.f / 255.f));
+
+    cv::Mat _hsv[3], hsv, hsv8, bgr;
+    _hsv[0] = angle;
+    _hsv[1] = cv::Mat::ones(angle.size(), CV_32F);
+    _hsv[2] = magnNorm;
+    cv::merge(_hsv, 3, hsv);
+    hsv.convertTo(hsv8, CV_8U, 255.0);
+    cv::cvtColor(hsv8, bgr, cv::COLOR_HSV2BGR);
+
+    std::ostringstream filenameSS;
+    filenameSS << std::setw(5) << std::setfill('0') << frameIndex << ".png";
+    cv::imwrite(outputFolder + "/OF_" + filenameSS.str(), bgr);
+    ALICEVISION_LOG_DEBUG("Wrote OF_" << filenameSS.str() << "!");
+}
+
 cv::Mat KeyframeSelector::readImage(dataio::FeedProvider &feed, std::size_t width)
 {
     image::Image<image::RGBColor> image;
@@ -719,14 +908,17 @@ cv::Mat KeyframeSelector::readImage(dataio::FeedProvider &feed, std::size_t widt
     cv::cvtColor(cvFrame, cvGrayscale, cv::COLOR_BGR2GRAY);
 
     // Resize to smaller size if requested
-    if (width == 0)
-        return cvGrayscale;
+    return rescaleImage(cvGrayscale, width);
+}
+
+cv::Mat KeyframeSelector::rescaleImage(const cv::Mat& grayscaleImage, std::size_t width)
+{
+    if (width == 0 || grayscaleImage.cols <= width)
+        return grayscaleImage;
 
     cv::Mat cvRescaled;
-    if (cvGrayscale.cols > width && width > 0) {
-        cv::resize(cvGrayscale, cvRescaled,
-                   cv::Size(width, double(cvGrayscale.rows) * double(width) / double(cvGrayscale.cols)));
-    }
+    cv::resize(grayscaleImage, cvRescaled,
+               cv::Size(width, double(grayscaleImage.rows) * double(width) / double(grayscaleImage.cols)));
 
     return cvRescaled;
 }
@@ -772,7 +964,7 @@ double KeyframeSelector::computeSharpness(const cv::Mat& grayscaleImage, const s
 }
 
 double KeyframeSelector::estimateFlow(const cv::Ptr<cv::DenseOpticalFlow>& ptrFlow, const cv::Mat& grayscaleImage,
-                                      const cv::Mat& previousGrayscaleImage, const std::size_t cellSize)
+                                      const cv::Mat& previousGrayscaleImage, const std::size_t cellSize, cv::Mat& flow)
 {
     if (cellSize > grayscaleImage.size().width) {  // If the cell size is bigger than the height, it will be adjusted
         ALICEVISION_THROW(std::invalid_argument,
@@ -788,7 +980,6 @@ double KeyframeSelector::estimateFlow(const cv::Ptr<cv::DenseOpticalFlow>& ptrFl
                           << ")");
     }
 
-    cv::Mat flow;
     ptrFlow->calc(grayscaleImage, previousGrayscaleImage, flow);
 
     cv::Mat sumflow;
@@ -99,6 +99,9 @@ public:
 
     /**
      * @brief Compute the sharpness and optical flow scores for the input media paths
+     * @note The frames are decoded once by a reader thread and scored in parallel by worker threads. The optical flow
+     *       of each pair of consecutive frames is computed once: if the flow visualisation export is enabled, it is
+     *       written during the scores computation.
      * @param[in] rescaledWidthSharpness the width to resize the input frames to before using them to compute the
      *            sharpness scores (if equal to 0, no rescale will be performed)
      * @param[in] rescaledWidthFlow the width to resize the input frames to before using them to compute the
@@ -139,12 +142,22 @@ public:
 
     /**
      * @brief Export optical flow HSV visualisation for each frame as a PNG image
+     * @note Nothing is recomputed if the visualisation has already been exported by computeScores with the same width
      * @param[in] rescaledWidth the width to resize the input frames to before computing the optical flow (if equal
      *            to 0, no rescale will be performed)
      * @return true if the frames have been correctly exported, false otherwise
      */
     bool exportFlowVisualisation(const std::size_t rescaledWidth);
 
+    /**
+     * @brief Enable the export of the optical flow HSV visualisation during the scores computation
+     * @param[in] exportFlowVisualisation true to write the visualisation of each optical flow when it is computed
+     */
+    void setExportFlowVisualisation(bool exportFlowVisualisation)
+    {
+        _exportFlowVisualisation = exportFlowVisualisation;
+    }
+
     /**
      * @brief Set the minimum frame step parameter for the processing algorithm
      * @param[in] frameStep minimum number of frames between two keyframes
@@ -227,6 +240,15 @@ private:
      */
     cv::Mat readImage(dataio::FeedProvider &feed, std::size_t width = 0);
 
+    /**
+     * @brief Rescale a grayscale OpenCV matrix if it is wider than the provided size.
+     * @param[in] grayscaleImage the input grayscale matrix
+     * @param[in] width The width to resize the input image to. The height will be adjusted with respect to the size ratio.
+     *                  There will be no resizing if this parameter is set to 0
+     * @return An OpenCV Mat object containing the rescaled image, sharing the input data if it is not rescaled
+     */
+    static cv::Mat rescaleImage(const cv::Mat& grayscaleImage, std::size_t width);
+
     /**
      * @brief Compute the sharpness scores for an input grayscale frame with a sliding window
      * @param[in] grayscaleImage the input grayscale matrix of the frame
@@ -241,10 +263,25 @@ private:
      * @param[in] grayscaleImage the grayscale matrix of the current frame
      * @param[in] previousGrayscaleImage the grayscale matrix of the previous frame
      * @param[in] cellSize the size of the evaluated cells within the frame
+     * @param[out] flow the computed optical flow
      * @return a double value representing the median motion of all the image's cells
      */
     double estimateFlow(const cv::Ptr<cv::DenseOpticalFlow>& ptrFlow, const cv::Mat& grayscaleImage,
-                        const cv::Mat& previousGrayscaleImage, const std::size_t cellSize);
+                        const cv::Mat& previousGrayscaleImage, const std::size_t cellSize, cv::Mat& flow);
+
+    /**
+     * @brief Create the output folders of the optical flow visualisation (one per camera of the rig, if any)
+     * @return the output folder of each media path
+     */
+    std::vector<std::string> createFlowVisualisationFolders() const;
+
+    /**
+     * @brief Write the HSV visualisation of an optical flow as a PNG image
+     * @param[in] flow the optical flow between a frame and its previous frame
+     * @param[in] outputFolder the output folder
+     * @param[in] frameIndex the index of the frame
+     */
+    static void writeFlowVisualisation(const cv::Mat& flow, const std::string& outputFolder, std::size_t frameIndex);
 
     /**
      * @brief Write the output SfMData files with the selected and non-selected keyframes information
@@ -345,6 +382,13 @@ private:
     /// Output SfMData containing the non-selected frames
     sfmData::SfMData _outputSfmFrames;
 
+    /// Export the optical flow visualisation during the scores computation
+    bool _exportFlowVisualisation = false;
+    /// The optical flow visualisation has been exported by the last scores computation
+    bool _flowVisualisationExported = false;
+    /// Width of the frames used for the exported optical flow visualisation
+    std::size_t _flowVisualisationWidth = 0;
+
     /// Size of the frame (afer rescale, if any is applied)
     unsigned int _frameWidth = 0;
     unsigned int _frameHeight = 0;
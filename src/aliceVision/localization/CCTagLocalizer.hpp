@@ -209,7 +209,7 @@ void kNearestKeyFrames(
  * each possible marker for that view.
  */
 std::bitset<128> constructCCTagViewDescriptor(
-        const std::vector<feature::CCTAG_Regions::DescriptorT> & vCCTagDescriptors);
+        const feature::CCTAG_Regions::DescsViewT & vCCTagDescriptors);
 
 float viewSimilarity(
         const feature::CCTAG_Regions & regionsA,
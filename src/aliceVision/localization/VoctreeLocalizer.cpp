@@ -357,7 +357,7 @@ bool VoctreeLocalizer::initDatabase(const std::string & vocTreeFilepath,
 
       if(descType == _voctreeDescType)
       {
-        voctree::SparseHistogram histo = _voctree->quantizeToSparse(currRegions->blindDescriptors());
+        voctree::SparseHistogram histo = _voctree->quantizeToSparse(currRegions->DescriptorRawData(), currRegions->RegionCount());
 #pragma omp critical
         {
           _database.insert(id_view, histo);
@@ -391,7 +391,7 @@ bool VoctreeLocalizer::localizeFirstBestResult(const feature::MapRegionsPerDesc
   ALICEVISION_LOG_DEBUG("[database]\tRequest closest images from voctree");
   // pass the descriptors through the vocabulary tree to get the visual words
   // associated to each feature
-  voctree::SparseHistogram requestImageWords = _voctree->quantizeToSparse(queryRegions.at(_voctreeDescType)->blindDescriptors());
+  voctree::SparseHistogram requestImageWords = _voctree->quantizeToSparse(queryRegions.at(_voctreeDescType)->DescriptorRawData(), queryRegions.at(_voctreeDescType)->RegionCount());
   
   // Request closest images from voctree
   std::vector<voctree::DocMatch> matchedImages;
@@ -762,7 +762,7 @@ void VoctreeLocalizer::getAllAssociations(const feature::MapRegionsPerDesc &quer
     ALICEVISION_LOG_WARNING("[database]\t No feature type " << feature::EImageDescriberType_enumToString(_voctreeDescType) << " in query region.");
     return;
   }
-  voctree::SparseHistogram requestImageWords = _voctree->quantizeToSparse(queryRegions.at(_voctreeDescType)->blindDescriptors());
+  voctree::SparseHistogram requestImageWords = _voctree->quantizeToSparse(queryRegions.at(_voctreeDescType)->DescriptorRawData(), queryRegions.at(_voctreeDescType)->RegionCount());
   
   // Request closest images from voctree
   _database.find(requestImageWords, (param._numResults==0) ? (_database.size()) : (param._numResults) , out_matchedImages);
@@ -10,6 +10,7 @@
 #include <aliceVision/numeric/numeric.hpp>
 #include <aliceVision/matching/ArrayMatcher.hpp>
 #include <aliceVision/feature/metric.hpp>
+#include <aliceVision/feature/metricSimd.hpp>
 #include <aliceVision/stl/indexedSort.hpp>
 
 #include <aliceVision/config.hpp>
@@ -124,6 +125,27 @@ class ArrayMatcher_bruteForce  : public ArrayMatcher<Scalar, Metric>
     pvec_distances->resize(nbQuery * NN);
     pvec_indices->resize(nbQuery * NN);
 
+    // Distance ratio test: use the batched top-2 SIMD kernel if available for this metric
+    if constexpr (feature::MetricTop2Kernel<Scalar, Metric>::available)
+    {
+      if (NN <= 2)
+      {
+        typedef feature::MetricTop2Kernel<Scalar, Metric> KernelT;
+        std::vector<feature::Top2Neighbours<typename KernelT::DistanceT>> neighbours(nbQuery);
+        KernelT::search(query, nbQuery, (*memMapping).data(), (*memMapping).rows(), (*memMapping).cols(), neighbours.data());
+
+        for (int queryIndex = 0; queryIndex < nbQuery; ++queryIndex)
+        {
+          for (size_t i = 0; i < NN; ++i)
+          {
+            (*pvec_distances)[queryIndex*NN+i] = static_cast<DistanceType>(neighbours[queryIndex].distance[i]);
+            (*pvec_indices)[queryIndex*NN+i] = IndMatch(queryIndex, neighbours[queryIndex].index[i]);
+          }
+        }
+        return true;
+      }
+    }
+
     #pragma omp parallel for schedule(dynamic)
     for (int queryIndex=0; queryIndex < nbQuery; ++queryIndex) 
     {
@@ -121,7 +121,8 @@ class ArrayMatcher_kdtreeFlann : public ArrayMatcher<Scalar, Metric>
     flann::Matrix<Scalar> queries((Scalar*)query, nbQuery, _dimension);
     // do a knn search, using 128 checks
     flann::SearchParams params(128);
-    params.cores = omp_get_max_threads();
+    // avoid oversubscription when the caller already runs in a parallel region
+    params.cores = omp_in_parallel() ? 1 : omp_get_max_threads();
 
     if (_index->knnSearch(queries, indices, dists, NN, params) <= 0)
       return false;
@@ -0,0 +1,268 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "MatchesFile.hpp"
+#include <aliceVision/system/Logger.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace fs = boost::filesystem;
+
+namespace aliceVision {
+namespace matching {
+
+namespace {
+
+const char matchesFileMagic[8] = {'A', 'V', 'M', 'A', 'T', 'C', 'H', 0};
+
+} // namespace
+
+MatchesFileWriter::MatchesFileWriter(const std::string& filepath)
+  : _filepath(filepath)
+{
+  const fs::path bPath = fs::path(filepath);
+  _tmpFilepath = (bPath.parent_path() / bPath.stem()).string() + "." + fs::unique_path().string() + bPath.extension().string();
+
+  _stream.open(_tmpFilepath, std::ios::out | std::ios::binary);
+  if(!_stream.is_open())
+    throw std::runtime_error("Can't save matches file, can't open '" + _tmpFilepath + "' !");
+
+  // header is rewritten on close, when the offset table position is known
+  MatchesFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, matchesFileMagic, sizeof(matchesFileMagic));
+  header.version = MATCHES_FILE_VERSION;
+  _stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  _offset = sizeof(header);
+}
+
+MatchesFileWriter::~MatchesFileWriter()
+{
+  try
+  {
+    close();
+  }
+  catch(const std::exception& e)
+  {
+    ALICEVISION_LOG_ERROR(e.what());
+  }
+}
+
+void MatchesFileWriter::append(const Pair& pair, const MatchesPerDescType& matches)
+{
+  std::vector<std::uint32_t> block;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if(!_stream.is_open())
+    throw std::runtime_error("Can't append matches, file '" + _filepath + "' is closed.");
+
+  for(const auto& matchesPerDesc : matches)
+  {
+    const IndMatches& indMatches = matchesPerDesc.second;
+
+    MatchesFileIndexEntry entry;
+    entry.I = pair.first;
+    entry.J = pair.second;
+    entry.descType = static_cast<std::uint32_t>(matchesPerDesc.first);
+    entry.reserved = 0;
+    entry.offset = _offset;
+    entry.count = indMatches.size();
+
+    block.resize(2 * indMatches.size());
+    for(std::size_t i = 0; i < indMatches.size(); ++i)
+    {
+      block[2 * i] = indMatches[i]._i;
+      block[2 * i + 1] = indMatches[i]._j;
+    }
+
+    const std::uint64_t blockSize = block.size() * sizeof(std::uint32_t);
+    _stream.write(reinterpret_cast<const char*>(block.data()), blockSize);
+    _offset += blockSize;
+    _entries.push_back(entry);
+  }
+
+  if(!_stream.good())
+    throw std::runtime_error("Can't save matches file, '" + _tmpFilepath + "' is incorrect !");
+}
+
+void MatchesFileWriter::close()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if(!_stream.is_open())
+    return;
+
+  std::sort(_entries.begin(), _entries.end(), [](const MatchesFileIndexEntry& a, const MatchesFileIndexEntry& b) {
+    return std::tie(a.I, a.J, a.descType) < std::tie(b.I, b.J, b.descType);
+  });
+
+  _stream.write(reinterpret_cast<const char*>(_entries.data()), _entries.size() * sizeof(MatchesFileIndexEntry));
+
+  MatchesFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, matchesFileMagic, sizeof(matchesFileMagic));
+  header.version = MATCHES_FILE_VERSION;
+  header.indexOffset = _offset;
+  header.entryCount = _entries.size();
+
+  _stream.seekp(0);
+  _stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  const bool good = _stream.good();
+  _stream.close();
+
+  if(!good)
+    throw std::runtime_error("Can't save matches file, '" + _tmpFilepath + "' is incorrect !");
+
+  // rename temporary file
+  fs::rename(_tmpFilepath, _filepath);
+}
+
+MatchesFileReader::MatchesFileReader(const std::string& filepath)
+  : _filepath(filepath)
+{
+  try
+  {
+    _file = boost::interprocess::file_mapping(filepath.c_str(), boost::interprocess::read_only);
+    _region = boost::interprocess::mapped_region(_file, boost::interprocess::read_only);
+  }
+  catch(const boost::interprocess::interprocess_exception& e)
+  {
+    throw std::runtime_error("Can't load matches file, can't map '" + filepath + "' : " + e.what());
+  }
+
+  if(_region.get_size() < sizeof(MatchesFileHeader))
+    throw std::runtime_error("Can't load matches file, '" + filepath + "' is too small.");
+
+  const MatchesFileHeader* header = static_cast<const MatchesFileHeader*>(_region.get_address());
+
+  if(std::memcmp(header->magic, matchesFileMagic, sizeof(matchesFileMagic)) != 0)
+    throw std::runtime_error("Can't load matches file, '" + filepath + "' is not a binary matches file.");
+
+  if(header->version != MATCHES_FILE_VERSION)
+    throw std::runtime_error("Can't load matches file, '" + filepath + "' has an unsupported version (" +
+                             std::to_string(header->version) + ").");
+
+  // compare by division: a crafted header must not pass the check after a 64-bit wrap-around
+  const std::uint64_t fileSize = _region.get_size();
+  if(header->indexOffset < sizeof(MatchesFileHeader) || header->indexOffset > fileSize ||
+     (fileSize - header->indexOffset) % sizeof(MatchesFileIndexEntry) != 0 ||
+     header->entryCount != (fileSize - header->indexOffset) / sizeof(MatchesFileIndexEntry))
+    throw std::runtime_error("Can't load matches file, '" + filepath + "' is incomplete or incorrect.");
+
+  _entries = reinterpret_cast<const MatchesFileIndexEntry*>(static_cast<const char*>(_region.get_address()) + header->indexOffset);
+  _nbEntries = static_cast<std::size_t>(header->entryCount);
+
+  // entries are sorted by pair: group consecutive entries
+  _pairs.reserve(_nbEntries);
+  std::size_t first = 0;
+  for(std::size_t i = 1; i <= _nbEntries; ++i)
+  {
+    if(i == _nbEntries || _entries[i].I != _entries[first].I || _entries[i].J != _entries[first].J)
+    {
+      const MatchesFileIndexEntry& entry = _entries[first];
+      _pairs[pairKey(Pair(entry.I, entry.J))] = std::make_pair(first, i);
+      first = i;
+    }
+  }
+
+  for(std::size_t i = 0; i < _nbEntries; ++i)
+  {
+    const MatchesFileIndexEntry& entry = _entries[i];
+    if(entry.offset < sizeof(MatchesFileHeader) || entry.offset > header->indexOffset ||
+       entry.count > (header->indexOffset - entry.offset) / (2 * sizeof(std::uint32_t)))
+      throw std::runtime_error("Can't load matches file, '" + filepath + "' is incorrect.");
+  }
+}
+
+PairSet MatchesFileReader::getPairs() const
+{
+  PairSet pairs;
+  for(std::size_t i = 0; i < _nbEntries; ++i)
+    pairs.insert(pairs.end(), Pair(_entries[i].I, _entries[i].J));
+  return pairs;
+}
+
+void MatchesFileReader::readBlock(const MatchesFileIndexEntry& entry, IndMatches& matches) const
+{
+  const std::uint32_t* block = reinterpret_cast<const std::uint32_t*>(static_cast<const char*>(_region.get_address()) + entry.offset);
+
+  matches.resize(entry.count);
+  for(std::size_t i = 0; i < entry.count; ++i)
+  {
+    matches[i] = IndMatch(block[2 * i], block[2 * i + 1]);
+  }
+}
+
+bool MatchesFileReader::load(const Pair& pair, MatchesPerDescType& matches) const
+{
+  const auto it = _pairs.find(pairKey(pair));
+  if(it == _pairs.end())
+    return false;
+
+  for(std::size_t i = it->second.first; i < it->second.second; ++i)
+  {
+    const MatchesFileIndexEntry& entry = _entries[i];
+    readBlock(entry, matches[static_cast<feature::EImageDescriberType>(entry.descType)]);
+  }
+  return true;
+}
+
+bool MatchesFileReader::load(const Pair& pair, feature::EImageDescriberType descType, IndMatches& matches) const
+{
+  const auto it = _pairs.find(pairKey(pair));
+  if(it == _pairs.end())
+    return false;
+
+  for(std::size_t i = it->second.first; i < it->second.second; ++i)
+  {
+    const MatchesFileIndexEntry& entry = _entries[i];
+    if(static_cast<feature::EImageDescriberType>(entry.descType) == descType)
+    {
+      readBlock(entry, matches);
+      return true;
+    }
+  }
+  return false;
+}
+
+void MatchesFileReader::loadAll(PairwiseMatches& matches,
+                                const std::set<IndexT>& viewsKeysFilter,
+                                const std::vector<feature::EImageDescriberType>& descTypesFilter) const
+{
+  IndMatches indMatches;
+
+  for(std::size_t i = 0; i < _nbEntries; ++i)
+  {
+    const MatchesFileIndexEntry& entry = _entries[i];
+    const feature::EImageDescriberType descType = static_cast<feature::EImageDescriberType>(entry.descType);
+
+    if(!viewsKeysFilter.empty() && (viewsKeysFilter.count(entry.I) == 0 || viewsKeysFilter.count(entry.J) == 0))
+      continue;
+
+    if(!descTypesFilter.empty() && std::find(descTypesFilter.begin(), descTypesFilter.end(), descType) == descTypesFilter.end())
+      continue;
+
+    readBlock(entry, indMatches);
+
+    // merge in the output (matches of the same pair may be loaded from several files)
+    IndMatches& outMatches = matches[Pair(entry.I, entry.J)][descType];
+    if(outMatches.empty())
+      outMatches.swap(indMatches);
+    else
+      outMatches.insert(outMatches.end(), indMatches.begin(), indMatches.end());
+  }
+}
+
+}  // namespace matching
+}  // namespace aliceVision
@@ -0,0 +1,177 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/matching/IndMatch.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aliceVision {
+namespace matching {
+
+/// Current version of the binary matches file
+constexpr std::uint32_t MATCHES_FILE_VERSION = 1;
+
+/**
+ * @brief Entry of the binary matches file offset table.
+ *        One entry per image pair and describer type.
+ */
+struct MatchesFileIndexEntry
+{
+  std::uint32_t I;
+  std::uint32_t J;
+  std::uint32_t descType;
+  std::uint32_t reserved;
+  /// offset (in bytes) of the first match of the block
+  std::uint64_t offset;
+  /// number of matches of the block
+  std::uint64_t count;
+};
+
+static_assert(sizeof(MatchesFileIndexEntry) == 32, "Unexpected MatchesFileIndexEntry size.");
+
+/**
+ * @brief Header of the binary matches file.
+ *
+ * File layout: [header][match blocks][offset table]
+ * - match blocks: for each pair and describer type, count x 2 uint32 (feature index in I, feature index in J)
+ * - offset table: pairCount x MatchesFileIndexEntry sorted by (I, J, descType)
+ *
+ * The offset table is written when the file is closed, so match blocks can be appended
+ * while they are computed. A file with a null indexOffset is incomplete.
+ */
+struct MatchesFileHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t indexOffset;
+  std::uint64_t entryCount;
+};
+
+static_assert(sizeof(MatchesFileHeader) == 32, "Unexpected MatchesFileHeader size.");
+
+/**
+ * @brief Streaming writer of a binary matches file.
+ *        Pairs can be appended from several threads, the offset table is written on close.
+ */
+class MatchesFileWriter
+{
+public:
+  /**
+   * @brief Open a binary matches file for writing.
+   *        The data is written in a temporary file renamed on close.
+   * @param[in] filepath the output file path
+   */
+  explicit MatchesFileWriter(const std::string& filepath);
+
+  ~MatchesFileWriter();
+
+  /**
+   * @brief Append the matches of one image pair.
+   * @note Thread-safe
+   * @param[in] pair the image pair
+   * @param[in] matches the pair matches for each describer type
+   */
+  void append(const Pair& pair, const MatchesPerDescType& matches);
+
+  /**
+   * @brief Write the offset table and close the file.
+   */
+  void close();
+
+private:
+  std::string _filepath;
+  std::string _tmpFilepath;
+  std::ofstream _stream;
+  std::uint64_t _offset = 0;
+  std::vector<MatchesFileIndexEntry> _entries;
+  std::mutex _mutex;
+};
+
+/**
+ * @brief Read-only access to a binary matches file.
+ *        Only the offset table is read on construction, the matches of one pair
+ *        are read from the file mapping on demand.
+ */
+class MatchesFileReader
+{
+public:
+  /**
+   * @brief Map a binary matches file and read its offset table
+   * @param[in] filepath the binary matches file path
+   * @throw std::runtime_error if the file cannot be mapped or is invalid
+   */
+  explicit MatchesFileReader(const std::string& filepath);
+
+  /// Return the number of image pairs stored in the file
+  std::size_t getNbPairs() const { return _pairs.size(); }
+
+  /// Return all the image pairs stored in the file
+  PairSet getPairs() const;
+
+  /// Return true if the given pair is stored in the file
+  bool hasPair(const Pair& pair) const { return _pairs.count(pairKey(pair)) != 0; }
+
+  /**
+   * @brief Load the matches of one image pair.
+   * @note Thread-safe
+   * @param[in] pair the image pair
+   * @param[out] matches the pair matches for each describer type
+   * @return false if the pair is not stored in the file
+   */
+  bool load(const Pair& pair, MatchesPerDescType& matches) const;
+
+  /**
+   * @brief Load the matches of one image pair for one describer type.
+   * @note Thread-safe
+   * @param[in] pair the image pair
+   * @param[in] descType the describer type
+   * @param[out] matches the pair matches
+   * @return false if the pair is not stored in the file for this describer type
+   */
+  bool load(const Pair& pair, feature::EImageDescriberType descType, IndMatches& matches) const;
+
+  /**
+   * @brief Load all the matches of the file, optionally restricted to some views and describer types.
+   *        Unrequested pairs are never read.
+   * @param[in,out] matches the matches are appended to this container
+   * @param[in] viewsKeysFilter restrict the loading to pairs of these views (if not empty)
+   * @param[in] descTypesFilter restrict the loading to these describer types (if not empty)
+   */
+  void loadAll(PairwiseMatches& matches,
+               const std::set<IndexT>& viewsKeysFilter = {},
+               const std::vector<feature::EImageDescriberType>& descTypesFilter = {}) const;
+
+private:
+  static std::uint64_t pairKey(const Pair& pair)
+  {
+    return (static_cast<std::uint64_t>(pair.first) << 32) | static_cast<std::uint64_t>(pair.second);
+  }
+
+  void readBlock(const MatchesFileIndexEntry& entry, IndMatches& matches) const;
+
+  std::string _filepath;
+  boost::interprocess::file_mapping _file;
+  boost::interprocess::mapped_region _region;
+  const MatchesFileIndexEntry* _entries = nullptr;
+  std::size_t _nbEntries = 0;
+  /// pair key -> [first entry, end entry) in the offset table
+  std::unordered_map<std::uint64_t, std::pair<std::size_t, std::size_t>> _pairs;
+};
+
+}  // namespace matching
+}  // namespace aliceVision
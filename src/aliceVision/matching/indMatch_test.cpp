@@ -7,6 +7,7 @@
 
 #include "aliceVision/matching/IndMatch.hpp"
 #include "aliceVision/matching/io.hpp"
+#include "aliceVision/matching/MatchesFile.hpp"
 
 #include <boost/filesystem/operations.hpp>
 
@@ -162,3 +163,57 @@ BOOST_AUTO_TEST_CASE(IndMatch_DuplicateRemoval)
   BOOST_CHECK_EQUAL(IndMatch(2,3), vec_indMatch[3]);
   BOOST_CHECK_EQUAL(IndMatch(3,3), vec_indMatch[4]);
 }
+
+BOOST_AUTO_TEST_CASE(IndMatch_IO_Binary)
+{
+  const std::string testFolder = "matchingBinTest";
+  boost::filesystem::remove_all(testFolder);
+  boost::filesystem::create_directory(testFolder);
+  {
+    PairwiseMatches matches;
+    matches[std::make_pair(0,1)][EImageDescriberType::UNKNOWN] = {{0,0},{1,1}};
+    matches[std::make_pair(0,1)][EImageDescriberType::SIFT] = {{5,6}};
+    matches[std::make_pair(1,2)][EImageDescriberType::UNKNOWN] = {{0,0},{1,1},{2,2}};
+    matches[std::make_pair(2,3)][EImageDescriberType::UNKNOWN] = {{7,8}};
+
+    BOOST_CHECK(Save(matches, testFolder, "bin", false));
+
+    // per-pair lookup
+    const MatchesFileReader reader((fs::path(testFolder) / "matches.bin").string());
+    BOOST_CHECK_EQUAL(3, reader.getNbPairs());
+    BOOST_CHECK(reader.hasPair(std::make_pair(1,2)));
+    BOOST_CHECK(!reader.hasPair(std::make_pair(0,2)));
+
+    MatchesPerDescType pairMatches;
+    BOOST_CHECK(reader.load(std::make_pair(0,1), pairMatches));
+    BOOST_CHECK_EQUAL(2, pairMatches.size());
+    BOOST_CHECK(pairMatches.at(EImageDescriberType::UNKNOWN) == matches.at(std::make_pair(0,1)).at(EImageDescriberType::UNKNOWN));
+    BOOST_CHECK(pairMatches.at(EImageDescriberType::SIFT) == matches.at(std::make_pair(0,1)).at(EImageDescriberType::SIFT));
+
+    IndMatches indMatches;
+    BOOST_CHECK(reader.load(std::make_pair(1,2), EImageDescriberType::UNKNOWN, indMatches));
+    BOOST_CHECK_EQUAL(3, indMatches.size());
+    BOOST_CHECK(!reader.load(std::make_pair(1,2), EImageDescriberType::SIFT, indMatches));
+
+    // load with view and descriptor type filters
+    PairwiseMatches loadedMatches;
+    BOOST_CHECK(Load(loadedMatches, {0, 1, 2}, {testFolder}, {EImageDescriberType::UNKNOWN}));
+    BOOST_CHECK_EQUAL(2, loadedMatches.size());
+    BOOST_CHECK_EQUAL(1, loadedMatches.at(std::make_pair(0,1)).size());
+    BOOST_CHECK_EQUAL(3, loadedMatches.at(std::make_pair(1,2)).at(EImageDescriberType::UNKNOWN).size());
+  }
+  boost::filesystem::remove_all(testFolder);
+  boost::filesystem::create_directory(testFolder);
+  {
+    PairwiseMatches matches;
+    matches[std::make_pair(0,1)][EImageDescriberType::UNKNOWN] = {{0,0},{1,1}};
+    matches[std::make_pair(1,2)][EImageDescriberType::UNKNOWN] = {{0,0},{1,1},{2,2}};
+
+    // one file per image
+    BOOST_CHECK(Save(matches, testFolder, "bin", true));
+    PairwiseMatches loadedMatches;
+    BOOST_CHECK_EQUAL(2, LoadMatchFilePerImage(loadedMatches, {0, 1}, testFolder, "matches.bin"));
+    BOOST_CHECK(loadedMatches == matches);
+  }
+  boost::filesystem::remove_all(testFolder);
+}
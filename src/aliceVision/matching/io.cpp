@@ -7,6 +7,7 @@
 
 #include "io.hpp"
 #include <aliceVision/matching/IndMatch.hpp>
+#include <aliceVision/matching/MatchesFile.hpp>
 #include <aliceVision/config.hpp>
 #include <aliceVision/system/Logger.hpp>
 
@@ -24,14 +25,37 @@ namespace fs = boost::filesystem;
 namespace aliceVision {
 namespace matching {
 
-bool LoadMatchFile(PairwiseMatches& matches, const std::string& filepath)
+/**
+ * @brief Load a match file, optionally restricted to some views and describer types.
+ * @note Filters are only applied at read time for the binary format.
+ */
+bool loadMatchFile(PairwiseMatches& matches,
+                   const std::string& filepath,
+                   const std::set<IndexT>& viewsKeysFilter,
+                   const std::vector<feature::EImageDescriberType>& descTypesFilter)
 {
   const std::string ext = fs::extension(filepath);
 
   if(!fs::exists(filepath))
     return false;
 
-  if(ext == ".txt")
+  if(ext == ".bin")
+  {
+    try
+    {
+      // only the offset table is read, unrequested pairs are skipped
+      // the requested pairs are still all loaded: PairwiseMatches is an in-memory container
+      const MatchesFileReader reader(filepath);
+      reader.loadAll(matches, viewsKeysFilter, descTypesFilter);
+    }
+    catch(const std::exception& e)
+    {
+      ALICEVISION_LOG_WARNING(e.what());
+      return false;
+    }
+    return true;
+  }
+  else if(ext == ".txt")
   {
     std::ifstream stream(filepath);
     if (!stream.is_open())
@@ -78,6 +102,35 @@ bool LoadMatchFile(PairwiseMatches& matches, const std::string& filepath)
   return false;
 }
 
+bool LoadMatchFile(PairwiseMatches& matches, const std::string& filepath)
+{
+  return loadMatchFile(matches, filepath, {}, {});
+}
+
+/**
+ * @brief Merge pair-wise matches into \p matches, appending the matches of already existing pairs.
+ */
+void mergeMatches(PairwiseMatches& matches, PairwiseMatches& fileMatches)
+{
+  for(auto& matchesPerView: fileMatches)
+  {
+    MatchesPerDescType& outPairMatches = matches[matchesPerView.first];
+    for(auto& matchesPerDescType : matchesPerView.second)
+    {
+      IndMatches& outMatches = outPairMatches[matchesPerDescType.first];
+      IndMatches& pairMatches = matchesPerDescType.second;
+      if(outMatches.empty())
+        outMatches.swap(pairMatches);
+      else
+        std::copy(
+          std::make_move_iterator(pairMatches.begin()),
+          std::make_move_iterator(pairMatches.end()),
+          std::back_inserter(outMatches)
+        );
+    }
+  }
+}
+
 void filterMatchesByViews(PairwiseMatches& matches, const std::set<IndexT>& viewsKeys)
 {
   matching::PairwiseMatches filteredMatches;
@@ -135,33 +188,32 @@ std::size_t LoadMatchFilePerImage(PairwiseMatches& matches,
                                   const std::string& folder,
                                   const std::string& extension)
 {
-  int nbLoadedMatchFiles = 0;
-  // Load one match file per image
-  #pragma omp parallel for num_threads(3)
-  for(ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(viewsKeys.size()); ++i)
+  const std::vector<IndexT> views(viewsKeys.begin(), viewsKeys.end());
+  std::vector<PairwiseMatches> matchesPerFile(views.size());
+  std::vector<char> loadedPerFile(views.size(), 0);
+
+  // Load one match file per image, each thread fills its own containers
+  #pragma omp parallel for
+  for(ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(views.size()); ++i)
   {
-    std::set<IndexT>::const_iterator it = viewsKeys.begin();
-    std::advance(it, i);
-    const IndexT idView = *it;
-    const std::string matchFilename = std::to_string(idView) + "." + extension;
-    PairwiseMatches fileMatches;
-    if(!LoadMatchFile(fileMatches, (fs::path(folder) / matchFilename).string() ))
-    {
-      #pragma omp critical
-      {
-        ALICEVISION_LOG_DEBUG("Unable to load match file: " << matchFilename << " in: " << folder);
-      }
+    const std::string matchFilename = std::to_string(views[i]) + "." + extension;
+    loadedPerFile[i] = LoadMatchFile(matchesPerFile[i], (fs::path(folder) / matchFilename).string());
+    if(!loadedPerFile[i])
+      ALICEVISION_LOG_DEBUG("Unable to load match file: " << matchFilename << " in: " << folder);
+  }
+
+  // merge the loaded matches into the output
+  std::size_t nbLoadedMatchFiles = 0;
+  for(std::size_t i = 0; i < views.size(); ++i)
+  {
+    if(!loadedPerFile[i])
       continue;
-    }
-    #pragma omp critical
+    ++nbLoadedMatchFiles;
+    for(auto& v: matchesPerFile[i])
     {
-      ++nbLoadedMatchFiles;
-      // merge the loaded matches into the output
-      for(const auto& v: fileMatches)
-      {
-        matches[v.first] = v.second;
-      }
+      matches[v.first] = std::move(v.second);
     }
+    PairwiseMatches().swap(matchesPerFile[i]);
   }
   return nbLoadedMatchFiles;
 }
@@ -171,8 +223,14 @@ std::size_t LoadMatchFilePerImage(PairwiseMatches& matches,
  * @param[out] matches PairwiseMatches to add loaded matches to
  * @param[in] folder Folder to load matches files from
  * @param[in] pattern Pattern that files must respect to be loaded
+ * @param[in] viewsKeysFilter Restrict the matches read from binary files to these views
+ * @param[in] descTypesFilter Restrict the matches read from binary files to these types of descriptors
  */
-std::size_t loadMatchesFromFolder(PairwiseMatches& matches, const std::string& folder, const std::string& pattern)
+std::size_t loadMatchesFromFolder(PairwiseMatches& matches,
+                                  const std::string& folder,
+                                  const std::string& pattern,
+                                  const std::set<IndexT>& viewsKeysFilter,
+                                  const std::vector<feature::EImageDescriberType>& descTypesFilter)
 {
   std::size_t nbLoadedMatchFiles = 0;
   std::vector<std::string> matchFiles;
@@ -185,40 +243,32 @@ std::size_t loadMatchesFromFolder(PairwiseMatches& matches, const std::string& f
     }
   }
 
-  #pragma omp parallel for num_threads(3)
+  // sort to get a deterministic merge order
+  std::sort(matchFiles.begin(), matchFiles.end());
+
+  std::vector<PairwiseMatches> matchesPerFile(matchFiles.size());
+  std::vector<char> loadedPerFile(matchFiles.size(), 0);
+
+  // each thread loads into its own container, no synchronization needed
+  #pragma omp parallel for
   for(int i = 0; i < matchFiles.size(); ++i)
   {
     const std::string& matchFile = matchFiles[i];
-    PairwiseMatches fileMatches;
     ALICEVISION_LOG_DEBUG("Loading match file: " << matchFile);
-    if(!LoadMatchFile(fileMatches, matchFile))
-    {
+    loadedPerFile[i] = loadMatchFile(matchesPerFile[i], matchFile, viewsKeysFilter, descTypesFilter);
+    if(!loadedPerFile[i])
       ALICEVISION_LOG_WARNING("Unable to load match file: " << matchFile);
+  }
+
+  // merge in global map
+  for(std::size_t i = 0; i < matchFiles.size(); ++i)
+  {
+    if(!loadedPerFile[i])
       continue;
-    }
-    #pragma omp critical
-    {
-    for(const auto& matchesPerView: fileMatches)
-    {
-      const Pair& pair = matchesPerView.first;
-      const MatchesPerDescType& pairMatches = matchesPerView.second;
-      for(const auto& matchesPerDescType : pairMatches)
-      {
-        const feature::EImageDescriberType& descType = matchesPerDescType.first;
-        const auto& pairMatches = matchesPerDescType.second;
-        // merge in global map
-        std::copy(
-          std::make_move_iterator(pairMatches.begin()), 
-          std::make_move_iterator(pairMatches.end()), 
-          std::back_inserter(matches[pair][descType])
-        );
-      }
-    }
+    mergeMatches(matches, matchesPerFile[i]);
+    PairwiseMatches().swap(matchesPerFile[i]);
     ++nbLoadedMatchFiles;
-    }   
   }
-  if(!nbLoadedMatchFiles)
-    ALICEVISION_LOG_WARNING("No matches file loaded in: " << folder);
   return nbLoadedMatchFiles;
 }
 
@@ -230,7 +280,6 @@ bool Load(PairwiseMatches& matches,
           int minNbMatches)
 {
   std::size_t nbLoadedMatchFiles = 0;
-  const std::string pattern = "matches.txt";
 
   // build up a set with normalized paths to remove duplicates
   std::set<std::string> foldersSet;
@@ -244,7 +293,13 @@ bool Load(PairwiseMatches& matches,
 
   for(const auto& folder : foldersSet)
   {
-    nbLoadedMatchFiles += loadMatchesFromFolder(matches, folder, pattern);
+    // binary match files are preferred, text files are only loaded if there is no binary file
+    std::size_t nbLoadedFolderMatchFiles = loadMatchesFromFolder(matches, folder, "matches.bin", viewsKeysFilter, descTypesFilter);
+    if(!nbLoadedFolderMatchFiles)
+      nbLoadedFolderMatchFiles = loadMatchesFromFolder(matches, folder, "matches.txt", viewsKeysFilter, descTypesFilter);
+    if(!nbLoadedFolderMatchFiles)
+      ALICEVISION_LOG_WARNING("No matches file loaded in: " << folder);
+    nbLoadedMatchFiles += nbLoadedFolderMatchFiles;
   }
 
   if(!nbLoadedMatchFiles)
@@ -315,6 +370,21 @@ private:
     fs::rename(tmpPath, filepath);
   }
 
+  void saveBin(
+    const std::string& filepath,
+    const PairwiseMatches::const_iterator& matchBegin,
+    const PairwiseMatches::const_iterator& matchEnd)
+  {
+    MatchesFileWriter writer(filepath);
+    for(PairwiseMatches::const_iterator match = matchBegin;
+      match != matchEnd;
+      ++match)
+    {
+      writer.append(match->first, match->second);
+    }
+    writer.close();
+  }
+
 public:
   MatchExporter(
     const PairwiseMatches& matches,
@@ -334,6 +404,8 @@ public:
 
     if(m_ext == ".txt")
       saveTxt(filepath, m_matches.begin(), m_matches.end());
+    else if(m_ext == ".bin")
+      saveBin(filepath, m_matches.begin(), m_matches.end());
     else
       throw std::runtime_error(std::string("Unknown matching file format: ") + m_ext);
   }
@@ -359,6 +431,8 @@ public:
       
       if(m_ext == ".txt")
         saveTxt(filepath, matchBegin, match);
+      else if(m_ext == ".bin")
+        saveBin(filepath, matchBegin, match);
       else
         throw std::runtime_error(std::string("Unknown matching file format: ") + m_ext);
 
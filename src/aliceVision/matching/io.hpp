@@ -16,7 +16,7 @@ namespace matching {
 
 
 /**
- * @brief Load a match file.
+ * @brief Load a match file (text .txt or binary .bin).
  *
  * @param[out] matches container for the output matches
  * @param[in] filepath the match file to load
@@ -39,6 +39,8 @@ std::size_t LoadMatchFilePerImage(PairwiseMatches& matches,
 /**
  * @brief Load all the matches from the folder. Optionally filter the view, the type of descriptors
  * and the number of matches.
+ * Binary match files are preferred over text match files. For binary files, the view and
+ * descriptor type filters are applied before reading the matches.
  *
  * @param[out] matches container for the output matches.
  * @param[in] viewsKeysFilter Restrict the matches to these views.
@@ -47,6 +49,8 @@ std::size_t LoadMatchFilePerImage(PairwiseMatches& matches,
  * @param[in] maxNbMatches keep at most \p maxNbMatches matches (0 takes all matches).
  * @param[in] minNbMatches discard the match files with less than \p minNbMatches (0 takes all files).
  * @return \p false if no file could be loaded.
+ * @note All the requested matches are kept in memory. Consumers that can process one pair
+ *       at a time should read the binary files with MatchesFileReader::load instead.
  * @see filterMatchesByViews
  * @see filterTopMatches
  */
@@ -67,6 +67,24 @@ void matchesGridFiltering(const aliceVision::feature::Regions& lRegions,
                           const aliceVision::Pair& indexImagePair,
                           aliceVision::matching::IndMatches& outMatches, size_t gridSize = 3);
 
+/**
+ * @brief Sort the matches of one image pair by features scale, order them with a grid
+ *        and keep the best ones.
+ * @param[in] indexImagePair The Pair of matched images
+ * @param[in] matchesPerDesc The matches of the pair for each describer type
+ * @param[in] sfmData The SfMData with the views of the pair
+ * @param[in] regionPerView The regions of the views
+ * @param[in] useGridSort Order the matches with a grid
+ * @param[in] numMatchesToKeep Maximum number of matches to keep per describer type (0: all)
+ * @param[out] outMatchesPerDesc The filtered matches of the pair for each describer type
+ */
+void matchesGridFilteringForPair(const Pair& indexImagePair,
+                                 const MatchesPerDescType& matchesPerDesc,
+                                 const sfmData::SfMData& sfmData,
+                                 const feature::RegionsPerView& regionPerView,
+                                 bool useGridSort, std::size_t numMatchesToKeep,
+                                 MatchesPerDescType& outMatchesPerDesc);
+
 void matchesGridFilteringForAllPairs(const PairwiseMatches& geometricMatches,
                                      const sfmData::SfMData& sfmData,
                                      const feature::RegionsPerView& regionPerView,
@@ -13,6 +13,13 @@
 #include <aliceVision/matchingImageCollection/IImageCollectionMatcher.hpp>
 #include <aliceVision/system/ProgressDisplay.hpp>
 #include <aliceVision/config.hpp>
+#include <aliceVision/alicevision_omp.hpp>
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace aliceVision {
 namespace matchingImageCollection {
@@ -21,14 +28,138 @@ using namespace aliceVision::matching;
 using namespace aliceVision::feature;
 
 ImageCollectionMatcher_generic::ImageCollectionMatcher_generic(
-  float distRatio, bool crossMatching, EMatcherType matcherType)
+  float distRatio, bool crossMatching, EMatcherType matcherType, std::size_t maxCachedMatchers)
   : IImageCollectionMatcher()
   , _f_dist_ratio(distRatio)
   , _useCrossMatching(crossMatching)
   , _matcherType(matcherType)
+  , _maxCachedMatchers(maxCachedMatchers)
+{
+}
+
+namespace {
+
+/**
+ * @brief Per-image cache of regions matchers (with their search index).
+ *        A matcher is built on first use and kept resident in a LRU cache
+ *        bounded to a maximum number of matchers. An evicted matcher is freed
+ *        once the pairs still using it are done, and rebuilt if needed again.
+ */
+class RegionsMatcherCache
+{
+public:
+  RegionsMatcherCache(const feature::RegionsPerView& regionsPerView,
+                      feature::EImageDescriberType descType,
+                      EMatcherType matcherType,
+                      std::mt19937::result_type seed,
+                      std::size_t maxMatchers)
+    : _regionsPerView(regionsPerView)
+    , _descType(descType)
+    , _matcherType(matcherType)
+    , _seed(seed)
+    , _maxMatchers(std::max<std::size_t>(maxMatchers, 1))
+  {}
+
+  /// Get the matcher of the given view, build it if needed
+  /// @note Thread-safe
+  std::shared_ptr<const RegionsDatabaseMatcher> acquire(IndexT viewId)
+  {
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _entries.find(viewId);
+      if(it != _entries.end())
+      {
+        // most recently used
+        _lru.splice(_lru.begin(), _lru, it->second.second);
+        entry = it->second.first;
+      }
+      else
+      {
+        entry = std::make_shared<Entry>();
+        _lru.push_front(viewId);
+        _entries.emplace(viewId, std::make_pair(entry, _lru.begin()));
+
+        // evict the least recently used matchers
+        while(_entries.size() > _maxMatchers)
+        {
+          _entries.erase(_lru.back());
+          _lru.pop_back();
+          ++_nbEvictions;
+        }
+      }
+    }
+
+    // build outside of the cache lock: several matchers can be built at the same time
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if(!entry->matcher)
+    {
+      // seed from the view id: the matcher does not depend on the thread that builds it
+      std::mt19937 randomNumberGenerator(_seed + viewId);
+      entry->matcher = std::make_shared<const RegionsDatabaseMatcher>(randomNumberGenerator, _matcherType,
+                                                                      _regionsPerView.getRegions(viewId, _descType));
+    }
+    return entry->matcher;
+  }
+
+  /// Number of matchers evicted from the cache
+  std::size_t getNbEvictions() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _nbEvictions;
+  }
+
+private:
+  struct Entry
+  {
+    std::mutex mutex;
+    std::shared_ptr<const RegionsDatabaseMatcher> matcher;
+  };
+
+  const feature::RegionsPerView& _regionsPerView;
+  const feature::EImageDescriberType _descType;
+  const EMatcherType _matcherType;
+  const std::mt19937::result_type _seed;
+  const std::size_t _maxMatchers;
+
+  mutable std::mutex _mutex;
+  /// view ids from the most to the least recently used
+  std::list<IndexT> _lru;
+  std::map<IndexT, std::pair<std::shared_ptr<Entry>, std::list<IndexT>::iterator>> _entries;
+  std::size_t _nbEvictions = 0;
+};
+
+/**
+ * @brief Order the pairs by blocks of the pairs matrix.
+ *        The pairs of a block involve at most 2 * blockSize views, so consecutive pairs
+ *        reuse the same matchers, whatever the index of the second view.
+ * @param[in,out] pairs the pairs to order
+ * @param[in] blockSize the number of views per block side
+ */
+void orderPairsByBlocks(std::vector<Pair>& pairs, std::size_t blockSize)
 {
+  // rank of each view: the blocks do not depend on the view ids distribution
+  std::map<IndexT, std::size_t> viewRanks;
+  for(const Pair& pair : pairs)
+  {
+    viewRanks.emplace(pair.first, 0);
+    viewRanks.emplace(pair.second, 0);
+  }
+  std::size_t rank = 0;
+  for(auto& viewRank : viewRanks)
+    viewRank.second = rank++;
+
+  const std::size_t size = std::max<std::size_t>(blockSize, 1);
+  std::stable_sort(pairs.begin(), pairs.end(), [&](const Pair& a, const Pair& b)
+  {
+    const auto blockA = std::make_pair(viewRanks.at(a.first) / size, viewRanks.at(a.second) / size);
+    const auto blockB = std::make_pair(viewRanks.at(b.first) / size, viewRanks.at(b.second) / size);
+    return blockA < blockB;
+  });
 }
 
+} // namespace
+
 void ImageCollectionMatcher_generic::Match(
   std::mt19937 & randomNumberGenerator,
   const feature::RegionsPerView& regionsPerView,
@@ -39,90 +170,99 @@ void ImageCollectionMatcher_generic::Match(
 #if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_OPENMP)
   ALICEVISION_LOG_DEBUG("Using the OPENMP thread interface");
 #endif
-  const bool b_multithreaded_pair_search = (_matcherType == CASCADE_HASHING_L2);
-  // -> set to true for CASCADE_HASHING_L2, since OpenMP instructions are not used in this matcher
 
   auto progressDisplay = system::createConsoleProgressDisplay(pairs.size(), std::cout);
 
-  // Sort pairs according the first index to minimize the MatcherT build operations
-  typedef std::map<size_t, std::vector<size_t> > Map_vectorT;
-  Map_vectorT map_Pairs;
-  for (PairSet::const_iterator iter = pairs.begin(); iter != pairs.end(); ++iter)
-  {
-    map_Pairs[iter->first].push_back(iter->second);
-  }
+  std::vector<Pair> pairsToMatch;
+  pairsToMatch.reserve(pairs.size());
 
-  // Perform matching between all the pairs
-  for (Map_vectorT::const_iterator iter = map_Pairs.begin();
-    iter != map_Pairs.end(); ++iter)
+  for(const Pair& pair : pairs)
   {
-    const size_t I = iter->first;
-    const std::vector<size_t> & indexToCompare = iter->second;
+    const feature::Regions& regionsI = regionsPerView.getRegions(pair.first, descType);
+    const feature::Regions& regionsJ = regionsPerView.getRegions(pair.second, descType);
 
-    const feature::Regions & regionsI = regionsPerView.getRegions(I, descType);
-    if (regionsI.RegionCount() == 0)
+    if(regionsI.RegionCount() == 0 || regionsJ.RegionCount() == 0 ||
+       regionsI.Type_id() != regionsJ.Type_id())
     {
-      progressDisplay += indexToCompare.size();
+      ++progressDisplay;
       continue;
     }
 
-    // Initialize the matching interface
-    matching::RegionsDatabaseMatcher matcher(randomNumberGenerator, _matcherType, regionsI);
+    pairsToMatch.push_back(pair);
+  }
 
-    #pragma omp parallel for schedule(dynamic) if(b_multithreaded_pair_search)
-    for (int j = 0; j < (int)indexToCompare.size(); ++j)
-    {
-      const size_t J = indexToCompare[j];
+  // Pairs are sorted according the first index (PairSet order): consecutive pairs share the same
+  // database matcher of I. With cross matching, the matchers of J are also needed: the pairs are
+  // ordered by blocks so that the matchers in use fit in the cache, even when the threads work on
+  // two consecutive blocks.
+  const std::size_t nbThreads = omp_get_max_threads();
+  const std::size_t maxMatchers = std::max(_maxCachedMatchers, 4 * nbThreads);
+  if(_useCrossMatching)
+    orderPairsByBlocks(pairsToMatch, maxMatchers / 4);
 
-      const feature::Regions &regionsJ = regionsPerView.getRegions(J, descType);
-      if (regionsJ.RegionCount() == 0
-          || regionsI.Type_id() != regionsJ.Type_id())
-      {
-        ++progressDisplay;
-        continue;
-      }
+  RegionsMatcherCache matcherCache(regionsPerView, descType, _matcherType, randomNumberGenerator(), maxMatchers);
 
-      IndMatches vec_putatives_matches;
-      matcher.Match(_f_dist_ratio, regionsJ, vec_putatives_matches);
+  std::vector<IndMatches> matchesPerPair(pairsToMatch.size());
 
-      if (_useCrossMatching)
-      {
-        // Initialize the matching interface
-        matching::RegionsDatabaseMatcher matcherCross(randomNumberGenerator, _matcherType, regionsJ);  
+  // Pairs are matched in parallel (dynamic scheduling balances the load between threads),
+  // matchers use their own inner parallelism only if there are too few pairs.
+  #pragma omp parallel for schedule(dynamic, 1) if(pairsToMatch.size() >= omp_get_max_threads())
+  for(int p = 0; p < (int)pairsToMatch.size(); ++p)
+  {
+    const IndexT I = pairsToMatch[p].first;
+    const IndexT J = pairsToMatch[p].second;
 
-        IndMatches vec_putatives_matches_cross;
-        matcherCross.Match(_f_dist_ratio, regionsI, vec_putatives_matches_cross);
+    const feature::Regions& regionsI = regionsPerView.getRegions(I, descType);
+    const feature::Regions& regionsJ = regionsPerView.getRegions(J, descType);
 
-        //Create a dictionnary of matches indexed by their pair of indexes
-        std::map<std::pair<int, int>, IndMatch> check_matches;
-        for (IndMatch & m : vec_putatives_matches_cross)
-        {
-          std::pair<int, int> key = std::make_pair(m._i, m._j);
-          check_matches[key] = m;
-        }
+    IndMatches vec_putatives_matches;
+    {
+      const std::shared_ptr<const RegionsDatabaseMatcher> matcher = matcherCache.acquire(I);
+      matcher->Match(_f_dist_ratio, regionsJ, vec_putatives_matches);
+    }
 
-        IndMatches vec_putatives_matches_checked;
-        for (IndMatch & m : vec_putatives_matches)
-        {
-          //Check with reversed key (images are swapped)
-          std::pair<int, int> key = std::make_pair(m._j, m._i);
-          if (check_matches.find(key) != check_matches.end())
-          {
-            vec_putatives_matches_checked.push_back(m);
-          }
-        }
+    if (_useCrossMatching)
+    {
+      IndMatches vec_putatives_matches_cross;
+      {
+        const std::shared_ptr<const RegionsDatabaseMatcher> matcherCross = matcherCache.acquire(J);
+        matcherCross->Match(_f_dist_ratio, regionsI, vec_putatives_matches_cross);
+      }
 
-        std::swap(vec_putatives_matches, vec_putatives_matches_checked);
+      //Create a dictionnary of matches indexed by their pair of indexes
+      std::map<std::pair<int, int>, IndMatch> check_matches;
+      for (IndMatch & m : vec_putatives_matches_cross)
+      {
+        std::pair<int, int> key = std::make_pair(m._i, m._j);
+        check_matches[key] = m;
       }
 
-      #pragma omp critical
+      IndMatches vec_putatives_matches_checked;
+      for (IndMatch & m : vec_putatives_matches)
       {
-        ++progressDisplay;
-        if (!vec_putatives_matches.empty())
+        //Check with reversed key (images are swapped)
+        std::pair<int, int> key = std::make_pair(m._j, m._i);
+        if (check_matches.find(key) != check_matches.end())
         {
-          map_PutativesMatches[std::make_pair(I,J)].emplace(descType, std::move(vec_putatives_matches));
+          vec_putatives_matches_checked.push_back(m);
         }
       }
+
+      std::swap(vec_putatives_matches, vec_putatives_matches_checked);
+    }
+
+    matchesPerPair[p].swap(vec_putatives_matches);
+    ++progressDisplay;
+  }
+
+  ALICEVISION_LOG_DEBUG("Regions matchers evicted from the cache: " << matcherCache.getNbEvictions());
+
+  // Gather the results in the pairs order: the output does not depend on the number of threads
+  for(std::size_t p = 0; p < pairsToMatch.size(); ++p)
+  {
+    if (!matchesPerPair[p].empty())
+    {
+      map_PutativesMatches[pairsToMatch[p]].emplace(descType, std::move(matchesPerPair[p]));
     }
   }
 }
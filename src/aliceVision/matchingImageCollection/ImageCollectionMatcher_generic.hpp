@@ -23,10 +23,18 @@ namespace matchingImageCollection {
 class ImageCollectionMatcher_generic : public IImageCollectionMatcher
 {
   public:
+  /**
+   * @param[in] dist_ratio distance ratio used to discard spurious correspondences
+   * @param[in] crossMatching use the symmetric matching test
+   * @param[in] matcherType the matcher type
+   * @param[in] maxCachedMatchers the maximum number of regions matchers (with their search index)
+   *            kept in memory, at least 4 per thread are kept
+   */
   ImageCollectionMatcher_generic(
     float dist_ratio,
     bool crossMatching,
-    matching::EMatcherType matcherType
+    matching::EMatcherType matcherType,
+    std::size_t maxCachedMatchers = 64
   );
 
   /// Find corresponding points between some pair of view Ids
@@ -45,6 +53,8 @@ class ImageCollectionMatcher_generic : public IImageCollectionMatcher
   bool _useCrossMatching;
   // Matcher Type
   matching::EMatcherType _matcherType;
+  // Maximum number of regions matchers kept in memory
+  std::size_t _maxCachedMatchers;
 };
 
 } // namespace aliceVision
@@ -38,6 +38,7 @@
 #include <assimp/postprocess.h>
 
 #include <map>
+#include <memory>
 #include <set>
 
 // Debug mode: save atlases decomposition in frequency bands and
@@ -135,14 +136,6 @@ std::istream& operator>>(std::istream& in, EBumpMappingType& bumpMappingType)
     return in;
 }
 
-/**
- * @brief Return whether a pixel is contained in or intersected by a 2D triangle.
- * @param[in] triangle the triangle as an array of 3 point2Ds
- * @param[in] pixel the pixel to test
- * @param[out] barycentricCoords the barycentric
- *  coordinates of this pixel relative to \p triangle
- * @return
- */
 bool isPixelInTriangle(const Point2d* triangle, const Pixel& pixel, Point2d& barycentricCoords)
 {
     // get pixel center
@@ -283,9 +276,88 @@ void Texturing::updateAtlases()
     }
 }
 
+namespace {
+
+/// Base size of the atlas accumulation tiles in pixels
+constexpr int accuTileSide = 256;
+
+/**
+ * @brief Process tiles of an atlas accumulation pyramid in parallel.
+ *
+ * The tile cache is not thread-safe, so the tiles are acquired by batches
+ * that fit in the cache memory before being processed in parallel.
+ */
+template <class TileFunction>
+void processAccuTiles(Texturing::AccuTiledPyramid& accuPyramid, const std::vector<int>& tileIndexes,
+                      std::size_t maxTilesInCore, TileFunction tileFunction)
+{
+    const std::size_t batchSize = std::max(std::size_t(1), maxTilesInCore);
+    std::vector<Texturing::AccuTiledPyramid::AccuPixel*> tilesData;
+
+    for(std::size_t batchBegin = 0; batchBegin < tileIndexes.size(); batchBegin += batchSize)
+    {
+        const std::size_t batchEnd = std::min(tileIndexes.size(), batchBegin + batchSize);
+        tilesData.resize(batchEnd - batchBegin);
+
+        for(std::size_t i = batchBegin; i < batchEnd; ++i)
+        {
+            tilesData[i - batchBegin] = accuPyramid.acquireTile(tileIndexes[i]);
+            if(tilesData[i - batchBegin] == nullptr)
+                throw std::runtime_error("Texturing: Cannot load the texture tile " + std::to_string(tileIndexes[i]) + " from the cache.");
+        }
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int i = 0; i < int(tilesData.size()); ++i)
+            tileFunction(tileIndexes[batchBegin + i], tilesData[i]);
+    }
+}
+
+} // namespace
+
+void Texturing::AccuTiledPyramid::init(const std::shared_ptr<image::TileCacheManager>& manager, int nbBands, int textureSide)
+{
+    cacheManager = manager;
+    nbLevels = nbBands;
+    side = textureSide;
+    tileSide = int(manager->getTileWidth());
+    nbTilesPerSide = divideRoundUp(side, tileSide);
+    tiles.assign(nbTilesPerSide * nbTilesPerSide, nullptr);
+}
+
+void Texturing::AccuTiledPyramid::clear()
+{
+    tiles.clear();
+    tiles.shrink_to_fit();
+}
+
+Texturing::AccuTiledPyramid::AccuPixel* Texturing::AccuTiledPyramid::acquireTile(int tileIndex)
+{
+    image::CachedTile::smart_pointer& tile = tiles[tileIndex];
+    const bool isNewTile = (tile == nullptr);
+
+    if(isNewTile)
+    {
+        const int width = std::min(tileSide, side - (tileIndex % nbTilesPerSide) * tileSide);
+        const int height = std::min(tileSide, side - (tileIndex / nbTilesPerSide) * tileSide);
+        tile = cacheManager->requireNewCachedTile(width, height, nbLevels * sizeof(AccuPixel));
+        if(tile == nullptr)
+            return nullptr;
+    }
+
+    if(!tile->acquire())
+        return nullptr;
+
+    AccuPixel* data = reinterpret_cast<AccuPixel*>(tile->getDataPointer());
+    if(isNewTile && data != nullptr)
+        std::fill_n(data, std::size_t(tileSide) * tileSide * nbLevels, AccuPixel{image::RGBfColor(0.f, 0.f, 0.f), 0.f});
+
+    return data;
+}
+
 void Texturing::generateTextures(const mvsUtils::MultiViewParams& mp,
                                  const boost::filesystem::path& outPath,
-                                 image::EImageFileType textureFileType)
+                                 image::EImageFileType textureFileType,
+                                 const boost::filesystem::path& cacheFolderPath)
 {
     // Ensure that contribution levels do not contain 0 and are sorted (as each frequency band contributes to lower bands).
     auto& m = texParams.multiBandNbContrib;
@@ -311,222 +383,81 @@ void Texturing::generateTextures(const mvsUtils::MultiViewParams& mp,
     imageCache.setCacheSize(2);
     ALICEVISION_LOG_INFO("Images loaded from cache with: " + ECorrectEV_enumToString(texParams.correctEV));
 
-    //calculate the maximum number of atlases in memory in MB
-    system::MemoryInfo memInfo = system::getMemoryInfo();
-    const std::size_t imageMaxMemSize =
-            mp.getMaxImageWidth() * mp.getMaxImageHeight() * sizeof(image::RGBfColor) / std::pow(2,20); //MB
-    const std::size_t imagePyramidMaxMemSize = texParams.nbBand * imageMaxMemSize;
-    const std::size_t atlasContribMemSize =
-            texParams.textureSide * texParams.textureSide * (sizeof(image::RGBfColor)+sizeof(float)) / std::pow(2,20); //MB
-    const std::size_t atlasPyramidMaxMemSize = texParams.nbBand * atlasContribMemSize;
-
-    const int availableRam = int(memInfo.availableRam / std::pow(2,20));
-    const int availableMem = availableRam - 2 * (imagePyramidMaxMemSize + imageMaxMemSize); // keep some memory for the 2 input images in cache and one laplacian pyramid
-
     const int nbAtlas = _atlases.size();
-    // Memory needed to process each attlas = input + input pyramid + output atlas pyramid
-    const int memoryPerAtlas = (imageMaxMemSize + imagePyramidMaxMemSize) + atlasPyramidMaxMemSize;
-    int nbAtlasMax = std::floor(availableMem / double(memoryPerAtlas)); //maximum number of textures laplacian pyramid in RAM
-    nbAtlasMax = std::min(nbAtlas, nbAtlasMax); //if enough memory, do it with all atlases
-
-    ALICEVISION_LOG_INFO("nbAtlas: " << nbAtlas);
-    ALICEVISION_LOG_INFO("availableRam: " << availableRam);
-    ALICEVISION_LOG_INFO("availableMem: " << availableMem);
-    ALICEVISION_LOG_INFO("memoryPerAtlas: " << memoryPerAtlas);
-
-    ALICEVISION_LOG_DEBUG("nbAtlasMax: " << nbAtlasMax);
 
-    // Add rounding to have a uniform repartition between chunks (avoid a small chunk at the end)
-    const int nChunks = divideRoundUp(nbAtlas, nbAtlasMax);
-    nbAtlasMax = divideRoundUp(nbAtlas, nChunks);
-    ALICEVISION_LOG_DEBUG("nChunks: " << nChunks);
-    ALICEVISION_LOG_INFO("nbAtlasMax (after rounding): " << nbAtlasMax);
-
-    if (availableMem - nbAtlasMax*atlasPyramidMaxMemSize < 1000) //keep 1 GB margin in memory
-        nbAtlasMax -= 1;
-    nbAtlasMax = std::max(1, nbAtlasMax); //if not enough memory, do it one by one
+    // We select the best cameras for each triangle and store it per camera for each output texture files.
+    // Triangles contributions are stored per frequency bands for multi-band blending.
+    std::vector<CameraContributions> contributionsPerCamera(mp.ncams);
+    for(int atlasID = 0; atlasID < nbAtlas; ++atlasID)
+        selectTrianglesContributions(mp, atlasID, contributionsPerCamera);
 
-    ALICEVISION_LOG_INFO("Total amount of available RAM: " << availableRam << " MB.");
-    ALICEVISION_LOG_INFO("Total amount of memory remaining for the computation: " << availableMem << " MB.");
-    ALICEVISION_LOG_INFO("Total amount of an image in memory: " << imageMaxMemSize << " MB.");
-    ALICEVISION_LOG_INFO("Total amount of an atlas pyramid in memory: " << atlasPyramidMaxMemSize << " MB.");
-    ALICEVISION_LOG_INFO("Processing " << nbAtlas << " atlases by chunks of " << nbAtlasMax);
-
-    //generateTexture for the maximum number of atlases, and iterate
-    const std::div_t divresult = div(nbAtlas, nbAtlasMax);
-    std::vector<size_t> atlasIDs;
-    atlasIDs.reserve(nbAtlasMax);
-    for(int n = 0; n <= divresult.quot; ++n)
+    // the contributions of all atlases are kept until each camera is processed
+    std::size_t contributionsMemSize = contributionsPerCamera.capacity() * sizeof(CameraContributions);
+    for(const CameraContributions& cameraContributions : contributionsPerCamera)
     {
-        atlasIDs.clear();
-        int imax = (n < divresult.quot ? nbAtlasMax : divresult.rem);
-        if(!imax)
-            continue;
-        for(int i = 0; i < imax; ++i)
+        for(const auto& c : cameraContributions)
         {
-            size_t atlasID = size_t(n*nbAtlasMax + i);
-            atlasIDs.push_back(atlasID);
+            contributionsMemSize += sizeof(c) + c.second.capacity() * sizeof(ScorePerTriangle);
+            for(const ScorePerTriangle& band : c.second)
+                contributionsMemSize += band.capacity() * sizeof(ScorePerTriangle::value_type);
         }
-        ALICEVISION_LOG_INFO("Generating texture for atlases " << n*nbAtlasMax + 1 << " to " << n*nbAtlasMax+imax );
-        generateTexturesSubSet(mp, atlasIDs, imageCache, outPath, textureFileType);
     }
-}
-
-void Texturing::generateTexturesSubSet(const mvsUtils::MultiViewParams& mp,
-                                       const std::vector<size_t>& atlasIDs,
-                                       mvsUtils::ImagesCache<image::Image<image::RGBfColor>>& imageCache,
-                                       const bfs::path& outPath,
-                                       image::EImageFileType textureFileType)
-{
-    if(atlasIDs.size() > _atlases.size())
-        throw std::runtime_error("Invalid atlas IDs ");
+    const std::size_t contributionsMem = contributionsMemSize / std::pow(2,20); //MB
+    ALICEVISION_LOG_INFO("Total amount of the triangles contributions in memory: " << contributionsMem << " MB.");
 
-    unsigned int textureSize = texParams.textureSide * texParams.textureSide;
-
-    // We select the best cameras for each triangle and store it per camera for each output texture files.
-    // Triangles contributions are stored per frequency bands for multi-band blending.
-    using AtlasIndex = size_t;
-    using ScorePerTriangle = std::vector<std::pair<unsigned int, float>>; //list of <triangleId, score>
-    std::vector<std::map<AtlasIndex, std::vector<ScorePerTriangle>>> contributionsPerCamera(mp.ncams);
-
-    //for each atlasID, calculate contributionPerCamera
-    for(const size_t atlasID : atlasIDs)
+    // The atlases are accumulated by tiles: the cache keeps the most recently used tiles in memory and the others on disk,
+    // so each camera is read only once for all atlases.
+    // The tiles are swapped in a dedicated folder (in the system temporary folder by default), removed at the end (after the cache manager).
+    struct CacheFolder
     {
-        ALICEVISION_LOG_INFO("Generating texture for atlas " << atlasID + 1 << "/" << _atlases.size()
-                  << " (" << _atlases[atlasID].size() << " triangles).");
-
-        // iterate over atlas' triangles
-        for(size_t i = 0; i < _atlases[atlasID].size(); ++i)
+        const bfs::path path;
+        explicit CacheFolder(const bfs::path& parent)
+            : path((parent.empty() ? bfs::temp_directory_path() : parent) / bfs::unique_path("texturing_%%%%-%%%%-%%%%-%%%%"))
         {
-            int triangleID = _atlases[atlasID][i];
-
-            // Fuse visibilities of the 3 vertices
-            std::vector<int> allTriCams;
-            for (int k = 0; k < 3; ++k)
-            {
-                const int pointIndex = mesh->tris[triangleID].v[k];
-                const StaticVector<int> pointVisibilities = mesh->pointsVisibilities[pointIndex];
-                if (!pointVisibilities.empty())
-                {
-                    std::copy(pointVisibilities.begin(), pointVisibilities.end(), std::inserter(allTriCams, allTriCams.end()));
-                }
-            }
-            if (allTriCams.empty())
-            {
-                // triangle without visibility
-                ALICEVISION_LOG_TRACE("No visibility for triangle " << triangleID << " in texture atlas " << atlasID << ".");
-                continue;
-            }
-            std::sort(allTriCams.begin(), allTriCams.end());
-
-            std::vector<std::pair<int, int>> selectedTriCams; // <camId, nbVertices>
-            selectedTriCams.emplace_back(allTriCams.front(), 1);
-            for (int j = 1; j < allTriCams.size(); ++j)
-            {
-                const unsigned int camId = allTriCams[j];
-                if(selectedTriCams.back().first == camId)
-                {
-                    ++selectedTriCams.back().second;
-                }
-                else
-                {
-                    selectedTriCams.emplace_back(camId, 1);
-                }
-            }
-
-            assert(!selectedTriCams.empty());
-
-            // Select the N best views for texturing
-            Point3d triangleNormal;
-            Point3d triangleCenter;
-            if (texParams.angleHardThreshold != 0.0)
-            {
-                triangleNormal = mesh->computeTriangleNormal(triangleID);
-                triangleCenter = mesh->computeTriangleCenterOfGravity(triangleID);
-            }
-            using ScoreCamId = std::tuple<int, double, int>; // <nbVertex, score, camId>
-            std::vector<ScoreCamId> scorePerCamId;
-            for (const auto& itCamVis: selectedTriCams)
-            {
-                const int camId = itCamVis.first;
-                const int verticesSupport = itCamVis.second;
-                if(texParams.forceVisibleByAllVertices && verticesSupport < 3)
-                    continue;
-
-                if (texParams.angleHardThreshold != 0.0)
-                {
-                    const Point3d vecPointToCam = (mp.CArr[camId] - triangleCenter).normalize();
-                    const double angle = angleBetwV1andV2(triangleNormal, vecPointToCam);
-                    if(angle > texParams.angleHardThreshold)
-                        continue;
-                }
-
-                const int w = mp.getWidth(camId);
-                const int h = mp.getHeight(camId);
+            bfs::create_directories(path);
+        }
+        ~CacheFolder() { boost::system::error_code ec; bfs::remove_all(path, ec); }
+    } cacheFolder(cacheFolderPath);
+    ALICEVISION_LOG_INFO("Texturing cache folder: " << cacheFolder.path);
 
-                const Mesh::triangle_proj tProj = mesh->getTriangleProjection(triangleID, mp, camId, w, h);
-                const int nbVertex = mesh->getTriangleNbVertexInImage(mp, tProj, camId, 20);
-                if(nbVertex == 0)
-                    // No triangle vertex in the image
-                    continue;
+    std::shared_ptr<image::TileCacheManager> cacheManager =
+            image::TileCacheManager::create(cacheFolder.path.string(), accuTileSide, accuTileSide, 65536);
 
-                const double area = mesh->computeTriangleProjectionArea(tProj);
-                const double score = area * double(verticesSupport);
-                scorePerCamId.emplace_back(nbVertex, score, camId);
-            }
-            if (scorePerCamId.empty())
-            {
-                // triangle without visibility
-                ALICEVISION_LOG_TRACE("No visibility for triangle " << triangleID << " in texture atlas " << atlasID << " after scoring!!");
-                continue;
-            }
+    std::vector<AccuTiledPyramid> accuPyramids(nbAtlas);
+    for(AccuTiledPyramid& accuPyramid : accuPyramids)
+        accuPyramid.init(cacheManager, texParams.nbBand, texParams.textureSide);
 
-            std::sort(scorePerCamId.begin(), scorePerCamId.end(), std::greater<ScoreCamId>());
-            const double minScore = texParams.bestScoreThreshold * std::get<1>(scorePerCamId.front()); // bestScoreThreshold * bestScore
-            const bool bestIsPartial = (std::get<0>(scorePerCamId.front()) < 3);
+    //calculate the maximum number of tiles in memory
+    system::MemoryInfo memInfo = system::getMemoryInfo();
+    const std::size_t imageMaxMemSize =
+            mp.getMaxImageWidth() * mp.getMaxImageHeight() * sizeof(image::RGBfColor) / std::pow(2,20); //MB
+    const std::size_t imagePyramidMaxMemSize = texParams.nbBand * imageMaxMemSize;
+    const std::size_t atlasTextureMemSize =
+            texParams.textureSide * texParams.textureSide * (sizeof(image::RGBfColor)+sizeof(float)) / std::pow(2,20); //MB
+    const std::size_t tileMemSize = std::size_t(accuTileSide) * accuTileSide * texParams.nbBand * sizeof(AccuTiledPyramid::AccuPixel);
+    const std::size_t nbTilesPerAtlas = std::size_t(std::pow(divideRoundUp(int(texParams.textureSide), accuTileSide), 2));
+    const std::size_t nbTiles = nbAtlas * nbTilesPerAtlas;
 
-            int nbContribMax = std::min(texParams.multiBandNbContrib.back(), static_cast<int>(scorePerCamId.size()));
-            int nbCumulatedVertices = 0;
-            int band = 0;
-            for(int contrib = 0; nbCumulatedVertices < 3 * nbContribMax && contrib < nbContribMax; ++contrib)
-            {
-                nbCumulatedVertices += std::get<0>(scorePerCamId[contrib]);
-                if (!bestIsPartial && contrib != 0)
-                {
-                    if(std::get<1>(scorePerCamId[contrib]) < minScore)
-                    {
-                        // The best image fully see the triangle and has a much better score, so only rely on the first ones
-                        break;
-                    }
-                }
+    const int availableRam = int(memInfo.availableRam / std::pow(2,20));
+    // keep some memory for the triangles contributions, the 2 input images in cache, one laplacian pyramid, one output texture and a 1 GB margin
+    const int availableMem = availableRam - int(contributionsMem + 2 * imageMaxMemSize + imagePyramidMaxMemSize + atlasTextureMemSize) - 1000;
 
-                //for the camera camId : add triangle score to the corresponding texture, at the right frequency band
-                const int camId = std::get<2>(scorePerCamId[contrib]);
-                const int triangleScore = std::get<1>(scorePerCamId[contrib]);
-                auto& camContribution = contributionsPerCamera[camId];
-                if(camContribution.find(atlasID) == camContribution.end())
-                    camContribution[atlasID].resize(texParams.nbBand);
-                camContribution.at(atlasID)[band].emplace_back(triangleID, triangleScore);
+    std::size_t maxTilesInCore = (availableMem > 0) ? std::size_t(availableMem) * std::pow(2,20) / tileMemSize : 0;
+    maxTilesInCore = std::max(std::size_t(16), std::min(maxTilesInCore, nbTiles)); //if enough memory, keep all tiles in memory
+    cacheManager->setMaxMemory(maxTilesInCore * tileMemSize);
 
-                if(contrib + 1 == texParams.multiBandNbContrib[band])
-                {
-                    ++band;
-                }
-            }
-        }
-    }
+    ALICEVISION_LOG_INFO("Total amount of available RAM: " << availableRam << " MB.");
+    ALICEVISION_LOG_INFO("Total amount of memory remaining for the computation: " << availableMem << " MB.");
+    ALICEVISION_LOG_INFO("Total amount of an image in memory: " << imageMaxMemSize << " MB.");
+    ALICEVISION_LOG_INFO("Total amount of an atlas pyramid in memory: " << nbTilesPerAtlas * tileMemSize / std::pow(2,20) << " MB.");
+    ALICEVISION_LOG_INFO("Processing " << nbAtlas << " atlases with " << maxTilesInCore << "/" << nbTiles << " tiles in memory.");
 
     ALICEVISION_LOG_INFO("Reading pixel color.");
 
-    //pyramid of atlases frequency bands
-    std::map<AtlasIndex, AccuPyramid> accuPyramids;
-    for(std::size_t atlasID: atlasIDs)
-        accuPyramids[atlasID].init(texParams.nbBand, texParams.textureSide, texParams.textureSide);
-
-    //for each camera, for each texture, iterate over triangles and fill the accuPyramids map
+    //for each camera, for each texture, iterate over triangles and fill the accuPyramids
     for(int camId = 0; camId < contributionsPerCamera.size(); ++camId)
     {
-        const std::map<AtlasIndex, std::vector<ScorePerTriangle>>& cameraContributions = contributionsPerCamera[camId];
+        const CameraContributions& cameraContributions = contributionsPerCamera[camId];
 
         if(cameraContributions.empty())
         {
@@ -546,144 +477,35 @@ void Texturing::generateTexturesSubSet(const mvsUtils::MultiViewParams& mp,
         // for each output texture file
         for(const auto& c : cameraContributions)
         {
-            AtlasIndex atlasID = c.first;
+            const std::size_t atlasID = c.first;
             ALICEVISION_LOG_INFO("  - Texture file: " << atlasID + 1);
-            //for each frequency band
             for(int band = 0; band < c.second.size(); ++band)
-            {
-                const ScorePerTriangle& trianglesId = c.second[band];
-                ALICEVISION_LOG_INFO("      - band " << band + 1 << ": " << trianglesId.size() << " triangles.");
-
-                // for each triangle
-                #pragma omp parallel for
-                for(int ti = 0; ti < trianglesId.size(); ++ti)
-                {
-                    const unsigned int triangleId = std::get<0>(trianglesId[ti]);
-                    const float triangleScore = texParams.useScore ? std::get<1>(trianglesId[ti]) : 1.0f;
-                    // retrieve triangle 3D and UV coordinates
-                    Point2d triPixs[3];
-                    Point3d triPts[3];
-                    auto& triangleUvIds = mesh->trisUvIds[triangleId];
-                    // compute the Bottom-Left minima of the current UDIM for [0,1] range remapping
-                    Point2d udimBL;
-                    StaticVector<Point2d>& uvCoords = mesh->uvCoords;
-                    udimBL.x = std::floor(std::min({uvCoords[triangleUvIds[0]].x,
-                                                    uvCoords[triangleUvIds[1]].x,
-                                                    uvCoords[triangleUvIds[2]].x}));
-                    udimBL.y = std::floor(std::min({uvCoords[triangleUvIds[0]].y,
-                                                    uvCoords[triangleUvIds[1]].y,
-                                                    uvCoords[triangleUvIds[2]].y}));
-
-                    for(int k = 0; k < 3; ++k)
-                    {
-                       const int pointIndex = mesh->tris[triangleId].v[k];
-                       triPts[k] = mesh->pts[pointIndex];                               // 3D coordinates
-                       const int uvPointIndex = triangleUvIds.m[k];
-                       Point2d uv = uvCoords[uvPointIndex];
-                       // UDIM: remap coordinates between [0,1]
-                       uv = uv - udimBL;
-
-                       triPixs[k] = uv * texParams.textureSide;   // UV coordinates
-                    }
+                ALICEVISION_LOG_INFO("      - band " << band + 1 << ": " << c.second[band].size() << " triangles.");
 
-                    // compute triangle bounding box in pixel indexes
-                    // min values: floor(value)
-                    // max values: ceil(value)
-                    Pixel LU, RD;
-                    LU.x = static_cast<int>(std::floor(std::min({triPixs[0].x, triPixs[1].x, triPixs[2].x})));
-                    LU.y = static_cast<int>(std::floor(std::min({triPixs[0].y, triPixs[1].y, triPixs[2].y})));
-                    RD.x = static_cast<int>(std::ceil(std::max({triPixs[0].x, triPixs[1].x, triPixs[2].x})));
-                    RD.y = static_cast<int>(std::ceil(std::max({triPixs[0].y, triPixs[1].y, triPixs[2].y})));
-
-                    // sanity check: clamp values to [0; textureSide]
-                    int texSide = static_cast<int>(texParams.textureSide);
-                    LU.x = clamp(LU.x, 0, texSide);
-                    LU.y = clamp(LU.y, 0, texSide);
-                    RD.x = clamp(RD.x, 0, texSide);
-                    RD.y = clamp(RD.y, 0, texSide);
-
-                    // iterate over pixels of the triangle's bounding box
-                    for(int y = LU.y; y < RD.y; ++y)
-                    {
-                       for(int x = LU.x; x < RD.x; ++x)
-                       {
-                           Pixel pix(x, y); // top-left corner of the pixel
-                           Point2d barycCoords;
-
-                           // test if the pixel is inside triangle
-                           // and retrieve its barycentric coordinates
-                           if(!isPixelInTriangle(triPixs, pix, barycCoords))
-                           {
-                               continue;
-                           }
-
-                           // remap 'y' to image coordinates system (inverted Y axis)
-                           const unsigned int y_ = (texParams.textureSide - 1) - y;
-                           // 1D pixel index
-                           unsigned int xyoffset = y_ * texParams.textureSide + x;
-                           // get 3D coordinates
-                           Point3d pt3d = barycentricToCartesian(triPts, barycCoords);
-                           // get 2D coordinates in source image
-                           Point2d pixRC;
-                           mp.getPixelFor3DPoint(&pixRC, pt3d, camId);
-                           // exclude out of bounds pixels
-                           if(!mp.isPixelInImage(pixRC, camId))
-                               continue;
-
-                           // If the color is pure zero (ie. no contributions), we consider it as an invalid pixel.
-                           if (getInterpolateColor(camImg, pixRC.y, pixRC.x) == image::RGBfColor(0.f, 0.f, 0.f))
-                               continue;
-
-                           // Fill the accumulated pyramid for this pixel
-                           // each frequency band also contributes to lower frequencies (higher band indexes)
-                           AccuPyramid& accuPyramid = accuPyramids.at(atlasID);
-                           for(std::size_t bandContrib = band; bandContrib < pyramidL.size(); ++bandContrib)
-                           {
-                               int downscaleCoef = std::pow(texParams.multiBandDownscale, bandContrib);
-                               AccuImage& accuImage = accuPyramid.pyramid[bandContrib];
-
-                               // fill the accumulated color map for this pixel
-                               const auto pixDownscaled = pixRC / downscaleCoef;
-                               accuImage.img(xyoffset) += getInterpolateColor(pyramidL[bandContrib], pixDownscaled.y, pixDownscaled.x) * triangleScore;
-                               accuImage.imgCount[xyoffset] += triangleScore;
-                           }
-                       }
-                    }
-                }
-            }
+            accumulateCameraContributions(mp, camId, camImg, pyramidL, c.second, maxTilesInCore, accuPyramids[atlasID]);
         }
+
+        // the camera contributions are no longer needed
+        CameraContributions().swap(contributionsPerCamera[camId]);
     }
 
-    //calculate atlas texture in the first level of the pyramid (avoid creating a new buffer)
+    //calculate atlas texture from the frequency bands
     //debug mode : write all the frequencies levels for each texture
-    for(std::size_t atlasID : atlasIDs)
+    for(int atlasID = 0; atlasID < nbAtlas; ++atlasID)
     {
-        AccuPyramid& accuPyramid = accuPyramids.at(atlasID);
-        AccuImage& atlasTexture = accuPyramid.pyramid[0];
+        AccuTiledPyramid& accuPyramid = accuPyramids[atlasID];
         ALICEVISION_LOG_INFO("Create texture " << atlasID + 1);
 
 #if TEXTURING_MBB_DEBUG
         {
-            // write the number of contribution per atlas frequency bands
-            if(!texParams.useScore)
+            for(int level = 0; level < accuPyramid.nbLevels; ++level)
             {
-                for(std::size_t level = 0; level < accuPyramid.pyramid.size(); ++level)
-                {
-                    AccuImage& atlasLevelTexture =  accuPyramid.pyramid[level];
-
-                    //write the number of contributions for each texture
-                    std::vector<float> imgContrib(textureSize);
-
-                    for(unsigned int yp = 0; yp < texParams.textureSide; ++yp)
-                    {
-                        unsigned int yoffset = yp * texParams.textureSide;
-                        for(unsigned int xp = 0; xp < texParams.textureSide; ++xp)
-                        {
-                            unsigned int xyoffset = yoffset + xp;
-                            imgContrib[xyoffset] = atlasLevelTexture.imgCount[xyoffset];
-                        }
-                    }
+                AccuImage atlasLevelTexture;
+                getAtlasTexture(accuPyramid, maxTilesInCore, atlasLevelTexture, level);
 
+                // write the number of contribution per atlas frequency bands
+                if(!texParams.useScore)
+                {
                     const std::string textureName = "contrib_" + std::to_string(1001 + atlasID) + std::string("_") + std::to_string(level) + std::string(".") + EImageFileType_enumToString(textureFileType); // starts at '1001' for UDIM compatibility
                     bfs::path texturePath = outPath / textureName;
 
@@ -691,63 +513,365 @@ void Texturing::generateTexturesSubSet(const mvsUtils::MultiViewParams& mp,
                     OutputFileColorSpace colorspace(EImageColorSpace::SRGB, EImageColorSpace::AUTO);
                     if(texParams.convertLAB)
                         colorspace.from = EImageColorSpace::LAB;
-                    writeImage(texturePath.string(), texParams.textureSide, texParams.textureSide, imgContrib, EImageQuality::OPTIMIZED, colorspace);
+                    writeImage(texturePath.string(), texParams.textureSide, texParams.textureSide, atlasLevelTexture.imgCount, EImageQuality::OPTIMIZED, colorspace);
                 }
+
+                //write each frequency band
+                writeTexture(atlasLevelTexture, atlasID, outPath, textureFileType, level);
             }
         }
 #endif
 
         ALICEVISION_LOG_INFO("  - Computing final (average) color.");
-        for(unsigned int yp = 0; yp < texParams.textureSide; ++yp)
+        AccuImage atlasTexture;
+        getAtlasTexture(accuPyramid, maxTilesInCore, atlasTexture);
+        accuPyramid.clear();
+
+        writeTexture(atlasTexture, atlasID, outPath, textureFileType, -1);
+    }
+}
+
+void Texturing::selectTrianglesContributions(const mvsUtils::MultiViewParams& mp, std::size_t atlasID,
+                                             std::vector<CameraContributions>& contributionsPerCamera) const
+{
+    ALICEVISION_LOG_INFO("Generating texture for atlas " << atlasID + 1 << "/" << _atlases.size()
+              << " (" << _atlases[atlasID].size() << " triangles).");
+
+    // iterate over atlas' triangles
+    for(size_t i = 0; i < _atlases[atlasID].size(); ++i)
+    {
+        int triangleID = _atlases[atlasID][i];
+
+        // Fuse visibilities of the 3 vertices
+        std::vector<int> allTriCams;
+        for (int k = 0; k < 3; ++k)
         {
-            unsigned int yoffset = yp * texParams.textureSide;
-            for(unsigned int xp = 0; xp < texParams.textureSide; ++xp)
+            const int pointIndex = mesh->tris[triangleID].v[k];
+            const StaticVector<int>& pointVisibilities = mesh->pointsVisibilities[pointIndex];
+            if (!pointVisibilities.empty())
             {
-                unsigned int xyoffset = yoffset + xp;
+                allTriCams.insert(allTriCams.end(), pointVisibilities.begin(), pointVisibilities.end());
+            }
+        }
+        if (allTriCams.empty())
+        {
+            // triangle without visibility
+            ALICEVISION_LOG_TRACE("No visibility for triangle " << triangleID << " in texture atlas " << atlasID << ".");
+            continue;
+        }
+        std::sort(allTriCams.begin(), allTriCams.end());
+
+        std::vector<std::pair<int, int>> selectedTriCams; // <camId, nbVertices>
+        selectedTriCams.emplace_back(allTriCams.front(), 1);
+        for (int j = 1; j < allTriCams.size(); ++j)
+        {
+            const unsigned int camId = allTriCams[j];
+            if(selectedTriCams.back().first == camId)
+            {
+                ++selectedTriCams.back().second;
+            }
+            else
+            {
+                selectedTriCams.emplace_back(camId, 1);
+            }
+        }
+
+        assert(!selectedTriCams.empty());
 
-                // If the imgCount is valid on the first band, it will be valid on all the other bands
-                if(atlasTexture.imgCount[xyoffset] == 0)
+        // Select the N best views for texturing
+        Point3d triangleNormal;
+        Point3d triangleCenter;
+        if (texParams.angleHardThreshold != 0.0)
+        {
+            triangleNormal = mesh->computeTriangleNormal(triangleID);
+            triangleCenter = mesh->computeTriangleCenterOfGravity(triangleID);
+        }
+        using ScoreCamId = std::tuple<int, double, int>; // <nbVertex, score, camId>
+        std::vector<ScoreCamId> scorePerCamId;
+        for (const auto& itCamVis: selectedTriCams)
+        {
+            const int camId = itCamVis.first;
+            const int verticesSupport = itCamVis.second;
+            if(texParams.forceVisibleByAllVertices && verticesSupport < 3)
+                continue;
+
+            if (texParams.angleHardThreshold != 0.0)
+            {
+                const Point3d vecPointToCam = (mp.CArr[camId] - triangleCenter).normalize();
+                const double angle = angleBetwV1andV2(triangleNormal, vecPointToCam);
+                if(angle > texParams.angleHardThreshold)
                     continue;
+            }
 
-                atlasTexture.img(xyoffset) /= atlasTexture.imgCount[xyoffset];
-                atlasTexture.imgCount[xyoffset] = 1;
+            const int w = mp.getWidth(camId);
+            const int h = mp.getHeight(camId);
+
+            const Mesh::triangle_proj tProj = mesh->getTriangleProjection(triangleID, mp, camId, w, h);
+            const int nbVertex = mesh->getTriangleNbVertexInImage(mp, tProj, camId, 20);
+            if(nbVertex == 0)
+                // No triangle vertex in the image
+                continue;
+
+            const double area = mesh->computeTriangleProjectionArea(tProj);
+            const double score = area * double(verticesSupport);
+            scorePerCamId.emplace_back(nbVertex, score, camId);
+        }
+        if (scorePerCamId.empty())
+        {
+            // triangle without visibility
+            ALICEVISION_LOG_TRACE("No visibility for triangle " << triangleID << " in texture atlas " << atlasID << " after scoring!!");
+            continue;
+        }
+
+        std::sort(scorePerCamId.begin(), scorePerCamId.end(), std::greater<ScoreCamId>());
+        const double minScore = texParams.bestScoreThreshold * std::get<1>(scorePerCamId.front()); // bestScoreThreshold * bestScore
+        const bool bestIsPartial = (std::get<0>(scorePerCamId.front()) < 3);
 
-                for(std::size_t level = 1; level < accuPyramid.pyramid.size(); ++level)
+        int nbContribMax = std::min(texParams.multiBandNbContrib.back(), static_cast<int>(scorePerCamId.size()));
+        int nbCumulatedVertices = 0;
+        int band = 0;
+        for(int contrib = 0; nbCumulatedVertices < 3 * nbContribMax && contrib < nbContribMax; ++contrib)
+        {
+            nbCumulatedVertices += std::get<0>(scorePerCamId[contrib]);
+            if (!bestIsPartial && contrib != 0)
+            {
+                if(std::get<1>(scorePerCamId[contrib]) < minScore)
                 {
-                    AccuImage& atlasLevelTexture =  accuPyramid.pyramid[level];
-                    atlasLevelTexture.img(xyoffset) /= atlasLevelTexture.imgCount[xyoffset];
+                    // The best image fully see the triangle and has a much better score, so only rely on the first ones
+                    break;
                 }
             }
-        }
 
-#if TEXTURING_MBB_DEBUG
-        {
-            //write each frequency band, for each texture
-            for(std::size_t level = 0; level < accuPyramid.pyramid.size(); ++level)
+            //for the camera camId : add triangle score to the corresponding texture, at the right frequency band
+            const int camId = std::get<2>(scorePerCamId[contrib]);
+            const int triangleScore = std::get<1>(scorePerCamId[contrib]);
+            auto& camContribution = contributionsPerCamera[camId];
+            if(camContribution.find(atlasID) == camContribution.end())
+                camContribution[atlasID].resize(texParams.nbBand);
+            camContribution.at(atlasID)[band].emplace_back(triangleID, triangleScore);
+
+            if(contrib + 1 == texParams.multiBandNbContrib[band])
             {
-                AccuImage& atlasLevelTexture =  accuPyramid.pyramid[level];
-                writeTexture(atlasLevelTexture, atlasID, outPath, textureFileType, level);
+                ++band;
             }
+        }
+    }
+}
+
+void Texturing::accumulateCameraContributions(const mvsUtils::MultiViewParams& mp, int camId,
+                                              const image::Image<image::RGBfColor>& camImg,
+                                              const std::vector<image::Image<image::RGBfColor>>& pyramidL,
+                                              const std::vector<ScorePerTriangle>& contributions,
+                                              std::size_t maxTilesInCore, AccuTiledPyramid& accuPyramid) const
+{
+    // triangle in the texture pixels
+    struct TriangleRaster
+    {
+        Point2d triPixs[3];
+        Point3d triPts[3];
+        Pixel LU;
+        Pixel RD;
+        float score;
+        int band;
+    };
+
+    std::vector<std::pair<int, int>> bandTriangles; // <band, index in band>
+    for(int band = 0; band < contributions.size(); ++band)
+        for(int ti = 0; ti < contributions[band].size(); ++ti)
+            bandTriangles.emplace_back(band, ti);
+
+    std::vector<TriangleRaster> triangles(bandTriangles.size());
 
+    #pragma omp parallel for
+    for(int i = 0; i < triangles.size(); ++i)
+    {
+        TriangleRaster& triangle = triangles[i];
+        const std::pair<unsigned int, float>& contribution = contributions[bandTriangles[i].first][bandTriangles[i].second];
+        const unsigned int triangleId = contribution.first;
+        triangle.band = bandTriangles[i].first;
+        triangle.score = texParams.useScore ? contribution.second : 1.0f;
+
+        // retrieve triangle 3D and UV coordinates
+        auto& triangleUvIds = mesh->trisUvIds[triangleId];
+        // compute the Bottom-Left minima of the current UDIM for [0,1] range remapping
+        Point2d udimBL;
+        const StaticVector<Point2d>& uvCoords = mesh->uvCoords;
+        udimBL.x = std::floor(std::min({uvCoords[triangleUvIds[0]].x,
+                                        uvCoords[triangleUvIds[1]].x,
+                                        uvCoords[triangleUvIds[2]].x}));
+        udimBL.y = std::floor(std::min({uvCoords[triangleUvIds[0]].y,
+                                        uvCoords[triangleUvIds[1]].y,
+                                        uvCoords[triangleUvIds[2]].y}));
+
+        for(int k = 0; k < 3; ++k)
+        {
+            const int pointIndex = mesh->tris[triangleId].v[k];
+            triangle.triPts[k] = mesh->pts[pointIndex];                      // 3D coordinates
+            const int uvPointIndex = triangleUvIds.m[k];
+            // UDIM: remap coordinates between [0,1]
+            const Point2d uv = uvCoords[uvPointIndex] - udimBL;
+            triangle.triPixs[k] = uv * texParams.textureSide;                // UV coordinates
         }
-#endif
 
-        // Fuse frequency bands into the first buffer, calculate final texture
-        for(unsigned int yp = 0; yp < texParams.textureSide; ++yp)
+        const Point2d* triPixs = triangle.triPixs;
+        // compute triangle bounding box in pixel indexes
+        // min values: floor(value)
+        // max values: ceil(value)
+        triangle.LU.x = static_cast<int>(std::floor(std::min({triPixs[0].x, triPixs[1].x, triPixs[2].x})));
+        triangle.LU.y = static_cast<int>(std::floor(std::min({triPixs[0].y, triPixs[1].y, triPixs[2].y})));
+        triangle.RD.x = static_cast<int>(std::ceil(std::max({triPixs[0].x, triPixs[1].x, triPixs[2].x})));
+        triangle.RD.y = static_cast<int>(std::ceil(std::max({triPixs[0].y, triPixs[1].y, triPixs[2].y})));
+
+        // sanity check: clamp values to [0; textureSide]
+        const int texSide = static_cast<int>(texParams.textureSide);
+        triangle.LU.x = clamp(triangle.LU.x, 0, texSide);
+        triangle.LU.y = clamp(triangle.LU.y, 0, texSide);
+        triangle.RD.x = clamp(triangle.RD.x, 0, texSide);
+        triangle.RD.y = clamp(triangle.RD.y, 0, texSide);
+    }
+
+    // bin the triangles per atlas tile, each pixel is filled by the tile containing it
+    const int tileSide = accuPyramid.tileSide;
+    const int nbTilesPerSide = accuPyramid.nbTilesPerSide;
+    std::vector<std::vector<int>> trianglesPerTile(accuPyramid.tiles.size());
+    for(int i = 0; i < triangles.size(); ++i)
+    {
+        const TriangleRaster& triangle = triangles[i];
+        if(triangle.RD.x <= triangle.LU.x || triangle.RD.y <= triangle.LU.y)
+            continue;
+        for(int ty = triangle.LU.y / tileSide; ty <= (triangle.RD.y - 1) / tileSide; ++ty)
+            for(int tx = triangle.LU.x / tileSide; tx <= (triangle.RD.x - 1) / tileSide; ++tx)
+                trianglesPerTile[ty * nbTilesPerSide + tx].push_back(i);
+    }
+
+    std::vector<int> tileIndexes;
+    for(int tileIndex = 0; tileIndex < trianglesPerTile.size(); ++tileIndex)
+    {
+        if(!trianglesPerTile[tileIndex].empty())
+            tileIndexes.push_back(tileIndex);
+    }
+
+    const std::size_t nbLevels = std::min(pyramidL.size(), std::size_t(accuPyramid.nbLevels));
+    const std::size_t levelSize = std::size_t(tileSide) * tileSide;
+
+    processAccuTiles(accuPyramid, tileIndexes, maxTilesInCore,
+                     [&](int tileIndex, AccuTiledPyramid::AccuPixel* tileData)
+    {
+        const int tileX = (tileIndex % nbTilesPerSide) * tileSide;
+        const int tileY = (tileIndex / nbTilesPerSide) * tileSide;
+
+        for(const int i : trianglesPerTile[tileIndex])
         {
-            unsigned int yoffset = yp * texParams.textureSide;
-            for(unsigned int xp = 0; xp < texParams.textureSide; ++xp)
+            const TriangleRaster& triangle = triangles[i];
+            const int xEnd = std::min(triangle.RD.x, tileX + tileSide);
+            const int yEnd = std::min(triangle.RD.y, tileY + tileSide);
+
+            // iterate over pixels of the triangle's bounding box in the tile
+            for(int y = std::max(triangle.LU.y, tileY); y < yEnd; ++y)
             {
-                unsigned int xyoffset = yoffset + xp;
-                for(std::size_t level = 1; level < accuPyramid.pyramid.size(); ++level)
+                for(int x = std::max(triangle.LU.x, tileX); x < xEnd; ++x)
                 {
-                    AccuImage& atlasLevelTexture =  accuPyramid.pyramid[level];
-                    atlasTexture.img(xyoffset) += atlasLevelTexture.img(xyoffset);
+                    Pixel pix(x, y); // top-left corner of the pixel
+                    Point2d barycCoords;
+
+                    // test if the pixel is inside triangle
+                    // and retrieve its barycentric coordinates
+                    if(!isPixelInTriangle(triangle.triPixs, pix, barycCoords))
+                    {
+                        continue;
+                    }
+
+                    // get 3D coordinates
+                    const Point3d pt3d = barycentricToCartesian(triangle.triPts, barycCoords);
+                    // get 2D coordinates in source image
+                    Point2d pixRC;
+                    mp.getPixelFor3DPoint(&pixRC, pt3d, camId);
+                    // exclude out of bounds pixels
+                    if(!mp.isPixelInImage(pixRC, camId))
+                        continue;
+
+                    // If the color is pure zero (ie. no contributions), we consider it as an invalid pixel.
+                    if (getInterpolateColor(camImg, pixRC.y, pixRC.x) == image::RGBfColor(0.f, 0.f, 0.f))
+                        continue;
+
+                    // Fill the accumulated pyramid for this pixel
+                    // each frequency band also contributes to lower frequencies (higher band indexes)
+                    AccuTiledPyramid::AccuPixel* accuPixel = tileData + (y - tileY) * tileSide + (x - tileX);
+                    for(std::size_t bandContrib = triangle.band; bandContrib < nbLevels; ++bandContrib)
+                    {
+                        const int downscaleCoef = std::pow(texParams.multiBandDownscale, bandContrib);
+                        AccuTiledPyramid::AccuPixel& accu = accuPixel[bandContrib * levelSize];
+
+                        // fill the accumulated color map for this pixel
+                        const auto pixDownscaled = pixRC / downscaleCoef;
+                        accu.color += getInterpolateColor(pyramidL[bandContrib], pixDownscaled.y, pixDownscaled.x) * triangle.score;
+                        accu.count += triangle.score;
+                    }
                 }
             }
         }
-        writeTexture(atlasTexture, atlasID, outPath, textureFileType, -1);
+    });
+}
+
+void Texturing::getAtlasTexture(AccuTiledPyramid& accuPyramid, std::size_t maxTilesInCore,
+                                AccuImage& atlasTexture, int level) const
+{
+    const int side = accuPyramid.side;
+    const int tileSide = accuPyramid.tileSide;
+    const std::size_t levelSize = std::size_t(tileSide) * tileSide;
+
+    atlasTexture.img.resize(side, side);
+    atlasTexture.imgCount.assign(std::size_t(side) * side, 0.f);
+
+    std::vector<int> tileIndexes;
+    for(int tileIndex = 0; tileIndex < accuPyramid.tiles.size(); ++tileIndex)
+    {
+        if(accuPyramid.tiles[tileIndex] != nullptr)
+            tileIndexes.push_back(tileIndex);
     }
+
+    processAccuTiles(accuPyramid, tileIndexes, maxTilesInCore,
+                     [&](int tileIndex, AccuTiledPyramid::AccuPixel* tileData)
+    {
+        const int tileX = (tileIndex % accuPyramid.nbTilesPerSide) * tileSide;
+        const int tileY = (tileIndex / accuPyramid.nbTilesPerSide) * tileSide;
+        const int xEnd = std::min(side, tileX + tileSide);
+        const int yEnd = std::min(side, tileY + tileSide);
+
+        for(int y = tileY; y < yEnd; ++y)
+        {
+            // remap 'y' to image coordinates system (inverted Y axis)
+            const std::size_t yoffset = std::size_t(side - 1 - y) * side;
+            for(int x = tileX; x < xEnd; ++x)
+            {
+                const std::size_t xyoffset = yoffset + x;
+                const AccuTiledPyramid::AccuPixel* accuPixel = tileData + (y - tileY) * tileSide + (x - tileX);
+
+                if(level >= 0)
+                {
+                    const AccuTiledPyramid::AccuPixel& accu = accuPixel[level * levelSize];
+                    if(accu.count != 0)
+                        atlasTexture.img(xyoffset) = accu.color / accu.count;
+                    atlasTexture.imgCount[xyoffset] = accu.count;
+                    continue;
+                }
+
+                // If the count is valid on the first band, it will be valid on all the other bands
+                if(accuPixel[0].count == 0)
+                    continue;
+
+                // Fuse the average colors of the frequency bands
+                image::RGBfColor color = accuPixel[0].color / accuPixel[0].count;
+                for(int l = 1; l < accuPyramid.nbLevels; ++l)
+                {
+                    const AccuTiledPyramid::AccuPixel& accu = accuPixel[l * levelSize];
+                    color += accu.color / accu.count;
+                }
+                atlasTexture.img(xyoffset) = color;
+                atlasTexture.imgCount[xyoffset] = 1;
+            }
+        }
+    });
 }
 
 void Texturing::generateNormalAndHeightMaps(const mvsUtils::MultiViewParams& mp, const Mesh& denseMesh,
@@ -7,8 +7,9 @@
 #pragma once
 
 #include <aliceVision/image/io.hpp>
-#include <aliceVision/image/io.hpp>
+#include <aliceVision/image/cache.hpp>
 #include <aliceVision/mvsData/Point2d.hpp>
+#include <aliceVision/mvsData/Pixel.hpp>
 #include <aliceVision/mvsData/Point3d.hpp>
 #include <aliceVision/mvsData/StaticVector.hpp>
 #include <aliceVision/mvsData/Voxel.hpp>
@@ -19,6 +20,10 @@
 
 #include <boost/filesystem.hpp>
 
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace bfs = boost::filesystem;
 
 namespace GEO {
@@ -63,6 +68,22 @@ std::istream& operator>>(std::istream& in, EBumpMappingType& meshFileType);
 std::ostream& operator<<(std::ostream& os, EBumpMappingType meshFileType);
 
 
+/**
+ * @brief Return whether a pixel is contained in or intersected by a 2D triangle.
+ * @param[in] triangle the triangle as an array of 3 point2Ds
+ * @param[in] pixel the pixel to test
+ * @param[out] barycentricCoords the barycentric
+ *  coordinates of this pixel relative to \p triangle
+ * @return
+ */
+bool isPixelInTriangle(const Point2d* triangle, const Pixel& pixel, Point2d& barycentricCoords);
+
+/// @return the point of the triangle at the given barycentric coordinates
+Point2d barycentricToCartesian(const Point2d* triangle, const Point2d& coords);
+
+/// @return the point of the triangle at the given barycentric coordinates
+Point3d barycentricToCartesian(const Point3d* triangle, const Point2d& coords);
+
 struct BumpMappingParams
 {
     image::EImageFileType bumpMappingFileType = image::EImageFileType::NONE;
@@ -178,29 +199,97 @@ public:
             imgCount.resize(width * height);
         }
     };
-    struct AccuPyramid
-    {
-        std::vector<AccuImage> pyramid;
 
-        void init(int nbLevels, int imgWidth, int imgHeight)
+    /**
+     * @brief Accumulation buffers of the frequency bands of a texture atlas, split in square tiles.
+     *
+     * The tiles are created on the first contribution and managed by a TileCacheManager,
+     * which keeps the most recently used ones in memory and moves the others to disk.
+     * Each tile stores all the bands of its pixels.
+     */
+    struct AccuTiledPyramid
+    {
+        struct AccuPixel
         {
-            pyramid.resize(nbLevels);
-            for(auto& accuImage : pyramid)
-                accuImage.resize(imgWidth, imgHeight);
-        }
+            image::RGBfColor color;
+            float count;
+        };
+
+        std::shared_ptr<image::TileCacheManager> cacheManager;
+        int nbLevels = 0;
+        int side = 0;
+        int tileSide = 0;
+        int nbTilesPerSide = 0;
+        std::vector<image::CachedTile::smart_pointer> tiles;
+
+        void init(const std::shared_ptr<image::TileCacheManager>& manager, int nbBands, int textureSide);
+
+        /// Release the tiles and their memory
+        void clear();
+
+        /// @return the size of a tile in bytes
+        inline std::size_t getTileMemSize() const { return std::size_t(tileSide) * tileSide * nbLevels * sizeof(AccuPixel); }
+
+        /**
+         * @brief Get the data of a tile in memory, a new tile is initialized to zero.
+         * @note not thread-safe, the data remains valid until more tiles than the cache capacity are acquired
+         * @param[in] tileIndex the tile index
+         * @return the tile data (level, y, x), nullptr if the tile cannot be loaded
+         */
+        AccuPixel* acquireTile(int tileIndex);
     };
 
-    /// Generate texture files for all texture atlases
+    /// list of <triangleId, score>
+    using ScorePerTriangle = std::vector<std::pair<unsigned int, float>>;
+    /// contributions of a camera per texture atlas and per frequency band
+    using CameraContributions = std::map<std::size_t, std::vector<ScorePerTriangle>>;
+
+    /**
+     * @brief Generate texture files for all texture atlases
+     * @param[in] mp the multi-view parameters
+     * @param[in] outPath the output folder
+     * @param[in] textureFileType the texture file type
+     * @param[in] cacheFolder the folder where the tiles that do not fit in memory are swapped (empty: system temporary folder)
+     */
     void generateTextures(const mvsUtils::MultiViewParams& mp,
                           const bfs::path &outPath,
-                          image::EImageFileType textureFileType = image::EImageFileType::PNG);
-
-    /// Generate texture files for the given sub-set of texture atlases
-    void generateTexturesSubSet(const mvsUtils::MultiViewParams& mp,
-                                const std::vector<size_t>& atlasIDs,
-                                mvsUtils::ImagesCache<image::Image<image::RGBfColor>>& imageCache,
-                                const bfs::path &outPath,
-                                image::EImageFileType textureFileType = image::EImageFileType::PNG);
+                          image::EImageFileType textureFileType = image::EImageFileType::PNG,
+                          const bfs::path& cacheFolder = bfs::path());
+
+    /**
+     * @brief Select the best cameras for each triangle of a texture atlas.
+     * @param[in] mp the multi-view parameters
+     * @param[in] atlasID the texture atlas
+     * @param[in,out] contributionsPerCamera the triangles contributions per camera, per atlas and per frequency band
+     */
+    void selectTrianglesContributions(const mvsUtils::MultiViewParams& mp, std::size_t atlasID,
+                                      std::vector<CameraContributions>& contributionsPerCamera) const;
+
+    /**
+     * @brief Accumulate the colors of a camera into the frequency bands of a texture atlas.
+     * @param[in] mp the multi-view parameters
+     * @param[in] camId the camera
+     * @param[in] camImg the camera image
+     * @param[in] pyramidL the laplacian pyramid of the camera image
+     * @param[in] contributions the triangles contributions of the camera to the atlas per frequency band
+     * @param[in] maxTilesInCore the maximum number of tiles in memory
+     * @param[in,out] accuPyramid the atlas accumulation buffers
+     */
+    void accumulateCameraContributions(const mvsUtils::MultiViewParams& mp, int camId,
+                                       const image::Image<image::RGBfColor>& camImg,
+                                       const std::vector<image::Image<image::RGBfColor>>& pyramidL,
+                                       const std::vector<ScorePerTriangle>& contributions,
+                                       std::size_t maxTilesInCore, AccuTiledPyramid& accuPyramid) const;
+
+    /**
+     * @brief Fuse the frequency bands of a texture atlas.
+     * @param[in] accuPyramid the atlas accumulation buffers
+     * @param[in] maxTilesInCore the maximum number of tiles in memory
+     * @param[out] atlasTexture the atlas texture
+     * @param[in] level the frequency band to extract, -1 for the fused texture
+     */
+    void getAtlasTexture(AccuTiledPyramid& accuPyramid, std::size_t maxTilesInCore,
+                         AccuImage& atlasTexture, int level = -1) const;
 
     void generateNormalAndHeightMaps(const mvsUtils::MultiViewParams& mp, const Mesh& denseMesh,
                                      const bfs::path& outPath, const mesh::BumpMappingParams& bumpMappingParams);
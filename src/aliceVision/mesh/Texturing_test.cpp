@@ -0,0 +1,255 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/mesh/Texturing.hpp>
+#include <aliceVision/camera/Pinhole.hpp>
+#include <aliceVision/sfmData/SfMData.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+
+#define BOOST_TEST_MODULE texturing
+
+#include <boost/test/unit_test.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::mesh;
+
+namespace {
+
+/// cameras looking at the plane z=0 from different positions
+sfmData::SfMData createScene(int nbCameras, int width, int height)
+{
+    sfmData::SfMData sfmData;
+    sfmData.intrinsics[0] = std::make_shared<camera::Pinhole>(width, height, 150.0, 150.0, 0.0, 0.0);
+
+    for(int i = 0; i < nbCameras; ++i)
+    {
+        std::shared_ptr<sfmData::View> view = std::make_shared<sfmData::View>("", i, 0, i, width, height);
+        sfmData.views[i] = view;
+        const Vec3 center(0.3 * std::cos(i), 0.2 * std::sin(i), -3.0 - 0.2 * i);
+        sfmData.setPose(*view, sfmData::CameraPose(geometry::Pose3(Mat3::Identity(), center)));
+    }
+    return sfmData;
+}
+
+/// regular grid on the plane z=0 in [-1;1]x[-1;1], with UVs in [0;1]x[0;1], visible by all cameras
+Mesh* createPlaneMesh(int gridSize, int nbCameras)
+{
+    Mesh* mesh = new Mesh();
+    for(int j = 0; j <= gridSize; ++j)
+    {
+        for(int i = 0; i <= gridSize; ++i)
+        {
+            const Point2d uv(double(i) / gridSize, double(j) / gridSize);
+            mesh->pts.push_back(Point3d(uv.x * 2.0 - 1.0, uv.y * 2.0 - 1.0, 0.0));
+            mesh->uvCoords.push_back(uv);
+
+            PointVisibility visibility;
+            for(int c = 0; c < nbCameras; ++c)
+                visibility.push_back(c);
+            mesh->pointsVisibilities.push_back(visibility);
+        }
+    }
+    for(int j = 0; j < gridSize; ++j)
+    {
+        for(int i = 0; i < gridSize; ++i)
+        {
+            const int v = j * (gridSize + 1) + i;
+            mesh->tris.push_back(Mesh::triangle(v, v + 1, v + gridSize + 2));
+            mesh->trisUvIds.push_back(Voxel(v, v + 1, v + gridSize + 2));
+            mesh->tris.push_back(Mesh::triangle(v, v + gridSize + 2, v + gridSize + 1));
+            mesh->trisUvIds.push_back(Voxel(v, v + gridSize + 2, v + gridSize + 1));
+        }
+    }
+    return mesh;
+}
+
+/// a smooth non-black image per camera and per pyramid level
+image::Image<image::RGBfColor> createImage(int camId, int level, int width, int height)
+{
+    image::Image<image::RGBfColor> img(width, height);
+    for(int y = 0; y < height; ++y)
+        for(int x = 0; x < width; ++x)
+            img(y, x) = image::RGBfColor(1.0f + std::sin(0.05f * x + camId), 1.0f + std::cos(0.07f * y - level), 0.5f + 0.01f * (camId + level));
+    return img;
+}
+
+/// the full resolution accumulation of the texturing before the tiled buffers
+void accumulateReference(const Texturing& texturing, const mvsUtils::MultiViewParams& mp, int camId,
+                         const image::Image<image::RGBfColor>& camImg,
+                         const std::vector<image::Image<image::RGBfColor>>& pyramidL,
+                         const std::vector<Texturing::ScorePerTriangle>& contributions,
+                         std::vector<Texturing::AccuImage>& accuPyramid)
+{
+    const TexturingParams& texParams = texturing.texParams;
+    const Mesh& mesh = *texturing.mesh;
+
+    for(int band = 0; band < contributions.size(); ++band)
+    {
+        for(const auto& contribution : contributions[band])
+        {
+            const unsigned int triangleId = contribution.first;
+            const float triangleScore = texParams.useScore ? contribution.second : 1.0f;
+
+            Point2d triPixs[3];
+            Point3d triPts[3];
+            for(int k = 0; k < 3; ++k)
+            {
+                triPts[k] = mesh.pts[mesh.tris[triangleId].v[k]];
+                triPixs[k] = mesh.uvCoords[mesh.trisUvIds[triangleId].m[k]] * texParams.textureSide;
+            }
+
+            const int texSide = static_cast<int>(texParams.textureSide);
+            const int xMin = std::max(0, int(std::floor(std::min({triPixs[0].x, triPixs[1].x, triPixs[2].x}))));
+            const int yMin = std::max(0, int(std::floor(std::min({triPixs[0].y, triPixs[1].y, triPixs[2].y}))));
+            const int xMax = std::min(texSide, int(std::ceil(std::max({triPixs[0].x, triPixs[1].x, triPixs[2].x}))));
+            const int yMax = std::min(texSide, int(std::ceil(std::max({triPixs[0].y, triPixs[1].y, triPixs[2].y}))));
+
+            for(int y = yMin; y < yMax; ++y)
+            {
+                for(int x = xMin; x < xMax; ++x)
+                {
+                    Point2d barycCoords;
+                    if(!isPixelInTriangle(triPixs, Pixel(x, y), barycCoords))
+                        continue;
+
+                    const unsigned int xyoffset = ((texParams.textureSide - 1) - y) * texParams.textureSide + x;
+                    const Point3d pt3d = barycentricToCartesian(triPts, barycCoords);
+                    Point2d pixRC;
+                    mp.getPixelFor3DPoint(&pixRC, pt3d, camId);
+                    if(!mp.isPixelInImage(pixRC, camId))
+                        continue;
+                    if(getInterpolateColor(camImg, pixRC.y, pixRC.x) == image::RGBfColor(0.f, 0.f, 0.f))
+                        continue;
+
+                    for(std::size_t bandContrib = band; bandContrib < pyramidL.size(); ++bandContrib)
+                    {
+                        const int downscaleCoef = std::pow(texParams.multiBandDownscale, bandContrib);
+                        const auto pixDownscaled = pixRC / downscaleCoef;
+                        accuPyramid[bandContrib].img(xyoffset) += getInterpolateColor(pyramidL[bandContrib], pixDownscaled.y, pixDownscaled.x) * triangleScore;
+                        accuPyramid[bandContrib].imgCount[xyoffset] += triangleScore;
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+//-----------------
+// Test summary:
+//-----------------
+// - Texture a plane seen by several cameras
+// - Accumulate the cameras in tiled buffers, with a cache of a single tile in memory (the other tiles are swapped on disk)
+// - Check that the texture is the same as the full resolution accumulation in memory
+//-----------------
+BOOST_AUTO_TEST_CASE(texturing_tiledAccumulation)
+{
+    const int nbCameras = 4;
+    const int width = 240;
+    const int height = 180;
+    const sfmData::SfMData sfmData = createScene(nbCameras, width, height);
+    mvsUtils::MultiViewParams mp(sfmData, "", "", "", false);
+    BOOST_REQUIRE_EQUAL(mp.getNbCameras(), nbCameras);
+
+    Texturing texturing;
+    texturing.mesh = createPlaneMesh(8, nbCameras);
+    texturing.texParams.textureSide = 300; // not a multiple of the tile size
+    texturing.texParams.nbBand = 2;
+    texturing.texParams.multiBandDownscale = 2;
+    texturing.texParams.multiBandNbContrib = {1, 3}; // cumulated contributions per band
+    texturing._atlases.resize(1);
+    for(int triangleId = 0; triangleId < texturing.mesh->tris.size(); ++triangleId)
+        texturing._atlases[0].push_back(triangleId);
+
+    std::vector<Texturing::CameraContributions> contributionsPerCamera(nbCameras);
+    texturing.selectTrianglesContributions(mp, 0, contributionsPerCamera);
+
+    const boost::filesystem::path cacheFolder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(cacheFolder);
+
+    {
+        std::shared_ptr<image::TileCacheManager> cacheManager = image::TileCacheManager::create(cacheFolder.string(), 256, 256, 64);
+        Texturing::AccuTiledPyramid accuTiledPyramid;
+        accuTiledPyramid.init(cacheManager, texturing.texParams.nbBand, texturing.texParams.textureSide);
+        const std::size_t maxTilesInCore = 1;
+        cacheManager->setMaxMemory(maxTilesInCore * accuTiledPyramid.getTileMemSize());
+
+        std::vector<Texturing::AccuImage> referencePyramid(texturing.texParams.nbBand);
+        for(Texturing::AccuImage& accuImage : referencePyramid)
+            accuImage.resize(texturing.texParams.textureSide, texturing.texParams.textureSide);
+
+        int nbContributingCameras = 0;
+        for(int camId = 0; camId < nbCameras; ++camId)
+        {
+            const auto it = contributionsPerCamera[camId].find(0);
+            if(it == contributionsPerCamera[camId].end())
+                continue;
+            ++nbContributingCameras;
+
+            const image::Image<image::RGBfColor> camImg = createImage(camId, -1, width, height);
+            std::vector<image::Image<image::RGBfColor>> pyramidL;
+            for(int level = 0; level < texturing.texParams.nbBand; ++level)
+                pyramidL.push_back(createImage(camId, level, width >> level, height >> level));
+
+            texturing.accumulateCameraContributions(mp, camId, camImg, pyramidL, it->second, maxTilesInCore, accuTiledPyramid);
+            accumulateReference(texturing, mp, camId, camImg, pyramidL, it->second, referencePyramid);
+        }
+        BOOST_CHECK_GT(nbContributingCameras, 1);
+
+        // each band and the fused texture
+        for(int level = -1; level < texturing.texParams.nbBand; ++level)
+        {
+            Texturing::AccuImage texture;
+            texturing.getAtlasTexture(accuTiledPyramid, maxTilesInCore, texture, level);
+
+            int nbValidPixels = 0;
+            int nbDifferentPixels = 0;
+            for(int i = 0; i < texture.imgCount.size(); ++i)
+            {
+                const float referenceCount = referencePyramid[0].imgCount[i];
+                if(level >= 0)
+                {
+                    const Texturing::AccuImage& reference = referencePyramid[level];
+                    if(texture.imgCount[i] != reference.imgCount[i])
+                        ++nbDifferentPixels;
+                    else if(reference.imgCount[i] != 0 && (texture.img(i) - reference.img(i) / reference.imgCount[i]).norm() > 1e-5f)
+                        ++nbDifferentPixels;
+                    continue;
+                }
+
+                if(referenceCount == 0)
+                {
+                    nbDifferentPixels += (texture.imgCount[i] != 0);
+                    continue;
+                }
+                ++nbValidPixels;
+
+                image::RGBfColor color = referencePyramid[0].img(i) / referenceCount;
+                for(int l = 1; l < texturing.texParams.nbBand; ++l)
+                    color += referencePyramid[l].img(i) / referencePyramid[l].imgCount[i];
+
+                if(texture.imgCount[i] != 1 || (texture.img(i) - color).norm() > 1e-5f)
+                    ++nbDifferentPixels;
+            }
+
+            BOOST_CHECK_EQUAL(nbDifferentPixels, 0);
+            if(level < 0)
+                BOOST_CHECK_GT(nbValidPixels, texturing.texParams.textureSide * texturing.texParams.textureSide / 2);
+        }
+
+        // the atlas uses the 4 tiles, only one is in memory and the others are swapped in the cache folder
+        BOOST_CHECK_EQUAL(cacheManager->getActiveBlocks(), 4);
+        BOOST_CHECK(!boost::filesystem::is_empty(cacheFolder));
+        accuTiledPyramid.clear();
+        BOOST_CHECK_EQUAL(cacheManager->getActiveBlocks(), 0);
+    }
+
+    boost::filesystem::remove_all(cacheFolder);
+}
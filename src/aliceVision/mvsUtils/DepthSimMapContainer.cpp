@@ -0,0 +1,570 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "DepthSimMapContainer.hpp"
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/numeric/numeric.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace aliceVision {
+namespace mvsUtils {
+
+namespace {
+
+const char containerMagic[5] = {'A', 'V', 'D', 'S', 'M'};
+const std::uint32_t containerFormatVersion = 3;
+
+enum EChannel : std::uint32_t
+{
+    DEPTH = 1,
+    SIM = 2
+};
+
+template <typename T>
+inline void writeValue(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline void readValue(std::istream& stream, T& value)
+{
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+inline std::uint32_t floatBits(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    return bits;
+}
+
+inline float bitsFloat(std::uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+/**
+ * @brief Compress the values of a tile channel.
+ * @param[in] values the tile values in row-major order
+ * @param[in] width the tile width
+ * @param[in] height the tile height
+ * @param[out] out_data the compressed data
+ */
+void encodeTileChannel(const std::vector<float>& values, int width, int height, std::vector<char>& out_data)
+{
+    const std::size_t nbValues = std::size_t(width) * height;
+
+    // 4-bit codes (number of significant bytes of each residual) then the residual bytes
+    out_data.assign((nbValues + 1) / 2, 0);
+    out_data.reserve(out_data.size() + nbValues * 2);
+
+    for(std::size_t i = 0; i < nbValues; ++i)
+    {
+        const int x = i % width;
+        const std::uint32_t prediction = (x > 0) ? floatBits(values[i - 1]) : ((i >= std::size_t(width)) ? floatBits(values[i - width]) : 0);
+        std::uint32_t residual = floatBits(values[i]) ^ prediction;
+
+        char nbBytes = 0;
+        for(std::uint32_t r = residual; r != 0; r >>= 8)
+            ++nbBytes;
+
+        out_data[i / 2] |= char(nbBytes << ((i % 2) * 4));
+
+        for(char b = 0; b < nbBytes; ++b, residual >>= 8)
+            out_data.push_back(char(residual & 0xFF));
+    }
+}
+
+/**
+ * @brief Decompress the values of a tile channel.
+ * @param[in] data the compressed data
+ * @param[in] width the tile width
+ * @param[in] height the tile height
+ * @param[out] out_values the tile values in row-major order
+ */
+void decodeTileChannel(const std::vector<char>& data, int width, int height, std::vector<float>& out_values)
+{
+    const std::size_t nbValues = std::size_t(width) * height;
+    const std::size_t codesSize = (nbValues + 1) / 2;
+
+    if(data.size() < codesSize)
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container tile data.");
+
+    out_values.resize(nbValues);
+    std::size_t position = codesSize;
+
+    for(std::size_t i = 0; i < nbValues; ++i)
+    {
+        const int nbBytes = (static_cast<unsigned char>(data[i / 2]) >> ((i % 2) * 4)) & 0x0F;
+
+        if(nbBytes > 4 || position + nbBytes > data.size())
+            ALICEVISION_THROW_ERROR("Invalid depth/sim map container tile data.");
+
+        std::uint32_t residual = 0;
+        for(int b = 0; b < nbBytes; ++b)
+            residual |= std::uint32_t(static_cast<unsigned char>(data[position + b])) << (8 * b);
+        position += nbBytes;
+
+        const int x = i % width;
+        const std::uint32_t prediction = (x > 0) ? floatBits(out_values[i - 1]) : ((i >= std::size_t(width)) ? floatBits(out_values[i - width]) : 0);
+        out_values[i] = bitsFloat(residual ^ prediction);
+    }
+}
+
+/// @return true if the depth/sim pair a is closer than b (the similarity breaks the ties)
+inline bool isCloser(float depthA, float simA, float depthB, float simB)
+{
+    return (depthA < depthB) || (depthA == depthB && simA < simB);
+}
+
+} // namespace
+
+void downscaleDepthSimMap(const image::Image<float>& depthMap,
+                          const image::Image<float>& simMap,
+                          image::Image<float>& out_depthMap,
+                          image::Image<float>& out_simMap)
+{
+    const bool hasSimMap = (simMap.size() > 0);
+    const int width = depthMap.Width();
+    const int height = depthMap.Height();
+    const int outWidth = divideRoundUp(width, 2);
+    const int outHeight = divideRoundUp(height, 2);
+
+    out_depthMap.resize(outWidth, outHeight, false);
+    if(hasSimMap)
+        out_simMap.resize(outWidth, outHeight, false);
+    else
+        out_simMap = image::Image<float>();
+
+    for(int y = 0; y < outHeight; ++y)
+    {
+        for(int x = 0; x < outWidth; ++x)
+        {
+            // no valid depth: keep the top-left pixel
+            int bestX = 2 * x;
+            int bestY = 2 * y;
+            bool valid = false;
+
+            for(int sy = 2 * y; sy < std::min(2 * y + 2, height); ++sy)
+            {
+                for(int sx = 2 * x; sx < std::min(2 * x + 2, width); ++sx)
+                {
+                    const float depth = depthMap(sy, sx);
+                    if(depth <= 0.0f)
+                        continue;
+
+                    const float sim = hasSimMap ? simMap(sy, sx) : 0.0f;
+                    const float bestSim = hasSimMap ? simMap(bestY, bestX) : 0.0f;
+
+                    if(!valid || isCloser(depth, sim, depthMap(bestY, bestX), bestSim))
+                    {
+                        bestX = sx;
+                        bestY = sy;
+                        valid = true;
+                    }
+                }
+            }
+
+            out_depthMap(y, x) = depthMap(bestY, bestX);
+            if(hasSimMap)
+                out_simMap(y, x) = simMap(bestY, bestX);
+        }
+    }
+}
+
+void writeDepthSimMapContainer(const std::string& path,
+                               const image::Image<float>& depthMap,
+                               const image::Image<float>& simMap,
+                               const DepthSimMapCameraInfo& cameraInfo,
+                               int tileSize,
+                               int nbLevels)
+{
+    const bool hasSimMap = (simMap.size() > 0);
+
+    if(tileSize <= 0 || nbLevels <= 0)
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container parameters (tile size: " << tileSize << ", levels: " << nbLevels << ").");
+
+    if(hasSimMap && (simMap.Width() != depthMap.Width() || simMap.Height() != depthMap.Height()))
+        ALICEVISION_THROW_ERROR("Depth map and similarity map sizes differ, cannot write container: " << path);
+
+    if(cameraInfo.downscale <= 0 || (!cameraInfo.P.empty() && cameraInfo.P.size() != 16))
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container camera information, cannot write container: " << path);
+
+    // build the levels, until the level is a single pixel
+    std::vector<image::Image<float>> depthLevels(1, depthMap);
+    std::vector<image::Image<float>> simLevels(1, simMap);
+
+    while(int(depthLevels.size()) < nbLevels && (depthLevels.back().Width() > 1 || depthLevels.back().Height() > 1))
+    {
+        image::Image<float> levelDepthMap;
+        image::Image<float> levelSimMap;
+        downscaleDepthSimMap(depthLevels.back(), simLevels.back(), levelDepthMap, levelSimMap);
+        depthLevels.push_back(std::move(levelDepthMap));
+        simLevels.push_back(std::move(levelSimMap));
+    }
+
+    std::ofstream stream(path, std::ios::binary);
+    if(!stream.is_open())
+        ALICEVISION_THROW_ERROR("Cannot open depth/sim map container file: " << path);
+
+    std::uint64_t nbDepthValues = 0;
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = -std::numeric_limits<float>::max();
+
+    for(int i = 0; i < depthMap.size(); ++i)
+    {
+        const float depth = depthMap(i);
+        if(depth <= 0.0f)
+            continue;
+        ++nbDepthValues;
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    if(nbDepthValues == 0)
+    {
+        minDepth = 0.0f;
+        maxDepth = 0.0f;
+    }
+
+    // header
+    stream.write(containerMagic, sizeof(containerMagic));
+    writeValue(stream, containerFormatVersion);
+    writeValue(stream, std::uint32_t(depthMap.Width()));
+    writeValue(stream, std::uint32_t(depthMap.Height()));
+    writeValue(stream, std::uint32_t(tileSize));
+    writeValue(stream, std::uint32_t(depthLevels.size()));
+    writeValue(stream, std::uint32_t(hasSimMap ? (EChannel::DEPTH | EChannel::SIM) : EChannel::DEPTH));
+    writeValue(stream, nbDepthValues);
+    writeValue(stream, minDepth);
+    writeValue(stream, maxDepth);
+
+    // camera
+    std::vector<double> matrixP = cameraInfo.P;
+    matrixP.resize(16, 0.0);
+    writeValue(stream, std::uint32_t(cameraInfo.downscale));
+    writeValue(stream, std::uint32_t(cameraInfo.imageWidth));
+    writeValue(stream, std::uint32_t(cameraInfo.imageHeight));
+    writeValue(stream, std::uint32_t(!cameraInfo.P.empty()));
+    stream.write(reinterpret_cast<const char*>(matrixP.data()), matrixP.size() * sizeof(double));
+
+    // tile index placeholder, updated once the tiles are written
+    std::vector<std::vector<DepthSimMapTileInfo>> tiles(depthLevels.size());
+    for(std::size_t level = 0; level < depthLevels.size(); ++level)
+        tiles.at(level).resize(divideRoundUp(depthLevels.at(level).Width(), tileSize) * divideRoundUp(depthLevels.at(level).Height(), tileSize));
+
+    const std::streampos indexPosition = stream.tellp();
+    for(const auto& levelTiles : tiles)
+    {
+        for(const DepthSimMapTileInfo& tile : levelTiles)
+        {
+            writeValue(stream, tile.offset);
+            writeValue(stream, tile.depthSize);
+            writeValue(stream, tile.simSize);
+            writeValue(stream, tile.nbDepthValues);
+            writeValue(stream, tile.minDepth);
+            writeValue(stream, tile.maxDepth);
+        }
+    }
+
+    // tile data
+    std::vector<float> tileValues;
+    std::vector<char> tileData;
+
+    for(std::size_t level = 0; level < depthLevels.size(); ++level)
+    {
+        const image::Image<float>& levelDepthMap = depthLevels.at(level);
+        const image::Image<float>& levelSimMap = simLevels.at(level);
+        const int nbTilesX = divideRoundUp(levelDepthMap.Width(), tileSize);
+
+        for(std::size_t t = 0; t < tiles.at(level).size(); ++t)
+        {
+            DepthSimMapTileInfo& tile = tiles.at(level).at(t);
+
+            const int beginX = (t % nbTilesX) * tileSize;
+            const int beginY = (t / nbTilesX) * tileSize;
+            const int width = std::min(tileSize, levelDepthMap.Width() - beginX);
+            const int height = std::min(tileSize, levelDepthMap.Height() - beginY);
+
+            tile.offset = stream.tellp();
+            tile.minDepth = std::numeric_limits<float>::max();
+            tile.maxDepth = -std::numeric_limits<float>::max();
+
+            // depth
+            tileValues.resize(std::size_t(width) * height);
+            for(int y = 0; y < height; ++y)
+            {
+                for(int x = 0; x < width; ++x)
+                {
+                    const float depth = levelDepthMap(beginY + y, beginX + x);
+                    tileValues[y * width + x] = depth;
+
+                    if(depth > 0.0f)
+                    {
+                        ++tile.nbDepthValues;
+                        tile.minDepth = std::min(tile.minDepth, depth);
+                        tile.maxDepth = std::max(tile.maxDepth, depth);
+                    }
+                }
+            }
+
+            if(tile.nbDepthValues == 0)
+            {
+                tile.minDepth = 0.0f;
+                tile.maxDepth = 0.0f;
+            }
+
+            encodeTileChannel(tileValues, width, height, tileData);
+            stream.write(tileData.data(), tileData.size());
+            tile.depthSize = tileData.size();
+
+            // similarity
+            if(hasSimMap)
+            {
+                for(int y = 0; y < height; ++y)
+                    for(int x = 0; x < width; ++x)
+                        tileValues[y * width + x] = levelSimMap(beginY + y, beginX + x);
+
+                encodeTileChannel(tileValues, width, height, tileData);
+                stream.write(tileData.data(), tileData.size());
+                tile.simSize = tileData.size();
+            }
+        }
+    }
+
+    // tile index
+    stream.seekp(indexPosition);
+    for(const auto& levelTiles : tiles)
+    {
+        for(const DepthSimMapTileInfo& tile : levelTiles)
+        {
+            writeValue(stream, tile.offset);
+            writeValue(stream, tile.depthSize);
+            writeValue(stream, tile.simSize);
+            writeValue(stream, tile.nbDepthValues);
+            writeValue(stream, tile.minDepth);
+            writeValue(stream, tile.maxDepth);
+        }
+    }
+
+    if(!stream.good())
+        ALICEVISION_THROW_ERROR("Cannot write depth/sim map container file: " << path);
+}
+
+DepthSimMapContainer::DepthSimMapContainer(const std::string& path)
+  : _path(path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if(!stream.is_open())
+        ALICEVISION_THROW_ERROR("Cannot open depth/sim map container file: " << path);
+
+    char magic[sizeof(containerMagic)];
+    std::uint32_t version = 0;
+    stream.read(magic, sizeof(magic));
+    readValue(stream, version);
+
+    if(!stream.good() || std::memcmp(magic, containerMagic, sizeof(magic)) != 0)
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container file: " << path);
+
+    if(version != containerFormatVersion)
+        ALICEVISION_THROW_ERROR("Unsupported depth/sim map container version " << version << ": " << path);
+
+    std::uint32_t width, height, tileSize, nbLevels, channels;
+    readValue(stream, width);
+    readValue(stream, height);
+    readValue(stream, tileSize);
+    readValue(stream, nbLevels);
+    readValue(stream, channels);
+    readValue(stream, _nbDepthValues);
+    readValue(stream, _minDepth);
+    readValue(stream, _maxDepth);
+
+    if(!stream.good() || tileSize == 0 || nbLevels == 0)
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container header: " << path);
+
+    _width = width;
+    _height = height;
+    _tileSize = tileSize;
+    _nbLevels = nbLevels;
+    _hasSimMap = (channels & EChannel::SIM);
+
+    std::uint32_t downscale, imageWidth, imageHeight, hasP;
+    std::vector<double> matrixP(16);
+    readValue(stream, downscale);
+    readValue(stream, imageWidth);
+    readValue(stream, imageHeight);
+    readValue(stream, hasP);
+    stream.read(reinterpret_cast<char*>(matrixP.data()), matrixP.size() * sizeof(double));
+
+    if(!stream.good() || downscale == 0)
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container camera information: " << path);
+
+    _cameraInfo.downscale = downscale;
+    _cameraInfo.imageWidth = imageWidth;
+    _cameraInfo.imageHeight = imageHeight;
+    if(hasP)
+        _cameraInfo.P = matrixP;
+
+    _tiles.resize(_nbLevels);
+    for(int level = 0; level < _nbLevels; ++level)
+    {
+        std::vector<DepthSimMapTileInfo>& levelTiles = _tiles.at(level);
+        levelTiles.resize(getNbTilesX(level) * getNbTilesY(level));
+
+        for(DepthSimMapTileInfo& tile : levelTiles)
+        {
+            readValue(stream, tile.offset);
+            readValue(stream, tile.depthSize);
+            readValue(stream, tile.simSize);
+            readValue(stream, tile.nbDepthValues);
+            readValue(stream, tile.minDepth);
+            readValue(stream, tile.maxDepth);
+        }
+    }
+
+    if(!stream.good())
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map container tile index: " << path);
+}
+
+int DepthSimMapContainer::getWidth(int level) const
+{
+    int width = _width;
+    for(int l = 0; l < level; ++l)
+        width = divideRoundUp(width, 2);
+    return width;
+}
+
+int DepthSimMapContainer::getHeight(int level) const
+{
+    int height = _height;
+    for(int l = 0; l < level; ++l)
+        height = divideRoundUp(height, 2);
+    return height;
+}
+
+int DepthSimMapContainer::getNbTilesX(int level) const
+{
+    return divideRoundUp(getWidth(level), _tileSize);
+}
+
+int DepthSimMapContainer::getNbTilesY(int level) const
+{
+    return divideRoundUp(getHeight(level), _tileSize);
+}
+
+const DepthSimMapTileInfo& DepthSimMapContainer::getTileInfo(int level, int tileX, int tileY) const
+{
+    return _tiles.at(level).at(tileY * getNbTilesX(level) + tileX);
+}
+
+ROI DepthSimMapContainer::getTileRoi(int level, int tileX, int tileY) const
+{
+    const ROI tileRoi(tileX * _tileSize, (tileX + 1) * _tileSize, tileY * _tileSize, (tileY + 1) * _tileSize);
+    return intersect(tileRoi, ROI(0, getWidth(level), 0, getHeight(level)));
+}
+
+int DepthSimMapContainer::getLevel(int downscale) const
+{
+    for(int level = 0; level < _nbLevels; ++level)
+    {
+        if((1 << level) == downscale)
+            return level;
+    }
+    return -1;
+}
+
+void DepthSimMapContainer::readDepthMap(image::Image<float>& out_depthMap, int level, const ROI& roi) const
+{
+    read(&out_depthMap, nullptr, level, roi);
+}
+
+void DepthSimMapContainer::readSimMap(image::Image<float>& out_simMap, int level, const ROI& roi) const
+{
+    read(nullptr, &out_simMap, level, roi);
+}
+
+void DepthSimMapContainer::readDepthSimMap(image::Image<float>& out_depthMap,
+                                           image::Image<float>& out_simMap,
+                                           int level,
+                                           const ROI& roi) const
+{
+    read(&out_depthMap, &out_simMap, level, roi);
+}
+
+void DepthSimMapContainer::read(image::Image<float>* out_depthMap, image::Image<float>* out_simMap, int level, const ROI& roi) const
+{
+    if(level < 0 || level >= _nbLevels)
+        ALICEVISION_THROW_ERROR("Invalid level " << level << " in depth/sim map container: " << _path);
+
+    if(out_simMap != nullptr && !_hasSimMap)
+        ALICEVISION_THROW_ERROR("No similarity map in depth/sim map container: " << _path);
+
+    const int levelWidth = getWidth(level);
+    const int levelHeight = getHeight(level);
+    const ROI levelRoi(0, levelWidth, 0, levelHeight);
+    const ROI readRoi = roi.isEmpty() ? levelRoi : roi;
+
+    if(readRoi.x.end > unsigned(levelWidth) || readRoi.y.end > unsigned(levelHeight))
+        ALICEVISION_THROW_ERROR("Region out of the level " << level << " of the depth/sim map container: " << _path);
+
+    if(out_depthMap != nullptr)
+        out_depthMap->resize(readRoi.width(), readRoi.height(), false);
+    if(out_simMap != nullptr)
+        out_simMap->resize(readRoi.width(), readRoi.height(), false);
+
+    if(readRoi.isEmpty())
+        return;
+
+    std::ifstream stream(_path, std::ios::binary);
+    if(!stream.is_open())
+        ALICEVISION_THROW_ERROR("Cannot open depth/sim map container file: " << _path);
+
+    std::vector<char> tileData;
+    std::vector<float> tileValues;
+
+    // decode a channel of a tile and copy the part inside the region
+    const auto readTileChannel = [&](std::uint64_t offset, std::uint32_t size, const ROI& tileRoi, image::Image<float>& out_map)
+    {
+        tileData.resize(size);
+        stream.seekg(offset);
+        stream.read(tileData.data(), size);
+
+        if(!stream.good())
+            ALICEVISION_THROW_ERROR("Cannot read depth/sim map container tile: " << _path);
+
+        decodeTileChannel(tileData, tileRoi.width(), tileRoi.height(), tileValues);
+
+        const ROI copyRoi = intersect(tileRoi, readRoi);
+        for(unsigned int y = copyRoi.y.begin; y < copyRoi.y.end; ++y)
+            for(unsigned int x = copyRoi.x.begin; x < copyRoi.x.end; ++x)
+                out_map(y - readRoi.y.begin, x - readRoi.x.begin) = tileValues[(y - tileRoi.y.begin) * tileRoi.width() + (x - tileRoi.x.begin)];
+    };
+
+    for(unsigned int tileY = readRoi.y.begin / _tileSize; tileY <= (readRoi.y.end - 1) / _tileSize; ++tileY)
+    {
+        for(unsigned int tileX = readRoi.x.begin / _tileSize; tileX <= (readRoi.x.end - 1) / _tileSize; ++tileX)
+        {
+            const DepthSimMapTileInfo& tile = getTileInfo(level, tileX, tileY);
+            const ROI tileRoi = getTileRoi(level, tileX, tileY);
+
+            if(out_depthMap != nullptr)
+                readTileChannel(tile.offset, tile.depthSize, tileRoi, *out_depthMap);
+
+            if(out_simMap != nullptr)
+                readTileChannel(tile.offset + tile.depthSize, tile.simSize, tileRoi, *out_simMap);
+        }
+    }
+}
+
+} // namespace mvsUtils
+} // namespace aliceVision
@@ -0,0 +1,195 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/image/Image.hpp>
+#include <aliceVision/mvsData/ROI.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace aliceVision {
+namespace mvsUtils {
+
+// AliceVision tiled depth/sim map container (.avdsm):
+// -- Header
+// magic "AVDSM", format version (uint32), width, height, tile size, number of levels, channels (uint32),
+// number of valid depths (uint64), min depth, max depth (float)
+// -- Camera, the equivalent of the EXR depth/sim map metadata
+// downscale, original image width, original image height, has projection matrix (uint32),
+// projection matrix 4x4 at scale 1 in row-major order (16 double)
+// -- Tile index, for each level (full resolution first) and each tile in row-major order
+// data offset (uint64), compressed depth size, compressed sim size (uint32),
+// number of valid depths (uint32), min depth, max depth (float)
+// -- Tile data
+// --
+// Each level is half the size of the previous one. A downscaled pixel keeps the closest valid depth of the
+// 2x2 pixels below it, with its similarity, so a level is never the blend of two surfaces.
+// Each channel of a tile is compressed losslessly: every float is XORed with its left neighbor (its top
+// neighbor on the first column), the number of significant bytes of the residual is stored in a 4-bit code
+// followed by these bytes. Invalid areas and smooth surfaces are stored in a few bits per pixel.
+// Values are stored in the native (little-endian) byte order.
+
+/**
+ * @brief Tile information of a depth/sim map container.
+ */
+struct DepthSimMapTileInfo
+{
+    /// tile data offset in the file
+    std::uint64_t offset = 0;
+    /// compressed depth data size in bytes
+    std::uint32_t depthSize = 0;
+    /// compressed similarity data size in bytes (0 if no similarity map)
+    std::uint32_t simSize = 0;
+    /// number of valid depths in the tile
+    std::uint32_t nbDepthValues = 0;
+    /// depth range of the valid depths of the tile
+    float minDepth = 0.0f;
+    float maxDepth = 0.0f;
+};
+
+/**
+ * @brief Camera information of a depth/sim map container.
+ * @note Same information as the AliceVision EXR depth/sim map metadata, used to load the cameras from the depth maps.
+ */
+struct DepthSimMapCameraInfo
+{
+    /// downscale factor of the maps from the original image
+    int downscale = 1;
+    /// original image size
+    int imageWidth = 0;
+    int imageHeight = 0;
+    /// projection matrix (4x4) at scale 1 in row-major order, empty if unknown
+    std::vector<double> P;
+};
+
+/**
+ * @brief Write a depth map and its similarity map in a tiled container.
+ * @param[in] path the output file path
+ * @param[in] depthMap the depth map
+ * @param[in] simMap the similarity map, same size as the depth map or empty to store only the depth map
+ * @param[in] cameraInfo the camera information of the maps
+ * @param[in] tileSize the tile width and height
+ * @param[in] nbLevels the maximum number of levels (full resolution included)
+ */
+void writeDepthSimMapContainer(const std::string& path,
+                               const image::Image<float>& depthMap,
+                               const image::Image<float>& simMap,
+                               const DepthSimMapCameraInfo& cameraInfo,
+                               int tileSize = 256,
+                               int nbLevels = 4);
+
+/**
+ * @brief Downscale a depth/sim map by 2, keep the closest valid depth of each 2x2 pixels with its similarity.
+ * @note Used to build the container levels, applying it n times gives the level n of a container.
+ * @param[in] depthMap the depth map
+ * @param[in] simMap the similarity map, can be empty
+ * @param[out] out_depthMap the downscaled depth map
+ * @param[out] out_simMap the downscaled similarity map, empty if simMap is empty
+ */
+void downscaleDepthSimMap(const image::Image<float>& depthMap,
+                          const image::Image<float>& simMap,
+                          image::Image<float>& out_depthMap,
+                          image::Image<float>& out_simMap);
+
+/**
+ * @brief Read access to a tiled depth/sim map container.
+ *
+ * Only the header and the tile index are read at construction,
+ * each read decodes only the tiles of the requested level intersecting the requested region.
+ */
+class DepthSimMapContainer
+{
+public:
+    /**
+     * @brief Open a container and read its tile index.
+     * @param[in] path the container file path
+     */
+    explicit DepthSimMapContainer(const std::string& path);
+
+    inline const std::string& getPath() const { return _path; }
+    inline int getNbLevels() const { return _nbLevels; }
+    inline int getTileSize() const { return _tileSize; }
+    inline bool hasSimMap() const { return _hasSimMap; }
+    inline std::uint64_t getNbDepthValues() const { return _nbDepthValues; }
+    inline float getMinDepth() const { return _minDepth; }
+    inline float getMaxDepth() const { return _maxDepth; }
+    inline const DepthSimMapCameraInfo& getCameraInfo() const { return _cameraInfo; }
+
+    /// @return the map width at the given level
+    int getWidth(int level = 0) const;
+
+    /// @return the map height at the given level
+    int getHeight(int level = 0) const;
+
+    /// @return the number of tile columns at the given level
+    int getNbTilesX(int level = 0) const;
+
+    /// @return the number of tile rows at the given level
+    int getNbTilesY(int level = 0) const;
+
+    /// @return the information of a tile, with its depth range
+    const DepthSimMapTileInfo& getTileInfo(int level, int tileX, int tileY) const;
+
+    /// @return the region of a tile in the level coordinates
+    ROI getTileRoi(int level, int tileX, int tileY) const;
+
+    /**
+     * @brief Get the level to read for a power of two downscale factor.
+     * @param[in] downscale the downscale factor
+     * @return the level, or -1 if the container has no such level
+     */
+    int getLevel(int downscale) const;
+
+    /**
+     * @brief Read the depth map of a region of a level.
+     * @param[out] out_depthMap the depth map of the region
+     * @param[in] level the level
+     * @param[in] roi the region in the level coordinates, empty for the whole level
+     */
+    void readDepthMap(image::Image<float>& out_depthMap, int level = 0, const ROI& roi = ROI()) const;
+
+    /**
+     * @brief Read the similarity map of a region of a level.
+     * @param[out] out_simMap the similarity map of the region
+     * @param[in] level the level
+     * @param[in] roi the region in the level coordinates, empty for the whole level
+     */
+    void readSimMap(image::Image<float>& out_simMap, int level = 0, const ROI& roi = ROI()) const;
+
+    /**
+     * @brief Read the depth map and the similarity map of a region of a level.
+     * @param[out] out_depthMap the depth map of the region
+     * @param[out] out_simMap the similarity map of the region
+     * @param[in] level the level
+     * @param[in] roi the region in the level coordinates, empty for the whole level
+     */
+    void readDepthSimMap(image::Image<float>& out_depthMap,
+                         image::Image<float>& out_simMap,
+                         int level = 0,
+                         const ROI& roi = ROI()) const;
+
+private:
+    void read(image::Image<float>* out_depthMap, image::Image<float>* out_simMap, int level, const ROI& roi) const;
+
+    std::string _path;
+    int _width = 0;
+    int _height = 0;
+    int _tileSize = 0;
+    int _nbLevels = 0;
+    bool _hasSimMap = false;
+    std::uint64_t _nbDepthValues = 0;
+    float _minDepth = 0.0f;
+    float _maxDepth = 0.0f;
+    DepthSimMapCameraInfo _cameraInfo;
+    /// tile index per level
+    std::vector<std::vector<DepthSimMapTileInfo>> _tiles;
+};
+
+} // namespace mvsUtils
+} // namespace aliceVision
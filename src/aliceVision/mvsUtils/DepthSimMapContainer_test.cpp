@@ -0,0 +1,367 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/mvsUtils/DepthSimMapContainer.hpp>
+#include <aliceVision/mvsUtils/depthSimMapIO.hpp>
+#include <aliceVision/mvsUtils/fileIO.hpp>
+#include <aliceVision/mvsUtils/MultiViewParams.hpp>
+#include <aliceVision/camera/Pinhole.hpp>
+#include <aliceVision/sfmData/SfMData.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+
+#define BOOST_TEST_MODULE depthSimMapContainer
+
+#include <boost/test/unit_test.hpp>
+
+using namespace aliceVision;
+using namespace aliceVision::mvsUtils;
+
+namespace {
+
+/// a tilted plane with holes and noise, similarity in [-1;1]
+void generateDepthSimMap(int width, int height, image::Image<float>& depthMap, image::Image<float>& simMap)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> noise(-0.01f, 0.01f);
+    std::uniform_real_distribution<float> similarity(-1.0f, 1.0f);
+
+    depthMap.resize(width, height);
+    simMap.resize(width, height);
+
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            const bool hole = (x > width / 3 && x < width / 2 && y > height / 4);
+            depthMap(y, x) = hole ? -1.0f : 10.0f + 0.01f * x + 0.02f * y + noise(generator);
+            simMap(y, x) = hole ? 1.0f : similarity(generator);
+        }
+    }
+}
+
+bool isSame(const image::Image<float>& a, const image::Image<float>& b)
+{
+    if(a.Width() != b.Width() || a.Height() != b.Height())
+        return false;
+
+    for(int i = 0; i < a.size(); ++i)
+    {
+        if(a(i) != b(i))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(depthSimMapContainer_fullMap)
+{
+    const int width = 301;
+    const int height = 157;
+    image::Image<float> depthMap;
+    image::Image<float> simMap;
+    generateDepthSimMap(width, height, depthMap, simMap);
+
+    const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.avdsm")).string();
+    DepthSimMapCameraInfo cameraInfo;
+    cameraInfo.downscale = 2;
+    cameraInfo.imageWidth = 2 * width;
+    cameraInfo.imageHeight = 2 * height;
+    cameraInfo.P.resize(16);
+    for(int i = 0; i < 16; ++i)
+        cameraInfo.P[i] = 0.5 * i;
+    writeDepthSimMapContainer(path, depthMap, simMap, cameraInfo, 64, 4);
+
+    const DepthSimMapContainer container(path);
+    BOOST_CHECK_EQUAL(container.getWidth(), width);
+    BOOST_CHECK_EQUAL(container.getHeight(), height);
+    BOOST_CHECK_EQUAL(container.getNbLevels(), 4);
+    BOOST_CHECK(container.hasSimMap());
+    BOOST_CHECK_EQUAL(container.getCameraInfo().downscale, cameraInfo.downscale);
+    BOOST_CHECK_EQUAL(container.getCameraInfo().imageWidth, cameraInfo.imageWidth);
+    BOOST_CHECK_EQUAL(container.getCameraInfo().imageHeight, cameraInfo.imageHeight);
+    BOOST_CHECK(container.getCameraInfo().P == cameraInfo.P);
+
+    std::size_t nbDepthValues = 0;
+    for(int i = 0; i < depthMap.size(); ++i)
+        nbDepthValues += (depthMap(i) > 0.0f);
+    BOOST_CHECK_EQUAL(container.getNbDepthValues(), nbDepthValues);
+
+    // lossless full resolution
+    image::Image<float> readDepthMap;
+    image::Image<float> readSimMap;
+    container.readDepthSimMap(readDepthMap, readSimMap);
+    BOOST_CHECK(isSame(depthMap, readDepthMap));
+    BOOST_CHECK(isSame(simMap, readSimMap));
+
+    // levels are the iterative 2x2 downscale
+    image::Image<float> levelDepthMap = depthMap;
+    image::Image<float> levelSimMap = simMap;
+    for(int level = 1; level < container.getNbLevels(); ++level)
+    {
+        image::Image<float> downscaledDepthMap;
+        image::Image<float> downscaledSimMap;
+        downscaleDepthSimMap(levelDepthMap, levelSimMap, downscaledDepthMap, downscaledSimMap);
+        levelDepthMap.swap(downscaledDepthMap);
+        levelSimMap.swap(downscaledSimMap);
+
+        BOOST_CHECK_EQUAL(container.getLevel(1 << level), level);
+        container.readDepthSimMap(readDepthMap, readSimMap, level);
+        BOOST_CHECK(isSame(levelDepthMap, readDepthMap));
+        BOOST_CHECK(isSame(levelSimMap, readSimMap));
+    }
+
+    // region across several tiles
+    const ROI roi(50, 200, 30, 140);
+    container.readDepthMap(readDepthMap, 0, roi);
+    BOOST_REQUIRE_EQUAL(readDepthMap.Width(), roi.width());
+    BOOST_REQUIRE_EQUAL(readDepthMap.Height(), roi.height());
+
+    for(unsigned int y = roi.y.begin; y < roi.y.end; ++y)
+        for(unsigned int x = roi.x.begin; x < roi.x.end; ++x)
+            BOOST_CHECK_EQUAL(readDepthMap(y - roi.y.begin, x - roi.x.begin), depthMap(y, x));
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(depthSimMapContainer_regionRead)
+{
+    const int width = 301;
+    const int height = 157;
+    const int tileSize = 32;
+    image::Image<float> depthMap;
+    image::Image<float> simMap;
+    generateDepthSimMap(width, height, depthMap, simMap);
+
+    const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.avdsm")).string();
+    writeDepthSimMapContainer(path, depthMap, simMap, DepthSimMapCameraInfo(), tileSize, 4);
+
+    // reference maps of the level 2
+    const int level = 2;
+    image::Image<float> levelDepthMap = depthMap;
+    image::Image<float> levelSimMap = simMap;
+    for(int l = 0; l < level; ++l)
+    {
+        image::Image<float> downscaledDepthMap;
+        image::Image<float> downscaledSimMap;
+        downscaleDepthSimMap(levelDepthMap, levelSimMap, downscaledDepthMap, downscaledSimMap);
+        levelDepthMap.swap(downscaledDepthMap);
+        levelSimMap.swap(downscaledSimMap);
+    }
+
+    const ROI roi(20, 50, 10, 30);
+    std::vector<bool> isTileRead;
+
+    {
+        const DepthSimMapContainer container(path);
+        BOOST_REQUIRE_EQUAL(container.getWidth(level), levelDepthMap.Width());
+        BOOST_REQUIRE_EQUAL(container.getHeight(level), levelDepthMap.Height());
+
+        // the tile index stores the depth range of the valid depths of each tile
+        for(int tileY = 0; tileY < container.getNbTilesY(level); ++tileY)
+        {
+            for(int tileX = 0; tileX < container.getNbTilesX(level); ++tileX)
+            {
+                const DepthSimMapTileInfo& tile = container.getTileInfo(level, tileX, tileY);
+                const ROI tileRoi = container.getTileRoi(level, tileX, tileY);
+
+                std::uint32_t nbDepthValues = 0;
+                float minDepth = std::numeric_limits<float>::max();
+                float maxDepth = 0.0f;
+                for(unsigned int y = tileRoi.y.begin; y < tileRoi.y.end; ++y)
+                {
+                    for(unsigned int x = tileRoi.x.begin; x < tileRoi.x.end; ++x)
+                    {
+                        const float depth = levelDepthMap(y, x);
+                        if(depth <= 0.0f)
+                            continue;
+                        ++nbDepthValues;
+                        minDepth = std::min(minDepth, depth);
+                        maxDepth = std::max(maxDepth, depth);
+                    }
+                }
+
+                BOOST_CHECK_EQUAL(tile.nbDepthValues, nbDepthValues);
+                if(nbDepthValues > 0)
+                {
+                    BOOST_CHECK_EQUAL(tile.minDepth, minDepth);
+                    BOOST_CHECK_EQUAL(tile.maxDepth, maxDepth);
+                }
+
+                isTileRead.push_back(!intersect(tileRoi, roi).isEmpty());
+            }
+        }
+    }
+
+    // corrupt the tiles of the level which are not intersecting the region
+    {
+        const DepthSimMapContainer container(path);
+        std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+        std::size_t t = 0;
+        for(int tileY = 0; tileY < container.getNbTilesY(level); ++tileY)
+        {
+            for(int tileX = 0; tileX < container.getNbTilesX(level); ++tileX, ++t)
+            {
+                if(isTileRead.at(t))
+                    continue;
+
+                const DepthSimMapTileInfo& tile = container.getTileInfo(level, tileX, tileY);
+                const std::vector<char> invalidData(tile.depthSize + tile.simSize, char(0xFF));
+                stream.seekp(tile.offset);
+                stream.write(invalidData.data(), invalidData.size());
+            }
+        }
+        BOOST_REQUIRE(stream.good());
+    }
+
+    BOOST_REQUIRE(std::count(isTileRead.begin(), isTileRead.end(), false) > 0);
+
+    // the region read decodes only the intersecting tiles
+    const DepthSimMapContainer container(path);
+    image::Image<float> readDepthMap;
+    image::Image<float> readSimMap;
+    BOOST_CHECK_NO_THROW(container.readDepthSimMap(readDepthMap, readSimMap, level, roi));
+    BOOST_REQUIRE_EQUAL(readDepthMap.Width(), roi.width());
+    BOOST_REQUIRE_EQUAL(readDepthMap.Height(), roi.height());
+
+    for(unsigned int y = roi.y.begin; y < roi.y.end; ++y)
+    {
+        for(unsigned int x = roi.x.begin; x < roi.x.end; ++x)
+        {
+            BOOST_CHECK_EQUAL(readDepthMap(y - roi.y.begin, x - roi.x.begin), levelDepthMap(y, x));
+            BOOST_CHECK_EQUAL(readSimMap(y - roi.y.begin, x - roi.x.begin), levelSimMap(y, x));
+        }
+    }
+
+    // the whole level decodes the corrupted tiles, the other levels are untouched
+    BOOST_CHECK_THROW(container.readDepthMap(readDepthMap, level), std::exception);
+    container.readDepthMap(readDepthMap);
+    BOOST_CHECK(isSame(depthMap, readDepthMap));
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(depthSimMapContainer_depthOnly)
+{
+    image::Image<float> depthMap;
+    image::Image<float> simMap;
+    generateDepthSimMap(40, 30, depthMap, simMap);
+
+    const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.avdsm")).string();
+    writeDepthSimMapContainer(path, depthMap, image::Image<float>(), DepthSimMapCameraInfo(), 16, 8);
+
+    const DepthSimMapContainer container(path);
+    BOOST_CHECK(!container.hasSimMap());
+    BOOST_CHECK(container.getCameraInfo().P.empty());
+    // 40x30 -> 20x15 -> 10x8 -> 5x4 -> 3x2 -> 2x1 -> 1x1
+    BOOST_CHECK_EQUAL(container.getNbLevels(), 7);
+    BOOST_CHECK_EQUAL(container.getLevel(3), -1);
+
+    image::Image<float> readDepthMap;
+    container.readDepthMap(readDepthMap);
+    BOOST_CHECK(isSame(depthMap, readDepthMap));
+
+    image::Image<float> readSimMap;
+    BOOST_CHECK_THROW(container.readSimMap(readSimMap), std::exception);
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(depthSimMapContainer_multiViewParams)
+{
+    const int width = 200;
+    const int height = 150;
+
+    sfmData::SfMData sfmData;
+    sfmData.intrinsics[0] = std::make_shared<camera::Pinhole>(width, height, 180.0, 180.0, 2.0, -3.0);
+    for(int i = 0; i < 2; ++i)
+    {
+        std::shared_ptr<sfmData::View> view = std::make_shared<sfmData::View>("", i, 0, i, width, height);
+        sfmData.views[i] = view;
+        sfmData.setPose(*view, sfmData::CameraPose(geometry::Pose3(Mat3::Identity(), Vec3(0.5 * i, 0.1, -4.0))));
+    }
+
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+
+    // write the depth/sim maps downscaled by 2 in container mode
+    MultiViewParams mpWrite(sfmData, "", folder.string(), "", false);
+    mpWrite.userParams.put("depthSimMap.container", true);
+
+    const int step = 2;
+    image::Image<float> depthMap;
+    image::Image<float> simMap;
+    generateDepthSimMap(width / step, height / step, depthMap, simMap);
+
+    for(int rc = 0; rc < mpWrite.getNbCameras(); ++rc)
+    {
+        writeDepthSimMap(rc, mpWrite, depthMap, simMap, 1, step);
+        BOOST_CHECK(boost::filesystem::exists(getFileNameFromIndex(mpWrite, rc, EFileType::depthSimMapContainer, 1)));
+        BOOST_CHECK(!boost::filesystem::exists(getFileNameFromIndex(mpWrite, rc, EFileType::depthMap, 1)));
+    }
+
+    // the cameras are read back from the containers as from the EXR metadata
+    const MultiViewParams mpRead(sfmData, "", folder.string(), "", true);
+    BOOST_REQUIRE_EQUAL(mpRead.getNbCameras(), mpWrite.getNbCameras());
+
+    for(int rc = 0; rc < mpRead.getNbCameras(); ++rc)
+    {
+        BOOST_CHECK_EQUAL(mpRead.getDownscaleFactor(rc), step);
+        BOOST_CHECK_EQUAL(mpRead.getWidth(rc), depthMap.Width());
+        BOOST_CHECK_EQUAL(mpRead.getHeight(rc), depthMap.Height());
+
+        const std::vector<double> writeP = mpWrite.getOriginalP(rc);
+        const std::vector<double> readP = mpRead.getOriginalP(rc);
+        BOOST_REQUIRE_EQUAL(readP.size(), writeP.size());
+        for(std::size_t i = 0; i < readP.size(); ++i)
+            BOOST_CHECK_SMALL(readP[i] - writeP[i], 1e-9);
+
+        image::Image<float> readDepthMap;
+        image::Image<float> readSimMap;
+        readDepthSimMap(rc, mpRead, readDepthMap, readSimMap);
+        BOOST_CHECK(isSame(depthMap, readDepthMap));
+        BOOST_CHECK(isSame(simMap, readSimMap));
+        BOOST_CHECK_EQUAL(readDepthMap.size(), mpRead.getWidth(rc) * mpRead.getHeight(rc));
+
+        // region of the maps downscaled by 2, read from the container level
+        image::Image<float> downscaledDepthMap;
+        image::Image<float> downscaledSimMap;
+        downscaleDepthSimMap(depthMap, simMap, downscaledDepthMap, downscaledSimMap);
+
+        const ROI roi(5, 30, 3, 20);
+        readDepthSimMap(rc, mpRead, roi, 2, readDepthMap, readSimMap);
+        BOOST_REQUIRE_EQUAL(readDepthMap.Width(), roi.width());
+        BOOST_REQUIRE_EQUAL(readDepthMap.Height(), roi.height());
+        for(unsigned int y = roi.y.begin; y < roi.y.end; ++y)
+        {
+            for(unsigned int x = roi.x.begin; x < roi.x.end; ++x)
+            {
+                BOOST_CHECK_EQUAL(readDepthMap(y - roi.y.begin, x - roi.x.begin), downscaledDepthMap(y, x));
+                BOOST_CHECK_EQUAL(readSimMap(y - roi.y.begin, x - roi.x.begin), downscaledSimMap(y, x));
+            }
+        }
+
+        // one region per tile with valid depths
+        std::vector<DepthMapRegion> regions;
+        getDepthMapRegions(rc, mpRead, 1, regions);
+        BOOST_CHECK(!regions.empty());
+        for(const DepthMapRegion& region : regions)
+        {
+            BOOST_CHECK(!region.roi.isEmpty());
+            BOOST_CHECK(region.nbDepthValues > 0);
+            BOOST_CHECK(region.minDepth > 0.0f && region.minDepth <= region.maxDepth);
+        }
+    }
+
+    boost::filesystem::remove_all(folder);
+}
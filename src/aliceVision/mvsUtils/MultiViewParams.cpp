@@ -5,6 +5,7 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "MultiViewParams.hpp"
+#include <aliceVision/mvsUtils/DepthSimMapContainer.hpp>
 #include <aliceVision/sfmData/SfMData.hpp>
 #include <aliceVision/system/Logger.hpp>
 #include <aliceVision/image/io.hpp>
@@ -70,6 +71,11 @@ MultiViewParams::MultiViewParams(const sfmData::SfMData& sfmData,
               // use output of DepthMap if scale==1
               const int scale = (depthMapsFolder.empty() ? 0 : 1);
               path = getFileNameFromViewId(*this, view.getViewId(), mvsUtils::EFileType::depthMap, scale);
+
+              // depth/sim map container, written instead of the depth map
+              const std::string containerPath = getFileNameFromViewId(*this, view.getViewId(), mvsUtils::EFileType::depthSimMapContainer, scale);
+              if(!fs::exists(path) && fs::exists(containerPath))
+                  path = containerPath;
           }
           else if(_imagesFolder != "/" && !_imagesFolder.empty() && fs::is_directory(_imagesFolder) && !fs::is_empty(_imagesFolder))
           {
@@ -122,7 +128,18 @@ MultiViewParams::MultiViewParams(const sfmData::SfMData& sfmData,
         oiio::ParamValueList::const_iterator pIt = metadata.end();
         
         const bool fileExists = fs::exists(imgParams.path);
-        if(fileExists)
+        const bool isContainer = fileExists && (fs::path(imgParams.path).extension() == ".avdsm");
+        DepthSimMapCameraInfo containerCameraInfo;
+
+        if(isContainer)
+        {
+            // depth/sim map container camera information, same as the EXR metadata
+            containerCameraInfo = DepthSimMapContainer(imgParams.path).getCameraInfo();
+
+            if(containerCameraInfo.imageWidth != imgParams.width || containerCameraInfo.imageHeight != imgParams.height)
+                throw std::runtime_error("Image size of file: '" + imgParams.path + "' does not match the view image size.");
+        }
+        else if(fileExists)
         {
             metadata = image::readImageMetadata(imgParams.path);
             scaleIt = metadata.find("AliceVision:downscale");
@@ -130,7 +147,12 @@ MultiViewParams::MultiViewParams(const sfmData::SfMData& sfmData,
         }
 
         // find image scale information
-        if(scaleIt != metadata.end() && scaleIt->type() == oiio::TypeDesc::INT)
+        if(isContainer)
+        {
+            // use depth/sim map container camera information
+            _imagesScale.at(i) = containerCameraInfo.downscale;
+        }
+        else if(scaleIt != metadata.end() && scaleIt->type() == oiio::TypeDesc::INT)
         {
             // use aliceVision image metadata
             _imagesScale.at(i) = scaleIt->get_int();
@@ -156,7 +178,12 @@ MultiViewParams::MultiViewParams(const sfmData::SfMData& sfmData,
         FocK1K2Arr.at(i) = Point3d(-1.0, -1.0, -1.0);
 
         // load camera matrices
-        if(pIt != metadata.end() && pIt->type() == oiio::TypeDesc(oiio::TypeDesc::DOUBLE, oiio::TypeDesc::MATRIX44))
+        if(!containerCameraInfo.P.empty())
+        {
+            ALICEVISION_LOG_DEBUG("Reading view " << getViewId(i) << " projection matrix from depth/sim map container.");
+            loadMatricesFromRawProjectionMatrix(i, containerCameraInfo.P.data());
+        }
+        else if(pIt != metadata.end() && pIt->type() == oiio::TypeDesc(oiio::TypeDesc::DOUBLE, oiio::TypeDesc::MATRIX44))
         {
             ALICEVISION_LOG_DEBUG("Reading view " << getViewId(i) << " projection matrix from image metadata.");
             loadMatricesFromRawProjectionMatrix(i, static_cast<const double*>(pIt->data()));
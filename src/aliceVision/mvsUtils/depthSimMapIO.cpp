@@ -7,6 +7,7 @@
 #include "depthSimMapIO.hpp"
 
 #include <aliceVision/mvsData/Point2d.hpp>
+#include <aliceVision/mvsUtils/DepthSimMapContainer.hpp>
 #include <aliceVision/mvsUtils/fileIO.hpp>
 #include <aliceVision/numeric/numeric.hpp>
 #include <aliceVision/image/io.hpp>
@@ -14,6 +15,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 
+#include <limits>
+
 namespace fs = boost::filesystem;
 
 namespace aliceVision {
@@ -113,6 +116,77 @@ void getTilePathList(int rc,
   }
 }
 
+/**
+ * @brief Get the depth/sim map container path for a R camera if it exists
+ * @param[in] rc the related R camera index
+ * @param[in] mp the multi-view parameters
+ * @param[in] scale the depth/sim map downscale factor
+ * @param[in] customSuffix the filename custom suffix
+ * @return the container path or an empty string if there is no container
+ */
+std::string getExistingContainerPath(int rc, const MultiViewParams& mp, int scale, const std::string& customSuffix)
+{
+    const std::string containerPath = getFileNameFromIndex(mp, rc, EFileType::depthSimMapContainer, scale, customSuffix);
+    return fs::exists(containerPath) ? containerPath : std::string();
+}
+
+/**
+ * @brief Downscale full depth/sim maps as the depth/sim map container levels, then crop them
+ * @param[in,out] inout_depthMap the full depth map, replaced by the region of the downscaled depth map
+ * @param[in,out] inout_simMap the full similarity map (can be empty), replaced by the region of the downscaled similarity map
+ * @param[in] roi the 2d region of interest in the downscaled maps, empty for the whole maps
+ * @param[in] downscale the power of two downscale factor
+ */
+void downscaleAndCropDepthSimMap(image::Image<float>& inout_depthMap,
+                                 image::Image<float>& inout_simMap,
+                                 const ROI& roi,
+                                 int downscale)
+{
+    for(int d = downscale; d > 1; d /= 2)
+    {
+        image::Image<float> levelDepthMap;
+        image::Image<float> levelSimMap;
+        downscaleDepthSimMap(inout_depthMap, inout_simMap, levelDepthMap, levelSimMap);
+        inout_depthMap.swap(levelDepthMap);
+        inout_simMap.swap(levelSimMap);
+    }
+
+    if(roi.isEmpty())
+        return;
+
+    if(roi.x.end > unsigned(inout_depthMap.Width()) || roi.y.end > unsigned(inout_depthMap.Height()))
+        ALICEVISION_THROW_ERROR("Region out of the depth/sim map (downscale: " << downscale << ").");
+
+    const bool hasSimMap = (inout_simMap.size() > 0);
+    image::Image<float> depthMap(roi.width(), roi.height());
+    image::Image<float> simMap;
+    if(hasSimMap)
+        simMap.resize(roi.width(), roi.height());
+
+    for(unsigned int y = roi.y.begin; y < roi.y.end; ++y)
+    {
+        for(unsigned int x = roi.x.begin; x < roi.x.end; ++x)
+        {
+            depthMap(y - roi.y.begin, x - roi.x.begin) = inout_depthMap(y, x);
+            if(hasSimMap)
+                simMap(y - roi.y.begin, x - roi.x.begin) = inout_simMap(y, x);
+        }
+    }
+
+    inout_depthMap.swap(depthMap);
+    inout_simMap.swap(simMap);
+}
+
+/**
+ * @brief Check a depth/sim map downscale factor
+ * @param[in] downscale the downscale factor, should be a power of two
+ */
+void checkDepthSimMapDownscale(int downscale)
+{
+    if(downscale <= 0 || (downscale & (downscale - 1)) != 0)
+        ALICEVISION_THROW_ERROR("Invalid depth/sim map downscale factor: " << downscale << ", should be a power of two.");
+}
+
 /**
  * @brief Weight one of the corners/edges of a tile according to the size of the padding
  *
@@ -355,11 +429,36 @@ void writeDepthSimMap(int rc,
     const oiio::ROI displayRoi(0, imageWidth, 0, imageHeight);
     const oiio::ROI pixelRoi(downscaledROI.x.begin, downscaledROI.x.end, downscaledROI.y.begin, downscaledROI.y.end, 0, 1, 0, 1);
 
+    const bool isTile = (downscaledROI.width() != imageWidth || downscaledROI.height() != imageHeight);
+
+    // full size maps in a single tiled container, with the camera information of the EXR metadata
+    if(!isTile)
+    {
+        const std::string containerPath = getFileNameFromIndex(mp, rc, EFileType::depthSimMapContainer, scale, customSuffix);
+
+        if(depthMap.size() > 0 && mp.userParams.get<bool>("depthSimMap.container", false))
+        {
+            // same camera information as the EXR metadata
+            DepthSimMapCameraInfo cameraInfo;
+            cameraInfo.downscale = mp.getDownscaleFactor(rc) * scaleStep;
+            cameraInfo.imageWidth = mp.getOriginalWidth(rc);
+            cameraInfo.imageHeight = mp.getOriginalHeight(rc);
+            cameraInfo.P = mp.getOriginalP(rc);
+
+            writeDepthSimMapContainer(containerPath, depthMap, simMap, cameraInfo);
+            return;
+        }
+
+        // the readers use the container first, remove a previous one
+        if(fs::exists(containerPath))
+            fs::remove(containerPath);
+    }
+
     // output map path
     std::string depthMapPath;
     std::string simMapPath;
 
-    if(downscaledROI.width() != imageWidth || downscaledROI.height() != imageHeight) // is a tile
+    if(isTile)
     {
         // tiled depth/sim map
         depthMapPath = getFileNameFromIndex(mp, rc, EFileType::depthMap, scale, customSuffix, roi.x.begin, roi.y.begin);
@@ -505,6 +604,19 @@ void readDepthSimMap(int rc,
                      int step, 
                      const std::string& customSuffix)
 {
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    if(!containerPath.empty())
+    {
+        const DepthSimMapContainer container(containerPath);
+
+        if(container.hasSimMap())
+        {
+            container.readDepthSimMap(out_depthMap, out_simMap);
+            return;
+        }
+    }
+
     const std::string depthMapPath = getFileNameFromIndex(mp, rc,EFileType::depthMap, scale, customSuffix);
     const std::string simMapPath = getFileNameFromIndex(mp, rc, EFileType::simMap, scale, customSuffix);
 
@@ -527,6 +639,14 @@ void readDepthMap(int rc,
                   int step,
                   const std::string& customSuffix)
 {
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    if(!containerPath.empty())
+    {
+        DepthSimMapContainer(containerPath).readDepthMap(out_depthMap);
+        return;
+    }
+
     const std::string depthMapPath = getFileNameFromIndex(mp, rc, EFileType::depthMap, scale, customSuffix);
         
     if (fs::exists(depthMapPath))
@@ -546,6 +666,19 @@ void readSimMap(int rc,
                 int step, 
                 const std::string& customSuffix)
 {
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    if(!containerPath.empty())
+    {
+        const DepthSimMapContainer container(containerPath);
+
+        if(container.hasSimMap())
+        {
+            container.readSimMap(out_simMap);
+            return;
+        }
+    }
+
     const std::string simMapPath = getFileNameFromIndex(mp, rc, EFileType::simMap, scale, customSuffix);
 
     if (fs::exists(simMapPath))
@@ -558,12 +691,133 @@ void readSimMap(int rc,
     }
 }
 
+void readDepthSimMap(int rc,
+                     const MultiViewParams& mp,
+                     const ROI& roi,
+                     int downscale,
+                     image::Image<float>& out_depthMap,
+                     image::Image<float>& out_simMap,
+                     int scale,
+                     int step,
+                     const std::string& customSuffix)
+{
+    checkDepthSimMapDownscale(downscale);
+
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    if(!containerPath.empty())
+    {
+        const DepthSimMapContainer container(containerPath);
+        const int level = container.getLevel(downscale);
+
+        // only the tiles of the level intersecting the roi are decoded
+        if(container.hasSimMap() && level >= 0)
+        {
+            container.readDepthSimMap(out_depthMap, out_simMap, level, roi);
+            return;
+        }
+    }
+
+    // no suitable container: read the full maps, then downscale and crop them as the container levels
+    readDepthSimMap(rc, mp, out_depthMap, out_simMap, scale, step, customSuffix);
+    downscaleAndCropDepthSimMap(out_depthMap, out_simMap, roi, downscale);
+}
+
+void readDepthMap(int rc,
+                  const MultiViewParams& mp,
+                  const ROI& roi,
+                  int downscale,
+                  image::Image<float>& out_depthMap,
+                  int scale,
+                  int step,
+                  const std::string& customSuffix)
+{
+    checkDepthSimMapDownscale(downscale);
+
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    if(!containerPath.empty())
+    {
+        const DepthSimMapContainer container(containerPath);
+        const int level = container.getLevel(downscale);
+
+        // only the tiles of the level intersecting the roi are decoded
+        if(level >= 0)
+        {
+            container.readDepthMap(out_depthMap, level, roi);
+            return;
+        }
+    }
+
+    // no suitable container: read the full map, then downscale and crop it as the container levels
+    image::Image<float> simMap; // empty, the closest depths are kept without similarity
+    readDepthMap(rc, mp, out_depthMap, scale, step, customSuffix);
+    downscaleAndCropDepthSimMap(out_depthMap, simMap, roi, downscale);
+}
+
+void getDepthMapRegions(int rc,
+                        const MultiViewParams& mp,
+                        int downscale,
+                        std::vector<DepthMapRegion>& out_regions,
+                        int scale,
+                        int step,
+                        const std::string& customSuffix)
+{
+    checkDepthSimMapDownscale(downscale);
+
+    out_regions.clear();
+
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    if(!containerPath.empty())
+    {
+        const DepthSimMapContainer container(containerPath);
+        const int level = container.getLevel(downscale);
+
+        // one region per tile with valid depths, from the tile index
+        if(level >= 0)
+        {
+            for(int tileY = 0; tileY < container.getNbTilesY(level); ++tileY)
+            {
+                for(int tileX = 0; tileX < container.getNbTilesX(level); ++tileX)
+                {
+                    const DepthSimMapTileInfo& tile = container.getTileInfo(level, tileX, tileY);
+
+                    if(tile.nbDepthValues == 0)
+                        continue;
+
+                    DepthMapRegion region;
+                    region.roi = container.getTileRoi(level, tileX, tileY);
+                    region.nbDepthValues = tile.nbDepthValues;
+                    region.minDepth = tile.minDepth;
+                    region.maxDepth = tile.maxDepth;
+                    out_regions.push_back(region);
+                }
+            }
+            return;
+        }
+    }
+
+    // no tile index: a single region covering the whole map, without reading it
+    DepthMapRegion region;
+    region.nbDepthValues = 0; // unknown
+    region.minDepth = 0.0f;
+    region.maxDepth = std::numeric_limits<float>::max();
+    out_regions.push_back(region);
+}
+
 unsigned long getNbDepthValuesFromDepthMap(int rc, 
                                            const MultiViewParams& mp,
                                            int scale,
                                            int step,
                                            const std::string& customSuffix)
 {
+    const std::string containerPath = getExistingContainerPath(rc, mp, scale, customSuffix);
+
+    // get nbDepthValues from the container header
+    if(!containerPath.empty())
+        return DepthSimMapContainer(containerPath).getNbDepthValues();
+
     const std::string depthMapPath = getFileNameFromIndex(mp, rc, EFileType::depthMap, scale, customSuffix);
     int nbDepthValues = -1;
 
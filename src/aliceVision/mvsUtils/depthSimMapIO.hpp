@@ -11,10 +11,25 @@
 #include <aliceVision/image/Image.hpp>
 
 #include <string>
+#include <vector>
 
 namespace aliceVision {
 namespace mvsUtils {
 
+/**
+ * @brief A region of a depth map with valid depths, with its depth range
+ */
+struct DepthMapRegion
+{
+    /// region in the downscaled depth map, empty for the whole map
+    ROI roi;
+    /// number of valid depths in the region, 0 if unknown
+    std::size_t nbDepthValues = 0;
+    /// depth range of the valid depths of the region
+    float minDepth = 0.0f;
+    float maxDepth = 0.0f;
+};
+
 /**
  * @brief Add a tile to a full map with weighting
  * @param[in] rc the related R camera index
@@ -35,6 +50,8 @@ void addTileMapWeighted(int rc,
 
 /**
  * @brief Write the depth map and the similarity map
+ * @note Full size maps are written in a single depth/sim map container (see DepthSimMapContainer)
+ *       if the "depthSimMap.container" user parameter is enabled.
  * @param[in] rc the related R camera index
  * @param[in] mp the multi-view parameters
  * @param[in] tileParams tile workflow parameters
@@ -107,6 +124,73 @@ void readDepthSimMap(int rc,
                      int step = 1,
                      const std::string& customSuffix = "");
 
+/**
+ * @brief read a region of the downscaled depth map and similarity map
+ * @note With a depth/sim map container, only the tiles of the corresponding level intersecting the roi are read.
+ *       Otherwise the full maps are read and downscaled the same way.
+ * @param[in] rc the related R camera index
+ * @param[in] mp the multi-view parameters
+ * @param[in] roi the 2d region of interest in the downscaled map, empty for the whole map
+ * @param[in] downscale the power of two downscale factor applied to the maps
+ * @param[out] out_depthMap the corresponding depth map region
+ * @param[out] out_simMap the corresponding similarity map region
+ * @param[in] scale the depth/sim map downscale factor
+ * @param[in] step the depth/sim map step factor
+ * @param[in] customSuffix the filename custom suffix
+ */
+void readDepthSimMap(int rc,
+                     const MultiViewParams& mp,
+                     const ROI& roi,
+                     int downscale,
+                     image::Image<float>& out_depthMap,
+                     image::Image<float>& out_simMap,
+                     int scale = 1,
+                     int step = 1,
+                     const std::string& customSuffix = "");
+
+/**
+ * @brief read a region of the downscaled depth map
+ * @note With a depth/sim map container, only the tiles of the corresponding level intersecting the roi are read.
+ *       Otherwise the full map is read and downscaled the same way.
+ * @param[in] rc the related R camera index
+ * @param[in] mp the multi-view parameters
+ * @param[in] roi the 2d region of interest in the downscaled map, empty for the whole map
+ * @param[in] downscale the power of two downscale factor applied to the map
+ * @param[out] out_depthMap the corresponding depth map region
+ * @param[in] scale the depth/sim map downscale factor
+ * @param[in] step the depth/sim map step factor
+ * @param[in] customSuffix the filename custom suffix
+ */
+void readDepthMap(int rc,
+                  const MultiViewParams& mp,
+                  const ROI& roi,
+                  int downscale,
+                  image::Image<float>& out_depthMap,
+                  int scale = 1,
+                  int step = 1,
+                  const std::string& customSuffix = "");
+
+/**
+ * @brief Get the regions of the downscaled depth map with valid depths, with their depth range
+ * @note With a depth/sim map container, one region per tile with valid depths is given from the tile index,
+ *       without decoding any tile. Otherwise a single region covering the whole map, with an unknown number
+ *       of valid depths and depth range.
+ * @param[in] rc the related R camera index
+ * @param[in] mp the multi-view parameters
+ * @param[in] downscale the power of two downscale factor applied to the map
+ * @param[out] out_regions the depth map regions, to read with readDepthMap / readDepthSimMap
+ * @param[in] scale the depth/sim map downscale factor
+ * @param[in] step the depth/sim map step factor
+ * @param[in] customSuffix the filename custom suffix
+ */
+void getDepthMapRegions(int rc,
+                        const MultiViewParams& mp,
+                        int downscale,
+                        std::vector<DepthMapRegion>& out_regions,
+                        int scale = 1,
+                        int step = 1,
+                        const std::string& customSuffix = "");
+
 /**
  * @brief read the depth map from file(s)
  * @param[in] rc the related R camera index
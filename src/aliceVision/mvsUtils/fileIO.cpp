@@ -222,6 +222,16 @@ std::string getFileNameFromViewId(const MultiViewParams& mp, int viewId, EFileTy
           ext = "exr";
           break;
       }
+      case EFileType::depthSimMapContainer:
+      {
+          if(scale == 0)
+              folder = mp.getDepthMapsFilterFolder();
+          else
+              folder = mp.getDepthMapsFolder();
+          suffix = "_depthSimMap";
+          ext = "avdsm";
+          break;
+      }
       case EFileType::normalMap:
       {
           folder = mp.getDepthMapsFilterFolder();
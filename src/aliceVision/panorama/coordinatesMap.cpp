@@ -19,6 +19,9 @@ bool CoordinatesMap::build(const std::pair<int, int>& panoramaSize, const geomet
     int min_x = std::numeric_limits<int>::max();
     int min_y = std::numeric_limits<int>::max();
 
+    Mat3X rays(3, coarseBbox.width);
+    Mat2X pixels;
+
     for(int y = 0; y < coarseBbox.height; y++)
     {
 
@@ -30,26 +33,31 @@ bool CoordinatesMap::build(const std::pair<int, int>& panoramaSize, const geomet
 
         for(int x = 0; x < coarseBbox.width; x++)
         {
-
             int cx = x + coarseBbox.left;
+            rays.col(x) = SphericalMapping::fromEquirectangular(Vec2(cx, cy), panoramaSize.first, panoramaSize.second);
+        }
+
+        /**
+         * Project all the rays of the row to camera pixel coordinates
+         */
+        intrinsics.projectPoints(pose, rays, pixels, true);
+        const Mat3X transformedRays = pose(rays);
+
+        for(int x = 0; x < coarseBbox.width; x++)
+        {
 
-            Vec3 ray = SphericalMapping::fromEquirectangular(Vec2(cx, cy), panoramaSize.first, panoramaSize.second);
+            int cx = x + coarseBbox.left;
 
             /**
              * Check that this ray should be visible.
              * This test is camera type dependent
              */
-            Vec3 transformedRay = pose(ray);
-            if(!intrinsics.isVisibleRay(transformedRay))
+            if(!intrinsics.isVisibleRay(transformedRays.col(x)))
             {
                 continue;
             }
 
-            /**
-             * Project this ray to camera pixel coordinates
-             */
-            const Vec2 pix_disto_d = intrinsics.project(pose, ray.homogeneous(), true);
-            const Vec2f pix_disto = pix_disto_d.cast<float>();
+            const Vec2f pix_disto = pixels.col(x).cast<float>();
 
             /**
              * Ignore invalid coordinates
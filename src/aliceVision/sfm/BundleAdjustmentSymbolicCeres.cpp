@@ -9,7 +9,7 @@
 #include <aliceVision/sfmData/SfMData.hpp>
 #include <aliceVision/alicevision_omp.hpp>
 #include <aliceVision/config.hpp>
-#include <aliceVision/camera/Equidistant.hpp>
+#include <aliceVision/camera/camera.hpp>
 #include <aliceVision/utils/CeresUtils.hpp>
 
 #include <boost/filesystem.hpp>
@@ -17,6 +17,7 @@
 #include <ceres/rotation.h>
 
 #include <fstream>
+#include <type_traits>
 
 
 namespace fs = boost::filesystem;
@@ -270,6 +271,296 @@ private:
   bool _withRig;
 };
 
+/**
+ * @brief Pinhole projection of a camera space point on the camera plane.
+ */
+struct PinholeProjection
+{
+  /**
+   * @param[in] camera the camera intrinsics
+   * @param[in] X the point in the camera space
+   * @param[out] d_P_d_X the derivative of the projection wrt the point
+   * @param[out] d_P_d_focal the derivative of the projection wrt the horizontal focal
+   * @return the point on the camera plane, before distortion
+   */
+  static inline Vec2 project(const IntrinsicsScaleOffsetDisto& /*camera*/, const Vec3& X,
+                             Eigen::Matrix<double, 2, 3>& d_P_d_X, Vec2& d_P_d_focal)
+  {
+    d_P_d_X << 1.0 / X(2), 0.0, - X(0) / (X(2) * X(2)),
+               0.0, 1.0 / X(2), - X(1) / (X(2) * X(2));
+    d_P_d_focal.setZero();
+
+    return X.head<2>() / X(2);
+  }
+
+  /**
+   * @param[in] camera the camera intrinsics
+   * @param[in] focal the camera focal
+   * @return the scale from the camera plane to the image plane (the focal)
+   */
+  static inline Vec2 getImageScale(const IntrinsicsScaleOffsetDisto& /*camera*/, const Vec2& focal)
+  {
+    return focal;
+  }
+
+  /**
+   * @param[in] distorted the distorted point on the camera plane
+   * @return the derivative of the image point wrt the focal, at a constant point on the camera plane
+   */
+  static inline Eigen::Matrix2d getDerivativeImageScaleWrtFocal(const Vec2& distorted)
+  {
+    return distorted.asDiagonal();
+  }
+};
+
+/**
+ * @brief Equidistant projection of a camera space point on the camera plane (radius = focal * angle).
+ */
+struct EquidistantProjection
+{
+  /// @see PinholeProjection::project
+  static inline Vec2 project(const IntrinsicsScaleOffsetDisto& camera, const Vec3& X,
+                             Eigen::Matrix<double, 2, 3>& d_P_d_X, Vec2& d_P_d_focal)
+  {
+    const double rsensor = std::min(camera.sensorWidth(), camera.sensorHeight());
+    const double rscale = camera.sensorWidth() / std::max(camera.w(), camera.h());
+    const double focal = camera.getScale()(0);
+    const double fov = rsensor / (focal * rscale);
+
+    // angle with the optical axis and radial angle
+    const double len2d2 = X(0) * X(0) + X(1) * X(1);
+    const double len2d = std::sqrt(len2d2);
+    const double angle_Z = std::atan2(len2d, X(2));
+    const double angle_radial = std::atan2(X(1), X(0));
+
+    const double radius = angle_Z / (0.5 * fov);
+    const double d_radius_d_angle_Z = 1.0 / (0.5 * fov);
+    const double cosRadial = std::cos(angle_radial);
+    const double sinRadial = std::sin(angle_radial);
+
+    Eigen::Matrix<double, 2, 3> d_angles_d_X;
+    const double d_angle_Z_d_len2d = X(2) / (len2d2 + X(2) * X(2));
+    d_angles_d_X << - X(1) / len2d2, X(0) / len2d2, 0.0,
+                    d_angle_Z_d_len2d * X(0) / len2d, d_angle_Z_d_len2d * X(1) / len2d, - len2d / (len2d2 + X(2) * X(2));
+
+    Eigen::Matrix2d d_P_d_angles;
+    d_P_d_angles << - sinRadial * radius, cosRadial * d_radius_d_angle_Z,
+                    cosRadial * radius, sinRadial * d_radius_d_angle_Z;
+
+    d_P_d_X = d_P_d_angles * d_angles_d_X;
+
+    const Vec2 P(cosRadial * radius, sinRadial * radius);
+    // the radius is proportional to the focal
+    d_P_d_focal = P / focal;
+
+    return P;
+  }
+
+  /// @see PinholeProjection::getImageScale, the image circle radius for the equidistant cameras
+  static inline Vec2 getImageScale(const IntrinsicsScaleOffsetDisto& camera, const Vec2& /*focal*/)
+  {
+    return Vec2::Constant(static_cast<const EquiDistant&>(camera).getCircleRadius());
+  }
+
+  /// @see PinholeProjection::getDerivativeImageScaleWrtFocal, the image circle radius does not depend on the focal
+  static inline Eigen::Matrix2d getDerivativeImageScaleWrtFocal(const Vec2& /*distorted*/)
+  {
+    return Eigen::Matrix2d::Zero();
+  }
+};
+
+/// Camera model without distortion
+struct NoDistortion {};
+
+/**
+ * @brief Projection cost function specialized for a given camera model.
+ *
+ * The projection, the distortion model and the intrinsics block size are known at compile time:
+ * the projection is inlined, the distortion calls are resolved statically, the camera space point and
+ * the distortion derivatives are computed once for all the Jacobians, which have fixed sizes,
+ * and the intrinsics are updated in place without any temporary allocation.
+ *
+ * @tparam ProjectionT the projection on the camera plane (PinholeProjection or EquidistantProjection)
+ * @tparam DistortionT the concrete distortion model, NoDistortion if none
+ * @tparam IntrinsicsSize the number of intrinsics parameters (scale, offset and distortion)
+ */
+template <typename ProjectionT, typename DistortionT, int IntrinsicsSize>
+class CostProjectionSpecialized : public ceres::SizedCostFunction<2, 16, 16, IntrinsicsSize, 3> {
+public:
+  static constexpr bool HasDistortion = !std::is_same<DistortionT, NoDistortion>::value;
+  static constexpr int DistortionSize = IntrinsicsSize - 4;
+
+  CostProjectionSpecialized(const sfmData::Observation& measured, const std::shared_ptr<IntrinsicsScaleOffsetDisto> & intrinsics, DistortionT* distortion)
+    : _measured(measured)
+    , _intrinsics(intrinsics)
+    , _distortion(distortion)
+  {
+    assert(_intrinsics->getParamsSize() == IntrinsicsSize);
+    assert(!HasDistortion || _distortion != nullptr);
+  }
+
+  bool Evaluate(double const * const * parameters, double * residuals, double ** jacobians) const override
+  {
+    const double * parameter_pose = parameters[0];
+    const double * parameter_rig = parameters[1];
+    const double * parameter_intrinsics = parameters[2];
+    const double * parameter_landmark = parameters[3];
+
+    const Eigen::Map<const SE3::Matrix> rTo(parameter_pose);
+    const Eigen::Map<const SE3::Matrix> cTr(parameter_rig);
+    const Eigen::Map<const Vec3> pt(parameter_landmark);
+
+    // update intrinsics object with estimated parameters
+    const Vec2 focal(parameter_intrinsics[0], parameter_intrinsics[1]);
+    _intrinsics->setScale(focal);
+    _intrinsics->setOffset(Vec2(parameter_intrinsics[2], parameter_intrinsics[3]));
+    if constexpr (HasDistortion)
+    {
+      std::copy(parameter_intrinsics + 4, parameter_intrinsics + IntrinsicsSize, _distortion->getParameters().begin());
+    }
+
+    const SE3::Matrix T = cTr * rTo;
+    const Vec4 pth = pt.homogeneous();
+    const Vec3 X = T.block<3, 4>(0, 0) * pth;
+
+    // projection on the camera plane, distortion and conversion to pixels
+    Eigen::Matrix<double, 2, 3> d_P_d_X;
+    Vec2 d_P_d_focal;
+    const Vec2 P = ProjectionT::project(*_intrinsics, X, d_P_d_X, d_P_d_focal);
+
+    Vec2 distorted = P;
+    if constexpr (HasDistortion)
+    {
+      distorted = _distortion->DistortionT::addDistortion(P);
+    }
+
+    const Vec2 imageScale = ProjectionT::getImageScale(*_intrinsics, focal);
+    const Vec2 pt_est = distorted.cwiseProduct(imageScale) + _intrinsics->getPrincipalPoint();
+    const double scale = (_measured.scale > 1e-12) ? _measured.scale : 1.0;
+
+    residuals[0] = (pt_est(0) - _measured.x(0)) / scale;
+    residuals[1] = (pt_est(1) - _measured.x(1)) / scale;
+
+    if (jacobians == nullptr) {
+      return true;
+    }
+
+    const double invScale = 1.0 / scale;
+
+    // derivative of the residual wrt the point on the camera plane
+    Eigen::Matrix2d d_res_d_P = invScale * imageScale.asDiagonal();
+    if constexpr (HasDistortion)
+    {
+      d_res_d_P = d_res_d_P * _distortion->DistortionT::getDerivativeAddDistoWrtPt(P);
+    }
+    const Eigen::Matrix<double, 2, 3> d_res_d_X = d_res_d_P * d_P_d_X;
+
+    if (jacobians[0] != nullptr || jacobians[1] != nullptr) {
+      const Eigen::Matrix<double, 2, 16> d_res_d_T = d_res_d_X * getJacobian_AB_wrt_A<4, 4, 1>(T, pth).template block<3, 16>(0, 0);
+
+      if (jacobians[0] != nullptr) {
+        Eigen::Map<Eigen::Matrix<double, 2, 16, Eigen::RowMajor>> J(jacobians[0]);
+
+        J = d_res_d_T * getJacobian_AB_wrt_B<4, 4, 4>(cTr, rTo) * getJacobian_AB_wrt_A<4, 4, 4>(Eigen::Matrix4d::Identity(), rTo);
+      }
+
+      if (jacobians[1] != nullptr) {
+        Eigen::Map<Eigen::Matrix<double, 2, 16, Eigen::RowMajor>> J(jacobians[1]);
+
+        J = d_res_d_T * getJacobian_AB_wrt_A<4, 4, 4>(cTr, rTo) * getJacobian_AB_wrt_A<4, 4, 4>(Eigen::Matrix4d::Identity(), cTr);
+      }
+    }
+
+    if (jacobians[2] != nullptr) {
+      Eigen::Map<Eigen::Matrix<double, 2, IntrinsicsSize, Eigen::RowMajor>> J(jacobians[2]);
+
+      // scale, the horizontal focal may also change the projection on the camera plane
+      J.template block<2, 2>(0, 0) = invScale * ProjectionT::getDerivativeImageScaleWrtFocal(distorted);
+      J.col(0) += d_res_d_P * d_P_d_focal;
+
+      // principal point
+      J.template block<2, 2>(0, 2) = invScale * Eigen::Matrix2d::Identity();
+
+      if constexpr (HasDistortion)
+      {
+        J.template rightCols<DistortionSize>() = invScale * imageScale.asDiagonal() * _distortion->DistortionT::getDerivativeAddDistoWrtDisto(P);
+      }
+    }
+
+    if (jacobians[3] != nullptr) {
+      Eigen::Map<Eigen::Matrix<double, 2, 3, Eigen::RowMajor>> J(jacobians[3]);
+
+      J = d_res_d_X * T.block<3, 3>(0, 0);
+    }
+
+    return true;
+  }
+
+private:
+  const sfmData::Observation & _measured;
+  const std::shared_ptr<IntrinsicsScaleOffsetDisto> _intrinsics;
+  DistortionT* const _distortion;
+};
+
+template <typename ProjectionT, typename DistortionT, int IntrinsicsSize>
+ceres::CostFunction* createCostProjectionSpecialized(const sfmData::Observation& measured, const std::shared_ptr<camera::IntrinsicBase> & intrinsics, bool withRig)
+{
+  const std::shared_ptr<IntrinsicsScaleOffsetDisto> camera = std::dynamic_pointer_cast<IntrinsicsScaleOffsetDisto>(intrinsics);
+
+  // the intrinsic may be a subclass with a different number of parameters
+  if (camera == nullptr || camera->getParamsSize() != IntrinsicsSize)
+  {
+    return new CostProjection(measured, intrinsics, withRig);
+  }
+
+  DistortionT* distortion = nullptr;
+  if constexpr (!std::is_same<DistortionT, NoDistortion>::value)
+  {
+    distortion = dynamic_cast<DistortionT*>(camera->getDistortion().get());
+  }
+  if ((distortion == nullptr) != (camera->getDistortion() == nullptr))
+  {
+    return new CostProjection(measured, intrinsics, withRig);
+  }
+
+  return new CostProjectionSpecialized<ProjectionT, DistortionT, IntrinsicsSize>(measured, camera, distortion);
+}
+
+ceres::CostFunction* createCostProjection(const sfmData::Observation& measured, const std::shared_ptr<camera::IntrinsicBase> & intrinsics, bool withRig, bool specialized)
+{
+  if (!specialized)
+  {
+    return new CostProjection(measured, intrinsics, withRig);
+  }
+
+  switch(intrinsics->getType())
+  {
+    case EINTRINSIC::PINHOLE_CAMERA:
+      return createCostProjectionSpecialized<PinholeProjection, NoDistortion, 4>(measured, intrinsics, withRig);
+    case EINTRINSIC::PINHOLE_CAMERA_RADIAL1:
+      return createCostProjectionSpecialized<PinholeProjection, DistortionRadialK1, 5>(measured, intrinsics, withRig);
+    case EINTRINSIC::PINHOLE_CAMERA_RADIAL3:
+      return createCostProjectionSpecialized<PinholeProjection, DistortionRadialK3, 7>(measured, intrinsics, withRig);
+    case EINTRINSIC::PINHOLE_CAMERA_3DERADIAL4:
+      return createCostProjectionSpecialized<PinholeProjection, Distortion3DERadial4, 10>(measured, intrinsics, withRig);
+    case EINTRINSIC::PINHOLE_CAMERA_3DEANAMORPHIC4:
+      return createCostProjectionSpecialized<PinholeProjection, Distortion3DEAnamorphic4, 8>(measured, intrinsics, withRig);
+    case EINTRINSIC::PINHOLE_CAMERA_3DECLASSICLD:
+      return createCostProjectionSpecialized<PinholeProjection, Distortion3DEClassicLD, 9>(measured, intrinsics, withRig);
+    case EINTRINSIC::PINHOLE_CAMERA_FISHEYE:
+      return createCostProjectionSpecialized<PinholeProjection, DistortionFisheye, 8>(measured, intrinsics, withRig);
+    case EINTRINSIC::EQUIDISTANT_CAMERA:
+      return createCostProjectionSpecialized<EquidistantProjection, NoDistortion, 4>(measured, intrinsics, withRig);
+    case EINTRINSIC::EQUIDISTANT_CAMERA_RADIAL3:
+      return createCostProjectionSpecialized<EquidistantProjection, DistortionRadialK3PT, 7>(measured, intrinsics, withRig);
+    // no analytic distortion derivatives for these models
+    case EINTRINSIC::PINHOLE_CAMERA_BROWN:
+    case EINTRINSIC::PINHOLE_CAMERA_FISHEYE1:
+    default:
+      return new CostProjection(measured, intrinsics, withRig);
+  }
+}
+
 void BundleAdjustmentSymbolicCeres::addPose(const sfmData::CameraPose& cameraPose, bool isConstant, SE3::Matrix & poseBlock, ceres::Problem& problem, bool refineTranslation, bool refineRotation)
 {
   const Mat3& R = cameraPose.getTransform().rotation();
@@ -753,7 +1044,7 @@ void BundleAdjustmentSymbolicCeres::addLandmarksToProblem(const sfmData::SfMData
         _linearSolverOrdering.AddElementToGroup(intrinsicBlockPtr, 2);
       }
 
-      ceres::CostFunction* costFunction = new CostProjection(observation, intrinsic, withRig);
+      ceres::CostFunction* costFunction = createCostProjection(observation, intrinsic, withRig);
       problem.AddResidualBlock(costFunction, lossFunction, poseBlockPtr, rigBlockPtr, intrinsicBlockPtr, landmarkBlockPtr);
 
       if(!refineStructure || getLandmarkState(landmarkId) == EParameterState::CONSTANT)
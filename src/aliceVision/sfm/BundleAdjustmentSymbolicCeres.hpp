@@ -13,6 +13,8 @@
 #include <aliceVision/sfm/LocalBundleAdjustmentGraph.hpp>
 #include <aliceVision/numeric/numeric.hpp>
 #include <aliceVision/sfmData/CameraPose.hpp>
+#include <aliceVision/sfmData/Landmark.hpp>
+#include <aliceVision/camera/IntrinsicBase.hpp>
 
 #include <ceres/ceres.h>
 #include "liealgebra.hpp"
@@ -303,5 +305,16 @@ private:
   ceres::ParameterBlockOrdering _linearSolverOrdering;
 };
 
+/**
+ * @brief Create the projection cost function of an observation for the symbolic bundle adjustment.
+ * @param[in] measured the 2D observation, must outlive the cost function
+ * @param[in] intrinsics the camera intrinsics of the observation, updated by the cost function evaluation
+ * @param[in] withRig true if the view is part of a rig
+ * @param[in] specialized use a cost function specialized for the camera model if available, the generic one otherwise
+ * @return the cost function with the parameter blocks: pose (16), rig (16), intrinsics and landmark (3)
+ */
+ceres::CostFunction* createCostProjection(const sfmData::Observation& measured, const std::shared_ptr<camera::IntrinsicBase>& intrinsics,
+                                          bool withRig, bool specialized = true);
+
 } // namespace sfm
 } // namespace aliceVision
@@ -7,6 +7,7 @@
 
 #include <aliceVision/sfm/FrustumFilter.hpp>
 #include <aliceVision/sfm/sfm.hpp>
+#include <aliceVision/sfm/sfmFilters.hpp>
 #include <aliceVision/sfmData/SfMData.hpp>
 #include <aliceVision/system/ProgressDisplay.hpp>
 #include <aliceVision/stl/mapUtils.hpp>
@@ -14,6 +15,7 @@
 #include <aliceVision/geometry/HalfPlane.hpp>
 #include <aliceVision/config.hpp>
 
+#include <algorithm>
 #include <fstream>
 
 namespace aliceVision {
@@ -171,35 +173,45 @@ void FrustumFilter::init_z_near_z_far_depth(const sfmData::SfMData& sfmData, con
   const bool bComputed_Z = (zNear == -1. && zFar == -1.) && !sfmData.structure.empty();
   if(bComputed_Z)  // Compute the near & far planes from the structure and view observations
   {
-    for(sfmData::Landmarks::const_iterator itL = sfmData.getLandmarks().begin();
-      itL != sfmData.getLandmarks().end(); ++itL)
+    std::vector<const sfmData::Landmark*> landmarks;
+    landmarks.reserve(sfmData.getLandmarks().size());
+    for(const auto& landmarkPair : sfmData.getLandmarks())
+      landmarks.push_back(&landmarkPair.second);
+
+    std::vector<IndexT> viewIds;
+    for(const auto& viewPair : sfmData.getViews())
     {
-      const sfmData::Landmark & landmark = itL->second;
-      const Vec3 & X = landmark.X;
-      for(sfmData::Observations::const_iterator iterO = landmark.observations.begin();
-        iterO != landmark.observations.end(); ++iterO)
-      {
-        const IndexT id_view = iterO->first;
-        const sfmData::Observation & ob = iterO->second;
-        const sfmData::View * view = sfmData.getViews().at(id_view).get();
-        if (!sfmData.isPoseAndIntrinsicDefined(view))
-          continue;
-
-        sfmData::Intrinsics::const_iterator iterIntrinsic = sfmData.getIntrinsics().find(view->getIntrinsicId());
-        const Pose3 pose = sfmData.getPose(*view).getTransform();
-        const double z = pose.depth(X);
-        NearFarPlanesT::iterator itZ = z_near_z_far_perView.find(id_view);
-        if (itZ != z_near_z_far_perView.end())
-        {
-          if ( z < itZ->second.first)
-            itZ->second.first = z;
-          else
-          if ( z > itZ->second.second)
-            itZ->second.second = z;
-        }
-        else
-          z_near_z_far_perView[id_view] = std::make_pair(z,z);
-      }
+      if(sfmData.isPoseAndIntrinsicDefined(viewPair.second.get()))
+        viewIds.push_back(viewPair.first);
+    }
+    std::sort(viewIds.begin(), viewIds.end());
+
+    // gather the observations per view, to compute the depths by batch with the view pose
+    ObservationsPerView observationsPerView;
+    getObservationsPerView(landmarks, viewIds, observationsPerView);
+
+    std::vector<std::pair<double, double>> nearFarPerView(viewIds.size());
+    #pragma omp parallel for schedule(dynamic)
+    for(int v = 0; v < viewIds.size(); ++v)
+    {
+      const std::size_t begin = observationsPerView.offsets[v];
+      const std::size_t nbObservations = observationsPerView.offsets[v + 1] - begin;
+      if(nbObservations == 0)
+        continue;
+
+      Mat3X pts3D(3, nbObservations);
+      for(std::size_t j = 0; j < nbObservations; ++j)
+        pts3D.col(j) = landmarks[observationsPerView.landmarkIndexes[begin + j]]->X;
+
+      const Pose3 pose = sfmData.getPose(sfmData.getView(viewIds[v])).getTransform();
+      const Eigen::RowVectorXd depths = (pose.rotation().row(2) * (pts3D.colwise() - pose.center()));
+      nearFarPerView[v] = std::make_pair(depths.minCoeff(), depths.maxCoeff());
+    }
+
+    for(std::size_t v = 0; v < viewIds.size(); ++v)
+    {
+      if(observationsPerView.offsets[v + 1] > observationsPerView.offsets[v])
+        z_near_z_far_perView[viewIds[v]] = nearFarPerView[v];
     }
   }
   else
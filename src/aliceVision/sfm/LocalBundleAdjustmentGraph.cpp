@@ -229,9 +229,10 @@ BundleAdjustment::EParameterState LocalBundleAdjustmentGraph::getStateFromDistan
   return BundleAdjustment::EParameterState::IGNORED;
 }
 
-void LocalBundleAdjustmentGraph::updateGraphWithNewViews(
+template <typename TracksPerViewT>
+void LocalBundleAdjustmentGraph::addNewViewsToGraph(
     const sfmData::SfMData& sfmData,
-    const track::TracksPerView& map_tracksPerView,
+    const TracksPerViewT& tracksPerView,
     const std::set<IndexT>& newReconstructedViews,
     const std::size_t minNbOfMatches)
 {
@@ -291,7 +292,7 @@ void LocalBundleAdjustmentGraph::updateGraphWithNewViews(
     // each new view need to be connected to the graph
     // we create the 'minNbOfEdgesPerView' best edges and all the other with more than 'minNbOfMatches' shared landmarks
     const std::size_t minNbOfEdgesPerView = 10;
-    std::vector<Pair> newEdges = getNewEdges(sfmData, map_tracksPerView, addedViewsId, minNbOfMatches, minNbOfEdgesPerView);
+    std::vector<Pair> newEdges = getNewEdges(sfmData, tracksPerView, addedViewsId, minNbOfMatches, minNbOfEdgesPerView);
     numAddedEdges = newEdges.size();
 
     for(const Pair& edge: newEdges)
@@ -304,6 +305,24 @@ void LocalBundleAdjustmentGraph::updateGraphWithNewViews(
   ALICEVISION_LOG_DEBUG("It contains " << _graph.maxNodeId() + 1 << " nodes & " << _graph.maxEdgeId() + 1 << " edges");
 }
 
+void LocalBundleAdjustmentGraph::updateGraphWithNewViews(
+    const sfmData::SfMData& sfmData,
+    const track::TracksPerView& map_tracksPerView,
+    const std::set<IndexT>& newReconstructedViews,
+    const std::size_t minNbOfMatches)
+{
+  addNewViewsToGraph(sfmData, map_tracksPerView, newReconstructedViews, minNbOfMatches);
+}
+
+void LocalBundleAdjustmentGraph::updateGraphWithNewViews(
+    const sfmData::SfMData& sfmData,
+    const track::TracksStore& tracksStore,
+    const std::set<IndexT>& newReconstructedViews,
+    const std::size_t minNbOfMatches)
+{
+  addNewViewsToGraph(sfmData, tracksStore, newReconstructedViews, minNbOfMatches);
+}
+
 void LocalBundleAdjustmentGraph::computeGraphDistances(const sfmData::SfMData& sfmData, const std::set<IndexT>& newReconstructedViews)
 { 
   ALICEVISION_LOG_DEBUG("Computing graph-distances...");
@@ -433,9 +452,16 @@ void LocalBundleAdjustmentGraph::convertDistancesToStates(const sfmData::SfMData
   }
 }
 
-std::vector<Pair> LocalBundleAdjustmentGraph::getNewEdges(
+namespace {
+
+/**
+ * @brief Count the number of shared landmarks between the new views and each already resected cameras.
+ * @param[in] viewTrackIds returns the range of the sorted ids of the tracks visible in a view
+ */
+template <typename ViewTrackIds>
+std::vector<Pair> getNewEdgesFromViewTracks(
     const sfmData::SfMData& sfmData,
-    const track::TracksPerView& tracksPerView,
+    ViewTrackIds viewTrackIds,
     const std::set<IndexT>& newViewsId,
     const std::size_t minNbOfMatches,
     const std::size_t minNbOfEdgesPerView)
@@ -454,13 +480,13 @@ std::vector<Pair> LocalBundleAdjustmentGraph::getNewEdges(
     std::map<IndexT, std::size_t> sharedLandmarksPerView;
 
     // get all the tracks of the new added view
-    const aliceVision::track::TrackIdSet& newViewTrackIds = tracksPerView.at(viewId);
+    const auto newViewTrackIds = viewTrackIds(viewId);
     
     // keep the reconstructed tracks (with an associated landmark)
     std::vector<IndexT> newViewLandmarks; // all landmarks (already reconstructed) visible from the new view
     
-    newViewLandmarks.reserve(newViewTrackIds.size());
-    std::set_intersection(newViewTrackIds.begin(), newViewTrackIds.end(),
+    newViewLandmarks.reserve(std::distance(newViewTrackIds.first, newViewTrackIds.second));
+    std::set_intersection(newViewTrackIds.first, newViewTrackIds.second,
                           landmarkIds.begin(), landmarkIds.end(),
                           std::back_inserter(newViewLandmarks));
     
@@ -506,6 +532,36 @@ std::vector<Pair> LocalBundleAdjustmentGraph::getNewEdges(
   return newEdges;
 }
 
+} // namespace
+
+std::vector<Pair> LocalBundleAdjustmentGraph::getNewEdges(
+    const sfmData::SfMData& sfmData,
+    const track::TracksPerView& tracksPerView,
+    const std::set<IndexT>& newViewsId,
+    const std::size_t minNbOfMatches,
+    const std::size_t minNbOfEdgesPerView)
+{
+  const auto viewTrackIds = [&](IndexT viewId) {
+    const track::TrackIdSet& trackIds = tracksPerView.at(viewId);
+    return std::make_pair(trackIds.begin(), trackIds.end());
+  };
+  return getNewEdgesFromViewTracks(sfmData, viewTrackIds, newViewsId, minNbOfMatches, minNbOfEdgesPerView);
+}
+
+std::vector<Pair> LocalBundleAdjustmentGraph::getNewEdges(
+    const sfmData::SfMData& sfmData,
+    const track::TracksStore& tracksStore,
+    const std::set<IndexT>& newViewsId,
+    const std::size_t minNbOfMatches,
+    const std::size_t minNbOfEdgesPerView)
+{
+  const auto viewTrackIds = [&](IndexT viewId) {
+    const IndexT* trackIds = tracksStore.viewTrackIds(viewId);
+    return std::make_pair(trackIds, trackIds + tracksStore.viewNbTracks(viewId));
+  };
+  return getNewEdgesFromViewTracks(sfmData, viewTrackIds, newViewsId, minNbOfMatches, minNbOfEdgesPerView);
+}
+
 void LocalBundleAdjustmentGraph::checkFocalLengthsConsistency(const std::size_t windowSize, const double stdevPercentageLimit)
 {
   ALICEVISION_LOG_DEBUG("Checking, for each camera, if the focal length is stable...");
@@ -8,6 +8,7 @@
 
 #include <aliceVision/types.hpp>
 #include <aliceVision/track/TracksBuilder.hpp>
+#include <aliceVision/track/TracksStore.hpp>
 #include <aliceVision/sfm/BundleAdjustment.hpp>
 
 #include <lemon/list_graph.h>
@@ -167,6 +168,18 @@ public:
       const track::TracksPerView& map_tracksPerView, 
       const std::set<IndexT>& newImageIndex,
       const std::size_t kMinNbOfMatches = 50);
+
+  /**
+   * @brief Complete the graph with the newly resected views or all the posed views if the graph is empty.
+   * @param[in] sfmData contains all the information about the reconstruction
+   * @param[in] tracksStore All the tracks, with the per-view index
+   * @param[in] newReconstructedViews The list of the newly resected views
+   * @param[in] kMinNbOfMatches The min. number of shared matches to create an edge between two views (nodes)
+   */
+  void updateGraphWithNewViews(const sfmData::SfMData& sfmData,
+      const track::TracksStore& tracksStore,
+      const std::set<IndexT>& newImageIndex,
+      const std::size_t kMinNbOfMatches = 50);
   
   /**
    * @brief Compute the intragraph-distance between all the nodes of the graph (posed views) and the newly resected views.
@@ -279,6 +292,29 @@ private:
       const std::set<IndexT>& newViewsId,
       const std::size_t minNbOfMatches,
       const std::size_t minNbOfEdgesPerView);
+
+  /**
+   * @brief Count the number of shared landmarks between all the new views and each already resected cameras.
+   * @param[in] sfmData contains all the information about the reconstruction
+   * @param[in] tracksStore All the tracks, with the per-view index
+   * @param[in] newViewsId A set with the views index that we want to count matches with resected cameras.
+   * @return A map giving the number of matches for each images pair.
+   */
+  static std::vector<Pair> getNewEdges(const sfmData::SfMData& sfmData,
+      const track::TracksStore& tracksStore,
+      const std::set<IndexT>& newViewsId,
+      const std::size_t minNbOfMatches,
+      const std::size_t minNbOfEdgesPerView);
+
+  /**
+   * @brief Add the new views and their edges to the graph.
+   * @param[in] tracksPerView The tracks visible in each view (TracksPerView or TracksStore)
+   */
+  template <typename TracksPerViewT>
+  void addNewViewsToGraph(const sfmData::SfMData& sfmData,
+      const TracksPerViewT& tracksPerView,
+      const std::set<IndexT>& newReconstructedViews,
+      const std::size_t minNbOfMatches);
   
   /**
    * @brief Return the state of the focal length (constant or not) for a specific intrinsic.
@@ -6,12 +6,15 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include <aliceVision/sfm/sfm.hpp>
+#include <aliceVision/sfm/BundleAdjustmentSymbolicCeres.hpp>
 #include <aliceVision/camera/cameraCommon.hpp>
 #include <aliceVision/multiview/NViewDataSet.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <iostream>
+#include <memory>
 
 #define BOOST_TEST_MODULE bundleAdjustment
 
@@ -137,6 +140,176 @@ BOOST_AUTO_TEST_CASE(BUNDLE_ADJUSTMENT_EffectiveMinimization_PinholeFisheye)
   BOOST_CHECK_LT(dResidual_after, dResidual_before);
 }
 
+BOOST_AUTO_TEST_CASE(BUNDLE_ADJUSTMENT_SYMBOLIC_EffectiveMinimization_Pinhole)
+{
+  const int nviews = 3;
+  const int npoints = 6;
+  const NViewDatasetConfigurator config;
+  const NViewDataSet d = NRealisticCamerasRing(nviews, npoints, config);
+
+  // Translate the input dataset to a SfMData scene
+  SfMData sfmData = getInputScene(d, config, EINTRINSIC::PINHOLE_CAMERA);
+
+  const double dResidual_before = RMSE(sfmData);
+
+  // Call the symbolic BA (cost function specialized for the camera model)
+  std::shared_ptr<BundleAdjustment> ba_object = std::make_shared<BundleAdjustmentSymbolicCeres>();
+  BOOST_CHECK( ba_object->adjust(sfmData) );
+
+  const double dResidual_after = RMSE(sfmData);
+  BOOST_CHECK_LT(dResidual_after, dResidual_before);
+}
+
+BOOST_AUTO_TEST_CASE(BUNDLE_ADJUSTMENT_SYMBOLIC_EffectiveMinimization_PinholeRadialK3)
+{
+  const int nviews = 3;
+  const int npoints = 6;
+  const NViewDatasetConfigurator config;
+  const NViewDataSet d = NRealisticCamerasRing(nviews, npoints, config);
+
+  // Translate the input dataset to a SfMData scene
+  SfMData sfmData = getInputScene(d, config, EINTRINSIC::PINHOLE_CAMERA_RADIAL3);
+
+  const double dResidual_before = RMSE(sfmData);
+
+  // Call the symbolic BA (cost function specialized for the camera model)
+  std::shared_ptr<BundleAdjustment> ba_object = std::make_shared<BundleAdjustmentSymbolicCeres>();
+  BOOST_CHECK( ba_object->adjust(sfmData) );
+
+  const double dResidual_after = RMSE(sfmData);
+  BOOST_CHECK_LT(dResidual_after, dResidual_before);
+}
+
+/**
+ * @brief Evaluate a projection cost function of the symbolic bundle adjustment.
+ * @param[in] costFunction the cost function
+ * @param[in] parameterBlocks the pose, rig, intrinsics and landmark parameters
+ * @param[out] residuals the residuals
+ * @param[out] jacobians the row major Jacobian per parameter block, an empty block is not evaluated
+ */
+void evaluateCostProjection(const ceres::CostFunction& costFunction, const std::vector<std::vector<double>>& parameterBlocks,
+                            Vec2& residuals, std::vector<std::vector<double>>& jacobians)
+{
+  std::vector<const double*> parameters;
+  std::vector<double*> jacobiansPtr;
+  for (std::size_t i = 0; i < parameterBlocks.size(); ++i)
+  {
+    parameters.push_back(parameterBlocks[i].data());
+    jacobiansPtr.push_back(jacobians[i].empty() ? nullptr : jacobians[i].data());
+  }
+  BOOST_REQUIRE(costFunction.Evaluate(parameters.data(), residuals.data(), jacobiansPtr.data()));
+}
+
+// Test summary:
+// - For each camera model, create the cost function specialized for the camera model and the generic one
+// - Check that they give the same residuals and Jacobians
+// - The generic intrinsics Jacobian is not implemented for the equidistant models: check it with finite differences
+BOOST_AUTO_TEST_CASE(BUNDLE_ADJUSTMENT_SYMBOLIC_CostProjectionSpecialized)
+{
+  const std::vector<EINTRINSIC> intrinsicTypes = {
+    EINTRINSIC::PINHOLE_CAMERA,
+    EINTRINSIC::PINHOLE_CAMERA_RADIAL1,
+    EINTRINSIC::PINHOLE_CAMERA_RADIAL3,
+    EINTRINSIC::PINHOLE_CAMERA_3DERADIAL4,
+    EINTRINSIC::PINHOLE_CAMERA_3DEANAMORPHIC4,
+    EINTRINSIC::PINHOLE_CAMERA_3DECLASSICLD,
+    EINTRINSIC::PINHOLE_CAMERA_FISHEYE,
+    EINTRINSIC::EQUIDISTANT_CAMERA,
+    EINTRINSIC::EQUIDISTANT_CAMERA_RADIAL3
+  };
+
+  // observation with a scale, to check the residuals normalization
+  const Observation observation(Vec2(540.0, 370.0), 0, 2.0);
+
+  // pose and rig with rotations, the landmark is in front of the camera, off the optical axis
+  SE3::Matrix pose = SE3::Matrix::Identity();
+  pose.block<3, 3>(0, 0) = RotationAroundY(0.1) * RotationAroundX(-0.05);
+  pose.block<3, 1>(0, 3) = Vec3(0.2, -0.1, 3.0);
+  SE3::Matrix rig = SE3::Matrix::Identity();
+  rig.block<3, 3>(0, 0) = RotationAroundZ(0.2);
+  rig.block<3, 1>(0, 3) = Vec3(-0.05, 0.1, 0.02);
+  const Vec3 landmark(0.4, -0.3, 1.0);
+
+  const auto isClose = [](double a, double b, double tolerance) { return std::abs(a - b) <= tolerance * std::max(1.0, std::abs(b)); };
+
+  for (const EINTRINSIC intrinsicType : intrinsicTypes)
+  {
+    BOOST_TEST_CONTEXT("Intrinsic " << EINTRINSIC_enumToString(intrinsicType))
+    {
+      std::shared_ptr<IntrinsicBase> intrinsic = createIntrinsic(intrinsicType, 1000, 800, 900.0, 905.0, 3.0, -2.0);
+      std::vector<double> params = intrinsic->getParams();
+      for (std::size_t i = 4; i < params.size(); ++i)
+        params[i] += ((i % 2) ? -0.01 : 0.02) / double(i - 3);
+      intrinsic->updateFromParams(params);
+      params = intrinsic->getParams();
+
+      std::shared_ptr<IntrinsicBase> intrinsicGeneric(intrinsic->clone());
+
+      const std::vector<std::vector<double>> parameterBlocks = {
+        std::vector<double>(pose.data(), pose.data() + 16),
+        std::vector<double>(rig.data(), rig.data() + 16),
+        params,
+        std::vector<double>(landmark.data(), landmark.data() + 3)
+      };
+
+      const bool equidistant = isEquidistant(intrinsicType);
+
+      std::unique_ptr<ceres::CostFunction> costSpecialized(createCostProjection(observation, intrinsic, true));
+      std::unique_ptr<ceres::CostFunction> costGeneric(createCostProjection(observation, intrinsicGeneric, true, false));
+
+      Vec2 residualsSpecialized;
+      std::vector<std::vector<double>> jacobiansSpecialized = {
+        std::vector<double>(2 * 16), std::vector<double>(2 * 16), std::vector<double>(2 * params.size()), std::vector<double>(2 * 3)};
+      evaluateCostProjection(*costSpecialized, parameterBlocks, residualsSpecialized, jacobiansSpecialized);
+
+      Vec2 residualsGeneric;
+      std::vector<std::vector<double>> jacobiansGeneric = {
+        std::vector<double>(2 * 16), std::vector<double>(2 * 16), std::vector<double>(equidistant ? 0 : 2 * params.size()), std::vector<double>(2 * 3)};
+      evaluateCostProjection(*costGeneric, parameterBlocks, residualsGeneric, jacobiansGeneric);
+
+      BOOST_CHECK_SMALL(residualsSpecialized(0) - residualsGeneric(0), 1e-9);
+      BOOST_CHECK_SMALL(residualsSpecialized(1) - residualsGeneric(1), 1e-9);
+
+      for (std::size_t block = 0; block < parameterBlocks.size(); ++block)
+      {
+        if (jacobiansGeneric[block].empty())
+          continue;
+
+        int nbDifferences = 0;
+        for (std::size_t i = 0; i < jacobiansSpecialized[block].size(); ++i)
+          nbDifferences += !isClose(jacobiansSpecialized[block][i], jacobiansGeneric[block][i], 1e-8);
+        BOOST_CHECK_MESSAGE(nbDifferences == 0, "Parameter block " << block << ": " << nbDifferences << " different Jacobian values.");
+      }
+
+      if (!equidistant)
+        continue;
+
+      // intrinsics Jacobian with central finite differences
+      int nbDifferences = 0;
+      for (std::size_t p = 0; p < params.size(); ++p)
+      {
+        const double step = 1e-6 * std::max(1.0, std::abs(params[p]));
+        std::vector<std::vector<double>> noJacobians(parameterBlocks.size());
+
+        std::vector<std::vector<double>> parametersPlus = parameterBlocks;
+        parametersPlus[2][p] += step;
+        Vec2 residualsPlus;
+        evaluateCostProjection(*costSpecialized, parametersPlus, residualsPlus, noJacobians);
+
+        std::vector<std::vector<double>> parametersMinus = parameterBlocks;
+        parametersMinus[2][p] -= step;
+        Vec2 residualsMinus;
+        evaluateCostProjection(*costSpecialized, parametersMinus, residualsMinus, noJacobians);
+
+        const Vec2 derivative = (residualsPlus - residualsMinus) / (2.0 * step);
+        for (int r = 0; r < 2; ++r)
+          nbDifferences += !isClose(jacobiansSpecialized[2][r * params.size() + p], derivative(r), 1e-5);
+      }
+      BOOST_CHECK_EQUAL(nbDifferences, 0);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(LOCAL_BUNDLE_ADJUSTMENT_EffectiveMinimization_Pinhole_CamerasRing)
 {
   const int nviews = 4;
@@ -24,13 +24,14 @@ IndexT getRigPoseId(IndexT rigId, IndexT frameId)
   return static_cast<IndexT>(rigPoseId);
 }
 
-double computeCameraScore(const SfMData& sfmData, const track::TracksPerView& tracksPerView, IndexT viewId)
+double computeCameraScore(const SfMData& sfmData, const track::TracksStore& tracksStore, IndexT viewId)
 {
   std::set<std::size_t> viewLandmarks;
   {
     // A. Compute 2D/3D matches
     // A1. list tracks ids used by the view
-    const aliceVision::track::TrackIdSet& tracksIds = tracksPerView.at(static_cast<std::size_t>(viewId));
+    const IndexT* tracksIds = tracksStore.viewTrackIds(viewId);
+    const IndexT* tracksIdsEnd = tracksIds + tracksStore.viewNbTracks(viewId);
 
     // A2. intersects the track list with the reconstructed
     std::set<std::size_t> reconstructedTrackId;
@@ -39,7 +40,7 @@ double computeCameraScore(const SfMData& sfmData, const track::TracksPerView& tr
                    stl::RetrieveKey());
 
     // Get the ids of the already reconstructed tracks
-    std::set_intersection(tracksIds.begin(), tracksIds.end(),
+    std::set_intersection(tracksIds, tracksIdsEnd,
                           reconstructedTrackId.begin(),
                           reconstructedTrackId.end(),
                           std::inserter(viewLandmarks, viewLandmarks.begin()));
@@ -75,7 +76,7 @@ double computeCameraScore(const SfMData& sfmData, const track::TracksPerView& tr
 }
 
 
-void RigSequence::init(const track::TracksPerView& tracksPerView)
+void RigSequence::init(const track::TracksStore& tracksStore)
 {
   for(const auto& viewPair : _sfmData.getViews())
   {
@@ -88,7 +89,7 @@ void RigSequence::init(const track::TracksPerView& tracksPerView)
       // compute pose score, sum of inverse reprojection errors
       if(_sfmData.isPoseAndIntrinsicDefined(view.getViewId()))
       {
-        score = computeCameraScore(_sfmData, tracksPerView, view.getViewId());
+        score = computeCameraScore(_sfmData, tracksStore, view.getViewId());
 
         // add one to the number of poses for this rig relative sub-pose
         _rigInfoPerSubPose[view.getSubPoseId()].nbPose++;
@@ -8,6 +8,7 @@
 
 #include <aliceVision/sfmData/SfMData.hpp>
 #include <aliceVision/track/TracksBuilder.hpp>
+#include <aliceVision/track/TracksStore.hpp>
 
 namespace aliceVision {
 namespace sfm {
@@ -33,8 +34,9 @@ public:
   /**
    * @brief RigSequence initialization
    * build internal structures
+   * @param[in] tracksStore all the tracks, with the per-view index
    */
-  void init(const track::TracksPerView& tracksPerView);
+  void init(const track::TracksStore& tracksStore);
 
   /**
    * @brief Calibrate new possible rigs or update independent poses to rig poses
@@ -31,38 +31,59 @@ std::unique_ptr<feature::Regions> loadRegions(const std::vector<std::string>& fo
 
   std::string featFilename;
   std::string descFilename;
+  std::string regionsFilename;
 
   for(const std::string& folder : folders)
   {
     const fs::path featPath = fs::path(folder) / std::string(basename + "." + imageDescriberTypeName + ".feat");
     const fs::path descPath = fs::path(folder) / std::string(basename + "." + imageDescriberTypeName + ".desc");
+    const fs::path regionsPath = fs::path(folder) / std::string(basename + "." + imageDescriberTypeName + feature::REGIONS_FILE_EXTENSION);
 
-    if(fs::exists(featPath) && fs::exists(descPath))
+    // the binary regions container is preferred over the .feat/.desc files
+    if(fs::exists(regionsPath))
+    {
+      regionsFilename = regionsPath.string();
+      featFilename.clear();
+      descFilename.clear();
+    }
+    else if(fs::exists(featPath) && fs::exists(descPath))
     {
       featFilename = featPath.string();
       descFilename = descPath.string();
+      regionsFilename.clear();
     }
   }
 
-  if(featFilename.empty() || descFilename.empty())
+  if(regionsFilename.empty() && (featFilename.empty() || descFilename.empty()))
     throw std::runtime_error("Can't find view " + basename + " region files");
 
   ALICEVISION_LOG_TRACE("Features filename: "    << featFilename);
   ALICEVISION_LOG_TRACE("Descriptors filename: " << descFilename);
+  ALICEVISION_LOG_TRACE("Regions filename: "     << regionsFilename);
 
   std::unique_ptr<feature::Regions> regionsPtr;
   imageDescriber.allocate(regionsPtr);
 
   try
   {
-    regionsPtr->Load(featFilename, descFilename);
+    if(!regionsFilename.empty())
+      regionsPtr->LoadContainer(regionsFilename);
+    else
+      regionsPtr->Load(featFilename, descFilename);
   }
   catch(const std::exception& e)
   {
     std::stringstream ss;
     ss << "Invalid " << imageDescriberTypeName << " regions files for the view " << basename << " : \n";
-    ss << "\t- Features file : " << featFilename << "\n";
-    ss << "\t- Descriptors file: " << descFilename << "\n";
+    if(!regionsFilename.empty())
+    {
+      ss << "\t- Regions file : " << regionsFilename << "\n";
+    }
+    else
+    {
+      ss << "\t- Features file : " << featFilename << "\n";
+      ss << "\t- Descriptors file: " << descFilename << "\n";
+    }
     ss << "\t  " << e.what() << "\n";
     ALICEVISION_LOG_ERROR(ss.str());
 
@@ -94,11 +115,24 @@ std::unique_ptr<feature::Regions> loadFeatures(const std::vector<std::string>& f
     }
   }
 
+  bool isRegionsContainer = false;
+
   for(const auto& folder : foldersSet)
   {
     const fs::path featPath = fs::path(folder) / std::string(basename + "." + imageDescriberTypeName + ".feat");
-    if(fs::exists(featPath))
+    const fs::path regionsPath = fs::path(folder) / std::string(basename + "." + imageDescriberTypeName + feature::REGIONS_FILE_EXTENSION);
+
+    // the binary regions container is preferred over the .feat file
+    if(fs::exists(regionsPath))
+    {
+      featFilename = regionsPath.string();
+      isRegionsContainer = true;
+    }
+    else if(fs::exists(featPath))
+    {
       featFilename = featPath.string();
+      isRegionsContainer = false;
+    }
   }
 
   if(featFilename.empty())
@@ -111,7 +145,16 @@ std::unique_ptr<feature::Regions> loadFeatures(const std::vector<std::string>& f
 
   try
   {
-    regionsPtr->LoadFeatures(featFilename);
+    if(isRegionsContainer)
+    {
+      // descriptors pages of the mapping are never touched
+      regionsPtr->LoadContainer(featFilename);
+      regionsPtr->clearDescriptors();
+    }
+    else
+    {
+      regionsPtr->LoadFeatures(featFilename);
+    }
   }
   catch(const std::exception& e)
   {
@@ -6,6 +6,7 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include <aliceVision/sfm/pipeline/sequential/ReconstructionEngine_sequentialSfM.hpp>
+#include <aliceVision/alicevision_omp.hpp>
 #include <aliceVision/sfm/pipeline/RelativePoseInfo.hpp>
 #include <aliceVision/sfm/utils/statistics.hpp>
 #include <aliceVision/sfmDataIO/sfmDataIO.hpp>
@@ -40,6 +41,8 @@
 #include <tuple>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #ifdef _MSC_VER
 #pragma warning( once : 4267 ) //warning C4267: 'argument' : conversion from 'size_t' to 'const int', possible loss of data
@@ -58,8 +61,7 @@ using namespace aliceVision::sfmData;
  * @brief Compute indexes of all features in a fixed size pyramid grid.
  * These precomputed values are useful to the next best view selection for incremental SfM.
  *
- * @param[in] tracksPerView: The list of TrackID per view
- * @param[in] map_tracks: All putative tracks
+ * @param[in] tracksStore: All putative tracks, with the per-view index
  * @param[in] views: All views
  * @param[in] featuresProvider: Input features and descriptors
  * @param[in] pyramidDepth: Depth of the pyramid.
@@ -67,8 +69,7 @@ using namespace aliceVision::sfmData;
  *             Precomputed list of pyramid cells ID for each track in each view.
  */
 void computeTracksPyramidPerView(
-    const track::TracksPerView& tracksPerView,
-    const track::TracksMap& map_tracks,
+    const track::TracksStore& tracksStore,
     const Views& views,
     const feature::FeaturesPerView& featuresProvider,
     const std::size_t pyramidBase,
@@ -85,17 +86,16 @@ void computeTracksPyramidPerView(
     start += Square(widthPerLevel[level]);
   }
 
-  tracksPyramidPerView.reserve(tracksPerView.size());
-  for(const auto& viewTracks: tracksPerView)
+  // create an entry for each view, even if there is no track at all
+  tracksPyramidPerView.reserve(views.size());
+  for(const auto& viewIt: views)
   {
-    auto& trackPyramid = tracksPyramidPerView[viewTracks.first];
-    // reserve 500 tracks in each view
-    trackPyramid.reserve(500 * pyramidDepth);
+    auto& trackPyramid = tracksPyramidPerView[viewIt.first];
+    trackPyramid.reserve(tracksStore.viewNbTracks(viewIt.first) * pyramidDepth);
   }
 
-  for(const auto& viewTracks: tracksPerView)
+  for(const IndexT viewId: tracksStore.getViewIds())
   {
-    const auto viewId = viewTracks.first;
     auto& tracksPyramidIndex = tracksPyramidPerView[viewId];
     const View& view = *views.at(viewId).get();
     std::vector<double> cellWidthPerLevel(pyramidDepth);
@@ -105,12 +105,13 @@ void computeTracksPyramidPerView(
       cellWidthPerLevel[level] = (double)view.getWidth() / (double)widthPerLevel[level];
       cellHeightPerLevel[level] = (double)view.getHeight() / (double)widthPerLevel[level];
     }
-    for(std::size_t i = 0; i < viewTracks.second.size(); ++i)
+    const IndexT* trackIds = tracksStore.viewTrackIds(viewId);
+    const IndexT* featIds = tracksStore.viewFeatureIds(viewId);
+    for(std::size_t i = 0; i < tracksStore.viewNbTracks(viewId); ++i)
     {
-      const std::size_t trackId = viewTracks.second[i];
-      const track::Track& track = map_tracks.at(trackId);
-      const std::size_t featIndex = track.featPerView.at(viewId);
-      const auto& feature = featuresProvider.getFeatures(viewId, track.descType)[featIndex]; 
+      const std::size_t trackId = trackIds[i];
+      const std::size_t featIndex = featIds[i];
+      const auto& feature = featuresProvider.getFeatures(viewId, tracksStore.trackDescType(trackId))[featIndex]; 
       
       for(std::size_t level = 0; level < pyramidDepth; ++level)
       {
@@ -143,6 +144,14 @@ ReconstructionEngine_sequentialSfM::ReconstructionEngine_sequentialSfM(
       _localStrategyGraph->setGraphDistanceLimit(_params.localBundelAdjustementGraphDistanceLimit);
   }
 
+  // the adaptive resection groups start with one image per thread
+  if(_params.adaptiveImagesPerGroup)
+  {
+    _adaptiveMaxImagesPerGroup = static_cast<std::size_t>(std::max(omp_get_max_threads(), 1));
+    if(_params.maxImagesPerGroup > 0)
+      _adaptiveMaxImagesPerGroup = std::min(_adaptiveMaxImagesPerGroup, _params.maxImagesPerGroup);
+  }
+
   // setup HTML logger
   if(!_htmlLogFile.empty())
   {
@@ -183,7 +192,7 @@ bool ReconstructionEngine_sequentialSfM::process()
           if (!reconstructedViews.empty())
           {
               // Add the reconstructed views to the LocalBA graph
-              _localStrategyGraph->updateGraphWithNewViews(_sfmData, _map_tracksPerView, reconstructedViews, _params.kMinNbOfMatches);
+              _localStrategyGraph->updateGraphWithNewViews(_sfmData, _tracksStore, reconstructedViews, _params.kMinNbOfMatches);
               _localStrategyGraph->updateRigEdgesToTheGraph(_sfmData);
           }
       }
@@ -242,46 +251,53 @@ void ReconstructionEngine_sequentialSfM::initializePyramidScoring()
 
 std::size_t ReconstructionEngine_sequentialSfM::fuseMatchesIntoTracks()
 {
-  // compute tracks from matches
-  track::TracksBuilder tracksBuilder;
-
   {
-    // list of features matches for each couple of images
-    const aliceVision::matching::PairwiseMatches& matches = *_pairwiseMatches;
+    if(_inputTracksStore != nullptr)
+    {
+      // tracks already built and filtered by the tracksBuilding step
+      ALICEVISION_LOG_DEBUG("Use the input tracks");
+      _tracksStore = std::move(*_inputTracksStore);
+      _inputTracksStore->clear();
+      if(!_tracksStore.hasViewIndex())
+        _tracksStore.buildViewIndex();
+    }
+    else
+    {
+      // compute tracks from matches
+      track::TracksBuilder tracksBuilder;
 
-    ALICEVISION_LOG_DEBUG("Track building");
-    tracksBuilder.build(matches);
+      // list of features matches for each couple of images
+      const aliceVision::matching::PairwiseMatches& matches = *_pairwiseMatches;
 
-    ALICEVISION_LOG_DEBUG("Track filtering");
-    tracksBuilder.filter(_params.filterTrackForks, _params.minInputTrackLength);
+      ALICEVISION_LOG_DEBUG("Track building");
+      tracksBuilder.build(matches);
 
-    ALICEVISION_LOG_DEBUG("Track export to internal structure");
-    // build tracks with STL compliant type
-    tracksBuilder.exportToSTL(_map_tracks);
-    ALICEVISION_LOG_DEBUG("Build tracks per view");
+      ALICEVISION_LOG_DEBUG("Track filtering");
+      tracksBuilder.filter(_params.filterTrackForks, _params.minInputTrackLength);
 
-    // Init tracksPerView to have an entry in the map for each view (even if there is no track at all)
-    for(const auto& viewIt: _sfmData.views)
-    {
-        // create an entry in the map
-        _map_tracksPerView[viewIt.first];
+      ALICEVISION_LOG_DEBUG("Track export to internal structure");
+      {
+        // build tracks with STL compliant type
+        track::TracksMap tracks;
+        tracksBuilder.exportToSTL(tracks);
+        ALICEVISION_LOG_DEBUG("Build tracks per view");
+        _tracksStore.importFromSTL(tracks);
+      }
     }
-    track::computeTracksPerView(_map_tracks, _map_tracksPerView);
+
     ALICEVISION_LOG_DEBUG("Build tracks pyramid per view");
     computeTracksPyramidPerView(
-            _map_tracksPerView, _map_tracks, _sfmData.views, *_featuresPerView, _params.pyramidBase, _params.pyramidDepth, _map_featsPyramidPerView);
+            _tracksStore, _sfmData.views, *_featuresPerView, _params.pyramidBase, _params.pyramidDepth, _map_featsPyramidPerView);
 
     // display stats
     {
-      std::set<size_t> imagesId;
-      track::imageIdInTracks(_map_tracksPerView, imagesId);
-
       ALICEVISION_LOG_INFO("Fuse matches into tracks: " << std::endl
-        << "\t- # tracks: " << tracksBuilder.nbTracks() << std::endl
-        << "\t- # images in tracks: " << imagesId.size());
+        << "\t- # tracks: " << _tracksStore.nbTracks() << std::endl
+        << "\t- # images in tracks: " << _tracksStore.getViewIds().size());
 
       std::map<size_t, size_t> map_Occurence_TrackLength;
-      track::tracksLength(_map_tracks, map_Occurence_TrackLength);
+      for(std::size_t trackId = 0; trackId < _tracksStore.nbTracks(); ++trackId)
+        ++map_Occurence_TrackLength[_tracksStore.trackLength(trackId)];
       ALICEVISION_LOG_INFO("TrackLength, Occurrence");
       for(const auto& iter: map_Occurence_TrackLength)
       {
@@ -291,7 +307,7 @@ std::size_t ReconstructionEngine_sequentialSfM::fuseMatchesIntoTracks()
       }
     }
   }
-  return _map_tracks.size();
+  return _tracksStore.nbTracks();
 }
 
 std::vector<Pair> ReconstructionEngine_sequentialSfM::getInitialImagePairsCandidates()
@@ -346,10 +362,12 @@ void ReconstructionEngine_sequentialSfM::registerChanges(const std::set<IndexT>&
   const sfmData::Landmarks & landmarks = _sfmData.getLandmarks();
   for (IndexT id : newReconstructedViews)
   {
-    const track::TrackIdSet & setTracks = _map_tracksPerView[id];
+    const IndexT* trackIds = _tracksStore.viewTrackIds(id);
 
-    for (auto idTrack : setTracks)
+    for (std::size_t t = 0; t < _tracksStore.viewNbTracks(id); ++t)
     {
+      const IndexT idTrack = trackIds[t];
+
       //Check that this track is indeed a landmark
       if (landmarks.find(idTrack) == landmarks.end())
       {
@@ -363,10 +381,10 @@ void ReconstructionEngine_sequentialSfM::registerChanges(const std::set<IndexT>&
         continue;
       }
 
-      const track::Track & track = _map_tracks[idTrack];
-      for (const auto & pairFeat : track.featPerView)
+      const IndexT* trackViewIds = _tracksStore.trackViewIds(idTrack);
+      for (std::size_t o = 0; o < _tracksStore.trackLength(idTrack); ++o)
       {
-          IndexT oview = pairFeat.first;
+          IndexT oview = trackViewIds[o];
           if (oview == id)
           {
               continue;
@@ -411,14 +429,15 @@ void ReconstructionEngine_sequentialSfM::remapLandmarkIdsToTrackIds()
   ALICEVISION_LOG_DEBUG("Find corresponding landmark id per track id");
 
   // find corresponding landmark id per track id
-  for(const auto& trackPair : _map_tracks)
+  for(std::size_t trackId = 0; trackId < _tracksStore.nbTracks(); ++trackId)
   {
-    const IndexT trackId = trackPair.first;
-    const Track& track = trackPair.second;
+    const IndexT* trackViewIds = _tracksStore.trackViewIds(trackId);
+    const IndexT* trackFeatIds = _tracksStore.trackFeatureIds(trackId);
+    const feature::EImageDescriberType descType = _tracksStore.trackDescType(trackId);
 
-    for(const auto& featView : track.featPerView)
+    for(std::size_t i = 0; i < _tracksStore.trackLength(trackId); ++i)
     {
-      const ObsToLandmark::const_iterator it = obsToLandmark.find(ObsKey(featView.first, featView.second, track.descType));
+      const ObsToLandmark::const_iterator it = obsToLandmark.find(ObsKey(trackViewIds[i], trackFeatIds[i], descType));
 
       if(it != obsToLandmark.end())
       {
@@ -430,7 +449,7 @@ void ReconstructionEngine_sequentialSfM::remapLandmarkIdsToTrackIds()
   }
 
   ALICEVISION_LOG_INFO("Landmark ids to track ids remapping: " << std::endl
-                        << "\t- # tracks: " << _map_tracks.size() << std::endl
+                        << "\t- # tracks: " << _tracksStore.nbTracks() << std::endl
                         << "\t- # input landmarks: " << landmarks.size() << std::endl
                         << "\t- # output landmarks: " << _sfmData.getLandmarks().size());
 }
@@ -501,8 +520,11 @@ double ReconstructionEngine_sequentialSfM::incrementalReconstruction()
                          );
 
     // compute robust resection of remaining images
+    system::Timer stepTimer;
     while (findNextBestViews(bestViewCandidates, candidateViewIds))
     {
+      _stepsDuration.nextBestViews += stepTimer.elapsedMs();
+
       ALICEVISION_LOG_INFO("Update Reconstruction:" << std::endl
         << "\t- resection id: " << resectionId << std::endl
         << "\t- # images in the resection group: " << bestViewCandidates.size() << std::endl
@@ -511,16 +533,22 @@ double ReconstructionEngine_sequentialSfM::incrementalReconstruction()
       // get reconstructed views before resection
       const std::set<IndexT> prevReconstructedViews = _sfmData.getValidViews();
 
+      stepTimer.reset();
       std::set<IndexT> newReconstructedViews = resection(resectionId, bestViewCandidates, prevReconstructedViews, candidateViewIds);
+      const double resectionDuration = stepTimer.elapsedMs();
+
       if(newReconstructedViews.empty())
       {
         candidateViewIds.clear();
+        stepTimer.reset();
         continue;
       }
 
-
       triangulate(prevReconstructedViews, newReconstructedViews);
+
+      stepTimer.reset();
       bundleAdjustment(newReconstructedViews);
+      updateAdaptiveImagesPerGroup(bestViewCandidates.size(), resectionDuration, stepTimer.elapsedMs());
 
 
       //Erase reconstructed views from list of available views
@@ -547,7 +575,9 @@ double ReconstructionEngine_sequentialSfM::incrementalReconstruction()
       }
 
       ++resectionId;
+      stepTimer.reset();
     }
+    _stepsDuration.nextBestViews += stepTimer.elapsedMs();
 
     if(_params.rig.useRigConstraint && !_sfmData.getRigs().empty())
     {
@@ -590,10 +620,20 @@ double ReconstructionEngine_sequentialSfM::incrementalReconstruction()
                                                                 const std::set<IndexT>& prevReconstructedViews,
                                                                 std::set<IndexT>& remainingViewIds)
 {
-  auto chrono_start = std::chrono::steady_clock::now();
+  system::Timer timer;
 
-  // add images to the 3D reconstruction
-#pragma omp parallel for
+  // the scene is not modified during the resection of the group, so the reconstructed tracks are listed once
+  std::set<std::size_t> reconstructedTracksId;
+  std::transform(_sfmData.getLandmarks().begin(), _sfmData.getLandmarks().end(),
+                 std::inserter(reconstructedTracksId, reconstructedTracksId.begin()),
+                 stl::RetrieveKey());
+
+  // compute the resection of the images, the results are staged per image
+  std::vector<ResectionData> resectionsData(bestViewIds.size());
+  std::vector<char> hasResected(bestViewIds.size(), 0);
+  std::vector<char> isSkipped(bestViewIds.size(), 0);
+
+#pragma omp parallel for schedule(dynamic)
   for(int i = 0; i < bestViewIds.size(); ++i)
   {
     const IndexT viewId = bestViewIds.at(i);
@@ -610,9 +650,7 @@ double ReconstructionEngine_sequentialSfM::incrementalReconstruction()
           << "\t- rig id: " << view.getRigId() << std::endl
           << "\t- sub-pose id: " << view.getSubPoseId());
 
-#pragma omp critical
-        remainingViewIds.erase(viewId);
-
+        isSkipped[i] = 1;
         continue;
       }
 
@@ -629,34 +667,71 @@ double ReconstructionEngine_sequentialSfM::incrementalReconstruction()
           << "\t- rig id: " << view.getRigId() << std::endl
           << "\t- sub-pose id: " << view.getSubPoseId());
 
-#pragma omp critical
-        remainingViewIds.erase(viewId);
-
+        isSkipped[i] = 1;
         continue;
       }
     }
 
-    ResectionData newResectionData;
-    newResectionData.error_max = _params.localizerEstimatorError;
-    newResectionData.max_iteration = _params.localizerEstimatorMaxIterations;
-    const bool hasResected = computeResection(viewId, newResectionData);
+    ResectionData& resectionData = resectionsData.at(i);
+    resectionData.error_max = _params.localizerEstimatorError;
+    resectionData.max_iteration = _params.localizerEstimatorMaxIterations;
 
-#pragma omp critical
+    if(computeResection(viewId, reconstructedTracksId, resectionData))
     {
-      if(hasResected)
-      {
-        updateScene(viewId, newResectionData);
-        ALICEVISION_LOG_DEBUG("Resection of image " << i << " ( view id: " << viewId << " ) succeed.");
-        _sfmData.getViews().at(viewId)->setResectionId(resectionId);
-      }
-      else
-      {
-        ALICEVISION_LOG_DEBUG("Resection of image " << i << " ( view id: " << viewId << " ) was not possible.");
-      }
+      computeInlierObservations(viewId, resectionData);
+      hasResected[i] = 1;
+      ALICEVISION_LOG_DEBUG("Resection of image " << i << " ( view id: " << viewId << " ) succeed.");
+    }
+    else
+    {
+      ALICEVISION_LOG_DEBUG("Resection of image " << i << " ( view id: " << viewId << " ) was not possible.");
     }
   }
 
-  ALICEVISION_LOG_DEBUG("Resection of " << bestViewIds.size() << " new images took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - chrono_start).count() << " msec.");
+  const double resectionDuration = timer.elapsedMs();
+  timer.reset();
+
+  // commit the staged results in the order of the resection group, to be independent of the threads scheduling
+  std::vector<IndexT> resectedViewIds;
+  std::vector<const ResectionData*> resectedData;
+
+  for(std::size_t i = 0; i < bestViewIds.size(); ++i)
+  {
+    const IndexT viewId = bestViewIds.at(i);
+
+    if(isSkipped[i])
+    {
+      remainingViewIds.erase(viewId);
+      continue;
+    }
+
+    if(!hasResected[i])
+      continue;
+
+    // a view of a rig can be indirectly localized by a previous view of the group sharing its rig pose
+    const View& view = *_sfmData.getViews().at(viewId);
+    if(view.isPartOfRig() && _sfmData.isPoseAndIntrinsicDefined(viewId))
+    {
+      ALICEVISION_LOG_DEBUG("Resection of image " << i << " ( view id: " << viewId << " ) was discarded, "
+                            "view indirectly localized by the resection group.");
+      continue;
+    }
+
+    updateScene(viewId, resectionsData.at(i));
+    _sfmData.getViews().at(viewId)->setResectionId(resectionId);
+
+    resectedViewIds.push_back(viewId);
+    resectedData.push_back(&resectionsData.at(i));
+  }
+
+  updateSceneObservations(resectedViewIds, resectedData);
+
+  const double sceneUpdateDuration = timer.elapsedMs();
+  _stepsDuration.resection += resectionDuration;
+  _stepsDuration.sceneUpdate += sceneUpdateDuration;
+
+  ALICEVISION_LOG_DEBUG("Resection of " << bestViewIds.size() << " new images took " << system::prettyTime(resectionDuration)
+                        << " (scene update: " << system::prettyTime(sceneUpdateDuration) << ").");
 
   // get new reconstructed views
   std::set<IndexT> newReconstructedViews;
@@ -685,7 +760,10 @@ void ReconstructionEngine_sequentialSfM::triangulate(const std::set<IndexT>& pre
   else
     triangulate_multiViewsLORANSAC(_sfmData, prevReconstructedViews, newReconstructedViews);
 
-  ALICEVISION_LOG_DEBUG("Triangulation of the " << newReconstructedViews.size() << " newly reconstructed views took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - chrono_start).count() << " msec.");
+  const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - chrono_start).count();
+  _stepsDuration.triangulation += duration;
+
+  ALICEVISION_LOG_DEBUG("Triangulation of the " << newReconstructedViews.size() << " newly reconstructed views took " << system::prettyTime(duration) << ".");
 }
 
 bool ReconstructionEngine_sequentialSfM::bundleAdjustment(std::set<IndexT>& newReconstructedViews, bool isInitialPair)
@@ -719,7 +797,7 @@ bool ReconstructionEngine_sequentialSfM::bundleAdjustment(std::set<IndexT>& newR
 
   // add the new reconstructed views to the graph
   if(_params.useLocalBundleAdjustment)
-    _localStrategyGraph->updateGraphWithNewViews(_sfmData, _map_tracksPerView, newReconstructedViews, _params.kMinNbOfMatches);
+    _localStrategyGraph->updateGraphWithNewViews(_sfmData, _tracksStore, newReconstructedViews, _params.kMinNbOfMatches);
 
 
   if(enableLocalStrategy)
@@ -765,7 +843,10 @@ bool ReconstructionEngine_sequentialSfM::bundleAdjustment(std::set<IndexT>& newR
       const bool success = BA.adjust(_sfmData, refineOptions);
 
       if(!success)
+      {
+        _stepsDuration.bundleAdjustment += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - chronoStart).count();
         return false; // not usable solution
+      }
 
       // save the current focal lengths values (for each intrinsic) in the history
       if(_params.useLocalBundleAdjustment)
@@ -777,10 +858,13 @@ bool ReconstructionEngine_sequentialSfM::bundleAdjustment(std::set<IndexT>& newR
       statistics.show();
     }
 
+    system::Timer filteringTimer;
     nbOutliers = removeOutliers();
 
     std::set<IndexT> removedViewsIdIteration;
     eraseUnstablePosesAndObservations(this->_sfmData, _params.minPointsPerPose, _params.minTrackLength, &removedViewsIdIteration);
+    const double filteringTimeMs = filteringTimer.elapsedMs();
+    _stepsDuration.outliersFiltering += filteringTimeMs;
 
     for(IndexT v : removedViewsIdIteration)
       newReconstructedViews.erase(v);
@@ -792,11 +876,14 @@ bool ReconstructionEngine_sequentialSfM::bundleAdjustment(std::set<IndexT>& newR
       ALICEVISION_LOG_DEBUG("Views removed from the local BA graph: " << removedViewsIdIteration);
     }
 
-    ALICEVISION_LOG_INFO("Bundle adjustment iteration: " << iteration << " took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - chronoItStart).count() << " msec.");
+    ALICEVISION_LOG_INFO("Bundle adjustment iteration: " << iteration << " took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - chronoItStart).count() << " msec"
+                         << " (outliers filtering: " << system::prettyTime(filteringTimeMs) << ").");
     ++iteration;
   }
   while(nbOutliersThreshold >= 0 && nbOutliers > nbOutliersThreshold);
 
+  _stepsDuration.bundleAdjustment += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - chronoStart).count();
+
   ALICEVISION_LOG_INFO("Bundle adjustment with " << iteration << " iterations took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - chronoStart).count() << " msec.");
   return true;
 }
@@ -814,6 +901,14 @@ void ReconstructionEngine_sequentialSfM::exportStatistics(double reconstructionT
     << "\t- elapsed time: " << reconstructionTime << std::endl
     << "\t- residual RMSE: " <<  residual);
 
+  ALICEVISION_LOG_INFO("Structure from Motion steps duration:" << std::endl
+    << "\t- next best views selection: " << system::prettyTime(_stepsDuration.nextBestViews) << std::endl
+    << "\t- resection: " << system::prettyTime(_stepsDuration.resection) << std::endl
+    << "\t- scene update: " << system::prettyTime(_stepsDuration.sceneUpdate) << std::endl
+    << "\t- triangulation: " << system::prettyTime(_stepsDuration.triangulation) << std::endl
+    << "\t- bundle adjustment: " << system::prettyTime(_stepsDuration.bundleAdjustment) << std::endl
+    << "\t- outliers filtering (included in bundle adjustment): " << system::prettyTime(_stepsDuration.outliersFiltering));
+
   std::map<feature::EImageDescriberType, int> descTypeUsage = _sfmData.getLandmarkDescTypesUsages();
   for(const auto& d: descTypeUsage)
   {
@@ -873,7 +968,10 @@ void ReconstructionEngine_sequentialSfM::exportStatistics(double reconstructionT
        << "<br>- # poses: " << _sfmData.getPoses().size() << std::endl
        << "<br>- # landmarks: " << _sfmData.getLandmarks().size()
        << "<br>- elapsed time: " << reconstructionTime
-       << "<br>- residual RMSE: " << residual;
+       << "<br>- residual RMSE: " << residual
+       << "<br>- resection time: " << system::prettyTime(_stepsDuration.resection)
+       << "<br>- triangulation time: " << system::prettyTime(_stepsDuration.triangulation)
+       << "<br>- bundle adjustment time: " << system::prettyTime(_stepsDuration.bundleAdjustment);
 
     _htmlDocStream->pushInfo(os.str());
     _htmlDocStream->pushInfo(htmlMarkup("h2","Histogram of reprojection-residuals"));
@@ -913,6 +1011,14 @@ void ReconstructionEngine_sequentialSfM::exportStatistics(double reconstructionT
       _jsonLogTree.add("sfm.observationsHistogram." + std::to_string(i), obsHistogram[i]);
 
     _jsonLogTree.put("sfm.time", reconstructionTime);                        // process time
+
+    // steps duration (in seconds)
+    _jsonLogTree.put("sfm.steps.nextBestViews", _stepsDuration.nextBestViews / 1000.0);
+    _jsonLogTree.put("sfm.steps.resection", _stepsDuration.resection / 1000.0);
+    _jsonLogTree.put("sfm.steps.sceneUpdate", _stepsDuration.sceneUpdate / 1000.0);
+    _jsonLogTree.put("sfm.steps.triangulation", _stepsDuration.triangulation / 1000.0);
+    _jsonLogTree.put("sfm.steps.bundleAdjustment", _stepsDuration.bundleAdjustment / 1000.0);
+    _jsonLogTree.put("sfm.steps.outliersFiltering", _stepsDuration.outliersFiltering / 1000.0);
     _jsonLogTree.put("hardware.cpu.freq", system::cpu_clock_by_os());        // cpu frequency
     _jsonLogTree.put("hardware.cpu.cores", system::get_total_cpus());        // cpu cores
     _jsonLogTree.put("hardware.ram.size", system::getMemoryInfo().totalRam); // ram size
@@ -931,7 +1037,7 @@ void ReconstructionEngine_sequentialSfM::calibrateRigs(std::set<IndexT>& updated
   for(const std::pair<IndexT, Rig>& rigPair : _sfmData.getRigs())
   {
     RigSequence sequence(_sfmData, rigPair.first, _params.rig);
-    sequence.init(_map_tracksPerView);
+    sequence.init(_tracksStore);
     sequence.updateSfM(updatedViews);
   }
 }
@@ -945,26 +1051,31 @@ bool ReconstructionEngine_sequentialSfM::findConnectedViews(
   if (remainingViewIds.empty() || _sfmData.getLandmarks().empty())
     return false;
 
-  // Collect tracksIds
-  std::set<size_t> reconstructed_trackId;
-  std::transform(_sfmData.getLandmarks().begin(), _sfmData.getLandmarks().end(),
-                 std::inserter(reconstructed_trackId, reconstructed_trackId.begin()),
-                 stl::RetrieveKey());
+  // Flag the reconstructed tracks, landmark ids are track ids
+  std::vector<bool> isTrackReconstructed(_tracksStore.nbTracks(), false);
+  for(const auto& landmarkIt : _sfmData.getLandmarks())
+  {
+    if(landmarkIt.first < isTrackReconstructed.size())
+      isTrackReconstructed[landmarkIt.first] = true;
+  }
 
   const std::set<IndexT> reconstructedIntrinsics = _sfmData.getReconstructedIntrinsics();
+  const std::vector<IndexT> remainingViewIdsVec(remainingViewIds.begin(), remainingViewIds.end());
 
-#pragma omp parallel for
-  for(int i = 0; i < remainingViewIds.size(); ++i)
+  // One slot per remaining view, to keep a deterministic order before sorting
+  std::vector<ViewConnectionScore> connectedViews(remainingViewIdsVec.size());
+  std::vector<char> isConnected(remainingViewIdsVec.size(), 0);
+
+#pragma omp parallel for schedule(dynamic)
+  for(int i = 0; i < remainingViewIdsVec.size(); ++i)
   {
-    std::set<IndexT>::const_iterator iter = remainingViewIds.cbegin();
-    std::advance(iter, i);
-    const IndexT viewId = *iter;
+    const IndexT viewId = remainingViewIdsVec[i];
     const IndexT intrinsicId = _sfmData.getViews().at(viewId)->getIntrinsicId();
     const bool isIntrinsicsReconstructed = reconstructedIntrinsics.count(intrinsicId);
 
     // Compute 2D - 3D possible content
-    const aliceVision::track::TrackIdSet& set_tracksIds = _map_tracksPerView.at(viewId);
-    if (set_tracksIds.empty())
+    const std::size_t nbTracksInView = _tracksStore.viewNbTracks(viewId);
+    if (nbTracksInView == 0)
       continue;
 
     // Check if the view is part of a rig
@@ -995,19 +1106,25 @@ bool ReconstructionEngine_sequentialSfM::findConnectedViews(
 
     // Count the common possible putative point
     //  with the already 3D reconstructed trackId
+    const IndexT* trackIds = _tracksStore.viewTrackIds(viewId);
     std::vector<std::size_t> vec_trackIdForResection;
-    vec_trackIdForResection.reserve(set_tracksIds.size());
-    std::set_intersection(set_tracksIds.begin(), set_tracksIds.end(),
-                          reconstructed_trackId.begin(),
-                          reconstructed_trackId.end(),
-                          std::back_inserter(vec_trackIdForResection));
+    vec_trackIdForResection.reserve(nbTracksInView);
+    for(std::size_t t = 0; t < nbTracksInView; ++t)
+    {
+      if(isTrackReconstructed[trackIds[t]])
+        vec_trackIdForResection.push_back(trackIds[t]);
+    }
     // Compute an image score based on the number of matches to the 3D scene
     // and the repartition of these features in the image.
     std::size_t score = computeCandidateImageScore(viewId, vec_trackIdForResection);
-#pragma omp critical
-    {
-      out_connectedViews.emplace_back(viewId, vec_trackIdForResection.size(), score, isIntrinsicsReconstructed);
-    }
+    connectedViews[i] = ViewConnectionScore(viewId, vec_trackIdForResection.size(), score, isIntrinsicsReconstructed);
+    isConnected[i] = 1;
+  }
+
+  for(std::size_t i = 0; i < connectedViews.size(); ++i)
+  {
+    if(isConnected[i])
+      out_connectedViews.push_back(connectedViews[i]);
   }
 
   // Sort by the image score
@@ -1109,6 +1226,10 @@ bool ReconstructionEngine_sequentialSfM::findNextBestViews(
   if(_params.maxImagesPerGroup > 0 && out_selectedViewIds.size() > _params.maxImagesPerGroup)
     out_selectedViewIds.resize(_params.maxImagesPerGroup);
 
+  // the adaptive limit balances the resection and the bundle adjustment durations
+  if(_params.adaptiveImagesPerGroup && _adaptiveMaxImagesPerGroup > 0 && out_selectedViewIds.size() > _adaptiveMaxImagesPerGroup)
+    out_selectedViewIds.resize(_adaptiveMaxImagesPerGroup);
+
   ALICEVISION_LOG_DEBUG(
     "Find next best views took: " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - chrono_start).count() << " msec\n"
     "\t# images : " << out_selectedViewIds.size() << "\n"
@@ -1154,7 +1275,7 @@ bool ReconstructionEngine_sequentialSfM::makeInitialPair3D(const Pair& currentPa
   // b. get common features between the two views
   // use the track to have a more dense match correspondence set
   aliceVision::track::TracksMap commonTracks;
-  track::getCommonTracksInImagesFast({I, J}, _map_tracks, _map_tracksPerView, commonTracks);
+  track::getCommonTracksInImages({I, J}, _tracksStore, commonTracks);
 
   // copy point to arrays
   const std::size_t n = commonTracks.size();
@@ -1346,7 +1467,7 @@ bool ReconstructionEngine_sequentialSfM::getBestInitialImagePairs(std::vector<Pa
 
     aliceVision::track::TracksMap map_tracksCommon;
     const std::set<size_t> set_imageIndex= {I, J};
-    track::getCommonTracksInImagesFast(set_imageIndex, _map_tracks, _map_tracksPerView, map_tracksCommon);
+    track::getCommonTracksInImages(set_imageIndex, _tracksStore, map_tracksCommon);
 
     // Copy points correspondences to arrays for relative pose estimation
     const size_t n = map_tracksCommon.size();
@@ -1485,24 +1606,19 @@ std::size_t ReconstructionEngine_sequentialSfM::computeCandidateImageScore(Index
  * C. Do the resectioning: compute the camera pose.
  * D. Refine the pose of the found camera
  */
-bool ReconstructionEngine_sequentialSfM::computeResection(const IndexT viewId, ResectionData& resectionData)
+bool ReconstructionEngine_sequentialSfM::computeResection(const IndexT viewId, const std::set<std::size_t>& reconstructedTracksId, ResectionData& resectionData)
 {
   using namespace track;
 
   // A. Compute 2D/3D matches
   // A1. list tracks ids used by the view
-  const aliceVision::track::TrackIdSet& set_tracksIds = _map_tracksPerView.at(viewId);
+  const IndexT* viewTrackIds = _tracksStore.viewTrackIds(viewId);
 
   // A2. intersects the track list with the reconstructed
-  std::set<std::size_t> reconstructed_trackId;
-  std::transform(_sfmData.getLandmarks().begin(), _sfmData.getLandmarks().end(),
-                 std::inserter(reconstructed_trackId, reconstructed_trackId.begin()),
-                 stl::RetrieveKey());
-  
   // Get the ids of the already reconstructed tracks
-  std::set_intersection(set_tracksIds.begin(), set_tracksIds.end(),
-                        reconstructed_trackId.begin(),
-                        reconstructed_trackId.end(),
+  std::set_intersection(viewTrackIds, viewTrackIds + _tracksStore.viewNbTracks(viewId),
+                        reconstructedTracksId.begin(),
+                        reconstructedTracksId.end(),
                         std::inserter(resectionData.tracksId, resectionData.tracksId.begin()));
   
   if (resectionData.tracksId.empty())
@@ -1514,7 +1630,7 @@ bool ReconstructionEngine_sequentialSfM::computeResection(const IndexT viewId, R
   
   // Get back featId associated to a tracksID already reconstructed.
   // These 2D/3D associations will be used for the resection.
-  getFeatureIdInViewPerTrack(_map_tracks,
+  getFeatureIdInViewPerTrack(_tracksStore,
                                              resectionData.tracksId,
                                              viewId,
                                              &resectionData.featuresId);
@@ -1622,18 +1738,11 @@ bool ReconstructionEngine_sequentialSfM::computeResection(const IndexT viewId, R
   return true;
 }
 
-void ReconstructionEngine_sequentialSfM::updateScene(const IndexT viewIndex, const ResectionData& resectionData)
-{ 
-  // A. Update the global scene with the new found camera pose, intrinsic (if not defined)
-
-  // update the view pose or rig pose/sub-pose
-  _map_ACThreshold.insert(std::make_pair(viewIndex, resectionData.error_max));
-
-  const View& view = *_sfmData.views.at(viewIndex);
-  _sfmData.setPose(view, CameraPose(resectionData.pose));
+void ReconstructionEngine_sequentialSfM::computeInlierObservations(const IndexT viewIndex, ResectionData& resectionData) const
+{
+  resectionData.inlierObservations.clear();
 
-  // B. Update the observations into the global scene structure
-  // - Add the new 2D observations to the reconstructed tracks
+  // keep the 2D/3D matches consistent with the refined pose
   std::set<std::size_t>::const_iterator iterTrackId = resectionData.tracksId.begin();
   for (std::size_t i = 0; i < resectionData.pt2D.cols(); ++i, ++iterTrackId)
   {
@@ -1643,15 +1752,96 @@ void ReconstructionEngine_sequentialSfM::updateScene(const IndexT viewIndex, con
     if (residual.norm() < resectionData.error_max &&
         resectionData.pose.depth(X) > 0)
     {
-      Landmark& landmark = _sfmData.structure[*iterTrackId];
       const IndexT idFeat = resectionData.featuresId[i].second;
-      const double scale = (_params.featureConstraint == EFeatureConstraint::BASIC) ? 0.0 : _featuresPerView->getFeatures(viewIndex, landmark.descType)[idFeat].scale();
-      // Inlier, add the point to the reconstructed track
-      landmark.observations[viewIndex] = Observation(x, idFeat, scale);
+      const double scale = (_params.featureConstraint == EFeatureConstraint::BASIC) ? 0.0 : _featuresPerView->getFeatures(viewIndex, resectionData.vec_descType.at(i))[idFeat].scale();
+      resectionData.inlierObservations.emplace_back(*iterTrackId, Observation(x, idFeat, scale));
+    }
+  }
+}
+
+void ReconstructionEngine_sequentialSfM::updateScene(const IndexT viewIndex, const ResectionData& resectionData)
+{ 
+  // Update the global scene with the new found camera pose, intrinsic (if not defined)
+
+  // update the view pose or rig pose/sub-pose
+  _map_ACThreshold.insert(std::make_pair(viewIndex, resectionData.error_max));
+
+  const View& view = *_sfmData.views.at(viewIndex);
+  _sfmData.setPose(view, CameraPose(resectionData.pose));
+}
+
+void ReconstructionEngine_sequentialSfM::updateSceneObservations(const std::vector<IndexT>& viewIds, const std::vector<const ResectionData*>& resectionsData)
+{
+  // list all the new observations <trackId, index of the view, index of the observation>
+  std::vector<std::tuple<IndexT, std::size_t, std::size_t>> newObservations;
+  {
+    std::size_t nbObservations = 0;
+    for(const ResectionData* resectionData : resectionsData)
+      nbObservations += resectionData->inlierObservations.size();
+    newObservations.reserve(nbObservations);
+  }
+
+  for(std::size_t v = 0; v < resectionsData.size(); ++v)
+  {
+    const auto& inlierObservations = resectionsData.at(v)->inlierObservations;
+    for(std::size_t o = 0; o < inlierObservations.size(); ++o)
+      newObservations.emplace_back(inlierObservations.at(o).first, v, o);
+  }
+
+  // group the observations per landmark
+  std::sort(newObservations.begin(), newObservations.end());
+
+  std::vector<std::size_t> groupsBegin;
+  for(std::size_t i = 0; i < newObservations.size(); ++i)
+  {
+    if(i == 0 || std::get<0>(newObservations[i]) != std::get<0>(newObservations[i - 1]))
+      groupsBegin.push_back(i);
+  }
+  groupsBegin.push_back(newObservations.size());
+
+  // the landmarks already exist, so each thread only updates the observations of its own landmarks
+#pragma omp parallel for schedule(dynamic, 256)
+  for(int g = 0; g < static_cast<int>(groupsBegin.size()) - 1; ++g)
+  {
+    Landmark& landmark = _sfmData.structure.at(std::get<0>(newObservations[groupsBegin[g]]));
+
+    for(std::size_t i = groupsBegin[g]; i < groupsBegin[g + 1]; ++i)
+    {
+      const std::size_t v = std::get<1>(newObservations[i]);
+      const std::size_t o = std::get<2>(newObservations[i]);
+
+      // inlier, add the point to the reconstructed track
+      landmark.observations[viewIds.at(v)] = resectionsData.at(v)->inlierObservations.at(o).second;
     }
   }
 }
 
+void ReconstructionEngine_sequentialSfM::updateAdaptiveImagesPerGroup(std::size_t nbImages, double resectionDuration, double bundleAdjustmentDuration)
+{
+  if(!_params.adaptiveImagesPerGroup || nbImages == 0 || resectionDuration <= 0.0)
+    return;
+
+  // at least one image per thread to use all the cores during the resection
+  const std::size_t maxImagesPerGroup = (_params.maxImagesPerGroup > 0) ? _params.maxImagesPerGroup : std::numeric_limits<std::size_t>::max();
+  const std::size_t minImagesPerGroup = std::min(static_cast<std::size_t>(std::max(omp_get_max_threads(), 1)), maxImagesPerGroup);
+
+  // the bundle adjustment duration barely depends on the number of new images, while the resection duration grows with it:
+  // the target group size balances both durations, so the bundle adjustment cost is amortized over enough new images
+  // without adding too much data at once.
+  const double resectionDurationPerImage = resectionDuration / static_cast<double>(nbImages);
+  const double targetImagesPerGroup = bundleAdjustmentDuration / resectionDurationPerImage;
+
+  // smooth the update to be robust to the variance of the measures
+  const double imagesPerGroup = 0.5 * (static_cast<double>(_adaptiveMaxImagesPerGroup) + targetImagesPerGroup);
+  const double clampedImagesPerGroup = std::max(static_cast<double>(minImagesPerGroup), std::min(imagesPerGroup, static_cast<double>(maxImagesPerGroup)));
+
+  _adaptiveMaxImagesPerGroup = static_cast<std::size_t>(std::round(clampedImagesPerGroup));
+
+  ALICEVISION_LOG_DEBUG("Adaptive resection group size: " << _adaptiveMaxImagesPerGroup << std::endl
+                        << "\t- resection duration per image: " << system::prettyTime(resectionDurationPerImage) << std::endl
+                        << "\t- bundle adjustment duration: " << system::prettyTime(bundleAdjustmentDuration));
+}
+
 bool ReconstructionEngine_sequentialSfM::checkChieralities(
   const Vec3& pt3D, 
   const std::set<IndexT> & viewsId, 
@@ -1695,37 +1885,40 @@ void ReconstructionEngine_sequentialSfM::getTracksToTriangulate(const std::set<I
   allReconstructedViews.insert(previousReconstructedViews.begin(), previousReconstructedViews.end());
   allReconstructedViews.insert(newReconstructedViews.begin(), newReconstructedViews.end());
   
-  std::set<IndexT> allTracksInNewViews;
-  track::getTracksInImagesFast(newReconstructedViews, _map_tracksPerView, allTracksInNewViews);
-  
-  std::set<IndexT>::iterator it;
-#pragma omp parallel private(it)
+  // Tracks visible in the new views, from the per-view index
+  std::vector<bool> isTrackInNewViews(_tracksStore.nbTracks(), false);
+  for(const IndexT viewId : newReconstructedViews)
   {
-    for (it = allTracksInNewViews.begin(); it != allTracksInNewViews.end(); ++it)
-    {
-#pragma omp single nowait
-      {
-        const std::size_t trackId = *it;
-        
-        const track::Track& track = _map_tracks.at(trackId);
-        
-        std::set<IndexT> allViewsSharingTheTrack;
-        std::transform(track.featPerView.begin(), track.featPerView.end(),
-                       std::inserter(allViewsSharingTheTrack, allViewsSharingTheTrack.begin()),
-                       stl::RetrieveKey());
-        
-        std::set<IndexT> allReconstructedViewsSharingTheTrack;
-        std::set_intersection(allViewsSharingTheTrack.begin(), allViewsSharingTheTrack.end(),
-                              allReconstructedViews.begin(), allReconstructedViews.end(),
-                              std::inserter(allReconstructedViewsSharingTheTrack, allReconstructedViewsSharingTheTrack.begin()));
-        
-        if (allReconstructedViewsSharingTheTrack.size() >= _params.minNbObservationsForTriangulation)
-        {
-#pragma omp critical        
-          mapTracksToTriangulate[trackId] = allReconstructedViewsSharingTheTrack;
-        }
-      }
-    }
+    const IndexT* trackIds = _tracksStore.viewTrackIds(viewId);
+    for(std::size_t t = 0; t < _tracksStore.viewNbTracks(viewId); ++t)
+      isTrackInNewViews[trackIds[t]] = true;
+  }
+
+  std::vector<IndexT> allTracksInNewViews;
+  for(std::size_t trackId = 0; trackId < isTrackInNewViews.size(); ++trackId)
+  {
+    if(isTrackInNewViews[trackId])
+      allTracksInNewViews.push_back(trackId);
+  }
+
+  std::vector<std::set<IndexT>> reconstructedViewsPerTrack(allTracksInNewViews.size());
+
+#pragma omp parallel for schedule(dynamic, 256)
+  for(int i = 0; i < allTracksInNewViews.size(); ++i)
+  {
+    const IndexT trackId = allTracksInNewViews[i];
+
+    // track views are sorted
+    const IndexT* trackViewIds = _tracksStore.trackViewIds(trackId);
+    std::set_intersection(trackViewIds, trackViewIds + _tracksStore.trackLength(trackId),
+                          allReconstructedViews.begin(), allReconstructedViews.end(),
+                          std::inserter(reconstructedViewsPerTrack[i], reconstructedViewsPerTrack[i].end()));
+  }
+
+  for(std::size_t i = 0; i < allTracksInNewViews.size(); ++i)
+  {
+    if(reconstructedViewsPerTrack[i].size() >= _params.minNbObservationsForTriangulation)
+      mapTracksToTriangulate[allTracksInNewViews[i]].swap(reconstructedViewsPerTrack[i]);
   }
 }
 
@@ -1788,7 +1981,8 @@ void ReconstructionEngine_sequentialSfM::triangulate_multiViewsLORANSAC(SfMData&
   {
     const IndexT trackId = setTracksId.at(i);
     bool isValidTrack = true;
-    const track::Track& track = _map_tracks.at(trackId);
+    track::Track track;
+    _tracksStore.getTrack(trackId, track);
     std::set<IndexT>& observations = mapTracksToTriangulate.at(trackId); // all the posed views possessing the track
     
     // The track needs to be seen by a min. number of views to be triangulated
@@ -1847,8 +2041,6 @@ void ReconstructionEngine_sequentialSfM::triangulate_multiViewsLORANSAC(SfMData&
       Mat2X features(2, observations.size()); // undistorted 2D features (one per pose)
       std::vector<Mat34> Ps; // projective matrices (one per pose)
       {
-        const track::Track& track = _map_tracks.at(trackId);
-        
         int i = 0;
         for (const IndexT& viewId : observations)
         {
@@ -1952,7 +2144,7 @@ void ReconstructionEngine_sequentialSfM::triangulate_2Views(SfMData& scene, cons
       // Find track correspondences between I and J
       const std::set<std::size_t> set_viewIndex = { I, J };
       track::TracksMap map_tracksCommonIJ;
-      track::getCommonTracksInImagesFast(set_viewIndex, _map_tracks, _map_tracksPerView, map_tracksCommonIJ);
+      track::getCommonTracksInImages(set_viewIndex, _tracksStore, map_tracksCommonIJ);
 
       const View* viewI = scene.getViews().at(I).get();
       const View* viewJ = scene.getViews().at(J).get();
@@ -2097,12 +2289,17 @@ void ReconstructionEngine_sequentialSfM::triangulate_2Views(SfMData& scene, cons
 
 std::size_t ReconstructionEngine_sequentialSfM::removeOutliers()
 {
+  system::Timer timer;
   const std::size_t nbOutliersResidualErr = RemoveOutliers_PixelResidualError(_sfmData, _params.featureConstraint, _params.maxReprojectionError, 2);
+  const double residualErrTimeMs = timer.elapsedMs();
+
+  timer.reset();
   const std::size_t nbOutliersAngleErr = RemoveOutliers_AngleError(_sfmData, _params.minAngleForLandmark);
+  const double angleErrTimeMs = timer.elapsedMs();
 
   ALICEVISION_LOG_INFO("Remove outliers: " << std::endl
-                        << "\t- # outliers residual error: " << nbOutliersResidualErr << std::endl
-                        << "\t- # outliers angular error: " << nbOutliersAngleErr);
+                        << "\t- # outliers residual error: " << nbOutliersResidualErr << " (" << system::prettyTime(residualErrTimeMs) << ")" << std::endl
+                        << "\t- # outliers angular error: " << nbOutliersAngleErr << " (" << system::prettyTime(angleErrTimeMs) << ")");
 
   return nbOutliersResidualErr + nbOutliersAngleErr;
 }
@@ -15,6 +15,7 @@
 #include <aliceVision/sfmDataIO/sfmDataIO.hpp>
 #include <aliceVision/feature/FeaturesPerView.hpp>
 #include <aliceVision/track/TracksBuilder.hpp>
+#include <aliceVision/track/TracksStore.hpp>
 #include <dependencies/htmlDoc/htmlDoc.hpp>
 #include <aliceVision/utils/Histogram.hpp>
 
@@ -85,6 +86,11 @@ public:
     /// we don't add too much data in one step without bundle adjustment.
     std::size_t maxImagesPerGroup = 30;
 
+    /// Adapt the number of cameras added before each bundle adjustment to the measured cost of the resection and
+    /// the bundle adjustment steps, between the number of threads and maxImagesPerGroup.
+    /// The size of the resection groups depends on timings, so the reconstruction is not reproducible from run to run.
+    bool adaptiveImagesPerGroup = false;
+
     /// Threshold for the maximum number of outliers allowed at the end of a BA iteration.
     /// If the limit is not met, another BA iteration is performed.
     /// Using a negative value for this threshold will disable BA iterations.
@@ -125,6 +131,16 @@ public:
     _pairwiseMatches = pairwiseMatches;
   }
 
+  /**
+   * @brief Use precomputed tracks instead of fusing the matches into tracks.
+   *        The store content is moved into the engine by fuseMatchesIntoTracks.
+   * @param[in] tracksStore the tracks loaded from a binary tracks file (nullptr to build them from the matches)
+   */
+  void setTracks(track::TracksStore* tracksStore)
+  {
+    _inputTracksStore = tracksStore;
+  }
+
   /**
    * @brief Process the entire incremental reconstruction
    * @return true if done
@@ -247,6 +263,19 @@ private:
     std::shared_ptr<camera::IntrinsicBase> optionalIntrinsic = nullptr;
     /// the instrinsic already exists in the scene or not.
     bool isNewIntrinsic;
+    /// inlier observations to add to the reconstructed tracks <trackId, observation>
+    std::vector<std::pair<IndexT, sfmData::Observation>> inlierObservations;
+  };
+
+  /// Accumulated durations of the incremental reconstruction steps (in milliseconds)
+  struct StepsDuration
+  {
+    double nextBestViews = 0.0;
+    double resection = 0.0;
+    double sceneUpdate = 0.0;
+    double triangulation = 0.0;
+    double bundleAdjustment = 0.0;
+    double outliersFiltering = 0.0;
   };
 
   /**
@@ -286,19 +315,44 @@ private:
 
   /**
    * @brief Apply the resection on a single view.
+   * @note The scene is only read, so several views can be resected concurrently.
    * @param[in] viewIndex: image index to add to the reconstruction.
-   * @param[out] resectionData: contains the result (P) and all the data used during the resection.
+   * @param[in] reconstructedTracksId: ids of the tracks already reconstructed in the scene.
+   * @param[out] resectionData: contains the result (P), the inlier observations and all the data used during the resection.
    * @return false if resection failed
    */
-  bool computeResection(const IndexT viewIndex, ResectionData& resectionData);
+  bool computeResection(const IndexT viewIndex, const std::set<std::size_t>& reconstructedTracksId, ResectionData& resectionData);
 
   /**
-   * @brief Update the global scene with the new found camera pose, intrinsic (if not defined) and 
-   * Update its observations into the global scene structure.
+   * @brief Select the 2D/3D matches of a resected view which are inliers for the estimated pose.
+   * @param[in] viewIndex: image index added to the reconstruction.
+   * @param[in,out] resectionData: contains the camera pose, all data used during the resection and
+   *                the output inlier observations.
+   */
+  void computeInlierObservations(const IndexT viewIndex, ResectionData& resectionData) const;
+
+  /**
+   * @brief Update the global scene with the new found camera pose and its a contrario threshold.
    * @param[in] viewIndex: image index added to the reconstruction.
    * @param[in] resectionData: contains the camera pose and all data used during the resection.
    */
   void updateScene(const IndexT viewIndex, const ResectionData& resectionData);
+
+  /**
+   * @brief Add the inlier observations of the resected views into the global scene structure.
+   * Observations are grouped per landmark, so each landmark is updated by a single thread.
+   * @param[in] viewIds: resected view ids.
+   * @param[in] resectionsData: resection data of each view, in the same order as viewIds.
+   */
+  void updateSceneObservations(const std::vector<IndexT>& viewIds, const std::vector<const ResectionData*>& resectionsData);
+
+  /**
+   * @brief Update the maximum size of the resection groups from the durations of the last resection group.
+   * @param[in] nbImages: number of images in the last resection group.
+   * @param[in] resectionDuration: duration of the resection of the last group (in milliseconds).
+   * @param[in] bundleAdjustmentDuration: duration of the bundle adjustment of the last group (in milliseconds).
+   */
+  void updateAdaptiveImagesPerGroup(std::size_t nbImages, double resectionDuration, double bundleAdjustmentDuration);
                    
   /**
    * @brief  Triangulate new possible 2D tracks
@@ -376,6 +430,7 @@ private:
 
   feature::FeaturesPerView* _featuresPerView;
   matching::PairwiseMatches* _pairwiseMatches;
+  track::TracksStore* _inputTracksStore = nullptr;
 
   // Pyramid scoring
 
@@ -388,15 +443,18 @@ private:
   /// List of views which are affected by a previous update
   std::set<IndexT> _registeredCandidatesViews;
 
-  /// Putative landmark tracks (visibility per potential 3D point)
-  track::TracksMap _map_tracks;
-  /// Putative tracks per view
-  track::TracksPerView _map_tracksPerView;
+  /// Putative landmark tracks (visibility per potential 3D point) in a compact layout, with a per-view index
+  track::TracksStore _tracksStore;
   /// Precomputed pyramid index for each trackId of each viewId.
   track::TracksPyramidPerView _map_featsPyramidPerView;
   /// Per camera confidence (A contrario estimated threshold error)
   HashMap<IndexT, double> _map_ACThreshold;
 
+  // Resection groups size
+
+  /// Current maximum number of images per resection group (if adaptiveImagesPerGroup is enabled)
+  std::size_t _adaptiveMaxImagesPerGroup = 0;
+
   // Local Bundle Adjustment data
 
   /// Contains all the data used by the Local BA approach
@@ -413,6 +471,8 @@ private:
   std::string _htmlLogFile;
   /// property tree for json stats export
   pt::ptree _jsonLogTree;
+  /// accumulated durations of the reconstruction steps
+  StepsDuration _stepsDuration;
 };
 
 } // namespace sfm
@@ -10,54 +10,236 @@
 #include <aliceVision/stl/stl.hpp>
 #include <aliceVision/system/Logger.hpp>
 #include <aliceVision/sfm/BundleAdjustment.hpp>
+#include <aliceVision/alicevision_omp.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <iterator>
 
 namespace aliceVision {
 namespace sfm {
 
+namespace {
+
+/**
+ * @brief Pose and intrinsic of a view, cached to avoid the map lookups per observation.
+ */
+struct ViewGeometry
+{
+  geometry::Pose3 pose;
+  const camera::IntrinsicBase* intrinsic = nullptr;
+};
+
+void getViewsGeometry(const sfmData::SfMData& sfmData, HashMap<IndexT, ViewGeometry>& out_viewsGeometry)
+{
+  out_viewsGeometry.clear();
+
+  for(const auto& viewPair : sfmData.getViews())
+  {
+    const sfmData::View& view = *viewPair.second;
+    if(!sfmData.isPoseAndIntrinsicDefined(&view))
+      continue;
+
+    ViewGeometry& viewGeometry = out_viewsGeometry[viewPair.first];
+    viewGeometry.pose = sfmData.getPose(view).getTransform();
+    viewGeometry.intrinsic = sfmData.getIntrinsicPtr(view.getIntrinsicId());
+  }
+}
+
+/**
+ * @return the cached geometry of the view or nullptr if the view has no defined pose or intrinsic
+ */
+const ViewGeometry* getViewGeometry(const HashMap<IndexT, ViewGeometry>& viewsGeometry, IndexT viewId)
+{
+  const auto it = viewsGeometry.find(viewId);
+  return (it == viewsGeometry.end()) ? nullptr : &it->second;
+}
+
+} // namespace
+
+std::size_t getObservationsPerView(const std::vector<const sfmData::Landmark*>& landmarks,
+                                   const std::vector<IndexT>& viewIds,
+                                   ObservationsPerView& out_observationsPerView)
+{
+  const std::size_t nbViews = viewIds.size();
+
+  HashMap<IndexT, std::size_t> viewIndexes;
+  viewIndexes.reserve(nbViews);
+  for(std::size_t v = 0; v < nbViews; ++v)
+    viewIndexes[viewIds[v]] = v;
+
+  // each thread handles a contiguous range of landmarks, the same one for the count and the scatter
+  const int nbThreads = omp_get_max_threads();
+  const std::size_t chunkSize = (landmarks.size() + nbThreads - 1) / nbThreads;
+  std::vector<std::vector<std::size_t>> countsPerThread(nbThreads, std::vector<std::size_t>(nbViews, 0));
+  std::atomic<std::size_t> nbSkipped(0);
+
+  // first pass (parallel): count the observations of each view
+  #pragma omp parallel for num_threads(nbThreads)
+  for(int t = 0; t < nbThreads; ++t)
+  {
+    std::vector<std::size_t>& counts = countsPerThread[t];
+    std::size_t localNbSkipped = 0;
+    const std::size_t end = std::min(landmarks.size(), (t + 1) * chunkSize);
+
+    for(std::size_t landmarkIndex = t * chunkSize; landmarkIndex < end; ++landmarkIndex)
+    {
+      for(const auto& obsPair : landmarks[landmarkIndex]->observations)
+      {
+        const auto it = viewIndexes.find(obsPair.first);
+        if(it == viewIndexes.end())
+          ++localNbSkipped;
+        else
+          ++counts[it->second];
+      }
+    }
+    nbSkipped += localNbSkipped;
+  }
+
+  // prefix sums: offset of each view, then of each thread inside each view
+  out_observationsPerView.viewIds = viewIds;
+  out_observationsPerView.offsets.assign(nbViews + 1, 0);
+  for(std::size_t v = 0; v < nbViews; ++v)
+  {
+    std::size_t offset = out_observationsPerView.offsets[v];
+    for(int t = 0; t < nbThreads; ++t)
+    {
+      const std::size_t count = countsPerThread[t][v];
+      countsPerThread[t][v] = offset;
+      offset += count;
+    }
+    out_observationsPerView.offsets[v + 1] = offset;
+  }
+
+  const std::size_t nbObservations = out_observationsPerView.offsets.back();
+  out_observationsPerView.landmarkIndexes.resize(nbObservations);
+  out_observationsPerView.observations.resize(nbObservations);
+
+  // second pass (parallel): scatter the observations in their view bucket
+  #pragma omp parallel for num_threads(nbThreads)
+  for(int t = 0; t < nbThreads; ++t)
+  {
+    std::vector<std::size_t>& writeOffsets = countsPerThread[t];
+    const std::size_t end = std::min(landmarks.size(), (t + 1) * chunkSize);
+
+    for(std::size_t landmarkIndex = t * chunkSize; landmarkIndex < end; ++landmarkIndex)
+    {
+      for(const auto& obsPair : landmarks[landmarkIndex]->observations)
+      {
+        const auto it = viewIndexes.find(obsPair.first);
+        if(it == viewIndexes.end())
+          continue;
+        const std::size_t j = writeOffsets[it->second]++;
+        out_observationsPerView.landmarkIndexes[j] = landmarkIndex;
+        out_observationsPerView.observations[j] = &obsPair.second;
+      }
+    }
+  }
+
+  return nbSkipped;
+}
+
 IndexT RemoveOutliers_PixelResidualError(sfmData::SfMData& sfmData,
                                          EFeatureConstraint featureConstraint,
                                          const double dThresholdPixel,
                                          const unsigned int minTrackLength)
 {
-  IndexT outlier_count = 0;
-  sfmData::Landmarks::iterator iterTracks = sfmData.structure.begin();
+  HashMap<IndexT, ViewGeometry> viewsGeometry;
+  getViewsGeometry(sfmData, viewsGeometry);
+
+  std::vector<sfmData::Landmarks::iterator> landmarks;
+  std::vector<const sfmData::Landmark*> landmarksPtr;
+  landmarks.reserve(sfmData.structure.size());
+  landmarksPtr.reserve(sfmData.structure.size());
+  for(auto it = sfmData.structure.begin(); it != sfmData.structure.end(); ++it)
+  {
+    landmarks.push_back(it);
+    landmarksPtr.push_back(&it->second);
+  }
+
+  // gather the observations per view, to project them by batch with the view geometry
+  std::vector<IndexT> viewIds;
+  viewIds.reserve(viewsGeometry.size());
+  for(const auto& viewGeometry : viewsGeometry)
+    viewIds.push_back(viewGeometry.first);
+  std::sort(viewIds.begin(), viewIds.end());
 
+  ObservationsPerView observationsPerView;
+  if(getObservationsPerView(landmarksPtr, viewIds, observationsPerView) > 0)
+    ALICEVISION_THROW_ERROR("RemoveOutliers_PixelResidualError: landmark observed by a view without a defined pose or intrinsic.");
 
-  while(iterTracks != sfmData.structure.end())
+  // first pass (parallel): find outlier observations, sfmData is not modified
+  std::vector<std::pair<std::size_t, IndexT>> outlierObservations; // (landmark index, view id)
+
+  #pragma omp parallel
   {
-    sfmData::Observations & observations = iterTracks->second.observations;
-    sfmData::Observations::iterator itObs = observations.begin();
+    std::vector<std::pair<std::size_t, IndexT>> localOutlierObservations;
 
-    while(itObs != observations.end())
+    #pragma omp for schedule(dynamic)
+    for(int v = 0; v < viewIds.size(); ++v)
     {
-      const sfmData::View * view = sfmData.views.at(itObs->first).get();
-      const geometry::Pose3 pose = sfmData.getPose(*view).getTransform();
-      const camera::IntrinsicBase * intrinsic = sfmData.intrinsics.at(view->getIntrinsicId()).get();
+      const IndexT viewId = viewIds[v];
+      const ViewGeometry& viewGeometry = *getViewGeometry(viewsGeometry, viewId);
+      const std::size_t begin = observationsPerView.offsets[v];
+      const std::size_t nbObservations = observationsPerView.offsets[v + 1] - begin;
+      if(nbObservations == 0)
+        continue;
 
-      Vec2 residual = intrinsic->residual(pose, iterTracks->second.X.homogeneous(), itObs->second.x);
-      if(featureConstraint == EFeatureConstraint::SCALE && itObs->second.scale > 0.0)
-      {
-          // Apply the scale of the feature to get a residual value
-          // relative to the feature precision.
-          residual /= itObs->second.scale;
-      }
+      Mat3X pts3D(3, nbObservations);
+      for(std::size_t j = 0; j < nbObservations; ++j)
+        pts3D.col(j) = landmarksPtr[observationsPerView.landmarkIndexes[begin + j]]->X;
+
+      Mat2X projected;
+      viewGeometry.intrinsic->projectPoints(viewGeometry.pose, pts3D, projected);
 
-      if((pose.depth(iterTracks->second.X) < 0) || (residual.norm() > dThresholdPixel))
+      for(std::size_t j = 0; j < nbObservations; ++j)
       {
-        ++outlier_count;
-        itObs = observations.erase(itObs);
+        const sfmData::Observation& observation = *observationsPerView.observations[begin + j];
+
+        Vec2 residual = observation.x - projected.col(j);
+        if(featureConstraint == EFeatureConstraint::SCALE && observation.scale > 0.0)
+        {
+            // Apply the scale of the feature to get a residual value
+            // relative to the feature precision.
+            residual /= observation.scale;
+        }
+
+        if((viewGeometry.pose.depth(pts3D.col(j)) < 0) || (residual.norm() > dThresholdPixel))
+          localOutlierObservations.emplace_back(observationsPerView.landmarkIndexes[begin + j], viewId);
       }
-      else
-        ++itObs;
     }
 
-    if (observations.empty() || observations.size() < minTrackLength)
-      iterTracks = sfmData.structure.erase(iterTracks);
-    else
-      ++iterTracks;
+    #pragma omp critical
+    outlierObservations.insert(outlierObservations.end(), localOutlierObservations.begin(), localOutlierObservations.end());
+  }
+
+  const IndexT outlier_count = outlierObservations.size();
+
+  // landmarks without enough inliers are removed
+  std::vector<std::size_t> nbOutliersPerLandmark(landmarks.size(), 0);
+  for(const auto& outlierObservation : outlierObservations)
+    ++nbOutliersPerLandmark[outlierObservation.first];
+
+  std::vector<bool> landmarksToErase(landmarks.size(), false);
+  for(std::size_t landmarkIndex = 0; landmarkIndex < landmarks.size(); ++landmarkIndex)
+  {
+    const std::size_t nbInliers = landmarks[landmarkIndex]->second.observations.size() - nbOutliersPerLandmark[landmarkIndex];
+    landmarksToErase[landmarkIndex] = (nbInliers == 0 || nbInliers < minTrackLength);
+  }
+
+  // second pass (sequential): remove outliers
+  for(const auto& outlierObservation : outlierObservations)
+  {
+    if(!landmarksToErase[outlierObservation.first])
+      landmarks[outlierObservation.first]->second.observations.erase(outlierObservation.second);
+  }
+
+  for(std::size_t landmarkIndex = 0; landmarkIndex < landmarks.size(); ++landmarkIndex)
+  {
+    if(landmarksToErase[landmarkIndex])
+      sfmData.structure.erase(landmarks[landmarkIndex]);
   }
+
   return outlier_count;
 }
 
@@ -70,9 +252,17 @@ IndexT RemoveOutliers_AngleError(sfmData::SfMData& sfmData, const double dMinAcc
   LandmarksKeysVec v_keys; v_keys.reserve(sfmData.structure.size());
   std::transform(sfmData.structure.cbegin(), sfmData.structure.cend(), std::back_inserter(v_keys), stl::RetrieveKey());
 
+  HashMap<IndexT, ViewGeometry> viewsGeometry;
+  getViewsGeometry(sfmData, viewsGeometry);
+
   LandmarksKeysVec toErase;
+  std::atomic<bool> invalidObservation(false); // no exception can leave the parallel region, set by several threads
 
-  #pragma omp parallel for
+  #pragma omp parallel
+  {
+  LandmarksKeysVec localToErase;
+
+  #pragma omp for schedule(dynamic, 1024)
   for (int landmarkIndex = 0; landmarkIndex < v_keys.size(); ++landmarkIndex)
   {
     const sfmData::Observations &observations = sfmData.structure.at(v_keys[landmarkIndex]).observations;
@@ -93,11 +283,15 @@ IndexT RemoveOutliers_AngleError(sfmData::SfMData& sfmData, const double dMinAcc
     // fill matrix, optimistically checking each new entry against col(greedyI)
     for(itObs = observations.begin(), i = 0; itObs != observations.end(); ++itObs, ++i)
     {
-      const sfmData::View * view = sfmData.views.at(itObs->first).get();
-      const geometry::Pose3 pose = sfmData.getPose(*view).getTransform();
-      const camera::IntrinsicBase * intrinsic = sfmData.intrinsics.at(view->getIntrinsicId()).get();
+      const ViewGeometry* viewGeometry = getViewGeometry(viewsGeometry, itObs->first);
+      if(viewGeometry == nullptr)
+      {
+        invalidObservation = true;
+        viewDirections.col(i).setZero();
+        continue;
+      }
 
-      viewDirections.col(i) = applyIntrinsicExtrinsic(pose, intrinsic, itObs->second.x);
+      viewDirections.col(i) = applyIntrinsicExtrinsic(viewGeometry->pose, viewGeometry->intrinsic, itObs->second.x);
 
       double dCosAngle = viewDirections.col(i).transpose() * viewDirections.col(greedyI);
       if (dCosAngle < dMaxAcceptedCosAngle)
@@ -139,11 +333,17 @@ IndexT RemoveOutliers_AngleError(sfmData::SfMData& sfmData, const double dMinAcc
     // acceptable angle not found
     if (i == 0)
     {
-      #pragma omp critical
-      toErase.push_back(v_keys[landmarkIndex]);
+      localToErase.push_back(v_keys[landmarkIndex]);
     }
   }
 
+  #pragma omp critical
+  toErase.insert(toErase.end(), localToErase.begin(), localToErase.end());
+  }
+
+  if(invalidObservation)
+    ALICEVISION_THROW_ERROR("RemoveOutliers_AngleError: landmark observed by a view without a defined pose or intrinsic.");
+
   for (IndexT key : toErase)
   {
     sfmData.structure.erase(key);
@@ -10,10 +10,14 @@
 #include <aliceVision/types.hpp>
 #include <aliceVision/sfm/BundleAdjustment.hpp>
 
+#include <vector>
+
 namespace aliceVision {
 
 namespace sfmData {
 class SfMData;
+struct Landmark;
+struct Observation;
 } // namespace sfmData
 
 namespace sfm {
@@ -31,6 +35,32 @@ inline PairSet Pair_filter(const IterablePairs& pairs, const IterableIndex& inde
   return kept_pairs;
 }
 
+/**
+ * @brief Observations of a set of landmarks, grouped by view.
+ * The observations of the view viewIds[i] are in [offsets[i], offsets[i+1]).
+ */
+struct ObservationsPerView
+{
+  std::vector<IndexT> viewIds;
+  std::vector<std::size_t> offsets;
+  /// index of the observing landmark in the input landmark list
+  std::vector<std::size_t> landmarkIndexes;
+  std::vector<const sfmData::Observation*> observations;
+};
+
+/**
+ * @brief Group the observations of the given landmarks by view.
+ * The buckets are built in parallel (count, prefix sum and scatter), the observations of a view
+ * keep the order of the input landmarks.
+ * @param[in] landmarks the landmarks
+ * @param[in] viewIds the views to gather, the observations of the other views are skipped
+ * @param[out] out_observationsPerView the observations grouped by view, in the order of viewIds
+ * @return the number of skipped observations
+ */
+std::size_t getObservationsPerView(const std::vector<const sfmData::Landmark*>& landmarks,
+                                   const std::vector<IndexT>& viewIds,
+                                   ObservationsPerView& out_observationsPerView);
+
 /// Remove observations with too large reprojection error.
 /// Return the number of removed tracks.
 IndexT RemoveOutliers_PixelResidualError(sfmData::SfMData& sfmData,
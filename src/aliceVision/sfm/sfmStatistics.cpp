@@ -5,6 +5,7 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "sfmStatistics.hpp"
+#include "sfmFilters.hpp"
 
 #include <aliceVision/sfm/pipeline/localization/SfMLocalizer.hpp>
 
@@ -16,6 +17,76 @@
 namespace aliceVision {
 namespace sfm {
 
+namespace {
+
+/**
+ * @brief Compute the reprojection error norms of the observations of each view.
+ * The observations are gathered per view to be projected by batch with the view pose and intrinsic.
+ * @param[in] sfmData the scene
+ * @param[in] specificViews the views to use (all the views if empty)
+ * @param[out] out_residualsPerView the residual norms of the observations of each view
+ */
+void computeResidualNormsPerView(const sfmData::SfMData& sfmData, const std::set<IndexT>& specificViews,
+                                 std::map<IndexT, std::vector<double>>& out_residualsPerView)
+{
+  std::vector<const sfmData::Landmark*> landmarks;
+  landmarks.reserve(sfmData.getLandmarks().size());
+  for(const auto& landmarkPair : sfmData.getLandmarks())
+    landmarks.push_back(&landmarkPair.second);
+
+  std::vector<IndexT> viewIds;
+  if(specificViews.empty())
+  {
+    viewIds.reserve(sfmData.getViews().size());
+    for(const auto& viewPair : sfmData.getViews())
+      viewIds.push_back(viewPair.first);
+    std::sort(viewIds.begin(), viewIds.end());
+  }
+  else
+  {
+    viewIds.assign(specificViews.begin(), specificViews.end());
+  }
+
+  ObservationsPerView observationsPerView;
+  if(getObservationsPerView(landmarks, viewIds, observationsPerView) > 0 && specificViews.empty())
+    ALICEVISION_THROW_ERROR("computeResidualNormsPerView: landmark observed by an unknown view.");
+
+  // the buckets are inserted sequentially, then each thread only fills the residuals of its views
+  std::vector<std::vector<double>*> residualsPerView(viewIds.size(), nullptr);
+  for(std::size_t v = 0; v < viewIds.size(); ++v)
+  {
+    if(observationsPerView.offsets[v + 1] > observationsPerView.offsets[v])
+      residualsPerView[v] = &out_residualsPerView[viewIds[v]];
+  }
+
+  #pragma omp parallel for schedule(dynamic)
+  for(int v = 0; v < viewIds.size(); ++v)
+  {
+    if(residualsPerView[v] == nullptr)
+      continue;
+
+    const sfmData::View& view = sfmData.getView(viewIds[v]);
+    const geometry::Pose3 pose = sfmData.getPose(view).getTransform();
+    const camera::IntrinsicBase* intrinsic = sfmData.getIntrinsicPtr(view.getIntrinsicId());
+
+    const std::size_t begin = observationsPerView.offsets[v];
+    const std::size_t nbObservations = observationsPerView.offsets[v + 1] - begin;
+    Mat3X pts3D(3, nbObservations);
+    for(std::size_t j = 0; j < nbObservations; ++j)
+      pts3D.col(j) = landmarks[observationsPerView.landmarkIndexes[begin + j]]->X;
+
+    Mat2X projected;
+    intrinsic->projectPoints(pose, pts3D, projected);
+
+    std::vector<double>& residuals = *residualsPerView[v];
+    residuals.resize(nbObservations);
+    for(std::size_t j = 0; j < nbObservations; ++j)
+      residuals[j] = (observationsPerView.observations[begin + j]->x - projected.col(j)).norm();
+  }
+}
+
+} // namespace
+
 void computeResidualsHistogram(const sfmData::SfMData& sfmData, BoxStats<double>& out_stats, utils::Histogram<double>* out_histogram, const std::set<IndexT>& specificViews)
 {
   {
@@ -30,27 +101,13 @@ void computeResidualsHistogram(const sfmData::SfMData& sfmData, BoxStats<double>
     return;
 
   // Collect residuals for each observation
+  std::map<IndexT, std::vector<double>> residualsPerView;
+  computeResidualNormsPerView(sfmData, specificViews, residualsPerView);
+
   std::vector<double> vec_residuals;
   vec_residuals.reserve(sfmData.structure.size());
-
-  for(const auto &track : sfmData.getLandmarks())
-  {
-    const aliceVision::sfmData::Observations & observations = track.second.observations;
-    for(const auto& obs: observations)
-    {
-      if(!specificViews.empty())
-      {
-          if(specificViews.count(obs.first) == 0)
-              continue;
-      }
-      const sfmData::View& view = sfmData.getView(obs.first);
-      const aliceVision::geometry::Pose3 pose = sfmData.getPose(view).getTransform();
-      const std::shared_ptr<aliceVision::camera::IntrinsicBase> intrinsic = sfmData.getIntrinsics().find(view.getIntrinsicId())->second;
-      const Vec2 residual = intrinsic->residual(pose, track.second.X.homogeneous(), obs.second.x);
-      vec_residuals.push_back(residual.norm());
-      //ALICEVISION_LOG_INFO("[AliceVision] sfmtstatistics::computeResidualsHistogram track: " << track.first << ", residual: " << residual.norm());
-    }
-  }
+  for(const auto& viewResiduals : residualsPerView)
+    vec_residuals.insert(vec_residuals.end(), viewResiduals.second.begin(), viewResiduals.second.end());
 
  // ALICEVISION_LOG_INFO("[AliceVision] sfmtstatistics::computeResidualsHistogram vec_residuals.size(): " << vec_residuals.size());
 
@@ -145,7 +202,7 @@ void computeLandmarksPerViewHistogram(const sfmData::SfMData& sfmData, BoxStats<
             if(it != nbLandmarksPerView.end())
                 ++(it->second);
             else
-                it->second = 1;
+                nbLandmarksPerView[viewId] = 1;
         }
     }
     if(nbLandmarksPerView.empty())
@@ -320,19 +377,7 @@ void computeResidualsPerView(const sfmData::SfMData& sfmData, int& nbViews, std:
 
     // Collect residuals (number of residuals per 3D points) of all landmarks visible in each view
     std::map<IndexT, std::vector<double>> residualsPerView;
-
-    for(const auto &landmark : sfmData.getLandmarks())
-    {
-      const aliceVision::sfmData::Observations & observations = landmark.second.observations;
-      for(const auto& obs: observations)
-      {
-        const sfmData::View& view = sfmData.getView(obs.first);
-        const aliceVision::geometry::Pose3 pose = sfmData.getPose(view).getTransform();
-        const std::shared_ptr<aliceVision::camera::IntrinsicBase> intrinsic = sfmData.getIntrinsics().find(view.getIntrinsicId())->second;
-        const Vec2 residual = intrinsic->residual(pose, landmark.second.X.homogeneous(), obs.second.x);
-        residualsPerView[obs.first].push_back(residual.norm());
-      }
-    }
+    computeResidualNormsPerView(sfmData, std::set<IndexT>(), residualsPerView);
 
     std::vector<IndexT> viewKeys;
     for(const auto& v: sfmData.getViews())
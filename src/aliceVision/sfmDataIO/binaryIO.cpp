@@ -0,0 +1,572 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "binaryIO.hpp"
+#include <aliceVision/sfmDataIO/jsonIO.hpp>
+#include <aliceVision/system/Logger.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace aliceVision {
+namespace sfmDataIO {
+
+namespace {
+
+const char binaryMagic[6] = {'A', 'V', 'S', 'F', 'M', 'B'};
+const std::uint32_t binaryFormatVersion = 1;
+
+enum class ESection : std::uint32_t
+{
+  FOLDERS = 1,
+  VIEWS = 2,
+  INTRINSICS = 3,
+  POSES = 4,
+  RIGS = 5,
+  STRUCTURE = 6,
+  CONTROL_POINTS = 7
+};
+
+template <typename T>
+inline void writeValue(std::ostream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline void readValue(std::istream& stream, T& value)
+{
+  stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+/// copy a value from a buffer and move the buffer pointer
+template <typename T>
+inline void readValue(const char*& buffer, T& value)
+{
+  std::memcpy(&value, buffer, sizeof(T));
+  buffer += sizeof(T);
+}
+
+/**
+ * @brief Write the section type and size around the section data.
+ * The size is only known at the end, the placeholder is updated by end().
+ */
+class SectionWriter
+{
+public:
+  SectionWriter(std::ostream& stream, ESection section)
+    : _stream(stream)
+  {
+    writeValue(_stream, static_cast<std::uint32_t>(section));
+    _sizePosition = _stream.tellp();
+    writeValue(_stream, std::uint64_t(0));
+    _dataPosition = _stream.tellp();
+  }
+
+  void end()
+  {
+    const std::streampos endPosition = _stream.tellp();
+    _stream.seekp(_sizePosition);
+    writeValue(_stream, static_cast<std::uint64_t>(endPosition - _dataPosition));
+    _stream.seekp(endPosition);
+  }
+
+private:
+  std::ostream& _stream;
+  std::streampos _sizePosition;
+  std::streampos _dataPosition;
+};
+
+void writeJSONSection(std::ostream& stream, ESection section, const bpt::ptree& tree)
+{
+  std::ostringstream json;
+  bpt::write_json(json, tree, false);
+  const std::string data = json.str();
+
+  SectionWriter writer(stream, section);
+  stream.write(data.data(), data.size());
+  writer.end();
+}
+
+void readJSONSection(std::istream& stream, std::uint64_t size, bpt::ptree& tree)
+{
+  std::string data(size, '\0');
+  stream.read(&data[0], size);
+  std::istringstream json(data);
+  bpt::read_json(json, tree);
+}
+
+void writePoses(std::ostream& stream, const sfmData::Poses& poses)
+{
+  SectionWriter writer(stream, ESection::POSES);
+  writeValue(stream, static_cast<std::uint64_t>(poses.size()));
+
+  for(const auto& posePair : poses)
+  {
+    const geometry::Pose3& transform = posePair.second.getTransform();
+    const Mat3& rotation = transform.rotation();
+    const Vec3 center = transform.center();
+
+    writeValue(stream, static_cast<std::uint32_t>(posePair.first));
+    stream.write(reinterpret_cast<const char*>(rotation.data()), 9 * sizeof(double));
+    stream.write(reinterpret_cast<const char*>(center.data()), 3 * sizeof(double));
+    writeValue(stream, static_cast<std::uint8_t>(posePair.second.isLocked()));
+  }
+  writer.end();
+}
+
+void readPoses(std::istream& stream, sfmData::Poses& poses)
+{
+  std::uint64_t nbPoses;
+  readValue(stream, nbPoses);
+
+  for(std::uint64_t i = 0; i < nbPoses && stream; ++i)
+  {
+    std::uint32_t poseId;
+    Mat3 rotation;
+    Vec3 center;
+    std::uint8_t locked;
+
+    readValue(stream, poseId);
+    stream.read(reinterpret_cast<char*>(rotation.data()), 9 * sizeof(double));
+    stream.read(reinterpret_cast<char*>(center.data()), 3 * sizeof(double));
+    readValue(stream, locked);
+
+    poses.emplace(poseId, sfmData::CameraPose(geometry::Pose3(rotation, center), locked != 0));
+  }
+}
+
+/**
+ * @brief Write landmarks (structure or control points).
+ * Landmark record: id (uint32), describer type (int32), X (3 x double), color (3 x uint8), number of observations (uint32)
+ * followed by the observation records: view id (uint32) [feature id (uint32), x (2 x double), scale (double)]
+ */
+void writeLandmarks(std::ostream& stream, ESection section, const sfmData::Landmarks& landmarks, bool saveObservations, bool saveFeatures)
+{
+  SectionWriter writer(stream, section);
+  writeValue(stream, static_cast<std::uint64_t>(landmarks.size()));
+  writeValue(stream, static_cast<std::uint8_t>(saveObservations));
+  writeValue(stream, static_cast<std::uint8_t>(saveFeatures));
+
+  for(const auto& landmarkPair : landmarks)
+  {
+    const sfmData::Landmark& landmark = landmarkPair.second;
+
+    writeValue(stream, static_cast<std::uint32_t>(landmarkPair.first));
+    writeValue(stream, static_cast<std::int32_t>(landmark.descType));
+    stream.write(reinterpret_cast<const char*>(landmark.X.data()), 3 * sizeof(double));
+    writeValue(stream, landmark.rgb.r());
+    writeValue(stream, landmark.rgb.g());
+    writeValue(stream, landmark.rgb.b());
+    writeValue(stream, static_cast<std::uint32_t>(saveObservations ? landmark.observations.size() : 0));
+
+    if(!saveObservations)
+      continue;
+
+    for(const auto& observationPair : landmark.observations)
+    {
+      writeValue(stream, static_cast<std::uint32_t>(observationPair.first));
+
+      if(saveFeatures)
+      {
+        const sfmData::Observation& observation = observationPair.second;
+        writeValue(stream, static_cast<std::uint32_t>(observation.id_feat));
+        stream.write(reinterpret_cast<const char*>(observation.x.data()), 2 * sizeof(double));
+        writeValue(stream, observation.scale);
+      }
+    }
+  }
+  writer.end();
+}
+
+void readLandmarks(std::istream& stream, sfmData::Landmarks& landmarks, bool loadObservations, bool loadFeatures)
+{
+  std::uint64_t nbLandmarks;
+  std::uint8_t hasObservations;
+  std::uint8_t hasFeatures;
+
+  readValue(stream, nbLandmarks);
+  readValue(stream, hasObservations);
+  readValue(stream, hasFeatures);
+
+  const std::size_t observationRecordSize = sizeof(std::uint32_t) + (hasFeatures ? sizeof(std::uint32_t) + 3 * sizeof(double) : 0);
+  loadFeatures = loadFeatures && hasFeatures;
+
+  std::vector<char> observationsBuffer;
+
+  for(std::uint64_t i = 0; i < nbLandmarks && stream; ++i)
+  {
+    std::uint32_t landmarkId;
+    std::int32_t descType;
+    std::uint32_t nbObservations;
+    sfmData::Landmark landmark;
+
+    readValue(stream, landmarkId);
+    readValue(stream, descType);
+    stream.read(reinterpret_cast<char*>(landmark.X.data()), 3 * sizeof(double));
+    readValue(stream, landmark.rgb.r());
+    readValue(stream, landmark.rgb.g());
+    readValue(stream, landmark.rgb.b());
+    readValue(stream, nbObservations);
+    landmark.descType = static_cast<feature::EImageDescriberType>(descType);
+
+    const std::size_t observationsSize = nbObservations * observationRecordSize;
+
+    if(!loadObservations)
+    {
+      stream.seekg(observationsSize, std::ios::cur);
+    }
+    else if(nbObservations > 0)
+    {
+      observationsBuffer.resize(observationsSize);
+      stream.read(observationsBuffer.data(), observationsSize);
+
+      // observations are saved in view id order
+      landmark.observations.reserve(nbObservations);
+      const char* buffer = observationsBuffer.data();
+      for(std::uint32_t o = 0; o < nbObservations; ++o)
+      {
+        std::uint32_t viewId;
+        sfmData::Observation observation;
+
+        readValue(buffer, viewId);
+        if(hasFeatures)
+        {
+          std::uint32_t featureId;
+          Vec2 x;
+          double scale;
+
+          readValue(buffer, featureId);
+          readValue(buffer, x(0));
+          readValue(buffer, x(1));
+          readValue(buffer, scale);
+
+          if(loadFeatures)
+          {
+            observation.id_feat = featureId;
+            observation.x = x;
+            observation.scale = scale;
+          }
+        }
+        landmark.observations.emplace_hint(landmark.observations.end(), viewId, observation);
+      }
+    }
+
+    landmarks.emplace(landmarkId, std::move(landmark));
+  }
+}
+
+} // namespace
+
+bool saveBinary(const sfmData::SfMData& sfmData, const std::string& filename, ESfMData partFlag)
+{
+  // save flags
+  const bool saveViews = (partFlag & VIEWS) == VIEWS;
+  const bool saveIntrinsics = (partFlag & INTRINSICS) == INTRINSICS;
+  const bool saveExtrinsics = (partFlag & EXTRINSICS) == EXTRINSICS;
+  const bool saveStructure = (partFlag & STRUCTURE) == STRUCTURE;
+  const bool saveControlPoints = (partFlag & CONTROL_POINTS) == CONTROL_POINTS;
+  const bool saveFeatures = (partFlag & OBSERVATIONS_WITH_FEATURES) == OBSERVATIONS_WITH_FEATURES;
+  const bool saveObservations = saveFeatures || ((partFlag & OBSERVATIONS) == OBSERVATIONS);
+
+  std::ofstream stream(filename, std::ios::binary);
+  if(!stream.is_open())
+  {
+    ALICEVISION_LOG_ERROR("Cannot open the file '" << filename << "' for writing.");
+    return false;
+  }
+
+  // header
+  stream.write(binaryMagic, sizeof(binaryMagic));
+  writeValue(stream, binaryFormatVersion);
+  writeValue(stream, static_cast<std::int32_t>(ALICEVISION_SFMDATAIO_VERSION_MAJOR));
+  writeValue(stream, static_cast<std::int32_t>(ALICEVISION_SFMDATAIO_VERSION_MINOR));
+  writeValue(stream, static_cast<std::int32_t>(ALICEVISION_SFMDATAIO_VERSION_REVISION));
+
+  // folders
+  if(!sfmData.getRelativeFeaturesFolders().empty() || !sfmData.getRelativeMatchesFolders().empty())
+  {
+    bpt::ptree foldersTree;
+    bpt::ptree featureFoldersTree;
+    bpt::ptree matchingFoldersTree;
+
+    for(const std::string& featuresFolder : sfmData.getRelativeFeaturesFolders())
+    {
+      bpt::ptree featureFolderTree;
+      featureFolderTree.put("", featuresFolder);
+      featureFoldersTree.push_back(std::make_pair("", featureFolderTree));
+    }
+
+    for(const std::string& matchesFolder : sfmData.getRelativeMatchesFolders())
+    {
+      bpt::ptree matchingFolderTree;
+      matchingFolderTree.put("", matchesFolder);
+      matchingFoldersTree.push_back(std::make_pair("", matchingFolderTree));
+    }
+
+    foldersTree.add_child("featuresFolders", featureFoldersTree);
+    foldersTree.add_child("matchesFolders", matchingFoldersTree);
+    writeJSONSection(stream, ESection::FOLDERS, foldersTree);
+  }
+
+  // views
+  if(saveViews && !sfmData.getViews().empty())
+  {
+    bpt::ptree viewsTree;
+
+    for(const auto& viewPair : sfmData.getViews())
+      saveView("", *(viewPair.second), viewsTree);
+
+    bpt::ptree sectionTree;
+    sectionTree.add_child("views", viewsTree);
+    writeJSONSection(stream, ESection::VIEWS, sectionTree);
+  }
+
+  // intrinsics
+  if(saveIntrinsics && !sfmData.getIntrinsics().empty())
+  {
+    bpt::ptree intrinsicsTree;
+
+    for(const auto& intrinsicPair : sfmData.getIntrinsics())
+      saveIntrinsic("", intrinsicPair.first, intrinsicPair.second, intrinsicsTree);
+
+    bpt::ptree sectionTree;
+    sectionTree.add_child("intrinsics", intrinsicsTree);
+    writeJSONSection(stream, ESection::INTRINSICS, sectionTree);
+  }
+
+  // extrinsics
+  if(saveExtrinsics)
+  {
+    if(!sfmData.getPoses().empty())
+      writePoses(stream, sfmData.getPoses());
+
+    if(!sfmData.getRigs().empty())
+    {
+      bpt::ptree rigsTree;
+
+      for(const auto& rigPair : sfmData.getRigs())
+        saveRig("", rigPair.first, rigPair.second, rigsTree);
+
+      bpt::ptree sectionTree;
+      sectionTree.add_child("rigs", rigsTree);
+      writeJSONSection(stream, ESection::RIGS, sectionTree);
+    }
+  }
+
+  // structure
+  if(saveStructure && !sfmData.getLandmarks().empty())
+    writeLandmarks(stream, ESection::STRUCTURE, sfmData.getLandmarks(), saveObservations, saveFeatures);
+
+  // control points
+  if(saveControlPoints && !sfmData.getControlPoints().empty())
+    writeLandmarks(stream, ESection::CONTROL_POINTS, sfmData.getControlPoints(), true, true);
+
+  stream.close();
+
+  if(stream.fail())
+  {
+    ALICEVISION_LOG_ERROR("Failed to write the file '" << filename << "'.");
+    return false;
+  }
+  return true;
+}
+
+bool loadBinary(sfmData::SfMData& sfmData, const std::string& filename, ESfMData partFlag)
+{
+  // load flags
+  const bool loadViews = (partFlag & VIEWS) == VIEWS;
+  const bool loadIntrinsics = (partFlag & INTRINSICS) == INTRINSICS;
+  const bool loadExtrinsics = (partFlag & EXTRINSICS) == EXTRINSICS;
+  const bool loadStructure = (partFlag & STRUCTURE) == STRUCTURE;
+  const bool loadControlPoints = (partFlag & CONTROL_POINTS) == CONTROL_POINTS;
+  const bool loadFeatures = (partFlag & OBSERVATIONS_WITH_FEATURES) == OBSERVATIONS_WITH_FEATURES;
+  const bool loadObservations = loadFeatures || ((partFlag & OBSERVATIONS) == OBSERVATIONS);
+
+  std::ifstream stream(filename, std::ios::binary);
+  if(!stream.is_open())
+  {
+    ALICEVISION_LOG_ERROR("Cannot open the file '" << filename << "'.");
+    return false;
+  }
+
+  // header
+  char magic[sizeof(binaryMagic)];
+  std::uint32_t formatVersion = 0;
+  Vec3i v;
+
+  stream.read(magic, sizeof(magic));
+  readValue(stream, formatVersion);
+  for(int i = 0; i < 3; ++i)
+  {
+    std::int32_t value;
+    readValue(stream, value);
+    v(i) = value;
+  }
+
+  if(!stream || std::memcmp(magic, binaryMagic, sizeof(magic)) != 0)
+  {
+    ALICEVISION_LOG_ERROR("The file '" << filename << "' is not a binary SfMData file.");
+    return false;
+  }
+
+  if(formatVersion > binaryFormatVersion)
+  {
+    ALICEVISION_LOG_ERROR("The binary SfMData file '" << filename << "' has an unsupported format version (" << formatVersion << ").");
+    return false;
+  }
+
+  const Version version(v);
+
+  // sections
+  while(true)
+  {
+    std::uint32_t sectionType;
+    std::uint64_t sectionSize;
+
+    readValue(stream, sectionType);
+    if(stream.eof())
+      break;
+    readValue(stream, sectionSize);
+
+    if(!stream)
+    {
+      ALICEVISION_LOG_ERROR("The binary SfMData file '" << filename << "' is truncated.");
+      return false;
+    }
+
+    const std::streampos sectionEnd = stream.tellg() + static_cast<std::streamoff>(sectionSize);
+
+    switch(static_cast<ESection>(sectionType))
+    {
+      case ESection::FOLDERS:
+      {
+        bpt::ptree tree;
+        readJSONSection(stream, sectionSize, tree);
+
+        for(bpt::ptree::value_type& featureFolderNode : tree.get_child("featuresFolders"))
+          sfmData.addFeaturesFolder(featureFolderNode.second.get_value<std::string>());
+
+        for(bpt::ptree::value_type& matchingFolderNode : tree.get_child("matchesFolders"))
+          sfmData.addMatchesFolder(matchingFolderNode.second.get_value<std::string>());
+        break;
+      }
+      case ESection::VIEWS:
+      {
+        if(!loadViews)
+        {
+          stream.seekg(sectionEnd);
+          break;
+        }
+
+        bpt::ptree tree;
+        readJSONSection(stream, sectionSize, tree);
+
+        sfmData::Views& views = sfmData.getViews();
+        for(bpt::ptree::value_type& viewNode : tree.get_child("views"))
+        {
+          sfmData::View view;
+          loadView(view, viewNode.second);
+          views.emplace(view.getViewId(), std::make_shared<sfmData::View>(view));
+        }
+        break;
+      }
+      case ESection::INTRINSICS:
+      {
+        if(!loadIntrinsics)
+        {
+          stream.seekg(sectionEnd);
+          break;
+        }
+
+        bpt::ptree tree;
+        readJSONSection(stream, sectionSize, tree);
+
+        sfmData::Intrinsics& intrinsics = sfmData.getIntrinsics();
+        for(bpt::ptree::value_type& intrinsicNode : tree.get_child("intrinsics"))
+        {
+          IndexT intrinsicId;
+          std::shared_ptr<camera::IntrinsicBase> intrinsic;
+
+          loadIntrinsic(version, intrinsicId, intrinsic, intrinsicNode.second);
+
+          intrinsics.emplace(intrinsicId, intrinsic);
+        }
+        break;
+      }
+      case ESection::POSES:
+      {
+        if(loadExtrinsics)
+          readPoses(stream, sfmData.getPoses());
+        else
+          stream.seekg(sectionEnd);
+        break;
+      }
+      case ESection::RIGS:
+      {
+        if(!loadExtrinsics)
+        {
+          stream.seekg(sectionEnd);
+          break;
+        }
+
+        bpt::ptree tree;
+        readJSONSection(stream, sectionSize, tree);
+
+        sfmData::Rigs& rigs = sfmData.getRigs();
+        for(bpt::ptree::value_type& rigNode : tree.get_child("rigs"))
+        {
+          IndexT rigId;
+          sfmData::Rig rig;
+
+          loadRig(rigId, rig, rigNode.second);
+
+          rigs.emplace(rigId, rig);
+        }
+        break;
+      }
+      case ESection::STRUCTURE:
+      {
+        if(loadStructure)
+          readLandmarks(stream, sfmData.getLandmarks(), loadObservations, loadFeatures);
+        else
+          stream.seekg(sectionEnd);
+        break;
+      }
+      case ESection::CONTROL_POINTS:
+      {
+        if(loadControlPoints)
+          readLandmarks(stream, sfmData.getControlPoints(), true, true);
+        else
+          stream.seekg(sectionEnd);
+        break;
+      }
+      default:
+      {
+        // unknown section (newer minor format version), skip it
+        ALICEVISION_LOG_DEBUG("Skip unknown section " << sectionType << " in the binary SfMData file '" << filename << "'.");
+        stream.seekg(sectionEnd);
+        break;
+      }
+    }
+
+    if(!stream || stream.tellg() != sectionEnd)
+    {
+      ALICEVISION_LOG_ERROR("The binary SfMData file '" << filename << "' is corrupted (section " << sectionType << ").");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace sfmDataIO
+} // namespace aliceVision
@@ -0,0 +1,48 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/sfmDataIO/sfmDataIO.hpp>
+
+#include <string>
+
+namespace aliceVision {
+namespace sfmDataIO {
+
+// AliceVision binary SfMData file (.sfmb):
+// -- Header
+// magic "AVSFMB", binary format version (uint32), sfmDataIO version (3 x int32)
+// -- Sections, until the end of the file
+// section type (uint32), section size in bytes (uint64), section data
+// --
+// Each section can be skipped without being parsed.
+// Folders, views, intrinsics and rigs are small and metadata-rich: their section data is the JSON
+// serialization used in .sfm files. Poses, structure and control points are stored as raw binary records,
+// landmarks are streamed one by one without any intermediate document.
+// Values are stored in the native (little-endian) byte order.
+
+/**
+ * @brief Save an SfMData in a binary chunked file.
+ * @param[in] sfmData The input SfMData
+ * @param[in] filename The filename
+ * @param[in] partFlag The ESfMData save flag
+ * @return true if completed
+ */
+bool saveBinary(const sfmData::SfMData& sfmData, const std::string& filename, ESfMData partFlag);
+
+/**
+ * @brief Load a binary chunked SfMData file.
+ * @note The sections not requested by partFlag are skipped without being read.
+ * @param[out] sfmData The output SfMData
+ * @param[in] filename The filename
+ * @param[in] partFlag The ESfMData load flag
+ * @return true if completed
+ */
+bool loadBinary(sfmData::SfMData& sfmData, const std::string& filename, ESfMData partFlag);
+
+} // namespace sfmDataIO
+} // namespace aliceVision
@@ -71,7 +71,7 @@ sfmData::SfMData createTestScene(std::size_t viewsCount = 2, std::size_t observa
 
 BOOST_AUTO_TEST_CASE(SfMData_IO_SAVE_LOAD)
 {
-    std::vector<std::string> ext_Type = {"sfm", "json"};
+    std::vector<std::string> ext_Type = {"sfm", "json", "sfmb"};
 
 #if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_ALEMBIC)
     ext_Type.push_back("abc");
@@ -179,6 +179,76 @@ BOOST_AUTO_TEST_CASE(SfMData_IO_SAVE_LOAD)
     }
 }
 
+BOOST_AUTO_TEST_CASE(SfMData_IO_BINARY_JSON_ROUNDTRIP)
+{
+    // scene with several landmarks, control points, locked poses and folders
+    sfmData::SfMData sfmData = createTestScene(5, 3, false);
+    sfmData.addFeaturesFolder("features");
+    sfmData.addMatchesFolder("matches");
+
+    for(IndexT landmarkId = 1; landmarkId < 100; ++landmarkId)
+    {
+        sfmData::Landmark landmark(Vec3::Random(), feature::EImageDescriberType::AKAZE, sfmData::Observations(), image::RGBColor(landmarkId, 2, 3));
+        for(IndexT viewId = landmarkId % 3; viewId < 5; viewId += 2)
+            landmark.observations[viewId] = sfmData::Observation(Vec2::Random() * 1000.0, landmarkId * 10 + viewId, 1.5);
+        sfmData.structure[landmarkId * 2] = landmark;
+    }
+    sfmData.control_points[0] = sfmData.structure.at(2);
+
+    // .sfm -> .sfmb -> .sfm
+    BOOST_CHECK(Save(sfmData, "ROUNDTRIP.sfm", ESfMData::ALL));
+
+    sfmData::SfMData sfmDataJson;
+    BOOST_CHECK(Load(sfmDataJson, "ROUNDTRIP.sfm", ESfMData::ALL));
+    sfmDataJson.getPoses().at(2).lock();
+    BOOST_CHECK(Save(sfmDataJson, "ROUNDTRIP.sfmb", ESfMData::ALL));
+
+    sfmData::SfMData sfmDataBinary;
+    BOOST_CHECK(Load(sfmDataBinary, "ROUNDTRIP.sfmb", ESfMData::ALL));
+    BOOST_CHECK(sfmDataJson == sfmDataBinary);
+    BOOST_CHECK(sfmDataBinary.getRelativeFeaturesFolders() == sfmDataJson.getRelativeFeaturesFolders());
+    BOOST_CHECK(sfmDataBinary.getRelativeMatchesFolders() == sfmDataJson.getRelativeMatchesFolders());
+    BOOST_CHECK(sfmDataBinary.getAbsolutePose(2).isLocked());
+
+    // landmark ids, scales and control points are preserved
+    for(const auto& landmarkPair : sfmDataJson.getLandmarks())
+    {
+        BOOST_REQUIRE(sfmDataBinary.getLandmarks().count(landmarkPair.first));
+        const sfmData::Landmark& landmark = sfmDataBinary.getLandmarks().at(landmarkPair.first);
+        BOOST_CHECK(landmark == landmarkPair.second);
+        for(const auto& observationPair : landmarkPair.second.observations)
+            BOOST_CHECK_EQUAL(landmark.observations.at(observationPair.first).scale, observationPair.second.scale);
+    }
+    BOOST_CHECK(sfmDataBinary.getControlPoints() == sfmDataJson.getControlPoints());
+
+    BOOST_CHECK(Save(sfmDataBinary, "ROUNDTRIP_2.sfm", ESfMData::ALL));
+    sfmData::SfMData sfmDataJson2;
+    BOOST_CHECK(Load(sfmDataJson2, "ROUNDTRIP_2.sfm", ESfMData::ALL));
+    BOOST_CHECK(sfmDataJson == sfmDataJson2);
+
+    // partial loading: structure without observations
+    sfmData::SfMData sfmDataStructure;
+    BOOST_CHECK(Load(sfmDataStructure, "ROUNDTRIP.sfmb", ESfMData::STRUCTURE));
+    BOOST_CHECK_EQUAL(sfmDataStructure.getViews().size(), 0);
+    BOOST_CHECK_EQUAL(sfmDataStructure.getLandmarks().size(), sfmData.getLandmarks().size());
+    for(const auto& landmarkPair : sfmDataStructure.getLandmarks())
+    {
+        BOOST_CHECK(landmarkPair.second.observations.empty());
+        BOOST_CHECK(landmarkPair.second.X == sfmDataJson.getLandmarks().at(landmarkPair.first).X);
+    }
+
+    // partial loading: observations without features
+    sfmData::SfMData sfmDataObservations;
+    BOOST_CHECK(Load(sfmDataObservations, "ROUNDTRIP.sfmb", ESfMData(ESfMData::STRUCTURE | ESfMData::OBSERVATIONS)));
+    for(const auto& landmarkPair : sfmDataObservations.getLandmarks())
+    {
+        const sfmData::Observations& observations = sfmDataJson.getLandmarks().at(landmarkPair.first).observations;
+        BOOST_CHECK_EQUAL(landmarkPair.second.observations.size(), observations.size());
+        for(const auto& observationPair : landmarkPair.second.observations)
+            BOOST_CHECK_EQUAL(observationPair.second.id_feat, UndefinedIndexT);
+    }
+}
+
 /*
 BOOST_AUTO_TEST_CASE(SfMData_IO_BigFile) {
   const int nbViews = 1000;
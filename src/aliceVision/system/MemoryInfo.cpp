@@ -13,8 +13,11 @@
 
 #if defined(__WINDOWS__)
 #include <windows.h>
+#include <psapi.h>
 #elif defined(__LINUX__)
 #include <sys/sysinfo.h>
+#include <sys/resource.h>
+#include <unistd.h>
 #include <fstream>
 #include <limits>
 #elif defined(__APPLE__)
@@ -24,6 +27,8 @@
 #include <mach/mach_types.h>
 #include <mach/mach_init.h>
 #include <mach/mach_host.h>
+#include <mach/task.h>
+#include <sys/resource.h>
 #else
 #warning "System unrecognized. Can't found memory infos."
 #include <limits>
@@ -129,6 +134,54 @@ MemoryInfo getMemoryInfo()
     return infos;
 }
 
+std::size_t getPeakProcessMemory()
+{
+#if defined(__WINDOWS__)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#elif defined(__LINUX__)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // in kB
+    return 0;
+#elif defined(__APPLE__)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+        return static_cast<std::size_t>(usage.ru_maxrss); // in bytes
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+std::size_t getProcessMemory()
+{
+#if defined(__WINDOWS__)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+#elif defined(__LINUX__)
+    // /proc/self/statm: size resident shared text lib data dt (in pages)
+    std::ifstream statm("/proc/self/statm");
+    std::size_t size = 0;
+    std::size_t resident = 0;
+    if(statm >> size >> resident)
+        return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        return static_cast<std::size_t>(info.resident_size);
+    return 0;
+#else
+    return 0;
+#endif
+}
+
 std::ostream& operator<<(std::ostream& os, const MemoryInfo& infos)
 {
   const double convertionGb = std::pow(2,30);
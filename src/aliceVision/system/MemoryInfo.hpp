@@ -25,6 +25,18 @@ struct MemoryInfo
 
 MemoryInfo getMemoryInfo();
 
+/**
+ * @brief Get the peak resident memory (in bytes) used by the current process.
+ * @return 0 if it is not available on this platform
+ */
+std::size_t getPeakProcessMemory();
+
+/**
+ * @brief Get the resident memory (in bytes) currently used by the current process.
+ * @return 0 if it is not available on this platform
+ */
+std::size_t getProcessMemory();
+
 std::ostream& operator<<(std::ostream& os, const MemoryInfo& infos);
 
 }
@@ -0,0 +1,462 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "StreamingTracksBuilder.hpp"
+
+#include <aliceVision/matching/MatchesFile.hpp>
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/system/MemoryInfo.hpp>
+#include <aliceVision/system/Timer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace aliceVision {
+namespace track {
+
+using namespace aliceVision::matching;
+
+namespace {
+
+/// flag of trackOfRoot values already converted from a track length to a track index
+constexpr std::uint32_t trackIndexFlag = 0x80000000u;
+
+} // namespace
+
+StreamingTracksBuilder::StreamingTracksBuilder(std::size_t memoryBudget)
+  : _memoryBudget(memoryBudget)
+{}
+
+void StreamingTracksBuilder::reserveFeatures(IndexT viewId, feature::EImageDescriberType descType, std::size_t nbFeatures)
+{
+  const auto it = _rangeIndex.find(rangeKey(viewId, descType));
+
+  if(it != _rangeIndex.end())
+  {
+    FeaturesRange& range = _ranges[it->second];
+    if(nbFeatures <= range.nbNodes)
+      return;
+
+    // ranges are contiguous: once nodes are allocated, only the last range can be extended
+    if(!_parent.empty() && it->second != _ranges.size() - 1)
+      throw std::runtime_error("Can't extend the features of view " + std::to_string(viewId) +
+                               " once matches have been added, all the features must be reserved first.");
+
+    _nbNodes += nbFeatures - range.nbNodes;
+    range.nbNodes = static_cast<std::uint32_t>(nbFeatures);
+  }
+  else
+  {
+    FeaturesRange range;
+    range.viewId = viewId;
+    range.descType = descType;
+    range.firstNode = static_cast<std::uint32_t>(_nbNodes);
+    range.nbNodes = static_cast<std::uint32_t>(nbFeatures);
+
+    _rangeIndex[rangeKey(viewId, descType)] = _ranges.size();
+    _ranges.push_back(range);
+    _nbNodes += nbFeatures;
+  }
+
+  if(_nbNodes >= std::numeric_limits<std::uint32_t>::max())
+    throw std::runtime_error("Too many features for the tracks builder (" + std::to_string(_nbNodes) + ").");
+
+  checkMemoryBudget(builderMemory(), "features reservation");
+
+  if(!_parent.empty())
+    allocateNodes();
+}
+
+bool StreamingTracksBuilder::loadMatches(const MatchesFileReader& reader, const Pair& pair, const MatchesFilter& filter,
+                                         MatchesPerDescType& matches)
+{
+  matches.clear();
+
+  if(!filter.viewsKeys.empty() && (!filter.viewsKeys.count(pair.first) || !filter.viewsKeys.count(pair.second)))
+    return false;
+
+  if(filter.descTypes.empty())
+  {
+    reader.load(pair, matches);
+  }
+  else
+  {
+    for(const feature::EImageDescriberType descType : filter.descTypes)
+    {
+      IndMatches descMatches;
+      if(reader.load(pair, descType, descMatches))
+        matches[descType] = std::move(descMatches);
+    }
+  }
+
+  // same selection as matching::filterTopMatches
+  if(filter.maxNbMatches > 0 && filter.minNbMatches > filter.maxNbMatches)
+    throw std::runtime_error("The minimum number of matches is higher than the maximum.");
+  for(auto& matchesIt : matches)
+  {
+    IndMatches& m = matchesIt.second;
+    if(filter.minNbMatches > 0 && m.size() < filter.minNbMatches)
+      m.clear();
+    else if(filter.maxNbMatches > 0 && m.size() > filter.maxNbMatches)
+      m.erase(m.begin() + filter.maxNbMatches, m.end());
+  }
+  return true;
+}
+
+void StreamingTracksBuilder::reserveFeatures(const MatchesFileReader& reader, const MatchesFilter& filter)
+{
+  MatchesPerDescType matchesPerDesc;
+
+  for(const Pair& pair : reader.getPairs())
+  {
+    if(!loadMatches(reader, pair, filter, matchesPerDesc))
+      continue;
+
+    for(const auto& matchesIt : matchesPerDesc)
+    {
+      IndexT maxI = 0;
+      IndexT maxJ = 0;
+      for(const IndMatch& m : matchesIt.second)
+      {
+        maxI = std::max(maxI, m._i);
+        maxJ = std::max(maxJ, m._j);
+      }
+      if(!matchesIt.second.empty())
+      {
+        reserveFeatures(pair.first, matchesIt.first, std::size_t(maxI) + 1);
+        reserveFeatures(pair.second, matchesIt.first, std::size_t(maxJ) + 1);
+      }
+    }
+  }
+}
+
+void StreamingTracksBuilder::reserveFeatures(const PairwiseMatches& pairwiseMatches)
+{
+  for(const auto& matchesPerDescIt : pairwiseMatches)
+  {
+    for(const auto& matchesIt : matchesPerDescIt.second)
+    {
+      IndexT maxI = 0;
+      IndexT maxJ = 0;
+      for(const IndMatch& m : matchesIt.second)
+      {
+        maxI = std::max(maxI, m._i);
+        maxJ = std::max(maxJ, m._j);
+      }
+      if(!matchesIt.second.empty())
+      {
+        reserveFeatures(matchesPerDescIt.first.first, matchesIt.first, std::size_t(maxI) + 1);
+        reserveFeatures(matchesPerDescIt.first.second, matchesIt.first, std::size_t(maxJ) + 1);
+      }
+    }
+  }
+}
+
+void StreamingTracksBuilder::allocateNodes()
+{
+  const std::size_t previousNbNodes = _parent.size();
+
+  // first allocation: ranges may have been extended since their declaration
+  if(previousNbNodes == 0)
+  {
+    std::uint32_t firstNode = 0;
+    for(FeaturesRange& range : _ranges)
+    {
+      range.firstNode = firstNode;
+      firstNode += range.nbNodes;
+    }
+  }
+
+  _parent.resize(_nbNodes);
+  std::iota(_parent.begin() + previousNbNodes, _parent.end(), static_cast<std::uint32_t>(previousNbNodes));
+  _rank.resize(_nbNodes, 0);
+  _used.resize(_nbNodes, false);
+
+  _stats.nbNodes = _nbNodes;
+}
+
+std::uint32_t StreamingTracksBuilder::find(std::uint32_t node)
+{
+  // path halving
+  while(_parent[node] != node)
+  {
+    _parent[node] = _parent[_parent[node]];
+    node = _parent[node];
+  }
+  return node;
+}
+
+void StreamingTracksBuilder::join(std::uint32_t a, std::uint32_t b)
+{
+  for(const std::uint32_t node : {a, b})
+  {
+    if(!_used[node])
+    {
+      _used[node] = true;
+      ++_stats.nbUsedNodes;
+    }
+  }
+
+  std::uint32_t rootA = find(a);
+  std::uint32_t rootB = find(b);
+  if(rootA == rootB)
+    return;
+
+  // union by rank
+  if(_rank[rootA] < _rank[rootB])
+    std::swap(rootA, rootB);
+  _parent[rootB] = rootA;
+  if(_rank[rootA] == _rank[rootB])
+    ++_rank[rootA];
+}
+
+const StreamingTracksBuilder::FeaturesRange& StreamingTracksBuilder::getRange(IndexT viewId, feature::EImageDescriberType descType) const
+{
+  const auto it = _rangeIndex.find(rangeKey(viewId, descType));
+  if(it == _rangeIndex.end())
+    throw std::runtime_error("No features reserved for view " + std::to_string(viewId) + " and describer type " +
+                             feature::EImageDescriberType_enumToString(descType) + ".");
+  return _ranges[it->second];
+}
+
+std::uint32_t StreamingTracksBuilder::getNode(const FeaturesRange& range, IndexT featureId) const
+{
+  if(featureId >= range.nbNodes)
+    throw std::runtime_error("Feature " + std::to_string(featureId) + " of view " + std::to_string(range.viewId) +
+                             " has not been reserved (" + std::to_string(range.nbNodes) + " features).");
+  return range.firstNode + featureId;
+}
+
+void StreamingTracksBuilder::addMatches(const Pair& pair, feature::EImageDescriberType descType, const IndMatches& matches)
+{
+  if(matches.empty())
+    return;
+
+  // accumulated for each pair: use a clock with a better resolution than system::Timer
+  const auto start = std::chrono::steady_clock::now();
+
+  if(_parent.size() != _nbNodes)
+    allocateNodes();
+
+  const FeaturesRange& rangeI = getRange(pair.first, descType);
+  const FeaturesRange& rangeJ = getRange(pair.second, descType);
+
+  for(const IndMatch& m : matches)
+    join(getNode(rangeI, m._i), getNode(rangeJ, m._j));
+
+  _stats.nbMatches += matches.size();
+  _stats.buildTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void StreamingTracksBuilder::addMatches(const Pair& pair, const MatchesPerDescType& matches)
+{
+  for(const auto& matchesIt : matches)
+    addMatches(pair, matchesIt.first, matchesIt.second);
+  ++_stats.nbPairs;
+}
+
+void StreamingTracksBuilder::addMatches(const MatchesFileReader& reader, const MatchesFilter& filter)
+{
+  MatchesPerDescType matchesPerDesc;
+
+  for(const Pair& pair : reader.getPairs())
+  {
+    if(loadMatches(reader, pair, filter, matchesPerDesc))
+      addMatches(pair, matchesPerDesc);
+  }
+}
+
+void StreamingTracksBuilder::build(const std::vector<std::string>& matchesFilepaths, const MatchesFilter& filter)
+{
+  for(const std::string& filepath : matchesFilepaths)
+  {
+    const MatchesFileReader reader(filepath);
+    reserveFeatures(reader, filter);
+  }
+
+  ALICEVISION_LOG_DEBUG("Tracks building: " << _nbNodes << " features reserved in " << _ranges.size() << " ranges.");
+
+  for(const std::string& filepath : matchesFilepaths)
+  {
+    const MatchesFileReader reader(filepath);
+    addMatches(reader, filter);
+  }
+
+  _stats.peakMemory = system::getPeakProcessMemory();
+}
+
+void StreamingTracksBuilder::build(const PairwiseMatches& pairwiseMatches)
+{
+  reserveFeatures(pairwiseMatches);
+
+  for(const auto& matchesPerDescIt : pairwiseMatches)
+    addMatches(matchesPerDescIt.first, matchesPerDescIt.second);
+
+  _stats.peakMemory = system::getPeakProcessMemory();
+}
+
+void StreamingTracksBuilder::exportToStore(TracksStore& tracks, bool clearForks, std::size_t minTrackLength)
+{
+  system::Timer timer;
+
+  tracks.clear();
+
+  if(_parent.size() != _nbNodes)
+    allocateNodes();
+
+  const std::size_t nbNodes = _parent.size();
+  const std::size_t nbUsedNodes = _stats.nbUsedNodes;
+
+  // track of each root + track nodes + output store (upper bound)
+  const std::size_t exportMemory = nbNodes * sizeof(std::uint32_t) +
+                                   nbUsedNodes * sizeof(std::uint32_t) +
+                                   nbUsedNodes * (2 * sizeof(IndexT) + sizeof(std::uint64_t) * 2 + sizeof(feature::EImageDescriberType));
+  checkMemoryBudget(builderMemory() + exportMemory, "tracks export");
+
+  // number of nodes of each track, stored on its root
+  std::vector<std::uint32_t> trackOfRoot(nbNodes, 0);
+  for(std::uint32_t node = 0; node < nbNodes; ++node)
+  {
+    if(_used[node])
+      ++trackOfRoot[find(node)];
+  }
+
+  // track offsets, in the order of the first node of each track
+  std::vector<std::uint64_t> offsets(1, 0);
+  for(std::uint32_t node = 0; node < nbNodes; ++node)
+  {
+    if(!_used[node])
+      continue;
+    std::uint32_t& value = trackOfRoot[find(node)];
+    if(value & trackIndexFlag)
+      continue;
+    const std::uint32_t trackLength = value;
+    value = trackIndexFlag | static_cast<std::uint32_t>(offsets.size() - 1);
+    offsets.push_back(offsets.back() + trackLength);
+  }
+
+  // track nodes, sorted by node id for each track
+  std::vector<std::uint32_t> trackNodes(offsets.back());
+  {
+    std::vector<std::uint64_t> cursors(offsets.begin(), offsets.end() - 1);
+    for(std::uint32_t node = 0; node < nbNodes; ++node)
+    {
+      if(_used[node])
+        trackNodes[cursors[trackOfRoot[find(node)] & ~trackIndexFlag]++] = node;
+    }
+  }
+  trackOfRoot.clear();
+  trackOfRoot.shrink_to_fit();
+
+  // convert nodes to observations and filter bad tracks
+  std::vector<std::pair<IndexT, IndexT>> observations;
+  std::vector<IndexT> viewIds;
+  std::vector<IndexT> featIds;
+
+  for(std::size_t trackIndex = 0; trackIndex + 1 < offsets.size(); ++trackIndex)
+  {
+    observations.clear();
+    bool hasFork = false;
+    std::size_t previousRange = std::numeric_limits<std::size_t>::max();
+
+    for(std::uint64_t i = offsets[trackIndex]; i < offsets[trackIndex + 1]; ++i)
+    {
+      const std::uint32_t node = trackNodes[i];
+      const std::size_t rangeIndex = std::distance(_ranges.begin(),
+        std::upper_bound(_ranges.begin(), _ranges.end(), node,
+                         [](std::uint32_t n, const FeaturesRange& range) { return n < range.firstNode; })) - 1;
+
+      // nodes are sorted and a track has a single describer type: observations in the same view are consecutive
+      if(rangeIndex == previousRange)
+      {
+        hasFork = true;
+        continue;
+      }
+      previousRange = rangeIndex;
+
+      const FeaturesRange& range = _ranges[rangeIndex];
+      observations.emplace_back(range.viewId, node - range.firstNode);
+    }
+
+    if((clearForks && hasFork) || observations.size() < minTrackLength)
+      continue;
+
+    std::sort(observations.begin(), observations.end());
+
+    viewIds.resize(observations.size());
+    featIds.resize(observations.size());
+    for(std::size_t i = 0; i < observations.size(); ++i)
+    {
+      viewIds[i] = observations[i].first;
+      featIds[i] = observations[i].second;
+    }
+
+    const FeaturesRange& range = _ranges[previousRange];
+    tracks.addTrack(range.descType, viewIds.data(), featIds.data(), observations.size());
+  }
+
+  tracks.buildViewIndex();
+
+  _stats.nbTracks = tracks.nbTracks();
+  _stats.nbObservations = tracks.nbObservations();
+  _stats.exportTime = timer.elapsed();
+  _stats.estimatedMemory = builderMemory() + tracks.memorySize();
+  _stats.peakMemory = system::getPeakProcessMemory();
+
+  ALICEVISION_LOG_INFO("Tracks building statistics:" << std::endl << _stats);
+}
+
+void StreamingTracksBuilder::clear()
+{
+  _ranges.clear();
+  _rangeIndex.clear();
+  _nbNodes = 0;
+  _parent = std::vector<std::uint32_t>();
+  _rank = std::vector<std::uint8_t>();
+  _used = std::vector<bool>();
+  _stats = Stats();
+}
+
+std::size_t StreamingTracksBuilder::builderMemory() const
+{
+  // parent + rank + used flag per node, range and its index entry per view
+  return _nbNodes * (sizeof(std::uint32_t) + sizeof(std::uint8_t)) + _nbNodes / 8 +
+         _ranges.size() * (sizeof(FeaturesRange) + sizeof(std::uint64_t) + 2 * sizeof(std::size_t) + sizeof(void*));
+}
+
+void StreamingTracksBuilder::checkMemoryBudget(std::size_t estimatedMemory, const std::string& step) const
+{
+  if(_memoryBudget == 0 || estimatedMemory <= _memoryBudget)
+    return;
+
+  const double convertionMb = std::pow(2, 20);
+  throw std::runtime_error("Tracks building exceeds the memory budget during " + step + ": " +
+                           std::to_string(static_cast<std::size_t>(estimatedMemory / convertionMb)) + " MB needed, " +
+                           std::to_string(static_cast<std::size_t>(_memoryBudget / convertionMb)) + " MB allowed.");
+}
+
+std::ostream& operator<<(std::ostream& os, const StreamingTracksBuilder::Stats& stats)
+{
+  const double convertionMb = std::pow(2, 20);
+  os << "\t- # pairs:            " << stats.nbPairs << std::endl
+     << "\t- # matches:          " << stats.nbMatches << std::endl
+     << "\t- # nodes:            " << stats.nbNodes << " (" << stats.nbUsedNodes << " used)" << std::endl
+     << "\t- # tracks:           " << stats.nbTracks << std::endl
+     << "\t- # observations:     " << stats.nbObservations << std::endl
+     << "\t- build time:         " << stats.buildTime << " s (" << stats.nodesPerSecond() << " nodes/s, "
+                                   << stats.matchesPerSecond() << " matches/s)" << std::endl
+     << "\t- export time:        " << stats.exportTime << " s" << std::endl
+     << "\t- estimated memory:   " << (stats.estimatedMemory / convertionMb) << " MB" << std::endl
+     << "\t- peak process memory: " << (stats.peakMemory / convertionMb) << " MB" << std::endl;
+  return os;
+}
+
+} // namespace track
+} // namespace aliceVision
@@ -0,0 +1,224 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/track/Track.hpp>
+#include <aliceVision/track/TracksStore.hpp>
+#include <aliceVision/types.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aliceVision {
+namespace matching {
+class MatchesFileReader;
+}
+
+namespace track {
+
+/**
+ * @brief Selection of the matches read from binary matches files, as in matching::Load
+ */
+struct MatchesFilter
+{
+  /// restrict to the pairs of these views (if not empty)
+  std::set<IndexT> viewsKeys;
+  /// restrict to these describer types (if not empty)
+  std::vector<feature::EImageDescriberType> descTypes;
+  /// maximum number of matches per image pair and describer type, 0 for no limit
+  int maxNbMatches = 0;
+  /// minimum number of matches per image pair and describer type, 0 for no limit
+  int minNbMatches = 0;
+};
+
+/**
+ * @brief Build tracks from pairwise matches consumed incrementally.
+ *
+ * Unlike TracksBuilder, the whole PairwiseMatches never needs to be in memory:
+ * matches are added pair by pair (e.g. from binary matches files) and only a compact
+ * union-find over the features is kept in memory.
+ *
+ * Each feature {viewId, descType, featureId} is a node of the union-find, identified by
+ * an integer: the features of a view for a describer type are a contiguous range of nodes
+ * that must be declared before adding matches (reserveFeatures).
+ * The union-find uses union by rank and path compression, with 5 bytes per node.
+ *
+ * Usage:
+ * @code{.cpp}
+ *  StreamingTracksBuilder tracksBuilder(memoryBudget);
+ *  tracksBuilder.build(matchesFilepaths); // or reserveFeatures(...) then addMatches(...)
+ *  TracksStore tracks;
+ *  tracksBuilder.exportToStore(tracks, clearForks, minTrackLength);
+ * @endcode
+ */
+class StreamingTracksBuilder
+{
+public:
+  /**
+   * @brief Statistics of the tracks building
+   */
+  struct Stats
+  {
+    std::size_t nbPairs = 0;
+    std::size_t nbMatches = 0;
+    /// number of union-find nodes (reserved features)
+    std::size_t nbNodes = 0;
+    /// number of nodes referenced by at least one match
+    std::size_t nbUsedNodes = 0;
+    std::size_t nbTracks = 0;
+    std::size_t nbObservations = 0;
+    /// time spent in the union-find (in seconds)
+    double buildTime = 0.0;
+    /// time spent in the tracks export (in seconds)
+    double exportTime = 0.0;
+    /// estimated memory of the builder and its output (in bytes)
+    std::size_t estimatedMemory = 0;
+    /// peak resident memory of the process (in bytes)
+    std::size_t peakMemory = 0;
+
+    /// Return the number of union-find nodes processed per second
+    double nodesPerSecond() const { return (buildTime > 0.0) ? (nbUsedNodes / buildTime) : 0.0; }
+    /// Return the number of matches processed per second
+    double matchesPerSecond() const { return (buildTime > 0.0) ? (nbMatches / buildTime) : 0.0; }
+  };
+
+  /**
+   * @param[in] memoryBudget maximum memory (in bytes) of the builder and its output, 0 for no limit
+   */
+  explicit StreamingTracksBuilder(std::size_t memoryBudget = 0);
+
+  /**
+   * @brief Declare the features of a view for a describer type.
+   *        Can be called several times, the range is extended if needed.
+   *        Once matches have been added, only new views or the last declared one can be extended.
+   * @param[in] viewId the view id
+   * @param[in] descType the describer type
+   * @param[in] nbFeatures the number of features (the maximum feature id + 1)
+   * @throw std::runtime_error if the memory budget is exceeded
+   */
+  void reserveFeatures(IndexT viewId, feature::EImageDescriberType descType, std::size_t nbFeatures);
+
+  /**
+   * @brief Declare the features referenced by the matches of a binary matches file
+   * @param[in] reader the binary matches file
+   * @param[in] filter the selection of the matches
+   */
+  void reserveFeatures(const matching::MatchesFileReader& reader, const MatchesFilter& filter = MatchesFilter());
+
+  /**
+   * @brief Declare the features referenced by pairwise matches
+   * @param[in] pairwiseMatches the pairwise matches
+   */
+  void reserveFeatures(const matching::PairwiseMatches& pairwiseMatches);
+
+  /**
+   * @brief Fuse the matches of one image pair into the tracks.
+   * @param[in] pair the image pair
+   * @param[in] descType the describer type
+   * @param[in] matches the matches, referencing reserved features
+   * @throw std::runtime_error if a feature has not been reserved
+   */
+  void addMatches(const Pair& pair, feature::EImageDescriberType descType, const matching::IndMatches& matches);
+
+  /**
+   * @brief Fuse the matches of one image pair into the tracks, for all describer types
+   * @param[in] pair the image pair
+   * @param[in] matches the matches per describer type
+   */
+  void addMatches(const Pair& pair, const matching::MatchesPerDescType& matches);
+
+  /**
+   * @brief Fuse all the matches of a binary matches file, pair by pair
+   * @param[in] reader the binary matches file
+   * @param[in] filter the selection of the matches
+   */
+  void addMatches(const matching::MatchesFileReader& reader, const MatchesFilter& filter = MatchesFilter());
+
+  /**
+   * @brief Build tracks from binary matches files.
+   *        Files are read twice (features declaration, then fusion), one at a time.
+   * @param[in] matchesFilepaths the binary matches files
+   * @param[in] filter the selection of the matches
+   */
+  void build(const std::vector<std::string>& matchesFilepaths, const MatchesFilter& filter = MatchesFilter());
+
+  /**
+   * @brief Build tracks from in-memory pairwise matches
+   * @param[in] pairwiseMatches the pairwise matches
+   */
+  void build(const matching::PairwiseMatches& pairwiseMatches);
+
+  /**
+   * @brief Export the tracks to a compact tracks store with its view index, bad tracks are removed.
+   *        Track ids are attributed in the order of their first feature.
+   * @param[out] tracks the output tracks store
+   * @param[in] clearForks remove tracks with multiple observations in a single view
+   * @param[in] minTrackLength minimal number of observations to keep a track
+   * @throw std::runtime_error if the memory budget is exceeded
+   */
+  void exportToStore(TracksStore& tracks, bool clearForks = true, std::size_t minTrackLength = 2);
+
+  /// Return the building statistics
+  const Stats& getStats() const { return _stats; }
+
+  /// Release the union-find memory
+  void clear();
+
+private:
+  struct FeaturesRange
+  {
+    IndexT viewId;
+    feature::EImageDescriberType descType;
+    std::uint32_t firstNode;
+    std::uint32_t nbNodes;
+  };
+
+  static std::uint64_t rangeKey(IndexT viewId, feature::EImageDescriberType descType)
+  {
+    return (static_cast<std::uint64_t>(viewId) << 32) | static_cast<std::uint64_t>(descType);
+  }
+
+  /**
+   * @brief Load the selected matches of an image pair
+   * @return false if the pair is not selected
+   */
+  static bool loadMatches(const matching::MatchesFileReader& reader, const Pair& pair, const MatchesFilter& filter,
+                          matching::MatchesPerDescType& matches);
+
+  std::uint32_t find(std::uint32_t node);
+  void join(std::uint32_t a, std::uint32_t b);
+  const FeaturesRange& getRange(IndexT viewId, feature::EImageDescriberType descType) const;
+  std::uint32_t getNode(const FeaturesRange& range, IndexT featureId) const;
+  void allocateNodes();
+  std::size_t builderMemory() const;
+  void checkMemoryBudget(std::size_t estimatedMemory, const std::string& step) const;
+
+  std::size_t _memoryBudget;
+  Stats _stats;
+
+  /// features ranges, sorted by first node
+  std::vector<FeaturesRange> _ranges;
+  /// {viewId, descType} => index in _ranges
+  std::unordered_map<std::uint64_t, std::size_t> _rangeIndex;
+
+  /// total number of reserved features
+  std::size_t _nbNodes = 0;
+
+  // union-find
+  std::vector<std::uint32_t> _parent;
+  std::vector<std::uint8_t> _rank;
+  std::vector<bool> _used;
+};
+
+std::ostream& operator<<(std::ostream& os, const StreamingTracksBuilder::Stats& stats);
+
+} // namespace track
+} // namespace aliceVision
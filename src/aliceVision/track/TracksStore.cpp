@@ -0,0 +1,296 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "TracksStore.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace fs = boost::filesystem;
+
+namespace aliceVision {
+namespace track {
+
+namespace {
+
+const char tracksFileMagic[8] = {'A', 'V', 'T', 'R', 'A', 'C', 'K', 0};
+
+template<typename T>
+void writeArray(std::ofstream& stream, const std::vector<T>& values)
+{
+  stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template<typename T>
+void readArray(std::ifstream& stream, std::vector<T>& values, std::size_t size)
+{
+  values.resize(size);
+  stream.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+}
+
+} // namespace
+
+void TracksStore::clear()
+{
+  _offsets.assign(1, 0);
+  _viewIds.clear();
+  _featIds.clear();
+  _descTypes.clear();
+
+  _viewIndexNbTracks = 0;
+  _indexViewIds.clear();
+  _viewOffsets.clear();
+  _viewTrackIds.clear();
+  _viewFeatIds.clear();
+}
+
+void TracksStore::reserve(std::size_t nbTracks, std::size_t nbObservations)
+{
+  _offsets.reserve(nbTracks + 1);
+  _descTypes.reserve(nbTracks);
+  _viewIds.reserve(nbObservations);
+  _featIds.reserve(nbObservations);
+}
+
+std::size_t TracksStore::addTrack(feature::EImageDescriberType descType, const IndexT* viewIds, const IndexT* featIds, std::size_t length)
+{
+  _viewIds.insert(_viewIds.end(), viewIds, viewIds + length);
+  _featIds.insert(_featIds.end(), featIds, featIds + length);
+  _offsets.push_back(_viewIds.size());
+  _descTypes.push_back(descType);
+  return _descTypes.size() - 1;
+}
+
+std::size_t TracksStore::memorySize() const
+{
+  return _offsets.capacity() * sizeof(std::uint64_t) +
+         (_viewIds.capacity() + _featIds.capacity()) * sizeof(IndexT) +
+         _descTypes.capacity() * sizeof(feature::EImageDescriberType) +
+         _viewOffsets.capacity() * sizeof(std::uint64_t) +
+         (_indexViewIds.capacity() + _viewTrackIds.capacity() + _viewFeatIds.capacity()) * sizeof(IndexT);
+}
+
+void TracksStore::exportToSTL(TracksMap& tracks) const
+{
+  tracks.clear();
+  tracks.reserve(nbTracks());
+
+  for(std::size_t trackId = 0; trackId < nbTracks(); ++trackId)
+    getTrack(trackId, tracks[trackId]);
+}
+
+void TracksStore::getTrack(std::size_t trackId, Track& track) const
+{
+  track.descType = _descTypes[trackId];
+  track.featPerView.clear();
+  track.featPerView.reserve(trackLength(trackId));
+
+  const IndexT* viewIds = trackViewIds(trackId);
+  const IndexT* featIds = trackFeatureIds(trackId);
+  for(std::size_t i = 0; i < trackLength(trackId); ++i)
+    track.featPerView.insert(track.featPerView.end(), std::make_pair(std::size_t(viewIds[i]), std::size_t(featIds[i])));
+}
+
+void TracksStore::importFromSTL(const TracksMap& tracks)
+{
+  clear();
+
+  std::size_t nbObservations = 0;
+  for(const auto& trackIt : tracks)
+    nbObservations += trackIt.second.featPerView.size();
+  reserve(tracks.size(), nbObservations);
+
+  std::vector<IndexT> viewIds;
+  std::vector<IndexT> featIds;
+
+  for(const auto& trackIt : tracks)
+  {
+    if(trackIt.first != nbTracks())
+      throw std::runtime_error("Can't import tracks in a tracks store, track ids are not contiguous (track " +
+                               std::to_string(trackIt.first) + ").");
+
+    // featPerView is sorted by view id
+    const Track& track = trackIt.second;
+    viewIds.clear();
+    featIds.clear();
+    for(const auto& featIt : track.featPerView)
+    {
+      viewIds.push_back(static_cast<IndexT>(featIt.first));
+      featIds.push_back(static_cast<IndexT>(featIt.second));
+    }
+    addTrack(track.descType, viewIds.data(), featIds.data(), viewIds.size());
+  }
+
+  buildViewIndex();
+}
+
+void TracksStore::save(const std::string& filepath) const
+{
+  const fs::path bPath = fs::path(filepath);
+  const std::string tmpFilepath = (bPath.parent_path() / bPath.stem()).string() + "." + fs::unique_path().string() + bPath.extension().string();
+
+  {
+    std::ofstream stream(tmpFilepath, std::ios::out | std::ios::binary);
+    if(!stream.is_open())
+      throw std::runtime_error("Can't save tracks file, can't open '" + tmpFilepath + "' !");
+
+    TracksFileHeader header;
+    std::memcpy(header.magic, tracksFileMagic, sizeof(tracksFileMagic));
+    header.version = TRACKS_FILE_VERSION;
+    header.reserved = 0;
+    header.trackCount = nbTracks();
+    header.observationCount = nbObservations();
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<std::uint32_t> descTypes(_descTypes.size());
+    std::transform(_descTypes.begin(), _descTypes.end(), descTypes.begin(),
+                   [](feature::EImageDescriberType descType) { return static_cast<std::uint32_t>(descType); });
+
+    writeArray(stream, _offsets);
+    writeArray(stream, descTypes);
+    writeArray(stream, _viewIds);
+    writeArray(stream, _featIds);
+
+    if(!stream.good())
+      throw std::runtime_error("Can't save tracks file, '" + tmpFilepath + "' is incorrect !");
+  }
+
+  // rename temporary file
+  fs::rename(tmpFilepath, filepath);
+}
+
+void TracksStore::load(const std::string& filepath)
+{
+  clear();
+
+  std::ifstream stream(filepath, std::ios::in | std::ios::binary);
+  if(!stream.is_open())
+    throw std::runtime_error("Can't load tracks file, can't open '" + filepath + "' !");
+
+  TracksFileHeader header;
+  if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    throw std::runtime_error("Can't load tracks file, '" + filepath + "' is too small.");
+
+  if(std::memcmp(header.magic, tracksFileMagic, sizeof(tracksFileMagic)) != 0)
+    throw std::runtime_error("Can't load tracks file, '" + filepath + "' is not a binary tracks file.");
+
+  if(header.version != TRACKS_FILE_VERSION)
+    throw std::runtime_error("Can't load tracks file, '" + filepath + "' has an unsupported version (" +
+                             std::to_string(header.version) + ").");
+
+  // bound the counts by the file size before computing the expected size, so it can't wrap around
+  const std::uint64_t fileSize = fs::file_size(filepath);
+  if(header.trackCount > fileSize / (sizeof(std::uint64_t) + sizeof(std::uint32_t)) ||
+     header.observationCount > fileSize / (2 * sizeof(IndexT)))
+    throw std::runtime_error("Can't load tracks file, '" + filepath + "' is incomplete or incorrect.");
+
+  const std::uint64_t expectedSize = sizeof(TracksFileHeader) + (header.trackCount + 1) * sizeof(std::uint64_t) +
+                                     header.trackCount * sizeof(std::uint32_t) +
+                                     2 * header.observationCount * sizeof(IndexT);
+  if(fileSize != expectedSize)
+    throw std::runtime_error("Can't load tracks file, '" + filepath + "' is incomplete or incorrect.");
+
+  std::vector<std::uint32_t> descTypes;
+  readArray(stream, _offsets, header.trackCount + 1);
+  readArray(stream, descTypes, header.trackCount);
+  readArray(stream, _viewIds, header.observationCount);
+  readArray(stream, _featIds, header.observationCount);
+
+  if(!stream.good() || _offsets.front() != 0 || _offsets.back() != header.observationCount ||
+     !std::is_sorted(_offsets.begin(), _offsets.end()))
+  {
+    clear();
+    throw std::runtime_error("Can't load tracks file, '" + filepath + "' is incorrect.");
+  }
+
+  _descTypes.resize(descTypes.size());
+  std::transform(descTypes.begin(), descTypes.end(), _descTypes.begin(),
+                 [](std::uint32_t descType) { return static_cast<feature::EImageDescriberType>(descType); });
+
+  buildViewIndex();
+}
+
+void TracksStore::buildViewIndex()
+{
+  // sorted unique view ids
+  _indexViewIds = _viewIds;
+  std::sort(_indexViewIds.begin(), _indexViewIds.end());
+  _indexViewIds.erase(std::unique(_indexViewIds.begin(), _indexViewIds.end()), _indexViewIds.end());
+  _indexViewIds.shrink_to_fit();
+
+  // counting sort of the observations by view: tracks are visited in increasing order,
+  // so the track ids of each view are sorted
+  _viewOffsets.assign(_indexViewIds.size() + 1, 0);
+  for(const IndexT viewId : _viewIds)
+    ++_viewOffsets[viewIndexPosition(viewId) + 1];
+  for(std::size_t i = 1; i < _viewOffsets.size(); ++i)
+    _viewOffsets[i] += _viewOffsets[i - 1];
+
+  _viewTrackIds.resize(_viewIds.size());
+  _viewFeatIds.resize(_viewIds.size());
+
+  std::vector<std::uint64_t> cursors(_viewOffsets.begin(), _viewOffsets.end() - 1);
+  for(std::size_t trackId = 0; trackId < nbTracks(); ++trackId)
+  {
+    for(std::uint64_t i = _offsets[trackId]; i < _offsets[trackId + 1]; ++i)
+    {
+      const std::uint64_t position = cursors[viewIndexPosition(_viewIds[i])]++;
+      _viewTrackIds[position] = static_cast<IndexT>(trackId);
+      _viewFeatIds[position] = _featIds[i];
+    }
+  }
+
+  _viewIndexNbTracks = nbTracks();
+}
+
+std::size_t TracksStore::viewIndexPosition(IndexT viewId) const
+{
+  const auto it = std::lower_bound(_indexViewIds.begin(), _indexViewIds.end(), viewId);
+  if(it == _indexViewIds.end() || *it != viewId)
+    return _indexViewIds.size();
+  return static_cast<std::size_t>(it - _indexViewIds.begin());
+}
+
+std::size_t TracksStore::viewNbTracks(IndexT viewId) const
+{
+  const std::size_t position = viewIndexPosition(viewId);
+  if(position == _indexViewIds.size())
+    return 0;
+  return static_cast<std::size_t>(_viewOffsets[position + 1] - _viewOffsets[position]);
+}
+
+const IndexT* TracksStore::viewTrackIds(IndexT viewId) const
+{
+  const std::size_t position = viewIndexPosition(viewId);
+  if(position == _indexViewIds.size())
+    return _viewTrackIds.data() + _viewTrackIds.size();
+  return _viewTrackIds.data() + _viewOffsets[position];
+}
+
+const IndexT* TracksStore::viewFeatureIds(IndexT viewId) const
+{
+  const std::size_t position = viewIndexPosition(viewId);
+  if(position == _indexViewIds.size())
+    return _viewFeatIds.data() + _viewFeatIds.size();
+  return _viewFeatIds.data() + _viewOffsets[position];
+}
+
+void TracksStore::exportTracksPerView(TracksPerView& tracksPerView) const
+{
+  for(std::size_t position = 0; position < _indexViewIds.size(); ++position)
+  {
+    TrackIdSet& trackIds = tracksPerView[_indexViewIds[position]];
+    trackIds.assign(_viewTrackIds.begin() + _viewOffsets[position], _viewTrackIds.begin() + _viewOffsets[position + 1]);
+  }
+}
+
+} // namespace track
+} // namespace aliceVision
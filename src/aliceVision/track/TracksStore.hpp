@@ -0,0 +1,183 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <aliceVision/track/Track.hpp>
+#include <aliceVision/types.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace aliceVision {
+namespace track {
+
+/// Current version of the binary tracks file
+constexpr std::uint32_t TRACKS_FILE_VERSION = 1;
+
+/**
+ * @brief Header of the binary tracks file.
+ *
+ * File layout: [header][offsets][descTypes][viewIds][featIds]
+ * - offsets: (trackCount + 1) x uint64, the observations range of each track
+ * - descTypes: trackCount x uint32
+ * - viewIds, featIds: observationCount x uint32 each
+ */
+struct TracksFileHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t trackCount;
+  std::uint64_t observationCount;
+};
+
+static_assert(sizeof(TracksFileHeader) == 32, "Unexpected TracksFileHeader size.");
+
+/**
+ * @brief Compact storage of tracks in a compressed sparse row layout.
+ *
+ * The observations {viewId, featureId} of all the tracks are stored in two contiguous arrays.
+ * The observations of the track i are in [offsets[i], offsets[i+1]), sorted by view id.
+ * Track ids are the track positions in the store.
+ *
+ * An inverted index (buildViewIndex) gives the sorted ids of the tracks visible in each view
+ * and the corresponding feature ids, with the same layout.
+ */
+class TracksStore
+{
+public:
+  TracksStore() = default;
+
+  /// Return the number of tracks
+  std::size_t nbTracks() const { return _descTypes.size(); }
+
+  /// Return the number of observations of all tracks
+  std::size_t nbObservations() const { return _viewIds.size(); }
+
+  /// Return true if the store contains no track
+  bool empty() const { return _descTypes.empty(); }
+
+  /// Return the number of observations of a track
+  std::size_t trackLength(std::size_t trackId) const
+  {
+    return static_cast<std::size_t>(_offsets[trackId + 1] - _offsets[trackId]);
+  }
+
+  /// Return the describer type of a track
+  feature::EImageDescriberType trackDescType(std::size_t trackId) const { return _descTypes[trackId]; }
+
+  /// Return the view ids of a track observations (trackLength values)
+  const IndexT* trackViewIds(std::size_t trackId) const { return _viewIds.data() + _offsets[trackId]; }
+
+  /// Return the feature ids of a track observations (trackLength values)
+  const IndexT* trackFeatureIds(std::size_t trackId) const { return _featIds.data() + _offsets[trackId]; }
+
+  /// Remove all the tracks
+  void clear();
+
+  /**
+   * @brief Reserve memory for a number of tracks and observations
+   * @param[in] nbTracks the number of tracks
+   * @param[in] nbObservations the total number of observations
+   */
+  void reserve(std::size_t nbTracks, std::size_t nbObservations);
+
+  /**
+   * @brief Append a track, its id is the previous number of tracks
+   * @param[in] descType the describer type of the track
+   * @param[in] viewIds the observations view ids, sorted by increasing values
+   * @param[in] featIds the observations feature ids
+   * @param[in] length the number of observations
+   * @return the track id
+   */
+  std::size_t addTrack(feature::EImageDescriberType descType, const IndexT* viewIds, const IndexT* featIds, std::size_t length);
+
+  /// Return the memory used by the store (in bytes)
+  std::size_t memorySize() const;
+
+  /**
+   * @brief Export tracks as a map {trackId => {(viewId, featureId), ...}}
+   * @param[out] tracks the tracks map
+   */
+  void exportToSTL(TracksMap& tracks) const;
+
+  /**
+   * @brief Export one track as {descType, (viewId, featureId), ...}
+   * @param[in] trackId the track id
+   * @param[out] track the track observations
+   */
+  void getTrack(std::size_t trackId, Track& track) const;
+
+  /**
+   * @brief Import tracks from a map, the view index is built.
+   * @param[in] tracks the tracks map, with contiguous track ids starting from 0
+   * @throw std::runtime_error if the track ids are not contiguous
+   */
+  void importFromSTL(const TracksMap& tracks);
+
+  /**
+   * @brief Save the tracks in a binary tracks file.
+   *        The data is written in a temporary file renamed at the end.
+   * @param[in] filepath the output file path
+   * @throw std::runtime_error if the file can't be written
+   */
+  void save(const std::string& filepath) const;
+
+  /**
+   * @brief Load the tracks from a binary tracks file, the view index is built.
+   * @param[in] filepath the input file path
+   * @throw std::runtime_error if the file can't be read or is incorrect
+   */
+  void load(const std::string& filepath);
+
+  /**
+   * @brief Build the per-view inverted index.
+   *        Must be called again if tracks are added.
+   */
+  void buildViewIndex();
+
+  /// Return true if the per-view inverted index is up to date
+  bool hasViewIndex() const { return _viewIndexNbTracks == nbTracks() && !_viewOffsets.empty(); }
+
+  /// Return the sorted ids of the views with at least one track (requires the view index)
+  const std::vector<IndexT>& getViewIds() const { return _indexViewIds; }
+
+  /// Return the number of tracks visible in a view (requires the view index)
+  std::size_t viewNbTracks(IndexT viewId) const;
+
+  /// Return the sorted ids of the tracks visible in a view, viewNbTracks values (requires the view index)
+  const IndexT* viewTrackIds(IndexT viewId) const;
+
+  /// Return the feature ids of the tracks visible in a view, in the order of viewTrackIds (requires the view index)
+  const IndexT* viewFeatureIds(IndexT viewId) const;
+
+  /**
+   * @brief Export the visible tracks of each view, without iterating over the tracks
+   * @param[out] tracksPerView for each view the sorted ids of the visible tracks (requires the view index)
+   */
+  void exportTracksPerView(TracksPerView& tracksPerView) const;
+
+private:
+  /// Return the position of a view in the view index, or the number of indexed views if not found
+  std::size_t viewIndexPosition(IndexT viewId) const;
+
+  std::vector<std::uint64_t> _offsets{0};
+  std::vector<IndexT> _viewIds;
+  std::vector<IndexT> _featIds;
+  std::vector<feature::EImageDescriberType> _descTypes;
+
+  // per-view inverted index
+  std::size_t _viewIndexNbTracks = 0;
+  std::vector<IndexT> _indexViewIds;
+  std::vector<std::uint64_t> _viewOffsets;
+  std::vector<IndexT> _viewTrackIds;
+  std::vector<IndexT> _viewFeatIds;
+};
+
+} // namespace track
+} // namespace aliceVision
@@ -6,9 +6,17 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "aliceVision/track/TracksBuilder.hpp"
+#include "aliceVision/track/StreamingTracksBuilder.hpp"
+#include "aliceVision/track/TracksStore.hpp"
 #include "aliceVision/track/tracksUtils.hpp"
 #include "aliceVision/matching/IndMatch.hpp"
+#include "aliceVision/matching/MatchesFile.hpp"
 
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <random>
+#include <set>
 #include <vector>
 #include <utility>
 
@@ -17,10 +25,59 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/tools/floating_point_comparison.hpp>
 
+using namespace aliceVision;
 using namespace aliceVision::feature;
 using namespace aliceVision::track;
 using namespace aliceVision::matching;
 
+namespace {
+
+using TrackObservations = std::pair<EImageDescriberType, std::vector<std::pair<std::size_t, std::size_t>>>;
+
+/// tracks observations, regardless of the track ids
+std::set<TrackObservations> getTracksObservations(const TracksMap& map_tracks)
+{
+  std::set<TrackObservations> tracks;
+  for (const auto& trackIt : map_tracks)
+    tracks.emplace(trackIt.second.descType, std::vector<std::pair<std::size_t, std::size_t>>(trackIt.second.featPerView.begin(), trackIt.second.featPerView.end()));
+  return tracks;
+}
+
+/// random matches between views, for two describer types
+PairwiseMatches createRandomMatches(IndexT nbViews, int nbMatches)
+{
+  std::mt19937 randomNumberGenerator(0);
+  std::uniform_int_distribution<IndexT> featureDistribution(0, 199);
+
+  PairwiseMatches map_pairwisematches;
+  for (IndexT I = 0; I < nbViews; ++I)
+  {
+    for (IndexT J = I + 1; J < nbViews; ++J)
+    {
+      for (EImageDescriberType descType : {EImageDescriberType::SIFT, EImageDescriberType::AKAZE})
+      {
+        IndMatches& matches = map_pairwisematches[std::make_pair(I, J)][descType];
+        for (int m = 0; m < nbMatches; ++m)
+          matches.emplace_back(featureDistribution(randomNumberGenerator), featureDistribution(randomNumberGenerator));
+      }
+    }
+  }
+  return map_pairwisematches;
+}
+
+/// write the matches in a temporary binary matches file
+std::string writeMatchesFile(const PairwiseMatches& map_pairwisematches)
+{
+  const std::string matchesFilepath = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("matches_%%%%%%.bin")).string();
+  MatchesFileWriter writer(matchesFilepath);
+  for (const auto& matchesIt : map_pairwisematches)
+    writer.append(matchesIt.first, matchesIt.second);
+  writer.close();
+  return matchesFilepath;
+}
+
+} // namespace
+
 
 BOOST_AUTO_TEST_CASE(Track_Simple) {
 
@@ -180,6 +237,233 @@ BOOST_AUTO_TEST_CASE(Track_Conflict) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(Track_Streaming_Conflict) {
+
+  // same configuration as Track_Conflict
+  PairwiseMatches map_pairwisematches;
+
+  const IndMatch testAB[] = {IndMatch(0,0), IndMatch(1,1), IndMatch(2,3)};
+  const IndMatch testBC[] = {IndMatch(0,0), IndMatch(1,6), IndMatch(3,2), IndMatch(3,8)};
+
+  map_pairwisematches[ std::make_pair(0,1) ][EImageDescriberType::UNKNOWN] = std::vector<IndMatch>(testAB, testAB+3);
+  map_pairwisematches[ std::make_pair(1,2) ][EImageDescriberType::UNKNOWN] = std::vector<IndMatch>(testBC, testBC+4);
+
+  StreamingTracksBuilder trackBuilder;
+  trackBuilder.build(map_pairwisematches);
+
+  TracksStore tracksStore;
+  trackBuilder.exportToStore(tracksStore, false, 2);
+  BOOST_CHECK_EQUAL(3, tracksStore.nbTracks());
+
+  trackBuilder.exportToStore(tracksStore, true, 2);
+  BOOST_CHECK_EQUAL(2, tracksStore.nbTracks());
+  BOOST_CHECK_EQUAL(6, tracksStore.nbObservations());
+  BOOST_CHECK_EQUAL(7, trackBuilder.getStats().nbMatches);
+
+  TracksMap map_tracks;
+  tracksStore.exportToSTL(map_tracks);
+
+  //0, {(0,0) (1,0) (2,0)}
+  //1, {(0,1) (1,1) (2,6)}
+  const std::pair<std::size_t,std::size_t> GT_Tracks[] =
+    {std::make_pair(0,0), std::make_pair(1,0), std::make_pair(2,0),
+     std::make_pair(0,1), std::make_pair(1,1), std::make_pair(2,6)};
+
+  BOOST_CHECK_EQUAL(2,  map_tracks.size());
+  std::size_t cpt = 0, i = 0;
+  for (TracksMap::const_iterator iterT = map_tracks.begin();
+    iterT != map_tracks.end();
+    ++iterT, ++i)
+  {
+    BOOST_CHECK_EQUAL(i, iterT->first);
+    BOOST_CHECK(iterT->second.descType == EImageDescriberType::UNKNOWN);
+    for (auto iter = iterT->second.featPerView.begin();
+      iter != iterT->second.featPerView.end();
+      ++iter)
+    {
+      BOOST_CHECK( GT_Tracks[cpt] == std::make_pair(iter->first, iter->second));
+      ++cpt;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Track_Streaming_MatchesFile) {
+
+  // random matches between views
+  const PairwiseMatches map_pairwisematches = createRandomMatches(8, 50);
+
+  // reference tracks
+  TracksBuilder trackBuilder;
+  trackBuilder.build(map_pairwisematches);
+  trackBuilder.filter(true, 3);
+  TracksMap map_tracksRef;
+  trackBuilder.exportToSTL(map_tracksRef);
+
+  // streaming tracks from a binary matches file
+  const std::string matchesFilepath = writeMatchesFile(map_pairwisematches);
+
+  StreamingTracksBuilder streamingTrackBuilder;
+  streamingTrackBuilder.build(std::vector<std::string>{matchesFilepath});
+  TracksStore tracksStore;
+  streamingTrackBuilder.exportToStore(tracksStore, true, 3);
+  TracksMap map_tracks;
+  tracksStore.exportToSTL(map_tracks);
+
+  // same tracks, regardless of the track ids
+  const std::set<TrackObservations> tracksRef = getTracksObservations(map_tracksRef);
+  const std::set<TrackObservations> tracks = getTracksObservations(map_tracks);
+
+  BOOST_CHECK(!tracksRef.empty());
+  BOOST_CHECK_EQUAL(tracksRef.size(), tracks.size());
+  BOOST_CHECK(tracksRef == tracks);
+
+  // per-view inverted index
+  BOOST_CHECK(tracksStore.hasViewIndex());
+  TracksStore importedTracksStore;
+  importedTracksStore.importFromSTL(map_tracksRef);
+  BOOST_CHECK(importedTracksStore.hasViewIndex());
+
+  TracksPerView tracksPerViewRef, tracksPerView;
+  computeTracksPerView(map_tracksRef, tracksPerViewRef);
+  importedTracksStore.exportTracksPerView(tracksPerView);
+  BOOST_CHECK(tracksPerViewRef == tracksPerView);
+
+  for (const auto& viewIt : tracksPerViewRef)
+  {
+    const IndexT viewId = viewIt.first;
+    BOOST_CHECK_EQUAL(viewIt.second.size(), importedTracksStore.viewNbTracks(viewId));
+    for (std::size_t t = 0; t < importedTracksStore.viewNbTracks(viewId); ++t)
+    {
+      const std::size_t trackId = importedTracksStore.viewTrackIds(viewId)[t];
+      BOOST_CHECK_EQUAL(viewIt.second[t], trackId);
+      BOOST_CHECK_EQUAL(map_tracksRef.at(trackId).featPerView.at(viewId), importedTracksStore.viewFeatureIds(viewId)[t]);
+    }
+  }
+  BOOST_CHECK_EQUAL(0, importedTracksStore.viewNbTracks(1000));
+
+  // memory budget
+  StreamingTracksBuilder limitedTrackBuilder(1024);
+  BOOST_CHECK_THROW(limitedTrackBuilder.build(std::vector<std::string>{matchesFilepath}), std::runtime_error);
+
+  boost::filesystem::remove(matchesFilepath);
+}
+
+BOOST_AUTO_TEST_CASE(Track_Streaming_Filter) {
+
+  // random matches between views, with a different number of matches per pair
+  PairwiseMatches map_pairwisematches = createRandomMatches(8, 60);
+  int nbMatches = 10;
+  for (auto& matchesIt : map_pairwisematches)
+  {
+    for (auto& descMatchesIt : matchesIt.second)
+      descMatchesIt.second.resize(nbMatches);
+    nbMatches = (nbMatches + 7) % 60;
+  }
+  const std::string matchesFilepath = writeMatchesFile(map_pairwisematches);
+
+  MatchesFilter filter;
+  filter.viewsKeys = {0, 1, 2, 4, 5, 7};
+  filter.descTypes = {EImageDescriberType::AKAZE};
+  filter.maxNbMatches = 40;
+  filter.minNbMatches = 15;
+
+  // reference tracks on the matches selected as matching::Load
+  PairwiseMatches map_filteredMatches;
+  for (const auto& matchesIt : map_pairwisematches)
+  {
+    if (!filter.viewsKeys.count(matchesIt.first.first) || !filter.viewsKeys.count(matchesIt.first.second))
+      continue;
+    IndMatches matches = matchesIt.second.at(EImageDescriberType::AKAZE);
+    if (matches.size() < filter.minNbMatches)
+      matches.clear();
+    else if (matches.size() > filter.maxNbMatches)
+      matches.resize(filter.maxNbMatches);
+    map_filteredMatches[matchesIt.first][EImageDescriberType::AKAZE] = matches;
+  }
+
+  TracksBuilder trackBuilder;
+  trackBuilder.build(map_filteredMatches);
+  trackBuilder.filter(true, 2);
+  TracksMap map_tracksRef;
+  trackBuilder.exportToSTL(map_tracksRef);
+
+  StreamingTracksBuilder streamingTrackBuilder;
+  streamingTrackBuilder.build(std::vector<std::string>{matchesFilepath}, filter);
+  TracksStore tracksStore;
+  streamingTrackBuilder.exportToStore(tracksStore, true, 2);
+  TracksMap map_tracks;
+  tracksStore.exportToSTL(map_tracks);
+
+  const std::set<TrackObservations> tracksRef = getTracksObservations(map_tracksRef);
+  BOOST_CHECK(!tracksRef.empty());
+  BOOST_CHECK(tracksRef == getTracksObservations(map_tracks));
+  for (const auto& trackIt : map_tracks)
+  {
+    BOOST_CHECK(trackIt.second.descType == EImageDescriberType::AKAZE);
+    for (const auto& featIt : trackIt.second.featPerView)
+      BOOST_CHECK(filter.viewsKeys.count(featIt.first));
+  }
+
+  // incoherent number of matches limits
+  filter.minNbMatches = 50;
+  StreamingTracksBuilder invalidTrackBuilder;
+  BOOST_CHECK_THROW(invalidTrackBuilder.build(std::vector<std::string>{matchesFilepath}, filter), std::runtime_error);
+
+  boost::filesystem::remove(matchesFilepath);
+}
+
+BOOST_AUTO_TEST_CASE(Track_Store_SaveLoad) {
+
+  TracksBuilder trackBuilder;
+  trackBuilder.build(createRandomMatches(6, 40));
+  trackBuilder.filter(true, 2);
+  TracksMap map_tracksRef;
+  trackBuilder.exportToSTL(map_tracksRef);
+
+  TracksStore tracksStore;
+  tracksStore.importFromSTL(map_tracksRef);
+  BOOST_REQUIRE(!tracksStore.empty());
+
+  const std::string tracksFilepath = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("tracks_%%%%%%.bin")).string();
+  tracksStore.save(tracksFilepath);
+
+  TracksStore loadedTracksStore;
+  loadedTracksStore.load(tracksFilepath);
+  BOOST_CHECK(loadedTracksStore.hasViewIndex());
+  BOOST_CHECK_EQUAL(tracksStore.nbTracks(), loadedTracksStore.nbTracks());
+  BOOST_CHECK_EQUAL(tracksStore.nbObservations(), loadedTracksStore.nbObservations());
+
+  // same tracks with the same ids
+  TracksMap map_tracks;
+  loadedTracksStore.exportToSTL(map_tracks);
+  BOOST_REQUIRE_EQUAL(map_tracksRef.size(), map_tracks.size());
+  for (const auto& trackIt : map_tracksRef)
+  {
+    const Track& track = map_tracks.at(trackIt.first);
+    BOOST_CHECK(trackIt.second.descType == track.descType);
+    BOOST_CHECK(trackIt.second.featPerView == track.featPerView);
+  }
+
+  TracksPerView tracksPerViewRef, tracksPerView;
+  computeTracksPerView(map_tracksRef, tracksPerViewRef);
+  loadedTracksStore.exportTracksPerView(tracksPerView);
+  BOOST_CHECK(tracksPerViewRef == tracksPerView);
+
+  // truncated file
+  boost::filesystem::resize_file(tracksFilepath, boost::filesystem::file_size(tracksFilepath) - 4);
+  BOOST_CHECK_THROW(loadedTracksStore.load(tracksFilepath), std::runtime_error);
+  BOOST_CHECK(loadedTracksStore.empty());
+
+  // not a tracks file
+  {
+    std::ofstream stream(tracksFilepath, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream << "not a tracks file, not a tracks file";
+  }
+  BOOST_CHECK_THROW(loadedTracksStore.load(tracksFilepath), std::runtime_error);
+
+  boost::filesystem::remove(tracksFilepath);
+}
+
 BOOST_AUTO_TEST_CASE(Track_GetCommonTracksInImages)
 {
   {
@@ -228,3 +512,42 @@ BOOST_AUTO_TEST_CASE(Track_GetCommonTracksInImages)
     BOOST_CHECK_EQUAL(base.size(), set_visibleTracks.size());
   }
 }
+
+BOOST_AUTO_TEST_CASE(Track_Store_GetCommonTracksInImages)
+{
+  TracksBuilder trackBuilder;
+  trackBuilder.build(createRandomMatches(6, 40));
+  trackBuilder.filter(true, 2);
+  TracksMap map_tracks;
+  trackBuilder.exportToSTL(map_tracks);
+  TracksPerView map_tracksPerView;
+  computeTracksPerView(map_tracks, map_tracksPerView);
+
+  TracksStore tracksStore;
+  tracksStore.importFromSTL(map_tracks);
+
+  // same common tracks as with the tracks map, including a view without track
+  for (const std::set<std::size_t>& set_imageIndex : std::vector<std::set<std::size_t>>{{0, 1}, {1, 3, 5}, {2, 50}})
+  {
+    TracksMap map_tracksCommonRef;
+    getCommonTracksInImagesFast(set_imageIndex, map_tracks, map_tracksPerView, map_tracksCommonRef);
+    TracksMap map_tracksCommon;
+    BOOST_CHECK_EQUAL(!map_tracksCommonRef.empty(), getCommonTracksInImages(set_imageIndex, tracksStore, map_tracksCommon));
+    BOOST_REQUIRE_EQUAL(map_tracksCommonRef.size(), map_tracksCommon.size());
+    for (const auto& trackIt : map_tracksCommonRef)
+    {
+      const Track& track = map_tracksCommon.at(trackIt.first);
+      BOOST_CHECK(track.descType == trackIt.second.descType);
+      BOOST_CHECK(track.featPerView == trackIt.second.featPerView);
+    }
+  }
+
+  // same feature ids
+  std::set<std::size_t> trackIds;
+  getTracksInImageFast(3, map_tracksPerView, trackIds);
+  trackIds.insert(tracksStore.nbTracks()); // non-existing track
+  std::vector<FeatureId> featuresIdRef, featuresId;
+  getFeatureIdInViewPerTrack(map_tracks, trackIds, 3, &featuresIdRef);
+  BOOST_CHECK(getFeatureIdInViewPerTrack(tracksStore, trackIds, 3, &featuresId));
+  BOOST_CHECK(featuresIdRef == featuresId);
+}
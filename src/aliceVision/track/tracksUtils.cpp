@@ -7,6 +7,7 @@
 
 #include "tracksUtils.hpp"
 
+#include <algorithm>
 #include <iterator>
 
 
@@ -120,6 +121,59 @@ bool getCommonTracksInImagesFast(const std::set<std::size_t>& imageIndexes,
   return !tracksOut.empty();
 }
 
+bool getCommonTracksInImages(const std::set<std::size_t>& imageIndexes,
+                             const TracksStore& tracksStore,
+                             TracksMap& tracksOut)
+{
+  assert(!imageIndexes.empty());
+  tracksOut.clear();
+
+  // intersect the sorted ids of the tracks visible in each view
+  std::vector<IndexT> commonTrackIds;
+  for(std::set<std::size_t>::const_iterator it = imageIndexes.cbegin(); it != imageIndexes.cend(); ++it)
+  {
+    const IndexT viewId = static_cast<IndexT>(*it);
+    const IndexT* viewTrackIds = tracksStore.viewTrackIds(viewId);
+    const std::size_t viewNbTracks = tracksStore.viewNbTracks(viewId);
+
+    if(it == imageIndexes.cbegin())
+    {
+      commonTrackIds.assign(viewTrackIds, viewTrackIds + viewNbTracks);
+    }
+    else
+    {
+      std::vector<IndexT> tmp;
+      tmp.reserve(std::min(commonTrackIds.size(), viewNbTracks));
+      std::set_intersection(commonTrackIds.cbegin(), commonTrackIds.cend(),
+                            viewTrackIds, viewTrackIds + viewNbTracks,
+                            std::back_inserter(tmp));
+      commonTrackIds.swap(tmp);
+    }
+    if(commonTrackIds.empty())
+      return false;
+  }
+
+  // the track observations are sorted by view id
+  tracksOut.reserve(commonTrackIds.size());
+  for(const IndexT trackId : commonTrackIds)
+  {
+    const IndexT* trackViewIds = tracksStore.trackViewIds(trackId);
+    const IndexT* trackViewIdsEnd = trackViewIds + tracksStore.trackLength(trackId);
+    const IndexT* trackFeatIds = tracksStore.trackFeatureIds(trackId);
+
+    Track& trackOut = tracksOut.insert(tracksOut.end(), std::make_pair(std::size_t(trackId), Track()))->second;
+    trackOut.descType = tracksStore.trackDescType(trackId);
+    trackOut.featPerView.reserve(imageIndexes.size());
+    for(std::size_t imageIndex : imageIndexes)
+    {
+      const IndexT* viewIt = std::lower_bound(trackViewIds, trackViewIdsEnd, static_cast<IndexT>(imageIndex));
+      trackOut.featPerView.insert(trackOut.featPerView.end(),
+                                  std::make_pair(imageIndex, std::size_t(trackFeatIds[viewIt - trackViewIds])));
+    }
+  }
+  return !tracksOut.empty();
+}
+
 void getTracksInImages(const std::set<std::size_t>& imagesId,
                        const TracksMap& tracks,
                        std::set<std::size_t>& tracksId)
@@ -224,6 +278,27 @@ bool getFeatureIdInViewPerTrack(const TracksMap& allTracks,
   return !out_featId->empty();
 }
 
+bool getFeatureIdInViewPerTrack(const TracksStore& tracksStore,
+                                const std::set<std::size_t>& trackIds,
+                                IndexT viewId,
+                                std::vector<FeatureId>* out_featId)
+{
+  for(std::size_t trackId : trackIds)
+  {
+    // ignore it if the track doesn't exist
+    if(trackId >= tracksStore.nbTracks())
+      continue;
+
+    // the track observations are sorted by view id
+    const IndexT* trackViewIds = tracksStore.trackViewIds(trackId);
+    const IndexT* trackViewIdsEnd = trackViewIds + tracksStore.trackLength(trackId);
+    const IndexT* viewIt = std::lower_bound(trackViewIds, trackViewIdsEnd, viewId);
+    if(viewIt != trackViewIdsEnd && *viewIt == viewId)
+      out_featId->emplace_back(tracksStore.trackDescType(trackId), tracksStore.trackFeatureIds(trackId)[viewIt - trackViewIds]);
+  }
+  return !out_featId->empty();
+}
+
 void tracksToIndexedMatches(const TracksMap& tracks,
                                    const std::vector<IndexT>& filterIndex,
                                    std::vector<IndMatch>* out_index)
@@ -7,6 +7,7 @@
 
 #pragma once
 #include <aliceVision/track/Track.hpp>
+#include <aliceVision/track/TracksStore.hpp>
 
 
 namespace aliceVision {
@@ -44,6 +45,16 @@ bool getCommonTracksInImagesFast(const std::set<std::size_t>& imageIndexes,
                                           const TracksPerView& tracksPerView,
                                           TracksMap& tracksOut);
   
+/**
+ * @brief Find common tracks among images, using the per-view index of the tracks store.
+ * @param[in] imageIndexes: set of images we are looking for common tracks.
+ * @param[in] tracksStore: all tracks of the scene, with the per-view index.
+ * @param[out] tracksOut: output with only the common tracks, restricted to the given images.
+ */
+bool getCommonTracksInImages(const std::set<std::size_t>& imageIndexes,
+                             const TracksStore& tracksStore,
+                             TracksMap& tracksOut);
+
 /**
  * @brief Find all the visible tracks from a set of images.
  * @param[in] imagesId set of images we are looking for tracks.
@@ -112,6 +123,18 @@ bool getFeatureIdInViewPerTrack(const TracksMap& allTracks,
                                        IndexT viewId,
                                        std::vector<FeatureId>* out_featId);
 
+/**
+ * @brief Get feature id (with associated describer type) in the specified view for each TrackId
+ * @param[in] tracksStore all tracks of the scene
+ * @param[in] trackIds the tracks in the images
+ * @param[in] viewId: ImageId we are looking for features
+ * @param[out] out_featId the number of features in the image as a vector
+ * @return true if the vector of features Ids is not empty
+ */
+bool getFeatureIdInViewPerTrack(const TracksStore& tracksStore,
+                                const std::set<std::size_t>& trackIds,
+                                IndexT viewId,
+                                std::vector<FeatureId>* out_featId);
 
 struct FunctorMapFirstEqual
 {
@@ -5,9 +5,13 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "Database.hpp"
+#include <aliceVision/alicevision_omp.hpp>
+#include <aliceVision/system/Logger.hpp>
 #include <aliceVision/system/ProgressDisplay.hpp>
+#include <aliceVision/system/Timer.hpp>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/tail.hpp>
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <stdexcept>
@@ -78,19 +82,19 @@ void Database::sanityCheck(std::size_t N, std::map<std::size_t, DocMatches>& mat
   }
 
   matches.clear();
-  // since we already know the size of the vectors, in order to parallelize the 
-  // query allocate the whole memory
-  auto display = system::createConsoleProgressDisplay(database_.size(), std::cout);
-  
-  //#pragma omp parallel for default(none) shared(database_)
+
+  // query all the documents of the database at once
+  std::vector<const SparseHistogram*> queries;
+  queries.reserve(database_.size());
   for(const auto &doc : database_)
-  {
-    std::vector<DocMatch> m;
-    find(doc.second, N, m);
-    //		matches.emplace_back( m );
-    matches[doc.first] = m;
-    ++display;
-  }
+    queries.push_back(&doc.second);
+
+  std::vector<DocMatches> matchesPerQuery;
+  findBatch(queries, N, matchesPerQuery);
+
+  std::size_t i = 0;
+  for(const auto &doc : database_)
+    matches[doc.first] = std::move(matchesPerQuery.at(i++));
 }
 
 /**
@@ -135,6 +139,196 @@ void Database::find( const SparseHistogram& query, std::size_t N, std::vector<Do
     matches.resize(nMatches);
 }
 
+void Database::findBatch(const std::vector<const SparseHistogram*>& queries, std::size_t N, std::vector<DocMatches>& matchesPerQuery,
+                         const std::string& distanceMethod, QueriesStatistics* statistics) const
+{
+  enum class EScoring { CLASSIC, COMMON_POINTS, STRONG_COMMON_POINTS, INVERSED_WEIGHTED_COMMON_POINTS, EXHAUSTIVE };
+
+  // the scores which can be accumulated from the postings of the query words use the inverted file,
+  // the others are computed document by document
+  EScoring scoring;
+  if(distanceMethod == "classic")
+    scoring = EScoring::CLASSIC;
+  else if(distanceMethod == "commonPoints")
+    scoring = EScoring::COMMON_POINTS;
+  else if(distanceMethod == "strongCommonPoints")
+    scoring = EScoring::STRONG_COMMON_POINTS;
+  else if(distanceMethod == "inversedWeightedCommonPoints")
+    scoring = EScoring::INVERSED_WEIGHTED_COMMON_POINTS;
+  else if(distanceMethod == "weightedStrongCommonPoints")
+    scoring = EScoring::EXHAUSTIVE;
+  else
+    throw std::invalid_argument("distance method " + distanceMethod + " unknown!");
+
+  system::Timer timer;
+
+  FlatInvertedFile invertedFile;
+  buildFlatInvertedFile(invertedFile);
+
+  const std::size_t nbDocuments = invertedFile.docIds.size();
+  const std::size_t nbWords = invertedFile.offsets.size() - 1;
+  const std::size_t nMatches = (N == 0) ? nbDocuments : std::min(N, nbDocuments);
+
+  // documents used by the exhaustive scoring, in the order of the document indexes
+  std::vector<const SparseHistogram*> documents;
+  if(scoring == EScoring::EXHAUSTIVE)
+  {
+    documents.reserve(nbDocuments);
+    for(const auto& document : database_)
+      documents.push_back(&document.second);
+  }
+
+  // best-to-worst order, ties sorted by document id to be independent of the threads scheduling
+  const auto matchesOrder = [](const DocMatch& a, const DocMatch& b) {
+    return (a.score < b.score) || (a.score == b.score && a.id < b.id);
+  };
+
+  matchesPerQuery.assign(queries.size(), DocMatches());
+
+#pragma omp parallel
+  {
+    // per thread buffers, reused for all the queries
+    std::vector<float> scores(nbDocuments);
+    DocMatches matches(nbDocuments);
+
+#pragma omp for schedule(dynamic)
+    for(std::ptrdiff_t q = 0; q < static_cast<std::ptrdiff_t>(queries.size()); ++q)
+    {
+      const SparseHistogram& query = *queries.at(q);
+
+      if(scoring == EScoring::EXHAUSTIVE)
+      {
+        for(std::size_t d = 0; d < nbDocuments; ++d)
+          scores[d] = sparseDistance(query, *documents[d], distanceMethod, word_weights_);
+      }
+      else
+      {
+        std::fill(scores.begin(), scores.end(), 0.0f);
+        float queryNbFeatures = 0.0f;
+
+        // accumulate the common points of the query and each document from the postings of the query words
+        for(const auto& wordPair : query)
+        {
+          const Word word = wordPair.first;
+          const uint32_t queryCount = static_cast<uint32_t>(wordPair.second.size());
+          queryNbFeatures += queryCount;
+
+          if(word < 0 || static_cast<std::size_t>(word) >= nbWords)
+            continue;
+
+          const uint32_t* postingsDocIndex = invertedFile.postingsDocIndex.data() + invertedFile.offsets[word];
+          const uint32_t* postingsCount = invertedFile.postingsCount.data() + invertedFile.offsets[word];
+          const std::size_t nbPostings = invertedFile.offsets[word + 1] - invertedFile.offsets[word];
+
+          switch(scoring)
+          {
+            case EScoring::CLASSIC:
+            case EScoring::COMMON_POINTS:
+              for(std::size_t p = 0; p < nbPostings; ++p)
+                scores[postingsDocIndex[p]] += std::min(queryCount, postingsCount[p]);
+              break;
+            case EScoring::STRONG_COMMON_POINTS:
+              if(queryCount == 1)
+              {
+                for(std::size_t p = 0; p < nbPostings; ++p)
+                  scores[postingsDocIndex[p]] += (postingsCount[p] == 1) ? 1.0f : 0.0f;
+              }
+              break;
+            case EScoring::INVERSED_WEIGHTED_COMMON_POINTS:
+              for(std::size_t p = 0; p < nbPostings; ++p)
+                scores[postingsDocIndex[p]] += (1.f / std::min(queryCount, postingsCount[p])) * word_weights_[word];
+              break;
+            default:
+              break;
+          }
+        }
+
+        // convert the common points into distances
+        if(scoring == EScoring::CLASSIC)
+        {
+          // sum of the absolute differences of the word counts
+          for(std::size_t d = 0; d < nbDocuments; ++d)
+            scores[d] = queryNbFeatures + invertedFile.docNbFeatures[d] - 2.0f * scores[d];
+        }
+        else
+        {
+          for(std::size_t d = 0; d < nbDocuments; ++d)
+            scores[d] = -scores[d];
+        }
+      }
+
+      // keep the top N matches
+      for(std::size_t d = 0; d < nbDocuments; ++d)
+        matches[d] = DocMatch(invertedFile.docIds[d], scores[d]);
+
+      std::partial_sort(matches.begin(), matches.begin() + nMatches, matches.end(), matchesOrder);
+      matchesPerQuery[q].assign(matches.begin(), matches.begin() + nMatches);
+    }
+  }
+
+  const double duration = timer.elapsed();
+
+  if(statistics != nullptr)
+  {
+    statistics->nbQueries = queries.size();
+    statistics->duration = duration;
+    statistics->queriesPerSecond = (duration > 0.0) ? queries.size() / duration : 0.0;
+  }
+
+  ALICEVISION_LOG_DEBUG("Database queries: " << queries.size() << " queries on " << nbDocuments << " documents in "
+                        << duration << " s (" << ((duration > 0.0) ? queries.size() / duration : 0.0) << " queries per second).");
+}
+
+void Database::buildFlatInvertedFile(FlatInvertedFile& invertedFile) const
+{
+  invertedFile.docIds.clear();
+  invertedFile.docNbFeatures.clear();
+  invertedFile.docIds.reserve(database_.size());
+  invertedFile.docNbFeatures.reserve(database_.size());
+
+  // count the postings of each word
+  std::size_t nbWords = word_files_.size();
+  for(const auto& document : database_)
+  {
+    if(!document.second.empty())
+      nbWords = std::max(nbWords, static_cast<std::size_t>(document.second.rbegin()->first) + 1);
+  }
+
+  std::vector<std::size_t> nbPostingsPerWord(nbWords, 0);
+  for(const auto& document : database_)
+  {
+    float nbFeatures = 0.0f;
+    for(const auto& wordPair : document.second)
+    {
+      ++nbPostingsPerWord[wordPair.first];
+      nbFeatures += wordPair.second.size();
+    }
+    invertedFile.docIds.push_back(document.first);
+    invertedFile.docNbFeatures.push_back(nbFeatures);
+  }
+
+  invertedFile.offsets.assign(nbWords + 1, 0);
+  for(std::size_t w = 0; w < nbWords; ++w)
+    invertedFile.offsets[w + 1] = invertedFile.offsets[w] + nbPostingsPerWord[w];
+
+  // fill the postings, documents are visited in increasing order of index
+  invertedFile.postingsDocIndex.resize(invertedFile.offsets.back());
+  invertedFile.postingsCount.resize(invertedFile.offsets.back());
+
+  std::vector<std::size_t> nextPosting(invertedFile.offsets.begin(), invertedFile.offsets.end() - 1);
+  uint32_t docIndex = 0;
+  for(const auto& document : database_)
+  {
+    for(const auto& wordPair : document.second)
+    {
+      const std::size_t p = nextPosting[wordPair.first]++;
+      invertedFile.postingsDocIndex[p] = docIndex;
+      invertedFile.postingsCount[p] = static_cast<uint32_t>(wordPair.second.size());
+    }
+    ++docIndex;
+  }
+}
+
 /**
  * @brief Compute the TF-IDF weights of all the words. To be called after inserting a corpus of
  * training examples into the database.
@@ -51,6 +51,19 @@ struct DocMatch
 
 typedef std::vector<DocMatch> DocMatches;
 
+/**
+ * @brief Statistics of a batch of database queries.
+ */
+struct QueriesStatistics
+{
+  /// number of queries
+  std::size_t nbQueries = 0;
+  /// duration of the queries (in seconds)
+  double duration = 0.0;
+  /// throughput of the queries
+  double queriesPerSecond = 0.0;
+};
+
 std::ostream& operator<<(std::ostream& os, const DocMatches& matches);
 
 /**
@@ -106,6 +119,22 @@ public:
    */
   void find(const SparseHistogram& query, std::size_t N, std::vector<DocMatch>& matches, const std::string &distanceMethod = "strongCommonPoints") const;
 
+  /**
+   * @brief Find the top N matches in the database for a batch of query documents.
+   *
+   * The queries are processed in parallel. The database is indexed in a flat inverted file, so each query
+   * only visits the postings of its own words instead of comparing its histogram with every document.
+   * Matches with the same score are sorted by document id.
+   *
+   * @param[in] queries The query documents, a set of quantized words per query.
+   * @param[in] N The number of matches to return per query (0 for all the documents).
+   * @param[out] matchesPerQuery IDs and scores for the top N matching database documents, in the order of the queries.
+   * @param[in] distanceMethod distance method (norm L1, etc.)
+   * @param[out] statistics optional queries statistics
+   */
+  void findBatch(const std::vector<const SparseHistogram*>& queries, std::size_t N, std::vector<DocMatches>& matchesPerQuery,
+                 const std::string& distanceMethod = "strongCommonPoints", QueriesStatistics* statistics = nullptr) const;
+
   /**
    * @brief Compute the TF-IDF weights of all the words. To be called after inserting a corpus of
    * training examples into the database.
@@ -151,6 +180,30 @@ private:
   // Stored in increasing order by DocId
   typedef std::vector<WordFrequency> InvertedFile;
 
+  /**
+   * @brief Inverted file of all the words stored in flat arrays.
+   * The postings of the word w are in [offsets[w], offsets[w+1]), in increasing order of document index.
+   */
+  struct FlatInvertedFile
+  {
+    /// document id per document index (in increasing order)
+    std::vector<DocId> docIds;
+    /// number of features (sum of the word counts) per document index
+    std::vector<float> docNbFeatures;
+    /// offset of the postings of each word
+    std::vector<std::size_t> offsets;
+    /// document index of each posting
+    std::vector<uint32_t> postingsDocIndex;
+    /// count of the word in the document of each posting
+    std::vector<uint32_t> postingsCount;
+  };
+
+  /**
+   * @brief Build the flat inverted file of the documents of the database
+   * @param[out] invertedFile the flat inverted file
+   */
+  void buildFlatInvertedFile(FlatInvertedFile& invertedFile) const;
+
   /// @todo Use sorted vector?
   // typedef std::vector< std::pair<Word, float> > DocumentVector;
   
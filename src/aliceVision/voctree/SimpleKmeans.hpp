@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <mutex>
 #include <numeric>
+#include <random>
 #include <vector>
 #include <limits>
 #include <stdio.h>
@@ -34,14 +35,15 @@ struct InitRandom
 {
 
   template<class Feature, class Distance, class FeatureAllocator>
-  void operator()(const std::vector<Feature*>& features, size_t k, std::vector<Feature, FeatureAllocator>& centers, Distance distance, const int verbose = 0)
+  void operator()(const std::vector<Feature*>& features, size_t k, std::vector<Feature, FeatureAllocator>& centers, Distance distance,
+                  std::mt19937& randomNumberGenerator, const int verbose = 0)
   {
     ALICEVISION_LOG_DEBUG("#\t\tRandom initialization");
     // Construct a random permutation of the features using a Fisher-Yates shuffle
     std::vector<Feature*> features_perm = features;
     for(size_t i = features.size(); i > 1; --i)
     {
-      size_t k = rand() % i;
+      size_t k = std::uniform_int_distribution<size_t>(0, i - 1)(randomNumberGenerator);
       std::swap(features_perm[i - 1], features_perm[k]);
     }
     // Take the first k permuted features as the initial centers
@@ -62,7 +64,8 @@ struct InitKmeanspp
 {
 
   template<class Feature, class Distance, class FeatureAllocator>
-  void operator()(const std::vector<Feature*>& features, size_t k, std::vector<Feature, FeatureAllocator>& centers, Distance distance, const int verbose = 0)
+  void operator()(const std::vector<Feature*>& features, size_t k, std::vector<Feature, FeatureAllocator>& centers, Distance distance,
+                  std::mt19937& randomNumberGenerator, const int verbose = 0)
   {
     typedef typename Distance::result_type squared_distance_type;
 
@@ -96,7 +99,7 @@ struct InitKmeanspp
     typename std::vector<Feature*>::const_iterator featiter;
 
     // 1. Choose a random center
-    size_t randCenter = rand() % features.size();
+    size_t randCenter = std::uniform_int_distribution<size_t>(0, features.size() - 1)(randomNumberGenerator);
 
     // add it to the centers
     centers[0] = *features[ randCenter ];
@@ -121,10 +124,13 @@ struct InitKmeanspp
 
       squared_distance_type bestSum = std::numeric_limits<squared_distance_type>::max();
       std::size_t bestCenter = -1;
+      int bestTrial = numTrials;
 
+      // the trials are drawn before the parallel loop: they do not depend on the threads
+      std::uniform_real_distribution<float> percDistribution(0.f, 1.f);
       for (auto& perc : trialPercs)
       {
-          perc = (float)std::rand() / RAND_MAX;
+          perc = percDistribution(randomNumberGenerator);
       }
 
       //make it a little bit more robust and try several guesses
@@ -142,7 +148,7 @@ struct InitKmeanspp
         squared_distance_type partial = (squared_distance_type)(currSum * perc);
         // look for the element that cap the partial sum that has been
         // drawn
-        dstiter = dists.begin();
+        auto dstiter = dists.cbegin();
         while((partial > 0) && (dstiter != dists.end()))
         {
           assert(dstiter != dists.end());
@@ -163,7 +169,7 @@ struct InitKmeanspp
         if(dstiter == dists.end())
           featidx = features.size() - 1;
         else
-          featidx = dstiter - dists.begin();
+          featidx = dstiter - dists.cbegin();
 
         // 2. compute the distance of each feature from the current center
         squared_distance_type distSum = 0;
@@ -181,11 +187,13 @@ struct InitKmeanspp
 
         {
             std::lock_guard<std::mutex> lock(bestSumMutex);
-            if (distSum < bestSum)
+            // on equal sums, keep the first trial whatever the threads order
+            if (distSum < bestSum || (distSum == bestSum && j < bestTrial))
             {
                 // save the best so far
                 bestSum = distSum;
                 bestCenter = featidx;
+                bestTrial = j;
                 std::swap(distsTemp, distsTempBest);
             }
         }
@@ -211,7 +219,8 @@ struct InitGiven
 {
 
   template<class Feature, class Distance, class FeatureAllocator>
-  void operator()(const std::vector<Feature*>& features, std::size_t k, std::vector<Feature, FeatureAllocator>& centers, Distance distance, const int verbose = 0)
+  void operator()(const std::vector<Feature*>& features, std::size_t k, std::vector<Feature, FeatureAllocator>& centers, Distance distance,
+                  std::mt19937& randomNumberGenerator, const int verbose = 0)
   {
     // Do nothing!
   }
@@ -290,7 +299,7 @@ class SimpleKmeans
 {
 public:
   typedef typename Distance::result_type squared_distance_type;
-  typedef boost::function<void(const std::vector<Feature*>&, std::size_t, std::vector<Feature, FeatureAllocator>&, Distance, const int verbose) > Initializer;
+  typedef boost::function<void(const std::vector<Feature*>&, std::size_t, std::vector<Feature, FeatureAllocator>&, Distance, std::mt19937&, const int verbose) > Initializer;
 
   /**
    * @brief Constructor
@@ -329,6 +338,38 @@ public:
     restarts_ = restarts;
   }
 
+  std::size_t getMiniBatchSize() const
+  {
+    return mini_batch_size_;
+  }
+
+  /**
+   * @brief Use the mini-batch k-means algorithm on sets larger than the batch size.
+   *
+   * Each iteration assigns a random batch of features and moves the centers with a per-center learning rate.
+   * D. Sculley (2010). "Web-scale k-means clustering". Proceedings of the 19th international conference on World Wide Web.
+   *
+   * @param batchSize number of features per iteration, 0 to use the standard Lloyd's algorithm
+   */
+  void setMiniBatchSize(std::size_t batchSize)
+  {
+    mini_batch_size_ = batchSize;
+  }
+
+  std::mt19937::result_type getSeed() const
+  {
+    return seed_;
+  }
+
+  /**
+   * @brief Set the seed of the random number generator used by the clustering functions without generator.
+   *        The clustering is reproducible for a given seed and number of threads.
+   */
+  void setSeed(std::mt19937::result_type seed)
+  {
+    seed_ = seed;
+  }
+
   int getVerbose() const
   {
     return verbose_;
@@ -366,17 +407,45 @@ public:
                                         std::vector<Feature, FeatureAllocator>& centers,
                                         std::vector<unsigned int>& membership) const;
 
+  /**
+   * @brief Partition a set of features into k clusters with the given random number generator.
+   *
+   * Several clusterings can run in parallel, each one with its own generator.
+   *
+   * @param      features   The features to be clustered.
+   * @param      k          The number of clusters.
+   * @param[out] centers    A set of k cluster centers.
+   * @param[out] membership Cluster assignment for each feature
+   * @param      randomNumberGenerator The random number generator used by the initialization and the iterations
+   */
+  squared_distance_type clusterPointers(const std::vector<Feature*>& features, std::size_t k,
+                                        std::vector<Feature, FeatureAllocator>& centers,
+                                        std::vector<unsigned int>& membership,
+                                        std::mt19937& randomNumberGenerator) const;
+
 private:
 
   squared_distance_type clusterOnce(const std::vector<Feature*>& features, std::size_t k,
                                     std::vector<Feature, FeatureAllocator>& centers,
-                                    std::vector<unsigned int>& membership) const;
+                                    std::vector<unsigned int>& membership,
+                                    std::mt19937& randomNumberGenerator) const;
+
+  squared_distance_type clusterOnceMiniBatch(const std::vector<Feature*>& features, std::size_t k,
+                                             std::vector<Feature, FeatureAllocator>& centers,
+                                             std::vector<unsigned int>& membership,
+                                             std::mt19937& randomNumberGenerator) const;
+
+  /// Get the index of the nearest center and its distance.
+  unsigned int nearestCenter(const Feature& feature, const std::vector<Feature, FeatureAllocator>& centers, std::size_t k,
+                             squared_distance_type& distance) const;
 
   Feature zero_;
   Distance distance_;
   Initializer choose_centers_;
   std::size_t max_iterations_;
   std::size_t restarts_;
+  std::size_t mini_batch_size_;
+  std::mt19937::result_type seed_;
   int verbose_;
 };
 
@@ -388,7 +457,9 @@ distance_(d),
 choose_centers_(InitKmeanspp()),
 max_iterations_(100),
 verbose_(verbose),
-restarts_(1)
+restarts_(1),
+mini_batch_size_(0),
+seed_(std::mt19937::default_seed)
 {
 }
 
@@ -410,6 +481,17 @@ typename SimpleKmeans<Feature, Distance, FeatureAllocator>::squared_distance_typ
 SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterPointers(const std::vector<Feature*>& features, size_t k,
                                                                    std::vector<Feature, FeatureAllocator>& centers,
                                                                    std::vector<unsigned int>& membership) const
+{
+  std::mt19937 randomNumberGenerator(seed_);
+  return clusterPointers(features, k, centers, membership, randomNumberGenerator);
+}
+
+template < class Feature, class Distance, class FeatureAllocator >
+typename SimpleKmeans<Feature, Distance, FeatureAllocator>::squared_distance_type
+SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterPointers(const std::vector<Feature*>& features, size_t k,
+                                                                   std::vector<Feature, FeatureAllocator>& centers,
+                                                                   std::vector<unsigned int>& membership,
+                                                                   std::mt19937& randomNumberGenerator) const
 {
   std::vector<Feature, FeatureAllocator> new_centers(centers);
   new_centers.resize(k);
@@ -420,8 +502,8 @@ SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterPointers(const std::ve
   for(std::size_t starts = 0; starts < restarts_; ++starts)
   {
     if(verbose_ > 0) ALICEVISION_LOG_DEBUG("Trial " << starts + 1 << "/" << restarts_);
-    choose_centers_(features, k, new_centers, distance_, verbose_);
-    squared_distance_type sse = clusterOnce(features, k, new_centers, new_membership);
+    choose_centers_(features, k, new_centers, distance_, randomNumberGenerator, verbose_);
+    squared_distance_type sse = clusterOnce(features, k, new_centers, new_membership, randomNumberGenerator);
     if(verbose_ > 0) ALICEVISION_LOG_DEBUG("End of Trial " << starts + 1 << "/" << restarts_);
     if(sse < least_sse)
     {
@@ -436,84 +518,97 @@ SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterPointers(const std::ve
   return least_sse;
 }
 
+template < class Feature, class Distance, class FeatureAllocator >
+unsigned int SimpleKmeans<Feature, Distance, FeatureAllocator>::nearestCenter(const Feature& feature,
+                                                                           const std::vector<Feature, FeatureAllocator>& centers,
+                                                                           std::size_t k, squared_distance_type& distance) const
+{
+  // @todo if k is large, let's say k>100 use FLAAN to retrieve the
+  // cluster center
+  squared_distance_type d_min = std::numeric_limits<squared_distance_type>::max();
+  unsigned int nearest = 0;
+  for(unsigned int j = 0; j < k; ++j)
+  {
+    const squared_distance_type d = distance_(feature, centers[j]);
+    if(d < d_min)
+    {
+      d_min = d;
+      nearest = j;
+    }
+  }
+  distance = d_min;
+  return nearest;
+}
+
 template < class Feature, class Distance, class FeatureAllocator >
 typename SimpleKmeans<Feature, Distance, FeatureAllocator>::squared_distance_type
 SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterOnce(const std::vector<Feature*>& features, std::size_t k,
                                                                std::vector<Feature, FeatureAllocator>& centers,
-                                                               std::vector<unsigned int>& membership) const
+                                                               std::vector<unsigned int>& membership,
+                                                               std::mt19937& randomNumberGenerator) const
 {
-  typedef typename std::vector<Feature, FeatureAllocator>::value_type centerType;
-  typedef typename Distance::value_type feature_value_type;
+  if(mini_batch_size_ > 0 && features.size() > mini_batch_size_)
+    return clusterOnceMiniBatch(features, k, centers, membership, randomNumberGenerator);
 
   std::vector<std::size_t> new_center_counts(k);
   std::vector<Feature, FeatureAllocator> new_centers(k);
-  std::vector<std::mutex> centersLocks(k);
   squared_distance_type max_center_shift = std::numeric_limits<squared_distance_type>::max();
 
+  // On small problems enabling multithreading does much more harm than good because thread
+  // creation is relatively expensive.
+  const bool enableMultithreading = features.size() * k > 1000000;
+  const int nbThreads = enableMultithreading ? omp_get_max_threads() : 1;
+
+  // Each thread accumulates its own cluster centers, they are reduced after the assignment
+  std::vector<std::vector<Feature, FeatureAllocator>> thread_centers(nbThreads, std::vector<Feature, FeatureAllocator>(k));
+  std::vector<std::vector<std::size_t>> thread_center_counts(nbThreads, std::vector<std::size_t>(k));
+
   if(verbose_ > 0) ALICEVISION_LOG_DEBUG("Iterations");
   for(std::size_t iter = 0; iter < max_iterations_; ++iter)
   {
     if(verbose_ > 0) ALICEVISION_LOG_DEBUG("*");
-    // Zero out new centers and counts
-    std::fill(new_center_counts.begin(), new_center_counts.end(), 0);
-    //		for(std::size_t i = 0; i < k; checkElements(new_centers[i++], "bef"));
-    std::fill(new_centers.begin(), new_centers.end(), zero_);
-    //		for(std::size_t i = 0; i < k; checkElements(new_centers[i++], "aft"));
-    assert(checkVectorElements(new_centers, "newcenters init"));
-    bool is_stable = true;
-
-    // On small problems enabling multithreading does much more harm than good because thread
-    // creation is relatively expensive.
-    // TODO: Ideally a thread pool would be created before the first iteration and the iterations
-    // would reuse the existing threads.
-    bool enableMultithreading = features.size() * k > 1000000;
+    // Zero out the accumulated centers and counts
+    for(int t = 0; t < nbThreads; ++t)
+    {
+      std::fill(thread_centers[t].begin(), thread_centers[t].end(), zero_);
+      std::fill(thread_center_counts[t].begin(), thread_center_counts[t].end(), 0);
+    }
+    std::size_t nbChanges = 0;
 
     // Assign data objects to current centers
-    #pragma omp parallel for shared( new_centers, new_center_counts, features, centers, membership) if(enableMultithreading)
+    #pragma omp parallel for num_threads(nbThreads) reduction(+:nbChanges)
     for(ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(features.size()); ++i)
     {
-      squared_distance_type d_min = std::numeric_limits<squared_distance_type>::max();
-      unsigned int nearest = 0;
-      bool found = false;
-
-      // @todo if k is large, let's say k>100 use FLAAN to retrieve the 
-      // cluster center
-
       // Find the nearest cluster center to feature i
-      for(unsigned int j = 0; j < k; ++j)
-      {
-        squared_distance_type distance = distance_(*features[i], centers[j]);
-        //		printf("\t\tdistance %f\n", (float)distance);
-        //		PrintFeat(*features[i] );
-        if(distance < d_min)
-        {
-          d_min = distance;
-          nearest = j;
-          found = true;
-        }
-        //		 printf("\t distance %f %f\n", (double)distance, (double)d_min);
-      }
-      assert(found);
+      squared_distance_type distance;
+      const unsigned int nearest = nearestCenter(*features[i], centers, k, distance);
+
       // Assign feature i to the cluster it is nearest to
       if(membership[i] != nearest)
       {
-        is_stable = false;
+        ++nbChanges;
         membership[i] = nearest;
       }
       // Accumulate the cluster center and its membership count
-      //	  printf("\t nearest %d\n", nearest);
-      //			checkElements(*features[i], "feat");
-      {
-        std::lock_guard<std::mutex> lock{centersLocks[nearest]};
-        new_centers[nearest] += *features[i];
-        //			checkElements(new_centers[nearest], "sum");
-        //	  printf("\t new_centers[nearest] += *features[i];\n");
-        ++new_center_counts[nearest];
-        //	  printf("\taccumulate\n");
-      }
+      const int t = omp_get_thread_num();
+      thread_centers[t][nearest] += *features[i];
+      ++thread_center_counts[t][nearest];
     }//for
 
-    if(is_stable) break;
+    if(nbChanges == 0) break;
+
+    // Reduce the accumulated centers
+    for(std::size_t i = 0; i < k; ++i)
+    {
+      new_centers[i] = thread_centers[0][i];
+      new_center_counts[i] = thread_center_counts[0][i];
+      for(int t = 1; t < nbThreads; ++t)
+      {
+        new_centers[i] += thread_centers[t][i];
+        new_center_counts[i] += thread_center_counts[t][i];
+      }
+    }
+    assert(checkVectorElements(new_centers, "newcenters"));
 
     if(iter > 0)
       max_center_shift = 0;
@@ -522,9 +617,6 @@ SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterOnce(const std::vector
     {
       if(new_center_counts[i] > 0)
       {
-        //		  printf("%d - %d\n", i, new_center_counts[i] );
-        //		  PrintFeat(new_centers[i] );
-        //		checkElements(new_centers[i], "bef");
         new_centers[i] = new_centers[i] / new_center_counts[i];
 
         squared_distance_type shift = distance_(new_centers[i], centers[i]);
@@ -532,15 +624,12 @@ SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterOnce(const std::vector
         max_center_shift = std::max(max_center_shift, shift);
 
         centers[i] = new_centers[i];
-        //					centers[i] = new_centers[i] / new_center_counts[i];
-        //		checkElements(new_centers[i], "aft");
-        //		PrintFeat(centers[i] );
       }
       else
       {
         // Choose a new center randomly from the input features
         // @todo use a better strategy like taking splitting the largest cluster
-        unsigned int index = rand() % features.size();
+        const std::size_t index = std::uniform_int_distribution<std::size_t>(0, features.size() - 1)(randomNumberGenerator);
         centers[i] = *features[index];
         ALICEVISION_LOG_DEBUG("Choosing a new center: " << index);
       }
@@ -561,5 +650,70 @@ SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterOnce(const std::vector
   return sse;
 }
 
+template < class Feature, class Distance, class FeatureAllocator >
+typename SimpleKmeans<Feature, Distance, FeatureAllocator>::squared_distance_type
+SimpleKmeans<Feature, Distance, FeatureAllocator>::clusterOnceMiniBatch(const std::vector<Feature*>& features, std::size_t k,
+                                                                        std::vector<Feature, FeatureAllocator>& centers,
+                                                                        std::vector<unsigned int>& membership,
+                                                                        std::mt19937& randomNumberGenerator) const
+{
+  typedef typename Distance::value_type feature_value_type;
+
+  const std::size_t batchSize = mini_batch_size_;
+  std::vector<std::size_t> center_counts(k, 0);
+  std::vector<std::size_t> batch(batchSize);
+  std::vector<unsigned int> batch_membership(batchSize);
+  std::vector<Feature, FeatureAllocator> previous_centers(k);
+
+  const bool enableMultithreading = batchSize * k > 1000000;
+  std::uniform_int_distribution<std::size_t> featureDistribution(0, features.size() - 1);
+
+  if(verbose_ > 0) ALICEVISION_LOG_DEBUG("Mini-batch iterations");
+  for(std::size_t iter = 0; iter < max_iterations_; ++iter)
+  {
+    // Draw the batch and assign it to the current centers
+    for(std::size_t b = 0; b < batchSize; ++b)
+      batch[b] = featureDistribution(randomNumberGenerator);
+
+    #pragma omp parallel for if(enableMultithreading)
+    for(ptrdiff_t b = 0; b < static_cast<ptrdiff_t>(batchSize); ++b)
+    {
+      squared_distance_type distance;
+      batch_membership[b] = nearestCenter(*features[batch[b]], centers, k, distance);
+    }
+
+    // Move each center towards its features, the learning rate decreases with the number of features seen
+    std::copy(centers.begin(), centers.begin() + k, previous_centers.begin());
+    for(std::size_t b = 0; b < batchSize; ++b)
+    {
+      const unsigned int c = batch_membership[b];
+      const Feature& feature = *features[batch[b]];
+      Feature& center = centers[c];
+      const double eta = 1.0 / ++center_counts[c];
+      for(std::size_t d = 0; d < center.size(); ++d)
+        center[d] += static_cast<feature_value_type>(eta * (feature[d] - center[d]));
+    }
+
+    squared_distance_type max_center_shift = 0;
+    for(std::size_t i = 0; i < k; ++i)
+      max_center_shift = std::max(max_center_shift, distance_(centers[i], previous_centers[i]));
+    if(max_center_shift <= 10e-10) break;
+  }
+
+  // Final assignment of all the features and sum squared error
+  const bool enableMultithreadingAll = features.size() * k > 1000000;
+  squared_distance_type sse = squared_distance_type(0);
+  assert(features.size() > 0);
+
+  #pragma omp parallel for reduction(+:sse) if(enableMultithreadingAll)
+  for(ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(features.size()); ++i)
+  {
+    squared_distance_type distance;
+    membership[i] = nearestCenter(*features[i], centers, k, distance);
+    sse += distance;
+  }
+  return sse;
+}
+
 }
 }
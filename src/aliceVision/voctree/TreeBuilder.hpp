@@ -8,7 +8,11 @@
 
 #include "MutableVocabularyTree.hpp"
 #include "SimpleKmeans.hpp"
+
+#include <aliceVision/alicevision_omp.hpp>
+
 #include <deque>
+#include <random>
 //#include <cstdio> //DEBUG
 
 namespace aliceVision {
@@ -79,12 +83,29 @@ public:
     return verbose_;
   }
 
+  /**
+   * @brief Cluster the nodes of a level in parallel once there are enough of them to use all the threads.
+   *        The nodes of the first levels are clustered one after the other with a parallel assignment step.
+   * @note Each node uses its own random number generator, seeded from the k-means seed and the node position:
+   *       the tree does not depend on the order in which the nodes are clustered.
+   */
+  void setParallelSubtrees(bool parallelSubtrees)
+  {
+    parallelSubtrees_ = parallelSubtrees;
+  }
+
+  bool getParallelSubtrees() const
+  {
+    return parallelSubtrees_;
+  }
+
 protected:
   Tree tree_;
   Kmeans kmeans_;
   Feature zero_;
 private:
   unsigned char verbose_;
+  bool parallelSubtrees_ = false;
 };
 
 template<class Feature, template<typename, typename> class DistanceT, class FeatureAllocator>
@@ -118,21 +139,44 @@ void TreeBuilder<Feature, DistanceT, FeatureAllocator>::build(const FeatureVecto
       feature_ptrs.push_back(const_cast<Feature*> (&f));
     }
   }
-  FeatureVector centers; // always size k
   for(uint32_t level = 0; level < levels; ++level)
   {
     if(verbose_) printf("# Level %u\n", level);
-    std::vector<unsigned int> membership;
 
-    for(std::size_t i = 0, ie = subset_queue.size(); i < ie; ++i)
+    const std::size_t nbSubsets = subset_queue.size();
+    std::vector<FeatureVector> centersPerSubset(nbSubsets);
+    std::vector< std::vector<unsigned int> > membershipPerSubset(nbSubsets);
+
+    // Cluster the subsets, the nodes of a level are independent
+    const bool parallelLevel = parallelSubtrees_ && nbSubsets >= static_cast<std::size_t>(omp_get_max_threads());
+
+    #pragma omp parallel for schedule(dynamic) if(parallelLevel)
+    for(ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(nbSubsets); ++i)
     {
-      std::vector<Feature*> &subset = subset_queue.front();
-      if(verbose_ > 1) printf("#\tClustering subset %lu/%lu of size %lu\n", i + 1, ie, subset.size());
+      const std::vector<Feature*> &subset = subset_queue[i];
+      if(verbose_ > 1) printf("#\tClustering subset %lu/%lu of size %lu\n", i + 1, nbSubsets, subset.size());
 
       // If the subset already has k or fewer elements, just use those as the centers.
       if(subset.size() <= k)
       {
         if(verbose_ > 2) printf("#\tno need to cluster %lu elements\n", subset.size());
+        continue;
+      }
+
+      // Cluster the current subset into k centers.
+      if(verbose_ > 2) printf("#\tclustering the current subset of %lu elements into %d centers\n", subset.size(), k);
+      std::seed_seq nodeSeed{static_cast<uint32_t>(kmeans_.getSeed()), level, static_cast<uint32_t>(i)};
+      std::mt19937 randomNumberGenerator(nodeSeed);
+      kmeans_.clusterPointers(subset, k, centersPerSubset[i], membershipPerSubset[i], randomNumberGenerator);
+    }
+
+    // Add the centers and update the queue in the subsets order
+    for(std::size_t i = 0; i < nbSubsets; ++i)
+    {
+      std::vector<Feature*> &subset = subset_queue.front();
+
+      if(subset.size() <= k)
+      {
         for(std::size_t j = 0; j < subset.size(); ++j)
         {
           tree_.centers().push_back(*subset[j]);
@@ -148,9 +192,8 @@ void TreeBuilder<Feature, DistanceT, FeatureAllocator>::build(const FeatureVecto
       }
       else
       {
-        // Cluster the current subset into k centers.
-        if(verbose_ > 2) printf("#\tclustering the current subset of %lu elements into %d centers\n", subset.size(), k);
-        kmeans_.clusterPointers(subset, k, centers, membership);
+        const FeatureVector& centers = centersPerSubset[i];
+        const std::vector<unsigned int>& membership = membershipPerSubset[i];
         // Add the centers and mark them as valid.
         tree_.centers().insert(tree_.centers().end(), centers.begin(), centers.end());
         tree_.validCenters().insert(tree_.validCenters().end(), k, 1);
@@ -167,6 +210,9 @@ void TreeBuilder<Feature, DistanceT, FeatureAllocator>::build(const FeatureVecto
         subset_queue.pop_front();
         subset_queue.insert(subset_queue.end(), new_subsets.begin(), new_subsets.end());
       }
+      // Release the memory of the clustered node
+      FeatureVector().swap(centersPerSubset[i]);
+      std::vector<unsigned int>().swap(membershipPerSubset[i]);
     }
     if(verbose_) printf("# centers so far = %lu\n", tree_.centers().size());
   }
@@ -49,8 +49,9 @@ float sparseDistance(const SparseHistogram& v1, const SparseHistogram& v2, const
       }
       else
       {
-        const auto val = std::minmax(i1->second.size(), i2->second.size());
-        distance += static_cast<float>(val.second - val.first);
+        const std::size_t size1 = i1->second.size();
+        const std::size_t size2 = i2->second.size();
+        distance += static_cast<float>(std::max(size1, size2) - std::min(size1, size2));
         ++i1;
         ++i2;
       }
@@ -70,11 +70,12 @@ public:
   virtual void load(const std::string& file) = 0;
 
   /**
-   * @brief Create a SparseHistogram from a blind vector of descriptors.
-   * @param blindDescriptors
-   * @return
+   * @brief Create a SparseHistogram from a blind array of descriptors.
+   * @param[in] blindDescriptors pointer to the first descriptor, of the vocabulary tree feature type
+   * @param[in] nbDescriptors the number of descriptors
+   * @return the sparse histogram of the visual words
    */
-  virtual SparseHistogram quantizeToSparse(const void* blindDescriptors) const = 0;
+  virtual SparseHistogram quantizeToSparse(const void* blindDescriptors, std::size_t nbDescriptors) const = 0;
 
   /// Get the depth (number of levels) of the tree.
   virtual uint32_t levels() const = 0;
@@ -123,14 +124,27 @@ public:
   template<class DescriptorT>
   std::vector<Word> quantize(const std::vector<DescriptorT>& features) const;
 
+  /**
+   * @brief Quantizes contiguous features into visual words, the features are distributed across threads.
+   * @param[in] features the features to quantize
+   * @param[in] nbFeatures the number of features
+   * @param[out] words the nbFeatures visual words
+   */
+  template<class DescriptorT>
+  void quantize(const DescriptorT* features, std::size_t nbFeatures, Word* words) const;
+
   /// Quantizes a set of features into sparse histogram of visual words.
   template<class DescriptorT>
   SparseHistogram quantizeToSparse(const std::vector<DescriptorT>& features) const;
 
-  SparseHistogram quantizeToSparse(const void* blindDescriptors) const override
+  SparseHistogram quantizeToSparse(const void* blindDescriptors, std::size_t nbDescriptors) const override
   {
-    const std::vector<Feature>* descriptors = static_cast<const std::vector<Feature>*>(blindDescriptors);
-    return quantizeToSparse(*descriptors);
+    std::vector<Word> doc(nbDescriptors, 0);
+    quantize(static_cast<const Feature*>(blindDescriptors), nbDescriptors, doc.data());
+
+    SparseHistogram histo;
+    computeSparseHistogram(doc, histo);
+    return histo;
   }
 
   /// Get the depth (number of levels) of the tree.
@@ -173,6 +187,16 @@ protected:
   }
 
   void setNodeCounts();
+
+  /**
+   * @brief Descend the tree computing the distances to all the children of a node with one batched SIMD call.
+   * @param[in] query the query converted by the batched distance
+   * @param[in,out] distances a buffer of splits() distances
+   * @return the visual word
+   */
+  template<class DescriptorT>
+  Word quantizeBatched(const typename BatchedDistance<DescriptorT, Feature, Distance>::query_type& query,
+                       typename BatchedDistance<DescriptorT, Feature, Distance>::result_type* distances) const;
 };
 
 template<class Feature, template<typename, typename> class Distance, class FeatureAllocator>
@@ -194,9 +218,21 @@ Word VocabularyTree<Feature, Distance, FeatureAllocator>::quantize(const Descrip
 {
   typedef typename Distance<Feature, DescriptorT>::result_type distance_type;
 
-  //	printf("asserting\n");
   assert(initialized());
-  //	printf("initialized\n");
+
+  if constexpr (BatchedDistance<DescriptorT, Feature, Distance>::available)
+  {
+    typedef BatchedDistance<DescriptorT, Feature, Distance> BatchedDistanceT;
+
+    // avoid a heap allocation for the usual branching factors
+    typename BatchedDistanceT::result_type stackDistances[16];
+    std::vector<typename BatchedDistanceT::result_type> heapDistances;
+    if(splits() > 16)
+      heapDistances.resize(splits());
+
+    return quantizeBatched<DescriptorT>(BatchedDistanceT::toQuery(feature), heapDistances.empty() ? stackDistances : heapDistances.data());
+  }
+
   int32_t index = -1; // virtual "root" index, which has no associated center.
   for(unsigned level = 0; level < levels_; ++level)
   {
@@ -222,25 +258,77 @@ Word VocabularyTree<Feature, Distance, FeatureAllocator>::quantize(const Descrip
   return index - word_start_;
 }
 
+template<class Feature, template<typename, typename> class Distance, class FeatureAllocator>
+template<class DescriptorT>
+Word VocabularyTree<Feature, Distance, FeatureAllocator>::quantizeBatched(const typename BatchedDistance<DescriptorT, Feature, Distance>::query_type& query,
+                                                                         typename BatchedDistance<DescriptorT, Feature, Distance>::result_type* distances) const
+{
+  typedef BatchedDistance<DescriptorT, Feature, Distance> BatchedDistanceT;
+
+  int32_t index = -1; // virtual "root" index, which has no associated center.
+  for(unsigned level = 0; level < levels_; ++level)
+  {
+    // the children of a node are contiguous in centers_, the valid ones first
+    const int32_t first_child = (index + 1) * splits();
+    uint32_t nbChildren = 0;
+    while(nbChildren < splits() && valid_centers_[first_child + nbChildren])
+      ++nbChildren;
+
+    BatchedDistanceT::distances(query, &centers_[first_child], nbChildren, distances);
+
+    // keep the first closest child, like the scalar descent
+    uint32_t best = 0;
+    for(uint32_t child = 1; child < nbChildren; ++child)
+    {
+      if(distances[child] < distances[best])
+        best = child;
+    }
+    index = first_child + best;
+  }
+
+  return index - word_start_;
+}
+
 template<class Feature, template<typename, typename> class Distance, class FeatureAllocator>
 template<class DescriptorT>
 std::vector<Word> VocabularyTree<Feature, Distance, FeatureAllocator>::quantize(const std::vector<DescriptorT>& features) const
 {
-  // ALICEVISION_LOG_DEBUG("VocabularyTree quantize: " << features.size());
   std::vector<Word> imgVisualWords(features.size(), 0);
 
   // quantize the features
-  #pragma omp parallel for
-  for(ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(features.size()); ++j)
-  {
-    // store the visual word associated to the feature in the temporary list
-    imgVisualWords[j] = quantize<DescriptorT>(features[j]);
-  }
+  quantize(features.data(), features.size(), imgVisualWords.data());
 
-  // add the vector to the documents
   return imgVisualWords;
 }
 
+template<class Feature, template<typename, typename> class Distance, class FeatureAllocator>
+template<class DescriptorT>
+void VocabularyTree<Feature, Distance, FeatureAllocator>::quantize(const DescriptorT* features, std::size_t nbFeatures, Word* words) const
+{
+  assert(initialized());
+
+  if constexpr (BatchedDistance<DescriptorT, Feature, Distance>::available)
+  {
+    typedef BatchedDistance<DescriptorT, Feature, Distance> BatchedDistanceT;
+
+    #pragma omp parallel
+    {
+      // one distances buffer per thread
+      std::vector<typename BatchedDistanceT::result_type> distances(splits());
+
+      #pragma omp for schedule(static)
+      for(ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nbFeatures); ++j)
+        words[j] = quantizeBatched<DescriptorT>(BatchedDistanceT::toQuery(features[j]), distances.data());
+    }
+  }
+  else
+  {
+    #pragma omp parallel for
+    for(ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nbFeatures); ++j)
+      words[j] = quantize<DescriptorT>(features[j]);
+  }
+}
+
 template<class Feature, template<typename, typename> class Distance, class FeatureAllocator>
 template<class DescriptorT>
 SparseHistogram VocabularyTree<Feature, Distance, FeatureAllocator>::quantizeToSparse(const std::vector<DescriptorT>& features) const
@@ -52,6 +52,23 @@ std::size_t readDescFromFiles(const sfmData::SfMData& sfmData,
                          std::vector<DescriptorT>& descriptors,
                          std::vector<std::size_t>& numFeatures);
 
+/**
+ * @brief Read a uniform random sample of the descriptors of a sfmData without loading all of them in memory.
+ * The descriptor files are read one after the other and the sample is maintained with a reservoir sampling.
+ * @param[in] sfmData The input sfmData
+ * @param[in] featuresFolders The folder(s) containing the descriptor files (optional)
+ * @param[in] maxDescriptors The maximum number of descriptors to keep
+ * @param[in] seed The seed of the random sampling
+ * @param[out] descriptors The sampled descriptors
+ * @return the total number of descriptors read
+ */
+template<class DescriptorT, class FileDescriptorT>
+std::size_t sampleDescFromFiles(const sfmData::SfMData& sfmData,
+                                const std::vector<std::string>& featuresFolders,
+                                std::size_t maxDescriptors,
+                                unsigned int seed,
+                                std::vector<DescriptorT>& descriptors);
+
 } // namespace voctree
 } // namespace aliceVision
 
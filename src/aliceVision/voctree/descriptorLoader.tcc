@@ -13,6 +13,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <random>
 
 namespace aliceVision {
 namespace voctree {
@@ -89,5 +90,53 @@ std::size_t readDescFromFiles(const sfmData::SfMData& sfmData,
   return numDescriptors;
 }
 
+template<class DescriptorT, class FileDescriptorT>
+std::size_t sampleDescFromFiles(const sfmData::SfMData& sfmData,
+                                const std::vector<std::string>& featuresFolders,
+                                std::size_t maxDescriptors,
+                                unsigned int seed,
+                                std::vector<DescriptorT>& descriptors)
+{
+  std::map<IndexT, std::string> descriptorsFiles;
+  getListOfDescriptorFiles(sfmData, featuresFolders, descriptorsFiles);
+
+  descriptors.clear();
+  descriptors.reserve(maxDescriptors);
+
+  std::mt19937 generator(seed);
+  std::size_t numDescriptors = 0;
+  std::vector<DescriptorT> fileDescriptors;
+
+  ALICEVISION_LOG_DEBUG("Sampling at most " << maxDescriptors << " descriptors...");
+  auto display = system::createConsoleProgressDisplay(descriptorsFiles.size(), std::cout);
+
+  for(const auto &currentFile : descriptorsFiles)
+  {
+    // only the descriptors of the current file and the sample are in memory
+    feature::loadDescsFromBinFile<DescriptorT, FileDescriptorT>(currentFile.second, fileDescriptors, false);
+
+    for(const DescriptorT& descriptor : fileDescriptors)
+    {
+      if(descriptors.size() < maxDescriptors)
+      {
+        descriptors.push_back(descriptor);
+      }
+      else
+      {
+        // the n-th descriptor replaces a sampled one with a probability of maxDescriptors / n
+        std::uniform_int_distribution<std::size_t> distribution(0, numDescriptors);
+        const std::size_t index = distribution(generator);
+        if(index < maxDescriptors)
+          descriptors[index] = descriptor;
+      }
+      ++numDescriptors;
+    }
+    ++display;
+  }
+
+  ALICEVISION_LOG_DEBUG("Sampled " << descriptors.size() << " descriptors out of " << numDescriptors);
+  return numDescriptors;
+}
+
 } // namespace voctree
 } // namespace aliceVision
@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <aliceVision/feature/Descriptor.hpp>
+#include <aliceVision/feature/metricSimd.hpp>
+
 #include <stdint.h>
 #include <Eigen/Core>
 
@@ -56,5 +59,69 @@ struct L2< Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>, Eigen::
   }
 };
 
+/**
+ * \brief Batched distances between one query and contiguous centers with the SIMD kernels of feature/metricSimd.
+ *
+ * Only available for the L2 distance on feature::Descriptor types. The query is converted once into \c query_type
+ * and then compared to all the children of a node in a single call.
+ */
+template<class DescriptorA, class DescriptorB, template<typename, typename> class Distance>
+struct BatchedDistance
+{
+  static constexpr bool available = false;
+};
+
+/// Specialization for unsigned char descriptors and centers (exact integer distances).
+template<std::size_t N>
+struct BatchedDistance<feature::Descriptor<unsigned char, N>, feature::Descriptor<unsigned char, N>, L2>
+{
+  typedef feature::Descriptor<unsigned char, N> feature_type;
+  typedef feature_type query_type;
+  typedef int result_type;
+  static constexpr bool available = true;
+  static_assert(sizeof(feature_type) == N * sizeof(unsigned char), "Descriptor data should be contiguous");
+
+  static query_type toQuery(const feature_type& a) { return a; }
+
+  static void distances(const query_type& query, const feature_type* centers, std::size_t nbCenters, result_type* out)
+  {
+    feature::squaredL2UcharOneToMany(query.getData(), centers->getData(), nbCenters, N, out);
+  }
+};
+
+/// Specialization for float descriptors and centers.
+template<std::size_t N>
+struct BatchedDistance<feature::Descriptor<float, N>, feature::Descriptor<float, N>, L2>
+{
+  typedef feature::Descriptor<float, N> feature_type;
+  typedef feature_type query_type;
+  typedef float result_type;
+  static constexpr bool available = true;
+  static_assert(sizeof(feature_type) == N * sizeof(float), "Descriptor data should be contiguous");
+
+  static query_type toQuery(const feature_type& a) { return a; }
+
+  static void distances(const query_type& query, const feature_type* centers, std::size_t nbCenters, result_type* out)
+  {
+    feature::squaredL2FloatOneToMany(query.getData(), centers->getData(), nbCenters, N, out);
+  }
+};
+
+/// Specialization for unsigned char descriptors and float centers (the query is converted to float once).
+template<std::size_t N>
+struct BatchedDistance<feature::Descriptor<unsigned char, N>, feature::Descriptor<float, N>, L2>
+  : public BatchedDistance<feature::Descriptor<float, N>, feature::Descriptor<float, N>, L2>
+{
+  typedef feature::Descriptor<float, N> query_type;
+
+  static query_type toQuery(const feature::Descriptor<unsigned char, N>& a)
+  {
+    query_type query;
+    for(std::size_t i = 0; i < N; ++i)
+      query[i] = static_cast<float>(a[i]);
+    return query;
+  }
+};
+
 }
 }
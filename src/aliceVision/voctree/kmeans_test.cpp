@@ -48,8 +48,9 @@ BOOST_AUTO_TEST_CASE(kmeanInitializer)
   }
 
   voctree::InitKmeanspp initializer;
+  std::mt19937 randomNumberGenerator;
 
-  initializer(featPtr, K, centers, voctree::L2<FeatureFloat, FeatureFloat>());
+  initializer(featPtr, K, centers, voctree::L2<FeatureFloat, FeatureFloat>(), randomNumberGenerator);
 
   // it's difficult to check the result as it is random, just check there are no weird things
   BOOST_CHECK(voctree::checkVectorElements(centers, "initializer1"));
@@ -69,7 +70,7 @@ BOOST_AUTO_TEST_CASE(kmeanInitializer)
     }
   }
 
-  initializer(featPtr, K, centers, voctree::L2<FeatureFloat,FeatureFloat>());
+  initializer(featPtr, K, centers, voctree::L2<FeatureFloat,FeatureFloat>(), randomNumberGenerator);
 
   // it's difficult to check the result as it is random, just check there are no weird things
   BOOST_CHECK(voctree::checkVectorElements(centers, "initializer2"));
@@ -90,6 +91,7 @@ BOOST_AUTO_TEST_CASE(kmeanInitializerVarying)
 
   // generate random values for K and DIMENSION
   std::default_random_engine generator;
+  std::mt19937 randomNumberGenerator;
   std::uniform_int_distribution<std::size_t> dimGen(3, 128);
   std::uniform_int_distribution<std::size_t> kGen(6, 300);
 
@@ -124,7 +126,7 @@ BOOST_AUTO_TEST_CASE(kmeanInitializerVarying)
       }
     }
 
-    initializer(featPtr, K, centers, voctree::L2<FeatureFloat,FeatureFloat>());
+    initializer(featPtr, K, centers, voctree::L2<FeatureFloat,FeatureFloat>(), randomNumberGenerator);
 
     // it's difficult to check the result as it is random, just check there are no weird things
     BOOST_CHECK(voctree::checkVectorElements(centers, "initializer"));
@@ -299,3 +301,55 @@ BOOST_AUTO_TEST_CASE(kmeanVarying)
     }
   }
 }
+
+BOOST_AUTO_TEST_CASE(kmeanMiniBatch)
+{
+  using namespace aliceVision;
+
+  ALICEVISION_LOG_DEBUG("Testing mini-batch kmeans...");
+
+  makeRandomOperationsReproducible();
+
+  const std::size_t DIMENSION = 8;
+  const std::size_t FEATURENUMBER = 500;
+  const std::size_t K = 10;
+  const std::size_t STEP = 5 * K;
+
+  typedef Eigen::Matrix<float, 1, DIMENSION> FeatureFloat;
+  typedef std::vector<FeatureFloat, Eigen::aligned_allocator<FeatureFloat> > FeatureFloatVector;
+
+  // generate k clusters well far away
+  FeatureFloatVector features;
+  FeatureFloatVector centers;
+  std::vector<unsigned int> membership;
+  features.reserve(FEATURENUMBER * K);
+  for(std::size_t i = 0; i < K; ++i)
+  {
+    for(std::size_t j = 0; j < FEATURENUMBER; ++j)
+    {
+      features.push_back((FeatureFloat::Random(1, DIMENSION) + Eigen::MatrixXf::Constant(1, DIMENSION, STEP * i) - Eigen::MatrixXf::Constant(1, DIMENSION, STEP * (K - 1) / 2)) / ((STEP * (K - 1) / 2) * sqrt(DIMENSION)));
+    }
+  }
+
+  voctree::SimpleKmeans<FeatureFloat> kmeans(FeatureFloat::Zero());
+  kmeans.setVerbose(0);
+  kmeans.setRestarts(5);
+  kmeans.setMiniBatchSize(200);
+
+  const voctree::SimpleKmeans<FeatureFloat>::squared_distance_type sse = kmeans.cluster(features, K, centers, membership);
+  BOOST_CHECK(voctree::checkVectorElements(centers, "minibatch"));
+  BOOST_CHECK(sse >= 0.0);
+  BOOST_REQUIRE_EQUAL(membership.size(), features.size());
+
+  // all the features of a generated cluster should be in the same cluster
+  std::vector<std::size_t> h(K, 0);
+  for(std::size_t i = 0; i < K; ++i)
+  {
+    const unsigned int cluster = membership[i * FEATURENUMBER];
+    for(std::size_t j = 0; j < FEATURENUMBER; ++j)
+      BOOST_CHECK_EQUAL(membership[i * FEATURENUMBER + j], cluster);
+    ++h[cluster];
+  }
+  for(std::size_t i = 0; i < h.size(); ++i)
+    BOOST_CHECK_EQUAL(h[i], 1);
+}
@@ -9,8 +9,11 @@
 
 #include <Eigen/Core>
 
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <random>
 #include <vector>
 
 #define BOOST_TEST_MODULE voctreeBuilder
@@ -85,4 +88,90 @@ BOOST_AUTO_TEST_CASE(voctreeBuilder)
     BOOST_CHECK_SMALL(distance(centerOrig[i],centerLoad[i]), kepsf);
   }
 //  voctree::printFeatVector( features ); 
+
+  // build the tree clustering the nodes of a level in parallel
+  voctree::TreeBuilder<FeatureFloat> parallelBuilder(FeatureFloat::Zero());
+  parallelBuilder.setVerbose(0);
+  parallelBuilder.setParallelSubtrees(true);
+  parallelBuilder.kmeans().setRestarts(10);
+  parallelBuilder.build(features, K, LEVELS);
+
+  BOOST_CHECK_EQUAL(parallelBuilder.tree().centers().size(), centerOrig.size());
+  for(uint8_t validCenter : parallelBuilder.tree().validCenters())
+    BOOST_CHECK(validCenter != 0);
+  BOOST_CHECK(voctree::checkVectorElements(parallelBuilder.tree().centers(), "parallel"));
+}
+
+BOOST_AUTO_TEST_CASE(voctreeBuilderReproducible)
+{
+  using namespace aliceVision;
+
+  const std::size_t DIMENSION = 3;
+  const std::size_t FEATURENUMBER = 50;
+  const std::size_t K = 4;
+  const std::size_t LEVELS = 3;
+  const std::size_t NBCLUSTERS = std::pow(K, LEVELS);
+
+  typedef Eigen::Matrix<float, 1, DIMENSION> FeatureFloat;
+  typedef std::vector<FeatureFloat, Eigen::aligned_allocator<FeatureFloat> > FeatureFloatVector;
+
+  // random features around random cluster centers
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+  const auto randomFeature = [&]() { return FeatureFloat(distribution(generator), distribution(generator), distribution(generator)); };
+
+  FeatureFloatVector features;
+  features.reserve(FEATURENUMBER * NBCLUSTERS);
+  for(std::size_t i = 0; i < NBCLUSTERS; ++i)
+  {
+    const FeatureFloat center = randomFeature();
+    for(std::size_t j = 0; j < FEATURENUMBER; ++j)
+      features.push_back(center + 0.1f * randomFeature());
+  }
+
+  // the global random generator state must not change the tree
+  const auto buildTree = [&](std::size_t seed, bool parallelSubtrees, std::size_t miniBatchSize, unsigned int globalSeed)
+  {
+    std::srand(globalSeed);
+
+    voctree::TreeBuilder<FeatureFloat> builder(FeatureFloat::Zero());
+    builder.setVerbose(0);
+    builder.setParallelSubtrees(parallelSubtrees);
+    builder.kmeans().setRestarts(3);
+    builder.kmeans().setMiniBatchSize(miniBatchSize);
+    builder.kmeans().setSeed(seed);
+    builder.build(features, K, LEVELS);
+    return builder.tree().centers();
+  };
+
+  const auto isSameTree = [](const FeatureFloatVector& centersA, const FeatureFloatVector& centersB)
+  {
+    if(centersA.size() != centersB.size())
+      return false;
+    for(std::size_t i = 0; i < centersA.size(); ++i)
+    {
+      if(centersA[i] != centersB[i])
+        return false;
+    }
+    return true;
+  };
+
+  // standard and mini-batch k-means (the root node is larger than the batch)
+  for(const std::size_t miniBatchSize : {0, 500})
+  {
+    for(const bool parallelSubtrees : {false, true})
+    {
+      BOOST_TEST_CONTEXT("miniBatchSize " << miniBatchSize << ", parallelSubtrees " << parallelSubtrees)
+      {
+        const FeatureFloatVector centers = buildTree(42, parallelSubtrees, miniBatchSize, 1);
+        BOOST_CHECK_EQUAL(centers.size(), (NBCLUSTERS * K - 1) / (K - 1) - 1);
+
+        // the same seed gives the same tree
+        BOOST_CHECK(isSameTree(centers, buildTree(42, parallelSubtrees, miniBatchSize, 2)));
+
+        // another seed gives another tree
+        BOOST_CHECK(!isSameTree(centers, buildTree(43, parallelSubtrees, miniBatchSize, 1)));
+      }
+    }
+  }
 }
@@ -5,9 +5,12 @@
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include <aliceVision/voctree/Database.hpp>
+#include <aliceVision/voctree/MutableVocabularyTree.hpp>
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <random>
 #include <vector>
 
 #define BOOST_TEST_MODULE vocabularyTree
@@ -17,6 +20,83 @@
 
 using namespace aliceVision::voctree;
 
+namespace {
+
+/**
+ * @brief Random tree with a few missing children, to check the quantization against the reference scalar descent.
+ */
+template<class Feature>
+void generateRandomTree(MutableVocabularyTree<Feature>& tree, uint32_t levels, uint32_t splits, std::mt19937& generator)
+{
+  std::uniform_real_distribution<float> valueDistribution(0.f, 255.f);
+  std::uniform_int_distribution<uint32_t> childrenDistribution(1, splits);
+
+  tree.setSize(levels, splits);
+  tree.centers().resize(tree.nodes());
+  tree.validCenters().assign(tree.nodes(), 0);
+
+  for(uint32_t firstChild = 0; firstChild < tree.nodes(); firstChild += splits)
+  {
+    const uint32_t nbChildren = childrenDistribution(generator);
+    for(uint32_t child = firstChild; child < firstChild + nbChildren; ++child)
+    {
+      for(std::size_t i = 0; i < Feature::static_size; ++i)
+        tree.centers()[child][i] = valueDistribution(generator);
+      tree.validCenters()[child] = 1;
+    }
+  }
+}
+
+template<class DescriptorT, class Feature>
+Word referenceQuantize(const MutableVocabularyTree<Feature>& tree, const DescriptorT& feature)
+{
+  int32_t index = -1;
+  for(uint32_t level = 0; level < tree.levels(); ++level)
+  {
+    const int32_t firstChild = (index + 1) * tree.splits();
+    int32_t bestChild = firstChild;
+    double bestDistance = std::numeric_limits<double>::max();
+    for(int32_t child = firstChild; child < firstChild + (int32_t)tree.splits() && tree.validCenters()[child]; ++child)
+    {
+      const double distance = L2<DescriptorT, Feature>()(feature, tree.centers()[child]);
+      if(distance < bestDistance)
+      {
+        bestChild = child;
+        bestDistance = distance;
+      }
+    }
+    index = bestChild;
+  }
+  return index - (tree.nodes() - tree.words());
+}
+
+template<class DescriptorT, class Feature>
+void checkQuantize(uint32_t levels, uint32_t splits)
+{
+  std::mt19937 generator(0);
+  MutableVocabularyTree<Feature> tree;
+  generateRandomTree(tree, levels, splits, generator);
+
+  std::uniform_int_distribution<int> valueDistribution(0, 255);
+  std::vector<DescriptorT> features(500);
+  for(DescriptorT& feature : features)
+  {
+    for(std::size_t i = 0; i < DescriptorT::static_size; ++i)
+      feature[i] = valueDistribution(generator);
+  }
+
+  const std::vector<Word> words = tree.quantize(features);
+  BOOST_REQUIRE_EQUAL(words.size(), features.size());
+
+  for(std::size_t j = 0; j < features.size(); ++j)
+  {
+    BOOST_CHECK_EQUAL(words[j], referenceQuantize(tree, features[j]));
+    BOOST_CHECK_EQUAL(tree.quantize(features[j]), words[j]);
+  }
+}
+
+} // namespace
+
 BOOST_AUTO_TEST_CASE(database)
 {
   const int cardDocuments = 10;
@@ -57,3 +137,90 @@ BOOST_AUTO_TEST_CASE(database)
     BOOST_CHECK_SMALL(static_cast<double>(match[0].score), 0.001);
   }
 }
+
+BOOST_AUTO_TEST_CASE(databaseBatchQueries)
+{
+  const int cardDocuments = 50;
+  const int cardWords = 200;
+  const int cardFeatures = 120;
+
+  // Create random documents sharing words
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<Word> wordDistribution(0, cardWords - 1);
+
+  Database db(cardWords);
+  std::vector<SparseHistogram> histograms(cardDocuments);
+  for(int i = 0; i < cardDocuments; ++i)
+  {
+    std::vector<Word> document(cardFeatures);
+    for(Word& word : document)
+      word = wordDistribution(generator);
+
+    computeSparseHistogram(document, histograms[i]);
+    // sparse document ids
+    db.insert(3 * i + 1, histograms[i]);
+  }
+  db.computeTfIdfWeights();
+
+  std::vector<const SparseHistogram*> queries;
+  for(const SparseHistogram& histogram : histograms)
+    queries.push_back(&histogram);
+
+  for(const std::string distanceMethod : {"classic", "commonPoints", "strongCommonPoints", "inversedWeightedCommonPoints"})
+  {
+    std::vector<DocMatches> batchMatches;
+    QueriesStatistics statistics;
+    db.findBatch(queries, 0, batchMatches, distanceMethod, &statistics);
+
+    BOOST_CHECK_EQUAL(statistics.nbQueries, queries.size());
+    BOOST_REQUIRE_EQUAL(batchMatches.size(), queries.size());
+
+    for(std::size_t q = 0; q < queries.size(); ++q)
+    {
+      // the batch queries should give the same scores as the single queries
+      DocMatches matches;
+      db.find(*queries[q], db.size(), matches, distanceMethod);
+
+      BOOST_REQUIRE_EQUAL(batchMatches[q].size(), matches.size());
+
+      std::map<DocId, float> scorePerDoc;
+      for(const DocMatch& match : matches)
+        scorePerDoc[match.id] = match.score;
+
+      for(std::size_t m = 0; m < batchMatches[q].size(); ++m)
+      {
+        const DocMatch& match = batchMatches[q][m];
+        BOOST_CHECK_EQUAL(match.score, scorePerDoc.at(match.id));
+        BOOST_CHECK_EQUAL(match.score, matches[m].score);
+      }
+    }
+
+    // top N matches
+    std::vector<DocMatches> topMatches;
+    db.findBatch(queries, 5, topMatches, distanceMethod);
+    for(std::size_t q = 0; q < queries.size(); ++q)
+    {
+      BOOST_REQUIRE_EQUAL(topMatches[q].size(), 5);
+      for(std::size_t m = 0; m < 5; ++m)
+        BOOST_CHECK(topMatches[q][m] == batchMatches[q][m]);
+    }
+  }
+
+  std::vector<DocMatches> unknownMatches;
+  BOOST_CHECK_THROW(db.findBatch(queries, 1, unknownMatches, "unknown"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(quantizeBatchedDistance)
+{
+  typedef aliceVision::feature::Descriptor<unsigned char, 128> DescriptorUChar;
+  typedef aliceVision::feature::Descriptor<float, 128> DescriptorFloat;
+
+  static_assert(BatchedDistance<DescriptorUChar, DescriptorUChar, L2>::available, "");
+  static_assert(BatchedDistance<DescriptorUChar, DescriptorFloat, L2>::available, "");
+
+  checkQuantize<DescriptorUChar, DescriptorUChar>(3, 10);
+  checkQuantize<DescriptorFloat, DescriptorFloat>(3, 10);
+  checkQuantize<DescriptorUChar, DescriptorFloat>(3, 10);
+  // branching factor larger than the stack buffer of the single descriptor quantization
+  checkQuantize<DescriptorUChar, DescriptorFloat>(2, 20);
+}
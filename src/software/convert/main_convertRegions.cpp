@@ -0,0 +1,120 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/feature/ImageDescriber.hpp>
+#include <aliceVision/feature/imageDescriberCommon.hpp>
+#include <aliceVision/feature/RegionsFile.hpp>
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/cmdline/cmdline.hpp>
+#include <aliceVision/system/main.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <cstdlib>
+#include <string>
+
+// These constants define the current software version.
+// They must be updated when the command line is changed.
+#define ALICEVISION_SOFTWARE_VERSION_MAJOR 1
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+
+using namespace aliceVision;
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+// convert regions between the .feat/.desc files and the binary regions container
+int aliceVision_main(int argc, char** argv)
+{
+  std::string inputFolder;
+  std::string outputFolder;
+  std::string describerTypesName = feature::EImageDescriberType_enumToString(feature::EImageDescriberType::SIFT);
+  bool toContainer = true;
+
+  po::options_description requiredParams("Required parameters");
+  requiredParams.add_options()
+    ("input,i", po::value<std::string>(&inputFolder)->required(),
+      "Input features folder.")
+    ("output,o", po::value<std::string>(&outputFolder)->required(),
+      "Output features folder.");
+
+  po::options_description optionalParams("Optional parameters");
+  optionalParams.add_options()
+    ("describerTypes,d", po::value<std::string>(&describerTypesName)->default_value(describerTypesName),
+      feature::EImageDescriberType_informations().c_str())
+    ("toContainer", po::value<bool>(&toContainer)->default_value(toContainer),
+      "If true, convert .feat/.desc files into .regions containers, otherwise convert .regions containers into .feat/.desc files.");
+
+  CmdLine cmdline("This program converts regions between .feat/.desc files and the binary .regions container.\n"
+                  "AliceVision convertRegions");
+  cmdline.add(requiredParams);
+  cmdline.add(optionalParams);
+  if(!cmdline.execute(argc, argv))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if(!(fs::exists(inputFolder) && fs::is_directory(inputFolder)))
+  {
+    ALICEVISION_LOG_ERROR(inputFolder << " does not exists or it is not a folder");
+    return EXIT_FAILURE;
+  }
+
+  if(!fs::exists(outputFolder))
+    fs::create_directories(outputFolder);
+
+  const std::vector<feature::EImageDescriberType> describerTypes = feature::EImageDescriberType_stringToEnums(describerTypesName);
+  const std::string inputExtension = toContainer ? ".desc" : feature::REGIONS_FILE_EXTENSION;
+
+  std::size_t count = 0;
+
+  for(const feature::EImageDescriberType describerType : describerTypes)
+  {
+    const std::string describerTypeName = feature::EImageDescriberType_enumToString(describerType);
+    const std::string suffix = "." + describerTypeName + inputExtension;
+    std::unique_ptr<feature::ImageDescriber> imageDescriber = feature::createImageDescriber(describerType);
+
+    for(fs::directory_iterator it(inputFolder); it != fs::directory_iterator(); ++it)
+    {
+      const std::string filename = it->path().filename().string();
+
+      if(filename.size() <= suffix.size() || filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) != 0)
+        continue;
+
+      const std::string basename = filename.substr(0, filename.size() - suffix.size()) + "." + describerTypeName;
+      const std::string inputBasePath = (fs::path(inputFolder) / basename).string();
+      const std::string outputBasePath = (fs::path(outputFolder) / basename).string();
+
+      std::unique_ptr<feature::Regions> regions;
+      imageDescriber->allocate(regions);
+
+      try
+      {
+        if(toContainer)
+        {
+          regions->Load(inputBasePath + ".feat", inputBasePath + ".desc");
+          regions->SaveContainer(outputBasePath + feature::REGIONS_FILE_EXTENSION);
+        }
+        else
+        {
+          regions->LoadContainer(inputBasePath + feature::REGIONS_FILE_EXTENSION);
+          regions->Save(outputBasePath + ".feat", outputBasePath + ".desc");
+        }
+      }
+      catch(const std::exception& e)
+      {
+        ALICEVISION_LOG_ERROR("Cannot convert regions '" << inputBasePath << "': " << e.what());
+        return EXIT_FAILURE;
+      }
+      ++count;
+    }
+  }
+
+  ALICEVISION_LOG_INFO("Converted " << count << " regions files.");
+
+  return EXIT_SUCCESS;
+}
@@ -4,24 +4,28 @@
 // v. 2.0. If a copy of the MPL was not distributed with this file,
 // You can obtain one at https://mozilla.org/MPL/2.0/.
 
+#include <aliceVision/config.hpp>
 #include <aliceVision/system/Logger.hpp>
 #include <aliceVision/cmdline/cmdline.hpp>
 #include <aliceVision/system/main.hpp>
 #include <aliceVision/sfmData/SfMData.hpp>
 #include <aliceVision/sfmDataIO/sfmDataIO.hpp>
 #include <aliceVision/mvsUtils/MultiViewParams.hpp>
-#include <aliceVision/depthMap/computeOnMultiGPUs.hpp>
 #include <aliceVision/depthMap/depthMap.hpp>
 #include <aliceVision/depthMap/DepthMapParams.hpp>
 #include <aliceVision/gpu/gpu.hpp>
 
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
+#include <aliceVision/depthMap/computeOnMultiGPUs.hpp>
+#endif
+
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 3
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 2
 
 using namespace aliceVision;
 
@@ -64,9 +68,15 @@ int aliceVision_main(int argc, char* argv[])
     bool exportIntermediateCrossVolumes = false;
     bool exportIntermediateVolume9pCsv = false;
 
+    // output depth/sim maps storage
+    bool depthSimMapContainer = false;
+
     // number of GPUs to use (0 means use all GPUs)
     int nbGPUs = 0;
 
+    // computation backend (auto, cuda or cpu)
+    std::string backend = "auto";
+
     po::options_description requiredParams("Required parameters");
     requiredParams.add_options()
         ("input,i", po::value<std::string>(&sfmDataFilename)->required(),
@@ -169,8 +179,15 @@ int aliceVision_main(int argc, char* argv[])
             "Export intermediate volumes 9 points from the SGM and Refine steps in CSV files.")
         ("exportTilePattern", po::value<bool>(&depthMapParams.exportTilePattern)->default_value(depthMapParams.exportTilePattern),
             "Export workflow tile pattern.")
+        ("depthSimMapContainer", po::value<bool>(&depthSimMapContainer)->default_value(depthSimMapContainer),
+            "Write each depth/similarity map pair in a single tiled and compressed container (.avdsm) instead of EXR files.")
         ("nbGPUs", po::value<int>(&nbGPUs)->default_value(nbGPUs),
-            "Number of GPUs to use (0 means use all GPUs).");
+            "Number of GPUs to use (0 means use all GPUs).")
+        ("backend", po::value<std::string>(&backend)->default_value(backend),
+            "Computation backend: \n"
+            "* auto: use CUDA if a compatible GPU is available, otherwise use the CPU\n"
+            "* cuda: use CUDA-Enabled GPUs only\n"
+            "* cpu: use the CPU only (slower, multi-threaded)");
 
     CmdLine cmdline("Dense Reconstruction.\n"
                     "This program estimate a depth map for each input calibrated camera using Plane Sweeping, a multi-view stereo algorithm notable for its efficiency on modern graphics hardware (GPU).\n"
@@ -182,15 +199,42 @@ int aliceVision_main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    // print GPU Information
-    ALICEVISION_LOG_INFO(gpu::gpuInformationCUDA());
+    // check the computation backend
+    if(backend != "auto" && backend != "cuda" && backend != "cpu")
+    {
+      ALICEVISION_LOG_ERROR("Invalid value for backend parameter: " << backend << ". Should be auto, cuda or cpu.");
+      return EXIT_FAILURE;
+    }
+
+    bool useCpuBackend = (backend == "cpu");
 
-    // check if the gpu suppport CUDA compute capability 2.0
-    if(!gpu::gpuSupportCUDA(2,0))
+#if !ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
+    if(backend == "cuda")
     {
-      ALICEVISION_LOG_ERROR("This program needs a CUDA-Enabled GPU (with at least compute capability 2.0).");
+      ALICEVISION_LOG_ERROR("This program has been built without CUDA, use the cpu or auto backend.");
       return EXIT_FAILURE;
     }
+    useCpuBackend = true;
+#endif
+
+    if(!useCpuBackend)
+    {
+      // print GPU Information
+      ALICEVISION_LOG_INFO(gpu::gpuInformationCUDA());
+
+      // check if the gpu suppport CUDA compute capability 2.0
+      if(!gpu::gpuSupportCUDA(2,0))
+      {
+        if(backend == "cuda")
+        {
+          ALICEVISION_LOG_ERROR("This program needs a CUDA-Enabled GPU (with at least compute capability 2.0).");
+          return EXIT_FAILURE;
+        }
+
+        ALICEVISION_LOG_WARNING("No CUDA-Enabled GPU (with at least compute capability 2.0) found, fallback to the CPU backend.");
+        useCpuBackend = true;
+      }
+    }
 
     // check if the scale is correct
     if(downscale < 1)
@@ -288,6 +332,7 @@ int aliceVision_main(int argc, char* argv[])
     mp.userParams.put("sgm.exportIntermediateVolumes", exportIntermediateVolumes);
     mp.userParams.put("sgm.exportIntermediateCrossVolumes", exportIntermediateCrossVolumes);
     mp.userParams.put("sgm.exportIntermediateVolume9pCsv", exportIntermediateVolume9pCsv);
+    mp.userParams.put("depthSimMap.container", depthSimMapContainer);
 
     // Refine Parameters
     mp.userParams.put("refine.scale", refineParams.scale);
@@ -336,8 +381,16 @@ int aliceVision_main(int argc, char* argv[])
       }
     }
 
-    ALICEVISION_LOG_INFO("Create depth maps.");
-    depthMap::computeOnMultiGPUs(mp, cams, depthMap::estimateAndRefineDepthMaps, nbGPUs);
+    ALICEVISION_LOG_INFO("Create depth maps (backend: " << (useCpuBackend ? "cpu" : "cuda") << ").");
+
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
+    if(useCpuBackend)
+      depthMap::estimateAndRefineDepthMapsCpu(mp, cams);
+    else
+      depthMap::computeOnMultiGPUs(mp, cams, depthMap::estimateAndRefineDepthMaps, nbGPUs);
+#else
+    depthMap::estimateAndRefineDepthMapsCpu(mp, cams);
+#endif
 
     ALICEVISION_COMMANDLINE_END
 }
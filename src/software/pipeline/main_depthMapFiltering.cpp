@@ -15,8 +15,12 @@
 #include <aliceVision/system/main.hpp>
 #include <aliceVision/system/Timer.hpp>
 
+#include <aliceVision/config.hpp>
+
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
 #include <aliceVision/depthMap/depthMap.hpp>
 #include <aliceVision/depthMap/computeOnMultiGPUs.hpp>
+#endif
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -24,7 +28,7 @@
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 2
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 1
 
 using namespace aliceVision;
 
@@ -53,6 +57,7 @@ int aliceVision_main(int argc, char* argv[])
     int pixSizeBallWithLowSimilarity = 0;
     int nNearestCams = 10;
     bool computeNormalMaps = false;
+    bool depthSimMapContainer = false;
 
     po::options_description requiredParams("Required parameters");
     requiredParams.add_options()
@@ -86,7 +91,9 @@ int aliceVision_main(int argc, char* argv[])
         ("nNearestCams", po::value<int>(&nNearestCams)->default_value(nNearestCams),
             "Number of nearest cameras.")
         ("computeNormalMaps", po::value<bool>(&computeNormalMaps)->default_value(computeNormalMaps),
-            "Compute normal maps per depth map");
+            "Compute normal maps per depth map")
+        ("depthSimMapContainer", po::value<bool>(&depthSimMapContainer)->default_value(depthSimMapContainer),
+            "Write each filtered depth/similarity map pair in a single tiled and compressed container (.avdsm) instead of EXR files.");
 
     CmdLine cmdline("This program filters depth maps to remove values that are not consistent with other depth maps.\n"
                     "AliceVision depthMapFiltering");
@@ -97,6 +104,14 @@ int aliceVision_main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+#if !ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
+    if(computeNormalMaps)
+    {
+        ALICEVISION_LOG_ERROR("Normal maps computation needs CUDA, this program has been built without CUDA.");
+        return EXIT_FAILURE;
+    }
+#endif
+
     // read the input SfM scene
     sfmData::SfMData sfmData;
     if(!sfmDataIO::Load(sfmData, sfmDataFilename, sfmDataIO::ESfMData::ALL))
@@ -110,6 +125,7 @@ int aliceVision_main(int argc, char* argv[])
 
     mp.setMinViewAngle(minViewAngle);
     mp.setMaxViewAngle(maxViewAngle);
+    mp.userParams.put("depthSimMap.container", depthSimMapContainer);
 
     std::vector<int> cams;
     cams.reserve(mp.ncams);
@@ -143,11 +159,13 @@ int aliceVision_main(int argc, char* argv[])
         fs.filterDepthMaps(cams, minNumOfConsistentCams, minNumOfConsistentCamsWithLowSimilarity);
     }
 
+#if ALICEVISION_IS_DEFINED(ALICEVISION_HAVE_CUDA)
     if (computeNormalMaps)
     {
         int nbGPUs = 0;
         depthMap::computeOnMultiGPUs(mp, cams, depthMap::computeNormalMaps, nbGPUs);
     }
+#endif
 
     ALICEVISION_LOG_INFO("Task done in (s): " + std::to_string(timer.elapsed()));
     return EXIT_SUCCESS;
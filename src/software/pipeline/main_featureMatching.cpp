@@ -27,11 +27,13 @@
 #include <aliceVision/matchingImageCollection/ImagePairListIO.hpp>
 #include <aliceVision/matching/pairwiseAdjacencyDisplay.hpp>
 #include <aliceVision/matching/io.hpp>
+#include <aliceVision/matching/MatchesFile.hpp>
 #include <aliceVision/system/main.hpp>
 #include <aliceVision/system/Timer.hpp>
 #include <aliceVision/cmdline/cmdline.hpp>
 #include <aliceVision/graph/graph.hpp>
 #include <aliceVision/stl/stl.hpp>
+#include <aliceVision/alicevision_omp.hpp>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -39,11 +41,12 @@
 #include <cstdlib>
 #include <fstream>
 #include <cctype>
+#include <memory>
 
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 2
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 1
 
 using namespace aliceVision;
 using namespace aliceVision::camera;
@@ -115,7 +118,7 @@ int aliceVision_main(int argc, char **argv)
   bool useGridSort = true;
   bool exportDebugFiles = false;
   bool matchFromKnownCameraPoses = false;
-  const std::string fileExtension = "txt";
+  std::string fileExtension = "txt";
   int randomSeed = std::mt19937::default_seed;
   double minRequired2DMotion = -1.0;
 
@@ -166,6 +169,10 @@ int aliceVision_main(int argc, char **argv)
       "Make sure that the matching process is symmetric (same matches for I->J than fo J->I).")
     ("matchFilePerImage", po::value<bool>(&matchFilePerImage)->default_value(matchFilePerImage),
       "Save matches in a separate file per image.")
+    ("matchesFileFormat", po::value<std::string>(&fileExtension)->default_value(fileExtension),
+      "Matches file format:\n"
+      "* txt: text file\n"
+      "* bin: binary file indexed per image pair (faster to load)")
     ("distanceRatio", po::value<float>(&distRatio)->default_value(distRatio),
       "Distance ratio to discard non meaningful matches.")
     ("maxIteration", po::value<int>(&maxIteration)->default_value(maxIteration),
@@ -199,6 +206,12 @@ int aliceVision_main(int argc, char **argv)
       return EXIT_FAILURE;
   }
 
+  if(fileExtension != "txt" && fileExtension != "bin")
+  {
+    ALICEVISION_LOG_ERROR("Unknown matches file format: " << fileExtension);
+    return EXIT_FAILURE;
+  }
+
   const double defaultLoRansacMatchingError = 20.0;
   if(!adjustRobustEstimatorThreshold(geometricEstimator, geometricErrorMax, defaultLoRansacMatchingError))
     return EXIT_FAILURE;
@@ -506,12 +519,90 @@ int aliceVision_main(int argc, char **argv)
   for(const auto& matchGeo: geometricMatches)
     ALICEVISION_LOG_INFO("\t- image pair (" + std::to_string(matchGeo.first.first) + ", " + std::to_string(matchGeo.first.second) + ") contains " + std::to_string(matchGeo.second.getNbAllMatches()) + " geometric matches.");
 
+#ifdef ALICEVISION_DEBUG_MATCHING
+  {
+    ALICEVISION_LOG_DEBUG("GEOMETRIC");
+    getStatsMap(geometricMatches);
+  }
+#endif
+
   // grid filtering
   ALICEVISION_LOG_INFO("Grid filtering");
 
+  // the putative matches are not needed anymore
+  PairwiseMatches().swap(mapPutativesMatches);
+
+  // the final matches are only kept in memory for the text format and the debug files
   PairwiseMatches finalMatches;
-  matchesGridFilteringForAllPairs(geometricMatches, sfmData, regionPerView, useGridSort,
-                                  numMatchesToKeep, finalMatches);
+
+  if(fileExtension == "bin")
+  {
+    // the pairs are filtered in parallel by bounded batches, each batch is appended to the binary
+    // matches file as soon as it is filtered and the geometric matches of its pairs are released
+    ALICEVISION_LOG_INFO("Grid filtering and save geometric matches.");
+
+    std::vector<PairwiseMatches::iterator> pairsToFilter;
+    pairsToFilter.reserve(geometricMatches.size());
+    for(auto it = geometricMatches.begin(); it != geometricMatches.end(); ++it)
+      pairsToFilter.push_back(it);
+
+    const std::size_t batchSize = 256;
+    std::vector<MatchesPerDescType> filteredMatches(std::min(batchSize, pairsToFilter.size()));
+
+    std::unique_ptr<MatchesFileWriter> writer;
+    IndexT writerViewId = UndefinedIndexT;
+
+    for(std::size_t batchStart = 0; batchStart < pairsToFilter.size(); batchStart += batchSize)
+    {
+      const std::size_t batchEnd = std::min(batchStart + batchSize, pairsToFilter.size());
+
+      #pragma omp parallel for schedule(dynamic)
+      for(int i = int(batchStart); i < int(batchEnd); ++i)
+      {
+        MatchesPerDescType& filtered = filteredMatches[i - batchStart];
+        filtered.clear();
+        matchesGridFilteringForPair(pairsToFilter[i]->first, pairsToFilter[i]->second, sfmData, regionPerView,
+                                    useGridSort, numMatchesToKeep, filtered);
+        // release the geometric matches of the pair
+        MatchesPerDescType().swap(pairsToFilter[i]->second);
+      }
+
+      // append in the pairs order, one file per first view if requested
+      for(std::size_t i = batchStart; i < batchEnd; ++i)
+      {
+        const Pair& pair = pairsToFilter[i]->first;
+        MatchesPerDescType& filtered = filteredMatches[i - batchStart];
+
+        if(!writer || (matchFilePerImage && pair.first != writerViewId))
+        {
+          if(writer)
+            writer->close();
+          writerViewId = pair.first;
+          const std::string filename = (matchFilePerImage ? std::to_string(pair.first) + "." : "") + filePrefix + "matches.bin";
+          writer.reset(new MatchesFileWriter((fs::path(matchesFolder) / filename).string()));
+        }
+        writer->append(pair, filtered);
+
+        ALICEVISION_LOG_INFO("\t- image pair (" << pair.first << ", " << pair.second << ") contains "
+                             << filtered.getNbAllMatches() << " geometric matches after grid filtering.");
+
+        if(exportDebugFiles)
+          finalMatches[pair] = std::move(filtered);
+        else
+          MatchesPerDescType().swap(filtered);
+      }
+    }
+
+    if(writer)
+      writer->close();
+    // same behavior as the text format: an empty matches file is written if there is no pair
+    else if(!matchFilePerImage)
+      MatchesFileWriter((fs::path(matchesFolder) / (filePrefix + "matches.bin")).string()).close();
+  }
+  else
+  {
+    matchesGridFilteringForAllPairs(geometricMatches, sfmData, regionPerView, useGridSort,
+                                    numMatchesToKeep, finalMatches);
 
     ALICEVISION_LOG_INFO("After grid filtering:");
     for (const auto& matchGridFiltering: finalMatches)
@@ -522,9 +613,10 @@ int aliceVision_main(int argc, char **argv)
                              << " geometric matches.");
     }
 
-  // export geometric filtered matches
-  ALICEVISION_LOG_INFO("Save geometric matches.");
-  Save(finalMatches, matchesFolder, fileExtension, matchFilePerImage, filePrefix);
+    // export geometric filtered matches
+    ALICEVISION_LOG_INFO("Save geometric matches.");
+    Save(finalMatches, matchesFolder, fileExtension, matchFilePerImage, filePrefix);
+  }
   ALICEVISION_LOG_INFO("Task done in (s): " + std::to_string(timer.elapsed()));
 
   // d. Export some statistics
@@ -549,12 +641,5 @@ int aliceVision_main(int argc, char **argv)
     */
   }
 
-#ifdef ALICEVISION_DEBUG_MATCHING
-  {
-    ALICEVISION_LOG_DEBUG("GEOMETRIC");
-    getStatsMap(geometricMatches);
-  }
-#endif
-
   return EXIT_SUCCESS;
 }
@@ -17,6 +17,7 @@
 #include <aliceVision/types.hpp>
 #include <aliceVision/config.hpp>
 #include <aliceVision/track/TracksBuilder.hpp>
+#include <aliceVision/track/TracksStore.hpp>
 #include <aliceVision/sfm/BundleAdjustment.hpp>
 
 #include <boost/program_options.hpp>
@@ -27,7 +28,7 @@
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 2
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 3
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 4
 
 using namespace aliceVision;
 
@@ -82,6 +83,7 @@ int aliceVision_main(int argc, char **argv)
   // user optional parameters
   std::string outputSfMViewsAndPoses;
   std::string extraInfoFolder;
+  std::string tracksFilename;
   std::string describerTypesName = feature::EImageDescriberType_enumToString(feature::EImageDescriberType::SIFT);
   std::pair<std::string,std::string> initialPairString("","");
 
@@ -107,6 +109,9 @@ int aliceVision_main(int argc, char **argv)
       "Path to folder(s) containing the extracted features.")
     ("matchesFolders,m", po::value<std::vector<std::string>>(&matchesFolders)->multitoken(),
       "Path to folder(s) in which computed matches are stored.")
+    ("tracksFilename", po::value<std::string>(&tracksFilename)->default_value(tracksFilename),
+      "Path to a binary tracks file ('.bin') written by tracksBuilding. If set, the tracks are loaded instead of "
+      "being built from the matches: minInputTrackLength and filterTrackForks are those used by tracksBuilding.")
     ("outputViewsAndPoses", po::value<std::string>(&outputSfMViewsAndPoses)->default_value(outputSfMViewsAndPoses),
       "Path to the output SfMData file (with only views and poses).")
     ("extraInfoFolder", po::value<std::string>(&extraInfoFolder)->default_value(extraInfoFolder),
@@ -160,6 +165,10 @@ int aliceVision_main(int argc, char **argv)
     ("maxImagesPerGroup", po::value<std::size_t>(&sfmParams.maxImagesPerGroup)->default_value(sfmParams.maxImagesPerGroup),
       "Maximum number of cameras that can be added before the bundle adjustment is performed. This prevents adding too much data "
       "at once without performing the bundle adjustment.")
+    ("adaptiveImagesPerGroup", po::value<bool>(&sfmParams.adaptiveImagesPerGroup)->default_value(sfmParams.adaptiveImagesPerGroup),
+      "Adapt the number of cameras added before each bundle adjustment (between the number of threads and maxImagesPerGroup) "
+      "to the measured durations of the resection and the bundle adjustment. The reconstruction is not reproducible "
+      "from run to run when enabled.")
     ("bundleAdjustmentMaxOutliers", po::value<int>(&sfmParams.bundleAdjustmentMaxOutliers)->default_value(sfmParams.bundleAdjustmentMaxOutliers),
       "Threshold for the maximum number of outliers allowed at the end of a bundle adjustment iteration."
       "Using a negative value for this threshold will disable BA iterations.")
@@ -252,6 +261,31 @@ int aliceVision_main(int argc, char **argv)
     return EXIT_FAILURE;
   }
 
+  // tracks reading
+  track::TracksStore tracksStore;
+  if(!tracksFilename.empty())
+  {
+    try
+    {
+      tracksStore.load(tracksFilename);
+    }
+    catch(const std::exception& e)
+    {
+      ALICEVISION_LOG_ERROR("Unable to load the tracks file '" << tracksFilename << "': " << e.what());
+      return EXIT_FAILURE;
+    }
+
+    for(const IndexT viewId : tracksStore.getViewIds())
+    {
+      if(!sfmData.getViews().count(viewId))
+      {
+        ALICEVISION_LOG_ERROR("The tracks file '" << tracksFilename << "' does not match the input SfMData: unknown view id " << viewId << ".");
+        return EXIT_FAILURE;
+      }
+    }
+    ALICEVISION_LOG_INFO("Tracks loaded from '" << tracksFilename << "': " << tracksStore.nbTracks() << " tracks.");
+  }
+
   if(extraInfoFolder.empty())
     extraInfoFolder = fs::path(outputSfM).parent_path().string();
 
@@ -302,6 +336,8 @@ int aliceVision_main(int argc, char **argv)
   // configure the featuresPerView & the matches_provider
   sfmEngine.setFeatures(&featuresPerView);
   sfmEngine.setMatches(&pairwiseMatches);
+  if(!tracksFilename.empty())
+    sfmEngine.setTracks(&tracksStore);
 
   if(!sfmEngine.process())
     return EXIT_FAILURE;
@@ -11,6 +11,7 @@
 #include <aliceVision/fuseCut/LargeScale.hpp>
 #include <aliceVision/fuseCut/ReconstructionPlan.hpp>
 #include <aliceVision/fuseCut/DelaunayGraphCut.hpp>
+#include <aliceVision/fuseCut/SpacePartition.hpp>
 #include <aliceVision/mesh/meshPostProcessing.hpp>
 #include <aliceVision/mvsData/Point3d.hpp>
 #include <aliceVision/mvsData/StaticVector.hpp>
@@ -21,18 +22,29 @@
 #include <aliceVision/system/Logger.hpp>
 #include <aliceVision/system/main.hpp>
 #include <aliceVision/system/Timer.hpp>
+#include <aliceVision/system/MemoryInfo.hpp>
+#include <aliceVision/alicevision_omp.hpp>
 
 #include <Eigen/Geometry>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 4
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 4
 
 using namespace aliceVision;
 
@@ -247,6 +259,51 @@ inline std::istream& operator>>(std::istream& in, BoundingBox& out_bbox)
 }
 
 
+/// Write the path, size and modification time of a file, to detect the changes of an input
+void writeFileKey(std::ostream& out, const std::string& filepath)
+{
+    out << filepath;
+    boost::system::error_code ec;
+    if(fs::is_regular_file(filepath, ec))
+        out << " " << fs::file_size(filepath, ec) << " " << fs::last_write_time(filepath, ec);
+    out << "\n";
+}
+
+/// Write the depth maps fusion parameters, to detect the changes of an input
+void writeFuseParamsKey(std::ostream& out, const fuseCut::FuseParams& params)
+{
+    out << params.maxInputPoints << " " << params.maxPoints << " " << params.minStep << " " << params.minVis << " "
+        << params.simFactor << " " << params.angleFactor << " " << params.pixSizeMarginInitCoef << " " << params.pixSizeMarginFinalCoef << " "
+        << params.voteMarginFactor << " " << params.contributeMarginFactor << " " << params.simGaussianSizeInit << " " << params.simGaussianSize << " "
+        << params.minAngleThreshold << " " << params.refineFuse << " " << params.maskHelperPointsWeight << " " << params.maskBorderSize << "\n";
+}
+
+/// Get the space to reconstruct: the bounding box if it is given, otherwise estimate it from the depth maps or from the SfM
+void estimateSpace(fuseCut::Fuser& fuser,
+                   const BoundingBox& boundingBox,
+                   const sfmData::SfMData& sfmData,
+                   bool meshingFromDepthMaps,
+                   bool estimateSpaceFromSfM,
+                   std::size_t estimateSpaceMinObservations,
+                   float estimateSpaceMinObservationAngle,
+                   std::array<Point3d, 8>& out_hexah)
+{
+    float minPixSize;
+
+    if (boundingBox.isInitialized())
+        boundingBox.toHexahedron(&out_hexah[0]);
+    else if(meshingFromDepthMaps && (!estimateSpaceFromSfM || sfmData.getLandmarks().empty()))
+      fuser.divideSpaceFromDepthMaps(&out_hexah[0], minPixSize);
+    else
+      fuser.divideSpaceFromSfM(sfmData, &out_hexah[0], estimateSpaceMinObservations, estimateSpaceMinObservationAngle);
+
+    const double length = out_hexah[0].x - out_hexah[1].x;
+    const double width = out_hexah[0].y - out_hexah[3].y;
+    const double height = out_hexah[0].z - out_hexah[4].z;
+
+    ALICEVISION_LOG_INFO("bounding Box : length: " << length << ", width: " << width << ", height: " << height);
+}
+
 int aliceVision_main(int argc, char* argv[])
 {
     system::Timer timer;
@@ -283,6 +340,12 @@ int aliceVision_main(int argc, char* argv[])
     double fullWeight = 1.0;
     bool exportDebugTetrahedralization = false;
     int maxNbConnectedHelperPoints = 50;
+    std::string maxflowSolver = "boykovKolmogorov";
+    bool parallelDelaunay = false;
+    std::size_t partitionMaxMemory = 0;
+    double partitionOverlap = 0.1;
+    int partitionNbParallelBlocks = 1;
+    std::size_t partitionMemoryPerPoint = fuseCut::defaultMeshingMemoryPerPoint;
 
     po::options_description requiredParams("Required parameters");
     requiredParams.add_options()
@@ -315,7 +378,11 @@ int aliceVision_main(int argc, char* argv[])
         ("minVis", po::value<int>(&fuseParams.minVis)->default_value(fuseParams.minVis),
             "Filter points based on their number of observations")
         ("partitioning", po::value<EPartitioningMode>(&partitioningMode)->default_value(partitioningMode),
-            "Partitioning: 'singleBlock' or 'auto'.")
+            "Partitioning: 'singleBlock' or 'auto'.\n"
+            "* singleBlock: the whole space is meshed at once\n"
+            "* auto: the space is split into overlapping blocks meshed within the memory budget, their meshes are stitched")
+        ("partitionMaxMemory", po::value<std::size_t>(&partitionMaxMemory)->default_value(partitionMaxMemory),
+            "Memory budget in MB of the 'auto' partitioning (0 to use the available memory).")
         ("repartition", po::value<ERepartitionMode>(&repartitionMode)->default_value(repartitionMode),
             "Repartition: 'multiResolution' or 'regularGrid'.")
         ("estimateSpaceFromSfM", po::value<bool>(&estimateSpaceFromSfM)->default_value(estimateSpaceFromSfM),
@@ -379,6 +446,20 @@ int aliceVision_main(int argc, char* argv[])
             "Maximum number of connected helper points before we remove them.")
         ("exportDebugTetrahedralization", po::value<bool>(&exportDebugTetrahedralization)->default_value(exportDebugTetrahedralization),
             "Export debug cells score as tetrahedral mesh. WARNING: could create huge meshes, only use on very small datasets.")        
+        ("maxflowSolver", po::value<std::string>(&maxflowSolver)->default_value(maxflowSolver),
+            "Solver used for the graph cut (same result):\n"
+            "* boykovKolmogorov: sequential Boykov-Kolmogorov\n"
+            "* pushRelabel: multi-threaded push-relabel, faster on large scenes with many cores")
+        ("parallelDelaunay", po::value<bool>(&parallelDelaunay)->default_value(parallelDelaunay),
+            "Use the multi-threaded Delaunay tetrahedralization of geogram if available. "
+            "Faster on large scenes, but the tetrahedralization (and so the output mesh) may differ between runs.")
+        ("partitionOverlap", po::value<double>(&partitionOverlap)->default_value(partitionOverlap),
+            "Overlap between the blocks of the 'auto' partitioning, relative to the block size.")
+        ("partitionNbParallelBlocks", po::value<int>(&partitionNbParallelBlocks)->default_value(partitionNbParallelBlocks),
+            "Number of blocks of the 'auto' partitioning meshed in parallel, they share the memory budget and the cores.")
+        ("partitionMemoryPerPoint", po::value<std::size_t>(&partitionMemoryPerPoint)->default_value(partitionMemoryPerPoint),
+            "Memory of the Delaunay graph cut per point in bytes, used to size the blocks of the 'auto' partitioning. "
+            "The default is a conservative estimate: the memory increase per point of each block is logged to adjust it.")
         ("seed", po::value<unsigned int>(&seed)->default_value(seed),
             "Seed used in random processes. (0 to use a random seed).");
 
@@ -391,6 +472,11 @@ int aliceVision_main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    if(maxflowSolver != "boykovKolmogorov" && maxflowSolver != "pushRelabel")
+    {
+      ALICEVISION_LOG_ERROR("Invalid value for maxflowSolver parameter: " << maxflowSolver << ". Should be boykovKolmogorov or pushRelabel.");
+      return EXIT_FAILURE;
+    }
 
     if(depthMapsFolder.empty())
     {
@@ -431,6 +517,8 @@ int aliceVision_main(int argc, char* argv[])
     mp.userParams.put("delaunaycut.nPixelSizeBehind", nPixelSizeBehind);
     mp.userParams.put("delaunaycut.fullWeight", fullWeight);
     mp.userParams.put("delaunaycut.voteFilteringForWeaklySupportedSurfaces", voteFilteringForWeaklySupportedSurfaces);
+    mp.userParams.put("delaunaycut.maxflowSolver", maxflowSolver);
+    mp.userParams.put("delaunaycut.parallelDelaunay", parallelDelaunay);
     mp.userParams.put("hallucinationsFiltering.invertTetrahedronBasedOnNeighborsNbIterations", invertTetrahedronBasedOnNeighborsNbIterations);
     mp.userParams.put("hallucinationsFiltering.minSolidAngleRatio", minSolidAngleRatio);
     mp.userParams.put("hallucinationsFiltering.nbSolidAngleFilteringIterations", nbSolidAngleFilteringIterations);
@@ -458,31 +546,209 @@ int aliceVision_main(int argc, char* argv[])
             {
                 case ePartitioningAuto:
                 {
-                    throw std::invalid_argument("Meshing mode: 'multiResolution', partitioning: 'auto' is not yet implemented.");
-                }
-                case ePartitioningSingleBlock:
-                {
-                    ALICEVISION_LOG_INFO("Meshing mode: multi-resolution, partitioning: single block.");
+                    ALICEVISION_LOG_INFO("Meshing mode: multi-resolution, partitioning: auto.");
                     std::array<Point3d, 8> hexah;
 
-                    float minPixSize;
-                    fuseCut::Fuser fs(mp);
+                    fuseCut::Fuser fuser(mp);
+                    estimateSpace(fuser, boundingBox, sfmData, meshingFromDepthMaps, estimateSpaceFromSfM,
+                                  estimateSpaceMinObservations, estimateSpaceMinObservationAngle, hexah);
 
-                    if (boundingBox.isInitialized())
-                        boundingBox.toHexahedron(&hexah[0]);
-                    else if(meshingFromDepthMaps && (!estimateSpaceFromSfM || sfmData.getLandmarks().empty()))
-                      fs.divideSpaceFromDepthMaps(&hexah[0], minPixSize);
-                    else
-                      fs.divideSpaceFromSfM(sfmData, &hexah[0], estimateSpaceMinObservations, estimateSpaceMinObservationAngle);
+                    if(saveRawDensePointCloud)
+                        ALICEVISION_LOG_WARNING("The dense point cloud before cut and filtering is not saved with the 'auto' partitioning.");
+
+                    // memory budget of a block
+                    const int nbParallelBlocks = std::max(1, partitionNbParallelBlocks);
+                    const std::size_t memoryBudget = (partitionMaxMemory > 0) ? partitionMaxMemory * 1024 * 1024 : system::getMemoryInfo().availableRam;
+                    if(partitionMemoryPerPoint == 0)
+                        throw std::invalid_argument("Invalid partitionMemoryPerPoint, it should be positive.");
+                    const std::size_t maxPointsPerBlock = std::min(std::size_t(fuseParams.maxPoints),
+                                                                   fuseCut::getMaxPointsPerBlock(memoryBudget / nbParallelBlocks, fuseParams.maxInputPoints,
+                                                                                                 partitionMemoryPerPoint));
+                    if(maxPointsPerBlock == 0)
+                        throw std::runtime_error("The memory budget (" + std::to_string(memoryBudget / (1024 * 1024)) + " MB) is too small to fuse " +
+                                                 std::to_string(fuseParams.maxInputPoints) + " input points per block, "
+                                                 "increase partitionMaxMemory or reduce maxInputPoints.");
+
+                    // the whole scene has maxPoints points as with a single block, split it into blocks within the memory budget
+                    const fuseCut::HexahedronFrame frame(&hexah[0]);
+                    const std::vector<fuseCut::SpaceBlock> blocks = fuseCut::computeSpaceBlocks(frame, fuser.getDepthMapsSamplePoints(), fuseParams.maxPoints,
+                                                                                                maxPointsPerBlock, partitionOverlap);
+
+                    fuseCut::FuseParams blockFuseParams = fuseParams;
+                    blockFuseParams.maxPoints = maxPointsPerBlock;
+
+                    const fs::path blocksDirectory = outDirectory / "blocks";
+                    fs::create_directories(blocksDirectory);
+                    std::vector<std::string> blocksDirs(blocks.size());
+                    for(std::size_t i = 0; i < blocks.size(); ++i)
+                        blocksDirs[i] = (blocksDirectory / ("block" + mvsUtils::num2strFourDecimal(i))).string() + "/";
+
+                    // geogram initialization in DelaunayGraphCut is not thread-safe
+                    std::mutex delaunayGCMutex;
+
+                    // the inputs shared by all the blocks
+                    std::ostringstream inputsKey;
+                    inputsKey.precision(17);
+                    writeFileKey(inputsKey, sfmDataFilename);
+                    if(meshingFromDepthMaps && fs::is_directory(depthMapsFolder))
+                    {
+                        std::vector<fs::path> depthMapsFiles(fs::directory_iterator(depthMapsFolder), fs::directory_iterator{});
+                        std::sort(depthMapsFiles.begin(), depthMapsFiles.end());
+                        for(const fs::path& depthMapFile : depthMapsFiles)
+                            writeFileKey(inputsKey, depthMapFile.string());
+                    }
+                    boost::property_tree::write_json(inputsKey, mp.userParams);
+                    writeFuseParamsKey(inputsKey, blockFuseParams);
+                    inputsKey << addLandmarksToTheDensePointCloud << " " << maxNbConnectedHelperPoints << " " << exportDebugTetrahedralization << "\n";
 
+                    const auto meshBlock = [&](int i)
+                    {
+                        const std::string& blockDir = blocksDirs[i];
+                        std::array<Point3d, 8> blockHexah = frame.getHexahedron(blocks[i].min, blocks[i].max);
+                        const StaticVector<int> cams = mp.findCamsWhichIntersectsHexahedron(&blockHexah[0]);
+
+                        // reuse the result of a previous run only if it was computed from the same inputs
+                        std::ostringstream blockKey;
+                        blockKey.precision(17);
+                        blockKey << inputsKey.str();
+                        for(const Point3d& p : blockHexah)
+                            blockKey << p.x << " " << p.y << " " << p.z << "\n";
+                        for(int c = 0; c < cams.size(); ++c)
+                            blockKey << cams[c] << " ";
+                        blockKey << "\n";
+
+                        const std::string blockKeyFilepath = blockDir + "blockInputs.txt";
+                        if(fs::exists(blockKeyFilepath))
+                        {
+                            std::ifstream blockKeyFile(blockKeyFilepath);
+                            const std::string previousBlockKey((std::istreambuf_iterator<char>(blockKeyFile)), std::istreambuf_iterator<char>());
+                            if(previousBlockKey == blockKey.str())
+                            {
+                                ALICEVISION_LOG_INFO("Mesh block " << i + 1 << "/" << blocks.size() << ": already computed.");
+                                return;
+                            }
+                        }
+                        // remove the results of other inputs
+                        fs::remove_all(blockDir);
+                        fs::create_directories(blockDir);
+
+                        const auto saveBlockKey = [&]()
+                        {
+                            std::ofstream blockKeyFile(blockKeyFilepath);
+                            blockKeyFile << blockKey.str();
+                            if(!blockKeyFile)
+                                throw std::runtime_error("Cannot write the block inputs file: " + blockKeyFilepath);
+                        };
+
+                        if(cams.empty())
+                        {
+                            ALICEVISION_LOG_INFO("Mesh block " << i + 1 << "/" << blocks.size() << ": no camera.");
+                            saveBlockKey();
+                            return;
+                        }
+                        ALICEVISION_LOG_INFO("Mesh block " << i + 1 << "/" << blocks.size() << ": " << cams.size() << " cameras, "
+                                             << blocks[i].nbPoints << " estimated points.");
+
+                        std::unique_ptr<fuseCut::DelaunayGraphCut> delaunayGC;
+                        {
+                            std::lock_guard<std::mutex> lock(delaunayGCMutex);
+                            delaunayGC.reset(new fuseCut::DelaunayGraphCut(mp));
+                        }
+                        // resident memory before the block, only meaningful if the blocks are meshed one at a time
+                        const std::size_t blockStartMemory = system::getProcessMemory();
+                        delaunayGC->createDensePointCloud(&blockHexah[0], cams, addLandmarksToTheDensePointCloud ? &sfmData : nullptr, &blockFuseParams);
+                        const std::size_t nbPoints = delaunayGC->_verticesCoords.size();
+                        delaunayGC->createGraphCut(&blockHexah[0], cams, blockDir, blockDir + "SpaceCamsTracks/", false,
+                                                   exportDebugTetrahedralization);
+                        const std::size_t blockEndMemory = system::getProcessMemory();
+                        if(nbParallelBlocks == 1 && nbPoints > 0 && blockEndMemory > blockStartMemory)
+                            ALICEVISION_LOG_INFO("Mesh block " << i + 1 << "/" << blocks.size() << ": " << nbPoints << " points, memory increase: "
+                                                 << (blockEndMemory - blockStartMemory) / std::pow(2, 20) << " MB, "
+                                                 << (blockEndMemory - blockStartMemory) / nbPoints << " bytes per point (partitionMemoryPerPoint: "
+                                                 << partitionMemoryPerPoint << ").");
+                        delaunayGC->graphCutPostProcessing(&blockHexah[0], blockDir);
+
+                        mesh::Mesh* blockMesh = delaunayGC->createMesh(maxNbConnectedHelperPoints);
+                        StaticVector<StaticVector<int>> blockPtsCams;
+                        delaunayGC->createPtsCams(blockPtsCams);
+                        delaunayGC.reset();
+
+                        mesh::meshPostProcessing(blockMesh, blockPtsCams, mp, blockDir, nullptr, &blockHexah[0]);
+
+                        if(!blockMesh->tris.empty())
+                        {
+                            saveArrayOfArraysToFile<int>(blockDir + "meshPtsCamsFromDGC.bin", blockPtsCams);
+                            blockMesh->saveToBin(blockDir + "mesh.bin");
+                        }
+                        delete blockMesh;
+                        saveBlockKey();
+                    };
+
+                    // blocks in parallel, they share the cores
                     {
-                        const double length = hexah[0].x - hexah[1].x;
-                        const double width = hexah[0].y - hexah[3].y;
-                        const double height = hexah[0].z - hexah[4].z;
+                        const int nbThreadsPerBlock = std::max(1, omp_get_max_threads() / nbParallelBlocks);
+                        std::atomic<int> nextBlock{0};
+                        std::mutex errorMutex;
+                        std::exception_ptr error;
+
+                        const auto meshBlocks = [&]()
+                        {
+                            omp_set_num_threads(nbThreadsPerBlock);
+                            for(int i = nextBlock++; i < blocks.size(); i = nextBlock++)
+                            {
+                                try
+                                {
+                                    meshBlock(i);
+                                }
+                                catch(...)
+                                {
+                                    std::lock_guard<std::mutex> lock(errorMutex);
+                                    if(!error)
+                                        error = std::current_exception();
+                                    nextBlock = int(blocks.size());
+                                }
+                            }
+                        };
+
+                        std::vector<std::thread> threads;
+                        for(int t = 0; t < std::min(nbParallelBlocks, int(blocks.size())); ++t)
+                            threads.emplace_back(meshBlocks);
+                        for(std::thread& thread : threads)
+                            thread.join();
+
+                        if(error)
+                            std::rethrow_exception(error);
+                    }
 
-                        ALICEVISION_LOG_INFO("bounding Box : length: " << length << ", width: " << width << ", height: " << height);
+                    // stitch the blocks meshes
+                    fuseCut::BlockMeshesStitcher stitcher(frame, blocks);
+                    for(std::size_t i = 0; i < blocks.size(); ++i)
+                    {
+                        const std::string meshFilepath = blocksDirs[i] + "mesh.bin";
+                        if(!fs::exists(meshFilepath))
+                            continue;
+
+                        mesh::Mesh blockMesh;
+                        blockMesh.loadFromBin(meshFilepath);
+                        StaticVector<StaticVector<int>> blockPtsCams;
+                        loadArrayOfArraysFromFile<int>(blockPtsCams, blocksDirs[i] + "meshPtsCamsFromDGC.bin");
+                        stitcher.addBlockMesh(i, blockMesh, blockPtsCams);
                     }
 
+                    mesh = new mesh::Mesh();
+                    stitcher.stitch(*mesh, ptsCams);
+
+                    break;
+                }
+                case ePartitioningSingleBlock:
+                {
+                    ALICEVISION_LOG_INFO("Meshing mode: multi-resolution, partitioning: single block.");
+                    std::array<Point3d, 8> hexah;
+
+                    fuseCut::Fuser fs(mp);
+                    estimateSpace(fs, boundingBox, sfmData, meshingFromDepthMaps, estimateSpaceFromSfM,
+                                  estimateSpaceMinObservations, estimateSpaceMinObservationAngle, hexah);
+
                     StaticVector<int> cams;
                     if(meshingFromDepthMaps)
                     {
@@ -52,6 +52,7 @@ int aliceVision_main(int argc, char* argv[])
 
     std::string outputFolder;
     std::string imagesFolder;
+    std::string cacheFolder;
     image::EImageColorSpace workingColorSpace = image::EImageColorSpace::SRGB;
     image::EImageColorSpace outputColorSpace = image::EImageColorSpace::AUTO;
     bool flipNormals = false;
@@ -134,7 +135,9 @@ int aliceVision_main(int argc, char* argv[])
             " * Push: For each vertex of the reconstruction, push the visibilities to the closest triangle in the input mesh.\n"
             " * PullPush: Combine results from Pull and Push results.'")
         ("subdivisionTargetRatio", po::value<float>(&texParams.subdivisionTargetRatio)->default_value(texParams.subdivisionTargetRatio),
-            "Percentage of the density of the reconstruction as the target for the subdivision (0: disable subdivision, 0.5: half density of the reconstruction, 1: full density of the reconstruction).");
+            "Percentage of the density of the reconstruction as the target for the subdivision (0: disable subdivision, 0.5: half density of the reconstruction, 1: full density of the reconstruction).")
+        ("cacheFolder", po::value<std::string>(&cacheFolder)->default_value(cacheFolder),
+            "Folder where the texture tiles that do not fit in memory are swapped (empty: system temporary folder).");
 
 
     CmdLine cmdline("AliceVision texturing");
@@ -226,7 +229,7 @@ int aliceVision_main(int argc, char* argv[])
     if(!inputMeshFilepath.empty() && !sfmDataFilename.empty() && texParams.textureFileType != image::EImageFileType::NONE)
     {
         ALICEVISION_LOG_INFO("Generate textures.");
-        mesh.generateTextures(mp, outputFolder, texParams.textureFileType);
+        mesh.generateTextures(mp, outputFolder, texParams.textureFileType, cacheFolder);
     }
 
 
@@ -17,24 +17,66 @@
 #include <aliceVision/types.hpp>
 #include <aliceVision/config.hpp>
 
+#include <aliceVision/track/StreamingTracksBuilder.hpp>
 #include <aliceVision/track/TracksBuilder.hpp>
+#include <aliceVision/track/TracksStore.hpp>
 #include <aliceVision/track/trackIO.hpp>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/range/iterator_range.hpp>
 
+#include <algorithm>
 #include <cstdlib>
+#include <set>
 
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 1
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 1
 
 using namespace aliceVision;
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
+/**
+ * @brief List the binary matches files of the matches folders, as matching::Load
+ * @param[in] folders the matches folders
+ * @return the sorted binary matches files
+ */
+std::vector<std::string> listBinaryMatchesFiles(const std::vector<std::string>& folders)
+{
+    // build up a set with normalized paths to remove duplicates
+    std::set<std::string> foldersSet;
+    for(const auto& folder : folders)
+    {
+        if(fs::exists(folder))
+            foldersSet.insert(fs::canonical(folder).string());
+    }
+
+    std::vector<std::string> matchesFiles;
+    for(const auto& folder : foldersSet)
+    {
+        std::size_t nbFolderMatchesFiles = 0;
+        for(const auto& entry : boost::make_iterator_range(fs::directory_iterator(folder), {}))
+        {
+            if(entry.path().string().find("matches.bin") != std::string::npos)
+            {
+                matchesFiles.push_back(entry.path().string());
+                ++nbFolderMatchesFiles;
+            }
+        }
+        if(!nbFolderMatchesFiles)
+            ALICEVISION_LOG_WARNING("No binary matches file in: " << folder);
+    }
+
+    // sort to get a deterministic order
+    std::sort(matchesFiles.begin(), matchesFiles.end());
+    return matchesFiles;
+}
+
 
 int aliceVision_main(int argc, char** argv)
 {
@@ -48,13 +90,17 @@ int aliceVision_main(int argc, char** argv)
     int minInputTrackLength = 2;
     bool filterTrackForks = true;
     bool useOnlyMatchesFromInputFolder = false;
+    bool streaming = false;
+    std::size_t maxMemory = 0;
 
     // user optional parameters
     std::string describerTypesName = feature::EImageDescriberType_enumToString(feature::EImageDescriberType::SIFT);
 
     po::options_description requiredParams("Required parameters");
     requiredParams.add_options()("input,i", po::value<std::string>(&sfmDataFilename)->required(), "SfMData file.")(
-        "output,o", po::value<std::string>(&tracksFilename)->required(), "Path to the tracks file.");
+        "output,o", po::value<std::string>(&tracksFilename)->required(), "Path to the tracks file.\n"
+        "A '.bin' extension writes a binary tracks file (track::TracksStore), which can be given to incrementalSfM (--tracksFilename), "
+        "otherwise a JSON file is written.");
 
     po::options_description optionalParams("Optional parameters");
     optionalParams.add_options()
@@ -66,7 +112,10 @@ int aliceVision_main(int argc, char** argv)
         ("minInputTrackLength", po::value<int>(&minInputTrackLength)->default_value(minInputTrackLength), "Minimum track length in input of SfM.")
         ("useOnlyMatchesFromInputFolder", po::value<bool>(&useOnlyMatchesFromInputFolder)->default_value(useOnlyMatchesFromInputFolder), "Use only matches from the input matchesFolder parameter.\n"
         "Matches folders previously added to the SfMData file will be ignored.")
-        ("filterTrackForks", po::value<bool>(&filterTrackForks)->default_value(filterTrackForks), "Enable/Disable the track forks removal. A track contains a fork when incoherent matches leads to multiple features in the same image for a single track.\n");
+        ("filterTrackForks", po::value<bool>(&filterTrackForks)->default_value(filterTrackForks), "Enable/Disable the track forks removal. A track contains a fork when incoherent matches leads to multiple features in the same image for a single track.\n")
+        ("streaming", po::value<bool>(&streaming)->default_value(streaming), "Build the tracks by streaming the binary matches files ('matches.bin') one image pair at a time, "
+        "instead of loading all the features and matches in memory.")
+        ("maxMemory", po::value<std::size_t>(&maxMemory)->default_value(maxMemory), "Maximum memory (in MB) of the streaming tracks building. 0 means no limit.");
 
     CmdLine cmdline("AliceVision tracksBuilding");
 
@@ -93,44 +142,90 @@ int aliceVision_main(int argc, char** argv)
     // get imageDescriber type
     const std::vector<feature::EImageDescriberType> describerTypes = feature::EImageDescriberType_stringToEnums(describerTypesName);
 
-    // features reading
-    feature::FeaturesPerView featuresPerView;
-    ALICEVISION_LOG_INFO("Load features");
-    if(!sfm::loadFeaturesPerView(featuresPerView, sfmData, featuresFolders, describerTypes))
+    const bool binaryOutput = boost::to_lower_copy(fs::path(tracksFilename).extension().string()) == ".bin";
+    track::TracksStore tracksStore;
+    track::TracksMap mapTracks;
+
+    if(streaming)
     {
-        ALICEVISION_LOG_ERROR("Invalid features.");
-        return EXIT_FAILURE;
+        // the features are not needed, the builder only uses the feature ids of the matches
+        std::vector<std::string> allMatchesFolders;
+        if(!useOnlyMatchesFromInputFolder)
+            allMatchesFolders = sfmData.getMatchesFolders();
+        allMatchesFolders.insert(allMatchesFolders.end(), matchesFolders.begin(), matchesFolders.end());
+
+        const std::vector<std::string> matchesFiles = listBinaryMatchesFiles(allMatchesFolders);
+        if(matchesFiles.empty())
+        {
+            ALICEVISION_LOG_ERROR("No binary matches file found, the streaming tracks building requires 'matches.bin' files.");
+            return EXIT_FAILURE;
+        }
+
+        track::MatchesFilter filter;
+        filter.viewsKeys = sfmData.getViewsKeys();
+        filter.descTypes = describerTypes;
+        filter.maxNbMatches = maxNbMatches;
+        filter.minNbMatches = minNbMatches;
+
+        track::StreamingTracksBuilder tracksBuilder(maxMemory * 1024 * 1024);
+        ALICEVISION_LOG_INFO("Track building from " << matchesFiles.size() << " binary matches file(s)");
+        tracksBuilder.build(matchesFiles, filter);
+
+        ALICEVISION_LOG_INFO("Track filtering and export to structure");
+        tracksBuilder.exportToStore(tracksStore, filterTrackForks, minInputTrackLength);
+
+        if(!binaryOutput)
+            tracksStore.exportToSTL(mapTracks);
     }
-
-    // matches reading
-    matching::PairwiseMatches pairwiseMatches;
-    ALICEVISION_LOG_INFO("Load features matches");
-    if(!sfm::loadPairwiseMatches(pairwiseMatches, sfmData, matchesFolders, describerTypes, maxNbMatches, minNbMatches, useOnlyMatchesFromInputFolder))
+    else
     {
-        ALICEVISION_LOG_ERROR("Unable to load matches.");
-        return EXIT_FAILURE;
+        // features reading
+        feature::FeaturesPerView featuresPerView;
+        ALICEVISION_LOG_INFO("Load features");
+        if(!sfm::loadFeaturesPerView(featuresPerView, sfmData, featuresFolders, describerTypes))
+        {
+            ALICEVISION_LOG_ERROR("Invalid features.");
+            return EXIT_FAILURE;
+        }
+
+        // matches reading
+        matching::PairwiseMatches pairwiseMatches;
+        ALICEVISION_LOG_INFO("Load features matches");
+        if(!sfm::loadPairwiseMatches(pairwiseMatches, sfmData, matchesFolders, describerTypes, maxNbMatches, minNbMatches, useOnlyMatchesFromInputFolder))
+        {
+            ALICEVISION_LOG_ERROR("Unable to load matches.");
+            return EXIT_FAILURE;
+        }
+
+        //Create tracks
+        track::TracksBuilder tracksBuilder;
+        ALICEVISION_LOG_INFO("Track building");
+        tracksBuilder.build(pairwiseMatches);
+
+        ALICEVISION_LOG_INFO("Track filtering");
+        tracksBuilder.filter(filterTrackForks, minInputTrackLength);
+
+        ALICEVISION_LOG_INFO("Track export to structure");
+        tracksBuilder.exportToSTL(mapTracks);
+
+        if(binaryOutput)
+            tracksStore.importFromSTL(mapTracks);
     }
 
-    //Create tracks
-    track::TracksBuilder tracksBuilder;
-    ALICEVISION_LOG_INFO("Track building");
-    tracksBuilder.build(pairwiseMatches);
-
-    ALICEVISION_LOG_INFO("Track filtering");
-    tracksBuilder.filter(filterTrackForks, minInputTrackLength);
-
-    ALICEVISION_LOG_INFO("Track export to structure");
-    track::TracksMap mapTracks;
-    tracksBuilder.exportToSTL(mapTracks);
-
-    // write the json file with the tree
     ALICEVISION_LOG_INFO("Export to file");
-    std::stringstream ss;
-
-    boost::json::value jv = boost::json::value_from(mapTracks);
-    std::ofstream of(tracksFilename);
-    of << boost::json::serialize(jv);
-    of.close();
+    if(binaryOutput)
+    {
+        // write the binary tracks file
+        tracksStore.save(tracksFilename);
+    }
+    else
+    {
+        // write the json file with the tree
+        boost::json::value jv = boost::json::value_from(mapTracks);
+        std::ofstream of(tracksFilename);
+        of << boost::json::serialize(jv);
+        of.close();
+    }
 
     return EXIT_SUCCESS;
 }
@@ -225,6 +225,9 @@ int aliceVision_main(int argc, char** argv)
     selector.setMinOutFrames(minNbOutFrames);
     selector.setMaxOutFrames(maxNbOutFrames);
 
+    // The optical flow visualisation is written while the scores are computed, to compute the optical flow only once
+    selector.setExportFlowVisualisation(exportFlowVisualisation);
+
     if (flowVisualisationOnly) {
         bool exported = selector.exportFlowVisualisation(rescaledWidthFlow);
         if (exported)
@@ -0,0 +1,201 @@
+// This file is part of the AliceVision project.
+// Copyright (c) 2023 AliceVision contributors.
+// This Source Code Form is subject to the terms of the Mozilla Public License,
+// v. 2.0. If a copy of the MPL was not distributed with this file,
+// You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <aliceVision/system/Logger.hpp>
+#include <aliceVision/cmdline/cmdline.hpp>
+#include <aliceVision/system/main.hpp>
+#include <aliceVision/system/Timer.hpp>
+#include <aliceVision/system/MemoryInfo.hpp>
+#include <aliceVision/fuseCut/MaxFlow_AdjList.hpp>
+#include <aliceVision/fuseCut/MaxFlow_CSR.hpp>
+#include <aliceVision/fuseCut/MaxFlow_PushRelabel.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// These constants define the current software version.
+// They must be updated when the command line is changed.
+#define ALICEVISION_SOFTWARE_VERSION_MAJOR 1
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+
+using namespace aliceVision;
+
+namespace po = boost::program_options;
+
+/**
+ * @brief Synthetic s-t graph: a 3D grid of nodes connected to their 6 neighbors.
+ * Each pair of nodes is connected once, as required by MaxFlow_CSR.
+ */
+struct GridGraph
+{
+    struct GridEdge
+    {
+        unsigned int n1;
+        unsigned int n2;
+        float capacity;
+        float reverseCapacity;
+    };
+
+    std::size_t nbNodes = 0;
+    std::vector<float> source;
+    std::vector<float> sink;
+    std::vector<GridEdge> edges;
+};
+
+void generateGridGraph(int gridSize, unsigned int seed, GridGraph& out_graph)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> capacityDistribution(0.0f, 1.0f);
+    std::exponential_distribution<float> terminalDistribution(4.0f);
+
+    const auto nodeIndex = [gridSize](int x, int y, int z) { return unsigned(x + gridSize * (y + gridSize * z)); };
+
+    out_graph.nbNodes = std::size_t(gridSize) * gridSize * gridSize;
+    out_graph.source.resize(out_graph.nbNodes);
+    out_graph.sink.resize(out_graph.nbNodes);
+    out_graph.edges.clear();
+    out_graph.edges.reserve(out_graph.nbNodes * 3);
+
+    for(std::size_t n = 0; n < out_graph.nbNodes; ++n)
+    {
+        out_graph.source[n] = terminalDistribution(generator);
+        out_graph.sink[n] = terminalDistribution(generator);
+    }
+
+    for(int z = 0; z < gridSize; ++z)
+    {
+        for(int y = 0; y < gridSize; ++y)
+        {
+            for(int x = 0; x < gridSize; ++x)
+            {
+                const unsigned int n = nodeIndex(x, y, z);
+
+                if(x + 1 < gridSize)
+                    out_graph.edges.push_back({n, nodeIndex(x + 1, y, z), capacityDistribution(generator), capacityDistribution(generator)});
+                if(y + 1 < gridSize)
+                    out_graph.edges.push_back({n, nodeIndex(x, y + 1, z), capacityDistribution(generator), capacityDistribution(generator)});
+                if(z + 1 < gridSize)
+                    out_graph.edges.push_back({n, nodeIndex(x, y, z + 1), capacityDistribution(generator), capacityDistribution(generator)});
+            }
+        }
+    }
+}
+
+template <typename MaxFlowT>
+void runSolver(const std::string& name, const GridGraph& graph, std::vector<bool>& out_isTarget)
+{
+    const std::size_t peakMemoryBefore = system::getPeakProcessMemory();
+    system::Timer timer;
+
+    MaxFlowT maxFlowGraph(graph.nbNodes);
+
+    for(std::size_t n = 0; n < graph.nbNodes; ++n)
+        maxFlowGraph.addNode(n, graph.source[n], graph.sink[n]);
+
+    for(const auto& edge : graph.edges)
+        maxFlowGraph.addEdge(edge.n1, edge.n2, edge.capacity, edge.reverseCapacity);
+
+    const double buildTimeMs = timer.elapsedMs();
+    timer.reset();
+
+    const float flow = maxFlowGraph.compute();
+
+    const double computeTimeMs = timer.elapsedMs();
+
+    out_isTarget.resize(graph.nbNodes);
+    std::size_t nbTargets = 0;
+    for(std::size_t n = 0; n < graph.nbNodes; ++n)
+    {
+        out_isTarget[n] = maxFlowGraph.isTarget(n);
+        nbTargets += out_isTarget[n];
+    }
+
+    const std::size_t peakMemoryAfter = system::getPeakProcessMemory();
+
+    ALICEVISION_LOG_INFO("Solver " << name << ":" << std::endl
+                         << "\t- flow: " << flow << std::endl
+                         << "\t- # target (full) nodes: " << nbTargets << " / " << graph.nbNodes << std::endl
+                         << "\t- add nodes/edges time: " << system::prettyTime(buildTimeMs) << std::endl
+                         << "\t- compute time: " << system::prettyTime(computeTimeMs) << std::endl
+                         << "\t- process peak memory: " << (peakMemoryAfter / (1024 * 1024)) << " MB"
+                         << " (+" << ((peakMemoryAfter - peakMemoryBefore) / (1024 * 1024)) << " MB)");
+}
+
+int aliceVision_main(int argc, char** argv)
+{
+    int gridSize = 100;
+    unsigned int seed = 0;
+    std::vector<std::string> solvers = {"csr", "pushRelabel"};
+
+    po::options_description optionalParams("Optional parameters");
+    optionalParams.add_options()
+        ("gridSize", po::value<int>(&gridSize)->default_value(gridSize),
+            "Size of the synthetic 3D grid graph (gridSize^3 nodes, 6-connectivity).")
+        ("seed", po::value<unsigned int>(&seed)->default_value(seed),
+            "Seed used to generate the graph capacities.")
+        ("solvers", po::value<std::vector<std::string>>(&solvers)->multitoken()->default_value(solvers, "csr pushRelabel"),
+            "Solvers to benchmark, in this order: csr, adjList, pushRelabel.\n"
+            "The process peak memory is cumulative, run one solver per process to compare memory usage.");
+
+    CmdLine cmdline("Benchmark the graph cut solvers used by the meshing on a synthetic graph.\n"
+                    "AliceVision maxflowBenchmark");
+    cmdline.add(optionalParams);
+    if(!cmdline.execute(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if(gridSize < 2)
+    {
+        ALICEVISION_LOG_ERROR("Invalid value for gridSize parameter. Should be at least 2.");
+        return EXIT_FAILURE;
+    }
+
+    system::Timer timer;
+    GridGraph graph;
+    generateGridGraph(gridSize, seed, graph);
+
+    ALICEVISION_LOG_INFO("Synthetic graph generated in " << system::prettyTime(timer.elapsedMs()) << ":" << std::endl
+                         << "\t- # nodes: " << graph.nbNodes << std::endl
+                         << "\t- # edges: " << graph.edges.size());
+
+    std::vector<bool> referenceIsTarget;
+
+    for(const std::string& solver : solvers)
+    {
+        std::vector<bool> isTarget;
+
+        if(solver == "csr")
+            runSolver<fuseCut::MaxFlow_CSR>(solver, graph, isTarget);
+        else if(solver == "adjList")
+            runSolver<fuseCut::MaxFlow_AdjList>(solver, graph, isTarget);
+        else if(solver == "pushRelabel")
+            runSolver<fuseCut::MaxFlow_PushRelabel>(solver, graph, isTarget);
+        else
+        {
+            ALICEVISION_LOG_ERROR("Unknown solver: " << solver);
+            return EXIT_FAILURE;
+        }
+
+        // compare the labeling with the first solver
+        if(referenceIsTarget.empty())
+        {
+            referenceIsTarget.swap(isTarget);
+            continue;
+        }
+
+        std::size_t nbDifferences = 0;
+        for(std::size_t n = 0; n < graph.nbNodes; ++n)
+            nbDifferences += (referenceIsTarget[n] != isTarget[n]);
+
+        ALICEVISION_LOG_INFO("Solver " << solver << ": " << nbDifferences << " node label(s) differ from solver " << solvers.front() << ".");
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -23,11 +23,12 @@
 #include <fstream>
 #include <string>
 #include <chrono>
+#include <random>
 
 // These constants define the current software version.
 // They must be updated when the command line is changed.
 #define ALICEVISION_SOFTWARE_VERSION_MAJOR 1
-#define ALICEVISION_SOFTWARE_VERSION_MINOR 0
+#define ALICEVISION_SOFTWARE_VERSION_MINOR 1
 
 static const int DIMENSION = 128;
 
@@ -53,6 +54,10 @@ int aliceVision_main(int argc, char** argv)
   std::uint32_t restart = 5;
   std::uint32_t LEVELS = 6;
   bool sanityCheck = true;
+  std::size_t maxDescriptors = 0;
+  std::size_t miniBatchSize = 0;
+  bool parallelSubtrees = false;
+  int randomSeed = std::mt19937::default_seed;
 
   po::options_description requiredParams("Required parameters");
   requiredParams.add_options()
@@ -67,7 +72,18 @@ int aliceVision_main(int argc, char** argv)
     (",k", po::value<uint32_t>(&K)->default_value(10), "The branching factor of the tree")
     ("restart,r", po::value<uint32_t>(&restart)->default_value(5), "Number of times that the kmean is launched for each cluster, the best solution is kept")
     (",L", po::value<uint32_t>(&LEVELS)->default_value(6), "Number of levels of the tree")
-    ("sanitycheck,s", po::value<bool>(&sanityCheck)->default_value(sanityCheck), "Perform a sanity check at the end of the creation of the vocabulary tree. The sanity check is a query to the database with the same documents/images useed to train the vocabulary tree");
+    ("sanitycheck,s", po::value<bool>(&sanityCheck)->default_value(sanityCheck), "Perform a sanity check at the end of the creation of the vocabulary tree. The sanity check is a query to the database with the same documents/images useed to train the vocabulary tree")
+    ("maxDescriptors", po::value<std::size_t>(&maxDescriptors)->default_value(maxDescriptors),
+      "Maximum number of descriptors used to train the tree, uniformly sampled from the descriptor files without loading all of them in memory. "
+      "The descriptors are then quantized file by file. 0 to use all the descriptors.")
+    ("miniBatchSize", po::value<std::size_t>(&miniBatchSize)->default_value(miniBatchSize),
+      "Number of descriptors per iteration of the mini-batch k-means, used on the nodes with more descriptors. 0 to use the standard k-means.")
+    ("parallelSubtrees", po::value<bool>(&parallelSubtrees)->default_value(parallelSubtrees),
+      "Cluster the nodes of a level in parallel once there are enough of them. "
+      "The tree is the same as the sequential one for a given seed, up to the floating point summation order of the k-means.")
+    ("randomSeed", po::value<int>(&randomSeed)->default_value(randomSeed),
+      "This seed value will generate a sequence using a linear random generator, for the descriptors sampling and the k-means. "
+      "Set -1 to use a random seed.");
 
   CmdLine cmdline("This program is used to load the sift descriptors from a SfMData file and create a vocabulary tree.\n"
                   "It takes as input either a list.txt file containing a simple list of images (bundler format and older AliceVision version format)\n"
@@ -93,7 +109,16 @@ int aliceVision_main(int argc, char** argv)
   std::vector<size_t> descRead;
   ALICEVISION_COUT("Reading descriptors from " << sfmDataFilename);
   auto detect_start = std::chrono::steady_clock::now();
-  size_t numTotDescriptors = aliceVision::voctree::readDescFromFiles<DescriptorFloat, DescriptorUChar>(sfmData, featuresFolders, descriptors, descRead);
+  size_t numTotDescriptors = 0;
+  const unsigned int seed = (randomSeed == -1) ? std::random_device()() : static_cast<unsigned int>(randomSeed);
+  if(maxDescriptors > 0)
+  {
+    numTotDescriptors = aliceVision::voctree::sampleDescFromFiles<DescriptorFloat, DescriptorUChar>(sfmData, featuresFolders, maxDescriptors, seed, descriptors);
+  }
+  else
+  {
+    numTotDescriptors = aliceVision::voctree::readDescFromFiles<DescriptorFloat, DescriptorUChar>(sfmData, featuresFolders, descriptors, descRead);
+  }
   auto detect_end = std::chrono::steady_clock::now();
   auto detect_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(detect_end - detect_start);
   if(descriptors.empty())
@@ -102,13 +127,16 @@ int aliceVision_main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
-  ALICEVISION_COUT("Done! " << descRead.size() << " sets of descriptors read for a total of " << numTotDescriptors << " features");
+  ALICEVISION_COUT("Done! " << descriptors.size() << " descriptors used for training out of a total of " << numTotDescriptors << " features");
   ALICEVISION_COUT("Reading took " << detect_elapsed.count() << " sec");
 
   // Create tree
   aliceVision::voctree::TreeBuilder<DescriptorFloat> builder(DescriptorFloat(0));
   builder.setVerbose(tbVerbosity);
   builder.kmeans().setRestarts(restart);
+  builder.kmeans().setMiniBatchSize(miniBatchSize);
+  builder.kmeans().setSeed(seed);
+  builder.setParallelSubtrees(parallelSubtrees);
   ALICEVISION_COUT("Building a tree of L=" << LEVELS << " levels with a branching factor of k=" << K);
   detect_start = std::chrono::steady_clock::now();
   builder.build(descriptors, K, LEVELS);
@@ -123,31 +151,46 @@ int aliceVision_main(int argc, char** argv)
   // temporary vector used to save all the visual word for each image before adding them to documents
   std::vector<aliceVision::voctree::Word> imgVisualWords;
   ALICEVISION_COUT("Quantizing the features");
-  size_t offset = 0; ///< this is used to align to the features of a given image in 'feature'
   detect_start = std::chrono::steady_clock::now();
-  // pass each feature through the vocabulary tree to get the associated visual word
-  // for each read images, recover the number of features in it from descRead and loop over the features
-  for(size_t i = 0; i < descRead.size(); ++i)
+
+  // quantize the features of the i-th image and add its histogram to the documents
+  const auto addDocument = [&](std::size_t i, const DescriptorFloat* imageDescriptors, std::size_t nbDescriptors)
   {
-    // for each image:
     // clear the temporary vector used to save all the visual word and allocate the proper size
-    imgVisualWords.clear();
-    // allocate as many visual words as the number of the features in the image
-    imgVisualWords.resize(descRead[i], 0);
-
-    #pragma omp parallel for
-    for(ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(descRead[i]); ++j)
-    {
-      //	store the visual word associated to the feature in the temporary list
-      imgVisualWords[j] = builder.tree().quantize(descriptors[ j + offset ]);
-    }
+    imgVisualWords.assign(nbDescriptors, 0);
+    // store the visual words associated to the features in the temporary list
+    builder.tree().quantize(imageDescriptors, nbDescriptors, imgVisualWords.data());
     aliceVision::voctree::SparseHistogram histo;
     aliceVision::voctree::computeSparseHistogram(imgVisualWords, histo);
     // add the vector to the documents
     allSparseHistograms[i] = histo;
+  };
 
-    // update the offset
-    offset += descRead[i];
+  if(maxDescriptors > 0)
+  {
+    // the training descriptors are only a sample, read the descriptor files one by one
+    std::vector<DescriptorFloat>().swap(descriptors);
+    std::map<IndexT, std::string> descriptorsFiles;
+    aliceVision::voctree::getListOfDescriptorFiles(sfmData, featuresFolders, descriptorsFiles);
+
+    std::size_t i = 0;
+    for(const auto& descriptorsFile : descriptorsFiles)
+    {
+      feature::loadDescsFromBinFile<DescriptorFloat, DescriptorUChar>(descriptorsFile.second, descriptors, false);
+      addDocument(i++, descriptors.data(), descriptors.size());
+    }
+  }
+  else
+  {
+    size_t offset = 0; ///< this is used to align to the features of a given image in 'feature'
+    // pass each feature through the vocabulary tree to get the associated visual word
+    // for each read images, recover the number of features in it from descRead and loop over the features
+    for(size_t i = 0; i < descRead.size(); ++i)
+    {
+      addDocument(i, descriptors.data() + offset, descRead[i]);
+      // update the offset
+      offset += descRead[i];
+    }
   }
   detect_end = std::chrono::steady_clock::now();
   detect_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(detect_end - detect_start);